@@ -0,0 +1 @@
+#define RRR_BUILD_DIR "/root/repo"
@@ -0,0 +1 @@
+#define RRR_BUILD_TIMESTAMP  20261018162258
@@ -784,6 +784,8 @@ static int __rrr_cmodule_helper_event_periodic (
 
 		rrr_stats_instance_update_rate(INSTANCE_D_STATS(thread_data), 1, "mmap_to_child_full_events", write_full_counter);
 		rrr_stats_instance_post_unsigned_base10_text(INSTANCE_D_STATS(thread_data), "mmap_to_child_count", 0, count);
+		rrr_stats_instance_shm_value_set(INSTANCE_D_STATS(thread_data), RRR_STATS_SHM_VALUE_MMAP_TO_CHILD_FULL_EVENTS, write_full_counter);
+		rrr_stats_instance_shm_value_set(INSTANCE_D_STATS(thread_data), RRR_STATS_SHM_VALUE_MMAP_TO_CHILD_COUNT, count);
 	}
 	{
 		unsigned long long int count = 0;
@@ -797,6 +799,8 @@ static int __rrr_cmodule_helper_event_periodic (
 
 		rrr_stats_instance_update_rate(INSTANCE_D_STATS(thread_data), 5, "mmap_to_parent_full_events", write_full_counter);
 		rrr_stats_instance_post_unsigned_base10_text(INSTANCE_D_STATS(thread_data), "mmap_to_parent_count", 0, count);
+		rrr_stats_instance_shm_value_set(INSTANCE_D_STATS(thread_data), RRR_STATS_SHM_VALUE_MMAP_TO_PARENT_FULL_EVENTS, write_full_counter);
+		rrr_stats_instance_shm_value_set(INSTANCE_D_STATS(thread_data), RRR_STATS_SHM_VALUE_MMAP_TO_PARENT_COUNT, count);
 	}
 	{
 		char buf_path[128];
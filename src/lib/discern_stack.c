@@ -36,6 +36,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define RRR_DISCERN_STACK_MAX 64
 
+// Operand results of a collection are stored on the stack during
+// execution unless there are more operands than this
+#define RRR_DISCERN_STACK_OPERAND_RESULTS_MAX 256
+
 enum rrr_discern_stack_element_type {
 	RRR_DISCERN_STACK_E_NONE,
 	RRR_DISCERN_STACK_E_TOPIC_FILTER,
@@ -91,18 +95,55 @@ struct rrr_discern_stack_list {
 	rrr_length wpos;
 };
 
-struct rrr_discern_stack_value_list {
+// Instructions of compiled definitions. PUSH and SKIP instructions
+// use the argument, for APPLY it is the position of the destination
+// name in the storage.
+enum rrr_discern_stack_instruction_code {
+	RRR_DISCERN_STACK_I_PUSH,
+	RRR_DISCERN_STACK_I_PUSH_OPERAND,
+	RRR_DISCERN_STACK_I_AND,
+	RRR_DISCERN_STACK_I_OR,
+	RRR_DISCERN_STACK_I_NOT,
+	RRR_DISCERN_STACK_I_APPLY,
+	RRR_DISCERN_STACK_I_POP,
+	RRR_DISCERN_STACK_I_BAIL,
+	RRR_DISCERN_STACK_I_SKIP_IF_FALSE,
+	RRR_DISCERN_STACK_I_SKIP_IF_TRUE
+};
+
+struct rrr_discern_stack_instruction {
+	enum rrr_discern_stack_instruction_code code;
+	rrr_length arg;
+};
+
+// Topic filter or array tag. Equal operands share the same
+// collection index and are evaluated once per execution.
+struct rrr_discern_stack_operand {
+	enum rrr_discern_stack_element_type type;
 	rrr_length data_pos;
-	rrr_length size;
+	rrr_length data_size;
+	rrr_length value;
+	rrr_length collection_index;
 };
 
 struct rrr_discern_stack {
 	RRR_LL_NODE(struct rrr_discern_stack);
 	struct rrr_discern_stack_list exe_list;
 	struct rrr_discern_stack_storage exe_storage;
+	struct rrr_discern_stack_instruction *program;
+	rrr_length program_size;
+	struct rrr_discern_stack_operand *operands;
+	rrr_length operand_count;
 	char *name;
 };
 
+struct rrr_discern_stack_execute_state {
+	// Zero means not evaluated, otherwise the result plus one
+	uint8_t *operand_results;
+	struct rrr_discern_stack_index_entry *index;
+	rrr_length index_size;
+};
+
 static int __rrr_discern_stack_storage_push (
 		rrr_length *position,
 		struct rrr_discern_stack_storage *target,
@@ -182,6 +223,8 @@ static void __rrr_discern_stack_destroy (
 		struct rrr_discern_stack *discern_stack
 ) {
 	__rrr_discern_stack_storage_clear(&discern_stack->exe_storage);
+	RRR_FREE_IF_NOT_NULL(discern_stack->program);
+	RRR_FREE_IF_NOT_NULL(discern_stack->operands);
 	rrr_free(discern_stack->name);
 	rrr_free(discern_stack);
 }
@@ -396,10 +439,220 @@ static int __rrr_discern_stack_new (
 		return ret;
 }
 
+static rrr_length __rrr_discern_stack_compile_operand (
+		struct rrr_discern_stack_operand *operands,
+		rrr_length *operand_count,
+		const struct rrr_discern_stack_storage *storage,
+		const struct rrr_discern_stack_element *node
+) {
+	const char *str = storage->data + node->value.data_pos;
+
+	for (rrr_length i = 0; i < *operand_count; i++) {
+		if (operands[i].type == node->type && strcmp(storage->data + operands[i].data_pos, str) == 0) {
+			return i;
+		}
+	}
+
+	struct rrr_discern_stack_operand *operand = &operands[*operand_count];
+
+	operand->type = node->type;
+	operand->data_pos = node->value.data_pos;
+	operand->data_size = node->value.data_size;
+	operand->value = node->value.value;
+	operand->collection_index = 0;
+
+	return (*operand_count)++;
+}
+
+struct rrr_discern_stack_compile_slot {
+	rrr_length start;
+	rrr_length data_pos;
+	int is_pure;
+};
+
+/*
+ * Compile a verified list into a program. The list is run through once while
+ * keeping track of which instructions produced each stack value. When the second
+ * operand of AND or OR has no side effects, a SKIP instruction is placed before
+ * it to avoid evaluating it if the first operand alone decides the result.
+ */
+static int __rrr_discern_stack_compile (
+		struct rrr_discern_stack *discern_stack
+) {
+	const struct rrr_discern_stack_list *list = &discern_stack->exe_list;
+	const struct rrr_discern_stack_storage *storage = &discern_stack->exe_storage;
+	const struct rrr_discern_stack_element *elements = storage->data + list->data_pos;
+
+	int ret = 0;
+
+	struct rrr_discern_stack_compile_slot slots[RRR_DISCERN_STACK_MAX];
+	struct rrr_discern_stack_instruction *program = NULL;
+	struct rrr_discern_stack_operand *operands = NULL;
+	rrr_length program_size = 0;
+	rrr_length operand_count = 0;
+	rrr_length wpos = 0;
+
+	assert(discern_stack->program == NULL && discern_stack->operands == NULL);
+	assert(list->wpos > 0);
+
+	// Each AND and OR may produce one extra instruction
+	if ((program = rrr_allocate(sizeof(*program) * list->wpos * 2)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	if ((operands = rrr_allocate(sizeof(*operands) * list->wpos)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	for (rrr_length i = 0; i < list->wpos; i++) {
+		const struct rrr_discern_stack_element *node = &elements[i];
+		struct rrr_discern_stack_instruction *instruction;
+		struct rrr_discern_stack_compile_slot *a, *b;
+
+		switch (node->op) {
+			case RRR_DISCERN_STACK_OP_PUSH:
+				assert(wpos < RRR_DISCERN_STACK_MAX);
+				slots[wpos].start = program_size;
+				slots[wpos].data_pos = node->value.data_pos;
+				slots[wpos].is_pure = 1;
+				wpos++;
+
+				instruction = &program[program_size++];
+				switch (node->type) {
+					case RRR_DISCERN_STACK_E_TOPIC_FILTER:
+					case RRR_DISCERN_STACK_E_ARRAY_TAG:
+						instruction->code = RRR_DISCERN_STACK_I_PUSH_OPERAND;
+						instruction->arg = __rrr_discern_stack_compile_operand (
+								operands,
+								&operand_count,
+								storage,
+								node
+						);
+						break;
+					case RRR_DISCERN_STACK_E_BOOL:
+						instruction->code = RRR_DISCERN_STACK_I_PUSH;
+						instruction->arg = node->value.value != 0;
+						break;
+					case RRR_DISCERN_STACK_E_DESTINATION:
+						// Destination value is never read, APPLY refers to the name directly
+						instruction->code = RRR_DISCERN_STACK_I_PUSH;
+						instruction->arg = 0;
+						break;
+					default:
+						assert(0);
+				};
+				break;
+			case RRR_DISCERN_STACK_OP_AND:
+			case RRR_DISCERN_STACK_OP_OR:
+				assert(wpos >= 2);
+				a = &slots[wpos - 2];
+				b = &slots[wpos - 1];
+				if (b->is_pure) {
+					memmove (
+							program + b->start + 1,
+							program + b->start,
+							sizeof(*program) * (program_size - b->start)
+					);
+					program[b->start].code = node->op == RRR_DISCERN_STACK_OP_AND
+						? RRR_DISCERN_STACK_I_SKIP_IF_FALSE
+						: RRR_DISCERN_STACK_I_SKIP_IF_TRUE;
+					// Skip the second operand and the operator itself
+					program[b->start].arg = program_size - b->start + 1;
+					program_size++;
+				}
+				program[program_size].code = node->op == RRR_DISCERN_STACK_OP_AND
+					? RRR_DISCERN_STACK_I_AND
+					: RRR_DISCERN_STACK_I_OR;
+				program[program_size].arg = 0;
+				program_size++;
+				a->is_pure &= b->is_pure;
+				wpos--;
+				break;
+			case RRR_DISCERN_STACK_OP_NOT:
+				program[program_size].code = RRR_DISCERN_STACK_I_NOT;
+				program[program_size].arg = 0;
+				program_size++;
+				break;
+			case RRR_DISCERN_STACK_OP_APPLY:
+				assert(wpos >= 2);
+				program[program_size].code = RRR_DISCERN_STACK_I_APPLY;
+				program[program_size].arg = slots[wpos - 1].data_pos;
+				program_size++;
+				wpos--;
+				slots[wpos - 1].is_pure = 0;
+				break;
+			case RRR_DISCERN_STACK_OP_POP:
+			case RRR_DISCERN_STACK_OP_BAIL:
+				assert(wpos >= 1);
+				program[program_size].code = node->op == RRR_DISCERN_STACK_OP_POP
+					? RRR_DISCERN_STACK_I_POP
+					: RRR_DISCERN_STACK_I_BAIL;
+				program[program_size].arg = 0;
+				program_size++;
+				wpos--;
+				if (wpos > 0) {
+					slots[wpos - 1].is_pure &= node->op == RRR_DISCERN_STACK_OP_POP && slots[wpos].is_pure;
+				}
+				break;
+			default:
+				assert(0);
+		};
+	}
+
+	assert(wpos == 0);
+
+	discern_stack->program = program;
+	discern_stack->program_size = program_size;
+	discern_stack->operands = operands;
+	discern_stack->operand_count = operand_count;
+
+	program = NULL;
+	operands = NULL;
+
+	out:
+	RRR_FREE_IF_NOT_NULL(program);
+	RRR_FREE_IF_NOT_NULL(operands);
+	return ret;
+}
+
+static void __rrr_discern_stack_collection_append (
+		struct rrr_discern_stack_collection *collection,
+		struct rrr_discern_stack *discern_stack
+) {
+	for (rrr_length i = 0; i < discern_stack->operand_count; i++) {
+		struct rrr_discern_stack_operand *operand = &discern_stack->operands[i];
+		const char *str = discern_stack->exe_storage.data + operand->data_pos;
+
+		operand->collection_index = collection->operand_count;
+
+		RRR_LL_ITERATE_BEGIN(collection, const struct rrr_discern_stack);
+			for (rrr_length j = 0; j < node->operand_count; j++) {
+				const struct rrr_discern_stack_operand *existing = &node->operands[j];
+				if (existing->type == operand->type && strcmp(node->exe_storage.data + existing->data_pos, str) == 0) {
+					operand->collection_index = existing->collection_index;
+					RRR_LL_ITERATE_LAST();
+					break;
+				}
+			}
+		RRR_LL_ITERATE_END();
+
+		if (operand->collection_index == collection->operand_count) {
+			collection->operand_count++;
+		}
+	}
+
+	RRR_LL_APPEND(collection, discern_stack);
+}
+
 void rrr_discern_stack_collection_clear (
 		struct rrr_discern_stack_collection *list
 ) {
 	RRR_LL_DESTROY(list, struct rrr_discern_stack, __rrr_discern_stack_destroy(node));
+	list->operand_count = 0;
 }
 
 const struct rrr_discern_stack *rrr_discern_stack_collection_get (
@@ -434,7 +687,11 @@ int rrr_discern_stack_collection_add_cloned (
 		goto out_destroy;
 	}
 
-	RRR_LL_APPEND(list, new_discern_stack);
+	if ((ret = __rrr_discern_stack_compile (new_discern_stack)) != 0) {
+		goto out_destroy;
+	}
+
+	__rrr_discern_stack_collection_append(list, new_discern_stack);
 
 	goto out;
 	out_destroy:
@@ -626,25 +883,87 @@ static int __rrr_discern_stack_execute_apply_cb_dummy (RRR_DISCERN_STACK_APPLY_C
 	return 0;
 }
 
+static int __rrr_discern_stack_execute_operand (
+		rrr_length *result,
+		const struct rrr_discern_stack *discern_stack,
+		const struct rrr_discern_stack_operand *operand,
+		const struct rrr_discern_stack_callbacks *callbacks,
+		struct rrr_discern_stack_execute_state *state
+) {
+	int ret = 0;
+
+	const char *str = discern_stack->exe_storage.data + operand->data_pos;
+	rrr_length index_result;
+
+	uint8_t *cached_result = &state->operand_results[operand->collection_index];
+	if (*cached_result) {
+		*result = *cached_result - 1;
+		goto out;
+	}
+
+	switch (operand->type) {
+		case RRR_DISCERN_STACK_E_TOPIC_FILTER:
+			if ((ret = callbacks->resolve_topic_filter_cb (
+					result,
+					str,
+					operand->data_size,
+					callbacks->resolve_cb_arg
+			)) != 0) {
+				goto out;
+			}
+			break;
+		case RRR_DISCERN_STACK_E_ARRAY_TAG:
+			// Check against any index from the callback. If the first and last
+			// letter do not match any index entry, we produce false result
+			// immediately.
+			index_result = 1;
+			for (rrr_length i = 0; i < state->index_size; i++) {
+				if ((index_result = state->index[i].id == operand->value)) {
+					break;
+				}
+			}
+
+			if (!index_result) {
+				*result = 0;
+				break;
+			}
+
+			// The callback may set a temporary index used to quickly eliminate
+			// H array tag check without calling the callback. The callback
+			// may set the index one time during an execution session.
+			if ((ret = callbacks->resolve_array_tag_cb (
+					result,
+					&state->index,
+					&state->index_size,
+					str,
+					callbacks->resolve_cb_arg
+			)) != 0) {
+				goto out;
+			}
+			break;
+		default:
+			assert(0);
+	};
+
+	*cached_result = (uint8_t) ((*result != 0) + 1);
+
+	out:
+	return ret;
+}
+
 /*
- * Fast execute with no checks of any kind. The list being
- * run should be verified first during parsing.
+ * Fast execute of the compiled program with no checks of any kind. The
+ * list the program is compiled from is verified during parsing.
  */
 static int __rrr_discern_stack_execute (
 		enum rrr_discern_stack_fault *fault,
-		struct rrr_discern_stack *discern_stack,
-		const struct rrr_discern_stack_callbacks *callbacks
+		const struct rrr_discern_stack *discern_stack,
+		const struct rrr_discern_stack_callbacks *callbacks,
+		struct rrr_discern_stack_execute_state *state
 ) {
-	const struct rrr_discern_stack_list *list = &discern_stack->exe_list;
-	struct rrr_discern_stack_storage *list_storage = &discern_stack->exe_storage;
-
 	int ret = 0;
 
-	struct rrr_discern_stack_value_list stack = {
-		.data_pos = 0,
-		.size = RRR_DISCERN_STACK_MAX
-	};
-	struct rrr_discern_stack_value stack_e[RRR_DISCERN_STACK_MAX];
+	rrr_length stack[RRR_DISCERN_STACK_MAX];
 	rrr_length wpos = 0;
 
 	int (*const apply_cbs[2])(RRR_DISCERN_STACK_APPLY_CB_ARGS) = {
@@ -652,103 +971,66 @@ static int __rrr_discern_stack_execute (
 		callbacks->apply_cb_true
 	};
 
-	const struct rrr_discern_stack_element *node;
-	struct rrr_discern_stack_index_entry *index_tmp = NULL;
-	rrr_length index_tmp_size = 0;
-	rrr_length index_result;
-
-	memset(stack_e, '\0', sizeof(stack_e));
-
 	*fault = RRR_DISCERN_STACK_FAULT_OK;
 
-	for (rrr_length i = 0; i < list->wpos; i++) {
-		assert (wpos < stack.size);
+	for (rrr_length pc = 0; pc < discern_stack->program_size; pc++) {
+		const struct rrr_discern_stack_instruction *instruction = &discern_stack->program[pc];
 
-		node = &((const struct rrr_discern_stack_element *) (list_storage->data + list->data_pos))[i];
+		assert (wpos < RRR_DISCERN_STACK_MAX);
 
-		switch (node->op) {
-			case RRR_DISCERN_STACK_OP_PUSH:
-				switch (node->type) {
-					case RRR_DISCERN_STACK_E_TOPIC_FILTER:
-						if ((ret = callbacks->resolve_topic_filter_cb (
-								&stack_e[wpos++].value,
-								list_storage->data + node->value.data_pos,
-								node->value.data_size,
-								callbacks->resolve_cb_arg
-						)) != 0) {
-							goto out;
-						}
-						break;
-					case RRR_DISCERN_STACK_E_ARRAY_TAG:
-						// Check against any index from the callback. If the first and last
-						// letter do not match any index entry, we produce false result
-						// immediately.
-						index_result = 1;
-						for (rrr_length i = 0; i < index_tmp_size; i++) {
-							if ((index_result = index_tmp[i].id == node->value.value)) {
-								break;
-							}
-						}
-
-						if (!index_result) {
-							stack_e[wpos++].value = 0;
-							break;
-						}
-
-						// The callback may set a temporary index used to quickly eliminate
-						// H array tag check without calling the callback. The callback
-						// may set the index one time during an execution session.
-						if ((ret = callbacks->resolve_array_tag_cb (
-								&stack_e[wpos++].value,
-								&index_tmp,
-								&index_tmp_size,
-								list_storage->data + node->value.data_pos,
-								callbacks->resolve_cb_arg
-						)) != 0) {
-							goto out;
-						}
-						break;
-					case RRR_DISCERN_STACK_E_BOOL:
-						stack_e[wpos++].value = 1;
-						break;
-					case RRR_DISCERN_STACK_E_DESTINATION:
-						stack_e[wpos++] = node->value;
-						break;
-					default:
-						assert(0);
-				};
+		switch (instruction->code) {
+			case RRR_DISCERN_STACK_I_PUSH:
+				stack[wpos++] = instruction->arg;
 				break;
-			case RRR_DISCERN_STACK_OP_AND:
-				stack_e[wpos - 2].value =
-					stack_e[wpos - 1].value &&
-					stack_e[wpos - 2].value;
+			case RRR_DISCERN_STACK_I_PUSH_OPERAND:
+				if ((ret = __rrr_discern_stack_execute_operand (
+						&stack[wpos++],
+						discern_stack,
+						&discern_stack->operands[instruction->arg],
+						callbacks,
+						state
+				)) != 0) {
+					*fault = RRR_DISCERN_STACK_FAULT_CRITICAL;
+					goto out;
+				}
+				break;
+			case RRR_DISCERN_STACK_I_AND:
+				stack[wpos - 2] = stack[wpos - 1] && stack[wpos - 2];
 				wpos--;
 				break;
-			case RRR_DISCERN_STACK_OP_OR:
-				stack_e[wpos - 2].value =
-					stack_e[wpos - 1].value ||
-					stack_e[wpos - 2].value;
+			case RRR_DISCERN_STACK_I_OR:
+				stack[wpos - 2] = stack[wpos - 1] || stack[wpos - 2];
 				wpos--;
 				break;
-			case RRR_DISCERN_STACK_OP_APPLY:
-				if ((ret = apply_cbs[stack_e[wpos - 2].value & 1](list_storage->data + stack_e[wpos - 1].data_pos, callbacks->apply_cb_arg)) != 0) {
+			case RRR_DISCERN_STACK_I_NOT:
+				stack[wpos - 1] = !stack[wpos - 1];
+				break;
+			case RRR_DISCERN_STACK_I_APPLY:
+				if ((ret = apply_cbs[stack[wpos - 2] != 0](discern_stack->exe_storage.data + instruction->arg, callbacks->apply_cb_arg)) != 0) {
 					*fault = RRR_DISCERN_STACK_FAULT_CRITICAL;
 					goto out;
 				}
 				wpos--;
 				break;
-			case RRR_DISCERN_STACK_OP_NOT:
-				stack_e[wpos - 1].value = !stack_e[wpos - 1].value;
-				break;
-			case RRR_DISCERN_STACK_OP_POP:
+			case RRR_DISCERN_STACK_I_POP:
 				wpos--;
 				break;
-			case RRR_DISCERN_STACK_OP_BAIL:
-				if (stack_e[wpos - 1].value) {
+			case RRR_DISCERN_STACK_I_BAIL:
+				if (stack[--wpos]) {
 					ret = RRR_DISCERN_STACK_BAIL;
 					goto out;
 				}
 				break;
+			case RRR_DISCERN_STACK_I_SKIP_IF_FALSE:
+				if (!stack[wpos - 1]) {
+					pc += instruction->arg;
+				}
+				break;
+			case RRR_DISCERN_STACK_I_SKIP_IF_TRUE:
+				if (stack[wpos - 1]) {
+					pc += instruction->arg;
+				}
+				break;
 			default:
 				assert(0);
 		}
@@ -757,7 +1039,6 @@ static int __rrr_discern_stack_execute (
 	assert(wpos == 0);
 
 	out:
-	RRR_FREE_IF_NOT_NULL(index_tmp);
 	return ret;
 }
 
@@ -768,19 +1049,47 @@ int rrr_discern_stack_collection_execute (
 ) {
 	int ret = 0;
 
+	uint8_t operand_results[RRR_DISCERN_STACK_OPERAND_RESULTS_MAX];
+	struct rrr_discern_stack_execute_state state = {
+		operand_results,
+		NULL,
+		0
+	};
+
 	*fault = RRR_DISCERN_STACK_FAULT_OK;
 
-	RRR_LL_ITERATE_BEGIN(collection, struct rrr_discern_stack);
+	if (collection->operand_count > RRR_DISCERN_STACK_OPERAND_RESULTS_MAX) {
+		if ((state.operand_results = rrr_allocate_zero(collection->operand_count)) == NULL) {
+			RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+			*fault = RRR_DISCERN_STACK_FAULT_CRITICAL;
+			ret = 1;
+			goto out;
+		}
+	}
+	else {
+		memset(operand_results, '\0', collection->operand_count);
+	}
+
+	RRR_LL_ITERATE_BEGIN(collection, const struct rrr_discern_stack);
 		if ((ret = __rrr_discern_stack_execute (
 				fault,
 				node,
-				callbacks
+				callbacks,
+				&state
 		)) != 0) {
+			if (ret == RRR_DISCERN_STACK_BAIL) {
+				// Stop processing, not an error
+				ret = 0;
+			}
 			goto out;
 		}
 	RRR_LL_ITERATE_END();
 
 	out:
+	if (state.operand_results != operand_results) {
+		RRR_FREE_IF_NOT_NULL(state.operand_results);
+	}
+	RRR_FREE_IF_NOT_NULL(state.index);
 	return ret;
 }
 
@@ -1200,7 +1509,12 @@ int rrr_discern_stack_interpret (
 		goto out_destroy;
 	}
 
-	RRR_LL_APPEND(target, discern_stack);
+	if ((ret = __rrr_discern_stack_compile(discern_stack)) != 0) {
+		*fault = RRR_DISCERN_STACK_FAULT_CRITICAL;
+		goto out_destroy;
+	}
+
+	__rrr_discern_stack_collection_append(target, discern_stack);
 
 	goto out;
 	out_destroy:
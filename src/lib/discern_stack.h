@@ -31,6 +31,8 @@ struct rrr_parse_pos;
 
 struct rrr_discern_stack_collection {
 	RRR_LL_HEAD(struct rrr_discern_stack);
+	// Number of distinct topic filters and array tags in all stacks
+	rrr_length operand_count;
 };
 
 struct rrr_discern_stack_index_entry {
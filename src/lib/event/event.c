@@ -24,6 +24,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdint.h>
 #include <errno.h>
 #include <sys/mman.h>
+#include <pthread.h>
+
+#include <event2/thread.h>
 
 #include "../log.h"
 #include "../allocator.h"
@@ -253,7 +256,7 @@ static void __rrr_event_signal_event (
 			}
 			else {
 				RRR_DBG_9_PRINTF("EQ DISP %p error from eventfd read, ending loop\n", queue);
-				event_base_loopbreak(queue->event_base);
+				rrr_event_dispatch_break(queue);
 			}
 		}
 	}
@@ -360,6 +363,25 @@ int rrr_event_dispatch (
 	}
 
 	queue->callback_ret = 0;
+	queue->break_error = 0;
+
+	if (queue->dispatch_hook != NULL) {
+		// The event base is shared and is dispatched by the hook
+		if ((ret = queue->dispatch_hook(queue->dispatch_hook_arg)) != 0) {
+			RRR_MSG_0("Error from dispatch hook in rrr_event_dispatch: %i\n", ret);
+			ret = 1;
+			goto out;
+		}
+
+		// Breaks caused by other queues sharing the base are not errors
+		if (queue->callback_ret != 0) {
+			ret = queue->callback_ret & ~(RRR_EVENT_EXIT);
+		}
+		else if (queue->break_error) {
+			ret = 1;
+		}
+		goto out;
+	}
 
 	if ((ret = event_base_dispatch(queue->event_base)) != 0) {
 		RRR_MSG_0("Error from event_base_dispatch in rrr_event_dispatch: %i\n", ret);
@@ -371,6 +393,10 @@ int rrr_event_dispatch (
 		ret = queue->callback_ret & ~(RRR_EVENT_EXIT);
 	}
 	else if (event_base_got_break(queue->event_base)) {
+		// Breaks caused by other queues sharing the base are not errors
+		if (!queue->break_error && rrr_atomic_u32_load(&queue->base_usercount) > 1) {
+			goto out;
+		}
 		ret = 1;
 		goto out;
 	}
@@ -382,6 +408,7 @@ int rrr_event_dispatch (
 void rrr_event_dispatch_break (
 		struct rrr_event_queue *queue
 ) {
+	queue->break_error = 1;
 	event_base_loopbreak(queue->event_base);
 }
 
@@ -448,6 +475,19 @@ void rrr_event_count (
 	*deferred_count = queue->deferred_amount[function];
 }
 
+// The queue owning an event base is freed together with the base
+// once all queues sharing the base are destroyed. Queues may be
+// destroyed by any thread.
+static void __rrr_event_queue_base_decref (
+		struct rrr_event_queue *owner
+) {
+	if (rrr_atomic_u32_fetch_sub(&owner->base_usercount, 1) > 1)
+		return;
+
+	event_base_free(owner->event_base);
+	rrr_free(owner);
+}
+
 void rrr_event_queue_destroy (
 		struct rrr_event_queue *queue
 ) {
@@ -470,8 +510,14 @@ void rrr_event_queue_destroy (
 	if (queue->unpause_event != NULL) {
 		event_free(queue->unpause_event);
 	}
-	event_base_free(queue->event_base);
-	rrr_free(queue);
+
+	if (queue->base_owner != NULL) {
+		__rrr_event_queue_base_decref(queue->base_owner);
+		rrr_free(queue);
+	}
+	else {
+		__rrr_event_queue_base_decref(queue);
+	}
 }
 
 
@@ -493,8 +539,18 @@ void rrr_event_queue_incref (
 	queue->usercount++;
 }
 
-int rrr_event_queue_new (
-		struct rrr_event_queue **target
+static pthread_once_t rrr_event_threads_once = PTHREAD_ONCE_INIT;
+static int rrr_event_threads_ret = 0;
+
+static void __rrr_event_threads_init (void) {
+	// Bases are created without locks unless they are shared
+	rrr_event_threads_ret = evthread_use_pthreads();
+}
+
+static int __rrr_event_queue_new (
+		struct rrr_event_queue **target,
+		struct rrr_event_queue *base_owner,
+		int shareable
 ) {
 	int ret = 0;
 
@@ -512,6 +568,12 @@ int rrr_event_queue_new (
 
 	struct rrr_event_queue *queue = NULL;
 
+	if (pthread_once(&rrr_event_threads_once, __rrr_event_threads_init) != 0 || rrr_event_threads_ret != 0) {
+		RRR_MSG_0("Could not initialize libevent threading in rrr_event_queue_new\n");
+		ret = 1;
+		goto out;
+	}
+
 	if ((cfg = event_config_new()) == NULL) {
 		RRR_MSG_0("Could not create event config in rrr_event_queue_new\n");
 		ret = 1;
@@ -525,6 +587,12 @@ int rrr_event_queue_new (
 		goto out;
 	}
 
+	if (!shareable && event_config_set_flag(cfg, EVENT_BASE_FLAG_NOLOCK) != 0) {
+		RRR_MSG_0("event_config_set_flag() failed in rrr_event_queue_new\n");
+		ret = 1;
+		goto out;
+	}
+
 	if ((queue = rrr_allocate(sizeof(*queue))) == NULL) {
 		RRR_MSG_0("Failed to allocate memory in rrr_event_queue_new\n");
 		ret = 1;
@@ -535,16 +603,25 @@ int rrr_event_queue_new (
 
 	queue->usercount = 1;
 
-	if ((queue->event_base = event_base_new_with_config(cfg)) == NULL) {
-		RRR_MSG_0("Could not create event base in rrr_event_queue_init\n");
-		ret = 1;
-		goto out_free;
+	if (base_owner != NULL) {
+		queue->event_base = base_owner->event_base;
+		queue->base_owner = base_owner;
+		rrr_atomic_u32_fetch_add(&base_owner->base_usercount, 1);
 	}
+	else {
+		if ((queue->event_base = event_base_new_with_config(cfg)) == NULL) {
+			RRR_MSG_0("Could not create event base in rrr_event_queue_init\n");
+			ret = 1;
+			goto out_free;
+		}
 
-	if (event_base_priority_init (queue->event_base, RRR_EVENT_PRIORITY_COUNT) != 0) {
-		RRR_MSG_0("Failed to initialize priority queues in rrr_event_queue_new\n");
-		ret = 1;
-		goto out_destroy_event_base;
+		if (event_base_priority_init (queue->event_base, RRR_EVENT_PRIORITY_COUNT) != 0) {
+			RRR_MSG_0("Failed to initialize priority queues in rrr_event_queue_new\n");
+			ret = 1;
+			goto out_destroy_event_base;
+		}
+
+		queue->base_usercount.value = 1;
 	}
 
 	if ((queue->periodic_event = event_new (
@@ -625,7 +702,12 @@ int rrr_event_queue_new (
 	out_destroy_periodic_event:
 		event_free(queue->periodic_event);
 	out_destroy_event_base:
-		event_base_free(queue->event_base);
+		if (base_owner != NULL) {
+			rrr_atomic_u32_fetch_sub(&base_owner->base_usercount, 1);
+		}
+		else {
+			event_base_free(queue->event_base);
+		}
 	out_free:
 		rrr_free(queue);
 	out:
@@ -634,3 +716,42 @@ int rrr_event_queue_new (
 		}
 		return ret;
 }
+
+int rrr_event_queue_new (
+		struct rrr_event_queue **target
+) {
+	return __rrr_event_queue_new(target, NULL, 0);
+}
+
+// The event base of this queue may be shared with other queues. The
+// base is created with locking as the queues may be destroyed by
+// other threads than the one dispatching.
+int rrr_event_queue_new_shareable (
+		struct rrr_event_queue **target
+) {
+	return __rrr_event_queue_new(target, NULL, 1);
+}
+
+// Create a queue using the event base of a shareable queue. A dispatch
+// hook must be set before the queue is dispatched.
+int rrr_event_queue_new_shared (
+		struct rrr_event_queue **target,
+		struct rrr_event_queue *base_owner
+) {
+	if (base_owner->base_owner != NULL) {
+		RRR_BUG("BUG: Base owner was itself sharing a base in %s\n", __func__);
+	}
+	return __rrr_event_queue_new(target, base_owner, 1);
+}
+
+void rrr_event_queue_dispatch_hook_set (
+		struct rrr_event_queue *queue,
+		int (*hook)(void *arg),
+		void *arg
+) {
+	if (queue->base_owner == NULL) {
+		RRR_BUG("BUG: Dispatch hook set on queue not sharing a base in %s\n", __func__);
+	}
+	queue->dispatch_hook = hook;
+	queue->dispatch_hook_arg = arg;
+}
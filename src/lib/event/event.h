@@ -109,6 +109,18 @@ void rrr_event_queue_incref (
 int rrr_event_queue_new (
 		struct rrr_event_queue **target
 );
+int rrr_event_queue_new_shareable (
+		struct rrr_event_queue **target
+);
+int rrr_event_queue_new_shared (
+		struct rrr_event_queue **target,
+		struct rrr_event_queue *base_owner
+);
+void rrr_event_queue_dispatch_hook_set (
+		struct rrr_event_queue *queue,
+		int (*hook)(void *arg),
+		void *arg
+);
 int rrr_event_queue_reinit (
 		struct rrr_event_queue *queue
 );
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "event.h"
 #include "event_functions.h"
 #include "../socket/rrr_socket_eventfd.h"
+#include "../util/atomic.h"
 
 struct rrr_event_queue;
 
@@ -55,6 +56,18 @@ struct rrr_event_queue {
 	void *callback_arg;
 	int callback_ret;
 
+	// Set when this queue breaks the loop because of an error. A
+	// shared base is also broken when other queues sharing it exit,
+	// which is not an error for this queue.
+	int break_error;
+
+	// Set when the event base is shared with other queues, the
+	// hook is then run instead of the event loop when dispatching
+	int (*dispatch_hook)(void *arg);
+	void *dispatch_hook_arg;
+	struct rrr_event_queue *base_owner;
+	rrr_atomic_u32_t base_usercount;
+
 	int usercount;
 };
 
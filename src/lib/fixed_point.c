@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "allocator.h"
 #include "util/rrr_endian.h"
 #include "util/gnu.h"
+#include "util/rrr_str.h"
 
 // 16#-0.000001 == 10#-0.00000005960464477539
 
@@ -158,30 +159,65 @@ int rrr_fixp_to_str_16 (
 	return 0;
 }
 
-int rrr_fixp_to_str_double (
+// Produces the same output as printf with %.10Lf using integer arithmetic only. The
+// 24 bit fraction multiplied by 10^10 fits in 64 bits, and the remainder is rounded
+// half to even like printf does. Writes at most RRR_FIXED_POINT_DEC_MAX bytes without
+// \0 termination and returns the number of bytes written.
+int rrr_fixp_to_dec (
 		char *target,
-		rrr_length target_size,
 		rrr_fixp source
 ) {
-	char buf[512];
-	long double intermediate = 0;
+	static const uint64_t decimals_factor = 10000000000ULL;
+	static const uint64_t fraction_mask = ((uint64_t) 1 << RRR_FIXED_POINT_BASE2_EXPONENT) - 1;
+
+	const int sign = source < 0;
+	const uint64_t positive = sign ? (uint64_t) 0 - (uint64_t) source : (uint64_t) source;
+
+	uint64_t whole_number = positive >> RRR_FIXED_POINT_BASE2_EXPONENT;
+	const uint64_t product = (positive & fraction_mask) * decimals_factor;
+	uint64_t decimals = product >> RRR_FIXED_POINT_BASE2_EXPONENT;
+	const uint64_t remainder = product & fraction_mask;
+	const uint64_t half = (uint64_t) 1 << (RRR_FIXED_POINT_BASE2_EXPONENT - 1);
+
+	if (remainder > half || (remainder == half && (decimals & 1))) {
+		if (++decimals == decimals_factor) {
+			decimals = 0;
+			whole_number++;
+		}
+	}
 
-	if (rrr_fixp_to_ldouble(&intermediate, source) != 0) {
-		return 1;
+	int wpos = 0;
+
+	if (sign) {
+		target[wpos++] = '-';
 	}
 
-	rrr_slength bytes = snprintf(buf, 511, "%.10Lf", intermediate);
-	if (bytes <= 0) {
-		return 1;
+	wpos += rrr_str_u64_to_dec(target + wpos, whole_number);
+	target[wpos++] = '.';
+
+	for (int i = RRR_FIXED_POINT_DEC_DECIMALS - 1; i >= 0; i--) {
+		target[wpos + i] = (char) ('0' + decimals % 10);
+		decimals /= 10;
 	}
 
-	if (bytes > 511 || bytes > rrr_length_dec_bug_const(target_size)) {
+	return wpos + RRR_FIXED_POINT_DEC_DECIMALS;
+}
+
+int rrr_fixp_to_str_double (
+		char *target,
+		rrr_length target_size,
+		rrr_fixp source
+) {
+	char buf[RRR_FIXED_POINT_DEC_MAX];
+
+	const int bytes = rrr_fixp_to_dec(buf, source);
+
+	if ((rrr_length) bytes > rrr_length_dec_bug_const(target_size)) {
 		return 1;
 	}
 
-	buf[bytes] = '\0';
-
-	memcpy(target, buf, (size_t) bytes + 1);
+	memcpy(target, buf, (size_t) bytes);
+	target[bytes] = '\0';
 
 	return 0;
 }
@@ -190,29 +226,19 @@ int rrr_fixp_to_new_str_double (
 		char **target,
 		rrr_fixp fixp
 ) {
-	int ret = 0;
-
 	*target = NULL;
 
 	char *buf = NULL;
 
-	long double intermediate = 0;
-	if (rrr_fixp_to_ldouble(&intermediate, fixp) != 0) {
-		ret = 1;
-		goto out;
+	if ((buf = rrr_allocate(RRR_FIXED_POINT_DEC_MAX + 1)) == NULL) {
+		return 1;
 	}
 
-	if (rrr_asprintf(&buf, "%.10Lf", intermediate) <= 0) {
-		ret = 0;
-		goto out;
-	}
+	buf[rrr_fixp_to_dec(buf, fixp)] = '\0';
 
 	*target = buf;
-	buf = NULL;
 
-	out:
-	RRR_FREE_IF_NOT_NULL(buf);
-	return ret;
+	return 0;
 }
 
 static long double __rrr_fixp_convert_char (char c) {
@@ -25,6 +25,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_FIXED_POINT_BASE2_EXPONENT 24
 #define RRR_FIXED_POINT_NUMBER_MAX 0x7FFFFFFFFF
 
+// Number of decimals produced when converting to decimal strings
+#define RRR_FIXED_POINT_DEC_DECIMALS 10
+// Maximum length of decimal string, sign + 12 digits + . + 10 decimals, not including \0
+#define RRR_FIXED_POINT_DEC_MAX 24
+
 #define RRR_FIXED_POINT_PARSE_OK			0
 #define RRR_FIXED_POINT_PARSE_ERR			1
 #define RRR_FIXED_POINT_PARSE_SOFT_ERR		2
@@ -50,6 +55,10 @@ int rrr_fixp_to_ldouble (
 		long double *target,
 		rrr_fixp source
 );
+int rrr_fixp_to_dec (
+		char *target,
+		rrr_fixp source
+);
 int rrr_fixp_to_str_16 (
 		char *target,
 		rrr_length target_size,
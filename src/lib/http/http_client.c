@@ -58,6 +58,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_HTTP_CLIENT_GRAYLIST_F_SHORT   (1<<0)
 #define RRR_HTTP_CLIENT_GRAYLIST_F_LONG    (1<<1)
 
+#define RRR_HTTP_CLIENT_POOL_FAILURES_UNHEALTHY    3
+
 struct rrr_http_client {
 	struct rrr_event_queue *events;
 
@@ -74,6 +76,8 @@ struct rrr_http_client {
 	struct rrr_http_service_collection alt_svc;
 
 	struct rrr_http_client_callbacks callbacks;
+
+	struct rrr_http_client_pool_stats pool_stats;
 };
 
 int rrr_http_client_new (
@@ -181,6 +185,66 @@ uint64_t rrr_http_client_active_transaction_count_get (
 	return result_accumulator + (unsigned long) RRR_LL_COUNT(&http_client->redirects);;
 }
 
+void rrr_http_client_tls_stats_get (
+		struct rrr_net_transport_tls_stats *target,
+		const struct rrr_http_client *http_client
+) {
+	memset(target, '\0', sizeof(*target));
+
+	if (http_client->transport_keepalive_tls != NULL) {
+		rrr_net_transport_tls_stats_get(target, http_client->transport_keepalive_tls);
+	}
+}
+
+static int __rrr_http_client_pool_stats_connection_count_callback (
+		struct rrr_net_transport_handle *handle,
+		void *arg
+) {
+	uint64_t *result_accumulator = arg;
+
+	(void)(handle);
+
+	(*result_accumulator)++;
+
+	return 0;
+}
+
+void rrr_http_client_pool_stats_get (
+		struct rrr_http_client_pool_stats *target,
+		const struct rrr_http_client *http_client
+) {
+	*target = http_client->pool_stats;
+
+	target->connections = 0;
+
+	if (http_client->transport_keepalive_plain != NULL) {
+		rrr_net_transport_iterate_by_mode_and_do (
+				http_client->transport_keepalive_plain,
+				RRR_NET_TRANSPORT_SOCKET_MODE_CONNECTION,
+				__rrr_http_client_pool_stats_connection_count_callback,
+				&target->connections
+		);
+	}
+
+	if (http_client->transport_keepalive_tls != NULL) {
+		rrr_net_transport_iterate_by_mode_and_do (
+				http_client->transport_keepalive_tls,
+				RRR_NET_TRANSPORT_SOCKET_MODE_CONNECTION,
+				__rrr_http_client_pool_stats_connection_count_callback,
+				&target->connections
+		);
+	}
+
+	if (http_client->transport_keepalive_quic != NULL) {
+		rrr_net_transport_iterate_by_mode_and_do (
+				http_client->transport_keepalive_quic,
+				RRR_NET_TRANSPORT_SOCKET_MODE_CONNECTION,
+				__rrr_http_client_pool_stats_connection_count_callback,
+				&target->connections
+		);
+	}
+}
+
 static int __rrr_http_client_websocket_response_available_notify_callback (
 		struct rrr_net_transport_handle *handle,
 		void *arg
@@ -349,6 +413,7 @@ int rrr_http_client_request_data_reset_from_config (
 
 	data->http_port = rrr_u16_from_biglength_bug_const(config->server_port);
 	data->concurrent_connections = rrr_u16_from_biglength_bug_const(config->concurrent_connections);
+	data->do_no_multiplex_prefer = config->do_pool_no_multiplex_prefer;
 
 	out:
 	return ret;
@@ -551,6 +616,10 @@ static int __rrr_http_client_receive_http_part_callback (
 		goto out;
 	}
 
+	if (handle != NULL) {
+		rrr_http_session_transport_ctx_pool_response_register(handle, rrr_http_transaction_lifetime_get(transaction));
+	}
+
 	if ((ret = __rrr_http_client_receive_alt_svc_get (
 			&http_client->alt_svc,
 			handle,
@@ -638,7 +707,9 @@ static int __rrr_http_client_request_failure_callback (
 ) {
 	struct rrr_http_client *http_client = arg;
 
-	(void)(handle);
+	if (handle != NULL) {
+		rrr_http_session_transport_ctx_pool_failure_register(handle);
+	}
 
 	return http_client->callbacks.failure_callback != NULL
 		? http_client->callbacks.failure_callback (
@@ -1063,79 +1134,253 @@ void __rrr_http_client_request_send_connect_callback (
 	*result = RRR_NET_TRANSPORT_CTX_HANDLE(handle);
 }
 
-static int __rrr_http_client_request_send_intermediate_connect (
+struct rrr_http_client_pool_select_data {
+	rrr_net_transport_handle handle;
+	uint16_t index;
+	uint64_t active_transaction_count;
+	uint64_t latency_avg_us;
+	uint64_t consecutive_failures;
+	int is_multiplexing;
+	int is_possible;
+};
+
+static int __rrr_http_client_pool_select_data_get_callback (
+		struct rrr_net_transport_handle *handle,
+		void *arg
+) {
+	struct rrr_http_client_pool_select_data *select_data = arg;
+
+	int ret = 0;
+
+	rrr_http_session_transport_ctx_pool_info_get (
+			&select_data->active_transaction_count,
+			&select_data->latency_avg_us,
+			&select_data->consecutive_failures,
+			&select_data->is_multiplexing,
+			handle
+	);
+
+	// Value is not set if no session has been created yet on the connection
+	select_data->is_possible = 1;
+
+	if ((ret = rrr_http_session_transport_ctx_request_send_possible (
+			&select_data->is_possible,
+			handle
+	)) != 0) {
+		RRR_MSG_0("Error while checking for request send possible in HTTP session in %s\n", __func__);
+		goto out;
+	}
+
+	out:
+	return ret;
+}
+
+// Healthy connections are preferred over connections with recent failures, then
+// connections with fewer transactions in flight and finally connections with
+// lower average response latency.
+static int __rrr_http_client_pool_select_data_is_better (
+		const struct rrr_http_client_pool_select_data *a,
+		const struct rrr_http_client_pool_select_data *b
+) {
+	const int a_healthy = a->consecutive_failures < RRR_HTTP_CLIENT_POOL_FAILURES_UNHEALTHY;
+	const int b_healthy = b->consecutive_failures < RRR_HTTP_CLIENT_POOL_FAILURES_UNHEALTHY;
+
+	if (a_healthy != b_healthy)
+		return a_healthy;
+	if (a->active_transaction_count != b->active_transaction_count)
+		return a->active_transaction_count < b->active_transaction_count;
+	return a->latency_avg_us < b->latency_avg_us;
+}
+
+static int __rrr_http_client_request_send_intermediate_connect_new (
+		rrr_net_transport_handle *result,
 		struct rrr_net_transport *transport_keepalive,
 		struct rrr_http_client_request_callback_data *callback_data,
 		const char * const server_to_use,
-		const uint16_t port_to_use
+		const uint16_t port_to_use,
+		const uint16_t concurrent_index
 ) {
 	int ret = 0;
 
 	int graylist_count;
 	int graylist_flags;
 
+	rrr_net_transport_handle keepalive_handle = 0;
+
+	*result = 0;
+
+	// Match number with index used to look up any existing handle in the transport
+	const uint64_t match_number = __rrr_http_client_net_transport_match_number_make (
+			port_to_use,
+			concurrent_index,
+			callback_data->transaction->application_type
+	);
+
+	// Match number without index used for preventing multiple connection attempts to the same
+	// server and for graylisting checks in alt-svc selector.
+	const uint64_t match_number_common = __rrr_http_client_net_transport_match_number_make (
+			port_to_use,
+			0,
+			callback_data->transaction->application_type
+	);
+
+	rrr_net_transport_graylist_get (
+			&graylist_count,
+			&graylist_flags,
+			transport_keepalive,
+			server_to_use,
+			match_number_common
+	);
+
+	if (graylist_count > 0) {
+		RRR_DBG_3("HTTP client not making connection to %s:%" PRIu16 " due to destination being graylisted\n",
+				server_to_use, port_to_use);
+		ret = RRR_HTTP_BUSY;
+		goto out;
+	}
+
+	RRR_DBG_3("HTTP client new connection to %s:%" PRIu16 " %" PRIu16 "/%" PRIu16 "\n",
+			server_to_use,
+			port_to_use,
+			concurrent_index + 1,
+			callback_data->data->concurrent_connections
+	);
+
+	if ((ret = rrr_net_transport_graylist_push (
+			transport_keepalive,
+			server_to_use,
+			match_number_common,
+			RRR_HTTP_CLIENT_GRAYLIST_PERIOD_LONG_MS * 1000,
+			RRR_HTTP_CLIENT_GRAYLIST_F_LONG
+	)) != 0) {
+		RRR_MSG_0("Failed to add to graylist in %s\n", __func__);
+		goto out;
+	}
+
+	if ((ret = rrr_net_transport_graylist_push (
+			transport_keepalive,
+			server_to_use,
+			match_number_common,
+			RRR_HTTP_CLIENT_GRAYLIST_PERIOD_SHORT_MS * 1000,
+			RRR_HTTP_CLIENT_GRAYLIST_F_SHORT
+	)) != 0) {
+		RRR_MSG_0("Failed to add to graylist in %s\n", __func__);
+		goto out;
+	}
+
+	if ((ret = rrr_net_transport_connect (
+			transport_keepalive,
+			port_to_use,
+			server_to_use,
+			__rrr_http_client_request_send_connect_callback,
+			&keepalive_handle
+	)) != 0) {
+		goto out;
+	}
+
+	if ((ret = rrr_net_transport_handle_match_data_set (
+			transport_keepalive,
+			keepalive_handle,
+			server_to_use,
+			match_number
+	)) != 0) {
+		RRR_MSG_0("Failed to set match data in %s\n", __func__);
+		goto out;
+	}
+
+	callback_data->http_client->pool_stats.connections_opened++;
+
+	*result = keepalive_handle;
+
+	out:
+	return ret;
+}
+
+/*
+ * Connection pool
+ *
+ * Up to concurrent_connections connections are kept open for each server, port and
+ * application, each identified by its index in the match number. For every request,
+ * the existing connection ready to accept a request with the best score is used, see
+ * the is_better function above. A new connection is only opened when no existing
+ * connection can accept the request and the limit has not been reached.
+ *
+ * Unless multiplexing preference is disabled, no new connections are opened as long as
+ * an HTTP2 or HTTP3 connection exists for the destination. Requests are then queued up
+ * by the caller until streams become available on the existing connection.
+ *
+ * Idle connections are closed by the net transport when the idle timeout of the client
+ * has passed.
+ *
+ * LONG and SHORT graylist periodis are added whenever a connection attempt is made for each
+ * given server and service. Only one connection attempt can be made for each target. If a
+ * service is connected but BUSY, another connection is made. This usually only happens for
+ * HTTP1.
+ *
+ * In case of failing connection attempts of main and alternative services, the following
+ * algorithm applies:
+ *
+ * - During LONG timeout for a target, no new connection attempts may be made.
+ * - After the SHORT period has expired (and before LONG timeout has expired), the alt-svc
+ *   selector will not suggest a graylisted service.
+ * - During the SHORT timeout, the alt-svc selector will still suggest the service to allow
+ *   any handshaking to complete.
+ *
+ * The SHORT timeout must be short enough to allow trying multiple alternative services
+ * within a LONG timeout. It should be set to LONG / 5.
+ *
+ * If all of plain, tls and quic modes are active and the latter two are reported by the
+ * server as alternative services, the following timeline describes how connection
+ * attempts for the different services will be made over time if none of them are reachable.
+ * C indicates connection attempt while H indicates handshaking.
+ *
+ *     HTTP1 |                   | SHORT ->| LONG --- --------- --------- -------->|   ...
+ *           |                   | C (H)       (H)       (H)                       |   ...
+ *     HTTP2 |         | SHORT ->| LONG --- --------- --------- -------->| SHORT ->|   ...
+ *           |         | C (H)   |                                       | C           ...
+ *     HTTP3 | SHORT ->| LONG --- --------- --------- -------->| SHORT ->| LONG ---    ...
+ *           | C  H    |                                       | C H H H |             ...
+ *
+ * 1. The highest protocol, HTTP3, is selected first. Since there is no immediate
+ *    feedback for UDP connections, handshaking will continue during the SHORT timeout
+ *    period. After the SHORT timeout, HTTP3 is no longer selected.
+ *
+ * 2. The second highest protocol, HTTP2, is selected. It will either immediately fail
+ *    due to connection refused/timeout or fail during later handshaking. After the
+ *    SHORT timeout, HTTP2 is no longer selected.
+ *
+ * 3. HTTP1 is not an alternative service, and it will be used when neither of HTTP2 and
+ *    HTTP3 are selected. HTTP3 will be used again later when its LONG timeout has passed.
+ *
+ *  HTTP2 may also be implicitly selected in place of HTTP1 if TLS is used and the server
+ *  reports HTTP2 in the ALPN. In both cases, in case of TLS, handshaking will occur until
+ *  another service is selected.
+ */
+static int __rrr_http_client_request_send_intermediate_connect (
+		struct rrr_net_transport *transport_keepalive,
+		struct rrr_http_client_request_callback_data *callback_data,
+		const char * const server_to_use,
+		const uint16_t port_to_use
+) {
+	struct rrr_http_client *http_client = callback_data->http_client;
+
+	int ret = 0;
+
+	struct rrr_http_client_pool_select_data select_data_best = {0};
+	uint16_t free_index = 0;
+	int free_index_found = 0;
+	uint16_t handshaking_count = 0;
+	uint16_t multiplexing_count = 0;
+
 	for (uint16_t concurrent_index = 0; concurrent_index < callback_data->data->concurrent_connections; concurrent_index++) {
-		// Match number with index used to look up any existing handle in the transport
+		struct rrr_http_client_pool_select_data select_data = {0};
+
 		const uint64_t match_number = __rrr_http_client_net_transport_match_number_make (
 				port_to_use,
 				concurrent_index,
 				callback_data->transaction->application_type
 		);
 
-		/*
-		 * LONG and SHORT graylist periodis are added whenever a connection attempt is made for each
-		 * given server and service. Only one connection attempt can be made for each target. If a
-		 * service is connected but BUSY, another connection is made. This usually only happens for
-		 * HTTP1.
-		 *
-		 * In case of failing connection attempts of main and alternative services, the following
-		 * algorithm applies:
-		 *
-		 * - During LONG timeout for a target, no new connection attempts may be made.
-		 * - After the SHORT period has expired (and before LONG timeout has expired), the alt-svc
-		 *   selector will not suggest a graylisted service.
-		 * - During the SHORT timeout, the alt-svc selector will still suggest the service to allow
-		 *   any handshaking to complete.
-		 *
-		 * The SHORT timeout must be short enough to allow trying multiple alternative services
-		 * within a LONG timeout. It should be set to LONG / 5.
-		 *
-		 * If all of plain, tls and quic modes are active and the latter two are reported by the
-		 * server as alternative services, the following timeline describes how connection
-		 * attempts for the different services will be made over time if none of them are reachable.
-		 * C indicates connection attempt while H indicates handshaking.
-		 *
-		 *     HTTP1 |                   | SHORT ->| LONG --- --------- --------- -------->|   ...
-		 *           |                   | C (H)       (H)       (H)                       |   ...
-		 *     HTTP2 |         | SHORT ->| LONG --- --------- --------- -------->| SHORT ->|   ...
-		 *           |         | C (H)   |                                       | C           ...
-		 *     HTTP3 | SHORT ->| LONG --- --------- --------- -------->| SHORT ->| LONG ---    ...
-		 *           | C  H    |                                       | C H H H |             ...
-		 *
-		 * 1. The highest protocol, HTTP3, is selected first. Since there is no immediate
-		 *    feedback for UDP connections, handshaking will continue during the SHORT timeout
-		 *    period. After the SHORT timeout, HTTP3 is no longer selected.
-		 *
-		 * 2. The second highest protocol, HTTP2, is selected. It will either immediately fail
-		 *    due to connection refused/timeout or fail during later handshaking. After the
-		 *    SHORT timeout, HTTP2 is no longer selected.
-		 *
-		 * 3. HTTP1 is not an alternative service, and it will be used when neither of HTTP2 and
-		 *    HTTP3 are selected. HTTP3 will be used again later when its LONG timeout has passed.
-		 *
-		 *  HTTP2 may also be implicitly selected in place of HTTP1 if TLS is used and the server
-		 *  reports HTTP2 in the ALPN. In both cases, in case of TLS, handshaking will occur until
-		 *  another service is selected.
-		 */
-
-		// Match number without index used for preventing multiple connection attempts to the same
-		// server and for graylisting checks in alt-svc selector.
-		const uint64_t match_number_common = __rrr_http_client_net_transport_match_number_make (
-				port_to_use,
-				0,
-				callback_data->transaction->application_type
-		);
-
 		rrr_net_transport_handle keepalive_handle = rrr_net_transport_handle_get_by_match (
 				transport_keepalive,
 				server_to_use,
@@ -1143,102 +1388,117 @@ static int __rrr_http_client_request_send_intermediate_connect (
 		);
 
 		if (keepalive_handle == 0) {
-			rrr_net_transport_graylist_get (
-					&graylist_count,
-					&graylist_flags,
-					transport_keepalive,
-					server_to_use,
-					match_number_common
-			);
-
-			if (graylist_count > 0) {
-				RRR_DBG_3("HTTP client not making connection to %s:%" PRIu16 " due to destination being graylisted\n",
-						server_to_use, port_to_use);
-				ret = RRR_HTTP_BUSY;
-				goto next;
-			}
-
-			RRR_DBG_3("HTTP client new connection to %s:%" PRIu16 " %" PRIu16 "/%" PRIu16 "\n",
-					server_to_use,
-					port_to_use,
-					concurrent_index + 1,
-					callback_data->data->concurrent_connections
-			);
-
-			if ((ret = rrr_net_transport_graylist_push (
-					transport_keepalive,
-					server_to_use,
-					match_number_common,
-					RRR_HTTP_CLIENT_GRAYLIST_PERIOD_LONG_MS * 1000,
-					RRR_HTTP_CLIENT_GRAYLIST_F_LONG
-			)) != 0) {
-				RRR_MSG_0("Failed to add to graylist in %s\n", __func__);
-				goto out;
+			if (!free_index_found) {
+				free_index = concurrent_index;
+				free_index_found = 1;
 			}
+			continue;
+		}
 
-			if ((ret = rrr_net_transport_graylist_push (
-					transport_keepalive,
-					server_to_use,
-					match_number_common,
-					RRR_HTTP_CLIENT_GRAYLIST_PERIOD_SHORT_MS * 1000,
-					RRR_HTTP_CLIENT_GRAYLIST_F_SHORT
-			)) != 0) {
-				RRR_MSG_0("Failed to add to graylist in %s\n", __func__);
-				goto out;
-			}
+		if (rrr_net_transport_handle_check_handshake_complete (
+				transport_keepalive,
+				keepalive_handle
+		) != RRR_READ_OK) {
+			handshaking_count++;
+			continue;
+		}
 
-			if ((ret = rrr_net_transport_connect (
-					transport_keepalive,
-					port_to_use,
-					server_to_use,
-					__rrr_http_client_request_send_connect_callback,
-					&keepalive_handle
-			)) != 0) {
-				goto out;
-			}
+		if ((ret = rrr_net_transport_handle_with_transport_ctx_do (
+				transport_keepalive,
+				keepalive_handle,
+				__rrr_http_client_pool_select_data_get_callback,
+				&select_data
+		)) != 0) {
+			goto out;
+		}
 
-			if ((ret = rrr_net_transport_handle_match_data_set (
-					transport_keepalive,
-					keepalive_handle,
-					server_to_use,
-					match_number
-			)) != 0) {
-				RRR_MSG_0("Failed to set match data in %s\n", __func__);
-				goto out;
-			}
+		if (select_data.is_multiplexing) {
+			multiplexing_count++;
 		}
-		else {
-			RRR_DBG_3("HTTP client existing connection to %s:%" PRIu16 " %" PRIu16 "/%" PRIu16 "\n",
-					server_to_use,
-					port_to_use,
-					concurrent_index + 1,
-					callback_data->data->concurrent_connections
-			);
+
+		if (!select_data.is_possible) {
+			continue;
 		}
 
-		if ((ret = rrr_net_transport_handle_check_handshake_complete (
-				transport_keepalive,
-				keepalive_handle
-		)) != RRR_READ_OK) {
-			ret = RRR_HTTP_BUSY;
-			goto next;
+		select_data.handle = keepalive_handle;
+		select_data.index = concurrent_index;
+
+		if (select_data_best.handle == 0 || __rrr_http_client_pool_select_data_is_better(&select_data, &select_data_best)) {
+			select_data_best = select_data;
 		}
+	}
+
+	if (select_data_best.handle != 0) {
+		RRR_DBG_3("HTTP client existing connection to %s:%" PRIu16 " %" PRIu16 "/%" PRIu16 " active %" PRIu64 " latency %" PRIu64 " us\n",
+				server_to_use,
+				port_to_use,
+				select_data_best.index + 1,
+				callback_data->data->concurrent_connections,
+				select_data_best.active_transaction_count,
+				select_data_best.latency_avg_us
+		);
 
-		ret = rrr_net_transport_handle_with_transport_ctx_do (
+		if ((ret = rrr_net_transport_handle_with_transport_ctx_do (
 				transport_keepalive,
-				keepalive_handle,
+				select_data_best.handle,
 				__rrr_http_client_request_send_final_transport_ctx_callback,
 				callback_data
-		);
-
-		next:
-		if (ret != RRR_HTTP_BUSY) {
-			break;
+		)) != RRR_HTTP_BUSY) {
+			if (ret == 0) {
+				http_client->pool_stats.requests_reused++;
+			}
+			goto out;
 		}
 	}
 
+	if (!callback_data->data->do_no_multiplex_prefer && (multiplexing_count > 0 || (
+			handshaking_count > 0 && callback_data->transaction->application_type >= RRR_HTTP_APPLICATION_HTTP2
+	))) {
+		RRR_DBG_3("HTTP client waiting for streams on multiplexed connection to %s:%" PRIu16 "\n",
+				server_to_use, port_to_use);
+		ret = RRR_HTTP_BUSY;
+		goto out;
+	}
+
+	if (!free_index_found) {
+		RRR_DBG_3("HTTP client connection limit %" PRIu16 " reached for %s:%" PRIu16 "\n",
+				callback_data->data->concurrent_connections, server_to_use, port_to_use);
+		ret = RRR_HTTP_BUSY;
+		goto out;
+	}
+
+	rrr_net_transport_handle keepalive_handle;
+	if ((ret = __rrr_http_client_request_send_intermediate_connect_new (
+			&keepalive_handle,
+			transport_keepalive,
+			callback_data,
+			server_to_use,
+			port_to_use,
+			free_index
+	)) != 0) {
+		goto out;
+	}
+
+	if ((ret = rrr_net_transport_handle_check_handshake_complete (
+			transport_keepalive,
+			keepalive_handle
+	)) != RRR_READ_OK) {
+		ret = RRR_HTTP_BUSY;
+		goto out;
+	}
+
+	ret = rrr_net_transport_handle_with_transport_ctx_do (
+			transport_keepalive,
+			keepalive_handle,
+			__rrr_http_client_request_send_final_transport_ctx_callback,
+			callback_data
+	);
+
 	out:
-		return ret;
+	if (ret == RRR_HTTP_BUSY) {
+		http_client->pool_stats.requests_busy++;
+	}
+	return ret;
 }
 
 static void __rrr_http_client_alt_svc_select (
@@ -1393,6 +1653,7 @@ static int __rrr_http_client_request_send_transport_keepalive_ensure (
 			NULL,
 			RRR_NET_TRANSPORT_PLAIN,
 			RRR_NET_TRANSPORT_F_PLAIN,
+			0,
 			0
 	};
 
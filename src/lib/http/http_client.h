@@ -86,6 +86,7 @@ struct rrr_net_transport_config;
 struct rrr_http_client_config;
 struct rrr_http_session;
 struct rrr_net_transport;
+struct rrr_net_transport_tls_stats;
 
 struct rrr_http_client_callbacks {
 	int (*final_callback)(RRR_HTTP_CLIENT_FINAL_CALLBACK_ARGS);
@@ -98,6 +99,13 @@ struct rrr_http_client_callbacks {
 	void *callback_arg;
 };
 
+struct rrr_http_client_pool_stats {
+	uint64_t connections;
+	uint64_t connections_opened;
+	uint64_t requests_reused;
+	uint64_t requests_busy;
+};
+
 struct rrr_http_client_request_data {
 	enum rrr_http_transport transport_force;
 
@@ -114,6 +122,7 @@ struct rrr_http_client_request_data {
 
 	int ssl_no_cert_verify;
 	uint16_t concurrent_connections;
+	int do_no_multiplex_prefer;
 
 	ssize_t read_max_size;
 };
@@ -147,6 +156,14 @@ void rrr_http_client_set_response_max_size (
 uint64_t rrr_http_client_active_transaction_count_get (
 		const struct rrr_http_client *http_client
 );
+void rrr_http_client_tls_stats_get (
+		struct rrr_net_transport_tls_stats *target,
+		const struct rrr_http_client *http_client
+);
+void rrr_http_client_pool_stats_get (
+		struct rrr_http_client_pool_stats *target,
+		const struct rrr_http_client *http_client
+);
 void rrr_http_client_websocket_response_available_notify (
 		struct rrr_http_client *http_client
 );
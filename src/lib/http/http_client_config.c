@@ -96,6 +96,9 @@ int rrr_http_client_config_parse (
 	RRR_INSTANCE_CONFIG_STRING_SET("_concurrent_connections");
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED(config_string, concurrent_connections, default_concurrent_connections);
 
+	RRR_INSTANCE_CONFIG_STRING_SET("_no_multiplex_prefer");
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO(config_string, do_pool_no_multiplex_prefer, 0);
+
 	RRR_INSTANCE_CONFIG_STRING_SET("_version_10");
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO(config_string, do_http_10, 0);
 
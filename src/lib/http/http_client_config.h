@@ -47,6 +47,7 @@ struct rrr_http_client_config {
 
 	uint16_t server_port;
 	rrr_setting_uint concurrent_connections;
+	int do_pool_no_multiplex_prefer;
 
 	struct rrr_map tags;
 	struct rrr_map fixed_tags;
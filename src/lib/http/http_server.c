@@ -839,6 +839,7 @@ int rrr_http_server_start_plain (
 			NULL,
 			RRR_NET_TRANSPORT_PLAIN,
 			RRR_NET_TRANSPORT_F_PLAIN,
+			0,
 			0
 	};
 
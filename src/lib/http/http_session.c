@@ -242,6 +242,60 @@ uint64_t rrr_http_session_transport_ctx_active_transaction_count_get_and_maintai
 	return rrr_http_application_active_transaction_count_get_and_maintain(session->application, handle);
 }
 
+void rrr_http_session_transport_ctx_pool_info_get (
+		uint64_t *active_transaction_count,
+		uint64_t *latency_avg_us,
+		uint64_t *consecutive_failures,
+		int *is_multiplexing,
+		struct rrr_net_transport_handle *handle
+) {
+	struct rrr_http_session *session = RRR_NET_TRANSPORT_CTX_PRIVATE_PTR(handle);
+
+	*active_transaction_count = 0;
+	*latency_avg_us = 0;
+	*consecutive_failures = 0;
+	*is_multiplexing = 0;
+
+	if (session == NULL) {
+		return;
+	}
+
+	*active_transaction_count = rrr_http_application_active_transaction_count_get_and_maintain(session->application, handle);
+	*latency_avg_us = session->latency_avg_us;
+	*consecutive_failures = session->consecutive_failures;
+	*is_multiplexing = rrr_http_application_type_get(session->application) >= RRR_HTTP_APPLICATION_HTTP2;
+}
+
+void rrr_http_session_transport_ctx_pool_response_register (
+		struct rrr_net_transport_handle *handle,
+		uint64_t latency_us
+) {
+	struct rrr_http_session *session = RRR_NET_TRANSPORT_CTX_PRIVATE_PTR(handle);
+
+	if (session == NULL) {
+		return;
+	}
+
+	// Exponential moving average with weight 1/8 for new samples
+	session->latency_avg_us = session->latency_avg_us == 0
+		? latency_us
+		: session->latency_avg_us - (session->latency_avg_us >> 3) + (latency_us >> 3)
+	;
+	session->consecutive_failures = 0;
+}
+
+void rrr_http_session_transport_ctx_pool_failure_register (
+		struct rrr_net_transport_handle *handle
+) {
+	struct rrr_http_session *session = RRR_NET_TRANSPORT_CTX_PRIVATE_PTR(handle);
+
+	if (session == NULL) {
+		return;
+	}
+
+	session->consecutive_failures++;
+}
+
 void rrr_http_session_transport_ctx_websocket_response_available_notify (
 		struct rrr_net_transport_handle *handle
 ) {
@@ -88,6 +88,10 @@ struct rrr_http_session {
 	// Used when ticking
 	uint64_t prev_complete_transaction_time;
 	uint64_t prev_complete_transaction_count;
+
+	// Used by client connection pool selection
+	uint64_t latency_avg_us;
+	uint64_t consecutive_failures;
 };
 
 struct rrr_net_transport;
@@ -128,6 +132,20 @@ int rrr_http_session_transport_ctx_request_send (
 uint64_t rrr_http_session_transport_ctx_active_transaction_count_get_and_maintain (
 		struct rrr_net_transport_handle *handle
 );
+void rrr_http_session_transport_ctx_pool_info_get (
+		uint64_t *active_transaction_count,
+		uint64_t *latency_avg_us,
+		uint64_t *consecutive_failures,
+		int *is_multiplexing,
+		struct rrr_net_transport_handle *handle
+);
+void rrr_http_session_transport_ctx_pool_response_register (
+		struct rrr_net_transport_handle *handle,
+		uint64_t latency_us
+);
+void rrr_http_session_transport_ctx_pool_failure_register (
+		struct rrr_net_transport_handle *handle
+);
 void rrr_http_session_transport_ctx_websocket_response_available_notify (
 		struct rrr_net_transport_handle *handle
 );
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "log.h"
@@ -461,6 +462,7 @@ static int __rrr_instance_parse_misc (
 		int do_enable_backstop;
 		int do_duplicate;
 		int do_topic_filter_invert;
+		int do_thread_pool;
 	} data_tmp;
 
 	struct data *data = &data_tmp;
@@ -486,11 +488,147 @@ static int __rrr_instance_parse_misc (
 	if (data->do_topic_filter_invert) {
 		data_final->misc_flags |= RRR_INSTANCE_MISC_OPTIONS_TOPIC_FILTER_INVERT;
 	}
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO("thread_pool", do_thread_pool, 0);
+	if (data->do_thread_pool) {
+		if (!data_final->module_data->thread_pool_capable) {
+			RRR_MSG_0("Parameter thread_pool was set in instance %s but module %s cannot run in the thread pool\n",
+				config->name, INSTANCE_M_MODULE_NAME(data_final));
+			ret = 1;
+			goto out;
+		}
+		data_final->misc_flags |= RRR_INSTANCE_MISC_OPTIONS_THREAD_POOL;
+	}
 
 	out:
 	return ret;
 }
 
+static int __rrr_instance_parse_placement (
+		struct rrr_instance *data_final,
+		rrr_length *isolated_index
+) {
+	int ret = 0;
+
+	struct rrr_instance_config_data *config = data_final->config;
+	struct rrr_thread_placement *placement = &data_final->placement;
+
+	struct data {
+		char *cpu_affinity;
+		int do_cpu_isolated;
+		char *numa_nodes;
+		char *numa_policy;
+		char *scheduling_policy;
+		rrr_setting_uint scheduling_priority;
+		char *nice;
+	} data_tmp = {0};
+
+	struct data *data = &data_tmp;
+
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("cpu_affinity", cpu_affinity);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO("cpu_isolated", do_cpu_isolated, 0);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("numa_nodes", numa_nodes);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("numa_policy", numa_policy);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("scheduling_policy", scheduling_policy);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("scheduling_priority", scheduling_priority, 0);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("nice", nice);
+
+	if (data->cpu_affinity != NULL) {
+		if ((ret = rrr_thread_placement_list_parse (
+				placement->cpus,
+				RRR_THREAD_PLACEMENT_CPU_MAX,
+				data->cpu_affinity
+		)) != 0) {
+			RRR_MSG_0("Failed to parse parameter cpu_affinity in instance %s\n", config->name);
+			goto out;
+		}
+		placement->has_cpus = 1;
+	}
+
+	if (data->do_cpu_isolated) {
+		// Each instance with cpu_isolated set gets its own isolated CPU as long as there are enough of them
+		if ((ret = rrr_thread_placement_isolated_select(placement, (*isolated_index)++)) != 0) {
+			RRR_MSG_0("Failed to select isolated CPU for parameter cpu_isolated in instance %s\n", config->name);
+			goto out;
+		}
+	}
+
+	if (data->numa_nodes != NULL) {
+		if ((ret = rrr_thread_placement_list_parse (
+				&placement->numa_nodes,
+				RRR_THREAD_PLACEMENT_NUMA_NODE_MAX,
+				data->numa_nodes
+		)) != 0) {
+			RRR_MSG_0("Failed to parse parameter numa_nodes in instance %s\n", config->name);
+			goto out;
+		}
+		placement->numa_policy = RRR_THREAD_PLACEMENT_NUMA_BIND;
+	}
+
+	if (data->numa_policy != NULL) {
+		if (data->numa_nodes == NULL) {
+			RRR_MSG_0("Parameter numa_policy was set in instance %s while numa_nodes was not\n", config->name);
+			ret = 1;
+			goto out;
+		}
+		if ((ret = rrr_thread_placement_numa_policy_parse(&placement->numa_policy, data->numa_policy)) != 0) {
+			RRR_MSG_0("Failed to parse parameter numa_policy in instance %s\n", config->name);
+			goto out;
+		}
+	}
+
+	if (data->scheduling_policy != NULL) {
+		if ((ret = rrr_thread_placement_sched_policy_parse(&placement->sched_policy, data->scheduling_policy)) != 0) {
+			RRR_MSG_0("Failed to parse parameter scheduling_policy in instance %s\n", config->name);
+			goto out;
+		}
+	}
+
+	if (placement->sched_policy == RRR_THREAD_PLACEMENT_SCHED_FIFO || placement->sched_policy == RRR_THREAD_PLACEMENT_SCHED_RR) {
+		if (data->scheduling_priority < 1 || data->scheduling_priority > 99) {
+			RRR_MSG_0("Parameter scheduling_priority in instance %s must be in the range 1-99 for real-time scheduling policies, got %llu\n",
+				config->name, (unsigned long long) data->scheduling_priority);
+			ret = 1;
+			goto out;
+		}
+		placement->sched_priority = (int) data->scheduling_priority;
+	}
+	else if (data->scheduling_priority != 0) {
+		RRR_MSG_0("Parameter scheduling_priority was set in instance %s while scheduling_policy was not fifo or rr\n", config->name);
+		ret = 1;
+		goto out;
+	}
+
+	if (data->nice != NULL) {
+		char *end = NULL;
+		long nice = strtol(data->nice, &end, 10);
+		if (end == data->nice || *end != '\0' || nice < -20 || nice > 19) {
+			RRR_MSG_0("Invalid value '%s' for parameter nice in instance %s, must be in the range -20 to 19\n",
+				data->nice, config->name);
+			ret = 1;
+			goto out;
+		}
+		if (placement->sched_policy == RRR_THREAD_PLACEMENT_SCHED_FIFO || placement->sched_policy == RRR_THREAD_PLACEMENT_SCHED_RR) {
+			RRR_MSG_0("Warning: Parameter nice in instance %s has no effect with real-time scheduling policies\n", config->name);
+		}
+		placement->nice = (int) nice;
+		placement->has_nice = 1;
+	}
+
+	if ((data_final->misc_flags & RRR_INSTANCE_MISC_OPTIONS_THREAD_POOL) && rrr_thread_placement_is_set(placement)) {
+		RRR_MSG_0("Placement parameters cannot be used in instance %s as thread_pool is set\n", config->name);
+		ret = 1;
+		goto out;
+	}
+
+	out:
+	RRR_FREE_IF_NOT_NULL(data->cpu_affinity);
+	RRR_FREE_IF_NOT_NULL(data->numa_nodes);
+	RRR_FREE_IF_NOT_NULL(data->numa_policy);
+	RRR_FREE_IF_NOT_NULL(data->scheduling_policy);
+	RRR_FREE_IF_NOT_NULL(data->nice);
+	return ret;
+}
+
 static int __rrr_instance_add_wait_for_instances (
 		struct rrr_instance_collection *instances,
 		struct rrr_instance *instance
@@ -874,6 +1012,10 @@ static void __rrr_instance_thread_intermediate_cleanup (
 	RRR_DBG_8("Thread %p intermediate cleanup cmodule is %p\n",
 		thread, thread_data->cmodule);
 
+	if (thread_data->poll_fused.callback != NULL) {
+		rrr_message_broker_fused_callback_set(INSTANCE_D_HANDLE(thread_data), 0, NULL, NULL);
+	}
+
 	if (thread_data->stats != NULL) {
 		rrr_stats_instance_destroy(thread_data->stats);
 	}
@@ -926,6 +1068,32 @@ static rrr_length __rrr_instance_count_receivers_of_self (
 	return callback_data.count;
 }
 
+static int __rrr_instance_thread_post_placement_stickies (
+		struct rrr_instance_runtime_data *thread_data
+) {
+	int ret = 0;
+
+	struct rrr_thread_placement_effective effective;
+
+	// Effective placement of the instance thread which may differ from
+	// the configuration if it could not be fully applied
+	rrr_thread_placement_effective_get(&effective);
+
+	ret |= rrr_stats_instance_post_text(thread_data->stats, "placement/cpu_affinity", 1, effective.cpus);
+	ret |= rrr_stats_instance_post_text(thread_data->stats, "placement/numa_policy", 1, effective.numa_policy);
+	ret |= rrr_stats_instance_post_text(thread_data->stats, "placement/numa_nodes", 1, effective.numa_nodes);
+	ret |= rrr_stats_instance_post_text(thread_data->stats, "placement/scheduling_policy", 1, effective.sched_policy);
+	ret |= rrr_stats_instance_post_base10_text(thread_data->stats, "placement/scheduling_priority", 1, effective.sched_priority);
+	ret |= rrr_stats_instance_post_base10_text(thread_data->stats, "placement/nice", 1, effective.nice);
+	ret |= rrr_stats_instance_post_text(thread_data->stats, "placement/thread", 1,
+		INSTANCE_D_THREAD(thread_data)->host != NULL
+			? INSTANCE_D_THREAD(thread_data)->host->name
+			: INSTANCE_D_THREAD(thread_data)->name
+	);
+
+	return ret;
+}
+
 static void *__rrr_instance_thread_entry_intermediate (
 		struct rrr_thread *thread
 ) {
@@ -965,6 +1133,12 @@ static void *__rrr_instance_thread_entry_intermediate (
 		goto out;
 	}
 
+	if (__rrr_instance_thread_post_placement_stickies(thread_data) != 0) {
+		RRR_MSG_0("Error while posting placement sticky statistics instance %s in %s\n",
+			INSTANCE_D_NAME(thread_data), __func__);
+		goto out;
+	}
+
 	RRR_DBG_1("Instance %s starting int PID %llu, TID %llu, thread %p, event queue %p instance %p\n",
 		thread->name, (unsigned long long) getpid(), (unsigned long long) rrr_gettid(), thread, INSTANCE_D_EVENTS(thread_data), thread_data);
 
@@ -1035,10 +1209,16 @@ static int __rrr_instance_thread_early_init (
 ) {
 	struct rrr_instance_runtime_data *thread_data = thread->private_data;
 
-	(void)(thread_data);
-
 	rrr_log_socket_after_thread();
 
+	// Placement is inherited by any cmodule worker forks made by the instance
+	if (rrr_thread_placement_is_set(&INSTANCE_D_INSTANCE(thread_data)->placement)) {
+		RRR_DBG_1("Applying placement to instance %s TID %llu\n",
+			INSTANCE_D_NAME(thread_data), (unsigned long long) rrr_gettid());
+		// Ignore return value, failures are warnings
+		rrr_thread_placement_apply(&INSTANCE_D_INSTANCE(thread_data)->placement, INSTANCE_D_NAME(thread_data));
+	}
+
 	return 0;
 }
 
@@ -1064,12 +1244,16 @@ static int __rrr_instance_collection_start_threads_check_wait_for_callback (
 	struct rrr_instance_collection_start_threads_check_wait_for_callback_data *data = arg;
 	struct rrr_instance *instance = rrr_instance_find_by_thread(data->instances, thread);
 
+	*do_start = 1;
+
 	if (instance == NULL) {
+		if (rrr_thread_is_host(thread)) {
+			// Pool worker thread
+			return 0;
+		}
 		RRR_BUG("Instance not found in %s\n", __func__);
 	}
 
-	*do_start = 1;
-
 	// TODO : Check for wait_for loops in configuration
 
 	RRR_LL_ITERATE_BEGIN(&instance->wait_for, struct rrr_instance_friend);
@@ -1093,6 +1277,283 @@ static int __rrr_instance_collection_start_threads_check_wait_for_callback (
 	return 0;
 }
 
+static int __rrr_instance_pool_worker_early_init (
+		struct rrr_thread *thread
+) {
+	(void)(thread);
+
+	rrr_log_socket_after_thread();
+
+	return 0;
+}
+
+static void __rrr_instance_pool_worker_late_deinit (
+		struct rrr_thread *thread
+) {
+	(void)(thread);
+
+	rrr_log_socket_flush_and_close();
+}
+
+static int __rrr_instance_pool_worker_dispatch (
+		void *arg
+) {
+	struct rrr_thread *thread = arg;
+	struct rrr_event_queue *events = thread->private_data;
+
+	return rrr_event_dispatch (
+			events,
+			1 * 1000 * 1000,
+			rrr_thread_signal_encourage_stop_check_and_update_watchdog_timer_void,
+			thread
+	);
+}
+
+static void *__rrr_instance_pool_worker_entry (
+		struct rrr_thread *thread
+) {
+	if (rrr_thread_host_start_condition_helper(thread) != 0) {
+		RRR_DBG_1("Pool worker %s received stop signal during startup\n", thread->name);
+		return NULL;
+	}
+
+	RRR_DBG_1("Pool worker %s starting TID %llu with %i instances\n",
+		thread->name, (unsigned long long) rrr_gettid(), thread->hosted_count);
+
+	rrr_thread_host_run(thread, __rrr_instance_pool_worker_dispatch, thread);
+
+	RRR_DBG_1("Pool worker %s exiting\n", thread->name);
+
+	return NULL;
+}
+
+static int __rrr_instance_pool_index_of (
+		struct rrr_instance_collection *instances,
+		const struct rrr_instance *instance
+) {
+	int i = 0;
+	RRR_LL_ITERATE_BEGIN(instances, struct rrr_instance);
+		if (node == instance) {
+			return i;
+		}
+		i++;
+	RRR_LL_ITERATE_END();
+	RRR_BUG("BUG: Instance not found in %s\n", __func__);
+	return -1;
+}
+
+static int __rrr_instance_pool_chain_head (
+		const int *fused_writer_of_instance,
+		int i
+) {
+	while (fused_writer_of_instance[i] >= 0) {
+		i = fused_writer_of_instance[i];
+	}
+	return i;
+}
+
+// Detect chains of pooled instances in which an instance is the only
+// reader of its only sender. Such a reader is fused with the sender, it
+// runs in the same worker and entries are passed directly to it.
+static void __rrr_instance_pool_fuse_detect (
+		int *fused_writer_of_instance,
+		struct rrr_instance_collection *instances
+) {
+	const int count = RRR_LL_COUNT(instances);
+
+	int i = 0;
+	RRR_LL_ITERATE_BEGIN(instances, struct rrr_instance);
+		struct rrr_instance *writer = RRR_LL_COUNT(&node->senders) == 1
+			? RRR_LL_FIRST(&node->senders)->instance
+			: NULL;
+
+		fused_writer_of_instance[i] = -1;
+		node->misc_flags &= ~(RRR_INSTANCE_MISC_OPTIONS_FUSED);
+
+		if (writer != NULL &&
+		    writer != node &&
+		    (INSTANCE_I_MISC_FLAGS(node) & RRR_INSTANCE_MISC_OPTIONS_THREAD_POOL) &&
+		    (INSTANCE_I_MISC_FLAGS(writer) & RRR_INSTANCE_MISC_OPTIONS_THREAD_POOL) &&
+		    !(INSTANCE_I_MISC_FLAGS(writer) & RRR_INSTANCE_MISC_OPTIONS_DUPLICATE) &&
+		    __rrr_instance_count_receivers_of_self(writer) == 1
+		) {
+			fused_writer_of_instance[i] = __rrr_instance_pool_index_of(instances, writer);
+		}
+
+		i++;
+	RRR_LL_ITERATE_END();
+
+	// Break any loops, entries would otherwise be passed around forever
+	for (i = 0; i < count; i++) {
+		int j = fused_writer_of_instance[i];
+		for (int steps = 0; j >= 0 && steps < count; steps++) {
+			if (j == i) {
+				fused_writer_of_instance[i] = -1;
+				break;
+			}
+			j = fused_writer_of_instance[j];
+		}
+	}
+
+	i = 0;
+	RRR_LL_ITERATE_BEGIN(instances, struct rrr_instance);
+		if (fused_writer_of_instance[i++] >= 0) {
+			node->misc_flags |= RRR_INSTANCE_MISC_OPTIONS_FUSED;
+		}
+	RRR_LL_ITERATE_END();
+}
+
+// Assign pooled instances to workers. Fused instances are put on the
+// same worker as the first instance of their chain. Other instances
+// are preferably put on the same worker as one of its senders so that
+// messages are passed without crossing threads, as long as this worker
+// is not full.
+static void __rrr_instance_pool_assign (
+		int *worker_of_instance,
+		int *worker_load,
+		int worker_count,
+		int pooled_count,
+		const int *fused_writer_of_instance,
+		struct rrr_instance_collection *instances
+) {
+	const int load_max = (pooled_count + worker_count - 1) / worker_count;
+	const int count = RRR_LL_COUNT(instances);
+
+	// Senders which appear later in the list are not assigned yet
+	for (int i = 0; i < count; i++) {
+		worker_of_instance[i] = -1;
+	}
+
+	int i = 0;
+	RRR_LL_ITERATE_BEGIN(instances, struct rrr_instance);
+		struct rrr_instance *instance = node;
+		int worker = -1;
+		int chain_length = 0;
+
+		if (!(INSTANCE_I_MISC_FLAGS(instance) & RRR_INSTANCE_MISC_OPTIONS_THREAD_POOL) || fused_writer_of_instance[i] >= 0) {
+			i++;
+			RRR_LL_ITERATE_NEXT();
+		}
+
+		for (int j = 0; j < count; j++) {
+			if (__rrr_instance_pool_chain_head(fused_writer_of_instance, j) == i) {
+				chain_length++;
+			}
+		}
+
+		RRR_LL_ITERATE_BEGIN(&instance->senders, struct rrr_instance_friend);
+			int sender_worker = worker_of_instance[__rrr_instance_pool_index_of(instances, node->instance)];
+			if (sender_worker >= 0 && worker_load[sender_worker] + chain_length <= load_max) {
+				worker = sender_worker;
+				RRR_LL_ITERATE_BREAK();
+			}
+		RRR_LL_ITERATE_END();
+
+		if (worker < 0) {
+			worker = 0;
+			for (int j = 1; j < worker_count; j++) {
+				if (worker_load[j] < worker_load[worker]) {
+					worker = j;
+				}
+			}
+		}
+
+		worker_of_instance[i++] = worker;
+		worker_load[worker] += chain_length;
+	RRR_LL_ITERATE_END();
+
+	for (i = 0; i < count; i++) {
+		if (fused_writer_of_instance[i] >= 0) {
+			worker_of_instance[i] = worker_of_instance[__rrr_instance_pool_chain_head(fused_writer_of_instance, i)];
+		}
+	}
+}
+
+static int __rrr_instance_pool_fuse (
+		struct rrr_message_broker *broker,
+		const int *fused_writer_of_instance,
+		struct rrr_instance_collection *instances
+) {
+	int ret = 0;
+
+	int i = 0;
+	RRR_LL_ITERATE_BEGIN(instances, struct rrr_instance);
+		if (fused_writer_of_instance[i] < 0) {
+			i++;
+			RRR_LL_ITERATE_NEXT();
+		}
+
+		struct rrr_instance *writer = RRR_LL_FIRST(&node->senders)->instance;
+
+		RRR_DBG_1("Instance '%s' is fused with its sender '%s'\n",
+			INSTANCE_M_NAME(node), INSTANCE_M_NAME(writer));
+
+		if ((ret = rrr_message_broker_fuse (
+				rrr_message_broker_costumer_find_by_name(broker, INSTANCE_M_NAME(writer)),
+				rrr_message_broker_costumer_find_by_name(broker, INSTANCE_M_NAME(node))
+		)) != 0) {
+			RRR_MSG_0("Failed to fuse instance %s with its sender %s\n",
+				INSTANCE_M_NAME(node), INSTANCE_M_NAME(writer));
+			goto out;
+		}
+
+		i++;
+	RRR_LL_ITERATE_END();
+
+	out:
+	return ret;
+}
+
+static int __rrr_instances_create_pool_workers (
+		struct rrr_thread **workers,
+		int worker_count,
+		struct rrr_thread_collection *thread_collection
+) {
+	int ret = 0;
+
+	struct rrr_event_queue *events = NULL;
+	char name[64];
+
+	for (int i = 0; i < worker_count; i++) {
+		if ((ret = rrr_event_queue_new_shareable (&events)) != 0) {
+			goto out;
+		}
+
+		sprintf(name, "pool_worker_%i", i);
+
+		if ((workers[i] = rrr_thread_collection_thread_create_and_preload (
+				thread_collection,
+				__rrr_instance_pool_worker_entry,
+				NULL,
+				__rrr_instance_pool_worker_early_init,
+				__rrr_instance_pool_worker_late_deinit,
+				name,
+				RRR_INSTANCE_DEFAULT_THREAD_WATCHDOG_TIMER_MS * 1000,
+				events
+		)) == NULL) {
+			RRR_MSG_0("Error while creating pool worker thread %s\n", name);
+			ret = 1;
+			goto out;
+		}
+
+		// The queue outlives the queues of the hosted instances as
+		// the event base is reference counted
+		if ((ret = rrr_thread_managed_data_push (
+				workers[i],
+				events,
+				rrr_event_queue_destroy_void
+		)) != 0) {
+			goto out;
+		}
+		events = NULL;
+	}
+
+	out:
+	if (events != NULL)
+		rrr_event_queue_destroy(events);
+	return ret;
+}
+
 // This function allocates runtime data and thread data.
 // - runtime data is ALWAYS destroyed by the thread. If a thread does not
 //   start, we must BUG() out
@@ -1116,6 +1577,12 @@ static int __rrr_instances_create_threads (
 	struct rrr_event_queue *events = NULL;
 	struct rrr_event_queue **events_ptr = NULL;
 	struct rrr_thread *thread;
+	struct rrr_thread **workers = NULL;
+	int *worker_of_instance = NULL;
+	int *fused_writer_of_instance = NULL;
+	int *worker_load = NULL;
+	int pooled_count = 0;
+	int worker_count = 0;
 	int i;
 
 	if (RRR_LL_COUNT(instances) == 0) {
@@ -1136,13 +1603,70 @@ static int __rrr_instances_create_threads (
 		goto out_destroy;
 	}
 
+	RRR_LL_ITERATE_BEGIN(instances, struct rrr_instance);
+		if (INSTANCE_I_MISC_FLAGS(node) & RRR_INSTANCE_MISC_OPTIONS_THREAD_POOL) {
+			pooled_count++;
+		}
+	RRR_LL_ITERATE_END();
+
+	if (pooled_count > 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		worker_count = cpus > 0 && cpus < pooled_count ? (int) cpus : pooled_count;
+
+		if ((workers = rrr_allocate_zero(sizeof(*workers) * (size_t) worker_count)) == NULL ||
+		    (worker_load = rrr_allocate_zero(sizeof(*worker_load) * (size_t) worker_count)) == NULL ||
+		    (worker_of_instance = rrr_allocate_zero(sizeof(*worker_of_instance) * (size_t) RRR_LL_COUNT(instances))) == NULL ||
+		    (fused_writer_of_instance = rrr_allocate_zero(sizeof(*fused_writer_of_instance) * (size_t) RRR_LL_COUNT(instances))) == NULL
+		) {
+			RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+			ret = 1;
+			goto out_destroy;
+		}
+
+		RRR_DBG_1("Creating %i pool workers for %i instances\n", worker_count, pooled_count);
+
+		// Workers must be created first, they must precede the hosted
+		// instances in the collection during the start procedure
+		if ((ret = __rrr_instances_create_pool_workers (
+				workers,
+				worker_count,
+				thread_collection
+		)) != 0) {
+			goto out_destroy;
+		}
+
+		__rrr_instance_pool_fuse_detect (
+				fused_writer_of_instance,
+				instances
+		);
+
+		__rrr_instance_pool_assign (
+				worker_of_instance,
+				worker_load,
+				worker_count,
+				pooled_count,
+				fused_writer_of_instance,
+				instances
+		);
+	}
+
 	// Initialize thread data and runtime data
 	i = 0;
 	RRR_LL_ITERATE_BEGIN(instances, struct rrr_instance);
 		RRR_DBG_1("Initializing instance %p '%s'\n",
 			node, INSTANCE_M_NAME(node));
 
-		if ((ret = rrr_event_queue_new (&events)) != 0) {
+		struct rrr_thread *worker = worker_of_instance != NULL && worker_of_instance[i] >= 0
+			? workers[worker_of_instance[i]]
+			: NULL;
+
+		if (worker != NULL) {
+			if ((ret = rrr_event_queue_new_shared (&events, worker->private_data)) != 0) {
+				goto out_destroy;
+			}
+			rrr_event_queue_dispatch_hook_set(events, rrr_thread_host_run_next_void, worker);
+		}
+		else if ((ret = rrr_event_queue_new (&events)) != 0) {
 			goto out_destroy;
 		}
 
@@ -1164,16 +1688,33 @@ static int __rrr_instances_create_threads (
 			goto out;
 		}
 
-		if ((thread = rrr_thread_collection_thread_create_and_preload (
-				thread_collection,
-				__rrr_instance_thread_entry_intermediate,
-				__rrr_instance_thread_preload,
-				__rrr_instance_thread_early_init,
-				__rrr_instance_thread_late_deinit,
-				node->module_data->instance_name,
-				RRR_INSTANCE_DEFAULT_THREAD_WATCHDOG_TIMER_MS * 1000,
-				runtime_data
-		)) == NULL) {
+		if (worker != NULL) {
+			RRR_DBG_1("Instance '%s' is hosted by pool worker %s\n",
+				INSTANCE_M_NAME(node), worker->name);
+
+			thread = rrr_thread_collection_thread_create_hosted_and_preload (
+					thread_collection,
+					worker,
+					__rrr_instance_thread_entry_intermediate,
+					__rrr_instance_thread_preload,
+					node->module_data->instance_name,
+					runtime_data
+			);
+		}
+		else {
+			thread = rrr_thread_collection_thread_create_and_preload (
+					thread_collection,
+					__rrr_instance_thread_entry_intermediate,
+					__rrr_instance_thread_preload,
+					__rrr_instance_thread_early_init,
+					__rrr_instance_thread_late_deinit,
+					node->module_data->instance_name,
+					RRR_INSTANCE_DEFAULT_THREAD_WATCHDOG_TIMER_MS * 1000,
+					runtime_data
+			);
+		}
+
+		if (thread == NULL) {
 			RRR_MSG_0("Error while creating thread for instance %s\n",
 				node->module_data->instance_name);
 			ret = 1;
@@ -1235,6 +1776,15 @@ static int __rrr_instances_create_threads (
 		i++;
 	RRR_LL_ITERATE_END();
 
+	// Senders must have been added to the broker prior to fusing
+	if (fused_writer_of_instance != NULL && (ret = __rrr_instance_pool_fuse (
+			message_broker,
+			fused_writer_of_instance,
+			instances
+	)) != 0) {
+		goto out_destroy;
+	}
+
 	*thread_collection_target = thread_collection;
 
 	goto out;
@@ -1246,6 +1796,10 @@ static int __rrr_instances_create_threads (
 		rrr_thread_collection_destroy(NULL, thread_collection);
 	out:
 		RRR_FREE_IF_NOT_NULL(events_ptr);
+		RRR_FREE_IF_NOT_NULL(workers);
+		RRR_FREE_IF_NOT_NULL(worker_load);
+		RRR_FREE_IF_NOT_NULL(worker_of_instance);
+		RRR_FREE_IF_NOT_NULL(fused_writer_of_instance);
 		return ret;
 }
 
@@ -1397,6 +1951,8 @@ int rrr_instances_create_from_config (
 ) {
 	int ret = 0;
 
+	rrr_length isolated_index = 0;
+
 	RRR_LL_ITERATE_BEGIN(config, struct rrr_instance_config_data);
 		ret = rrr_instance_load_and_save(instances, node, library_paths);
 		if (ret != 0) {
@@ -1447,6 +2003,12 @@ int rrr_instances_create_from_config (
 				INSTANCE_M_NAME(instance));
 			goto out;
 		}
+		ret = __rrr_instance_parse_placement(instance, &isolated_index);
+		if (ret != 0) {
+			RRR_MSG_0("Parsing of placement parameters failed for instance %s\n",
+				INSTANCE_M_NAME(instance));
+			goto out;
+		}
 	RRR_LL_ITERATE_END();
 
 	out:
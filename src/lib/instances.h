@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "instance_friends.h"
 #include "discern_stack.h"
 #include "threads.h"
+#include "thread_placement.h"
 #include "poll_helper.h"
 #include "event/event.h"
 #include "event/event_collection_struct.h"
@@ -37,6 +38,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_INSTANCE_MISC_OPTIONS_TOPIC_FILTER_INVERT      (1<<3)
 #define RRR_INSTANCE_MISC_OPTIONS_METHODS_DIRECT_DISPATCH  (1<<4)
 #define RRR_INSTANCE_MISC_OPTIONS_METHODS_DOUBLE_DELIVERY  (1<<5)
+#define RRR_INSTANCE_MISC_OPTIONS_THREAD_POOL              (1<<6)
+#define RRR_INSTANCE_MISC_OPTIONS_FUSED                    (1<<7)
 
 struct rrr_stats_instance;
 struct rrr_cmodule;
@@ -58,6 +61,7 @@ struct rrr_instance {
 	struct rrr_signal_handler *signal_handler;
 	char *topic_filter;
 	struct rrr_mqtt_topic_token *topic_first_token;
+	struct rrr_thread_placement placement;
 
 	// Static members
 	unsigned long int senders_count;
@@ -90,6 +94,9 @@ struct rrr_instance_module_data {
 	const char *module_name;
 	unsigned int type;
 	int want_event_dispatch;
+	// Set by modules which only dispatch events from their thread entry
+	// and may be run by a shared pool worker thread
+	int thread_pool_capable;
 	struct rrr_module_operations operations;
 	struct rrr_instance_event_functions event_functions;
 	void *dl_ptr;
@@ -139,6 +146,9 @@ struct rrr_instance_runtime_data {
 	// Poll statistics for modules which read from others
 	struct rrr_poll_helper_counters counters;
 
+	// Poll callback used by a fused sender, set in the first poll
+	struct rrr_poll_intermediate_callback_data poll_fused;
+
 	// Shorcut which is set by thread itself after starting
 	struct rrr_thread *thread;
 
@@ -457,6 +457,14 @@ int rrr_ip_network_start_tcp (
 	si.sin6_port = htons(data->port);
 	si.sin6_addr = in6addr_any;
 
+	if (data->reuse_port) {
+		int enable = 1;
+		if (setsockopt (fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0) {
+			RRR_MSG_0 ("Could not set SO_REUSEPORT for socket: %s\n", rrr_strerror(errno));
+			goto out_close_socket;
+		}
+	}
+
 	if (rrr_socket_bind_and_listen(fd, (struct sockaddr *) &si, sizeof(si), SO_REUSEADDR, max_connections) != 0) {
 		RRR_DBG_1 ("Note: Could not listen on port %d %s: %s\n", data->port, (do_ipv6 ? "IPv6" : "IPv4"), rrr_strerror(errno));
 		goto out_close_socket;
@@ -56,6 +56,8 @@ struct rrr_ip_data {
 	int fd;
 	uint16_t port;
 	int is_ipv6;
+	// Set SO_REUSEPORT on listening sockets
+	int reuse_port;
 };
 
 void rrr_ip_network_reset_hard (
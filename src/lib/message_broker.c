@@ -84,6 +84,16 @@ struct rrr_message_broker_costumer {
 	int (*entry_pre_buffer_hook)(struct rrr_msg_holder *entry_locked, void *arg);
 	void *callback_arg;
 	struct rrr_message_broker_costumer_managed_data_collection managed_data;
+	// When fused, the single reader runs in the same thread as this
+	// costumer and written entries are passed directly to the poll
+	// callback of the reader as long as the buffer is empty.
+	struct rrr_message_broker_costumer *fused_reader;
+	uint64_t fused_count;
+	// Set by the fused reader itself
+	int (*fused_callback)(RRR_MODULE_POLL_CALLBACK_SIGNATURE);
+	void *fused_callback_arg;
+	int fused_poll_flags;
+	int fused_ret;
 };
 
 struct rrr_message_broker {
@@ -352,8 +362,8 @@ void rrr_message_broker_unregister_all (
 			rrr_fifo_protected_get_stats(&stats, &costumer->main_queue);
 		}
 
-		RRR_DBG_1 ("Message broker unregister costumer '%s', buffer stats: %" PRIu64 "/%" PRIu64 "\n",
-				costumer->name, stats.total_entries_deleted, stats.total_entries_written
+		RRR_DBG_1 ("Message broker unregister costumer '%s', buffer stats: %" PRIu64 "/%" PRIu64 ", fused: %" PRIu64 "\n",
+				costumer->name, stats.total_entries_deleted, stats.total_entries_written, costumer->fused_count
 		);
 		RRR_LL_DESTROY (
 				&costumer->split_buffers,
@@ -1233,6 +1243,14 @@ static int __rrr_message_broker_write_entry_unsafe_callback(RRR_FIFO_PROTECTED_W
 	return 0;
 }
 
+static int __rrr_message_broker_fused_deliver (
+		int *delivered,
+		struct rrr_message_broker_costumer *costumer,
+		struct rrr_msg_holder *entry,
+		int (*check_cancel_callback)(void *arg),
+		void *check_cancel_callback_arg
+);
+
 // Only to be used when we already are inside a read callback and the
 // entry we passed in is guaranteed to have been allocated and modified
 // exclusively in message broker context.
@@ -1255,6 +1273,19 @@ int rrr_message_broker_incref_and_write_entry_unsafe (
 		goto out;
 	}
 
+	if (costumer->fused_reader != NULL) {
+		int delivered = 0;
+		if ((ret = __rrr_message_broker_fused_deliver (
+				&delivered,
+				costumer,
+				entry,
+				check_cancel_callback,
+				check_cancel_callback_arg
+		)) != 0 || delivered) {
+			goto out;
+		}
+	}
+
 	if (costumer->slot != NULL) {
 		if ((ret = rrr_msg_holder_slot_write_incref (
 				costumer->slot,
@@ -1450,6 +1481,75 @@ static int __rrr_message_broker_poll_delete_slot_intermediate (
 	return ret & ~(RRR_FIFO_PROTECTED_SEARCH_STOP);
 }
 
+static int __rrr_message_broker_fused_deliver (
+		int *delivered,
+		struct rrr_message_broker_costumer *costumer,
+		struct rrr_msg_holder *entry,
+		int (*check_cancel_callback)(void *arg),
+		void *check_cancel_callback_arg
+) {
+	struct rrr_message_broker_costumer *reader = costumer->fused_reader;
+
+	int ret = RRR_MESSAGE_BROKER_OK;
+
+	*delivered = 0;
+
+	// The reader registers its callback the first time it polls. Any
+	// entries already in the buffer must be read first to preserve
+	// the ordering.
+	if (reader->fused_callback == NULL) {
+		goto out;
+	}
+	if (costumer->slot != NULL
+		? rrr_msg_holder_slot_count(costumer->slot) > 0
+		: rrr_fifo_protected_get_entry_count(&costumer->main_queue) > 0
+	) {
+		goto out;
+	}
+
+	uint16_t amount_dummy = 1;
+	struct rrr_message_broker_read_entry_intermediate_callback_data callback_data = {
+			&amount_dummy,
+			costumer,
+			reader,
+			reader->fused_poll_flags,
+			reader->fused_callback,
+			reader->fused_callback_arg
+	};
+
+	// Reference is held by the reader like when the entry is in the buffer
+	rrr_msg_holder_lock(entry);
+	rrr_msg_holder_incref_while_locked(entry);
+
+	int backstop_dummy = 0;
+	int ret_tmp = __rrr_message_broker_poll_intermediate_backstop_handling (
+			&backstop_dummy,
+			entry,
+			&callback_data
+	);
+
+	// Callback must unlock
+	rrr_msg_holder_decref(entry);
+
+	*delivered = 1;
+	costumer->fused_count++;
+
+	if (ret_tmp != 0) {
+		// Return values from the callback belong to the reader, they
+		// are returned the next time it polls.
+		reader->fused_ret |= ret_tmp;
+		ret = __rrr_message_broker_write_notifications_send_final (
+				reader,
+				1,
+				check_cancel_callback,
+				check_cancel_callback_arg
+		);
+	}
+
+	out:
+	return ret;
+}
+
 static int __rrr_message_broker_get_source_buffer (
 		int *source_buffer_is_main,
 		struct rrr_fifo_protected **use_buffer,
@@ -1619,6 +1719,12 @@ int rrr_message_broker_poll_delete (
 			callback_arg
 	};
 
+	if (self->fused_ret != 0) {
+		ret = self->fused_ret;
+		self->fused_ret = 0;
+		goto out;
+	}
+
 	FRIENDS_ITERATE_BEGIN(senders,RRR_MESSAGE_BROKER_SENDERS_MAX);
 		callback_data.source = costumer;
 
@@ -1789,9 +1895,57 @@ int rrr_message_broker_sender_add (
 	return ret;
 }
 
+// No locking, call prior to starting threads. The writer and the reader
+// must be run by the same thread.
+int rrr_message_broker_fuse (
+		struct rrr_message_broker_costumer *writer,
+		struct rrr_message_broker_costumer *reader
+) {
+	int ret = RRR_MESSAGE_BROKER_OK;
+
+	if (writer->write_notify_listeners[0] != reader ||
+	    writer->write_notify_listeners[1] != NULL ||
+	    reader->senders[0] != writer ||
+	    reader->senders[1] != NULL
+	) {
+		RRR_MSG_0("Costumer %s must be the only reader of %s which must be its only sender in order to fuse them\n",
+			reader->name, writer->name);
+		ret = RRR_MESSAGE_BROKER_ERR;
+		goto out;
+	}
+
+	if (writer->split_buffers_active) {
+		RRR_MSG_0("Costumer %s has split buffers and cannot be fused with %s\n",
+			writer->name, reader->name);
+		ret = RRR_MESSAGE_BROKER_ERR;
+		goto out;
+	}
+
+	RRR_DBG_1("Message broker fusing costumer '%s' with reader '%s'\n",
+		writer->name, reader->name);
+
+	writer->fused_reader = reader;
+
+	out:
+	return ret;
+}
+
+// Only to be called by the thread of the reader, which is also the
+// thread of the fused writer
+void rrr_message_broker_fused_callback_set (
+		struct rrr_message_broker_costumer *reader,
+		int broker_poll_flags,
+		int (*callback)(RRR_MODULE_POLL_CALLBACK_SIGNATURE),
+		void *callback_arg
+) {
+	reader->fused_poll_flags = broker_poll_flags;
+	reader->fused_callback = callback;
+	reader->fused_callback_arg = callback_arg;
+}
+
 void rrr_message_broker_report_buffers (
 		struct rrr_message_broker *broker,
-		void (*callback_buffer)(const char *name, rrr_length count, void *arg),
+		void (*callback_buffer)(const char *name, rrr_length count, const struct rrr_fifo_protected_stats *stats, void *arg),
 		void (*callback_split_buffer)(const char *name, const char *receiver_name, rrr_length count, void *arg),
 		void *callback_arg
 ) {
@@ -1808,7 +1962,9 @@ void rrr_message_broker_report_buffers (
 	for (int i = 0; i < costumer_count; i++) {
 		struct rrr_message_broker_costumer *costumer = costumers[i];
 		const rrr_length count = rrr_fifo_protected_get_entry_count(&costumer->main_queue);
-		callback_buffer(costumer->name, count, callback_arg);
+		struct rrr_fifo_protected_stats stats = {0};
+		rrr_message_broker_get_fifo_stats(&stats, costumer);
+		callback_buffer(costumer->name, count, &stats, callback_arg);
 
 		if (__rrr_message_broker_costumer_split_buffer_lock(costumer) != 0) {
 			RRR_MSG_0("Failed to lock split buffers of costumer %s in %s, lock inconsistency.\n",
@@ -167,9 +167,19 @@ int rrr_message_broker_sender_add (
 		struct rrr_message_broker_costumer *costumer,
 		struct rrr_message_broker_costumer *listener_costumer
 );
+int rrr_message_broker_fuse (
+		struct rrr_message_broker_costumer *writer,
+		struct rrr_message_broker_costumer *reader
+);
+void rrr_message_broker_fused_callback_set (
+		struct rrr_message_broker_costumer *reader,
+		int broker_poll_flags,
+		int (*callback)(RRR_MODULE_POLL_CALLBACK_SIGNATURE),
+		void *callback_arg
+);
 void rrr_message_broker_report_buffers (
 		struct rrr_message_broker *broker,
-		void (*callback_buffer)(const char *name, rrr_length count, void *arg),
+		void (*callback_buffer)(const char *name, rrr_length count, const struct rrr_fifo_protected_stats *stats, void *arg),
 		void (*callback_split_buffer)(const char *name, const char *receiver_name, rrr_length count, void *arg),
 		void *callback_arg
 );
@@ -25,6 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "message_holder/message_holder_struct.h"
 #include "messages/msg_msg.h"
+#include "mqtt/mqtt_topic.h"
+#include "allocator.h"
 #include "array.h"
 
 int rrr_message_helper_topic_match (
@@ -68,14 +70,49 @@ int rrr_message_helper_has_array_tag (
 	return ret;
 }
 
+// The topic view is stored in the entry and reused by all matchers
+// which see the same entry. Entry must be locked.
 int rrr_message_helper_entry_topic_match (
 		int *does_match,
-		const struct rrr_msg_holder *entry,
+		struct rrr_msg_holder *entry,
 		const struct rrr_mqtt_topic_token *token
 ) {
+	int ret = 0;
+
 	const struct rrr_msg_msg *msg = entry->message;
+
+	*does_match = 0;
+
 	assert(entry->data_length >= MSG_MIN_SIZE(msg));
-	return rrr_message_helper_topic_match(does_match, msg, token);
+	assert(RRR_MSG_IS_RRR_MESSAGE(msg));
+
+	if (MSG_TOPIC_LENGTH(msg) == 0) {
+		goto out;
+	}
+
+	const char *topic = MSG_TOPIC_PTR(msg);
+	const char *topic_end = topic + MSG_TOPIC_LENGTH(msg);
+
+	if (entry->topic_view != NULL && !rrr_mqtt_topic_view_describes_with_end(entry->topic_view, topic, topic_end)) {
+		RRR_FREE_IF_NOT_NULL(entry->topic_view);
+	}
+
+	if (entry->topic_view == NULL && rrr_mqtt_topic_view_new_with_end(&entry->topic_view, topic, topic_end) != 0) {
+		RRR_MSG_0("Error while matching topic against topic filter\n");
+		ret = 1;
+		goto out;
+	}
+
+	// Warn on every match, also when the view is reused
+	if (!entry->topic_view->is_valid) {
+		RRR_MSG_0("Warning: Invalid syntax found in message while matching topic of length %u\n", MSG_TOPIC_LENGTH(msg));
+		goto out;
+	}
+
+	*does_match = rrr_mqtt_topic_match_tokens_and_view(token, entry->topic_view) == RRR_MQTT_TOKEN_MATCH;
+
+	out:
+	return ret;
 }
 
 int rrr_message_helper_entry_has_array_tag (
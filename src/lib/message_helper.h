@@ -38,7 +38,7 @@ int rrr_message_helper_has_array_tag (
 );
 int rrr_message_helper_entry_topic_match (
 		int *does_match,
-		const struct rrr_msg_holder *entry,
+		struct rrr_msg_holder *entry,
 		const struct rrr_mqtt_topic_token *token
 );
 int rrr_message_helper_entry_has_array_tag (
@@ -160,6 +160,7 @@ void rrr_msg_holder_decref_while_locked_and_unlock (
 	}
 	else if (--(entry->usercount) == 0) {
 		RRR_FREE_IF_NOT_NULL(entry->message);
+		RRR_FREE_IF_NOT_NULL(entry->topic_view);
 		rrr_msg_holder_private_data_clear(entry);
 		rrr_instance_friend_collection_clear(&entry->nexthops);
 		entry->usercount = 1; // Avoid bug trap
@@ -384,6 +385,7 @@ void rrr_msg_holder_set_data_unlocked (
 		rrr_biglength message_data_length
 ) {
 	RRR_FREE_IF_NOT_NULL(target->message);
+	RRR_FREE_IF_NOT_NULL(target->topic_view);
 	target->message = message;
 	target->data_length = message_data_length;
 }
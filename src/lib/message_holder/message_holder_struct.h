@@ -34,6 +34,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //#define RRR_MESSAGE_HOLDER_DEBUG_REFCOUNT
 //#define RRR_MESSAGE_HOLDER_DEBUG_LOCK_RECURSION
 
+struct rrr_mqtt_topic_view;
+
 // Note : When adding fields, update the zeroing macro below
 
 struct rrr_msg_holder {
@@ -74,6 +76,10 @@ struct rrr_msg_holder {
 	// Available for modules
 	void *private_data;
 	void (*private_data_destroy)(void *private_data);
+
+	// Tokenized topic of the message, created on first topic match
+	// and reused by later matches as long as the topic is unchanged
+	struct rrr_mqtt_topic_view *topic_view;
 };
 
 // Zero all fields except from the lock.
@@ -95,7 +101,8 @@ struct rrr_msg_holder {
     entry->bytes_to_send = 0;                                  \
     entry->endian_indicator = 0;                               \
     entry->private_data = NULL;                                \
-    entry->private_data_destroy = NULL                         \
+    entry->private_data_destroy = NULL;                        \
+    entry->topic_view = NULL                                   \
 
 #ifdef RRR_MESSAGE_HOLDER_DEBUG_LOCK_RECURSION
     #define RRR_MESSAGE_HOLDER_ZERO_ALL(entry)                 \
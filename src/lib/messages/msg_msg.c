@@ -458,38 +458,32 @@ int rrr_msg_msg_topic_match (
 ) {
 	int ret = 0;
 
-	char *topic_tmp = NULL;
-
 	*does_match = 0;
 
-	struct rrr_mqtt_topic_token *entry_first_token = NULL;
+	struct rrr_mqtt_topic_view *view = NULL;
 
-	if (rrr_mqtt_topic_validate_name_with_end (
+	// An invalid topic produces a view which never matches
+	if (rrr_mqtt_topic_view_new_with_end (
+			&view,
 			MSG_TOPIC_PTR(message),
 			MSG_TOPIC_PTR(message) + MSG_TOPIC_LENGTH(message)
 	) != 0) {
-		RRR_MSG_0("Warning: Invalid syntax found in message while matching topic of length %u\n", MSG_TOPIC_LENGTH(message));
-		ret = 0;
+		RRR_MSG_0("Tokenizing of topic failed in rrr_msg_msg_topic_match\n");
+		ret = 1;
 		goto out;
 	}
 
-	if (rrr_mqtt_topic_tokenize_with_end (
-			&entry_first_token,
-			MSG_TOPIC_PTR(message),
-			MSG_TOPIC_PTR(message) + MSG_TOPIC_LENGTH(message)
-	) != 0) {
-		RRR_MSG_0("Tokenizing of topic failed in rrr_msg_msg_topic_match\n");
-		ret = 1;
+	if (!view->is_valid) {
+		RRR_MSG_0("Warning: Invalid syntax found in message while matching topic of length %u\n", MSG_TOPIC_LENGTH(message));
 		goto out;
 	}
 
-	if (rrr_mqtt_topic_match_tokens_recursively(filter_first_token, entry_first_token) == RRR_MQTT_TOKEN_MATCH) {
+	if (rrr_mqtt_topic_match_tokens_and_view(filter_first_token, view) == RRR_MQTT_TOKEN_MATCH) {
 		*does_match = 1;
 	}
 
 	out:
-	RRR_FREE_IF_NOT_NULL(topic_tmp);
-	rrr_mqtt_topic_token_destroy(entry_first_token);
+	RRR_FREE_IF_NOT_NULL(view);
 	return ret;
 }
 
@@ -43,6 +43,192 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_MQTT_ACL_ACTION_RESULT_TO_STR(action) \
 	(action == RRR_MQTT_ACL_RESULT_ALLOW ? "ALLOW" : (action == RRR_MQTT_ACL_RESULT_DENY ? "DENY" : (action == RRR_MQTT_ACL_RESULT_DISCONNECT ? "DISCONNECT" : "ERR")))
 
+// Topic levels of all entries. An entry is stored in the node of its
+// last level, and only the last entry of equal topics is kept as the
+// last matching entry always decides access.
+struct rrr_mqtt_acl_trie_node {
+	struct rrr_hash children;
+	struct rrr_mqtt_acl_trie_node *child_plus;
+	struct rrr_mqtt_acl_trie_node *child_hash;
+	const struct rrr_mqtt_acl_entry *entry;
+};
+
+static uint64_t rrr_mqtt_acl_generation = 0;
+
+static void __rrr_mqtt_acl_trie_node_destroy (
+		struct rrr_mqtt_acl_trie_node *node
+);
+
+static int __rrr_mqtt_acl_trie_node_destroy_callback (
+		RRR_HASH_ITERATE_CALLBACK_ARGS
+) {
+	(void)(key);
+	(void)(key_size);
+	(void)(arg);
+
+	__rrr_mqtt_acl_trie_node_destroy(value);
+
+	return RRR_HASH_ITERATE_REMOVE;
+}
+
+static void __rrr_mqtt_acl_trie_node_destroy (
+		struct rrr_mqtt_acl_trie_node *node
+) {
+	if (node == NULL) {
+		return;
+	}
+	rrr_hash_iterate(&node->children, __rrr_mqtt_acl_trie_node_destroy_callback, NULL);
+	rrr_hash_clear(&node->children);
+	__rrr_mqtt_acl_trie_node_destroy(node->child_plus);
+	__rrr_mqtt_acl_trie_node_destroy(node->child_hash);
+	rrr_free(node);
+}
+
+static int __rrr_mqtt_acl_trie_node_new (
+		struct rrr_mqtt_acl_trie_node **target
+) {
+	if ((*target = rrr_allocate_zero(sizeof(**target))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		return 1;
+	}
+	return 0;
+}
+
+static int __rrr_mqtt_acl_trie_insert (
+		struct rrr_mqtt_acl_trie_node *root,
+		const struct rrr_mqtt_acl_entry *entry
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_acl_trie_node *node = root;
+
+	for (const struct rrr_mqtt_topic_token *token = entry->first_token; token != NULL; token = token->next) {
+		struct rrr_mqtt_acl_trie_node **child_ptr = NULL;
+		struct rrr_mqtt_acl_trie_node *child = NULL;
+
+		if (strcmp(token->data, "+") == 0) {
+			child_ptr = &node->child_plus;
+		}
+		else if (strcmp(token->data, "#") == 0) {
+			child_ptr = &node->child_hash;
+		}
+		else if ((child = rrr_hash_get_str(&node->children, token->data)) == NULL) {
+			if ((ret = __rrr_mqtt_acl_trie_node_new(&child)) != 0) {
+				goto out;
+			}
+			if ((ret = rrr_hash_set_str(&node->children, token->data, child)) != 0) {
+				RRR_MSG_0("Could not store ACL topic level in %s\n", __func__);
+				__rrr_mqtt_acl_trie_node_destroy(child);
+				goto out;
+			}
+		}
+
+		if (child_ptr != NULL) {
+			if (*child_ptr == NULL && (ret = __rrr_mqtt_acl_trie_node_new(child_ptr)) != 0) {
+				goto out;
+			}
+			child = *child_ptr;
+		}
+
+		node = child;
+	}
+
+	node->entry = entry;
+
+	out:
+	return ret;
+}
+
+struct rrr_mqtt_acl_trie_match_data {
+	const struct rrr_mqtt_acl_entry *result;
+	int match_type;
+};
+
+static void __rrr_mqtt_acl_trie_match (
+		struct rrr_mqtt_acl_trie_match_data *data,
+		struct rrr_mqtt_acl_trie_node *node,
+		const struct rrr_mqtt_topic_token *token
+);
+
+static void __rrr_mqtt_acl_trie_match_candidate (
+		struct rrr_mqtt_acl_trie_match_data *data,
+		const struct rrr_mqtt_acl_trie_node *node
+) {
+	if (node->entry != NULL && (data->result == NULL || node->entry->index > data->result->index)) {
+		data->result = node->entry;
+	}
+}
+
+static void __rrr_mqtt_acl_trie_match_next (
+		struct rrr_mqtt_acl_trie_match_data *data,
+		struct rrr_mqtt_acl_trie_node *child,
+		const struct rrr_mqtt_topic_token *token
+) {
+	if (token->next == NULL) {
+		__rrr_mqtt_acl_trie_match_candidate(data, child);
+	}
+	else {
+		__rrr_mqtt_acl_trie_match(data, child, token->next);
+	}
+}
+
+struct rrr_mqtt_acl_trie_match_plus_data {
+	struct rrr_mqtt_acl_trie_match_data *data;
+	const struct rrr_mqtt_topic_token *token;
+};
+
+static int __rrr_mqtt_acl_trie_match_plus_callback (
+		RRR_HASH_ITERATE_CALLBACK_ARGS
+) {
+	struct rrr_mqtt_acl_trie_match_plus_data *plus_data = arg;
+
+	(void)(key_size);
+
+	if (*((const char *) key) != '$') {
+		__rrr_mqtt_acl_trie_match_next(plus_data->data, value, plus_data->token);
+	}
+
+	return RRR_HASH_ITERATE_OK;
+}
+
+// Matches the same way as rrr_mqtt_topic_match_tokens_recursively for
+// PUBLISH and rrr_mqtt_topic_match_tokens_recursively_acl for SUBSCRIBE
+static void __rrr_mqtt_acl_trie_match (
+		struct rrr_mqtt_acl_trie_match_data *data,
+		struct rrr_mqtt_acl_trie_node *node,
+		const struct rrr_mqtt_topic_token *token
+) {
+	const int is_subscribe = data->match_type == RRR_MQTT_ACL_MATCH_SUBSCRIBE;
+	const int wildcard_allowed = is_subscribe || *(token->data) != '$';
+
+	if (node->child_hash != NULL && wildcard_allowed) {
+		__rrr_mqtt_acl_trie_match_candidate(data, node->child_hash);
+	}
+
+	if (is_subscribe && strcmp(token->data, "#") == 0) {
+		// Only matched by # in the ACL
+		return;
+	}
+
+	if (is_subscribe && strcmp(token->data, "+") == 0) {
+		struct rrr_mqtt_acl_trie_match_plus_data plus_data = {
+			data,
+			token
+		};
+		rrr_hash_iterate(&node->children, __rrr_mqtt_acl_trie_match_plus_callback, &plus_data);
+	}
+	else {
+		struct rrr_mqtt_acl_trie_node *child = rrr_hash_get_str(&node->children, token->data);
+		if (child != NULL) {
+			__rrr_mqtt_acl_trie_match_next(data, child, token);
+		}
+	}
+
+	if (node->child_plus != NULL && wildcard_allowed) {
+		__rrr_mqtt_acl_trie_match_next(data, node->child_plus, token);
+	}
+}
+
 static void __rrr_mqtt_acl_user_entry_destroy (
 		struct rrr_mqtt_acl_user_entry *entry
 ) {
@@ -89,6 +275,7 @@ static void __rrr_mqtt_acl_entry_destroy (
 		struct rrr_mqtt_acl_entry *entry
 ) {
 	RRR_LL_DESTROY(entry, struct rrr_mqtt_acl_user_entry, __rrr_mqtt_acl_user_entry_destroy(node));
+	rrr_hash_clear(&entry->users);
 	rrr_mqtt_topic_token_destroy(entry->first_token); // Checks for NULL
 	RRR_FREE_IF_NOT_NULL(entry->topic_orig);
 	rrr_free(entry);
@@ -97,9 +284,63 @@ static void __rrr_mqtt_acl_entry_destroy (
 void rrr_mqtt_acl_entry_collection_clear (
 		struct rrr_mqtt_acl *collection
 ) {
+	__rrr_mqtt_acl_trie_node_destroy(collection->trie);
+	collection->trie = NULL;
+	collection->generation = __atomic_add_fetch(&rrr_mqtt_acl_generation, 1, __ATOMIC_RELAXED);
 	RRR_LL_DESTROY(collection, struct rrr_mqtt_acl_entry, __rrr_mqtt_acl_entry_destroy(node));
 }
 
+static int __rrr_mqtt_acl_entry_compile (
+		struct rrr_mqtt_acl_entry *entry,
+		rrr_length index
+) {
+	entry->index = index;
+
+	rrr_hash_clear(&entry->users);
+
+	// Later entries for the same user replace earlier ones
+	RRR_LL_ITERATE_BEGIN(entry, struct rrr_mqtt_acl_user_entry);
+		if (rrr_hash_set_str(&entry->users, node->username, node) != 0) {
+			RRR_MSG_0("Could not store ACL user in %s\n", __func__);
+			return 1;
+		}
+	RRR_LL_ITERATE_END();
+
+	return 0;
+}
+
+// Must be called after entries are added
+static int __rrr_mqtt_acl_entry_collection_compile (
+		struct rrr_mqtt_acl *collection
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_acl_trie_node *trie = NULL;
+	rrr_length index = 0;
+
+	if ((ret = __rrr_mqtt_acl_trie_node_new(&trie)) != 0) {
+		goto out;
+	}
+
+	RRR_LL_ITERATE_BEGIN(collection, struct rrr_mqtt_acl_entry);
+		if ((ret = __rrr_mqtt_acl_entry_compile(node, index++)) != 0) {
+			goto out;
+		}
+		if ((ret = __rrr_mqtt_acl_trie_insert(trie, node)) != 0) {
+			goto out;
+		}
+	RRR_LL_ITERATE_END();
+
+	__rrr_mqtt_acl_trie_node_destroy(collection->trie);
+	collection->trie = trie;
+	collection->generation = __atomic_add_fetch(&rrr_mqtt_acl_generation, 1, __ATOMIC_RELAXED);
+	trie = NULL;
+
+	out:
+	__rrr_mqtt_acl_trie_node_destroy(trie);
+	return ret;
+}
+
 static int __rrr_mqtt_acl_entry_collection_push_new (
 		struct rrr_mqtt_acl *collection,
 		const struct rrr_mqtt_topic_token *first_token,
@@ -498,6 +739,12 @@ int rrr_mqtt_acl_entry_collection_populate_from_file (
 		goto out_clear_acl;
 	}
 
+	if ((ret = __rrr_mqtt_acl_entry_collection_compile(collection)) != 0) {
+		RRR_MSG_0("Error while compiling MQTT ACL file '%s'\n", filename);
+		ret = 1;
+		goto out_clear_acl;
+	}
+
 	goto out;
 	out_clear_acl:
 		rrr_mqtt_acl_entry_collection_clear(collection);
@@ -527,6 +774,12 @@ int rrr_mqtt_acl_entry_collection_push_allow_all (
 
 	RRR_LL_LAST(collection)->default_action = RRR_MQTT_ACL_ACTION_RW;
 
+	if (__rrr_mqtt_acl_entry_collection_compile(collection) != 0) {
+		RRR_MSG_0("Could not compile entries in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
 	out:
 	rrr_mqtt_topic_token_destroy(token_tmp); // Checks for NULL
 	return ret;
@@ -576,35 +829,100 @@ int rrr_mqtt_acl_check_access (
 		const struct rrr_mqtt_topic_token *first_token,
 		int requested_access_level,
 		const char *username,
-		int (*match_function) (
-				const struct rrr_mqtt_topic_token *a,
-				const struct rrr_mqtt_topic_token *b
-		)
+		int match_type
 ) {
 	int ret = RRR_MQTT_ACL_RESULT_DENY;
 
-	RRR_LL_ITERATE_BEGIN(collection, const struct rrr_mqtt_acl_entry);
-		if (match_function(node->first_token, first_token) == RRR_MQTT_TOKEN_MATCH) {
-			RRR_DBG_2 ("ACL matched %s requested level %s default action %s\n",
-					node->topic_orig, RRR_MQTT_ACL_ACTION_TO_STR(requested_access_level), RRR_MQTT_ACL_ACTION_TO_STR(node->default_action));
-
-			ret = __rrr_mqtt_acl_check_access_single(node->default_action, requested_access_level);
-
-			RRR_DBG_2 ("ACL result is %s (after default)\n",
-					RRR_MQTT_ACL_ACTION_RESULT_TO_STR(ret));
-
-			if (username != NULL && *username != '\0') {
-				const struct rrr_mqtt_acl_entry *entry = node;
-				RRR_LL_ITERATE_BEGIN(entry, const struct rrr_mqtt_acl_user_entry);
-					if (strcmp(node->username, username) == 0) {
-						ret = __rrr_mqtt_acl_check_access_single(node->action, requested_access_level);
-						RRR_DBG_2 ("ACL result is %s (after username %s match)\n",
-								RRR_MQTT_ACL_ACTION_RESULT_TO_STR(ret), username);
-					}
-				RRR_LL_ITERATE_END();
-			}
-		}
-	RRR_LL_ITERATE_END();
+	struct rrr_mqtt_acl_trie_match_data match_data = {
+		NULL,
+		match_type
+	};
+
+	if (collection->trie == NULL || first_token == NULL) {
+		goto out;
+	}
+
+	__rrr_mqtt_acl_trie_match(&match_data, collection->trie, first_token);
+
+	const struct rrr_mqtt_acl_entry *entry = match_data.result;
+
+	if (entry == NULL) {
+		goto out;
+	}
+
+	RRR_DBG_2 ("ACL matched %s requested level %s default action %s\n",
+			entry->topic_orig, RRR_MQTT_ACL_ACTION_TO_STR(requested_access_level), RRR_MQTT_ACL_ACTION_TO_STR(entry->default_action));
+
+	ret = __rrr_mqtt_acl_check_access_single(entry->default_action, requested_access_level);
+
+	RRR_DBG_2 ("ACL result is %s (after default)\n",
+			RRR_MQTT_ACL_ACTION_RESULT_TO_STR(ret));
+
+	const struct rrr_mqtt_acl_user_entry *user_entry;
+	if (username != NULL && *username != '\0' && (user_entry = rrr_hash_get_str(&entry->users, username)) != NULL) {
+		ret = __rrr_mqtt_acl_check_access_single(user_entry->action, requested_access_level);
+		RRR_DBG_2 ("ACL result is %s (after username %s match)\n",
+				RRR_MQTT_ACL_ACTION_RESULT_TO_STR(ret), username);
+	}
+
+	out:
+	return ret;
+}
+
+void rrr_mqtt_acl_cache_clear (
+		struct rrr_mqtt_acl_cache *cache
+) {
+	rrr_hash_clear(&cache->decisions);
+}
+
+// The cache must only be used for one user. Results are stored with an
+// offset of one as the hash does not allow NULL values.
+int rrr_mqtt_acl_check_access_cached (
+		struct rrr_mqtt_acl_cache *cache,
+		const struct rrr_mqtt_acl *collection,
+		const char *topic,
+		const struct rrr_mqtt_topic_token *first_token,
+		int requested_access_level,
+		const char *username,
+		int match_type
+) {
+	const size_t topic_length = strlen(topic);
+
+	if (topic_length > 0xffff) {
+		RRR_BUG("BUG: Topic too long in %s\n", __func__);
+	}
+
+	char key[topic_length + 2];
+	key[0] = (char) requested_access_level;
+	key[1] = (char) match_type;
+	memcpy(key + 2, topic, topic_length);
+
+	const rrr_length key_size = (rrr_length) sizeof(key);
+
+	if (cache->generation != collection->generation) {
+		rrr_hash_clear(&cache->decisions);
+		cache->generation = collection->generation;
+	}
+
+	const uintptr_t cached = (uintptr_t) rrr_hash_get(&cache->decisions, key, key_size);
+	if (cached != 0) {
+		return (int) (cached - 1);
+	}
+
+	const int ret = rrr_mqtt_acl_check_access (
+			collection,
+			first_token,
+			requested_access_level,
+			username,
+			match_type
+	);
+
+	if (RRR_HASH_COUNT(&cache->decisions) >= RRR_MQTT_ACL_CACHE_MAX) {
+		rrr_hash_clear(&cache->decisions);
+	}
+
+	// Failure to store only means the decision is not cached
+	rrr_hash_set(&cache->decisions, key, key_size, (void *) (uintptr_t) (ret + 1));
 
 	return ret;
 }
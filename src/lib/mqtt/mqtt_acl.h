@@ -22,7 +22,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef RRR_MQTT_ACL_H
 #define RRR_MQTT_ACL_H
 
+#include <stdint.h>
+
 #include "../util/linked_list.h"
+#include "../util/hash.h"
 
 #define RRR_MQTT_ACL_ACTION_DENY	0
 #define RRR_MQTT_ACL_ACTION_RO		1
@@ -34,7 +37,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_MQTT_ACL_RESULT_DENY		2
 #define RRR_MQTT_ACL_RESULT_DISCONNECT	3
 
+// Matching rules for a topic name in a PUBLISH or a topic filter in a SUBSCRIBE
+#define RRR_MQTT_ACL_MATCH_PUBLISH		0
+#define RRR_MQTT_ACL_MATCH_SUBSCRIBE	1
+
+// Decisions cached per connection before the cache is emptied
+#define RRR_MQTT_ACL_CACHE_MAX			256
+
 struct rrr_mqtt_topic_token;
+struct rrr_mqtt_acl_trie_node;
 
 struct rrr_mqtt_acl_user_entry {
 	RRR_LL_NODE(struct rrr_mqtt_acl_user_entry);
@@ -49,10 +60,28 @@ struct rrr_mqtt_acl_entry {
 	int default_action_is_set;
 	struct rrr_mqtt_topic_token *first_token;
 	char *topic_orig;
+
+	// Position in the file, the last matching entry decides access
+	rrr_length index;
+
+	// Username to user entry, populated when the ACL is compiled
+	struct rrr_hash users;
 };
 
 struct rrr_mqtt_acl {
 	RRR_LL_HEAD(struct rrr_mqtt_acl_entry);
+
+	// Entries by topic level, rebuilt whenever entries are added
+	struct rrr_mqtt_acl_trie_node *trie;
+
+	// Changed whenever the trie is rebuilt, invalidates caches
+	uint64_t generation;
+};
+
+// Decisions for a single user, one per connection
+struct rrr_mqtt_acl_cache {
+	struct rrr_hash decisions;
+	uint64_t generation;
 };
 
 void rrr_mqtt_acl_entry_collection_clear (
@@ -70,10 +99,19 @@ int rrr_mqtt_acl_check_access (
 		const struct rrr_mqtt_topic_token *first_token,
 		int requested_access_level,
 		const char *username,
-		int (*match_function) (
-				const struct rrr_mqtt_topic_token *a,
-				const struct rrr_mqtt_topic_token *b
-		)
+		int match_type
+);
+void rrr_mqtt_acl_cache_clear (
+		struct rrr_mqtt_acl_cache *cache
+);
+int rrr_mqtt_acl_check_access_cached (
+		struct rrr_mqtt_acl_cache *cache,
+		const struct rrr_mqtt_acl *collection,
+		const char *topic,
+		const struct rrr_mqtt_topic_token *first_token,
+		int requested_access_level,
+		const char *username,
+		int match_type
 );
 
 #endif /* RRR_MQTT_ACL_H */
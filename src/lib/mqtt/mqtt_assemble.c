@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "mqtt_packet.h"
 #include "mqtt_payload_buf.h"
 #include "mqtt_subscription.h"
+#include "mqtt_topic_alias.h"
 
 #include "../util/rrr_endian.h"
 
@@ -187,9 +188,11 @@ static int __rrr_mqtt_assemble_put_properties_callback (
 	return ret;
 }
 
+// A non-zero topic alias is appended to the properties of the collection
 static int __rrr_mqtt_assemble_put_properties (
 		struct rrr_mqtt_payload_buf_session *session,
-		const struct rrr_mqtt_property_collection *properties
+		const struct rrr_mqtt_property_collection *properties,
+		uint16_t topic_alias
 ) {
 	int ret = RRR_MQTT_ASSEMBLE_OK;
 
@@ -204,6 +207,10 @@ static int __rrr_mqtt_assemble_put_properties (
 	// count becomes one byte for each property (it's ID)
 	total_size += count;
 
+	if (topic_alias != 0) {
+		total_size += RRR_MQTT_TOPIC_ALIAS_PROPERTY_SIZE;
+	}
+
 	if (total_size + count > 0xfffffff) { // <-- Seven f's
 		// This should be checked prior to calling assembly function
 		RRR_BUG("Size of collection was too large in %s\n", __func__);
@@ -219,6 +226,11 @@ static int __rrr_mqtt_assemble_put_properties (
 		goto out;
 	}
 
+	if (topic_alias != 0) {
+		PUT_U8(RRR_MQTT_PROPERTY_TOPIC_ALIAS);
+		PUT_U16(topic_alias);
+	}
+
 	const char *end = session->wpos;
 
 	if ((rrr_length) (end - begin) != total_size) {
@@ -229,15 +241,19 @@ static int __rrr_mqtt_assemble_put_properties (
 	return ret;
 }
 
-#define PUT_PROPERTIES(properties) do {                        \
+#define PUT_PROPERTIES_WITH_TOPIC_ALIAS(properties,topic_alias) do { \
         if (__rrr_mqtt_assemble_put_properties(                \
                 session,                                       \
-                (properties)                                   \
+                (properties),                                  \
+                (topic_alias)                                  \
         ) != RRR_MQTT_ASSEMBLE_OK) {                           \
             ret = RRR_MQTT_ASSEMBLE_INTERNAL_ERR;              \
             goto out;                                          \
         }} while (0)                                           \
 
+#define PUT_PROPERTIES(properties)                             \
+        PUT_PROPERTIES_WITH_TOPIC_ALIAS(properties, 0)
+
 int rrr_mqtt_assemble_connect (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION) {
 	struct rrr_mqtt_p_connect *connect = (struct rrr_mqtt_p_connect *) packet;
 
@@ -325,24 +341,50 @@ int rrr_mqtt_assemble_connack (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION) {
 	BUF_DESTROY_AND_RETURN(RRR_MQTT_ASSEMBLE_OK);
 }
 
+#define PUT_PUBLISH_TOPIC(publish) do {                        \
+        size_t topic_len = strlen(publish->topic);             \
+        if (topic_len > 0xffff) {                              \
+            RRR_BUG("Topic length overflow in %s\n", __func__); \
+        }                                                      \
+        PUT_RAW_WITH_LENGTH(publish->topic, (uint16_t) topic_len); \
+        } while(0)                                             \
+
 int rrr_mqtt_assemble_publish (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION) {
 	struct rrr_mqtt_p_publish *publish = (struct rrr_mqtt_p_publish *) packet;
+	const struct rrr_mqtt_p_publish_encoded *encoded = publish->encoded;
 
 	BUF_INIT();
 
-	size_t topic_len = strlen(publish->topic);
-	if (topic_len > 0xffff) {
-		RRR_BUG("Topic length overflow in %s\n", __func__);
+	// Pre-assembled fields are only valid for the protocol version they were made for
+	// and do not contain any topic alias set for the current connection
+	if (encoded != NULL && (encoded->protocol_version_id != packet->protocol_version->id || publish->topic_alias_out != 0)) {
+		encoded = NULL;
 	}
 
-	PUT_RAW_WITH_LENGTH(publish->topic, (uint16_t) topic_len);
+	if (encoded != NULL) {
+		PUT_RAW(encoded->data, encoded->topic_size);
+	}
+	else if (publish->topic_alias_out_omit_topic) {
+		if (publish->topic_alias_out == 0) {
+			RRR_BUG("BUG: Topic omitted without topic alias in %s\n", __func__);
+		}
+		PUT_U16(0);
+	}
+	else {
+		PUT_PUBLISH_TOPIC(publish);
+	}
 
 	if (RRR_MQTT_P_PUBLISH_GET_FLAG_QOS(publish) > 0) {
 		PUT_U16(publish->packet_identifier);
 	}
 
-	if (RRR_MQTT_P_IS_V5(packet)) {
-		PUT_PROPERTIES(&publish->properties);
+	if (encoded != NULL) {
+		if (encoded->properties_size > 0) {
+			PUT_RAW(encoded->data + encoded->topic_size, encoded->properties_size);
+		}
+	}
+	else if (RRR_MQTT_P_IS_V5(packet)) {
+		PUT_PROPERTIES_WITH_TOPIC_ALIAS(&publish->properties, publish->topic_alias_out);
 	}
 
 	// Payload is added automatically
@@ -350,6 +392,28 @@ int rrr_mqtt_assemble_publish (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION) {
 	BUF_DESTROY_AND_RETURN(RRR_MQTT_P_5_REASON_OK);
 }
 
+// Assemble the fields of PUBLISH which are equal for all recipients
+int rrr_mqtt_assemble_publish_encoded (
+		char **target,
+		rrr_length *size,
+		rrr_length *topic_size,
+		const struct rrr_mqtt_p_publish *publish
+) {
+	BUF_INIT();
+
+	*topic_size = 0;
+
+	PUT_PUBLISH_TOPIC(publish);
+
+	*topic_size = rrr_mqtt_payload_buf_get_touched_size(session);
+
+	if (RRR_MQTT_P_IS_V5(publish)) {
+		PUT_PROPERTIES(&publish->properties);
+	}
+
+	BUF_DESTROY_AND_RETURN(RRR_MQTT_ASSEMBLE_OK);
+}
+
 // Assemble PUBACK, PUBREC, PUBREL, PUBCOMP
 int rrr_mqtt_assemble_def_puback (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION) {
 	struct rrr_mqtt_p_def_puback *puback = (struct rrr_mqtt_p_def_puback *) packet;
@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 		char **target, rrr_length *size, struct rrr_mqtt_p *packet
 
 struct rrr_mqtt_p;
+struct rrr_mqtt_p_publish;
 
 int rrr_mqtt_assemble_connect (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION);
 int rrr_mqtt_assemble_connack (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION);
@@ -44,5 +45,11 @@ int rrr_mqtt_assemble_pingreq (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION);
 int rrr_mqtt_assemble_pingresp (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION);
 int rrr_mqtt_assemble_disconnect (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION);
 int rrr_mqtt_assemble_auth (RRR_MQTT_P_TYPE_ASSEMBLE_DEFINITION);
+int rrr_mqtt_assemble_publish_encoded (
+		char **target,
+		rrr_length *size,
+		rrr_length *topic_size,
+		const struct rrr_mqtt_p_publish *publish
+);
 
 #endif /* RRR_MQTT_ASSEMBLE_H */
@@ -37,7 +37,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "mqtt_packet.h"
 
 #include "../net_transport/net_transport.h"
+#include "../net_transport/net_transport_ctx.h"
+#include "../event/event.h"
+#include "../event/event_collection.h"
+#include "../socket/rrr_socket_eventfd.h"
 #include "../passwd.h"
+#include "../rrr_strerror.h"
 #include "../util/linked_list.h"
 #include "../util/gnu.h"
 #include "../util/macro_utils.h"
@@ -49,6 +54,188 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_MQTT_BROKER_MAX_IN_FLIGHT 	125
 #define RRR_MQTT_BROKER_COMPLETE_PUBLISH_GRACE_TIME_S 2
 
+#define RRR_MQTT_BROKER_SHARD_PERIODIC_INTERVAL_MS 100
+
+struct rrr_mqtt_broker_shard {
+	struct rrr_mqtt_broker_data *broker;
+	unsigned int index;
+
+	// Owned by the shard except for the first shard
+	struct rrr_event_queue *queue;
+	struct rrr_mqtt_transport *transport;
+
+	struct rrr_event_collection events;
+	rrr_event_handle event_notify;
+	rrr_event_handle event_periodic;
+
+	// Written to by any thread to make the shard check the send
+	// queues of all its connections
+	struct rrr_socket_eventfd notify;
+	rrr_atomic_u32_t notify_pending;
+	rrr_atomic_u32_t stop;
+	rrr_atomic_u32_t failed;
+
+	// Updated periodically by the shard
+	rrr_atomic_u64_t client_count;
+
+	struct rrr_mqtt_topic_alias_counters topic_alias_stats;
+
+	pthread_t thread;
+	int thread_started;
+};
+
+// The connection currently owning a client ID. A connection which
+// is no longer the owner has had its session taken over by a newer
+// connection, possibly in another shard.
+struct rrr_mqtt_broker_client {
+	const struct rrr_mqtt_conn *connection;
+	struct rrr_mqtt_broker_shard *shard;
+};
+
+static void __rrr_mqtt_broker_shard_notify (
+		struct rrr_mqtt_broker_shard *shard
+) {
+	// Only one notification is kept pending
+	if (rrr_atomic_u32_fetch_or(&shard->notify_pending, 1) != 0) {
+		return;
+	}
+
+	if (rrr_socket_eventfd_write(&shard->notify, 1) != 0) {
+		RRR_MSG_0("Warning: Failed to notify MQTT broker thread %u\n", shard->index);
+	}
+}
+
+static struct rrr_mqtt_broker_shard *__rrr_mqtt_broker_shard_get (
+		struct rrr_mqtt_broker_data *broker,
+		struct rrr_net_transport_handle *handle
+) {
+	for (unsigned int i = 0; i < broker->shard_count; i++) {
+		if (rrr_mqtt_transport_owns_handle(broker->shards[i].transport, handle)) {
+			return &broker->shards[i];
+		}
+	}
+	return NULL;
+}
+
+static struct rrr_mqtt_transport *__rrr_mqtt_broker_transport_get (
+		struct rrr_mqtt_broker_data *broker,
+		struct rrr_mqtt_broker_shard *shard
+) {
+	return shard != NULL ? shard->transport : broker->mqtt_data.transport;
+}
+
+static int __rrr_mqtt_broker_clients_clear_callback (
+		RRR_HASH_ITERATE_CALLBACK_ARGS
+) {
+	(void)(key);
+	(void)(key_size);
+	(void)(arg);
+
+	rrr_free(value);
+
+	return RRR_HASH_ITERATE_REMOVE;
+}
+
+static int __rrr_mqtt_broker_clients_register (
+		struct rrr_mqtt_broker_data *broker,
+		struct rrr_mqtt_broker_shard *shard,
+		const struct rrr_mqtt_conn *connection
+) {
+	int ret = RRR_MQTT_OK;
+
+	struct rrr_mqtt_broker_shard *shard_taken_over = NULL;
+	struct rrr_mqtt_broker_client *client;
+
+	pthread_mutex_lock(&broker->clients_lock);
+
+	if ((client = rrr_hash_get_str(&broker->clients, connection->client_id)) != NULL) {
+		if (client->connection != connection && client->shard != shard) {
+			shard_taken_over = client->shard;
+		}
+	}
+	else {
+		if ((client = rrr_allocate_zero(sizeof(*client))) == NULL) {
+			RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+			ret = RRR_MQTT_INTERNAL_ERROR;
+			goto out;
+		}
+		if (rrr_hash_set_str(&broker->clients, connection->client_id, client) != 0) {
+			RRR_MSG_0("Could not register client ID in %s\n", __func__);
+			rrr_free(client);
+			ret = RRR_MQTT_INTERNAL_ERROR;
+			goto out;
+		}
+	}
+
+	client->connection = connection;
+	client->shard = shard;
+
+	out:
+	pthread_mutex_unlock(&broker->clients_lock);
+
+	// The old connection disconnects itself upon noticing that it is no longer the owner
+	if (shard_taken_over != NULL) {
+		__rrr_mqtt_broker_shard_notify(shard_taken_over);
+	}
+
+	return ret;
+}
+
+static void __rrr_mqtt_broker_clients_unregister_if_owner_unlocked (
+		struct rrr_mqtt_broker_data *broker,
+		const struct rrr_mqtt_conn *connection
+) {
+	struct rrr_mqtt_broker_client *client;
+
+	if ((client = rrr_hash_get_str(&broker->clients, connection->client_id)) != NULL && client->connection == connection) {
+		rrr_hash_remove_str(&broker->clients, connection->client_id);
+		rrr_free(client);
+	}
+}
+
+static void __rrr_mqtt_broker_clients_unregister_if_owner (
+		struct rrr_mqtt_broker_data *broker,
+		const struct rrr_mqtt_conn *connection
+) {
+	pthread_mutex_lock(&broker->clients_lock);
+	__rrr_mqtt_broker_clients_unregister_if_owner_unlocked(broker, connection);
+	pthread_mutex_unlock(&broker->clients_lock);
+}
+
+static int __rrr_mqtt_broker_clients_is_taken_in_other_shard (
+		struct rrr_mqtt_broker_data *broker,
+		struct rrr_mqtt_broker_shard *shard,
+		const struct rrr_mqtt_conn *connection,
+		const char *client_id
+) {
+	struct rrr_mqtt_broker_client *client;
+	int taken = 0;
+
+	pthread_mutex_lock(&broker->clients_lock);
+	if ((client = rrr_hash_get_str(&broker->clients, client_id)) != NULL) {
+		taken = client->connection != connection && client->shard != shard;
+	}
+	pthread_mutex_unlock(&broker->clients_lock);
+
+	return taken;
+}
+
+static int __rrr_mqtt_broker_clients_is_owner (
+		struct rrr_mqtt_broker_data *broker,
+		const struct rrr_mqtt_conn *connection
+) {
+	struct rrr_mqtt_broker_client *client;
+	int owner = 0;
+
+	pthread_mutex_lock(&broker->clients_lock);
+	if ((client = rrr_hash_get_str(&broker->clients, connection->client_id)) != NULL) {
+		owner = client->connection == connection;
+	}
+	pthread_mutex_unlock(&broker->clients_lock);
+
+	return owner;
+}
+
 void __rrr_mqtt_broker_listen_ipv4_and_ipv6_callback (
 		struct rrr_net_transport_handle *handle,
 		void *arg
@@ -78,17 +265,18 @@ static int __rrr_mqtt_broker_listen_ipv4_and_ipv6 (
 	return ret;
 }
 
-int rrr_mqtt_broker_listen_ipv4_and_ipv6 (
-		struct rrr_mqtt_broker_data *broker,
+static int __rrr_mqtt_broker_listen_ipv4_and_ipv6_transport (
+		struct rrr_mqtt_transport *transport,
 		const struct rrr_net_transport_config *net_transport_config,
-		uint16_t port
+		uint16_t port,
+		int reuse_port
 ) {
 	int ret = RRR_MQTT_OK;
 
 	// TODO : For multiple ports, transport may be re-used
 
 	if ((ret = rrr_mqtt_transport_start (
-			broker->mqtt_data.transport,
+			transport,
 			net_transport_config,
 			"MQTT broker"
 	)) != 0) {
@@ -96,8 +284,12 @@ int rrr_mqtt_broker_listen_ipv4_and_ipv6 (
 		goto out;
 	}
 
+	if (reuse_port) {
+		rrr_net_transport_reuse_port_set(rrr_mqtt_transport_get_latest(transport));
+	}
+
 	if ((ret = __rrr_mqtt_broker_listen_ipv4_and_ipv6 (
-			rrr_mqtt_transport_get_latest(broker->mqtt_data.transport),
+			rrr_mqtt_transport_get_latest(transport),
 			port
 	)) != 0) {
 		goto out;
@@ -107,6 +299,40 @@ int rrr_mqtt_broker_listen_ipv4_and_ipv6 (
 	return ret;
 }
 
+int rrr_mqtt_broker_listen_ipv4_and_ipv6 (
+		struct rrr_mqtt_broker_data *broker,
+		const struct rrr_net_transport_config *net_transport_config,
+		uint16_t port
+) {
+	int ret = RRR_MQTT_OK;
+
+	if (broker->shard_count == 0) {
+		return __rrr_mqtt_broker_listen_ipv4_and_ipv6_transport (
+				broker->mqtt_data.transport,
+				net_transport_config,
+				port,
+				0
+		);
+	}
+
+	// All shards listen on the same port and the kernel distributes
+	// new connections between them
+	for (unsigned int i = 0; i < broker->shard_count; i++) {
+		if ((ret = __rrr_mqtt_broker_listen_ipv4_and_ipv6_transport (
+				broker->shards[i].transport,
+				net_transport_config,
+				port,
+				1
+		)) != 0) {
+			RRR_MSG_0("Listening failed for MQTT broker thread %u\n", i);
+			goto out;
+		}
+	}
+
+	out:
+	return ret;
+}
+
 struct validate_client_id_callback_data {
 	const struct rrr_mqtt_conn *orig_connection;
 	const char *client_id;
@@ -171,6 +397,7 @@ static int __rrr_mqtt_broker_check_unique_client_id (
 		const char *client_id,
 		const struct rrr_mqtt_conn *connection,
 		struct rrr_mqtt_broker_data *broker,
+		struct rrr_mqtt_broker_shard *shard,
 		short disconnect_other_client
 ) {
 	int ret = RRR_MQTT_OK;
@@ -187,7 +414,7 @@ static int __rrr_mqtt_broker_check_unique_client_id (
 	};
 
 	if ((ret = rrr_mqtt_transport_iterate (
-			broker->mqtt_data.transport,
+			__rrr_mqtt_broker_transport_get(broker, shard),
 			RRR_NET_TRANSPORT_SOCKET_MODE_CONNECTION,
 			__rrr_mqtt_broker_check_unique_client_id_callback,
 			&callback_data
@@ -196,6 +423,18 @@ static int __rrr_mqtt_broker_check_unique_client_id (
 		goto out;
 	}
 
+	// Connections in other shards cannot be accessed from here. When the
+	// new connection registers the client ID, the old connection is
+	// notified and disconnects itself.
+	if ( shard != NULL &&
+	    !callback_data.client_name_was_taken &&
+	     __rrr_mqtt_broker_clients_is_taken_in_other_shard(broker, shard, connection, client_id)
+	) {
+		RRR_DBG_2("Client ID %s is used by a connection in another broker thread\n", client_id);
+		callback_data.client_name_was_taken = 1;
+		callback_data.other_client_was_disconnected = callback_data.do_disconnect_other_client;
+	}
+
 	*client_name_was_taken = callback_data.client_name_was_taken;
 	*other_client_was_disconnected = callback_data.other_client_was_disconnected;
 
@@ -217,7 +456,8 @@ static int __rrr_mqtt_broker_check_unique_client_id (
 static int __rrr_mqtt_broker_generate_unique_client_id (
 		char **final_result,
 		const struct rrr_mqtt_conn *connection,
-		struct rrr_mqtt_broker_data *broker
+		struct rrr_mqtt_broker_data *broker,
+		struct rrr_mqtt_broker_shard *shard
 ) {
 	int ret = RRR_MQTT_OK;
 	uint32_t serial = 0;
@@ -228,7 +468,7 @@ static int __rrr_mqtt_broker_generate_unique_client_id (
 	int retries = RRR_MQTT_BROKER_MAX_GENERATED_CLIENT_IDS;
 	while (--retries >= 0) {
 		// We let the serial overflow
-		serial = ++(broker->client_serial);
+		serial = rrr_atomic_u32_fetch_add(&broker->client_serial, 1) + 1;
 
 		RRR_FREE_IF_NOT_NULL(result);
 
@@ -247,6 +487,7 @@ static int __rrr_mqtt_broker_generate_unique_client_id (
 				result,
 				connection,
 				broker,
+				shard,
 				0 // = do not disconnect other client with equal name
 		);
 
@@ -453,6 +694,7 @@ static int __rrr_mqtt_broker_handle_connect_check_client_identifier (
 		short *session_was_present,
 		struct rrr_mqtt_session **session,
 		struct rrr_mqtt_broker_data *data,
+		struct rrr_mqtt_broker_shard *shard,
 		struct rrr_mqtt_conn *connection,
 		const struct rrr_mqtt_p_connect *connect
 ) {
@@ -494,6 +736,7 @@ static int __rrr_mqtt_broker_handle_connect_check_client_identifier (
 			connect->client_identifier,
 			connection, // Don't check self-connection
 			data,
+			shard,
 			1 // Disconnect existing client with same ID
 	)) != 0) {
 		 if (ret == RRR_MQTT_INTERNAL_ERROR) {
@@ -510,6 +753,10 @@ static int __rrr_mqtt_broker_handle_connect_check_client_identifier (
 		goto out;
 	}
 
+	if (shard != NULL && (ret = __rrr_mqtt_broker_clients_register (data, shard, connection)) != 0) {
+		goto out;
+	}
+
 	out:
 	RRR_FREE_IF_NOT_NULL(client_id_tmp);
 	return ret;
@@ -519,6 +766,7 @@ static int __rrr_mqtt_broker_handle_connect_assign_client_identifier (
 		uint8_t *reason_v5,
 		struct rrr_mqtt_p_connack *connack,
 		struct rrr_mqtt_broker_data *data,
+		struct rrr_mqtt_broker_shard *shard,
 		struct rrr_mqtt_conn *connection,
 		const struct rrr_mqtt_p_connect *connect
 ) {
@@ -532,7 +780,7 @@ static int __rrr_mqtt_broker_handle_connect_assign_client_identifier (
 		goto out;
 	}
 
-	if ((ret = __rrr_mqtt_broker_generate_unique_client_id (&client_id_tmp, connection, data)) != 0) {
+	if ((ret = __rrr_mqtt_broker_generate_unique_client_id (&client_id_tmp, connection, data, shard)) != 0) {
 		if (ret == RRR_MQTT_SOFT_ERROR) {
 			*reason_v5 = RRR_MQTT_P_5_REASON_CLIENT_ID_REJECTED;
 			goto out;
@@ -557,6 +805,10 @@ static int __rrr_mqtt_broker_handle_connect_assign_client_identifier (
 		goto out;
 	}
 
+	if (shard != NULL && (ret = __rrr_mqtt_broker_clients_register (data, shard, connection)) != 0) {
+		goto out;
+	}
+
 	out:
 	RRR_FREE_IF_NOT_NULL(client_id_tmp);
 	return ret;
@@ -630,6 +882,9 @@ static int __rrr_mqtt_broker_handle_connect (RRR_MQTT_TYPE_HANDLER_DEFINITION) {
 
 	RRR_MQTT_DEFINE_CONN_FROM_HANDLE_AND_CHECK;
 
+	struct rrr_mqtt_broker_shard *shard = __rrr_mqtt_broker_shard_get(data, handle);
+	struct rrr_mqtt_transport *transport = __rrr_mqtt_broker_transport_get(data, shard);
+
 	struct rrr_mqtt_session *session = NULL;
 	short session_was_present = 0;
 
@@ -663,6 +918,7 @@ static int __rrr_mqtt_broker_handle_connect (RRR_MQTT_TYPE_HANDLER_DEFINITION) {
 				&reason_v5,
 				connack,
 				data,
+				shard,
 				connection,
 				connect
 		)) != 0) {
@@ -681,6 +937,7 @@ static int __rrr_mqtt_broker_handle_connect (RRR_MQTT_TYPE_HANDLER_DEFINITION) {
 				&session_was_present,
 				&session,
 				data,
+				shard,
 				connection,
 				connect
 		)) != 0) {
@@ -694,7 +951,14 @@ static int __rrr_mqtt_broker_handle_connect (RRR_MQTT_TYPE_HANDLER_DEFINITION) {
 	}
 
 	{
-		const rrr_length client_count = rrr_mqtt_transport_client_count_get(data->mqtt_data.transport);
+		rrr_length client_count = rrr_mqtt_transport_client_count_get(transport);
+
+		// Counts of other shards are updated periodically by each shard
+		for (unsigned int i = 0; i < data->shard_count; i++) {
+			if (&data->shards[i] != shard) {
+				client_count += (rrr_length) rrr_atomic_u64_load_relaxed(&data->shards[i].client_count);
+			}
+		}
 
 		// If max clients are reached, we only allow connection if another client with
 		// the same ID got disconnected. To disconnect it will of course cause the client
@@ -745,7 +1009,7 @@ static int __rrr_mqtt_broker_handle_connect (RRR_MQTT_TYPE_HANDLER_DEFINITION) {
 
 	// Remove session from any old connections not yet destroyed
 	if (rrr_mqtt_common_clear_session_from_connections (
-			&data->mqtt_data,
+			transport,
 			session,
 			RRR_NET_TRANSPORT_CTX_HANDLE(handle)
 	) != 0) {
@@ -789,6 +1053,36 @@ static int __rrr_mqtt_broker_handle_connect (RRR_MQTT_TYPE_HANDLER_DEFINITION) {
 		goto out_send_connack;
 	}
 
+	if (RRR_MQTT_P_IS_V5(connect)) {
+		// Aliases we assign are limited by the maximum the client accepts
+		const struct rrr_mqtt_property *alias_maximum = rrr_mqtt_property_collection_get_property (
+				&((struct rrr_mqtt_p_connect *) packet)->properties,
+				RRR_MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM,
+				0
+		);
+		uint32_t alias_maximum_out = alias_maximum != NULL ? rrr_mqtt_property_get_uint32(alias_maximum) : 0;
+		if (alias_maximum_out > mqtt_data->topic_alias_maximum_out) {
+			alias_maximum_out = mqtt_data->topic_alias_maximum_out;
+		}
+
+		rrr_mqtt_conn_set_topic_alias_maximums (
+				connection,
+				mqtt_data->topic_alias_maximum_in,
+				(uint16_t) alias_maximum_out,
+				shard != NULL ? &shard->topic_alias_stats : &mqtt_data->topic_alias_stats
+		);
+
+		if (mqtt_data->topic_alias_maximum_in > 0 && rrr_mqtt_property_collection_add_uint32 (
+				&connack->properties,
+				RRR_MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM,
+				mqtt_data->topic_alias_maximum_in
+		) != 0) {
+			RRR_MSG_0("Could not set topic alias maximum of CONNACK\n");
+			reason_v5 = RRR_MQTT_P_5_REASON_UNSPECIFIED_ERROR;
+			goto out_send_connack;
+		}
+	}
+
 	// First (and only) bit of flags is session present bit
 	connack->ack_flags = session_was_present && !RRR_MQTT_P_CONNECT_GET_FLAG_CLEAN_START(connect) ? 1 : 0;
 
@@ -823,6 +1117,10 @@ static int __rrr_mqtt_broker_handle_connect (RRR_MQTT_TYPE_HANDLER_DEFINITION) {
 	}
 
 	out:
+	// A connection which failed to connect must not keep its client ID from other connections
+	if (shard != NULL && connection->client_id != NULL && connection->session == NULL) {
+		__rrr_mqtt_broker_clients_unregister_if_owner(data, connection);
+	}
 	RRR_MQTT_P_DECREF_IF_NOT_NULL(connack);
 	return ret;
 }
@@ -1024,7 +1322,50 @@ static void __rrr_mqtt_broker_publish_notify_callback (
 		void *arg
 ) {
 	struct rrr_mqtt_broker_data *data = arg;
-	rrr_mqtt_transport_notify_tick(data->mqtt_data.transport);
+
+	if (data->shard_count == 0) {
+		rrr_mqtt_transport_notify_tick(data->mqtt_data.transport);
+		return;
+	}
+
+	// The publish may have been received in any of the shards and
+	// subscribers may be present in all of them
+	for (unsigned int i = 0; i < data->shard_count; i++) {
+		__rrr_mqtt_broker_shard_notify(&data->shards[i]);
+	}
+}
+
+// Only the connection owning the client ID may notify the session about the
+// disconnect as the session might already be in use by a connection in another
+// shard. The session is cleared from the connection afterwards which makes
+// the common event handler skip the notification.
+static int __rrr_mqtt_broker_shard_connection_disconnect (
+		struct rrr_mqtt_broker_data *data,
+		struct rrr_mqtt_conn *connection
+) {
+	int ret = RRR_MQTT_OK;
+
+	pthread_mutex_lock(&data->clients_lock);
+
+	struct rrr_mqtt_broker_client *client = connection->client_id != NULL
+		? rrr_hash_get_str(&data->clients, connection->client_id)
+		: NULL;
+
+	if (client != NULL && client->connection == connection) {
+		__rrr_mqtt_broker_clients_unregister_if_owner_unlocked(data, connection);
+
+		int ret_tmp = MQTT_COMMON_CALL_SESSION_NOTIFY_DISCONNECT(&data->mqtt_data, connection->session, connection->disconnect_reason_v5_);
+		if ((ret_tmp & RRR_MQTT_SESSION_INTERNAL_ERROR) != 0) {
+			RRR_MSG_0("Internal error while notifying session about disconnect in %s\n", __func__);
+			ret = RRR_MQTT_INTERNAL_ERROR;
+		}
+	}
+
+	connection->session = NULL;
+
+	pthread_mutex_unlock(&data->clients_lock);
+
+	return ret;
 }
 
 static int __rrr_mqtt_broker_event_handler (
@@ -1035,14 +1376,16 @@ static int __rrr_mqtt_broker_event_handler (
 ) {
 	struct rrr_mqtt_broker_data *data = static_arg;
 
-	(void)(connection);
 	(void)(arg);
 
 	int ret = RRR_MQTT_OK;
 
 	switch (event) {
 		case RRR_MQTT_CONN_EVENT_DISCONNECT:
-			data->stats.total_connections_closed++;
+			rrr_atomic_u64_fetch_add_relaxed(&data->connections_closed, 1);
+			if (data->shard_count > 0) {
+				ret = __rrr_mqtt_broker_shard_connection_disconnect(data, connection);
+			}
 			break;
 		default:
 			break;
@@ -1060,12 +1403,14 @@ static int __rrr_mqtt_broker_acl_handler_subscribe (
 	// set for each subscription
 
 	RRR_LL_ITERATE_BEGIN(subscribe->subscriptions, struct rrr_mqtt_subscription);
-		int ret_tmp = rrr_mqtt_acl_check_access (
+		int ret_tmp = rrr_mqtt_acl_check_access_cached (
+				&connection->acl_cache,
 				broker->acl,
+				node->topic_filter,
 				node->token_tree,
 				RRR_MQTT_ACL_ACTION_RO,
 				connection->username,
-				rrr_mqtt_topic_match_tokens_recursively_acl
+				RRR_MQTT_ACL_MATCH_SUBSCRIBE
 		);
 		if (ret_tmp == RRR_MQTT_ACL_RESULT_ALLOW) {
 			RRR_DBG_2("ACL: Subscription '%s' for client '%s' allowed\n", node->topic_filter, connection->client_id);
@@ -1084,12 +1429,14 @@ static int __rrr_mqtt_broker_acl_handler_publish (
 		struct rrr_mqtt_conn *connection,
 		struct rrr_mqtt_p_publish *publish
 ) {
-	int ret = rrr_mqtt_acl_check_access (
+	int ret = rrr_mqtt_acl_check_access_cached (
+			&connection->acl_cache,
 			broker->acl,
+			publish->topic,
 			publish->token_tree_,
 			RRR_MQTT_ACL_ACTION_RW,
 			connection->username,
-			rrr_mqtt_topic_match_tokens_recursively
+			RRR_MQTT_ACL_MATCH_PUBLISH
 	);
 
 	if (ret == RRR_MQTT_ACL_RESULT_DENY && !RRR_MQTT_P_IS_V5(publish) && broker->disconnect_on_v31_publish_deny != 0) {
@@ -1121,12 +1468,172 @@ static int __rrr_mqtt_broker_acl_handler (
 	return ret;
 }
 
+static void __rrr_mqtt_broker_shard_notify_event (
+		evutil_socket_t fd,
+		short flags,
+		void *arg
+) {
+	struct rrr_mqtt_broker_shard *shard = arg;
+
+	(void)(fd);
+	(void)(flags);
+
+	uint64_t count_dummy;
+
+	// Clear before reading to not lose notifications written in between
+	rrr_atomic_u32_fetch_and(&shard->notify_pending, 0);
+
+	if (rrr_socket_eventfd_read(&count_dummy, &shard->notify) != 0) {
+		RRR_MSG_0("Failed to read notify eventfd in MQTT broker thread %u\n", shard->index);
+		rrr_atomic_u32_fetch_or(&shard->failed, 1);
+		rrr_event_dispatch_break(shard->queue);
+		return;
+	}
+
+	if (rrr_atomic_u32_load(&shard->stop)) {
+		rrr_event_dispatch_exit(shard->queue);
+		return;
+	}
+
+	rrr_mqtt_transport_notify_tick(shard->transport);
+}
+
+static void __rrr_mqtt_broker_shard_periodic (
+		evutil_socket_t fd,
+		short flags,
+		void *arg
+) {
+	struct rrr_mqtt_broker_shard *shard = arg;
+	struct rrr_mqtt_broker_data *broker = shard->broker;
+
+	(void)(fd);
+	(void)(flags);
+
+	rrr_atomic_u64_store_relaxed(&shard->client_count, rrr_mqtt_transport_client_count_get(shard->transport));
+
+	if (shard->index != 0) {
+		return;
+	}
+
+	// The first shard runs in the instance thread and stops it if any of the others fail
+	for (unsigned int i = 1; i < broker->shard_count; i++) {
+		if (rrr_atomic_u32_load(&broker->shards[i].failed)) {
+			RRR_MSG_0("MQTT broker thread %u has failed, stopping\n", i);
+			rrr_event_dispatch_break(shard->queue);
+			return;
+		}
+	}
+}
+
+static void *__rrr_mqtt_broker_shard_thread (
+		void *arg
+) {
+	struct rrr_mqtt_broker_shard *shard = arg;
+
+	RRR_DBG_1("MQTT broker thread %u starting\n", shard->index);
+
+	if (rrr_event_dispatch(shard->queue, 0, NULL, NULL) != 0) {
+		RRR_MSG_0("MQTT broker thread %u exited with error\n", shard->index);
+		rrr_atomic_u32_fetch_or(&shard->failed, 1);
+	}
+
+	RRR_DBG_1("MQTT broker thread %u exiting\n", shard->index);
+
+	return NULL;
+}
+
+static void __rrr_mqtt_broker_shard_cleanup (
+		struct rrr_mqtt_broker_shard *shard
+) {
+	if (shard->thread_started) {
+		pthread_join(shard->thread, NULL);
+		shard->thread_started = 0;
+	}
+
+	rrr_event_collection_clear(&shard->events);
+	rrr_socket_eventfd_cleanup(&shard->notify);
+
+	// The first shard uses the transport and queue of the broker
+	if (shard->index != 0) {
+		if (shard->transport != NULL) {
+			rrr_mqtt_transport_destroy(shard->transport);
+		}
+		if (shard->queue != NULL) {
+			rrr_event_queue_destroy(shard->queue);
+		}
+	}
+}
+
+static void __rrr_mqtt_broker_shards_destroy (
+		struct rrr_mqtt_broker_data *broker
+) {
+	// Stop all threads before any transport is destroyed
+	for (unsigned int i = 0; i < broker->shard_count; i++) {
+		struct rrr_mqtt_broker_shard *shard = &broker->shards[i];
+		if (shard->thread_started) {
+			rrr_atomic_u32_fetch_or(&shard->stop, 1);
+			__rrr_mqtt_broker_shard_notify(shard);
+		}
+	}
+
+	for (unsigned int i = 0; i < broker->shard_count; i++) {
+		__rrr_mqtt_broker_shard_cleanup(&broker->shards[i]);
+	}
+
+	rrr_free(broker->shards);
+	broker->shards = NULL;
+	broker->shard_count = 0;
+
+	rrr_hash_iterate(&broker->clients, __rrr_mqtt_broker_clients_clear_callback, NULL);
+	rrr_hash_clear(&broker->clients);
+	pthread_mutex_destroy(&broker->clients_lock);
+}
+
 void rrr_mqtt_broker_destroy (struct rrr_mqtt_broker_data *broker) {
 	/* Caller should make sure that no more connections are accepted at this point */
+	if (broker->shards != NULL) {
+		__rrr_mqtt_broker_shards_destroy(broker);
+	}
 	rrr_mqtt_common_data_destroy(&broker->mqtt_data);
 	rrr_free(broker);
 }
 
+// When a connection in another shard has taken over the client ID, this
+// connection is disconnected without touching the session.
+static int __rrr_mqtt_broker_read_check_taken_over (
+		struct rrr_mqtt_broker_data *data,
+		struct rrr_net_transport_handle *handle
+) {
+	RRR_MQTT_DEFINE_CONN_FROM_HANDLE_AND_CHECK_NO_ERROR;
+
+	int ret = RRR_MQTT_OK;
+
+	if ( connection->client_id == NULL ||
+	     connection->session == NULL ||
+	    !RRR_MQTT_CONN_STATE_SEND_IS_BUSY_CLIENT_ID(connection) ||
+	     __rrr_mqtt_broker_clients_is_owner(data, connection)
+	) {
+		goto out;
+	}
+
+	RRR_DBG_2("Disconnecting client with client ID %s, session was taken over by connection in another broker thread\n",
+			connection->client_id);
+
+	connection->session = NULL;
+
+	RRR_MQTT_CONN_SET_DISCONNECT_REASON_IF_ZERO(connection, RRR_MQTT_P_5_REASON_SESSION_TAKEN_OVER);
+
+	if ((ret = rrr_mqtt_conn_iterator_ctx_send_disconnect(handle)) != 0) {
+		ret &= RRR_MQTT_INTERNAL_ERROR;
+		goto out;
+	}
+
+	ret = RRR_MQTT_SOFT_ERROR;
+
+	out:
+	return ret;
+}
+
 static int __rrr_mqtt_broker_read_callback (
 		RRR_NET_TRANSPORT_READ_CALLBACK_FINAL_ARGS
 ) {
@@ -1137,6 +1644,13 @@ static int __rrr_mqtt_broker_read_callback (
 
 	struct rrr_mqtt_session_iterate_send_queue_counters session_iterate_counters = {0};
 
+	if (data->shard_count > 0 && (ret = __rrr_mqtt_broker_read_check_taken_over(data, handle)) != 0) {
+		ret = (ret & RRR_MQTT_INTERNAL_ERROR) != 0
+			? RRR_NET_TRANSPORT_READ_HARD_ERROR
+			: RRR_NET_TRANSPORT_READ_SOFT_ERROR;
+		goto out;
+	}
+
 	if ((ret = ret_from_read = rrr_mqtt_common_read_parse_single_handle (
 			&session_iterate_counters,
 			&data->mqtt_data,
@@ -1158,6 +1672,143 @@ static int __rrr_mqtt_broker_read_callback (
 	return ret | ret_from_read;
 }
 
+static int __rrr_mqtt_broker_shard_init (
+		struct rrr_mqtt_broker_shard *shard,
+		struct rrr_mqtt_broker_data *broker,
+		const struct rrr_mqtt_common_init_data *init_data,
+		unsigned int index
+) {
+	int ret = 0;
+
+	shard->broker = broker;
+	shard->index = index;
+
+	if (index == 0) {
+		shard->queue = broker->mqtt_data.queue;
+		shard->transport = broker->mqtt_data.transport;
+	}
+	else {
+		if ((ret = rrr_event_queue_new(&shard->queue)) != 0) {
+			RRR_MSG_0("Could not create event queue in %s\n", __func__);
+			goto out;
+		}
+
+		if ((ret = rrr_mqtt_common_transport_new (
+				&shard->transport,
+				&broker->mqtt_data,
+				init_data->max_socket_connections,
+				shard->queue,
+				__rrr_mqtt_broker_read_callback,
+				broker
+		)) != 0) {
+			RRR_MSG_0("Could not create transport in %s\n", __func__);
+			goto out;
+		}
+	}
+
+	rrr_event_collection_init(&shard->events, shard->queue);
+
+	if ((ret = rrr_socket_eventfd_init(&shard->notify)) != 0) {
+		RRR_MSG_0("Could not create notify eventfd in %s\n", __func__);
+		goto out;
+	}
+
+	if ((ret = rrr_event_collection_push_read (
+			&shard->event_notify,
+			&shard->events,
+			RRR_SOCKET_EVENTFD_READ_FD(&shard->notify),
+			__rrr_mqtt_broker_shard_notify_event,
+			shard,
+			0
+	)) != 0) {
+		RRR_MSG_0("Could not create notify event in %s\n", __func__);
+		goto out;
+	}
+
+	EVENT_ADD(shard->event_notify);
+
+	if ((ret = rrr_event_collection_push_periodic (
+			&shard->event_periodic,
+			&shard->events,
+			__rrr_mqtt_broker_shard_periodic,
+			shard,
+			RRR_MQTT_BROKER_SHARD_PERIODIC_INTERVAL_MS * 1000
+	)) != 0) {
+		RRR_MSG_0("Could not create periodic event in %s\n", __func__);
+		goto out;
+	}
+
+	EVENT_ADD(shard->event_periodic);
+
+	out:
+	return ret;
+}
+
+static int __rrr_mqtt_broker_shards_new (
+		struct rrr_mqtt_broker_data *broker,
+		const struct rrr_mqtt_common_init_data *init_data,
+		unsigned int threads
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_session_collection *sessions_locked;
+
+	// Sessions are shared by all shards
+	if ((ret = rrr_mqtt_session_collection_locked_new(&sessions_locked, broker->mqtt_data.sessions)) != 0) {
+		RRR_MSG_0("Could not create locked session collection in %s\n", __func__);
+		goto out;
+	}
+	broker->mqtt_data.sessions = sessions_locked;
+
+	if ((ret = rrr_posix_mutex_init(&broker->clients_lock, 0)) != 0) {
+		RRR_MSG_0("Could not initialize mutex in %s\n", __func__);
+		goto out;
+	}
+
+	if ((broker->shards = rrr_allocate_zero(sizeof(*(broker->shards)) * threads)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out_destroy_mutex;
+	}
+
+	broker->shard_count = threads;
+
+	for (unsigned int i = 0; i < threads; i++) {
+		if ((ret = __rrr_mqtt_broker_shard_init(&broker->shards[i], broker, init_data, i)) != 0) {
+			goto out_destroy_shards;
+		}
+	}
+
+	goto out;
+	out_destroy_shards:
+		// Also destroys mutex
+		__rrr_mqtt_broker_shards_destroy(broker);
+		goto out;
+	out_destroy_mutex:
+		pthread_mutex_destroy(&broker->clients_lock);
+	out:
+		return ret;
+}
+
+int rrr_mqtt_broker_threads_start (
+		struct rrr_mqtt_broker_data *broker
+) {
+	int ret = 0;
+
+	for (unsigned int i = 1; i < broker->shard_count; i++) {
+		struct rrr_mqtt_broker_shard *shard = &broker->shards[i];
+		if ((ret = pthread_create(&shard->thread, NULL, __rrr_mqtt_broker_shard_thread, shard)) != 0) {
+			RRR_MSG_0("Could not start MQTT broker thread %u: %s\n", i, rrr_strerror(ret));
+			ret = 1;
+			goto out;
+		}
+		shard->thread_started = 1;
+	}
+
+	out:
+	return ret;
+}
+
 int rrr_mqtt_broker_new (
 		struct rrr_mqtt_broker_data **broker,
 		const struct rrr_mqtt_common_init_data *init_data,
@@ -1168,6 +1819,7 @@ int rrr_mqtt_broker_new (
 		const struct rrr_mqtt_acl *acl,
 		int disallow_anonymous_logins,
 		int disconnect_on_v31_publish_deny,
+		unsigned int threads,
 		int (*session_initializer)(struct rrr_mqtt_session_collection **sessions, void *arg),
 		void *session_initializer_arg
 ) {
@@ -1212,12 +1864,16 @@ int rrr_mqtt_broker_new (
 	res->permission_name = permission_name;
 	res->acl = acl;
 
+	if (threads > 1 && (ret = __rrr_mqtt_broker_shards_new(res, init_data, threads)) != 0) {
+		goto out_destroy_data;
+	}
+
 	MQTT_COMMON_CALL_SESSION_REGISTER_CALLBACKS(&res->mqtt_data, __rrr_mqtt_broker_publish_notify_callback, res);
 
 	*broker = res;
 	goto out;
-//	out_destroy_data:
-//		rrr_mqtt_common_data_destroy(&res->mqtt_data);
+	out_destroy_data:
+		rrr_mqtt_common_data_destroy(&res->mqtt_data);
 	out_free:
 		RRR_FREE_IF_NOT_NULL(res);
 	out:
@@ -1235,7 +1891,20 @@ void rrr_mqtt_broker_get_stats (
 		RRR_MSG_0("Warning: Failed to get session stats in %s\n", __func__);
 	}
 
+	data->stats.total_connections_closed = rrr_atomic_u64_load_relaxed(&data->connections_closed);
 	data->stats.connections_active = rrr_mqtt_transport_client_count_get(data->mqtt_data.transport);
+	memset(&data->stats.topic_alias_stats, '\0', sizeof(data->stats.topic_alias_stats));
+	rrr_mqtt_topic_alias_counters_add_to_stats(&data->stats.topic_alias_stats, &data->mqtt_data.topic_alias_stats);
+
+	// Counters of the other threads are read without synchronization
+	// and might be slightly off
+	for (unsigned int i = 1; i < data->shard_count; i++) {
+		struct rrr_mqtt_broker_shard *shard = &data->shards[i];
+		data->stats.connections_active += rrr_atomic_u64_load_relaxed(&shard->client_count);
+	}
+	for (unsigned int i = 0; i < data->shard_count; i++) {
+		rrr_mqtt_topic_alias_counters_add_to_stats(&data->stats.topic_alias_stats, &data->shards[i].topic_alias_stats);
+	}
 
 	*target = data->stats;
 }
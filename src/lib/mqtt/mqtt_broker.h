@@ -25,13 +25,19 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <inttypes.h>
+#include <pthread.h>
 
 #include "mqtt_common.h"
 #include "../ip/ip.h"
 #include "../util/linked_list.h"
+#include "../util/hash.h"
+#include "../util/atomic.h"
+
+#define RRR_MQTT_BROKER_THREADS_MAX 64
 
 struct rrr_mqtt_acl;
 struct rrr_mqtt_broker_data;
+struct rrr_mqtt_broker_shard;
 struct rrr_event_queue;
 struct rrr_net_transport;
 struct rrr_net_transport_config;
@@ -42,6 +48,7 @@ struct rrr_mqtt_broker_stats {
 	uint64_t total_connections_closed;
 
 	struct rrr_mqtt_session_collection_stats session_stats;
+	struct rrr_mqtt_topic_alias_stats topic_alias_stats;
 };
 
 struct rrr_mqtt_broker_data {
@@ -51,7 +58,7 @@ struct rrr_mqtt_broker_data {
 	rrr_length max_clients;
 	uint16_t max_keep_alive;
 
-	uint32_t client_serial;
+	rrr_atomic_u32_t client_serial;
 	struct rrr_mqtt_broker_stats stats;
 
 	int disallow_anonymous_logins;
@@ -60,6 +67,18 @@ struct rrr_mqtt_broker_data {
 	const char *password_file;
 	const char *permission_name;
 	const struct rrr_mqtt_acl *acl;
+
+	rrr_atomic_u64_t connections_closed;
+
+	// Connections are spread across the shards when more than one thread
+	// is used. The first shard uses the queue and transport of the broker,
+	// the others run in separate threads. Sessions are shared.
+	struct rrr_mqtt_broker_shard *shards;
+	unsigned int shard_count;
+
+	// Owners of client IDs across shards
+	pthread_mutex_t clients_lock;
+	struct rrr_hash clients;
 };
 
 void rrr_mqtt_broker_destroy (struct rrr_mqtt_broker_data *broker);
@@ -76,6 +95,7 @@ int rrr_mqtt_broker_new (
 		const struct rrr_mqtt_acl *acl,
 		int disallow_anonymous_logins,
 		int disconnect_on_v31_publish_deny,
+		unsigned int threads,
 		int (*session_initializer)(struct rrr_mqtt_session_collection **sessions, void *arg),
 		void *session_initializer_arg
 );
@@ -84,6 +104,9 @@ int rrr_mqtt_broker_listen_ipv4_and_ipv6 (
 		const struct rrr_net_transport_config *net_transport_config,
 		uint16_t port
 );
+int rrr_mqtt_broker_threads_start (
+		struct rrr_mqtt_broker_data *broker
+);
 void rrr_mqtt_broker_get_stats (
 		struct rrr_mqtt_broker_stats *target,
 		struct rrr_mqtt_broker_data *data
@@ -552,6 +552,16 @@ int rrr_mqtt_client_connect (
 				goto out;
 			}
 		}
+
+		if (data->mqtt_data.topic_alias_maximum_in > 0 && rrr_mqtt_property_collection_add_uint32 (
+				&connect->properties,
+				RRR_MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM,
+				data->mqtt_data.topic_alias_maximum_in
+		) != 0) {
+			RRR_MSG_0("Could not set topic alias maximum for CONNECT packet in %s\n", __func__);
+			ret = 1;
+			goto out;
+		}
 	}
 
 	data->protocol_version = protocol_version;
@@ -588,7 +598,7 @@ int rrr_mqtt_client_connect (
 		goto out;
 	}
 
-	if ((ret = rrr_mqtt_common_clear_session_from_connections (mqtt_data, *session, *transport_handle)) != 0) {
+	if ((ret = rrr_mqtt_common_clear_session_from_connections (mqtt_data->transport, *session, *transport_handle)) != 0) {
 		RRR_MSG_0("Error while clearing session from old connections in %s return was %i\n", __func__, ret);
 		ret = RRR_MQTT_INTERNAL_ERROR;
 		goto out;
@@ -753,6 +763,21 @@ static int __rrr_mqtt_client_handle_connack (RRR_MQTT_TYPE_HANDLER_DEFINITION) {
 		}
 	}
 
+	if (RRR_MQTT_P_IS_V5(connack)) {
+		// Aliases we assign are limited by the maximum the server accepts
+		uint32_t alias_maximum_out = session_properties_tmp.numbers.topic_alias_maximum;
+		if (alias_maximum_out > mqtt_data->topic_alias_maximum_out) {
+			alias_maximum_out = mqtt_data->topic_alias_maximum_out;
+		}
+
+		rrr_mqtt_conn_set_topic_alias_maximums (
+				connection,
+				mqtt_data->topic_alias_maximum_in,
+				(uint16_t) alias_maximum_out,
+				&mqtt_data->topic_alias_stats
+		);
+	}
+
 	RRR_DBG_1("Received CONNACK with keep-alive %u, now connected\n", session_properties_tmp.numbers.server_keep_alive);
 
 	out:
@@ -1066,4 +1091,6 @@ void rrr_mqtt_client_get_stats (
 	) != 0) {
 		RRR_MSG_0("Warning: Failed to get session stats in %s\n", __func__);
 	}
+
+	rrr_mqtt_topic_alias_counters_add_to_stats(&target->topic_alias_stats, &data->mqtt_data.topic_alias_stats);
 }
@@ -33,6 +33,7 @@ struct rrr_net_transport_config;
 
 struct rrr_mqtt_client_stats {
 	struct rrr_mqtt_session_collection_stats session_stats;
+	struct rrr_mqtt_topic_alias_stats topic_alias_stats;
 };
 
 struct rrr_mqtt_client_data {
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 
 #include "../log.h"
 #include "../allocator.h"
@@ -30,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "mqtt_transport.h"
 #include "mqtt_session.h"
 #include "mqtt_acl.h"
+#include "mqtt_topic.h"
 
 #include "../net_transport/net_transport.h"
 #include "../util/macro_utils.h"
@@ -114,7 +116,7 @@ static int __rrr_mqtt_common_clear_session_from_connections_callback (
  * connection will also become disconnected. To avoid this, clear the session from
  * all other connections upon CONNECT. */
 int rrr_mqtt_common_clear_session_from_connections (
-		struct rrr_mqtt_data *data,
+		struct rrr_mqtt_transport *transport,
 		const struct rrr_mqtt_session *session_to_remove,
 		int transport_handle_disregard
 ) {
@@ -124,7 +126,7 @@ int rrr_mqtt_common_clear_session_from_connections (
 	};
 
 	return rrr_mqtt_transport_iterate (
-			data->transport,
+			transport,
 			RRR_NET_TRANSPORT_SOCKET_MODE_CONNECTION,
 			__rrr_mqtt_common_clear_session_from_connections_callback ,
 			&callback_data
@@ -236,6 +238,30 @@ static void __rrr_mqtt_common_maintenance (
 	}
 }
 
+// Create a transport with connections reporting events to the given data. Used
+// for the main transport and for any additional transports running on other
+// event queues (threads).
+int rrr_mqtt_common_transport_new (
+		struct rrr_mqtt_transport **transport,
+		struct rrr_mqtt_data *data,
+		rrr_length max_socket_connections,
+		struct rrr_event_queue *queue,
+		int (*read_callback)(RRR_NET_TRANSPORT_READ_CALLBACK_FINAL_ARGS),
+		void *read_callback_arg
+) {
+	return rrr_mqtt_transport_new (
+			transport,
+			max_socket_connections,
+			data->close_wait_time_usec,
+			queue,
+			__rrr_mqtt_common_connection_event_handler,
+			data,
+			rrr_mqtt_conn_accept_and_connect_callback,
+			read_callback,
+			read_callback_arg
+	);
+}
+
 int rrr_mqtt_common_data_init (
 		struct rrr_mqtt_data *data,
 		const struct rrr_mqtt_type_handler_properties *handler_properties,
@@ -266,19 +292,18 @@ int rrr_mqtt_common_data_init (
 	data->event_handler_static_arg = event_handler_static_arg;
 	data->retry_interval_usec = init_data->retry_interval_usec;
 	data->close_wait_time_usec = init_data->close_wait_time_usec;
+	data->topic_alias_maximum_in = init_data->topic_alias_maximum_in;
+	data->topic_alias_maximum_out = init_data->topic_alias_maximum_out;
 	data->handler_properties = handler_properties;
 	data->acl_handler = acl_handler;
 	data->acl_handler_arg = acl_handler_arg;
 	data->queue = queue;
 
-	if (rrr_mqtt_transport_new (
+	if (rrr_mqtt_common_transport_new (
 			&data->transport,
+			data,
 			init_data->max_socket_connections,
-			init_data->close_wait_time_usec,
 			queue,
-			__rrr_mqtt_common_connection_event_handler,
-			data,
-			rrr_mqtt_conn_accept_and_connect_callback,
 			read_callback,
 			read_callback_arg
 	) != 0) {
@@ -569,6 +594,10 @@ int rrr_mqtt_common_parse_connack_properties_callback (
 				defined->server_keep_alive,
 				RRR_MQTT_PROPERTY_SERVER_KEEP_ALIVE
 		);
+		HANDLE_PROPERTY_UPDATE_DEFINED (
+				defined->topic_alias_maximum,
+				RRR_MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM
+		);
 	}; // Don't use the macro with the default: clause
 
 	HANDLE_PROPERTY_SWITCH_BEGIN();
@@ -627,6 +656,10 @@ int rrr_mqtt_common_parse_connack_properties_callback (
 				session_properties->numbers.server_keep_alive,
 				RRR_MQTT_PROPERTY_SERVER_KEEP_ALIVE
 		);
+		HANDLE_PROPERTY_U32_UNCHECKED (
+				session_properties->numbers.topic_alias_maximum,
+				RRR_MQTT_PROPERTY_TOPIC_ALIAS_MAXIMUM
+		);
 		HANDLE_PROPERTY_CLONE (
 				&session_properties->response_information,
 				RRR_MQTT_PROPERTY_RESPONSE_INFO
@@ -814,6 +847,87 @@ static int __rrr_mqtt_common_send_now_callback (
 	return ret;
 }
 
+// Store or resolve a topic alias in a received PUBLISH. The alias property is
+// removed afterwards as the topic alias only has meaning on this connection.
+static int __rrr_mqtt_common_handle_publish_topic_alias (
+		struct rrr_mqtt_conn *connection,
+		struct rrr_mqtt_p_publish *publish
+) {
+	int ret = RRR_MQTT_OK;
+
+	if (!RRR_MQTT_P_IS_V5(publish)) {
+		goto out;
+	}
+
+	const struct rrr_mqtt_property *property = rrr_mqtt_property_collection_get_property (
+			&publish->properties,
+			RRR_MQTT_PROPERTY_TOPIC_ALIAS,
+			0
+	);
+
+	if (property == NULL) {
+		if (*(publish->topic) == '\0') {
+			RRR_MSG_0("Received PUBLISH with empty topic and no topic alias\n");
+			RRR_MQTT_CONN_SET_DISCONNECT_REASON_IF_ZERO(connection, RRR_MQTT_P_5_REASON_PROTOCOL_ERROR);
+			ret = RRR_MQTT_SOFT_ERROR;
+		}
+		goto out;
+	}
+
+	const uint32_t alias = rrr_mqtt_property_get_uint32(property);
+	if (alias == 0 || alias > connection->topic_alias_in.maximum) {
+		RRR_MSG_0("Received PUBLISH with topic alias %" PRIu32 " outside of allowed range 1-%u\n",
+				alias, connection->topic_alias_in.maximum);
+		RRR_MQTT_CONN_SET_DISCONNECT_REASON_IF_ZERO(connection, RRR_MQTT_P_5_REASON_TOPIC_ALIAS_INVALID);
+		ret = RRR_MQTT_SOFT_ERROR;
+		goto out;
+	}
+
+	if (*(publish->topic) == '\0') {
+		const char *topic = rrr_mqtt_topic_alias_in_get(&connection->topic_alias_in, (uint16_t) alias);
+		if (topic == NULL) {
+			RRR_MSG_0("Received PUBLISH with empty topic and unknown topic alias %" PRIu32 "\n", alias);
+			RRR_MQTT_CONN_SET_DISCONNECT_REASON_IF_ZERO(connection, RRR_MQTT_P_5_REASON_PROTOCOL_ERROR);
+			ret = RRR_MQTT_SOFT_ERROR;
+			goto out;
+		}
+
+		char *topic_new = NULL;
+		if ((topic_new = rrr_strdup(topic)) == NULL) {
+			RRR_MSG_0("Could not allocate memory for topic in %s\n", __func__);
+			ret = RRR_MQTT_INTERNAL_ERROR;
+			goto out;
+		}
+		rrr_free(publish->topic);
+		publish->topic = topic_new;
+
+		if (rrr_mqtt_topic_tokenize(&publish->token_tree_, publish->topic) != 0) {
+			RRR_MSG_0("Could not create topic token tree in %s\n", __func__);
+			ret = RRR_MQTT_INTERNAL_ERROR;
+			goto out;
+		}
+
+		rrr_atomic_u64_fetch_add_relaxed(&connection->topic_alias_stats->in_resolved, 1);
+		rrr_atomic_u64_fetch_add_relaxed(&connection->topic_alias_stats->in_bytes_saved,
+				RRR_MQTT_TOPIC_ALIAS_BYTES_SAVED(strlen(publish->topic)));
+	}
+	else {
+		if ((ret = rrr_mqtt_topic_alias_in_set(&connection->topic_alias_in, (uint16_t) alias, publish->topic)) != 0) {
+			ret = RRR_MQTT_INTERNAL_ERROR;
+			goto out;
+		}
+
+		rrr_atomic_u64_fetch_add_relaxed(&connection->topic_alias_stats->in_assigned, 1);
+	}
+
+	RRR_DBG_3("PUBLISH topic alias %" PRIu32 " is topic '%s'\n", alias, publish->topic);
+
+	rrr_mqtt_property_collection_clear_by_id(&publish->properties, RRR_MQTT_PROPERTY_TOPIC_ALIAS);
+
+	out:
+	return ret;
+}
+
 int rrr_mqtt_common_handle_publish (RRR_MQTT_TYPE_HANDLER_DEFINITION) {
 	struct rrr_mqtt_p_publish *publish = (struct rrr_mqtt_p_publish *) packet;
 
@@ -846,6 +960,10 @@ int rrr_mqtt_common_handle_publish (RRR_MQTT_TYPE_HANDLER_DEFINITION) {
 		goto out_generate_ack;
 	}
 
+	if ((ret = __rrr_mqtt_common_handle_publish_topic_alias (connection, publish)) != 0) {
+		goto out;
+	}
+
 	int acl_result = mqtt_data->acl_handler(connection, packet, mqtt_data->acl_handler_arg);
 	switch (acl_result) {
 		case RRR_MQTT_ACL_RESULT_ALLOW:
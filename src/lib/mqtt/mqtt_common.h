@@ -25,6 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 
 #include "mqtt_session.h"
+#include "mqtt_topic_alias.h"
 #include "../read_constants.h"
 #include "../net_transport/net_transport.h"
 #include "../event/event.h"
@@ -147,6 +148,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 struct rrr_net_transport;
 struct rrr_net_transport_handle;
 struct rrr_event_queue;
+struct rrr_mqtt_transport;
 struct rrr_mqtt_data;
 struct rrr_mqtt_conn;
 struct rrr_mqtt_p_publish;
@@ -194,6 +196,9 @@ struct rrr_mqtt_data {
 	struct rrr_mqtt_session_collection *sessions;
 	uint64_t retry_interval_usec;
 	uint64_t close_wait_time_usec;
+	uint16_t topic_alias_maximum_in;
+	uint16_t topic_alias_maximum_out;
+	struct rrr_mqtt_topic_alias_counters topic_alias_stats;
 
 	struct rrr_event_queue *queue;
 	struct rrr_event_collection events;
@@ -205,6 +210,8 @@ struct rrr_mqtt_common_init_data {
 	uint64_t retry_interval_usec;
 	uint64_t close_wait_time_usec;
 	rrr_length max_socket_connections;
+	uint16_t topic_alias_maximum_in;
+	uint16_t topic_alias_maximum_out;
 };
 
 struct rrr_mqtt_send_from_sessions_callback_data {
@@ -261,10 +268,18 @@ extern const struct rrr_mqtt_session_properties rrr_mqtt_common_default_session_
 void rrr_mqtt_common_will_properties_clear (struct rrr_mqtt_common_will_properties *will_properties);
 void rrr_mqtt_common_data_destroy (struct rrr_mqtt_data *data);
 int rrr_mqtt_common_clear_session_from_connections (
-		struct rrr_mqtt_data *data,
+		struct rrr_mqtt_transport *transport,
 		const struct rrr_mqtt_session *session_to_remove,
 		int transport_handle_disregard
 );
+int rrr_mqtt_common_transport_new (
+		struct rrr_mqtt_transport **transport,
+		struct rrr_mqtt_data *data,
+		rrr_length max_socket_connections,
+		struct rrr_event_queue *queue,
+		int (*read_callback)(RRR_NET_TRANSPORT_READ_CALLBACK_FINAL_ARGS),
+		void *read_callback_arg
+);
 int rrr_mqtt_common_data_init (
 		struct rrr_mqtt_data *data,
 		const struct rrr_mqtt_type_handler_properties *handler_properties,
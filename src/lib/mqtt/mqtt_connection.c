@@ -47,6 +47,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define RRR_MQTT_CONN_SEND_CHUNK_LIMIT_FACTOR 0.9
 
+// Payloads of this size or larger are not copied into the send buffer
+#define RRR_MQTT_CONN_SEND_PAYLOAD_SHARED_MIN 4096
+
 static int __rrr_mqtt_connection_call_event_handler (struct rrr_mqtt_conn *connection, int event, int no_repeat, void *arg) {
 	int ret = RRR_MQTT_OK;
 
@@ -247,6 +250,10 @@ static void __rrr_mqtt_connection_destroy (struct rrr_mqtt_conn *connection) {
 
 	rrr_mqtt_parse_session_destroy(&connection->parse_session);
 
+	rrr_mqtt_topic_alias_in_clear(&connection->topic_alias_in);
+	rrr_mqtt_topic_alias_out_clear(&connection->topic_alias_out);
+	rrr_mqtt_acl_cache_clear(&connection->acl_cache);
+
 	RRR_FREE_IF_NOT_NULL(connection->client_id);
 	RRR_FREE_IF_NOT_NULL(connection->username);
 
@@ -494,6 +501,20 @@ int rrr_mqtt_conn_set_data_from_connect_and_connack (
 	return ret;
 }
 
+void rrr_mqtt_conn_set_topic_alias_maximums (
+		struct rrr_mqtt_conn *connection,
+		uint16_t maximum_in,
+		uint16_t maximum_out,
+		struct rrr_mqtt_topic_alias_counters *stats
+) {
+	rrr_mqtt_topic_alias_in_maximum_set(&connection->topic_alias_in, maximum_in);
+	rrr_mqtt_topic_alias_out_maximum_set(&connection->topic_alias_out, maximum_out);
+	connection->topic_alias_stats = stats;
+
+	RRR_DBG_3("Topic alias maximums for connection %p set to %u in and %u out\n",
+			connection, maximum_in, maximum_out);
+}
+
 int rrr_mqtt_conn_iterator_ctx_housekeeping (
 		struct rrr_net_transport_handle *handle,
 		int (*exceeded_keep_alive_callback)(struct rrr_net_transport_handle *handle, void *arg),
@@ -862,6 +883,33 @@ static int __rrr_mqtt_conn_iterator_ctx_send_push_urgent (
 	return ret;
 }
 
+static int __rrr_mqtt_conn_iterator_ctx_send_push_payload (
+		struct rrr_net_transport_handle *handle,
+		struct rrr_mqtt_p_payload *payload,
+		int urgent
+) {
+	RRR_MQTT_DEFINE_CONN_FROM_HANDLE_AND_CHECK;
+
+	int ret = 0;
+
+	// The payload is shared with other packets and is not copied
+	if ((ret = (urgent ? rrr_net_transport_ctx_send_push_shared_urgent : rrr_net_transport_ctx_send_push_shared) (
+			handle,
+			payload->payload_start,
+			payload->size,
+			rrr_mqtt_p_usercount_incref_void,
+			rrr_mqtt_p_usercount_decref_void,
+			payload
+	)) != 0) {
+		RRR_MSG_0("Error while pushing payload to send queue in %s\n", __func__);
+		ret = RRR_MQTT_SOFT_ERROR;
+		goto out;
+	}
+
+	out:
+	return ret;
+}
+
 int __rrr_mqtt_connection_create_variable_int (
 		uint8_t *target,
 		rrr_length *length,
@@ -887,6 +935,42 @@ int __rrr_mqtt_connection_create_variable_int (
 	return RRR_MQTT_OK;
 }
 
+static int __rrr_mqtt_conn_topic_alias_out_prepare (
+		struct rrr_mqtt_conn *connection,
+		struct rrr_mqtt_p_publish *publish
+) {
+	int ret = RRR_MQTT_OK;
+
+	uint16_t alias = 0;
+	int is_new = 0;
+
+	if (rrr_mqtt_topic_alias_out_get (&alias, &is_new, &connection->topic_alias_out, publish->topic) != 0) {
+		ret = RRR_MQTT_INTERNAL_ERROR;
+		goto out;
+	}
+
+	if (alias == 0) {
+		goto out;
+	}
+
+	publish->topic_alias_out = alias;
+	publish->topic_alias_out_omit_topic = !is_new;
+
+	if (connection->topic_alias_stats != NULL) {
+		if (is_new) {
+			rrr_atomic_u64_fetch_add_relaxed(&connection->topic_alias_stats->out_assigned, 1);
+		}
+		else {
+			rrr_atomic_u64_fetch_add_relaxed(&connection->topic_alias_stats->out_reused, 1);
+			rrr_atomic_u64_fetch_add_relaxed(&connection->topic_alias_stats->out_bytes_saved,
+					RRR_MQTT_TOPIC_ALIAS_BYTES_SAVED(strlen(publish->topic)));
+		}
+	}
+
+	out:
+	return ret;
+}
+
 static int __rrr_mqtt_conn_iterator_ctx_send_packet (
 		int *do_stop,
 		struct rrr_net_transport_handle *handle,
@@ -898,6 +982,7 @@ static int __rrr_mqtt_conn_iterator_ctx_send_packet (
 	int ret = RRR_MQTT_OK;
 
 	struct rrr_mqtt_p_payload *payload = NULL;
+	struct rrr_mqtt_p_publish *publish_aliased = NULL;
 	char *network_data = NULL;
 	rrr_length network_size = 0;
 	void *send_data = NULL;
@@ -916,6 +1001,24 @@ static int __rrr_mqtt_conn_iterator_ctx_send_packet (
 		packet->assembled_data_size = 0;
 	}
 
+	if (RRR_MQTT_P_GET_TYPE(packet) == RRR_MQTT_P_TYPE_PUBLISH &&
+	    connection->topic_alias_out.maximum > 0 &&
+	    RRR_MQTT_P_IS_V5(packet)
+	) {
+		publish_aliased = (struct rrr_mqtt_p_publish *) packet;
+		if ((ret = __rrr_mqtt_conn_topic_alias_out_prepare (connection, publish_aliased)) != 0) {
+			goto out;
+		}
+		if (publish_aliased->topic_alias_out == 0) {
+			publish_aliased = NULL;
+		}
+		else {
+			// The assembled data is specific to this connection
+			RRR_FREE_IF_NOT_NULL(packet->_assembled_data);
+			packet->assembled_data_size = 0;
+		}
+	}
+
 	if (packet->_assembled_data == NULL) {
 		int ret_tmp = RRR_MQTT_P_GET_ASSEMBLER(packet) (
 				&network_data,
@@ -994,7 +1097,11 @@ static int __rrr_mqtt_conn_iterator_ctx_send_packet (
 
 	__rrr_mqtt_connection_update_last_write_time(connection);
 
-	const rrr_biglength send_size = sizeof(header.type) + variable_int_length + packet->assembled_data_size + (payload != NULL ? payload->size : 0);
+	// Large payloads are pushed as a separate chunk referring to the payload
+	// memory, avoiding a copy per recipient when a PUBLISH is forwarded
+	const int do_send_payload_separately = payload_size >= RRR_MQTT_CONN_SEND_PAYLOAD_SHARED_MIN;
+
+	const rrr_biglength send_size = sizeof(header.type) + variable_int_length + packet->assembled_data_size + (payload != NULL && !do_send_payload_separately ? payload->size : 0);
 	if (send_size > RRR_LENGTH_MAX) {
 		RRR_BUG("Bug: Send size overflow in rrr_mqtt_conn_iterator_ctx_send_packet (%llu>%llu)\n",
 			(unsigned long long) send_size, (unsigned long long) RRR_LENGTH_MAX);
@@ -1023,7 +1130,9 @@ static int __rrr_mqtt_conn_iterator_ctx_send_packet (
 		if (payload_size == 0) {
 			RRR_BUG("Payload size was 0 but payload pointer was not NULL in %s\n", __func__);
 		}
-		memcpy(send_data_pos, payload->payload_start, payload->size);
+		if (!do_send_payload_separately) {
+			memcpy(send_data_pos, payload->payload_start, payload->size);
+		}
 	}
 
 	int (*send_method)(
@@ -1040,6 +1149,10 @@ static int __rrr_mqtt_conn_iterator_ctx_send_packet (
 		goto out;
 	}
 
+	if (do_send_payload_separately && (ret = __rrr_mqtt_conn_iterator_ctx_send_push_payload (handle, payload, urgent)) != 0) {
+		goto out;
+	}
+
 	ret = rrr_mqtt_conn_update_state (
 			connection,
 			packet,
@@ -1057,6 +1170,12 @@ static int __rrr_mqtt_conn_iterator_ctx_send_packet (
 	}
 
 	out:
+	if (publish_aliased != NULL) {
+		RRR_FREE_IF_NOT_NULL(packet->_assembled_data);
+		packet->assembled_data_size = 0;
+		publish_aliased->topic_alias_out = 0;
+		publish_aliased->topic_alias_out_omit_topic = 0;
+	}
 	RRR_FREE_IF_NOT_NULL(send_data);
 	RRR_FREE_IF_NOT_NULL(network_data);
 	return ret;
@@ -27,6 +27,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "mqtt_packet.h"
 #include "mqtt_parse.h"
+#include "mqtt_topic_alias.h"
+#include "mqtt_acl.h"
 #include "../fifo.h"
 #include "../read_constants.h"
 #include "../ip/ip.h"
@@ -98,6 +100,14 @@ struct rrr_mqtt_conn {
 
 	struct rrr_mqtt_p_queue receive_buffer;
 
+	// Topic aliases are only used with V5 and when enabled in configuration
+	struct rrr_mqtt_topic_alias_in topic_alias_in;
+	struct rrr_mqtt_topic_alias_out topic_alias_out;
+	struct rrr_mqtt_topic_alias_counters *topic_alias_stats;
+
+	// ACL decisions for the user of the connection, only used by the broker
+	struct rrr_mqtt_acl_cache acl_cache;
+
 	uint64_t close_wait_time_usec;
 	uint64_t close_wait_start;
 
@@ -174,6 +184,12 @@ int rrr_mqtt_conn_iterator_ctx_housekeeping (
 		int (*exceeded_keep_alive_callback)(struct rrr_net_transport_handle *handle, void *arg),
 		void *callback_arg
 );
+void rrr_mqtt_conn_set_topic_alias_maximums (
+		struct rrr_mqtt_conn *connection,
+		uint16_t maximum_in,
+		uint16_t maximum_out,
+		struct rrr_mqtt_topic_alias_counters *stats
+);
 void rrr_mqtt_conn_accept_and_connect_callback (
 		struct rrr_net_transport_handle *handle,
 		const struct sockaddr *sockaddr,
@@ -173,6 +173,7 @@ static void __rrr_mqtt_p_free_publish (RRR_MQTT_P_TYPE_FREE_DEFINITION) {
 	rrr_mqtt_property_collection_clear(&publish->subscription_ids);
 	rrr_mqtt_topic_token_destroy(publish->token_tree_);
 	RRR_FREE_IF_NOT_NULL(publish->topic);
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish->encoded);
 	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish->qos_packets.puback);
 	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish->qos_packets.pubrec);
 	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish->qos_packets.pubrel);
@@ -391,6 +392,11 @@ static struct rrr_mqtt_p_publish *__rrr_mqtt_p_clone_publish_raw (
 		result->payload = (struct rrr_mqtt_p_payload *) publish->payload;
 	}
 
+	// Topic and properties are equal, assembled data may be shared
+	if (publish->encoded != NULL) {
+		rrr_mqtt_p_publish_encoded_set(result, publish->encoded);
+	}
+
 	goto out;
 	out_free_topic:
 		RRR_FREE_IF_NOT_NULL(result->topic);
@@ -432,6 +438,8 @@ struct rrr_mqtt_p_publish *rrr_mqtt_p_clone_publish (
 	result->payload_format_indicator = source->payload_format_indicator;
 	result->topic_alias = source->topic_alias;
 
+	result->store_sequence = source->store_sequence;
+
 	if (do_preserve_type_flags) {
 		result->type_flags = source->type_flags;
 	}
@@ -445,6 +453,71 @@ struct rrr_mqtt_p_publish *rrr_mqtt_p_clone_publish (
 	return result;
 }
 
+static void __rrr_mqtt_p_publish_encoded_destroy (void *arg) {
+	struct rrr_mqtt_p_publish_encoded *encoded = arg;
+	RRR_FREE_IF_NOT_NULL(encoded->data);
+	rrr_free(encoded);
+}
+
+int rrr_mqtt_p_publish_encoded_new (
+		struct rrr_mqtt_p_publish_encoded **target,
+		const struct rrr_mqtt_p_publish *publish
+) {
+	int ret = 0;
+
+	*target = NULL;
+
+	struct rrr_mqtt_p_publish_encoded *result = NULL;
+
+	if ((result = rrr_allocate_zero(sizeof(*result))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	rrr_mqtt_p_usercount_init((struct rrr_mqtt_p_usercount *) result, __rrr_mqtt_p_publish_encoded_destroy);
+
+	rrr_length total_size = 0;
+
+	if (rrr_mqtt_assemble_publish_encoded (
+			&result->data,
+			&total_size,
+			&result->topic_size,
+			publish
+	) != RRR_MQTT_ASSEMBLE_OK) {
+		RRR_MSG_0("Could not assemble PUBLISH in %s\n", __func__);
+		ret = 1;
+		goto out_decref;
+	}
+
+	result->protocol_version_id = publish->protocol_version->id;
+	result->properties_size = total_size - result->topic_size;
+
+	*target = result;
+
+	goto out;
+	out_decref:
+		RRR_MQTT_P_DECREF(result);
+	out:
+		return ret;
+}
+
+void rrr_mqtt_p_publish_encoded_set (
+		struct rrr_mqtt_p_publish *publish,
+		struct rrr_mqtt_p_publish_encoded *encoded
+) {
+	RRR_MQTT_P_INCREF(encoded);
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish->encoded);
+	publish->encoded = encoded;
+}
+
+void rrr_mqtt_p_publish_encoded_release (
+		struct rrr_mqtt_p_publish *publish
+) {
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish->encoded);
+	publish->encoded = NULL;
+}
+
 const struct rrr_mqtt_p_reason *rrr_mqtt_p_reason_get_v5 (uint8_t reason_v5) {
 	const struct rrr_mqtt_p_reason *test;
 	int i = 0;
@@ -323,6 +323,17 @@ struct rrr_mqtt_p_qos_packets {
 	struct rrr_mqtt_p_pubcomp *pubcomp;
 };
 
+// Topic and properties of a PUBLISH assembled once and shared between the
+// copies forwarded to different clients. The packet identifier, which is
+// placed between the two fields, and the fixed header are added per copy.
+struct rrr_mqtt_p_publish_encoded {
+	RRR_MQTT_P_USERCOUNT_FIELDS;
+	uint8_t protocol_version_id;
+	char *data;
+	rrr_length topic_size;
+	rrr_length properties_size;
+};
+
 struct rrr_mqtt_p_publish {
 	RRR_MQTT_P_PACKET_HEADER;
 
@@ -331,6 +342,9 @@ struct rrr_mqtt_p_publish {
 
 	struct rrr_mqtt_property_collection properties;
 
+	// May be NULL. Must be released if topic or properties are modified.
+	struct rrr_mqtt_p_publish_encoded *encoded;
+
 	uint64_t create_time;
 	uint32_t message_expiry_interval;
 	uint8_t message_expiry_interval_properties_updated;
@@ -339,6 +353,11 @@ struct rrr_mqtt_p_publish {
 	uint16_t topic_alias;
 	struct rrr_mqtt_property_collection subscription_ids;
 
+	// Set only while the packet is being assembled for a connection
+	// which uses topic aliases, never copied.
+	uint16_t topic_alias_out;
+	uint8_t topic_alias_out_omit_topic;
+
 	// Note that this field will not be assembled. Put values
 	// in the general properties fields instead for them to be
 	// sent.
@@ -353,6 +372,9 @@ struct rrr_mqtt_p_publish {
 
 	// Used when message is in will wait queue
 	uint32_t will_delay_interval;
+
+	// Non-zero when an outbound copy is recorded in the session store
+	uint64_t store_sequence;
 };
 
 #define RRR_MQTT_P_PUBLISH_GET_FLAG_RETAIN(p)    (((p)->type_flags & 1))
@@ -501,6 +523,17 @@ struct rrr_mqtt_p_publish *rrr_mqtt_p_clone_publish (
 		int do_preserve_dup,
 		int do_preserve_reason
 );
+int rrr_mqtt_p_publish_encoded_new (
+		struct rrr_mqtt_p_publish_encoded **target,
+		const struct rrr_mqtt_p_publish *publish
+);
+void rrr_mqtt_p_publish_encoded_set (
+		struct rrr_mqtt_p_publish *publish,
+		struct rrr_mqtt_p_publish_encoded *encoded
+);
+void rrr_mqtt_p_publish_encoded_release (
+		struct rrr_mqtt_p_publish *publish
+);
 const struct rrr_mqtt_p_reason *rrr_mqtt_p_reason_get_v5 (uint8_t reason_v5);
 const struct rrr_mqtt_p_reason *rrr_mqtt_p_reason_get_v31 (uint8_t reason_v31);
 uint8_t rrr_mqtt_p_translate_reason_from_v5 (uint8_t v5_reason);
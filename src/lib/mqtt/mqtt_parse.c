@@ -992,20 +992,25 @@ int rrr_mqtt_parse_publish (struct rrr_mqtt_parse_session *session) {
 		return RRR_MQTT_SOFT_ERROR;
 	}
 
-	// PARSE TOPIC
-	PARSE_UTF8(publish,topic,1,topic);
-
-	if (rrr_mqtt_topic_validate_name(publish->topic) != 0) {
-		RRR_MSG_0("Invalid topic name '%s' in received PUBLISH packet, it will be rejected\n",
-				publish->topic);
-		return RRR_MQTT_SOFT_ERROR;
-	}
+	// PARSE TOPIC. With V5, the topic may be empty when a topic alias is used in
+	// which case the topic is resolved and validated after the properties are parsed.
+	PARSE_UTF8(publish,topic,(PARSE_CHECK_V5(publish) ? 0 : 1),topic);
 
 	// If previous parse was incomplete, free the tree
 	rrr_mqtt_topic_token_destroy(publish->token_tree_);
-	if (rrr_mqtt_topic_tokenize(&publish->token_tree_, publish->topic) != 0) {
-		RRR_MSG_0("Could not create topic token tree in %s\n", __func__);
-		return RRR_MQTT_INTERNAL_ERROR;
+	publish->token_tree_ = NULL;
+
+	if (*(publish->topic) != '\0') {
+		if (rrr_mqtt_topic_validate_name(publish->topic) != 0) {
+			RRR_MSG_0("Invalid topic name '%s' in received PUBLISH packet, it will be rejected\n",
+					publish->topic);
+			return RRR_MQTT_SOFT_ERROR;
+		}
+
+		if (rrr_mqtt_topic_tokenize(&publish->token_tree_, publish->topic) != 0) {
+			RRR_MSG_0("Could not create topic token tree in %s\n", __func__);
+			return RRR_MQTT_INTERNAL_ERROR;
+		}
 	}
 
 	if (RRR_MQTT_P_PUBLISH_GET_FLAG_QOS(publish) > 0) {
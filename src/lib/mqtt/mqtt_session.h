@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 // These headers for submodules should only include declaration of their new collection function
 #include "mqtt_session_ram.h"
+#include "mqtt_session_locked.h"
 
 struct rrr_mqtt_p;
 struct rrr_mqtt_p_publish;
@@ -0,0 +1,407 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <pthread.h>
+
+#include "../log.h"
+#include "../allocator.h"
+
+#include "mqtt_session_locked.h"
+#include "mqtt_session.h"
+#include "mqtt_packet.h"
+
+#include "../fifo.h"
+#include "../util/posix.h"
+
+// The session collection is shared between the connection threads of the
+// broker. Methods may call back into the connection framework which again
+// may call other methods, the lock is therefore recursive.
+//
+// Packets to send are collected while the lock is held and passed to the
+// send callbacks after it is released, writing to a connection should not
+// stall the other threads.
+
+// Iteration of the send queue stops when this many packets are collected,
+// it is resumed after they are sent unless the send callback asks to stop.
+#define LOCKED_SEND_BATCH_SIZE 64
+
+struct rrr_mqtt_session_collection_locked {
+	RRR_MQTT_SESSION_COLLECTION_HEAD;
+	pthread_mutex_t lock;
+	struct rrr_mqtt_session_collection *inner;
+};
+
+#define LOCKED_DEFINE                                                                                  \
+    struct rrr_mqtt_session_collection_locked *locked = (struct rrr_mqtt_session_collection_locked *) collection
+
+#define LOCKED_CALL(method, ...)                                                                       \
+    do {                                                                                               \
+        pthread_mutex_lock(&locked->lock);                                                             \
+        ret = locked->inner->methods->method(__VA_ARGS__);                                             \
+        pthread_mutex_unlock(&locked->lock);                                                           \
+    } while (0)
+
+struct rrr_mqtt_session_locked_send_batch {
+	struct rrr_mqtt_p **packets;
+	size_t count;
+	size_t size;
+};
+
+static void __rrr_mqtt_session_locked_send_batch_clear (
+		struct rrr_mqtt_session_locked_send_batch *batch
+) {
+	for (size_t i = 0; i < batch->count; i++) {
+		RRR_MQTT_P_DECREF(batch->packets[i]);
+	}
+	batch->count = 0;
+}
+
+static int __rrr_mqtt_session_locked_send_batch_collect_callback (
+		struct rrr_mqtt_p *packet,
+		void *arg
+) {
+	struct rrr_mqtt_session_locked_send_batch *batch = arg;
+
+	if (batch->count == batch->size) {
+		const size_t size_new = batch->size + LOCKED_SEND_BATCH_SIZE;
+		struct rrr_mqtt_p **packets_new = rrr_reallocate(batch->packets, sizeof(*packets_new) * size_new);
+		if (packets_new == NULL) {
+			RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+			return RRR_FIFO_GLOBAL_ERR;
+		}
+		batch->packets = packets_new;
+		batch->size = size_new;
+	}
+
+	RRR_MQTT_P_INCREF(packet);
+	batch->packets[batch->count++] = packet;
+
+	return batch->count >= LOCKED_SEND_BATCH_SIZE ? RRR_FIFO_SEARCH_STOP : RRR_FIFO_OK;
+}
+
+static int __rrr_mqtt_session_collection_locked_get_stats (
+		struct rrr_mqtt_session_collection_stats *target,
+		struct rrr_mqtt_session_collection *collection
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(get_stats, target, locked->inner);
+	return ret;
+}
+
+static int __rrr_mqtt_session_collection_locked_iterate_and_clear_local_delivery (
+		struct rrr_mqtt_session_collection *collection,
+		void (*callback)(struct rrr_mqtt_p_publish *publish, void *arg),
+		void *callback_arg
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(iterate_and_clear_local_delivery, locked->inner, callback, callback_arg);
+	return ret;
+}
+
+static int __rrr_mqtt_session_collection_locked_maintain_expiration (
+		struct rrr_mqtt_session_collection *collection
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(maintain_expiration, locked->inner);
+	return ret;
+}
+
+static void __rrr_mqtt_session_collection_locked_destroy (
+		struct rrr_mqtt_session_collection *collection
+) {
+	LOCKED_DEFINE;
+	locked->inner->methods->destroy(locked->inner);
+	pthread_mutex_destroy(&locked->lock);
+	rrr_mqtt_session_collection_destroy(collection);
+	rrr_free(locked);
+}
+
+static int __rrr_mqtt_session_collection_locked_get_session (
+		struct rrr_mqtt_session **target,
+		struct rrr_mqtt_session_collection *collection,
+		const char *client_id,
+		short *session_was_present,
+		short no_creation
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(get_session, target, locked->inner, client_id, session_was_present, no_creation);
+	return ret;
+}
+
+static void __rrr_mqtt_session_collection_locked_register_callbacks (
+		struct rrr_mqtt_session_collection *collection,
+		void (*publish_notify_callback)(RRR_MQTT_SESSION_PUBLISH_NOTIFY_ARGS),
+		void *arg
+) {
+	LOCKED_DEFINE;
+	pthread_mutex_lock(&locked->lock);
+	locked->inner->methods->register_callbacks(locked->inner, publish_notify_callback, arg);
+	pthread_mutex_unlock(&locked->lock);
+}
+
+static int __rrr_mqtt_session_locked_init (
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session_to_find,
+		const struct rrr_mqtt_session_properties *session_properties,
+		uint64_t retry_interval_usec,
+		uint32_t max_in_flight,
+		uint32_t complete_publish_grace_time,
+		short clean_session
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(init_session, locked->inner, session_to_find, session_properties,
+			retry_interval_usec, max_in_flight, complete_publish_grace_time, clean_session);
+	return ret;
+}
+
+static int __rrr_mqtt_session_locked_clean (
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(clean_session, locked->inner, session);
+	return ret;
+}
+
+static int __rrr_mqtt_session_locked_update_properties (
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session,
+		const struct rrr_mqtt_session_properties *properties,
+		const struct rrr_mqtt_session_properties_numbers *numbers_to_update,
+		short is_v5
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(update_properties, locked->inner, session, properties, numbers_to_update, is_v5);
+	return ret;
+}
+
+static int __rrr_mqtt_session_locked_get_properties (
+		struct rrr_mqtt_session_properties *target,
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(get_properties, target, locked->inner, session);
+	return ret;
+}
+
+static int __rrr_mqtt_session_locked_heartbeat (
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(heartbeat, locked->inner, session);
+	return ret;
+}
+
+static int __rrr_mqtt_session_locked_iterate_send_queue (
+		struct rrr_mqtt_session_iterate_send_queue_counters *counters,
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session_to_find,
+		int (*callback)(struct rrr_mqtt_p *packet, void *arg),
+		void *callback_arg
+) {
+	LOCKED_DEFINE;
+	int ret;
+
+	struct rrr_mqtt_session_locked_send_batch batch = {0};
+
+	int do_stop = 0;
+	do {
+		LOCKED_CALL(iterate_send_queue, counters, locked->inner, session_to_find,
+				__rrr_mqtt_session_locked_send_batch_collect_callback, &batch);
+
+		// Collected packets are already marked as sent, try to send
+		// them also if the session reported an error
+		const int do_continue = batch.count >= LOCKED_SEND_BATCH_SIZE;
+
+		for (size_t i = 0; i < batch.count; i++) {
+			const int ret_tmp = callback(batch.packets[i], callback_arg);
+			if ((ret_tmp & RRR_FIFO_GLOBAL_ERR) != 0) {
+				RRR_MSG_0("Internal error from callback in %s, return was %i\n", __func__, ret_tmp);
+				__rrr_mqtt_session_locked_send_batch_clear(&batch);
+				ret |= RRR_MQTT_SESSION_INTERNAL_ERROR;
+				goto out;
+			}
+			else if ((ret_tmp & RRR_FIFO_CALLBACK_ERR) != 0) {
+				RRR_MSG_0("Soft error from callback in %s, return was %i\n", __func__, ret_tmp);
+				__rrr_mqtt_session_locked_send_batch_clear(&batch);
+				ret |= RRR_MQTT_SESSION_ERROR;
+				goto out;
+			}
+			else if ((ret_tmp & RRR_FIFO_SEARCH_STOP) != 0) {
+				do_stop = 1;
+			}
+		}
+
+		__rrr_mqtt_session_locked_send_batch_clear(&batch);
+
+		if (ret != 0 || !do_continue) {
+			break;
+		}
+	} while (!do_stop);
+
+	out:
+	RRR_FREE_IF_NOT_NULL(batch.packets);
+	return ret;
+}
+
+static int __rrr_mqtt_session_locked_notify_disconnect (
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session,
+		uint8_t reason_v5
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(notify_disconnect, locked->inner, session, reason_v5);
+	return ret;
+}
+
+static int __rrr_mqtt_session_locked_send_packet_queue (
+		rrr_length *total_send_queue_count,
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session,
+		struct rrr_mqtt_p *packet
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(send_packet_queue, total_send_queue_count, locked->inner, session, packet);
+	return ret;
+}
+
+static int __rrr_mqtt_session_locked_send_packet_now (
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session,
+		struct rrr_mqtt_p *packet,
+		int (*send_now_callback)(struct rrr_mqtt_p *packet, void *arg),
+		void *send_now_callback_arg
+) {
+	LOCKED_DEFINE;
+	int ret;
+
+	struct rrr_mqtt_session_locked_send_batch batch = {0};
+
+	LOCKED_CALL(send_packet_now, locked->inner, session, packet,
+			__rrr_mqtt_session_locked_send_batch_collect_callback, &batch);
+
+	for (size_t i = 0; i < batch.count && ret == 0; i++) {
+		if ((ret = send_now_callback(batch.packets[i], send_now_callback_arg)) != 0) {
+			RRR_MSG_0("Send now callback failed in %s\n", __func__);
+		}
+	}
+
+	__rrr_mqtt_session_locked_send_batch_clear(&batch);
+	RRR_FREE_IF_NOT_NULL(batch.packets);
+
+	return ret;
+}
+
+static int __rrr_mqtt_session_locked_receive_packet (
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session,
+		struct rrr_mqtt_p *packet,
+		unsigned int *ack_match_count
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(receive_packet, locked->inner, session, packet, ack_match_count);
+	return ret;
+}
+
+static int __rrr_mqtt_session_locked_register_will_publish (
+		struct rrr_mqtt_session_collection *collection,
+		struct rrr_mqtt_session **session,
+		struct rrr_mqtt_p_publish *publish
+) {
+	LOCKED_DEFINE;
+	int ret;
+	LOCKED_CALL(register_will_publish, locked->inner, session, publish);
+	return ret;
+}
+
+static const struct rrr_mqtt_session_collection_methods locked_methods = {
+		__rrr_mqtt_session_collection_locked_get_stats,
+		__rrr_mqtt_session_collection_locked_iterate_and_clear_local_delivery,
+		__rrr_mqtt_session_collection_locked_maintain_expiration,
+		__rrr_mqtt_session_collection_locked_destroy,
+		__rrr_mqtt_session_collection_locked_get_session,
+		__rrr_mqtt_session_collection_locked_register_callbacks,
+		__rrr_mqtt_session_locked_init,
+		__rrr_mqtt_session_locked_clean,
+		__rrr_mqtt_session_locked_update_properties,
+		__rrr_mqtt_session_locked_get_properties,
+		__rrr_mqtt_session_locked_heartbeat,
+		__rrr_mqtt_session_locked_iterate_send_queue,
+		__rrr_mqtt_session_locked_notify_disconnect,
+		__rrr_mqtt_session_locked_send_packet_queue,
+		__rrr_mqtt_session_locked_send_packet_now,
+		__rrr_mqtt_session_locked_receive_packet,
+		__rrr_mqtt_session_locked_register_will_publish
+};
+
+int rrr_mqtt_session_collection_locked_new (
+		struct rrr_mqtt_session_collection **sessions,
+		struct rrr_mqtt_session_collection *inner
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_session_collection_locked *locked = NULL;
+
+	if ((locked = rrr_allocate_zero(sizeof(*locked))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	if (rrr_mqtt_session_collection_init (
+			(struct rrr_mqtt_session_collection *) locked,
+			&locked_methods
+	) != 0) {
+		RRR_MSG_0("Could not initialize session collection in %s\n", __func__);
+		ret = 1;
+		goto out_free;
+	}
+
+	if (rrr_posix_mutex_init(&locked->lock, RRR_POSIX_MUTEX_IS_RECURSIVE) != 0) {
+		RRR_MSG_0("Could not initialize lock in %s\n", __func__);
+		ret = 1;
+		goto out_free;
+	}
+
+	locked->inner = inner;
+
+	*sessions = (struct rrr_mqtt_session_collection *) locked;
+
+	goto out;
+	out_free:
+		rrr_free(locked);
+	out:
+		return ret;
+}
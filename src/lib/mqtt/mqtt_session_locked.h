@@ -0,0 +1,34 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RRR_MQTT_SESSION_LOCKED_H
+#define RRR_MQTT_SESSION_LOCKED_H
+
+struct rrr_mqtt_session_collection;
+
+// Wrap a session collection so that all methods are called with a lock held. The
+// wrapper takes ownership of the inner collection and destroys it when destroyed.
+int rrr_mqtt_session_collection_locked_new (
+		struct rrr_mqtt_session_collection **sessions,
+		struct rrr_mqtt_session_collection *inner
+);
+
+#endif /* RRR_MQTT_SESSION_LOCKED_H */
@@ -31,6 +31,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "mqtt_packet.h"
 #include "mqtt_payload.h"
 #include "mqtt_subscription.h"
+#include "mqtt_subscription_index.h"
+#include "mqtt_session_store.h"
 #include "mqtt_common.h"
 #include "mqtt_id_pool.h"
 
@@ -38,14 +40,28 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/linked_list.h"
 #include "../util/macro_utils.h"
 #include "../util/posix.h"
+#include "../util/hash.h"
 #include "../fifo.h"
 
 #define RRR_MQTT_SESSION_RAM_MAINTAIN_INTERVAL_MS             250
 #define RRR_MQTT_SESSION_RAM_PUBLISH_GRACE_QUEUE_INTERVAL_MS  250
 #define RRR_MQTT_SESSION_RAM_HARD_TIMEOUT_MS                  (RRR_MQTT_COMMON_TICK_INTERVAL_S * 1000 * 2)
 
+// When the queue to remote of a stored session holds this many packets,
+// further QoS 1 and 2 PUBLISH are kept in the session store only and
+// read back as the queue is drained
+#define RRR_MQTT_SESSION_RAM_STORE_QUEUE_MAX                  512
+
 struct rrr_mqtt_session_collection_ram_data;
 
+// Offsets in the session store of paged out PUBLISH, oldest first
+struct rrr_mqtt_session_ram_paged {
+	rrr_biglength *offsets;
+	rrr_length first;
+	rrr_length count;
+	rrr_length size;
+};
+
 struct rrr_mqtt_session_ram {
 	// MUST be first
 	struct rrr_mqtt_session session;
@@ -74,6 +90,14 @@ struct rrr_mqtt_session_ram {
 	uint32_t complete_publish_grace_time_s;
 	struct rrr_mqtt_subscription_collection *subscriptions;
 	struct rrr_mqtt_p_publish *will_publish;
+
+	// Set when the session has been written to the session store
+	short is_stored;
+
+	// PUBLISH queued after those in the queue to remote, and their
+	// offsets in a new log while the store is being rewritten
+	struct rrr_mqtt_session_ram_paged paged;
+	struct rrr_mqtt_session_ram_paged paged_rewrite;
 };
 
 #define RRR_MQTT_SESSION_RAM_DELIVERY_METHOD_ARGS \
@@ -106,6 +130,20 @@ struct rrr_mqtt_session_collection_ram_data {
 
 	// Should be updated using provided functions to avoid difficult to find bugs
 	struct rrr_mqtt_session_collection_stats stats;
+
+	// Lookup of sessions by pointer value and by client ID. Sessions without
+	// client ID are only present in the pointer map.
+	struct rrr_hash sessions_by_ptr;
+	struct rrr_hash sessions_by_client_id;
+
+	// Subscriptions of all sessions, used by broker to find recipients
+	// of a PUBLISH. NULL for clients.
+	struct rrr_mqtt_subscription_index *subscription_index;
+
+	// Persistent storage of sessions, queued QoS 1 and 2 PUBLISH and
+	// retained PUBLISH. NULL when not configured.
+	struct rrr_mqtt_session_store *store;
+	uint64_t store_sequence;
 };
 
 #define SESSION_RAM_INCREF_OR_RETURN() \
@@ -216,6 +254,395 @@ static int __rrr_mqtt_session_collection_ram_get_stats (
 	return 0;
 }
 
+static int __rrr_mqtt_session_ram_paged_push (
+		struct rrr_mqtt_session_ram_paged *paged,
+		rrr_biglength offset
+) {
+	if (paged->first + paged->count == paged->size) {
+		// Move entries to the beginning if at least half of the array
+		// is unused, otherwise grow the array
+		if (paged->first >= paged->size / 2 && paged->first > 0) {
+			memmove(paged->offsets, paged->offsets + paged->first, sizeof(*(paged->offsets)) * paged->count);
+			paged->first = 0;
+		}
+		else {
+			if (paged->size > RRR_LENGTH_MAX / 2) {
+				RRR_MSG_0("Too many paged PUBLISH in %s\n", __func__);
+				return 1;
+			}
+
+			const rrr_length size_new = paged->size == 0 ? 64 : paged->size * 2;
+
+			rrr_biglength *offsets_new = rrr_reallocate(paged->offsets, sizeof(*offsets_new) * size_new);
+			if (offsets_new == NULL) {
+				RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+				return 1;
+			}
+
+			paged->offsets = offsets_new;
+			paged->size = size_new;
+		}
+	}
+
+	paged->offsets[paged->first + paged->count] = offset;
+	paged->count++;
+
+	return 0;
+}
+
+static void __rrr_mqtt_session_ram_paged_pop (
+		struct rrr_mqtt_session_ram_paged *paged
+) {
+	paged->first++;
+	if (--(paged->count) == 0) {
+		paged->first = 0;
+	}
+}
+
+static void __rrr_mqtt_session_ram_paged_clear (
+		struct rrr_mqtt_session_ram_paged *paged
+) {
+	RRR_FREE_IF_NOT_NULL(paged->offsets);
+	memset(paged, '\0', sizeof(*paged));
+}
+
+static int __rrr_mqtt_session_ram_is_registered (
+		struct rrr_mqtt_session_ram *session
+) {
+	return rrr_hash_get_ptr(&session->ram_data->sessions_by_ptr, session) == session;
+}
+
+static int __rrr_mqtt_session_collection_ram_store_append (
+		struct rrr_mqtt_session_collection_ram_data *data,
+		uint8_t type,
+		struct rrr_mqtt_session_store_record *record
+) {
+	if (rrr_mqtt_session_store_append(data->store, type, record) != 0) {
+		RRR_MSG_0("Failed to write record of type %u to MQTT session store\n", type);
+		return RRR_MQTT_SESSION_INTERNAL_ERROR;
+	}
+	return RRR_MQTT_SESSION_OK;
+}
+
+static int __rrr_mqtt_session_ram_store_session_delete (
+		struct rrr_mqtt_session_ram *session
+) {
+	struct rrr_mqtt_session_collection_ram_data *data = session->ram_data;
+
+	int ret = RRR_MQTT_SESSION_OK;
+
+	struct rrr_mqtt_session_store_record record = {0};
+
+	if (data->store == NULL || !session->is_stored) {
+		goto out;
+	}
+
+	if (rrr_mqtt_session_store_record_push_str(&record, session->client_id_) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out;
+	}
+
+	if ((ret = __rrr_mqtt_session_collection_ram_store_append (
+			data,
+			RRR_MQTT_SESSION_STORE_RECORD_SESSION_DELETE,
+			&record
+	)) != 0) {
+		goto out;
+	}
+
+	session->is_stored = 0;
+
+	out:
+	rrr_mqtt_session_store_record_clear(&record);
+	return ret;
+}
+
+// Must be called after changes to subscriptions or expiry of a session
+static int __rrr_mqtt_session_ram_store_session (
+		struct rrr_mqtt_session_ram *session
+) {
+	struct rrr_mqtt_session_collection_ram_data *data = session->ram_data;
+
+	int ret = RRR_MQTT_SESSION_OK;
+
+	struct rrr_mqtt_session_store_record record = {0};
+
+	if ( data->store == NULL ||
+	     session->client_id_ == NULL ||
+	     !__rrr_mqtt_session_ram_is_registered(session)
+	) {
+		goto out;
+	}
+
+	// Sessions which end upon disconnect are not stored
+	if (session->session_properties.numbers.session_expiry == 0) {
+		ret = __rrr_mqtt_session_ram_store_session_delete(session);
+		goto out;
+	}
+
+	if ( rrr_mqtt_session_store_record_push_str(&record, session->client_id_) != 0 ||
+	     rrr_mqtt_session_store_record_push_u32(&record, session->session_properties.numbers.session_expiry) != 0 ||
+	     rrr_mqtt_session_store_record_push_u64(&record, session->expire_time) != 0 ||
+	     rrr_mqtt_session_store_record_push_subscriptions(&record, session->subscriptions) != 0
+	) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out;
+	}
+
+	if ((ret = __rrr_mqtt_session_collection_ram_store_append (
+			data,
+			RRR_MQTT_SESSION_STORE_RECORD_SESSION,
+			&record
+	)) != 0) {
+		goto out;
+	}
+
+	session->is_stored = 1;
+
+	out:
+	rrr_mqtt_session_store_record_clear(&record);
+	return ret;
+}
+
+static int __rrr_mqtt_session_ram_store_publish_with_sequence (
+		rrr_biglength *offset,
+		struct rrr_mqtt_session_ram *session,
+		const struct rrr_mqtt_p_publish *publish
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	struct rrr_mqtt_session_store_record record = {0};
+
+	if ( rrr_mqtt_session_store_record_push_u64(&record, publish->store_sequence) != 0 ||
+	     rrr_mqtt_session_store_record_push_str(&record, session->client_id_) != 0 ||
+	     rrr_mqtt_session_store_record_push_publish(&record, publish) != 0
+	) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out;
+	}
+
+	if (rrr_mqtt_session_store_append_with_offset (
+			offset,
+			session->ram_data->store,
+			RRR_MQTT_SESSION_STORE_RECORD_PUBLISH,
+			&record
+	) != 0) {
+		RRR_MSG_0("Failed to write PUBLISH record to MQTT session store\n");
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out;
+	}
+
+	out:
+	rrr_mqtt_session_store_record_clear(&record);
+	return ret;
+}
+
+// Store outbound PUBLISH queued in a stored session. A record
+// of completion is written when the PUBLISH has been acknowledged.
+static int __rrr_mqtt_session_ram_store_publish (
+		struct rrr_mqtt_session_ram *session,
+		struct rrr_mqtt_p_publish *publish
+) {
+	if ( session->ram_data->store == NULL ||
+	     !session->is_stored ||
+	     RRR_MQTT_P_PUBLISH_GET_FLAG_QOS(publish) == 0
+	) {
+		return RRR_MQTT_SESSION_OK;
+	}
+
+	publish->store_sequence = ++(session->ram_data->store_sequence);
+
+	rrr_biglength offset_dummy;
+	return __rrr_mqtt_session_ram_store_publish_with_sequence(&offset_dummy, session, publish);
+}
+
+static int __rrr_mqtt_session_ram_store_page_out_needed (
+		struct rrr_mqtt_session_ram *session,
+		const struct rrr_mqtt_p_publish *publish
+) {
+	// Once paging has started, all PUBLISH are paged to preserve ordering
+	return session->ram_data->store != NULL &&
+	       session->is_stored &&
+	       RRR_MQTT_P_PUBLISH_GET_FLAG_QOS(publish) != 0 &&
+	       ( session->paged.count > 0 ||
+	         rrr_fifo_get_entry_count(&session->to_remote_buffer.buffer) >= RRR_MQTT_SESSION_RAM_STORE_QUEUE_MAX
+	       );
+}
+
+// The PUBLISH is not kept in memory, only its offset in the log
+static int __rrr_mqtt_session_ram_store_publish_paged (
+		struct rrr_mqtt_session_ram *session,
+		struct rrr_mqtt_p_publish *publish
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	rrr_biglength offset;
+
+	publish->store_sequence = ++(session->ram_data->store_sequence);
+
+	if ((ret = __rrr_mqtt_session_ram_store_publish_with_sequence(&offset, session, publish)) != 0) {
+		goto out;
+	}
+
+	if (__rrr_mqtt_session_ram_paged_push(&session->paged, offset) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out;
+	}
+
+	out:
+	return ret;
+}
+
+static int __rrr_mqtt_session_ram_store_paged_read_callback (
+		RRR_MQTT_SESSION_STORE_REPLAY_CALLBACK_ARGS
+) {
+	struct rrr_mqtt_p_publish **target = arg;
+
+	int ret = RRR_MQTT_SESSION_OK;
+
+	char *client_id = NULL;
+	struct rrr_mqtt_p_publish *publish = NULL;
+	uint64_t sequence = 0;
+
+	if ( type != RRR_MQTT_SESSION_STORE_RECORD_PUBLISH ||
+	     rrr_mqtt_session_store_reader_get_u64(&sequence, reader) != 0 ||
+	     rrr_mqtt_session_store_reader_get_str(&client_id, reader) != 0 ||
+	     rrr_mqtt_session_store_reader_get_publish(&publish, reader) != 0
+	) {
+		RRR_MSG_0("Invalid record of type %u at offset %" PRIrrrbl " for paged PUBLISH in MQTT session store\n",
+				type, offset);
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out;
+	}
+
+	publish->store_sequence = sequence;
+	publish->is_outbound = 1;
+
+	*target = publish;
+	publish = NULL;
+
+	out:
+	RRR_FREE_IF_NOT_NULL(client_id);
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish);
+	return ret;
+}
+
+static int __rrr_mqtt_session_ram_store_paged_read (
+		struct rrr_mqtt_p_publish **target,
+		struct rrr_mqtt_session_ram *session,
+		rrr_length pos
+) {
+	*target = NULL;
+
+	if (rrr_mqtt_session_store_read (
+			session->ram_data->store,
+			session->paged.offsets[session->paged.first + pos],
+			__rrr_mqtt_session_ram_store_paged_read_callback,
+			target
+	) != 0) {
+		RRR_MSG_0("Failed to read paged PUBLISH for client %s from MQTT session store\n", session->client_id_);
+		return RRR_MQTT_SESSION_INTERNAL_ERROR;
+	}
+
+	return RRR_MQTT_SESSION_OK;
+}
+
+// Read paged PUBLISH back into the queue to remote as it is drained
+static int __rrr_mqtt_session_ram_store_page_in (
+		struct rrr_mqtt_session_ram *session
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	struct rrr_mqtt_p_publish *publish = NULL;
+
+	while ( session->paged.count > 0 &&
+	        rrr_fifo_get_entry_count(&session->to_remote_buffer.buffer) < RRR_MQTT_SESSION_RAM_STORE_QUEUE_MAX
+	) {
+		if ((ret = __rrr_mqtt_session_ram_store_paged_read(&publish, session, 0)) != 0) {
+			goto out;
+		}
+
+		if (__rrr_mqtt_session_ram_fifo_write_simple (
+				&session->to_remote_buffer.buffer,
+				(struct rrr_mqtt_p *) publish
+		) != 0) {
+			RRR_MSG_0("Could not write to to_remote_queue in %s\n", __func__);
+			ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+			goto out;
+		}
+
+		RRR_MQTT_P_DECREF(publish);
+		publish = NULL;
+
+		__rrr_mqtt_session_ram_paged_pop(&session->paged);
+	}
+
+	out:
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish);
+	return ret;
+}
+
+static int __rrr_mqtt_session_collection_ram_store_ack (
+		struct rrr_mqtt_session_collection_ram_data *data,
+		struct rrr_mqtt_p_publish *publish
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	struct rrr_mqtt_session_store_record record = {0};
+
+	if (data->store == NULL || publish->store_sequence == 0) {
+		goto out;
+	}
+
+	if (rrr_mqtt_session_store_record_push_u64(&record, publish->store_sequence) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out;
+	}
+
+	if ((ret = __rrr_mqtt_session_collection_ram_store_append (
+			data,
+			RRR_MQTT_SESSION_STORE_RECORD_ACK,
+			&record
+	)) != 0) {
+		goto out;
+	}
+
+	publish->store_sequence = 0;
+
+	out:
+	rrr_mqtt_session_store_record_clear(&record);
+	return ret;
+}
+
+// A zero-byte payload deletes the retained PUBLISH also upon replay
+static int __rrr_mqtt_session_collection_ram_store_retain (
+		struct rrr_mqtt_session_collection_ram_data *data,
+		const struct rrr_mqtt_p_publish *publish
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	struct rrr_mqtt_session_store_record record = {0};
+
+	if (data->store == NULL) {
+		goto out;
+	}
+
+	if (rrr_mqtt_session_store_record_push_publish(&record, publish) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out;
+	}
+
+	ret = __rrr_mqtt_session_collection_ram_store_append (
+			data,
+			RRR_MQTT_SESSION_STORE_RECORD_RETAIN,
+			&record
+	);
+
+	out:
+	rrr_mqtt_session_store_record_clear(&record);
+	return ret;
+}
+
 struct mqtt_session_ram_retain_buffer_insert_callback_data {
 	struct rrr_mqtt_p_publish *publish;
 	int is_zero_byte_payload;
@@ -292,6 +719,7 @@ static int __rrr_mqtt_session_ram_retain_buffer_write_callback (
 
 struct receive_forwarded_publish_data {
 	struct rrr_mqtt_session_ram *session;
+	struct rrr_mqtt_p_publish_encoded **encoded;
 };
 
 static int __rrr_mqtt_session_ram_receive_forwarded_publish_match_callback (
@@ -323,6 +751,20 @@ static int __rrr_mqtt_session_ram_receive_forwarded_publish_match_callback (
 		goto out;
 	}
 
+	// Assemble topic and properties once and share them between all
+	// copies. Properties of packets with expiry interval are modified
+	// later and can't be shared.
+	if (new_publish->encoded == NULL && new_publish->message_expiry_interval == 0) {
+		if (*callback_data->encoded == NULL && rrr_mqtt_p_publish_encoded_new (
+				callback_data->encoded,
+				publish
+		) != 0) {
+			ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+			goto out;
+		}
+		rrr_mqtt_p_publish_encoded_set(new_publish, *callback_data->encoded);
+	}
+
 	// Always clear retain flag per specification
 	RRR_MQTT_P_PUBLISH_SET_FLAG_RETAIN(new_publish, 0);
 
@@ -347,6 +789,11 @@ static int __rrr_mqtt_session_ram_receive_forwarded_publish_match_callback (
 
 	new_publish->is_outbound = 1;
 
+	if (__rrr_mqtt_session_ram_store_page_out_needed(session, new_publish)) {
+		ret = __rrr_mqtt_session_ram_store_publish_paged(session, new_publish);
+		goto out;
+	}
+
 	if (__rrr_mqtt_session_ram_fifo_write_simple (
 			&session->to_remote_buffer.buffer,
 			(struct rrr_mqtt_p *) new_publish
@@ -356,39 +803,28 @@ static int __rrr_mqtt_session_ram_receive_forwarded_publish_match_callback (
 		goto out;
 	}
 
+	if ((ret = __rrr_mqtt_session_ram_store_publish(session, new_publish)) != 0) {
+		goto out;
+	}
+
 	out:
 	RRR_MQTT_P_DECREF_IF_NOT_NULL(new_publish);
 	return ret;
 }
 
-static int __rrr_mqtt_session_ram_receive_forwarded_publish (
-		struct rrr_mqtt_session_ram *ram_session,
+static int __rrr_mqtt_session_ram_receive_forwarded_publish_index_match_callback (
 		const struct rrr_mqtt_p_publish *publish,
-		rrr_length *match_count
+		const struct rrr_mqtt_subscription *subscription,
+		void *owner,
+		void *arg
 ) {
-	int ret = RRR_MQTT_SESSION_OK;
+	struct receive_forwarded_publish_data callback_data = { owner, arg };
 
-	struct receive_forwarded_publish_data callback_data = { ram_session };
-
-	// Note : We always send one PUBLISH per matching subscription and do
-	//        not check for overlaps. Other brokers might treat this different
-	//        and only send one PUBLISH. The different methods comply with
-	//        the standards (both V3.1.1 and V5), but the method here is the
-	//        least complex to implement.
-
-	if ((ret = rrr_mqtt_subscription_collection_match_publish_with_callback (
-			ram_session->subscriptions,
+	return __rrr_mqtt_session_ram_receive_forwarded_publish_match_callback (
 			publish,
-			__rrr_mqtt_session_ram_receive_forwarded_publish_match_callback,
-			&callback_data,
-			match_count
-	)) != RRR_MQTT_SUBSCRIPTION_OK) {
-		RRR_MSG_0("Error while matching publish packet against subscriptions in %s, return was %i\n",
-				__func__, ret);
-		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
-	}
-
-	return ret;
+			subscription,
+			&callback_data
+	);
 }
 
 static int __rrr_mqtt_session_collection_ram_forward_publish_to_clients (
@@ -398,18 +834,24 @@ static int __rrr_mqtt_session_collection_ram_forward_publish_to_clients (
 	int ret = RRR_FIFO_OK;
 
 	rrr_length total_match_count = 0;
+	struct rrr_mqtt_p_publish_encoded *encoded = NULL;
 
-	RRR_LL_ITERATE_BEGIN(ram_data, struct rrr_mqtt_session_ram);
-		rrr_length match_count = 0;
-		int ret_tmp = __rrr_mqtt_session_ram_receive_forwarded_publish(node, publish, &match_count);
-		total_match_count += match_count;
+	// Note : We always send one PUBLISH per matching subscription and do
+	//        not check for overlaps. Other brokers might treat this different
+	//        and only send one PUBLISH. The different methods comply with
+	//        the standards (both V3.1.1 and V5), but the method here is the
+	//        least complex to implement.
 
-		if (ret_tmp != RRR_MQTT_SESSION_OK) {
-			RRR_MSG_0("Error while receiving forwarded publish message, return was %i\n", ret);
-			ret |= RRR_FIFO_GLOBAL_ERR;
-			RRR_LL_ITERATE_LAST();
-		}
-	RRR_LL_ITERATE_END();
+	if (rrr_mqtt_subscription_index_match_publish_with_callback (
+			ram_data->subscription_index,
+			publish,
+			__rrr_mqtt_session_ram_receive_forwarded_publish_index_match_callback,
+			&encoded,
+			&total_match_count
+	) != RRR_MQTT_SUBSCRIPTION_OK) {
+		RRR_MSG_0("Error while matching publish packet against subscriptions in %s\n", __func__);
+		ret |= RRR_FIFO_GLOBAL_ERR;
+	}
 
 	if (total_match_count == 0) {
 		__rrr_mqtt_session_collection_ram_stats_notify_not_forwarded(ram_data);
@@ -418,43 +860,58 @@ static int __rrr_mqtt_session_collection_ram_forward_publish_to_clients (
 		__rrr_mqtt_session_collection_ram_stats_notify_forwarded(ram_data, total_match_count);
 	}
 
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(encoded);
+
 	return ret;
 }
 
-static int __rrr_mqtt_session_collection_ram_delivery_forward_final (
+static int __rrr_mqtt_session_collection_ram_retain_buffer_update (
 		struct rrr_mqtt_session_collection_ram_data *ram_data,
 		struct rrr_mqtt_p_publish *publish
 ) {
-	int ret = RRR_MQTT_SESSION_OK;
-
-	if (RRR_MQTT_P_PUBLISH_GET_FLAG_RETAIN(publish) != 0) {
-		int is_zero_byte_payload = 0;
+	int is_zero_byte_payload = 0;
 
-		// Zero-byte payload publishes will remove matching topics
-		// from retain queue and not forwarded
+	// Zero-byte payload publishes will remove matching topics
+	// from retain queue and not forwarded
 
-		if (publish->payload == NULL) {
+	if (publish->payload == NULL) {
+		is_zero_byte_payload = 1;
+	}
+	else {
+		if (publish->payload->size == 0) {
 			is_zero_byte_payload = 1;
 		}
-		else {
-			if (publish->payload->size == 0) {
-				is_zero_byte_payload = 1;
-			}
-		}
+	}
 
-		struct mqtt_session_ram_retain_buffer_insert_callback_data callback_data = {
-			publish,
-			is_zero_byte_payload
-		};
+	struct mqtt_session_ram_retain_buffer_insert_callback_data callback_data = {
+		publish,
+		is_zero_byte_payload
+	};
 
-		if (rrr_fifo_search_and_replace (
-				&ram_data->retain_buffer.buffer,
-				__rrr_mqtt_session_ram_retain_buffer_write_callback,
-				&callback_data,
-				1  // <-- Call callback again for potential write operation after looping
-		) != 0) {
-			RRR_MSG_0("Could not write to retain queue in %s\n", __func__);
-			ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+	if (rrr_fifo_search_and_replace (
+			&ram_data->retain_buffer.buffer,
+			__rrr_mqtt_session_ram_retain_buffer_write_callback,
+			&callback_data,
+			1  // <-- Call callback again for potential write operation after looping
+	) != 0) {
+		RRR_MSG_0("Could not write to retain queue in %s\n", __func__);
+		return RRR_MQTT_SESSION_INTERNAL_ERROR;
+	}
+
+	return RRR_MQTT_SESSION_OK;
+}
+
+static int __rrr_mqtt_session_collection_ram_delivery_forward_final (
+		struct rrr_mqtt_session_collection_ram_data *ram_data,
+		struct rrr_mqtt_p_publish *publish
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	if (RRR_MQTT_P_PUBLISH_GET_FLAG_RETAIN(publish) != 0) {
+		if ((ret = __rrr_mqtt_session_collection_ram_retain_buffer_update(ram_data, publish)) != 0) {
+			goto out;
+		}
+		if ((ret = __rrr_mqtt_session_collection_ram_store_retain(ram_data, publish)) != 0) {
 			goto out;
 		}
 	}
@@ -498,6 +955,9 @@ static int __rrr_mqtt_session_ram_update_publish_expiry_interval_properties (
 	const uint32_t diff_s = (uint32_t) ((rrr_time_get_64() - publish->create_time) / 1000 / 1000);
 	const uint32_t new_interval = diff_s >= old_interval ? 1 : old_interval - diff_s;
 
+	// Properties now differ from other copies of the PUBLISH
+	rrr_mqtt_p_publish_encoded_release(publish);
+
 	rrr_mqtt_property_collection_clear_by_id (&publish->properties, RRR_MQTT_PROPERTY_MESSAGE_EXPIRY_INTERVAL);
 	if (rrr_mqtt_property_collection_add_uint32 (
 			&publish->properties,
@@ -669,14 +1129,26 @@ static int __rrr_mqtt_session_collection_ram_create_and_add_session (
 	result->ram_data = data;
 	result->heartbeat_time = rrr_time_get_64();
 
+	if (rrr_hash_set_ptr(&data->sessions_by_ptr, result, result) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out_destroy_id_pool;
+	}
+
+	if (result->client_id_ != NULL && rrr_hash_set_str(&data->sessions_by_client_id, result->client_id_, result) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out_remove_ptr;
+	}
+
 	RRR_LL_UNSHIFT(data,result);
 
 	*target = result;
 
 	goto out;
 
-/*	out_destroy_id_pool:
-		rrr_mqtt_id_pool_destroy(&result->id_pool);*/
+	out_remove_ptr:
+		rrr_hash_remove_ptr(&data->sessions_by_ptr, result);
+	out_destroy_id_pool:
+		rrr_mqtt_id_pool_destroy(&result->id_pool);
 	out_destroy_subscriptions:
 		rrr_mqtt_subscription_collection_destroy(result->subscriptions);
 	out_free_client_id:
@@ -794,6 +1266,9 @@ static int __rrr_mqtt_session_ram_decref (
 	rrr_fifo_clear_with_callback(&session->from_remote_buffer.buffer, __rrr_mqtt_session_ram_packet_id_release_callback, NULL);
 	rrr_fifo_clear_with_callback(&session->publish_grace_buffer.buffer, __rrr_mqtt_session_ram_packet_id_release_callback, NULL);
 
+	__rrr_mqtt_session_ram_paged_clear(&session->paged);
+	__rrr_mqtt_session_ram_paged_clear(&session->paged_rewrite);
+
 	RRR_FREE_IF_NOT_NULL(session->client_id_);
 
 	rrr_mqtt_subscription_collection_destroy(session->subscriptions);
@@ -812,6 +1287,42 @@ static void __rrr_mqtt_session_ram_incref (struct rrr_mqtt_session_ram *session)
 	session->users++;
 }
 
+// Must be called after every change to the subscription collection of a session
+static int __rrr_mqtt_session_ram_subscription_index_update (
+		struct rrr_mqtt_session_ram *session
+) {
+	struct rrr_mqtt_subscription_index *index = session->ram_data->subscription_index;
+
+	// Sessions removed from the collection while in use must not be re-added
+	if (index == NULL || !__rrr_mqtt_session_ram_is_registered(session)) {
+		return RRR_MQTT_SESSION_OK;
+	}
+
+	if (rrr_mqtt_subscription_index_owner_update(index, session, session->subscriptions) != 0) {
+		RRR_MSG_0("Could not update subscription index in %s\n", __func__);
+		return RRR_MQTT_SESSION_INTERNAL_ERROR;
+	}
+
+	return RRR_MQTT_SESSION_OK;
+}
+
+// Call whenever a session is taken out of the collection list
+static void __rrr_mqtt_session_collection_ram_unregister (
+		struct rrr_mqtt_session_collection_ram_data *data,
+		struct rrr_mqtt_session_ram *session
+) {
+	// Failure is logged, the session is then recreated upon next startup
+	__rrr_mqtt_session_ram_store_session_delete(session);
+
+	if (data->subscription_index != NULL) {
+		rrr_mqtt_subscription_index_owner_remove(data->subscription_index, session);
+	}
+	if (session->client_id_ != NULL && rrr_hash_get_str(&data->sessions_by_client_id, session->client_id_) == session) {
+		rrr_hash_remove_str(&data->sessions_by_client_id, session->client_id_);
+	}
+	rrr_hash_remove_ptr(&data->sessions_by_ptr, session);
+}
+
 static void __rrr_mqtt_session_collection_remove (
 		struct rrr_mqtt_session_collection_ram_data *data,
 		struct rrr_mqtt_session_ram *session
@@ -820,6 +1331,7 @@ static void __rrr_mqtt_session_collection_remove (
 			data,
 			struct rrr_mqtt_session_ram,
 			session,
+			__rrr_mqtt_session_collection_ram_unregister(data, node);
 			__rrr_mqtt_session_ram_decref(node)
 	);
 
@@ -834,16 +1346,12 @@ static struct rrr_mqtt_session_ram *__rrr_mqtt_session_collection_ram_find_sessi
 ) {
 	struct rrr_mqtt_session_ram *result = NULL;
 
+	if (client_id != NULL && *client_id != '\0') {
+		return rrr_hash_get_str(&data->sessions_by_client_id, client_id);
+	}
+
 	RRR_LL_ITERATE_BEGIN(data, struct rrr_mqtt_session_ram);
-		if (client_id == NULL) {
-			if (node->client_id_ == NULL || *(node->client_id_) == '\0') {
-				result = node;
-			}
-		}
-		else if (strcmp(node->client_id_, client_id) == 0) {
-			if (result != NULL) {
-				RRR_BUG("Found two equal client ids in %s\n", __func__);
-			}
+		if (node->client_id_ == NULL || *(node->client_id_) == '\0') {
 			result = node;
 		}
 	RRR_LL_ITERATE_END();
@@ -915,15 +1423,11 @@ static struct rrr_mqtt_session_ram *__rrr_mqtt_session_collection_ram_session_fi
 		return NULL;
 	}
 
-	struct rrr_mqtt_session_ram *found = NULL;
+	struct rrr_mqtt_session_ram *found = rrr_hash_get_ptr(&data->sessions_by_ptr, session);
 
-	RRR_LL_ITERATE_BEGIN(data, struct rrr_mqtt_session_ram);
-		if ((void*) node == (void*) session) {
-			__rrr_mqtt_session_ram_incref(node);
-			found = node;
-			RRR_LL_ITERATE_LAST();
-		}
-	RRR_LL_ITERATE_END();
+	if (found != NULL) {
+		__rrr_mqtt_session_ram_incref(found);
+	}
 
 	return found;
 }
@@ -1053,77 +1557,301 @@ static int __rrr_mqtt_session_collection_iterate_and_clear_local_delivery_callba
 	struct iterate_local_delivery_callback_data *iterate_callback_data = arg;
 	struct rrr_mqtt_p_publish *publish = (struct rrr_mqtt_p_publish *) data;
 
-	if (RRR_MQTT_P_GET_TYPE(publish) != RRR_MQTT_P_TYPE_PUBLISH) {
-		RRR_BUG("Packet was not publish in %s\n", __func__);
+	if (RRR_MQTT_P_GET_TYPE(publish) != RRR_MQTT_P_TYPE_PUBLISH) {
+		RRR_BUG("Packet was not publish in %s\n", __func__);
+	}
+
+	iterate_callback_data->callback (
+			publish,
+			iterate_callback_data->callback_arg
+	);
+
+	return ret | RRR_FIFO_SEARCH_FREE;
+}
+
+
+static int __rrr_mqtt_session_collection_ram_iterate_and_clear_local_delivery (
+		struct rrr_mqtt_session_collection *sessions,
+		void (*callback)(struct rrr_mqtt_p_publish *publish, void *arg),
+		void *callback_arg
+) {
+	struct rrr_mqtt_session_collection_ram_data *data = (struct rrr_mqtt_session_collection_ram_data *) sessions;
+
+	int ret = RRR_MQTT_SESSION_OK;
+
+	struct iterate_local_delivery_callback_data iterate_callback_data = {
+			callback,
+			callback_arg
+	};
+
+	RRR_MQTT_COMMON_CALL_FIFO_CHECK_RETURN_TO_SESSION_ERRORS_GENERAL(
+			rrr_fifo_read_clear_forward_all (
+					&data->publish_local_buffer.buffer,
+					__rrr_mqtt_session_collection_iterate_and_clear_local_delivery_callback,
+					&iterate_callback_data
+			),
+			goto out,
+			" while iterating local delivery queue"
+	);
+
+	out:
+	return ret;
+}
+
+static int __rrr_mqtt_session_ram_iterate_publish_grace_callback (RRR_FIFO_READ_CALLBACK_ARGS) {
+	 struct rrr_mqtt_p *packet = (struct rrr_mqtt_p *) data;
+
+	(void)(size);
+
+	int *counter = arg;
+
+	int ret = RRR_FIFO_OK;
+
+	if (packet->planned_expiry_time == 0) {
+		RRR_BUG("BUG: Planned expiry not set in %s\n", __func__);
+	}
+	else if (packet->planned_expiry_time < rrr_time_get_64()) {
+		RRR_DBG_3("%s %p id %u grace time is complete, deleting from buffer.\n",
+			RRR_MQTT_P_GET_TYPE_NAME(packet),
+			packet,
+			RRR_MQTT_P_GET_IDENTIFIER(packet)
+		);
+		(*counter)++;
+		ret = RRR_FIFO_SEARCH_GIVE | RRR_FIFO_SEARCH_FREE;
+	}
+	else {
+		// If we encounter a packet which has not expired, it's unlikely that the rest
+		// of the packets are expired.
+		ret = RRR_FIFO_SEARCH_STOP;
+	}
+
+	return ret;
+}
+			
+static int __rrr_mqtt_session_collection_ram_store_rewrite_retain_callback (RRR_FIFO_READ_CALLBACK_ARGS) {
+	struct rrr_mqtt_session_collection_ram_data *ram_data = arg;
+	struct rrr_mqtt_p_publish *publish = (struct rrr_mqtt_p_publish *) data;
+
+	(void)(size);
+
+	if (__rrr_mqtt_session_ram_check_publish_expired(publish)) {
+		return RRR_FIFO_OK;
+	}
+
+	return __rrr_mqtt_session_collection_ram_store_retain(ram_data, publish) == 0 ? RRR_FIFO_OK : RRR_FIFO_GLOBAL_ERR;
+}
+
+static int __rrr_mqtt_session_ram_store_rewrite_publish_callback (RRR_FIFO_READ_CALLBACK_ARGS) {
+	struct rrr_mqtt_session_ram *session = arg;
+	struct rrr_mqtt_p_publish *publish = (struct rrr_mqtt_p_publish *) data;
+
+	(void)(size);
+
+	// Only store PUBLISH not yet acknowledged
+	if ( RRR_MQTT_P_GET_TYPE(publish) != RRR_MQTT_P_TYPE_PUBLISH ||
+	     publish->store_sequence == 0 ||
+	     (RRR_MQTT_P_PUBLISH_GET_FLAG_QOS(publish) == 1 && publish->qos_packets.puback != NULL) ||
+	     (RRR_MQTT_P_PUBLISH_GET_FLAG_QOS(publish) == 2 && publish->qos_packets.pubcomp != NULL)
+	) {
+		return RRR_FIFO_OK;
+	}
+
+	rrr_biglength offset_dummy;
+	return __rrr_mqtt_session_ram_store_publish_with_sequence(&offset_dummy, session, publish) == 0 ? RRR_FIFO_OK : RRR_FIFO_GLOBAL_ERR;
+}
+
+// Offsets in the new log are only used if the rewrite is committed
+static int __rrr_mqtt_session_ram_store_rewrite_paged (
+		struct rrr_mqtt_session_ram *session
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	struct rrr_mqtt_p_publish *publish = NULL;
+	rrr_biglength offset;
+
+	for (rrr_length i = 0; i < session->paged.count; i++) {
+		if ((ret = __rrr_mqtt_session_ram_store_paged_read(&publish, session, i)) != 0) {
+			goto out;
+		}
+
+		if ((ret = __rrr_mqtt_session_ram_store_publish_with_sequence(&offset, session, publish)) != 0) {
+			goto out;
+		}
+
+		if (__rrr_mqtt_session_ram_paged_push(&session->paged_rewrite, offset) != 0) {
+			ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+			goto out;
+		}
+
+		RRR_MQTT_P_DECREF(publish);
+		publish = NULL;
+	}
+
+	out:
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish);
+	return ret;
+}
+
+// PUBLISH paged out while the rewrite was pending were appended to the old
+// log and copied to the new log from the tail offset, others are already in
+// the new log. PUBLISH read back meanwhile were popped from the front.
+static int __rrr_mqtt_session_ram_store_rewrite_paged_end (
+		struct rrr_mqtt_session_ram *session,
+		int is_committed,
+		rrr_biglength tail_offset,
+		rrr_biglength tail_offset_new
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	if (!is_committed) {
+		__rrr_mqtt_session_ram_paged_clear(&session->paged_rewrite);
+		goto out;
+	}
+
+	rrr_length remaining = 0;
+	while (remaining < session->paged.count && session->paged.offsets[session->paged.first + remaining] < tail_offset) {
+		remaining++;
+	}
+
+	if (remaining > session->paged_rewrite.count) {
+		RRR_BUG("BUG: More paged PUBLISH remaining than were rewritten in %s\n", __func__);
+	}
+
+	while (session->paged_rewrite.count > remaining) {
+		__rrr_mqtt_session_ram_paged_pop(&session->paged_rewrite);
+	}
+
+	for (rrr_length i = remaining; i < session->paged.count; i++) {
+		const rrr_biglength offset = session->paged.offsets[session->paged.first + i];
+		if (__rrr_mqtt_session_ram_paged_push(&session->paged_rewrite, offset - tail_offset + tail_offset_new) != 0) {
+			ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+			goto out;
+		}
+	}
+
+	__rrr_mqtt_session_ram_paged_clear(&session->paged);
+	session->paged = session->paged_rewrite;
+	memset(&session->paged_rewrite, '\0', sizeof(session->paged_rewrite));
+
+	out:
+	return ret;
+}
+
+// Completes a committed rewrite once the new log has been synced
+static int __rrr_mqtt_session_collection_ram_store_rewrite_complete (
+		struct rrr_mqtt_session_collection_ram_data *data,
+		int do_wait
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	int is_complete = 0;
+	rrr_biglength tail_offset = 0;
+	rrr_biglength tail_offset_new = 0;
+
+	if (rrr_mqtt_session_store_rewrite_complete (
+			&is_complete,
+			&tail_offset,
+			&tail_offset_new,
+			data->store,
+			do_wait
+	) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+	}
+
+	if (!is_complete && ret == 0) {
+		goto out;
+	}
+
+	RRR_LL_ITERATE_BEGIN(data, struct rrr_mqtt_session_ram);
+		ret |= __rrr_mqtt_session_ram_store_rewrite_paged_end(node, is_complete, tail_offset, tail_offset_new);
+	RRR_LL_ITERATE_END();
+
+	out:
+	return ret;
+}
+
+// Write a snapshot of all stored state to a new log which replaces the current one
+static int __rrr_mqtt_session_collection_ram_store_rewrite (
+		struct rrr_mqtt_session_collection_ram_data *data,
+		int do_wait
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	if (rrr_mqtt_session_store_rewrite_begin(data->store) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out;
 	}
 
-	iterate_callback_data->callback (
-			publish,
-			iterate_callback_data->callback_arg
-	);
+	if (rrr_fifo_search (
+			&data->retain_buffer.buffer,
+			__rrr_mqtt_session_collection_ram_store_rewrite_retain_callback,
+			data
+	) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out_end;
+	}
 
-	return ret | RRR_FIFO_SEARCH_FREE;
-}
+	RRR_LL_ITERATE_BEGIN(data, struct rrr_mqtt_session_ram);
+		if (node->is_stored) {
+			if ((ret = __rrr_mqtt_session_ram_store_session(node)) != 0) {
+				RRR_LL_ITERATE_BREAK();
+			}
 
+			if (rrr_fifo_search (
+					&node->to_remote_buffer.buffer,
+					__rrr_mqtt_session_ram_store_rewrite_publish_callback,
+					node
+			) != 0) {
+				ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+				RRR_LL_ITERATE_BREAK();
+			}
+		}
 
-static int __rrr_mqtt_session_collection_ram_iterate_and_clear_local_delivery (
-		struct rrr_mqtt_session_collection *sessions,
-		void (*callback)(struct rrr_mqtt_p_publish *publish, void *arg),
-		void *callback_arg
-) {
-	struct rrr_mqtt_session_collection_ram_data *data = (struct rrr_mqtt_session_collection_ram_data *) sessions;
+		// Paged PUBLISH are copied also for sessions no longer stored
+		// as they are still read from the log
+		if ((ret = __rrr_mqtt_session_ram_store_rewrite_paged(node)) != 0) {
+			RRR_LL_ITERATE_BREAK();
+		}
+	RRR_LL_ITERATE_END();
 
-	int ret = RRR_MQTT_SESSION_OK;
+	out_end:
+	if (rrr_mqtt_session_store_rewrite_end(data->store, ret == 0) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+	}
 
-	struct iterate_local_delivery_callback_data iterate_callback_data = {
-			callback,
-			callback_arg
-	};
+	if (ret != 0) {
+		RRR_LL_ITERATE_BEGIN(data, struct rrr_mqtt_session_ram);
+			__rrr_mqtt_session_ram_store_rewrite_paged_end(node, 0, 0, 0);
+		RRR_LL_ITERATE_END();
+		goto out;
+	}
 
-	RRR_MQTT_COMMON_CALL_FIFO_CHECK_RETURN_TO_SESSION_ERRORS_GENERAL(
-			rrr_fifo_read_clear_forward_all (
-					&data->publish_local_buffer.buffer,
-					__rrr_mqtt_session_collection_iterate_and_clear_local_delivery_callback,
-					&iterate_callback_data
-			),
-			goto out,
-			" while iterating local delivery queue"
-	);
+	ret = __rrr_mqtt_session_collection_ram_store_rewrite_complete(data, do_wait);
 
 	out:
 	return ret;
 }
 
-static int __rrr_mqtt_session_ram_iterate_publish_grace_callback (RRR_FIFO_READ_CALLBACK_ARGS) {
-	 struct rrr_mqtt_p *packet = (struct rrr_mqtt_p *) data;
-
-	(void)(size);
-
-	int *counter = arg;
-
-	int ret = RRR_FIFO_OK;
-
-	if (packet->planned_expiry_time == 0) {
-		RRR_BUG("BUG: Planned expiry not set in %s\n", __func__);
+static int __rrr_mqtt_session_collection_ram_store_maintain (
+		struct rrr_mqtt_session_collection_ram_data *data
+) {
+	if (data->store == NULL) {
+		return RRR_MQTT_SESSION_OK;
 	}
-	else if (packet->planned_expiry_time < rrr_time_get_64()) {
-		RRR_DBG_3("%s %p id %u grace time is complete, deleting from buffer.\n",
-			RRR_MQTT_P_GET_TYPE_NAME(packet),
-			packet,
-			RRR_MQTT_P_GET_IDENTIFIER(packet)
-		);
-		(*counter)++;
-		ret = RRR_FIFO_SEARCH_GIVE | RRR_FIFO_SEARCH_FREE;
+
+	// Disk I/O is done by the sync thread of the store, the session
+	// lock is not held while waiting for it
+	if (rrr_mqtt_session_store_rewrite_is_pending(data->store)) {
+		return __rrr_mqtt_session_collection_ram_store_rewrite_complete(data, 0);
 	}
-	else {
-		// If we encounter a packet which has not expired, it's unlikely that the rest
-		// of the packets are expired.
-		ret = RRR_FIFO_SEARCH_STOP;
+
+	if (rrr_mqtt_session_store_rewrite_needed(data->store)) {
+		return __rrr_mqtt_session_collection_ram_store_rewrite(data, 0);
 	}
 
-	return ret;
+	return rrr_mqtt_session_store_sync(data->store) == 0 ? RRR_MQTT_SESSION_OK : RRR_MQTT_SESSION_INTERNAL_ERROR;
 }
-			
+
 static int __rrr_mqtt_session_collection_ram_maintain_expire (
 		struct rrr_mqtt_session_collection *sessions
 ) {
@@ -1179,9 +1907,13 @@ static int __rrr_mqtt_session_collection_ram_maintain_expire (
 		}
 	RRR_LL_ITERATE_END_CHECK_DESTROY (
 			data,
-			__rrr_mqtt_session_ram_decref(node)
+			(__rrr_mqtt_session_collection_ram_unregister(data, node), __rrr_mqtt_session_ram_decref(node))
 	);
 
+	if ((ret = __rrr_mqtt_session_collection_ram_store_maintain(data)) != 0) {
+		goto out;
+	}
+
 	out:
 	return ret;
 }
@@ -1189,15 +1921,31 @@ static int __rrr_mqtt_session_collection_ram_maintain_expire (
 static void __rrr_mqtt_session_collection_ram_destroy (struct rrr_mqtt_session_collection *sessions) {
 	struct rrr_mqtt_session_collection_ram_data *data = (struct rrr_mqtt_session_collection_ram_data *) sessions;
 
+	if (data->store != NULL) {
+		// Leave a compact log for the next startup. Sessions are not
+		// deleted from the store when destroyed below.
+		if (rrr_mqtt_session_store_rewrite_is_pending(data->store)) {
+			__rrr_mqtt_session_collection_ram_store_rewrite_complete(data, 1);
+		}
+		__rrr_mqtt_session_collection_ram_store_rewrite(data, 1);
+		rrr_mqtt_session_store_close(data->store);
+		data->store = NULL;
+	}
+
 	rrr_fifo_destroy(&data->retain_buffer.buffer);
 	rrr_fifo_destroy(&data->publish_local_buffer.buffer);
 
 	RRR_LL_DESTROY (
 			data,
 			struct rrr_mqtt_session_ram,
+			__rrr_mqtt_session_collection_ram_unregister(data, node);
 			__rrr_mqtt_session_ram_decref(node)
 	);
 
+	rrr_mqtt_subscription_index_destroy(data->subscription_index);
+	rrr_hash_clear(&data->sessions_by_client_id);
+	rrr_hash_clear(&data->sessions_by_ptr);
+
 	rrr_mqtt_session_collection_destroy(sessions);
 
 	rrr_free(sessions);
@@ -1333,6 +2081,8 @@ static int __rrr_mqtt_session_ram_clean_final (struct rrr_mqtt_session_ram *ram_
 	rrr_mqtt_subscription_collection_clear(ram_session->subscriptions);
 	rrr_mqtt_id_pool_clear(&ram_session->id_pool);
 
+	ret |= __rrr_mqtt_session_ram_subscription_index_update(ram_session);
+
 	return ret;
 }
 
@@ -1367,6 +2117,10 @@ static int __rrr_mqtt_session_ram_init (
 		__rrr_mqtt_session_ram_clean_final(ram_session);
 	}
 
+	if ((ret = __rrr_mqtt_session_ram_store_session(ram_session)) != 0) {
+		goto out;
+	}
+
 	RRR_DBG_2("Initialize ram session, expiry interval is %" PRIu32 " have will publish %p clean session %i to remote buffer count %" PRIrrrl "\n",
 			ram_session->session_properties.numbers.session_expiry,
 			ram_session->will_publish,
@@ -1389,6 +2143,8 @@ static int __rrr_mqtt_session_ram_clean (
 
 	__rrr_mqtt_session_ram_clean_final(ram_session);
 
+	ret = __rrr_mqtt_session_ram_store_session(ram_session);
+
 	SESSION_RAM_DECREF();
 
 	return ret;
@@ -1427,9 +2183,20 @@ static int __rrr_mqtt_session_ram_update_client_identifier (
 		RRR_DBG_1("MQTT client session %p: Server assigned client identifier %s in V5 CONNACK\n",
 				session, assigned_identifier_tmp);
 
+		if (session->client_id_ != NULL && rrr_hash_get_str(&session->ram_data->sessions_by_client_id, session->client_id_) == session) {
+			rrr_hash_remove_str(&session->ram_data->sessions_by_client_id, session->client_id_);
+		}
+
 		RRR_FREE_IF_NOT_NULL(session->client_id_);
 		session->client_id_ = assigned_identifier_tmp;
 		assigned_identifier_tmp = NULL;
+
+		if ( __rrr_mqtt_session_ram_is_registered(session) &&
+		     rrr_hash_set_str(&session->ram_data->sessions_by_client_id, session->client_id_, session) != 0
+		) {
+			ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+			goto out;
+		}
 	}
 	else {
 		if (is_v5) {
@@ -1834,6 +2601,9 @@ static int __rrr_mqtt_session_ram_add_subscriptions (
 		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
 	}
 
+	ret |= __rrr_mqtt_session_ram_subscription_index_update(ram_session);
+	ret |= __rrr_mqtt_session_ram_store_session(ram_session);
+
 	if (RRR_DEBUGLEVEL_2) {
 		rrr_mqtt_subscription_collection_dump(ram_session->subscriptions);
 	}
@@ -1859,6 +2629,9 @@ static int __rrr_mqtt_session_ram_remove_subscriptions (
 		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
 	}
 
+	ret |= __rrr_mqtt_session_ram_subscription_index_update(ram_session);
+	ret |= __rrr_mqtt_session_ram_store_session(ram_session);
+
 	if (RRR_DEBUGLEVEL_2) {
 		rrr_mqtt_subscription_collection_dump(ram_session->subscriptions);
 	}
@@ -1931,6 +2704,8 @@ static int __rrr_mqtt_session_ram_receive_suback (
 		ret = RRR_MQTT_SESSION_ERROR;
 	}
 
+	ret |= __rrr_mqtt_session_ram_subscription_index_update(ram_session);
+
 	return ret;
 }
 
@@ -2025,6 +2800,7 @@ static int __rrr_mqtt_session_ram_receive_unsuback (
 	if (orig_collection != NULL) {
 		rrr_mqtt_subscription_collection_destroy(orig_collection);
 	}
+	ret |= __rrr_mqtt_session_ram_subscription_index_update(ram_session);
 	return ret;
 }
 
@@ -2286,6 +3062,10 @@ int __rrr_mqtt_session_ram_packet_ack_complete (
 		goto out;
 	}
 
+	if (RRR_MQTT_P_GET_TYPE(packet) == RRR_MQTT_P_TYPE_PUBLISH) {
+		ret = __rrr_mqtt_session_collection_ram_store_ack(ram_session->ram_data, (struct rrr_mqtt_p_publish *) packet);
+	}
+
 	out:
 	return ret;
 }
@@ -2698,6 +3478,10 @@ static int __rrr_mqtt_session_ram_iterate_send_queue (
 		goto out_print_message;
 	}
 
+	if ((ret = __rrr_mqtt_session_ram_store_page_in(ram_session)) != 0) {
+		goto out;
+	}
+
 	struct iterate_send_queue_callback_data callback_data = {
 			callback,
 			callback_arg,
@@ -2769,6 +3553,7 @@ static int __rrr_mqtt_session_ram_iterate_send_queue (
 		RRR_MSG_0("Soft error while iterating buffer in %s\n", __func__);
 		ret = RRR_MQTT_SESSION_ERROR;
 	}
+	out:
 	SESSION_RAM_DECREF();
 	return ret;
 }
@@ -2805,6 +3590,12 @@ static int __rrr_mqtt_session_ram_notify_disconnect (
 		}
 	}
 
+	if ( ram_session->session_properties.numbers.session_expiry != 0 &&
+	    (ret = __rrr_mqtt_session_ram_store_session(ram_session)) != 0
+	) {
+		goto out;
+	}
+
 	if (ram_session->session_properties.numbers.session_expiry == 0) {
 		RRR_DBG_1("Destroying session with zero session expiry upon disconnect\n");
 		__rrr_mqtt_session_collection_remove (
@@ -3155,6 +3946,249 @@ static int __rrr_mqtt_session_ram_will_publish_register (
 	return ret;
 }
 
+struct rrr_mqtt_session_ram_store_replay_publish {
+	RRR_LL_NODE(struct rrr_mqtt_session_ram_store_replay_publish);
+	uint64_t sequence;
+	rrr_biglength offset;
+	struct rrr_mqtt_session_ram *session;
+};
+
+// PUBLISH records are held back until the complete log is replayed as
+// most of them are followed by an ACK record
+struct rrr_mqtt_session_ram_store_replay_data {
+	RRR_LL_HEAD(struct rrr_mqtt_session_ram_store_replay_publish);
+	struct rrr_mqtt_session_collection_ram_data *data;
+	struct rrr_hash publish_by_sequence;
+};
+
+static void __rrr_mqtt_session_ram_store_replay_publish_destroy (
+		struct rrr_mqtt_session_ram_store_replay_publish *replay_publish
+) {
+	__rrr_mqtt_session_ram_decref(replay_publish->session);
+	rrr_free(replay_publish);
+}
+
+static int __rrr_mqtt_session_ram_store_replay_session (
+		struct rrr_mqtt_session_collection_ram_data *data,
+		struct rrr_mqtt_session_store_reader *reader
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	char *client_id = NULL;
+	uint32_t session_expiry;
+	uint64_t expire_time;
+	struct rrr_mqtt_subscription_collection subscriptions = {0};
+
+	if ( rrr_mqtt_session_store_reader_get_str(&client_id, reader) != 0 ||
+	     rrr_mqtt_session_store_reader_get_u32(&session_expiry, reader) != 0 ||
+	     rrr_mqtt_session_store_reader_get_u64(&expire_time, reader) != 0 ||
+	     rrr_mqtt_session_store_reader_get_subscriptions(&subscriptions, reader) != 0
+	) {
+		ret = RRR_MQTT_SESSION_ERROR;
+		goto out;
+	}
+
+	const uint64_t time_now = rrr_time_get_64();
+
+	struct rrr_mqtt_session_ram *session = __rrr_mqtt_session_collection_ram_find_session(data, client_id);
+
+	if (expire_time != 0 && expire_time <= time_now) {
+		if (session != NULL) {
+			__rrr_mqtt_session_collection_remove(data, session);
+			__rrr_mqtt_session_collection_ram_stats_notify_delete(data);
+		}
+		goto out;
+	}
+
+	if (session == NULL) {
+		if ((ret = __rrr_mqtt_session_collection_ram_create_and_add_session (
+				&session,
+				data,
+				client_id
+		)) != 0) {
+			goto out;
+		}
+		__rrr_mqtt_session_collection_ram_stats_notify_create(data);
+	}
+
+	// Sessions which were connected count as disconnected at startup
+	if (expire_time == 0 && session_expiry != 0xffffffff) { // 8 f's
+		expire_time = time_now + (uint64_t) session_expiry * 1000 * 1000;
+	}
+
+	session->session_properties.numbers.session_expiry = session_expiry;
+	session->expire_time = expire_time;
+	session->heartbeat_time = time_now;
+	session->is_stored = 1;
+
+	rrr_mqtt_subscription_collection_clear(session->subscriptions);
+	RRR_LL_MERGE_AND_CLEAR_SOURCE_HEAD(session->subscriptions, &subscriptions);
+
+	if ((ret = __rrr_mqtt_session_ram_subscription_index_update(session)) != 0) {
+		goto out;
+	}
+
+	out:
+	rrr_mqtt_subscription_collection_clear(&subscriptions);
+	RRR_FREE_IF_NOT_NULL(client_id);
+	return ret;
+}
+
+static int __rrr_mqtt_session_ram_store_replay_callback (
+		RRR_MQTT_SESSION_STORE_REPLAY_CALLBACK_ARGS
+) {
+	struct rrr_mqtt_session_ram_store_replay_data *replay_data = arg;
+	struct rrr_mqtt_session_collection_ram_data *data = replay_data->data;
+
+	int ret = RRR_MQTT_SESSION_OK;
+
+	char *client_id = NULL;
+	struct rrr_mqtt_p_publish *publish = NULL;
+	struct rrr_mqtt_session_ram *session = NULL;
+	uint64_t sequence = 0;
+
+	switch (type) {
+		case RRR_MQTT_SESSION_STORE_RECORD_RETAIN:
+			if (rrr_mqtt_session_store_reader_get_publish(&publish, reader) != 0) {
+				ret = RRR_MQTT_SESSION_ERROR;
+				goto out;
+			}
+			if (!__rrr_mqtt_session_ram_check_publish_expired(publish)) {
+				ret = __rrr_mqtt_session_collection_ram_retain_buffer_update(data, publish);
+			}
+			break;
+		case RRR_MQTT_SESSION_STORE_RECORD_SESSION:
+			ret = __rrr_mqtt_session_ram_store_replay_session(data, reader);
+			break;
+		case RRR_MQTT_SESSION_STORE_RECORD_SESSION_DELETE:
+			if (rrr_mqtt_session_store_reader_get_str(&client_id, reader) != 0) {
+				ret = RRR_MQTT_SESSION_ERROR;
+				goto out;
+			}
+			if ((session = __rrr_mqtt_session_collection_ram_find_session(data, client_id)) != NULL) {
+				__rrr_mqtt_session_collection_remove(data, session);
+				__rrr_mqtt_session_collection_ram_stats_notify_delete(data);
+			}
+			break;
+		case RRR_MQTT_SESSION_STORE_RECORD_PUBLISH:
+			if ( rrr_mqtt_session_store_reader_get_u64(&sequence, reader) != 0 ||
+			     rrr_mqtt_session_store_reader_get_str(&client_id, reader) != 0 ||
+			     rrr_mqtt_session_store_reader_get_publish(&publish, reader) != 0
+			) {
+				ret = RRR_MQTT_SESSION_ERROR;
+				goto out;
+			}
+
+			if (sequence > data->store_sequence) {
+				data->store_sequence = sequence;
+			}
+
+			if ((session = __rrr_mqtt_session_collection_ram_find_session(data, client_id)) == NULL) {
+				break;
+			}
+
+			struct rrr_mqtt_session_ram_store_replay_publish *replay_publish;
+			if ((replay_publish = rrr_allocate_zero(sizeof(*replay_publish))) == NULL) {
+				RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+				ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+				goto out;
+			}
+
+			if (rrr_hash_set_u64(&replay_data->publish_by_sequence, sequence, replay_publish) != 0) {
+				rrr_free(replay_publish);
+				ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+				goto out;
+			}
+
+			// Session is held in case it is deleted later in the log
+			__rrr_mqtt_session_ram_incref(session);
+
+			// Only the offset is kept, the PUBLISH is read again when needed
+			replay_publish->sequence = sequence;
+			replay_publish->offset = offset;
+			replay_publish->session = session;
+
+			RRR_LL_APPEND(replay_data, replay_publish);
+			break;
+		case RRR_MQTT_SESSION_STORE_RECORD_ACK:
+			if (rrr_mqtt_session_store_reader_get_u64(&sequence, reader) != 0) {
+				ret = RRR_MQTT_SESSION_ERROR;
+				goto out;
+			}
+
+			struct rrr_mqtt_session_ram_store_replay_publish *acked;
+			if ((acked = rrr_hash_remove_u64(&replay_data->publish_by_sequence, sequence)) != NULL) {
+				RRR_LL_REMOVE_NODE_NO_FREE(replay_data, acked);
+				__rrr_mqtt_session_ram_store_replay_publish_destroy(acked);
+			}
+			break;
+		default:
+			RRR_MSG_0("Unknown record type %u in MQTT session store\n", type);
+			ret = RRR_MQTT_SESSION_ERROR;
+			goto out;
+	};
+
+	out:
+	RRR_FREE_IF_NOT_NULL(client_id);
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish);
+	return ret;
+}
+
+static int __rrr_mqtt_session_collection_ram_store_open (
+		struct rrr_mqtt_session_collection_ram_data *data,
+		const struct rrr_mqtt_session_collection_ram_config *config
+) {
+	int ret = RRR_MQTT_SESSION_OK;
+
+	struct rrr_mqtt_session_store *store = NULL;
+	struct rrr_mqtt_session_ram_store_replay_data replay_data = {0};
+
+	replay_data.data = data;
+
+	if (rrr_mqtt_session_store_open (
+			&store,
+			config->store_file,
+			config->store_sync_interval_ms,
+			__rrr_mqtt_session_ram_store_replay_callback,
+			&replay_data
+	) != 0) {
+		ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+		goto out;
+	}
+
+	// PUBLISH which were not acknowledged before shutdown are paged
+	// and read back once the client reconnects
+	RRR_LL_ITERATE_BEGIN(&replay_data, struct rrr_mqtt_session_ram_store_replay_publish);
+		if (!__rrr_mqtt_session_ram_is_registered(node->session)) {
+			RRR_LL_ITERATE_NEXT();
+		}
+
+		if (__rrr_mqtt_session_ram_paged_push(&node->session->paged, node->offset) != 0) {
+			ret = RRR_MQTT_SESSION_INTERNAL_ERROR;
+			goto out_close;
+		}
+	RRR_LL_ITERATE_END();
+
+	RRR_DBG_1("MQTT session store '%s' loaded, %i sessions and %i queued PUBLISH\n",
+			config->store_file, RRR_LL_COUNT(data), RRR_LL_COUNT(&replay_data));
+
+	data->store = store;
+	store = NULL;
+
+	// Compact the log now that the state is known
+	if ((ret = __rrr_mqtt_session_collection_ram_store_rewrite(data, 1)) != 0) {
+		goto out;
+	}
+
+	goto out;
+	out_close:
+		rrr_mqtt_session_store_close(store);
+	out:
+		RRR_LL_DESTROY(&replay_data, struct rrr_mqtt_session_ram_store_replay_publish, __rrr_mqtt_session_ram_store_replay_publish_destroy(node));
+		rrr_hash_clear(&replay_data.publish_by_sequence);
+		return ret;
+}
+
 const struct rrr_mqtt_session_collection_methods methods = {
 		__rrr_mqtt_session_collection_ram_get_stats,
 		__rrr_mqtt_session_collection_ram_iterate_and_clear_local_delivery,
@@ -3179,14 +4213,11 @@ static int __rrr_mqtt_session_collection_ram_new (
 		struct rrr_mqtt_session_collection **sessions,
 		int (*delivery_method)(RRR_MQTT_SESSION_RAM_DELIVERY_METHOD_ARGS),
 		int (*pretransmit_method)(RRR_MQTT_SESSION_RAM_PRETRANSMIT_METHOD_ARGS),
-		void *arg
+		int use_subscription_index,
+		const struct rrr_mqtt_session_collection_ram_config *config
 ) {
 	int ret = 0;
 
-	if (arg != NULL) {
-		RRR_BUG("arg was not NULL in %s\n", __func__);
-	}
-
 	struct rrr_mqtt_session_collection_ram_data *ram_data = rrr_allocate(sizeof(*ram_data));
 	if (ram_data == NULL) {
 		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
@@ -3205,18 +4236,33 @@ static int __rrr_mqtt_session_collection_ram_new (
 		goto out_destroy_ram_data;
 	}
 
+	if (use_subscription_index && rrr_mqtt_subscription_index_new(&ram_data->subscription_index) != 0) {
+		RRR_MSG_0("Could not create subscription index in %s\n", __func__);
+		ret = 1;
+		goto out_destroy_collection;
+	}
+
 	rrr_fifo_init_custom_refcount(&ram_data->retain_buffer.buffer, rrr_mqtt_p_usercount_incref_void, rrr_mqtt_p_usercount_decref_void);
 	rrr_fifo_init_custom_refcount(&ram_data->publish_local_buffer.buffer, rrr_mqtt_p_usercount_incref_void, rrr_mqtt_p_usercount_decref_void);
 
 	ram_data->delivery_method = delivery_method;
 	ram_data->pretransmit_method = pretransmit_method;
 
+	if (config != NULL && config->store_file != NULL && *(config->store_file) != '\0') {
+		if (__rrr_mqtt_session_collection_ram_store_open(ram_data, config) != 0) {
+			RRR_MSG_0("Could not open session store in %s\n", __func__);
+			__rrr_mqtt_session_collection_ram_destroy((struct rrr_mqtt_session_collection *) ram_data);
+			ret = 1;
+			goto out;
+		}
+	}
+
 	*sessions = (struct rrr_mqtt_session_collection *) ram_data;
 
 	goto out;
 
-//	out_destroy_collection:
-//		rrr_mqtt_session_collection_destroy((struct rrr_mqtt_session_collection *)ram_data);
+	out_destroy_collection:
+		rrr_mqtt_session_collection_destroy((struct rrr_mqtt_session_collection *)ram_data);
 	out_destroy_ram_data:
 		rrr_free(ram_data);
 	out:
@@ -3229,16 +4275,22 @@ int rrr_mqtt_session_collection_ram_new_broker (struct rrr_mqtt_session_collecti
 			sessions,
 			__rrr_mqtt_session_ram_delivery_forward,
 			__rrr_mqtt_session_ram_pretransmit_forward,
-			arg
+			1, // Use subscription index
+			arg // Optional configuration
 	);
 }
 
 int rrr_mqtt_session_collection_ram_new_client (struct rrr_mqtt_session_collection **sessions, void *arg) {
+	if (arg != NULL) {
+		RRR_BUG("arg was not NULL in %s\n", __func__);
+	}
+
 	return __rrr_mqtt_session_collection_ram_new (
 			sessions,
 			__rrr_mqtt_session_ram_delivery_local,
 			__rrr_mqtt_session_ram_pretransmit_local,
-			arg
+			0, // No subscription index, only one session is used
+			NULL
 	);
 }
 
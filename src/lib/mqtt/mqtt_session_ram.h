@@ -23,8 +23,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef RRR_MQTT_SESSION_RAM_H
 #define RRR_MQTT_SESSION_RAM_H
 
+#include <stdint.h>
+
 struct rrr_mqtt_session_collection;
 
+// Optional configuration for the broker collection, pass as arg
+struct rrr_mqtt_session_collection_ram_config {
+	// Sessions and retained messages are persisted when set
+	const char *store_file;
+	uint64_t store_sync_interval_ms;
+};
+
 int rrr_mqtt_session_collection_ram_new_broker (struct rrr_mqtt_session_collection **sessions, void *arg);
 int rrr_mqtt_session_collection_ram_new_client (struct rrr_mqtt_session_collection **sessions, void *arg);
 
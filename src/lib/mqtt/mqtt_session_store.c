@@ -0,0 +1,1404 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../log.h"
+#include "../allocator.h"
+#include "../rrr_strerror.h"
+
+#include "mqtt_session_store.h"
+#include "mqtt_packet.h"
+#include "mqtt_payload.h"
+#include "mqtt_parse.h"
+#include "mqtt_assemble.h"
+#include "mqtt_common.h"
+#include "mqtt_subscription.h"
+#include "mqtt_topic.h"
+
+#include "../socket/rrr_socket.h"
+#include "../util/crc32.h"
+#include "../util/rrr_time.h"
+#include "../util/posix.h"
+#include "../util/gnu.h"
+
+#define RRR_MQTT_SESSION_STORE_MAGIC             "RRRMQSS1"
+#define RRR_MQTT_SESSION_STORE_MAGIC_SIZE        8
+
+// Each record is prefixed with size and type and followed by a CRC32
+// of type and record data.
+#define RRR_MQTT_SESSION_STORE_RECORD_HEAD_SIZE  5
+#define RRR_MQTT_SESSION_STORE_RECORD_TAIL_SIZE  4
+#define RRR_MQTT_SESSION_STORE_RECORD_MAX_SIZE   (512 * 1024 * 1024)
+
+// Don't rewrite small logs, and otherwise wait until the log has grown
+// to twice the size of the last rewrite.
+#define RRR_MQTT_SESSION_STORE_REWRITE_MIN_SIZE  (4 * 1024 * 1024)
+
+struct rrr_mqtt_session_store {
+	char *path;
+	char *path_rewrite;
+	int fd;
+	int fd_rewrite;
+	uint64_t sync_interval_us;
+	uint64_t prev_sync_time;
+	int is_dirty;
+	rrr_biglength log_size;
+	rrr_biglength log_size_rewrite;
+	rrr_biglength log_size_after_rewrite;
+
+	// Set when a rewrite is ended with commit, the new log is then synced
+	// by the sync thread while records are appended to the old log
+	int rewrite_is_pending;
+	int rewrite_sync_posted;
+	rrr_biglength log_size_pending;
+
+	// Members below are protected by the sync lock. A job is posted by
+	// setting sync_busy, the sync thread clears it once done.
+	pthread_t sync_thread;
+	pthread_mutex_t sync_lock;
+	pthread_cond_t sync_cond;
+	int sync_fd;
+	int sync_directory;
+	int sync_busy;
+	int sync_failed;
+	int sync_stop;
+};
+
+void rrr_mqtt_session_store_record_clear (
+		struct rrr_mqtt_session_store_record *record
+) {
+	RRR_FREE_IF_NOT_NULL(record->data);
+	memset(record, '\0', sizeof(*record));
+}
+
+static int __rrr_mqtt_session_store_record_reserve (
+		char **target,
+		struct rrr_mqtt_session_store_record *record,
+		rrr_length size
+) {
+	// Space for record head is reserved at the beginning and space
+	// for the tail is always kept available at the end
+	if (record->size == 0) {
+		record->size = RRR_MQTT_SESSION_STORE_RECORD_HEAD_SIZE;
+	}
+
+	if ((rrr_biglength) record->size + size + RRR_MQTT_SESSION_STORE_RECORD_TAIL_SIZE > RRR_MQTT_SESSION_STORE_RECORD_MAX_SIZE) {
+		RRR_MSG_0("Record too large in %s\n", __func__);
+		return 1;
+	}
+
+	const rrr_length size_needed = record->size + size + RRR_MQTT_SESSION_STORE_RECORD_TAIL_SIZE;
+
+	if (size_needed > record->size_allocated) {
+		rrr_length size_new = record->size_allocated == 0 ? 256 : record->size_allocated;
+		while (size_new < size_needed) {
+			size_new *= 2;
+		}
+
+		char *data_new = rrr_reallocate(record->data, size_new);
+		if (data_new == NULL) {
+			RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+			return 1;
+		}
+
+		record->data = data_new;
+		record->size_allocated = size_new;
+	}
+
+	*target = record->data + record->size;
+	record->size += size;
+
+	return 0;
+}
+
+static void __rrr_mqtt_session_store_put_u32 (
+		char *target,
+		uint32_t value
+) {
+	target[0] = (char) ((value >> 24) & 0xff);
+	target[1] = (char) ((value >> 16) & 0xff);
+	target[2] = (char) ((value >> 8) & 0xff);
+	target[3] = (char) (value & 0xff);
+}
+
+static uint32_t __rrr_mqtt_session_store_get_u32 (
+		const char *source
+) {
+	const unsigned char *pos = (const unsigned char *) source;
+	return ((uint32_t) pos[0] << 24) | ((uint32_t) pos[1] << 16) | ((uint32_t) pos[2] << 8) | (uint32_t) pos[3];
+}
+
+int rrr_mqtt_session_store_record_push_u8 (
+		struct rrr_mqtt_session_store_record *record,
+		uint8_t value
+) {
+	char *target;
+
+	if (__rrr_mqtt_session_store_record_reserve(&target, record, 1) != 0) {
+		return 1;
+	}
+
+	*target = (char) value;
+
+	return 0;
+}
+
+int rrr_mqtt_session_store_record_push_u32 (
+		struct rrr_mqtt_session_store_record *record,
+		uint32_t value
+) {
+	char *target;
+
+	if (__rrr_mqtt_session_store_record_reserve(&target, record, 4) != 0) {
+		return 1;
+	}
+
+	__rrr_mqtt_session_store_put_u32(target, value);
+
+	return 0;
+}
+
+int rrr_mqtt_session_store_record_push_u64 (
+		struct rrr_mqtt_session_store_record *record,
+		uint64_t value
+) {
+	char *target;
+
+	if (__rrr_mqtt_session_store_record_reserve(&target, record, 8) != 0) {
+		return 1;
+	}
+
+	__rrr_mqtt_session_store_put_u32(target, (uint32_t) (value >> 32));
+	__rrr_mqtt_session_store_put_u32(target + 4, (uint32_t) (value & 0xffffffff));
+
+	return 0;
+}
+
+int rrr_mqtt_session_store_record_push_blob (
+		struct rrr_mqtt_session_store_record *record,
+		const void *data,
+		rrr_length size
+) {
+	char *target;
+
+	if (rrr_mqtt_session_store_record_push_u32(record, size) != 0) {
+		return 1;
+	}
+
+	if (__rrr_mqtt_session_store_record_reserve(&target, record, size) != 0) {
+		return 1;
+	}
+
+	if (size > 0) {
+		memcpy(target, data, size);
+	}
+
+	return 0;
+}
+
+int rrr_mqtt_session_store_record_push_str (
+		struct rrr_mqtt_session_store_record *record,
+		const char *str
+) {
+	return rrr_mqtt_session_store_record_push_blob(record, str, rrr_length_from_size_t_bug_const(strlen(str)));
+}
+
+int rrr_mqtt_session_store_record_push_publish (
+		struct rrr_mqtt_session_store_record *record,
+		const struct rrr_mqtt_p_publish *publish
+) {
+	int ret = 0;
+
+	char *encoded = NULL;
+	rrr_length encoded_size = 0;
+	rrr_length topic_size = 0;
+
+	// Topic and properties are stored in wire format, the packet is later
+	// re-created by running it through the ordinary parser
+	if ((ret = rrr_mqtt_assemble_publish_encoded (
+			&encoded,
+			&encoded_size,
+			&topic_size,
+			publish
+	)) != RRR_MQTT_ASSEMBLE_OK) {
+		RRR_MSG_0("Failed to assemble PUBLISH in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	// Never store DUP flag
+	const uint8_t type_flags = (uint8_t) (RRR_MQTT_P_PUBLISH_GET_FLAG_RETAIN(publish) | (RRR_MQTT_P_PUBLISH_GET_FLAG_QOS(publish) << 1));
+
+	if ((ret = rrr_mqtt_session_store_record_push_u8(record, publish->protocol_version->id)) != 0 ||
+	    (ret = rrr_mqtt_session_store_record_push_u8(record, type_flags)) != 0 ||
+	    (ret = rrr_mqtt_session_store_record_push_u64(record, publish->create_time)) != 0 ||
+	    (ret = rrr_mqtt_session_store_record_push_u32(record, topic_size)) != 0 ||
+	    (ret = rrr_mqtt_session_store_record_push_blob(record, encoded, encoded_size)) != 0 ||
+	    (ret = rrr_mqtt_session_store_record_push_blob (
+			record,
+			publish->payload != NULL ? publish->payload->payload_start : NULL,
+			publish->payload != NULL ? publish->payload->size : 0
+	    )) != 0
+	) {
+		goto out;
+	}
+
+	out:
+	RRR_FREE_IF_NOT_NULL(encoded);
+	return ret;
+}
+
+static int __rrr_mqtt_session_store_record_push_subscription_callback (
+		struct rrr_mqtt_subscription *sub,
+		void *arg
+) {
+	struct rrr_mqtt_session_store_record *record = arg;
+
+	if (rrr_mqtt_session_store_record_push_str(record, sub->topic_filter) != 0 ||
+	    rrr_mqtt_session_store_record_push_u8(record, sub->retain_handling) != 0 ||
+	    rrr_mqtt_session_store_record_push_u8(record, sub->rap) != 0 ||
+	    rrr_mqtt_session_store_record_push_u8(record, sub->nl) != 0 ||
+	    rrr_mqtt_session_store_record_push_u8(record, sub->qos_or_reason_v5) != 0
+	) {
+		return RRR_MQTT_SUBSCRIPTION_ITERATE_INTERNAL_ERROR;
+	}
+
+	return RRR_MQTT_SUBSCRIPTION_ITERATE_OK;
+}
+
+int rrr_mqtt_session_store_record_push_subscriptions (
+		struct rrr_mqtt_session_store_record *record,
+		const struct rrr_mqtt_subscription_collection *subscriptions
+) {
+	if (rrr_mqtt_session_store_record_push_u32(record, rrr_mqtt_subscription_collection_count(subscriptions)) != 0) {
+		return 1;
+	}
+
+	// Iterate function takes non-const argument but does not modify
+	// the collection unless the callback asks for it
+	return rrr_mqtt_subscription_collection_iterate (
+			(struct rrr_mqtt_subscription_collection *) subscriptions,
+			__rrr_mqtt_session_store_record_push_subscription_callback,
+			record
+	) != 0;
+}
+
+static int __rrr_mqtt_session_store_reader_get (
+		const char **target,
+		struct rrr_mqtt_session_store_reader *reader,
+		rrr_length size
+) {
+	if (reader->end - reader->pos < (rrr_slength) size) {
+		RRR_MSG_0("Record in MQTT session store was too short\n");
+		return 1;
+	}
+
+	*target = reader->pos;
+	reader->pos += size;
+
+	return 0;
+}
+
+int rrr_mqtt_session_store_reader_get_u8 (
+		uint8_t *target,
+		struct rrr_mqtt_session_store_reader *reader
+) {
+	const char *pos;
+
+	if (__rrr_mqtt_session_store_reader_get(&pos, reader, 1) != 0) {
+		return 1;
+	}
+
+	*target = (uint8_t) *pos;
+
+	return 0;
+}
+
+int rrr_mqtt_session_store_reader_get_u32 (
+		uint32_t *target,
+		struct rrr_mqtt_session_store_reader *reader
+) {
+	const char *pos;
+
+	if (__rrr_mqtt_session_store_reader_get(&pos, reader, 4) != 0) {
+		return 1;
+	}
+
+	*target = __rrr_mqtt_session_store_get_u32(pos);
+
+	return 0;
+}
+
+int rrr_mqtt_session_store_reader_get_u64 (
+		uint64_t *target,
+		struct rrr_mqtt_session_store_reader *reader
+) {
+	const char *pos;
+
+	if (__rrr_mqtt_session_store_reader_get(&pos, reader, 8) != 0) {
+		return 1;
+	}
+
+	*target = ((uint64_t) __rrr_mqtt_session_store_get_u32(pos) << 32) | __rrr_mqtt_session_store_get_u32(pos + 4);
+
+	return 0;
+}
+
+int rrr_mqtt_session_store_reader_get_blob (
+		const char **target,
+		rrr_length *size,
+		struct rrr_mqtt_session_store_reader *reader
+) {
+	uint32_t size_tmp;
+
+	if (rrr_mqtt_session_store_reader_get_u32(&size_tmp, reader) != 0) {
+		return 1;
+	}
+
+	*size = size_tmp;
+
+	return __rrr_mqtt_session_store_reader_get(target, reader, size_tmp);
+}
+
+int rrr_mqtt_session_store_reader_get_str (
+		char **target,
+		struct rrr_mqtt_session_store_reader *reader
+) {
+	const char *data;
+	rrr_length size;
+
+	*target = NULL;
+
+	if (rrr_mqtt_session_store_reader_get_blob(&data, &size, reader) != 0) {
+		return 1;
+	}
+
+	if (memchr(data, '\0', size) != NULL) {
+		RRR_MSG_0("String in MQTT session store contained zero byte\n");
+		return 1;
+	}
+
+	char *str = rrr_allocate((rrr_biglength) size + 1);
+	if (str == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		return 1;
+	}
+
+	memcpy(str, data, size);
+	str[size] = '\0';
+
+	*target = str;
+
+	return 0;
+}
+
+static rrr_length __rrr_mqtt_session_store_put_variable_int (
+		char *target,
+		rrr_length value
+) {
+	rrr_length length = 0;
+
+	do {
+		uint8_t byte = value & 0x7f;
+		value >>= 7;
+		if (value > 0) {
+			byte |= 1 << 7;
+		}
+		target[length++] = (char) byte;
+	} while (value > 0);
+
+	return length;
+}
+
+int rrr_mqtt_session_store_reader_get_publish (
+		struct rrr_mqtt_p_publish **target,
+		struct rrr_mqtt_session_store_reader *reader
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_parse_session parse_session;
+	struct rrr_mqtt_p *packet = NULL;
+	char *wire = NULL;
+
+	uint8_t protocol_version_id, type_flags;
+	uint64_t create_time;
+	uint32_t topic_size;
+	const char *encoded, *payload;
+	rrr_length encoded_size, payload_size;
+
+	*target = NULL;
+
+	rrr_mqtt_parse_session_init(&parse_session);
+
+	if ((ret = rrr_mqtt_session_store_reader_get_u8(&protocol_version_id, reader)) != 0 ||
+	    (ret = rrr_mqtt_session_store_reader_get_u8(&type_flags, reader)) != 0 ||
+	    (ret = rrr_mqtt_session_store_reader_get_u64(&create_time, reader)) != 0 ||
+	    (ret = rrr_mqtt_session_store_reader_get_u32(&topic_size, reader)) != 0 ||
+	    (ret = rrr_mqtt_session_store_reader_get_blob(&encoded, &encoded_size, reader)) != 0 ||
+	    (ret = rrr_mqtt_session_store_reader_get_blob(&payload, &payload_size, reader)) != 0
+	) {
+		goto out;
+	}
+
+	const struct rrr_mqtt_p_protocol_version *protocol_version = rrr_mqtt_p_get_protocol_version(protocol_version_id);
+	if (protocol_version == NULL || topic_size > encoded_size || (type_flags & ~(1|3<<1)) != 0) {
+		RRR_MSG_0("Invalid PUBLISH in MQTT session store\n");
+		ret = 1;
+		goto out;
+	}
+
+	// Put together the full packet. A placeholder packet identifier is
+	// needed for QoS 1 and 2, it is reset below.
+	const uint8_t qos = (uint8_t) ((type_flags & (3<<1)) >> 1);
+	const rrr_biglength remaining_length = (rrr_biglength) encoded_size + (qos > 0 ? 2 : 0) + payload_size;
+	if (remaining_length > 0xfffffff) {
+		RRR_MSG_0("PUBLISH too large in MQTT session store\n");
+		ret = 1;
+		goto out;
+	}
+
+	if ((wire = rrr_allocate(1 + 4 + remaining_length)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	char *wpos = wire;
+
+	*(wpos++) = (char) ((RRR_MQTT_P_TYPE_PUBLISH << 4) | type_flags);
+	wpos += __rrr_mqtt_session_store_put_variable_int(wpos, (rrr_length) remaining_length);
+	memcpy(wpos, encoded, topic_size);
+	wpos += topic_size;
+	if (qos > 0) {
+		*(wpos++) = 0;
+		*(wpos++) = 1;
+	}
+	memcpy(wpos, encoded + topic_size, encoded_size - topic_size);
+	wpos += encoded_size - topic_size;
+	if (payload_size > 0) {
+		memcpy(wpos, payload, payload_size);
+		wpos += payload_size;
+	}
+
+	rrr_mqtt_parse_session_update(&parse_session, wire, (rrr_biglength) (wpos - wire), protocol_version);
+	rrr_mqtt_packet_parse(&parse_session);
+
+	if (!RRR_MQTT_PARSE_IS_COMPLETE(&parse_session) || parse_session.type != RRR_MQTT_P_TYPE_PUBLISH) {
+		RRR_MSG_0("Failed to parse PUBLISH from MQTT session store\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (RRR_MQTT_PARSE_STATUS_IS_MOVE_PAYLOAD_TO_PACKET(&parse_session)) {
+		const char *payload_start = wire + parse_session.payload_pos;
+		if ((ret = rrr_mqtt_p_payload_new_with_allocated_payload (
+				&parse_session.packet->payload,
+				&wire, // Set to NULL if success
+				payload_start,
+				rrr_length_from_ptr_sub_bug_const (wpos, payload_start)
+		)) != 0) {
+			RRR_MSG_0("Could not move payload to packet in %s\n", __func__);
+			goto out;
+		}
+	}
+
+	rrr_mqtt_packet_parse_session_extract_packet(&packet, &parse_session);
+
+	struct rrr_mqtt_p_publish *publish = (struct rrr_mqtt_p_publish *) packet;
+
+	struct rrr_mqtt_common_parse_properties_data_publish callback_data = {
+			0,
+			publish
+	};
+
+	uint8_t reason_v5 = 0;
+	if ((ret = rrr_mqtt_common_parse_properties (
+			&reason_v5,
+			&publish->properties,
+			rrr_mqtt_common_parse_publish_properties_callback,
+			(struct rrr_mqtt_common_handle_properties_data *) &callback_data
+	)) != 0 || reason_v5 != RRR_MQTT_P_5_REASON_OK) {
+		RRR_MSG_0("Failed to parse PUBLISH properties from MQTT session store\n");
+		ret = 1;
+		goto out;
+	}
+
+	publish->packet_identifier = 0;
+	publish->create_time = create_time;
+
+	*target = publish;
+	packet = NULL;
+
+	out:
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(packet);
+	rrr_mqtt_parse_session_destroy(&parse_session);
+	RRR_FREE_IF_NOT_NULL(wire);
+	return ret;
+}
+
+int rrr_mqtt_session_store_reader_get_subscriptions (
+		struct rrr_mqtt_subscription_collection *target,
+		struct rrr_mqtt_session_store_reader *reader
+) {
+	int ret = 0;
+
+	char *topic_filter = NULL;
+	uint32_t count;
+
+	if ((ret = rrr_mqtt_session_store_reader_get_u32(&count, reader)) != 0) {
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint8_t retain_handling, rap, nl, qos;
+
+		RRR_FREE_IF_NOT_NULL(topic_filter);
+
+		if ((ret = rrr_mqtt_session_store_reader_get_str(&topic_filter, reader)) != 0 ||
+		    (ret = rrr_mqtt_session_store_reader_get_u8(&retain_handling, reader)) != 0 ||
+		    (ret = rrr_mqtt_session_store_reader_get_u8(&rap, reader)) != 0 ||
+		    (ret = rrr_mqtt_session_store_reader_get_u8(&nl, reader)) != 0 ||
+		    (ret = rrr_mqtt_session_store_reader_get_u8(&qos, reader)) != 0
+		) {
+			goto out;
+		}
+
+		if (rrr_mqtt_topic_filter_validate_name(topic_filter) != 0) {
+			RRR_MSG_0("Invalid topic filter '%s' in MQTT session store\n", topic_filter);
+			ret = 1;
+			goto out;
+		}
+
+		if ((ret = rrr_mqtt_subscription_collection_push_unique_str (
+				target,
+				topic_filter,
+				retain_handling,
+				rap,
+				nl,
+				qos
+		)) != RRR_MQTT_SUBSCRIPTION_OK && ret != RRR_MQTT_SUBSCRIPTION_REPLACED) {
+			RRR_MSG_0("Could not add subscription in %s\n", __func__);
+			ret = 1;
+			goto out;
+		}
+
+		ret = 0;
+	}
+
+	out:
+	RRR_FREE_IF_NOT_NULL(topic_filter);
+	return ret;
+}
+
+static int __rrr_mqtt_session_store_write (
+		int fd,
+		const char *path,
+		const char *data,
+		rrr_length size
+) {
+	while (size > 0) {
+		ssize_t bytes = write(fd, data, size);
+		if (bytes < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			RRR_MSG_0("Failed to write to MQTT session store '%s': %s\n",
+					path, rrr_strerror(errno));
+			return 1;
+		}
+		data += bytes;
+		size -= (rrr_length) bytes;
+	}
+
+	return 0;
+}
+
+static int __rrr_mqtt_session_store_read (
+		rrr_length *bytes_read,
+		int fd,
+		char *target,
+		rrr_length size
+) {
+	*bytes_read = 0;
+
+	while (*bytes_read < size) {
+		ssize_t bytes = read(fd, target + *bytes_read, size - *bytes_read);
+		if (bytes < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			RRR_MSG_0("Failed to read from MQTT session store: %s\n", rrr_strerror(errno));
+			return 1;
+		}
+		if (bytes == 0) {
+			break;
+		}
+		*bytes_read += (rrr_length) bytes;
+	}
+
+	return 0;
+}
+
+static int __rrr_mqtt_session_store_pread (
+		int fd,
+		const char *path,
+		char *target,
+		rrr_length size,
+		rrr_biglength offset
+) {
+	rrr_length pos = 0;
+
+	while (pos < size) {
+		ssize_t bytes = pread(fd, target + pos, size - pos, (off_t) (offset + pos));
+		if (bytes < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			RRR_MSG_0("Failed to read from MQTT session store '%s': %s\n", path, rrr_strerror(errno));
+			return 1;
+		}
+		if (bytes == 0) {
+			RRR_MSG_0("Unexpected end of file while reading from MQTT session store '%s'\n", path);
+			return 1;
+		}
+		pos += (rrr_length) bytes;
+	}
+
+	return 0;
+}
+
+static int __rrr_mqtt_session_store_replay (
+		rrr_biglength *valid_size,
+		int fd,
+		const char *path,
+		int (*replay_callback)(RRR_MQTT_SESSION_STORE_REPLAY_CALLBACK_ARGS),
+		void *replay_callback_arg
+) {
+	int ret = 0;
+
+	char *buf = NULL;
+	rrr_length buf_size = 0;
+	rrr_length bytes_read = 0;
+	rrr_length record_count = 0;
+
+	char head[RRR_MQTT_SESSION_STORE_RECORD_HEAD_SIZE];
+
+	*valid_size = RRR_MQTT_SESSION_STORE_MAGIC_SIZE;
+
+	while (1) {
+		if ((ret = __rrr_mqtt_session_store_read(&bytes_read, fd, head, sizeof(head))) != 0) {
+			goto out;
+		}
+
+		if (bytes_read == 0) {
+			break;
+		}
+
+		const uint32_t size = __rrr_mqtt_session_store_get_u32(head);
+		if (bytes_read < sizeof(head) || size > RRR_MQTT_SESSION_STORE_RECORD_MAX_SIZE) {
+			RRR_MSG_0("Warning: Truncated or invalid record header in MQTT session store '%s', discarding the rest of the file\n", path);
+			break;
+		}
+
+		const rrr_length record_size = 1 + size + RRR_MQTT_SESSION_STORE_RECORD_TAIL_SIZE;
+		if (record_size > buf_size) {
+			char *buf_new = rrr_reallocate(buf, record_size);
+			if (buf_new == NULL) {
+				RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+				ret = 1;
+				goto out;
+			}
+			buf = buf_new;
+			buf_size = record_size;
+		}
+
+		// Type is included in CRC calculation
+		buf[0] = head[4];
+
+		if ((ret = __rrr_mqtt_session_store_read(&bytes_read, fd, buf + 1, record_size - 1)) != 0) {
+			goto out;
+		}
+
+		if (bytes_read < record_size - 1) {
+			RRR_MSG_0("Warning: Truncated record in MQTT session store '%s', discarding the rest of the file\n", path);
+			break;
+		}
+
+		if (rrr_crc32cmp(buf, 1 + size, __rrr_mqtt_session_store_get_u32(buf + 1 + size)) != 0) {
+			RRR_MSG_0("Warning: Checksum mismatch for record in MQTT session store '%s', discarding the rest of the file\n", path);
+			break;
+		}
+
+		struct rrr_mqtt_session_store_reader reader = {
+			buf + 1,
+			buf + 1 + size
+		};
+
+		if ((ret = replay_callback((uint8_t) buf[0], *valid_size, &reader, replay_callback_arg)) != 0) {
+			RRR_MSG_0("Failed to replay record of type %u from MQTT session store '%s'\n", (uint8_t) buf[0], path);
+			goto out;
+		}
+
+		*valid_size += sizeof(head) + size + RRR_MQTT_SESSION_STORE_RECORD_TAIL_SIZE;
+		record_count++;
+	}
+
+	RRR_DBG_1("Replayed %" PRIrrrl " records from MQTT session store '%s'\n", record_count, path);
+
+	out:
+	RRR_FREE_IF_NOT_NULL(buf);
+	return ret;
+}
+
+int rrr_mqtt_session_store_read (
+		struct rrr_mqtt_session_store *store,
+		rrr_biglength offset,
+		int (*callback)(RRR_MQTT_SESSION_STORE_REPLAY_CALLBACK_ARGS),
+		void *callback_arg
+) {
+	int ret = 0;
+
+	char *buf = NULL;
+	char head[RRR_MQTT_SESSION_STORE_RECORD_HEAD_SIZE];
+
+	if (offset < RRR_MQTT_SESSION_STORE_MAGIC_SIZE || offset + sizeof(head) > store->log_size) {
+		RRR_BUG("BUG: Offset %" PRIrrrbl " out of range in %s\n", offset, __func__);
+	}
+
+	if ((ret = __rrr_mqtt_session_store_pread(store->fd, store->path, head, sizeof(head), offset)) != 0) {
+		goto out;
+	}
+
+	const uint32_t size = __rrr_mqtt_session_store_get_u32(head);
+	if (size > RRR_MQTT_SESSION_STORE_RECORD_MAX_SIZE || offset + sizeof(head) + size + RRR_MQTT_SESSION_STORE_RECORD_TAIL_SIZE > store->log_size) {
+		RRR_MSG_0("Invalid record header at offset %" PRIrrrbl " in MQTT session store '%s'\n", offset, store->path);
+		ret = 1;
+		goto out;
+	}
+
+	const rrr_length record_size = 1 + size + RRR_MQTT_SESSION_STORE_RECORD_TAIL_SIZE;
+	if ((buf = rrr_allocate(record_size)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	// Type is included in CRC calculation
+	buf[0] = head[4];
+
+	if ((ret = __rrr_mqtt_session_store_pread(store->fd, store->path, buf + 1, record_size - 1, offset + sizeof(head))) != 0) {
+		goto out;
+	}
+
+	if (rrr_crc32cmp(buf, 1 + size, __rrr_mqtt_session_store_get_u32(buf + 1 + size)) != 0) {
+		RRR_MSG_0("Checksum mismatch for record at offset %" PRIrrrbl " in MQTT session store '%s'\n", offset, store->path);
+		ret = 1;
+		goto out;
+	}
+
+	struct rrr_mqtt_session_store_reader reader = {
+		buf + 1,
+		buf + 1 + size
+	};
+
+	ret = callback((uint8_t) buf[0], offset, &reader, callback_arg);
+
+	out:
+	RRR_FREE_IF_NOT_NULL(buf);
+	return ret;
+}
+
+static int __rrr_mqtt_session_store_open_file (
+		rrr_biglength *valid_size,
+		const char *path,
+		int (*replay_callback)(RRR_MQTT_SESSION_STORE_REPLAY_CALLBACK_ARGS),
+		void *replay_callback_arg
+) {
+	int fd = 0;
+	char magic[RRR_MQTT_SESSION_STORE_MAGIC_SIZE];
+	rrr_length bytes_read = 0;
+
+	*valid_size = 0;
+
+	if ((fd = rrr_socket_open(path, O_CREAT|O_RDWR, 0600, "mqtt_session_store", 0)) <= 0) {
+		RRR_MSG_0("Could not open MQTT session store '%s': %s\n", path, rrr_strerror(errno));
+		goto out_fail;
+	}
+
+	if (__rrr_mqtt_session_store_read(&bytes_read, fd, magic, sizeof(magic)) != 0) {
+		goto out_fail;
+	}
+
+	if (bytes_read == 0) {
+		if (__rrr_mqtt_session_store_write(fd, path, RRR_MQTT_SESSION_STORE_MAGIC, RRR_MQTT_SESSION_STORE_MAGIC_SIZE) != 0) {
+			goto out_fail;
+		}
+		*valid_size = RRR_MQTT_SESSION_STORE_MAGIC_SIZE;
+		goto out;
+	}
+
+	if (bytes_read != sizeof(magic) || memcmp(magic, RRR_MQTT_SESSION_STORE_MAGIC, sizeof(magic)) != 0) {
+		RRR_MSG_0("File '%s' is not an MQTT session store\n", path);
+		goto out_fail;
+	}
+
+	if (__rrr_mqtt_session_store_replay(valid_size, fd, path, replay_callback, replay_callback_arg) != 0) {
+		goto out_fail;
+	}
+
+	// Discard any partially written record at the end
+	if (ftruncate(fd, (off_t) *valid_size) != 0 || lseek(fd, (off_t) *valid_size, SEEK_SET) < 0) {
+		RRR_MSG_0("Could not truncate MQTT session store '%s': %s\n", path, rrr_strerror(errno));
+		goto out_fail;
+	}
+
+	goto out;
+	out_fail:
+		if (fd > 0) {
+			rrr_socket_close(fd);
+		}
+		fd = -1;
+	out:
+		return fd;
+}
+
+// Make the rename() of a rewritten log persistent
+static int __rrr_mqtt_session_store_sync_directory (
+		const char *path
+) {
+	int ret = 0;
+
+	char *dir = NULL;
+	int fd = 0;
+
+	if ((dir = rrr_strdup(strchr(path, '/') != NULL ? path : "./")) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	// Keep the slash if the file is in the root directory
+	char *slash = strrchr(dir, '/');
+	*(slash == dir ? slash + 1 : slash) = '\0';
+
+	if ((fd = rrr_socket_open(dir, O_RDONLY|O_DIRECTORY, 0, "mqtt_session_store_dir", 0)) <= 0) {
+		RRR_MSG_0("Could not open directory '%s' of MQTT session store: %s\n", dir, rrr_strerror(errno));
+		fd = 0;
+		ret = 1;
+		goto out;
+	}
+
+	if (fsync(fd) != 0) {
+		RRR_MSG_0("fsync failed for directory '%s' of MQTT session store: %s\n", dir, rrr_strerror(errno));
+		ret = 1;
+		goto out;
+	}
+
+	out:
+	if (fd > 0) {
+		rrr_socket_close(fd);
+	}
+	RRR_FREE_IF_NOT_NULL(dir);
+	return ret;
+}
+
+// The sync thread performs fdatasync() and fsync() which may take a long
+// time, the caller may be holding locks shared with other threads. The
+// file descriptor of a job is a duplicate owned by the sync thread, the
+// caller is free to close its own descriptor meanwhile.
+static void *__rrr_mqtt_session_store_sync_thread (
+		void *arg
+) {
+	struct rrr_mqtt_session_store *store = arg;
+
+	pthread_mutex_lock(&store->sync_lock);
+	while (1) {
+		while (!store->sync_busy && !store->sync_stop) {
+			pthread_cond_wait(&store->sync_cond, &store->sync_lock);
+		}
+
+		// Any posted job is completed before stopping
+		if (!store->sync_busy) {
+			break;
+		}
+
+		const int fd = store->sync_fd;
+		const int do_sync_directory = store->sync_directory;
+
+		pthread_mutex_unlock(&store->sync_lock);
+
+		int failed = 0;
+
+		if (fd > 0) {
+			if (fdatasync(fd) != 0) {
+				RRR_MSG_0("fdatasync failed for MQTT session store '%s': %s\n",
+						store->path, rrr_strerror(errno));
+				failed = 1;
+			}
+			close(fd);
+		}
+
+		// The new log is already in place and its content synced, a failure
+		// only means that the old log might reappear after a power loss
+		if (do_sync_directory && __rrr_mqtt_session_store_sync_directory(store->path) != 0) {
+			RRR_MSG_0("Warning: Rename of rewritten MQTT session store '%s' may not be persistent\n", store->path);
+		}
+
+		pthread_mutex_lock(&store->sync_lock);
+
+		store->sync_fd = 0;
+		store->sync_directory = 0;
+		store->sync_failed |= failed;
+		store->sync_busy = 0;
+
+		pthread_cond_broadcast(&store->sync_cond);
+	}
+	pthread_mutex_unlock(&store->sync_lock);
+
+	return NULL;
+}
+
+// Returns 1 if a job completed since the last poll has failed
+static int __rrr_mqtt_session_store_sync_poll (
+		int *is_busy,
+		struct rrr_mqtt_session_store *store,
+		int do_wait
+) {
+	int ret = 0;
+
+	pthread_mutex_lock(&store->sync_lock);
+
+	while (do_wait && store->sync_busy) {
+		pthread_cond_wait(&store->sync_cond, &store->sync_lock);
+	}
+
+	*is_busy = store->sync_busy;
+
+	if (!store->sync_busy) {
+		ret = store->sync_failed;
+		store->sync_failed = 0;
+	}
+
+	pthread_mutex_unlock(&store->sync_lock);
+
+	return ret;
+}
+
+// The sync thread must not be busy
+static int __rrr_mqtt_session_store_sync_post (
+		struct rrr_mqtt_session_store *store,
+		int fd,
+		int do_sync_directory
+) {
+	int fd_dup = 0;
+
+	if (fd > 0 && (fd_dup = dup(fd)) < 0) {
+		RRR_MSG_0("Could not duplicate file descriptor of MQTT session store '%s': %s\n",
+				store->path, rrr_strerror(errno));
+		return 1;
+	}
+
+	pthread_mutex_lock(&store->sync_lock);
+
+	if (store->sync_busy) {
+		RRR_BUG("BUG: Sync thread busy in %s\n", __func__);
+	}
+
+	store->sync_fd = fd_dup;
+	store->sync_directory = do_sync_directory;
+	store->sync_busy = 1;
+
+	pthread_cond_broadcast(&store->sync_cond);
+	pthread_mutex_unlock(&store->sync_lock);
+
+	return 0;
+}
+
+int rrr_mqtt_session_store_open (
+		struct rrr_mqtt_session_store **target,
+		const char *path,
+		uint64_t sync_interval_ms,
+		int (*replay_callback)(RRR_MQTT_SESSION_STORE_REPLAY_CALLBACK_ARGS),
+		void *replay_callback_arg
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_session_store *store = NULL;
+
+	*target = NULL;
+
+	if ((store = rrr_allocate_zero(sizeof(*store))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	if ((store->path = rrr_strdup(path)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out_free;
+	}
+
+	if (rrr_asprintf(&store->path_rewrite, "%s.new", path) <= 0) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out_free_path;
+	}
+
+	if ((store->fd = __rrr_mqtt_session_store_open_file (
+			&store->log_size,
+			path,
+			replay_callback,
+			replay_callback_arg
+	)) < 0) {
+		ret = 1;
+		goto out_free_path_rewrite;
+	}
+
+	if (rrr_posix_mutex_init(&store->sync_lock, 0) != 0) {
+		RRR_MSG_0("Could not initialize lock in %s\n", __func__);
+		ret = 1;
+		goto out_close;
+	}
+
+	if (rrr_posix_cond_init(&store->sync_cond, 0) != 0) {
+		RRR_MSG_0("Could not initialize condition in %s\n", __func__);
+		ret = 1;
+		goto out_destroy_lock;
+	}
+
+	if (pthread_create(&store->sync_thread, NULL, __rrr_mqtt_session_store_sync_thread, store) != 0) {
+		RRR_MSG_0("Could not create sync thread in %s\n", __func__);
+		ret = 1;
+		goto out_destroy_cond;
+	}
+
+	store->sync_interval_us = sync_interval_ms * 1000;
+	store->prev_sync_time = rrr_time_get_64();
+	store->log_size_after_rewrite = store->log_size;
+
+	*target = store;
+
+	goto out;
+	out_destroy_cond:
+		pthread_cond_destroy(&store->sync_cond);
+	out_destroy_lock:
+		pthread_mutex_destroy(&store->sync_lock);
+	out_close:
+		rrr_socket_close(store->fd);
+	out_free_path_rewrite:
+		rrr_free(store->path_rewrite);
+	out_free_path:
+		rrr_free(store->path);
+	out_free:
+		rrr_free(store);
+	out:
+		return ret;
+}
+
+static void __rrr_mqtt_session_store_rewrite_abort (
+		struct rrr_mqtt_session_store *store
+) {
+	rrr_socket_close(store->fd_rewrite);
+	store->fd_rewrite = 0;
+	store->rewrite_is_pending = 0;
+	store->rewrite_sync_posted = 0;
+	unlink(store->path_rewrite);
+}
+
+void rrr_mqtt_session_store_close (
+		struct rrr_mqtt_session_store *store
+) {
+	pthread_mutex_lock(&store->sync_lock);
+	store->sync_stop = 1;
+	pthread_cond_broadcast(&store->sync_cond);
+	pthread_mutex_unlock(&store->sync_lock);
+
+	pthread_join(store->sync_thread, NULL);
+
+	if (store->fd_rewrite > 0) {
+		__rrr_mqtt_session_store_rewrite_abort(store);
+	}
+
+	if (store->is_dirty && fdatasync(store->fd) != 0) {
+		RRR_MSG_0("fdatasync failed for MQTT session store '%s': %s\n",
+				store->path, rrr_strerror(errno));
+	}
+
+	rrr_socket_close(store->fd);
+	pthread_cond_destroy(&store->sync_cond);
+	pthread_mutex_destroy(&store->sync_lock);
+	rrr_free(store->path_rewrite);
+	rrr_free(store->path);
+	rrr_free(store);
+}
+
+int rrr_mqtt_session_store_sync (
+		struct rrr_mqtt_session_store *store
+) {
+	int is_busy;
+
+	if (__rrr_mqtt_session_store_sync_poll(&is_busy, store, 0) != 0) {
+		return 1;
+	}
+
+	if (is_busy || !store->is_dirty || rrr_time_get_64() < store->prev_sync_time + store->sync_interval_us) {
+		return 0;
+	}
+
+	store->prev_sync_time = rrr_time_get_64();
+	store->is_dirty = 0;
+
+	return __rrr_mqtt_session_store_sync_post(store, store->fd, 0);
+}
+
+int rrr_mqtt_session_store_append_with_offset (
+		rrr_biglength *offset,
+		struct rrr_mqtt_session_store *store,
+		uint8_t type,
+		struct rrr_mqtt_session_store_record *record
+) {
+	char *tail;
+
+	// Ensures head space is reserved for empty records
+	if (__rrr_mqtt_session_store_record_reserve(&tail, record, 0) != 0) {
+		return 1;
+	}
+
+	const rrr_length size = record->size - RRR_MQTT_SESSION_STORE_RECORD_HEAD_SIZE;
+
+	__rrr_mqtt_session_store_put_u32(record->data, size);
+	record->data[4] = (char) type;
+	__rrr_mqtt_session_store_put_u32(tail, rrr_crc32buf(record->data + 4, 1 + size));
+
+	const rrr_length total_size = record->size + RRR_MQTT_SESSION_STORE_RECORD_TAIL_SIZE;
+
+	// Records appended while a committed rewrite is pending go to the old
+	// log and are copied to the new log once it is in place
+	if (store->fd_rewrite > 0 && !store->rewrite_is_pending) {
+		*offset = store->log_size_rewrite;
+		store->log_size_rewrite += total_size;
+		return __rrr_mqtt_session_store_write(store->fd_rewrite, store->path_rewrite, record->data, total_size);
+	}
+
+	if (__rrr_mqtt_session_store_write(store->fd, store->path, record->data, total_size) != 0) {
+		return 1;
+	}
+
+	*offset = store->log_size;
+	store->log_size += total_size;
+	store->is_dirty = 1;
+
+	return rrr_mqtt_session_store_sync(store);
+}
+
+int rrr_mqtt_session_store_append (
+		struct rrr_mqtt_session_store *store,
+		uint8_t type,
+		struct rrr_mqtt_session_store_record *record
+) {
+	rrr_biglength offset_dummy;
+	return rrr_mqtt_session_store_append_with_offset(&offset_dummy, store, type, record);
+}
+
+int rrr_mqtt_session_store_rewrite_needed (
+		const struct rrr_mqtt_session_store *store
+) {
+	return store->fd_rewrite <= 0 &&
+	       store->log_size > RRR_MQTT_SESSION_STORE_REWRITE_MIN_SIZE &&
+	       store->log_size > store->log_size_after_rewrite * 2;
+}
+
+int rrr_mqtt_session_store_rewrite_is_pending (
+		const struct rrr_mqtt_session_store *store
+) {
+	return store->rewrite_is_pending;
+}
+
+int rrr_mqtt_session_store_rewrite_begin (
+		struct rrr_mqtt_session_store *store
+) {
+	if (store->fd_rewrite > 0) {
+		RRR_BUG("BUG: Rewrite already in progress in %s\n", __func__);
+	}
+
+	if ((store->fd_rewrite = rrr_socket_open(store->path_rewrite, O_CREAT|O_TRUNC|O_RDWR, 0600, "mqtt_session_store", 0)) <= 0) {
+		RRR_MSG_0("Could not open MQTT session store '%s': %s\n", store->path_rewrite, rrr_strerror(errno));
+		store->fd_rewrite = 0;
+		return 1;
+	}
+
+	if (__rrr_mqtt_session_store_write (
+			store->fd_rewrite,
+			store->path_rewrite,
+			RRR_MQTT_SESSION_STORE_MAGIC,
+			RRR_MQTT_SESSION_STORE_MAGIC_SIZE
+	) != 0) {
+		__rrr_mqtt_session_store_rewrite_abort(store);
+		return 1;
+	}
+
+	store->log_size_rewrite = RRR_MQTT_SESSION_STORE_MAGIC_SIZE;
+
+	return 0;
+}
+
+int rrr_mqtt_session_store_rewrite_end (
+		struct rrr_mqtt_session_store *store,
+		int do_commit
+) {
+	if (store->fd_rewrite <= 0 || store->rewrite_is_pending) {
+		RRR_BUG("BUG: No rewrite in progress in %s\n", __func__);
+	}
+
+	if (!do_commit) {
+		__rrr_mqtt_session_store_rewrite_abort(store);
+		return 0;
+	}
+
+	store->rewrite_is_pending = 1;
+	store->log_size_pending = store->log_size;
+
+	return 0;
+}
+
+// Copy records appended to the old log while the rewrite was pending
+static int __rrr_mqtt_session_store_rewrite_copy_tail (
+		struct rrr_mqtt_session_store *store
+) {
+	int ret = 0;
+
+	char buf[8192];
+	rrr_biglength pos = store->log_size_pending;
+
+	while (pos < store->log_size) {
+		const rrr_length size = store->log_size - pos > sizeof(buf) ? sizeof(buf) : (rrr_length) (store->log_size - pos);
+
+		if ( (ret = __rrr_mqtt_session_store_pread(store->fd, store->path, buf, size, pos)) != 0 ||
+		     (ret = __rrr_mqtt_session_store_write(store->fd_rewrite, store->path_rewrite, buf, size)) != 0
+		) {
+			goto out;
+		}
+
+		pos += size;
+	}
+
+	out:
+	return ret;
+}
+
+int rrr_mqtt_session_store_rewrite_complete (
+		int *is_complete,
+		rrr_biglength *tail_offset,
+		rrr_biglength *tail_offset_new,
+		struct rrr_mqtt_session_store *store,
+		int do_wait
+) {
+	int is_busy;
+
+	*is_complete = 0;
+	*tail_offset = 0;
+	*tail_offset_new = 0;
+
+	if (!store->rewrite_is_pending) {
+		RRR_BUG("BUG: No rewrite pending in %s\n", __func__);
+	}
+
+	if (__rrr_mqtt_session_store_sync_poll(&is_busy, store, do_wait) != 0) {
+		goto out_abort;
+	}
+
+	if (is_busy) {
+		return 0;
+	}
+
+	if (!store->rewrite_sync_posted) {
+		if (__rrr_mqtt_session_store_sync_post(store, store->fd_rewrite, 0) != 0) {
+			goto out_abort;
+		}
+
+		store->rewrite_sync_posted = 1;
+
+		if (!do_wait) {
+			return 0;
+		}
+
+		if (__rrr_mqtt_session_store_sync_poll(&is_busy, store, 1) != 0) {
+			goto out_abort;
+		}
+	}
+
+	// The new log is synced up to the size it had when the rewrite was
+	// ended. Records copied from the old log are synced with the next
+	// interval.
+	if (__rrr_mqtt_session_store_rewrite_copy_tail(store) != 0) {
+		goto out_abort;
+	}
+
+	if (rename(store->path_rewrite, store->path) != 0) {
+		RRR_MSG_0("Could not rename MQTT session store '%s' to '%s': %s\n",
+				store->path_rewrite, store->path, rrr_strerror(errno));
+		goto out_abort;
+	}
+
+	const rrr_biglength tail_size = store->log_size - store->log_size_pending;
+
+	RRR_DBG_1("Rewrote MQTT session store '%s', size reduced from %" PRIrrrbl " to %" PRIrrrbl " bytes\n",
+			store->path, store->log_size, store->log_size_rewrite + tail_size);
+
+	rrr_socket_close(store->fd);
+
+	*is_complete = 1;
+	*tail_offset = store->log_size_pending;
+	*tail_offset_new = store->log_size_rewrite;
+
+	store->fd = store->fd_rewrite;
+	store->fd_rewrite = 0;
+	store->rewrite_is_pending = 0;
+	store->rewrite_sync_posted = 0;
+	store->log_size = store->log_size_rewrite + tail_size;
+	store->log_size_after_rewrite = store->log_size_rewrite;
+	store->log_size_rewrite = 0;
+	store->log_size_pending = 0;
+	store->is_dirty = tail_size > 0;
+	store->prev_sync_time = rrr_time_get_64();
+
+	// Make the rename() persistent
+	if (__rrr_mqtt_session_store_sync_post(store, 0, 1) != 0) {
+		return 1;
+	}
+
+	if (do_wait) {
+		return __rrr_mqtt_session_store_sync_poll(&is_busy, store, 1);
+	}
+
+	return 0;
+
+	out_abort:
+		__rrr_mqtt_session_store_rewrite_abort(store);
+		return 1;
+}
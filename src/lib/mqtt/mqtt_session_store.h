@@ -0,0 +1,189 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RRR_MQTT_SESSION_STORE_H
+#define RRR_MQTT_SESSION_STORE_H
+
+#include <stdint.h>
+
+#include "../rrr_types.h"
+
+// The session store is an append-only log of records describing changes
+// to broker state. Upon opening, all records are passed to a replay
+// callback which rebuilds the in-memory state. The log is compacted by
+// rewriting a snapshot of the current state to a new file which then
+// replaces the old one.
+//
+// Records are written immediately while fsync() is only performed at the
+// given interval. A crash of the program itself will therefore not lose
+// any records while a power loss may lose records written during the last
+// interval. A partially written record at the end of the log is discarded
+// upon replay. Syncing is done by a separate thread, the caller does not
+// wait for the disk.
+//
+// A record may be read back using its offset in the log, which allows
+// the user to keep large data in the log only. Offsets are only valid
+// until the next rewrite. While a rewrite is in progress, reads are done
+// from the old log while appended records go to the new log.
+//
+// A committed rewrite is pending until the new log has been synced. Records
+// appended meanwhile go to the old log and are copied to the end of the new
+// log when it replaces the old one. The offset of such a record in the new
+// log is its offset in the old log minus tail_offset plus tail_offset_new
+// as reported upon completion.
+
+#define RRR_MQTT_SESSION_STORE_RECORD_RETAIN          1
+#define RRR_MQTT_SESSION_STORE_RECORD_SESSION         2
+#define RRR_MQTT_SESSION_STORE_RECORD_SESSION_DELETE  3
+#define RRR_MQTT_SESSION_STORE_RECORD_PUBLISH         4
+#define RRR_MQTT_SESSION_STORE_RECORD_ACK             5
+
+#define RRR_MQTT_SESSION_STORE_REPLAY_CALLBACK_ARGS \
+    uint8_t type, rrr_biglength offset, struct rrr_mqtt_session_store_reader *reader, void *arg
+
+struct rrr_mqtt_p_publish;
+struct rrr_mqtt_subscription_collection;
+struct rrr_mqtt_session_store;
+
+struct rrr_mqtt_session_store_record {
+	char *data;
+	rrr_length size;
+	rrr_length size_allocated;
+};
+
+struct rrr_mqtt_session_store_reader {
+	const char *pos;
+	const char *end;
+};
+
+void rrr_mqtt_session_store_record_clear (
+		struct rrr_mqtt_session_store_record *record
+);
+int rrr_mqtt_session_store_record_push_u8 (
+		struct rrr_mqtt_session_store_record *record,
+		uint8_t value
+);
+int rrr_mqtt_session_store_record_push_u32 (
+		struct rrr_mqtt_session_store_record *record,
+		uint32_t value
+);
+int rrr_mqtt_session_store_record_push_u64 (
+		struct rrr_mqtt_session_store_record *record,
+		uint64_t value
+);
+int rrr_mqtt_session_store_record_push_blob (
+		struct rrr_mqtt_session_store_record *record,
+		const void *data,
+		rrr_length size
+);
+int rrr_mqtt_session_store_record_push_str (
+		struct rrr_mqtt_session_store_record *record,
+		const char *str
+);
+int rrr_mqtt_session_store_record_push_publish (
+		struct rrr_mqtt_session_store_record *record,
+		const struct rrr_mqtt_p_publish *publish
+);
+int rrr_mqtt_session_store_record_push_subscriptions (
+		struct rrr_mqtt_session_store_record *record,
+		const struct rrr_mqtt_subscription_collection *subscriptions
+);
+int rrr_mqtt_session_store_reader_get_u8 (
+		uint8_t *target,
+		struct rrr_mqtt_session_store_reader *reader
+);
+int rrr_mqtt_session_store_reader_get_u32 (
+		uint32_t *target,
+		struct rrr_mqtt_session_store_reader *reader
+);
+int rrr_mqtt_session_store_reader_get_u64 (
+		uint64_t *target,
+		struct rrr_mqtt_session_store_reader *reader
+);
+int rrr_mqtt_session_store_reader_get_blob (
+		const char **target,
+		rrr_length *size,
+		struct rrr_mqtt_session_store_reader *reader
+);
+int rrr_mqtt_session_store_reader_get_str (
+		char **target,
+		struct rrr_mqtt_session_store_reader *reader
+);
+int rrr_mqtt_session_store_reader_get_publish (
+		struct rrr_mqtt_p_publish **target,
+		struct rrr_mqtt_session_store_reader *reader
+);
+int rrr_mqtt_session_store_reader_get_subscriptions (
+		struct rrr_mqtt_subscription_collection *target,
+		struct rrr_mqtt_session_store_reader *reader
+);
+int rrr_mqtt_session_store_open (
+		struct rrr_mqtt_session_store **target,
+		const char *path,
+		uint64_t sync_interval_ms,
+		int (*replay_callback)(RRR_MQTT_SESSION_STORE_REPLAY_CALLBACK_ARGS),
+		void *replay_callback_arg
+);
+void rrr_mqtt_session_store_close (
+		struct rrr_mqtt_session_store *store
+);
+int rrr_mqtt_session_store_append_with_offset (
+		rrr_biglength *offset,
+		struct rrr_mqtt_session_store *store,
+		uint8_t type,
+		struct rrr_mqtt_session_store_record *record
+);
+int rrr_mqtt_session_store_append (
+		struct rrr_mqtt_session_store *store,
+		uint8_t type,
+		struct rrr_mqtt_session_store_record *record
+);
+int rrr_mqtt_session_store_read (
+		struct rrr_mqtt_session_store *store,
+		rrr_biglength offset,
+		int (*callback)(RRR_MQTT_SESSION_STORE_REPLAY_CALLBACK_ARGS),
+		void *callback_arg
+);
+int rrr_mqtt_session_store_sync (
+		struct rrr_mqtt_session_store *store
+);
+int rrr_mqtt_session_store_rewrite_needed (
+		const struct rrr_mqtt_session_store *store
+);
+int rrr_mqtt_session_store_rewrite_begin (
+		struct rrr_mqtt_session_store *store
+);
+int rrr_mqtt_session_store_rewrite_end (
+		struct rrr_mqtt_session_store *store,
+		int do_commit
+);
+int rrr_mqtt_session_store_rewrite_is_pending (
+		const struct rrr_mqtt_session_store *store
+);
+int rrr_mqtt_session_store_rewrite_complete (
+		int *is_complete,
+		rrr_biglength *tail_offset,
+		rrr_biglength *tail_offset_new,
+		struct rrr_mqtt_session_store *store,
+		int do_wait
+);
+
+#endif /* RRR_MQTT_SESSION_STORE_H */
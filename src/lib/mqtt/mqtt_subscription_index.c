@@ -0,0 +1,432 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+
+#include "../log.h"
+#include "../allocator.h"
+
+#include "mqtt_subscription_index.h"
+#include "mqtt_subscription.h"
+#include "mqtt_packet.h"
+#include "mqtt_topic.h"
+
+#include "../util/hash.h"
+#include "../util/linked_list.h"
+#include "../util/macro_utils.h"
+
+struct rrr_mqtt_subscription_index_node;
+
+struct rrr_mqtt_subscription_index_entry {
+	RRR_LL_NODE(struct rrr_mqtt_subscription_index_entry);
+	struct rrr_mqtt_subscription_index_entry *owner_next;
+	struct rrr_mqtt_subscription_index_node *node;
+	void *owner;
+	const struct rrr_mqtt_subscription *subscription;
+};
+
+struct rrr_mqtt_subscription_index_node {
+	RRR_LL_HEAD(struct rrr_mqtt_subscription_index_entry);
+	struct rrr_mqtt_subscription_index_node *parent;
+	struct rrr_hash children;
+	struct rrr_mqtt_subscription_index_node *child_plus;
+	struct rrr_mqtt_subscription_index_node *child_hash;
+	// Must be last
+	char token[1];
+};
+
+struct rrr_mqtt_subscription_index {
+	struct rrr_mqtt_subscription_index_node *root;
+	// Owner pointer => first entry in the owner chain
+	struct rrr_hash owners;
+	rrr_length entry_count;
+};
+
+static int __rrr_mqtt_subscription_index_node_new (
+		struct rrr_mqtt_subscription_index_node **target,
+		struct rrr_mqtt_subscription_index_node *parent,
+		const char *token
+) {
+	struct rrr_mqtt_subscription_index_node *node;
+
+	*target = NULL;
+
+	const size_t token_length = strlen(token);
+
+	if ((node = rrr_allocate(sizeof(*node) + token_length)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		return 1;
+	}
+
+	memset(node, '\0', sizeof(*node));
+	memcpy(node->token, token, token_length + 1);
+
+	node->parent = parent;
+
+	*target = node;
+
+	return 0;
+}
+
+static void __rrr_mqtt_subscription_index_node_destroy (
+		struct rrr_mqtt_subscription_index_node *node
+);
+
+static int __rrr_mqtt_subscription_index_node_destroy_child_callback (RRR_HASH_ITERATE_CALLBACK_ARGS) {
+	(void)(key);
+	(void)(key_size);
+	(void)(arg);
+
+	__rrr_mqtt_subscription_index_node_destroy(value);
+
+	return RRR_HASH_ITERATE_REMOVE;
+}
+
+static void __rrr_mqtt_subscription_index_node_destroy (
+		struct rrr_mqtt_subscription_index_node *index_node
+) {
+	if (index_node == NULL) {
+		return;
+	}
+
+	rrr_hash_iterate(&index_node->children, __rrr_mqtt_subscription_index_node_destroy_child_callback, NULL);
+	rrr_hash_clear(&index_node->children);
+
+	__rrr_mqtt_subscription_index_node_destroy(index_node->child_plus);
+	__rrr_mqtt_subscription_index_node_destroy(index_node->child_hash);
+
+	RRR_LL_DESTROY(index_node, struct rrr_mqtt_subscription_index_entry, rrr_free(node));
+
+	rrr_free(index_node);
+}
+
+int rrr_mqtt_subscription_index_new (
+		struct rrr_mqtt_subscription_index **target
+) {
+	struct rrr_mqtt_subscription_index *index;
+
+	*target = NULL;
+
+	if ((index = rrr_allocate(sizeof(*index))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		return 1;
+	}
+
+	memset(index, '\0', sizeof(*index));
+
+	if (__rrr_mqtt_subscription_index_node_new(&index->root, NULL, "") != 0) {
+		rrr_free(index);
+		return 1;
+	}
+
+	*target = index;
+
+	return 0;
+}
+
+void rrr_mqtt_subscription_index_destroy (
+		struct rrr_mqtt_subscription_index *index
+) {
+	if (index == NULL) {
+		return;
+	}
+	__rrr_mqtt_subscription_index_node_destroy(index->root);
+	rrr_hash_clear(&index->owners);
+	rrr_free(index);
+}
+
+rrr_length rrr_mqtt_subscription_index_count (
+		const struct rrr_mqtt_subscription_index *index
+) {
+	return index->entry_count;
+}
+
+static struct rrr_mqtt_subscription_index_node **__rrr_mqtt_subscription_index_node_child_wildcard (
+		struct rrr_mqtt_subscription_index_node *node,
+		const char *token
+) {
+	if (token[0] == '+' && token[1] == '\0') {
+		return &node->child_plus;
+	}
+	if (token[0] == '#' && token[1] == '\0') {
+		return &node->child_hash;
+	}
+	return NULL;
+}
+
+// Remove nodes which no longer have any entries or children, starting at the given node
+static void __rrr_mqtt_subscription_index_node_prune (
+		struct rrr_mqtt_subscription_index_node *node
+) {
+	while ( node->parent != NULL &&
+	        RRR_LL_IS_EMPTY(node) &&
+	        RRR_HASH_COUNT(&node->children) == 0 &&
+	        node->child_plus == NULL &&
+	        node->child_hash == NULL
+	) {
+		struct rrr_mqtt_subscription_index_node *parent = node->parent;
+		struct rrr_mqtt_subscription_index_node **wildcard = __rrr_mqtt_subscription_index_node_child_wildcard(parent, node->token);
+
+		if (wildcard != NULL && *wildcard == node) {
+			*wildcard = NULL;
+		}
+		else if (rrr_hash_remove_str(&parent->children, node->token) != node) {
+			RRR_BUG("BUG: Node not found in parent in %s\n", __func__);
+		}
+
+		__rrr_mqtt_subscription_index_node_destroy(node);
+
+		node = parent;
+	}
+}
+
+void rrr_mqtt_subscription_index_owner_remove (
+		struct rrr_mqtt_subscription_index *index,
+		const void *owner
+) {
+	struct rrr_mqtt_subscription_index_entry *entry = rrr_hash_remove_ptr(&index->owners, owner);
+
+	while (entry != NULL) {
+		struct rrr_mqtt_subscription_index_entry *next = entry->owner_next;
+		struct rrr_mqtt_subscription_index_node *node = entry->node;
+
+		RRR_LL_REMOVE_NODE_NO_FREE(node, entry);
+		rrr_free(entry);
+		index->entry_count--;
+
+		__rrr_mqtt_subscription_index_node_prune(node);
+
+		entry = next;
+	}
+}
+
+static int __rrr_mqtt_subscription_index_node_get_or_create_child (
+		struct rrr_mqtt_subscription_index_node **target,
+		struct rrr_mqtt_subscription_index_node *node,
+		const char *token
+) {
+	struct rrr_mqtt_subscription_index_node **wildcard = __rrr_mqtt_subscription_index_node_child_wildcard(node, token);
+	struct rrr_mqtt_subscription_index_node *child = wildcard != NULL
+		? *wildcard
+		: rrr_hash_get_str(&node->children, token)
+	;
+
+	if (child == NULL) {
+		if (__rrr_mqtt_subscription_index_node_new(&child, node, token) != 0) {
+			return 1;
+		}
+
+		if (wildcard != NULL) {
+			*wildcard = child;
+		}
+		else if (rrr_hash_set_str(&node->children, child->token, child) != 0) {
+			__rrr_mqtt_subscription_index_node_destroy(child);
+			return 1;
+		}
+	}
+
+	*target = child;
+
+	return 0;
+}
+
+static int __rrr_mqtt_subscription_index_add (
+		struct rrr_mqtt_subscription_index *index,
+		void *owner,
+		const struct rrr_mqtt_subscription *subscription
+) {
+	struct rrr_mqtt_subscription_index_node *node = index->root;
+	struct rrr_mqtt_subscription_index_entry *entry = NULL;
+
+	for (const struct rrr_mqtt_topic_token *token = subscription->token_tree; token != NULL; token = token->next) {
+		if (__rrr_mqtt_subscription_index_node_get_or_create_child(&node, node, token->data) != 0) {
+			goto out_prune;
+		}
+	}
+
+	if ((entry = rrr_allocate(sizeof(*entry))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		goto out_prune;
+	}
+
+	memset(entry, '\0', sizeof(*entry));
+
+	entry->owner_next = rrr_hash_get_ptr(&index->owners, owner);
+	entry->node = node;
+	entry->owner = owner;
+	entry->subscription = subscription;
+
+	if (rrr_hash_set_ptr(&index->owners, owner, entry) != 0) {
+		goto out_free_entry;
+	}
+
+	RRR_LL_APPEND(node, entry);
+	index->entry_count++;
+
+	return 0;
+
+	out_free_entry:
+		rrr_free(entry);
+	out_prune:
+		__rrr_mqtt_subscription_index_node_prune(node);
+		return 1;
+}
+
+// Replace all entries of an owner with the subscriptions currently in the collection
+int rrr_mqtt_subscription_index_owner_update (
+		struct rrr_mqtt_subscription_index *index,
+		void *owner,
+		const struct rrr_mqtt_subscription_collection *subscriptions
+) {
+	int ret = RRR_MQTT_SUBSCRIPTION_OK;
+
+	rrr_mqtt_subscription_index_owner_remove(index, owner);
+
+	RRR_LL_ITERATE_BEGIN(subscriptions, const struct rrr_mqtt_subscription);
+		if (node->qos_or_reason_v5 > 2) {
+			RRR_LL_ITERATE_NEXT();
+		}
+		if (__rrr_mqtt_subscription_index_add(index, owner, node) != 0) {
+			RRR_MSG_0("Could not add subscription '%s' to index in %s\n", node->topic_filter, __func__);
+			rrr_mqtt_subscription_index_owner_remove(index, owner);
+			ret = RRR_MQTT_SUBSCRIPTION_INTERNAL_ERROR;
+			RRR_LL_ITERATE_BREAK();
+		}
+	RRR_LL_ITERATE_END();
+
+	return ret;
+}
+
+struct rrr_mqtt_subscription_index_match_data {
+	const struct rrr_mqtt_p_publish *publish;
+	int (*match_callback) (
+			const struct rrr_mqtt_p_publish *publish,
+			const struct rrr_mqtt_subscription *subscription,
+			void *owner,
+			void *callback_arg
+	);
+	void *callback_arg;
+	rrr_length match_count;
+};
+
+static int __rrr_mqtt_subscription_index_match_deliver (
+		struct rrr_mqtt_subscription_index_match_data *match_data,
+		const struct rrr_mqtt_subscription_index_node *index_node
+) {
+	int ret = RRR_MQTT_SUBSCRIPTION_OK;
+
+	if (index_node == NULL) {
+		goto out;
+	}
+
+	RRR_LL_ITERATE_BEGIN(index_node, const struct rrr_mqtt_subscription_index_entry);
+		if ((ret = match_data->match_callback (
+				match_data->publish,
+				node->subscription,
+				node->owner,
+				match_data->callback_arg
+		)) != 0) {
+			RRR_MSG_0("Error from match_callback in %s: %i\n", __func__, ret);
+			ret = RRR_MQTT_SUBSCRIPTION_INTERNAL_ERROR;
+			goto out;
+		}
+		rrr_length_inc_bug(&match_data->match_count);
+	RRR_LL_ITERATE_END();
+
+	out:
+	return ret;
+}
+
+// Matching rules are equal to rrr_mqtt_topic_match_tokens_recursively
+static int __rrr_mqtt_subscription_index_match (
+		struct rrr_mqtt_subscription_index_match_data *match_data,
+		const struct rrr_mqtt_subscription_index_node *node,
+		const struct rrr_mqtt_topic_token *token
+) {
+	int ret = RRR_MQTT_SUBSCRIPTION_OK;
+
+	const int is_dollar = *(token->data) == '$';
+	const struct rrr_mqtt_subscription_index_node *child;
+
+	if ((child = rrr_hash_get_str(&node->children, token->data)) != NULL) {
+		if ((ret = token->next == NULL
+			? __rrr_mqtt_subscription_index_match_deliver(match_data, child)
+			: __rrr_mqtt_subscription_index_match(match_data, child, token->next)
+		) != 0) {
+			goto out;
+		}
+	}
+
+	if (is_dollar) {
+		goto out;
+	}
+
+	if ((child = node->child_plus) != NULL) {
+		if ((ret = token->next == NULL
+			? __rrr_mqtt_subscription_index_match_deliver(match_data, child)
+			: __rrr_mqtt_subscription_index_match(match_data, child, token->next)
+		) != 0) {
+			goto out;
+		}
+	}
+
+	if ((ret = __rrr_mqtt_subscription_index_match_deliver(match_data, node->child_hash)) != 0) {
+		goto out;
+	}
+
+	out:
+	return ret;
+}
+
+// Callback is called once per matching subscription
+int rrr_mqtt_subscription_index_match_publish_with_callback (
+		const struct rrr_mqtt_subscription_index *index,
+		const struct rrr_mqtt_p_publish *publish,
+		int (*match_callback) (
+				const struct rrr_mqtt_p_publish *publish,
+				const struct rrr_mqtt_subscription *subscription,
+				void *owner,
+				void *callback_arg
+		),
+		void *callback_arg,
+		rrr_length *match_count_final
+) {
+	int ret = RRR_MQTT_SUBSCRIPTION_OK;
+
+	struct rrr_mqtt_subscription_index_match_data match_data = {
+		publish,
+		match_callback,
+		callback_arg,
+		0
+	};
+
+	*match_count_final = 0;
+
+	if (publish->token_tree_ == NULL) {
+		RRR_BUG("BUG: Token tree of PUBLISH not set in %s\n", __func__);
+	}
+
+	ret = __rrr_mqtt_subscription_index_match(&match_data, index->root, publish->token_tree_);
+
+	*match_count_final = match_data.match_count;
+
+	return ret;
+}
@@ -0,0 +1,69 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RRR_MQTT_SUBSCRIPTION_INDEX_H
+#define RRR_MQTT_SUBSCRIPTION_INDEX_H
+
+#include "../rrr_types.h"
+
+// The subscription index is a topic filter trie shared by all sessions
+// in a broker. Each session (owner) registers pointers to subscriptions
+// in its own subscription collection. The owner must call update() after
+// every change to its collection and remove() before the collection is
+// destroyed, as the index holds pointers into it.
+
+struct rrr_mqtt_p_publish;
+struct rrr_mqtt_subscription;
+struct rrr_mqtt_subscription_collection;
+struct rrr_mqtt_subscription_index;
+
+int rrr_mqtt_subscription_index_new (
+		struct rrr_mqtt_subscription_index **target
+);
+void rrr_mqtt_subscription_index_destroy (
+		struct rrr_mqtt_subscription_index *index
+);
+rrr_length rrr_mqtt_subscription_index_count (
+		const struct rrr_mqtt_subscription_index *index
+);
+void rrr_mqtt_subscription_index_owner_remove (
+		struct rrr_mqtt_subscription_index *index,
+		const void *owner
+);
+int rrr_mqtt_subscription_index_owner_update (
+		struct rrr_mqtt_subscription_index *index,
+		void *owner,
+		const struct rrr_mqtt_subscription_collection *subscriptions
+);
+int rrr_mqtt_subscription_index_match_publish_with_callback (
+		const struct rrr_mqtt_subscription_index *index,
+		const struct rrr_mqtt_p_publish *publish,
+		int (*match_callback) (
+				const struct rrr_mqtt_p_publish *publish,
+				const struct rrr_mqtt_subscription *subscription,
+				void *owner,
+				void *callback_arg
+		),
+		void *callback_arg,
+		rrr_length *match_count_final
+);
+
+#endif /* RRR_MQTT_SUBSCRIPTION_INDEX_H */
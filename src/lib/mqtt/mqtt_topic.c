@@ -365,6 +365,7 @@ int rrr_mqtt_topic_tokens_clone (
 	}
 
 	strcpy(result->data, first_token->data);
+	result->hash = first_token->hash;
 
 	ret = rrr_mqtt_topic_tokens_clone(&result->next, first_token->next);
 	if (ret != 0) {
@@ -427,6 +428,7 @@ int rrr_mqtt_topic_tokenize_with_end (
 		memset (token, '\0', sizeof(*token));
 		memcpy (token->data, pos, len);
 		token->data[len] = '\0';
+		token->hash = rrr_mqtt_topic_level_hash(token->data, strlen(token->data));
 
 		if (token_end == end - 1 && *token_end == '/') {
 			const char* dummy = "";
@@ -467,3 +469,123 @@ int rrr_mqtt_topic_tokenize (
 	const char *end = topic + strlen(topic);
 	return rrr_mqtt_topic_tokenize_with_end(first_token, topic, end);
 }
+
+int rrr_mqtt_topic_view_new_with_end (
+		struct rrr_mqtt_topic_view **target,
+		const char *topic,
+		const char *end
+) {
+	int ret = 0;
+
+	*target = NULL;
+
+	const rrr_length topic_length = rrr_length_from_ptr_sub_bug_const(end, topic);
+
+	if (topic_length > 0xffff) {
+		RRR_MSG_0("Topic too long in %s (%" PRIrrrl ")\n", __func__, topic_length);
+		ret = 1;
+		goto out;
+	}
+
+	// Number of levels is number of separators plus one
+	rrr_length level_count = 1;
+	for (const char *pos = topic; pos < end; pos++) {
+		if (*pos == '/') {
+			level_count++;
+		}
+	}
+
+	struct rrr_mqtt_topic_view *view;
+	const size_t levels_size = sizeof(view->levels[0]) * level_count;
+
+	if ((view = rrr_allocate(sizeof(*view) + levels_size + topic_length)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	char *topic_copy = (char *) view + sizeof(*view) + levels_size;
+	memcpy(topic_copy, topic, topic_length);
+
+	view->topic = topic_copy;
+	view->topic_length = (uint16_t) topic_length;
+	view->level_count = 0;
+	view->is_valid = 0;
+
+	// Invalid topics never match, the view is still created to
+	// avoid validating again. Callers produce any warning.
+	if (topic_length == 0 || rrr_mqtt_topic_validate_name_with_end(topic, end) != 0) {
+		goto out_set;
+	}
+
+	uint16_t level_start = 0;
+	uint32_t hash = 0x811c9dc5;
+	for (uint16_t i = 0; i <= topic_length; i++) {
+		if (i == topic_length || topic_copy[i] == '/') {
+			struct rrr_mqtt_topic_view_level *level = &view->levels[view->level_count++];
+			level->offset = level_start;
+			level->length = (uint16_t) (i - level_start);
+			level->hash = hash;
+			level_start = (uint16_t) (i + 1);
+			hash = 0x811c9dc5;
+			continue;
+		}
+		hash ^= (unsigned char) topic_copy[i];
+		hash *= 0x01000193;
+	}
+
+	view->is_valid = 1;
+
+	out_set:
+	*target = view;
+
+	out:
+	return ret;
+}
+
+int rrr_mqtt_topic_view_describes_with_end (
+		const struct rrr_mqtt_topic_view *view,
+		const char *topic,
+		const char *end
+) {
+	const size_t topic_length = (size_t) (end - topic);
+	return view->topic_length == topic_length && memcmp(view->topic, topic, topic_length) == 0;
+}
+
+// Matching rules are equal to rrr_mqtt_topic_match_tokens_recursively
+int rrr_mqtt_topic_match_tokens_and_view (
+		const struct rrr_mqtt_topic_token *sub_token,
+		const struct rrr_mqtt_topic_view *view
+) {
+	if (!view->is_valid) {
+		return RRR_MQTT_TOKEN_MISMATCH;
+	}
+
+	uint16_t i = 0;
+	for (; sub_token != NULL && i < view->level_count; sub_token = sub_token->next, i++) {
+		const struct rrr_mqtt_topic_view_level *level = &view->levels[i];
+		const char *data = view->topic + level->offset;
+
+		if (*(sub_token->data) == '#') {
+			return level->length > 0 && *data == '$'
+				? RRR_MQTT_TOKEN_MISMATCH
+				: RRR_MQTT_TOKEN_MATCH;
+		}
+
+		if (*(sub_token->data) == '+') {
+			if (level->length > 0 && *data == '$') {
+				return RRR_MQTT_TOKEN_MISMATCH;
+			}
+		}
+		else if ( sub_token->hash != level->hash ||
+		          strlen(sub_token->data) != level->length ||
+		          memcmp(sub_token->data, data, level->length) != 0
+		) {
+			return RRR_MQTT_TOKEN_MISMATCH;
+		}
+	}
+
+	return sub_token == NULL && i == view->level_count
+		? RRR_MQTT_TOKEN_MATCH
+		: RRR_MQTT_TOKEN_MISMATCH;
+}
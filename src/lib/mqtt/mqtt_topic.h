@@ -22,16 +22,52 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef RRR_MQTT_TOPIC_H
 #define RRR_MQTT_TOPIC_H
 
+#include <stddef.h>
+
 #include "../rrr_inttypes.h"
 #include "../read_constants.h"
 
 struct rrr_mqtt_topic_token {
 	struct rrr_mqtt_topic_token *next;
 
+	// Computed from data when tokenizing
+	uint32_t hash;
+
 	// Must be last
 	char data[1];
 };
 
+struct rrr_mqtt_topic_view_level {
+	uint16_t offset;
+	uint16_t length;
+	uint32_t hash;
+};
+
+// Levels of a topic name found in a single pass, allowing the same topic to be
+// matched against multiple filters without splitting it again. The view keeps a
+// copy of the topic to be able to tell whether it still describes a topic. The
+// view is a single allocation which may be freed directly.
+struct rrr_mqtt_topic_view {
+	uint16_t topic_length;
+	uint16_t level_count;
+	int is_valid;
+	const char *topic;
+	struct rrr_mqtt_topic_view_level levels[];
+};
+
+// FNV-1a, must be the same for tokens and views
+static inline uint32_t rrr_mqtt_topic_level_hash (
+		const char *data,
+		size_t length
+) {
+	uint32_t hash = 0x811c9dc5;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char) data[i];
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
 #define RRR_MQTT_TOKEN_OK                 RRR_READ_OK
 #define RRR_MQTT_TOKEN_MATCH              RRR_READ_OK
 #define RRR_MQTT_TOKEN_INTERNAL_ERROR     RRR_READ_HARD_ERROR
@@ -86,5 +122,19 @@ int rrr_mqtt_topic_tokenize (
 		struct rrr_mqtt_topic_token **first_token,
 		const char *topic
 );
+int rrr_mqtt_topic_view_new_with_end (
+		struct rrr_mqtt_topic_view **target,
+		const char *topic,
+		const char *end
+);
+int rrr_mqtt_topic_view_describes_with_end (
+		const struct rrr_mqtt_topic_view *view,
+		const char *topic,
+		const char *end
+);
+int rrr_mqtt_topic_match_tokens_and_view (
+		const struct rrr_mqtt_topic_token *sub_token,
+		const struct rrr_mqtt_topic_view *view
+);
 
 #endif /* RRR_MQTT_TOPIC_H */
@@ -0,0 +1,207 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+
+#include "../log.h"
+#include "../allocator.h"
+
+#include "mqtt_topic_alias.h"
+
+void rrr_mqtt_topic_alias_in_clear (
+		struct rrr_mqtt_topic_alias_in *table
+) {
+	if (table->topics != NULL) {
+		for (uint16_t i = 0; i < table->maximum; i++) {
+			RRR_FREE_IF_NOT_NULL(table->topics[i]);
+		}
+		rrr_free(table->topics);
+		table->topics = NULL;
+	}
+}
+
+void rrr_mqtt_topic_alias_in_maximum_set (
+		struct rrr_mqtt_topic_alias_in *table,
+		uint16_t maximum
+) {
+	rrr_mqtt_topic_alias_in_clear(table);
+	table->maximum = maximum;
+}
+
+int rrr_mqtt_topic_alias_in_set (
+		struct rrr_mqtt_topic_alias_in *table,
+		uint16_t alias,
+		const char *topic
+) {
+	if (alias == 0 || alias > table->maximum) {
+		RRR_BUG("BUG: Alias %u out of range in %s\n", alias, __func__);
+	}
+
+	if (table->topics == NULL && (table->topics = rrr_allocate_zero(sizeof(*(table->topics)) * table->maximum)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		return 1;
+	}
+
+	char **target = &table->topics[alias - 1];
+
+	if (*target != NULL && strcmp(*target, topic) == 0) {
+		return 0;
+	}
+
+	char *topic_new;
+	if ((topic_new = rrr_strdup(topic)) == NULL) {
+		RRR_MSG_0("Could not allocate memory for topic in %s\n", __func__);
+		return 1;
+	}
+
+	RRR_FREE_IF_NOT_NULL(*target);
+	*target = topic_new;
+
+	return 0;
+}
+
+const char *rrr_mqtt_topic_alias_in_get (
+		const struct rrr_mqtt_topic_alias_in *table,
+		uint16_t alias
+) {
+	if (alias == 0 || alias > table->maximum || table->topics == NULL) {
+		return NULL;
+	}
+	return table->topics[alias - 1];
+}
+
+static void __rrr_mqtt_topic_alias_out_entry_destroy (
+		struct rrr_mqtt_topic_alias_out_entry *entry
+) {
+	RRR_FREE_IF_NOT_NULL(entry->topic);
+	rrr_free(entry);
+}
+
+void rrr_mqtt_topic_alias_out_clear (
+		struct rrr_mqtt_topic_alias_out *table
+) {
+	RRR_LL_DESTROY(table, struct rrr_mqtt_topic_alias_out_entry, __rrr_mqtt_topic_alias_out_entry_destroy(node));
+	rrr_hash_clear(&table->topics);
+	table->alias_free = 0;
+}
+
+void rrr_mqtt_topic_alias_out_maximum_set (
+		struct rrr_mqtt_topic_alias_out *table,
+		uint16_t maximum
+) {
+	rrr_mqtt_topic_alias_out_clear(table);
+	table->maximum = maximum;
+}
+
+// Sets alias to 0 if the topic should be sent without alias. When is_new is set,
+// the alias has not been used with this topic before and the full topic must be
+// sent along with the alias.
+int rrr_mqtt_topic_alias_out_get (
+		uint16_t *alias,
+		int *is_new,
+		struct rrr_mqtt_topic_alias_out *table,
+		const char *topic
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_topic_alias_out_entry *entry = NULL;
+	char *topic_new = NULL;
+
+	*alias = 0;
+	*is_new = 0;
+
+	if (table->maximum == 0 || strlen(topic) <= RRR_MQTT_TOPIC_ALIAS_TOPIC_LENGTH_MIN) {
+		goto out;
+	}
+
+	if ((entry = rrr_hash_get_str(&table->topics, topic)) != NULL) {
+		if (entry != RRR_LL_FIRST(table)) {
+			RRR_LL_REMOVE_NODE_NO_FREE(table, entry);
+			RRR_LL_UNSHIFT(table, entry);
+		}
+		*alias = entry->alias;
+		goto out;
+	}
+
+	if ((topic_new = rrr_strdup(topic)) == NULL) {
+		RRR_MSG_0("Could not allocate memory for topic in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	if (RRR_LL_COUNT(table) < table->maximum) {
+		if ((entry = rrr_allocate_zero(sizeof(*entry))) == NULL) {
+			RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+			ret = 1;
+			goto out;
+		}
+		if (table->alias_free != 0) {
+			entry->alias = table->alias_free;
+			table->alias_free = 0;
+		}
+		else {
+			entry->alias = (uint16_t) (RRR_LL_COUNT(table) + 1);
+		}
+	}
+	else {
+		// Re-assign the alias of the least recently used topic
+		entry = RRR_LL_POP(table);
+		rrr_hash_remove_str(&table->topics, entry->topic);
+		RRR_FREE_IF_NOT_NULL(entry->topic);
+	}
+
+	entry->topic = topic_new;
+	topic_new = NULL;
+
+	RRR_LL_UNSHIFT(table, entry);
+
+	if ((ret = rrr_hash_set_str(&table->topics, entry->topic, entry)) != 0) {
+		RRR_MSG_0("Could not store topic alias in %s\n", __func__);
+		RRR_LL_REMOVE_NODE_NO_FREE(table, entry);
+		// The alias may be in the middle of the range when the entry
+		// was re-assigned or took the free alias, keep it for the next
+		// new entry to avoid giving out an alias which is in use.
+		if (entry->alias != RRR_LL_COUNT(table) + 1) {
+			table->alias_free = entry->alias;
+		}
+		__rrr_mqtt_topic_alias_out_entry_destroy(entry);
+		goto out;
+	}
+
+	*alias = entry->alias;
+	*is_new = 1;
+
+	out:
+	RRR_FREE_IF_NOT_NULL(topic_new);
+	return ret;
+}
+
+void rrr_mqtt_topic_alias_counters_add_to_stats (
+		struct rrr_mqtt_topic_alias_stats *target,
+		struct rrr_mqtt_topic_alias_counters *counters
+) {
+	target->out_assigned += rrr_atomic_u64_load_relaxed(&counters->out_assigned);
+	target->out_reused += rrr_atomic_u64_load_relaxed(&counters->out_reused);
+	target->out_bytes_saved += rrr_atomic_u64_load_relaxed(&counters->out_bytes_saved);
+	target->in_assigned += rrr_atomic_u64_load_relaxed(&counters->in_assigned);
+	target->in_resolved += rrr_atomic_u64_load_relaxed(&counters->in_resolved);
+	target->in_bytes_saved += rrr_atomic_u64_load_relaxed(&counters->in_bytes_saved);
+}
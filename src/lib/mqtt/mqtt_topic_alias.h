@@ -0,0 +1,122 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RRR_MQTT_TOPIC_ALIAS_H
+#define RRR_MQTT_TOPIC_ALIAS_H
+
+#include <stdint.h>
+
+#include "../util/linked_list.h"
+#include "../util/hash.h"
+#include "../util/atomic.h"
+
+// Size of a Topic Alias property in a PUBLISH (identifier and two byte integer)
+#define RRR_MQTT_TOPIC_ALIAS_PROPERTY_SIZE 3
+
+// Topics of this length or shorter are always sent in full, using an alias
+// would not save any bytes.
+#define RRR_MQTT_TOPIC_ALIAS_TOPIC_LENGTH_MIN 8
+
+// Bytes saved by sending an alias instead of a topic, topics set by a
+// remote may be shorter than the alias property
+#define RRR_MQTT_TOPIC_ALIAS_BYTES_SAVED(topic_length)                  \
+    ((topic_length) > RRR_MQTT_TOPIC_ALIAS_PROPERTY_SIZE                \
+        ? (topic_length) - RRR_MQTT_TOPIC_ALIAS_PROPERTY_SIZE : 0)
+
+struct rrr_mqtt_topic_alias_stats {
+	uint64_t out_assigned;
+	uint64_t out_reused;
+	uint64_t out_bytes_saved;
+	uint64_t in_assigned;
+	uint64_t in_resolved;
+	uint64_t in_bytes_saved;
+};
+
+// Counters updated by connections and read by statistics, possibly
+// in different threads
+struct rrr_mqtt_topic_alias_counters {
+	rrr_atomic_u64_t out_assigned;
+	rrr_atomic_u64_t out_reused;
+	rrr_atomic_u64_t out_bytes_saved;
+	rrr_atomic_u64_t in_assigned;
+	rrr_atomic_u64_t in_resolved;
+	rrr_atomic_u64_t in_bytes_saved;
+};
+
+// Aliases assigned by the remote. The table is allocated upon first use.
+struct rrr_mqtt_topic_alias_in {
+	char **topics;
+	uint16_t maximum;
+};
+
+struct rrr_mqtt_topic_alias_out_entry {
+	RRR_LL_NODE(struct rrr_mqtt_topic_alias_out_entry);
+	char *topic;
+	uint16_t alias;
+};
+
+// Aliases assigned by us. Entries are kept in least recently used order with
+// the most recently used entry first, and the last entry is re-assigned when
+// all aliases are in use. Aliases are numbered from 1 in the order they are
+// assigned. If an entry is lost after failing to store it, its alias is kept
+// in alias_free and given to the next new entry.
+struct rrr_mqtt_topic_alias_out {
+	RRR_LL_HEAD(struct rrr_mqtt_topic_alias_out_entry);
+	struct rrr_hash topics;
+	uint16_t maximum;
+	uint16_t alias_free;
+};
+
+void rrr_mqtt_topic_alias_in_clear (
+		struct rrr_mqtt_topic_alias_in *table
+);
+void rrr_mqtt_topic_alias_in_maximum_set (
+		struct rrr_mqtt_topic_alias_in *table,
+		uint16_t maximum
+);
+int rrr_mqtt_topic_alias_in_set (
+		struct rrr_mqtt_topic_alias_in *table,
+		uint16_t alias,
+		const char *topic
+);
+const char *rrr_mqtt_topic_alias_in_get (
+		const struct rrr_mqtt_topic_alias_in *table,
+		uint16_t alias
+);
+void rrr_mqtt_topic_alias_out_clear (
+		struct rrr_mqtt_topic_alias_out *table
+);
+void rrr_mqtt_topic_alias_out_maximum_set (
+		struct rrr_mqtt_topic_alias_out *table,
+		uint16_t maximum
+);
+int rrr_mqtt_topic_alias_out_get (
+		uint16_t *alias,
+		int *is_new,
+		struct rrr_mqtt_topic_alias_out *table,
+		const char *topic
+);
+void rrr_mqtt_topic_alias_counters_add_to_stats (
+		struct rrr_mqtt_topic_alias_stats *target,
+		struct rrr_mqtt_topic_alias_counters *counters
+);
+
+#endif /* RRR_MQTT_TOPIC_ALIAS_H */
@@ -261,6 +261,18 @@ int rrr_mqtt_transport_connect (
 		return ret;
 }
 
+int rrr_mqtt_transport_owns_handle (
+		struct rrr_mqtt_transport *transport,
+		struct rrr_net_transport_handle *handle
+) {
+	RRR_MQTT_TRANSPORT_FOREACH_BEGIN();
+		if (RRR_NET_TRANSPORT_CTX_TRANSPORT(handle) == node) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
 void rrr_mqtt_transport_notify_tick (
 		struct rrr_mqtt_transport *transport
 ) {
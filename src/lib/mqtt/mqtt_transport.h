@@ -92,6 +92,10 @@ int rrr_mqtt_transport_connect (
 				void *rrr_mqtt_transport_accept_and_connect_callback_data
 		)
 );
+int rrr_mqtt_transport_owns_handle (
+		struct rrr_mqtt_transport *transport,
+		struct rrr_net_transport_handle *handle
+);
 void rrr_mqtt_transport_notify_tick (
 		struct rrr_mqtt_transport *transport
 );
@@ -37,11 +37,11 @@ int rrr_mqtt_p_usercount_init (
 void rrr_mqtt_p_usercount_incref (
 		struct rrr_mqtt_p_usercount *usercount
 ) {
-	if (usercount->users == 0) {
+	if (__atomic_load_n(&usercount->users, __ATOMIC_RELAXED) == 0) {
 		RRR_BUG("Users were 0 in %s\n", __func__);
 	}
 
-	usercount->users++;
+	__atomic_add_fetch(&usercount->users, 1, __ATOMIC_RELAXED);
 }
 
 void rrr_mqtt_p_usercount_decref (
@@ -51,12 +51,14 @@ void rrr_mqtt_p_usercount_decref (
 		return;
 	}
 
-	--(usercount->users);
+	// Packets and payloads may be shared between the threads of a
+	// multi-threaded broker
+	const int users = __atomic_sub_fetch(&usercount->users, 1, __ATOMIC_ACQ_REL);
 
-	if (usercount->users < 0) {
+	if (users < 0) {
 		RRR_BUG("Users were < 0 in %s\n", __func__);
 	}
-	if (usercount->users == 0) {
+	if (users == 0) {
 		usercount->destroy((void *) usercount);
 	}
 }
@@ -65,6 +67,6 @@ int rrr_mqtt_p_usercount_get_refcount (
 		struct rrr_mqtt_p_usercount *usercount
 ) {
 	int ret = 0;
-	ret = usercount->users;
+	ret = __atomic_load_n(&usercount->users, __ATOMIC_RELAXED);
 	return ret;
 }
@@ -44,6 +44,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #if defined(RRR_WITH_LIBRESSL) || defined(RRR_WITH_OPENSSL)
 #	include "net_transport_tls.h"
+#	include "net_transport_tls_common.h"
 #endif
 
 #include "../event/event_collection.h"
@@ -56,6 +57,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../ip/ip_util.h"
 #include "../util/posix.h"
 #include "../util/rrr_time.h"
+#include "../util/hash.h"
 #include "../helpers/nullsafe_str.h"
 #include "../socket/rrr_socket_send_chunk.h"
 #include "../socket/rrr_socket_graylist.h"
@@ -65,21 +67,117 @@ static struct rrr_net_transport_handle *__rrr_net_transport_handle_get (
 		rrr_net_transport_handle handle,
 		const char *source
 ) {
-	struct rrr_net_transport_handle_collection *collection = &transport->handles;
-
-	struct rrr_net_transport_handle *result = NULL;
-
 	// May be used to print debug messages
 	(void)(source);
 
-	RRR_LL_ITERATE_BEGIN(collection, struct rrr_net_transport_handle);
-		if (node->handle == handle) {
-			result = node;
-			RRR_LL_ITERATE_LAST();
+	return rrr_hash_get_u64(&transport->handles.handle_index, (uint64_t) handle);
+}
+
+static rrr_length __rrr_net_transport_match_key_size (
+		const char *string
+) {
+	return rrr_length_from_size_t_bug_const(sizeof(uint64_t) + strlen(string));
+}
+
+static void __rrr_net_transport_match_key_make (
+		char *key,
+		const char *string,
+		uint64_t number
+) {
+	memcpy(key, &number, sizeof(number));
+	memcpy(key + sizeof(number), string, strlen(string));
+}
+
+static int __rrr_net_transport_handle_match_index_add (
+		struct rrr_net_transport_handle *handle
+) {
+	struct rrr_hash *index = &handle->transport->handles.match_index;
+
+	const rrr_length key_size = __rrr_net_transport_match_key_size(handle->match_string);
+	char key[key_size];
+	__rrr_net_transport_match_key_make(key, handle->match_string, handle->match_number);
+
+	struct rrr_net_transport_handle *node = rrr_hash_get(index, key, key_size);
+	if (node == NULL) {
+		return rrr_hash_set(index, key, key_size, handle);
+	}
+
+	// Keep the oldest handle first in the chain
+	while (node->match_next != NULL) {
+		node = node->match_next;
+	}
+	node->match_next = handle;
+
+	return 0;
+}
+
+static void __rrr_net_transport_handle_match_index_remove (
+		struct rrr_net_transport_handle *handle
+) {
+	struct rrr_hash *index = &handle->transport->handles.match_index;
+
+	const rrr_length key_size = __rrr_net_transport_match_key_size(handle->match_string);
+	char key[key_size];
+	__rrr_net_transport_match_key_make(key, handle->match_string, handle->match_number);
+
+	struct rrr_net_transport_handle *node = rrr_hash_get(index, key, key_size);
+	if (node == handle) {
+		if (handle->match_next != NULL) {
+			// Replaces the value of the existing entry, cannot fail
+			rrr_hash_set(index, key, key_size, handle->match_next);
 		}
-	RRR_LL_ITERATE_END();
+		else {
+			rrr_hash_remove(index, key, key_size);
+		}
+	}
+	else {
+		for (; node != NULL; node = node->match_next) {
+			if (node->match_next == handle) {
+				node->match_next = handle->match_next;
+				break;
+			}
+		}
+	}
+
+	handle->match_next = NULL;
+}
+
+static struct rrr_net_transport_handle *__rrr_net_transport_handle_get_by_cid (
+		struct rrr_net_transport *transport,
+		const struct rrr_net_transport_connection_id *cid
+) {
+	assert(cid->length > 0);
+
+	return rrr_hash_get(&transport->handles.cid_index, cid->data, (rrr_length) cid->length);
+}
+
+static void __rrr_net_transport_handle_cid_index_remove (
+		struct rrr_net_transport_handle *handle,
+		const struct rrr_net_transport_connection_id *cid
+) {
+	struct rrr_hash *index = &handle->transport->handles.cid_index;
 
-	return result;
+	if (rrr_hash_get(index, cid->data, (rrr_length) cid->length) == handle) {
+		rrr_hash_remove(index, cid->data, (rrr_length) cid->length);
+	}
+}
+
+static void __rrr_net_transport_handle_index_remove (
+		struct rrr_net_transport_handle *handle
+) {
+	struct rrr_net_transport_handle_collection *collection = &handle->transport->handles;
+
+	if (rrr_hash_get_u64(&collection->handle_index, (uint64_t) handle->handle) == handle) {
+		rrr_hash_remove_u64(&collection->handle_index, (uint64_t) handle->handle);
+	}
+
+	if (handle->match_string != NULL) {
+		__rrr_net_transport_handle_match_index_remove(handle);
+	}
+
+	RRR_LL_ITERATE_BEGIN(&handle->cids, struct rrr_net_transport_connection_id);
+		__rrr_net_transport_handle_cid_index_remove(handle, node);
+	RRR_LL_ITERATE_END();
 }
 
 static int __rrr_net_transport_handle_destroy (
@@ -98,6 +196,9 @@ static int __rrr_net_transport_handle_destroy (
 		handle->application_ptr_destroy(handle->application_private_ptr);
 	}
 
+	// Must be done after close as the submodule may look up the handle
+	__rrr_net_transport_handle_index_remove(handle);
+
 	RRR_FREE_IF_NOT_NULL(handle->match_string);
 	RRR_FREE_IF_NOT_NULL(handle->application_close_reason_string);
 
@@ -110,6 +211,52 @@ static int __rrr_net_transport_handle_destroy (
 	return RRR_LL_DID_DESTROY;
 }
 
+static int __rrr_net_transport_handle_callback (
+		int *do_destroy,
+		struct rrr_net_transport_handle *handle,
+		int (*callback)(struct rrr_net_transport_handle *handle, void *arg),
+		void *arg
+) {
+	int ret = 0;
+
+	*do_destroy = 0;
+
+	// This function is only allowed to return OK or HARD ERROR (0 or 1)
+
+	if ((ret = callback (handle, arg)) != 0) {
+		if (ret == RRR_READ_INCOMPLETE) {
+			ret = 0;
+		}
+		else if (ret == RRR_READ_SOFT_ERROR || ret == RRR_READ_EOF) {
+			// For nice treatment of remote, for instance send a disconnect packet
+			if ((ret = handle->transport->methods->pre_destroy (
+					handle,
+					handle->submodule_private_ptr,
+					handle->application_private_ptr
+			)) == RRR_NET_TRANSPORT_READ_HARD_ERROR) {
+				RRR_MSG_0("Internal error from pre destroy function in %s\n", __func__);
+				goto out;
+			}
+
+			// When pre_destroy returns 0, go ahead with destruction
+			if (ret == 0) {
+				*do_destroy = 1;
+			}
+			else {
+				ret = 0;
+			}
+		}
+		else {
+			RRR_MSG_0("Error %i from callback function in %s\n", ret, __func__);
+			ret = RRR_NET_TRANSPORT_READ_HARD_ERROR;
+			goto out;
+		}
+	}
+
+	out:
+	return ret;
+}
+
 static int __rrr_net_transport_iterate_with_callback (
 		struct rrr_net_transport *transport,
 		enum rrr_net_transport_socket_mode search_mode,
@@ -123,49 +270,38 @@ static int __rrr_net_transport_iterate_with_callback (
 
 	struct rrr_net_transport_handle_collection *collection = &transport->handles;
 
+	int do_destroy = 0;
+
+	if (search_handle != NULL) {
+		// There can only be one match if we match on handle, no need to iterate
+		if (search_mode != RRR_NET_TRANSPORT_SOCKET_MODE_ANY && search_mode != search_handle->mode) {
+			goto out;
+		}
+
+		if ((ret = __rrr_net_transport_handle_callback (&do_destroy, search_handle, callback, arg)) != 0) {
+			goto out;
+		}
+
+		if (do_destroy) {
+			RRR_LL_REMOVE_NODE_NO_FREE(collection, search_handle);
+			__rrr_net_transport_handle_destroy(search_handle);
+		}
+
+		goto out;
+	}
+
 	RRR_LL_ITERATE_BEGIN(collection, struct rrr_net_transport_handle);
 		if (search_mode != RRR_NET_TRANSPORT_SOCKET_MODE_ANY && search_mode != node->mode) {
 			RRR_LL_ITERATE_NEXT();
 		}
 
-		if (search_handle != NULL) {
-			if (search_handle != node) {
-				RRR_LL_ITERATE_NEXT();
-			}
-
-			// There can only be one match if we match on handle
-			RRR_LL_ITERATE_LAST();
+		if ((ret = __rrr_net_transport_handle_callback (&do_destroy, node, callback, arg)) != 0) {
+			goto out;
 		}
 
-		if ((ret = callback (node, arg)) != 0) {
-			if (ret == RRR_READ_INCOMPLETE) {
-				ret = 0;
-			}
-			else if (ret == RRR_READ_SOFT_ERROR || ret == RRR_READ_EOF) {
-				// For nice treatment of remote, for instance send a disconnect packet
-				if ((ret = transport->methods->pre_destroy (
-						node,
-						node->submodule_private_ptr,
-						node->application_private_ptr
-				)) == RRR_NET_TRANSPORT_READ_HARD_ERROR) {
-					RRR_MSG_0("Internal error from pre destroy function in %s\n", __func__);
-					goto out;
-				}
-
-				// When pre_destroy returns 0, go ahead with destruction
-				if (ret == 0) {
-					__rrr_net_transport_handle_destroy(node);
-					RRR_LL_ITERATE_SET_DESTROY();
-				}
-				else {
-					ret = 0;
-				}
-			}
-			else {
-				RRR_MSG_0("Error %i from callback function in %s\n", ret, __func__);
-				ret = RRR_NET_TRANSPORT_READ_HARD_ERROR;
-				goto out;
-			}
+		if (do_destroy) {
+			__rrr_net_transport_handle_destroy(node);
+			RRR_LL_ITERATE_SET_DESTROY();
 		}
 	RRR_LL_ITERATE_END_CHECK_DESTROY_NO_FREE(collection);
 
@@ -256,6 +392,11 @@ static int __rrr_net_transport_handle_create_and_push (
 
 	rrr_event_collection_init(&new_handle->events, transport->event_queue);
 
+	if ((ret = rrr_hash_set_u64(&collection->handle_index, (uint64_t) handle, new_handle)) != 0) {
+		RRR_MSG_0("Could not add handle to index in %s\n", __func__);
+		goto out_free;
+	}
+
 	if ((ret = submodule_callback (
 			&new_handle->submodule_private_ptr,
 			&new_handle->submodule_fd,
@@ -263,7 +404,7 @@ static int __rrr_net_transport_handle_create_and_push (
 			datagram,
 			submodule_callback_arg
 	)) != 0) {
-		goto out_free;
+		goto out_remove;
 	}
 
 	RRR_LL_APPEND(collection, new_handle);
@@ -271,6 +412,8 @@ static int __rrr_net_transport_handle_create_and_push (
 	goto out;
 //	out_destroy:
 //		__rrr_net_transport_handle_destroy(new_handle);
+	out_remove:
+		rrr_hash_remove_u64(&collection->handle_index, (uint64_t) handle);
 	out_free:
 		rrr_free(new_handle);
 	out:
@@ -311,15 +454,7 @@ int rrr_net_transport_handle_allocate_and_add (
 			i = 1;
 		}
 
-		int was_taken = 0;
-		RRR_LL_ITERATE_BEGIN(collection, struct rrr_net_transport_handle);
-			if (node->handle == i) {
-				was_taken = 1;
-				RRR_LL_ITERATE_LAST();
-			}
-		RRR_LL_ITERATE_END();
-
-		if (was_taken == 0) {
+		if (rrr_hash_get_u64(&collection->handle_index, (uint64_t) i) == NULL) {
 			new_handle_id = i;
 			break;
 		}
@@ -405,12 +540,8 @@ static void __rrr_net_transport_handle_remove_and_destroy (
 		struct rrr_net_transport *transport,
 		struct rrr_net_transport_handle *handle
 ) {
-	RRR_LL_ITERATE_BEGIN(&transport->handles, struct rrr_net_transport_handle);
-		if (node == handle) {
-			RRR_LL_ITERATE_SET_DESTROY();
-			RRR_LL_ITERATE_LAST();
-		}
-	RRR_LL_ITERATE_END_CHECK_DESTROY(&transport->handles, 0; __rrr_net_transport_handle_destroy(node));
+	RRR_LL_REMOVE_NODE_NO_FREE(&transport->handles, handle);
+	__rrr_net_transport_handle_destroy(handle);
 }
 
 static int __rrr_net_transport_handle_send_nonblock (
@@ -888,6 +1019,32 @@ static int __rrr_net_transport_event_write_send_chunk_callback (
 	return ret;
 }
 
+static int __rrr_net_transport_event_write_sendv_chunk_callback (
+		RRR_SOCKET_SEND_CHUNK_SENDV_CALLBACK_ARGS
+) {
+	struct rrr_net_transport_handle *handle = arg;
+
+	int ret = 0;
+
+	if ((ret = handle->transport->methods->sendv (
+			written_bytes,
+			handle,
+			iov,
+			iov_count
+	)) != 0) {
+		if (ret != RRR_NET_TRANSPORT_SEND_INCOMPLETE) {
+			RRR_DBG_7("net transport fd %i [%s] return %i from submodule sendv function, connection should be closed\n",
+					handle->submodule_fd, handle->transport->application_name, ret);
+			goto out;
+		}
+	}
+
+	handle->bytes_written_total += (uint64_t) *written_bytes;
+
+	out:
+	return ret;
+}
+
 static void __rrr_net_transport_event_write (
 		evutil_socket_t fd,
 		short flags,
@@ -906,7 +1063,14 @@ static void __rrr_net_transport_event_write (
 
 	RRR_EVENT_HOOK();
 
-	if (rrr_socket_send_chunk_collection_count(&handle->send_chunks) > 0) {
+	if (rrr_socket_send_chunk_collection_count(&handle->send_chunks) > 0 && handle->transport->methods->sendv != NULL) {
+		ret_tmp = rrr_socket_send_chunk_collection_sendv_with_callback (
+				&handle->send_chunks,
+				__rrr_net_transport_event_write_sendv_chunk_callback,
+				handle
+		);
+	}
+	else if (rrr_socket_send_chunk_collection_count(&handle->send_chunks) > 0) {
 		ret_tmp = rrr_socket_send_chunk_collection_send_with_callback (
 				&handle->send_chunks,
 				__rrr_net_transport_event_write_send_chunk_callback,
@@ -1048,12 +1212,10 @@ void rrr_net_transport_handle_touch (
 		struct rrr_net_transport *transport,
 		rrr_net_transport_handle handle
 ) {
-	RRR_LL_ITERATE_BEGIN(&transport->handles, struct rrr_net_transport_handle);
-		if (node->handle == handle) {
-			rrr_net_transport_ctx_touch(node);
-			RRR_LL_ITERATE_LAST();
-		}
-	RRR_LL_ITERATE_END();
+	struct rrr_net_transport_handle *node = __rrr_net_transport_handle_get(transport, handle, __func__);
+	if (node != NULL) {
+		rrr_net_transport_ctx_touch(node);
+	}
 }
 
 static void __rrr_net_transport_handle_ptr_close_reason_set (
@@ -1095,17 +1257,15 @@ void rrr_net_transport_handle_close_with_reason (
 		uint64_t application_close_reason,
 		const char *application_close_reason_string
 ) {
-	RRR_LL_ITERATE_BEGIN(&transport->handles, struct rrr_net_transport_handle);
-		if (node->handle == handle) {
-			rrr_net_transport_handle_ptr_close_with_reason (
-					node,
-					submodule_close_reason,
-					application_close_reason,
-					application_close_reason_string
-			);
-			RRR_LL_ITERATE_LAST();
-		}
-	RRR_LL_ITERATE_END();
+	struct rrr_net_transport_handle *node = __rrr_net_transport_handle_get(transport, handle, __func__);
+	if (node != NULL) {
+		rrr_net_transport_handle_ptr_close_with_reason (
+				node,
+				submodule_close_reason,
+				application_close_reason,
+				application_close_reason_string
+		);
+	}
 }
 
 rrr_net_transport_handle rrr_net_transport_handle_get_by_match (
@@ -1115,6 +1275,16 @@ rrr_net_transport_handle rrr_net_transport_handle_get_by_match (
 ) {
 	rrr_net_transport_handle result_handle = 0;
 
+	if (string != NULL) {
+		const rrr_length key_size = __rrr_net_transport_match_key_size(string);
+		char key[key_size];
+		__rrr_net_transport_match_key_make(key, string, number);
+
+		const struct rrr_net_transport_handle *handle = rrr_hash_get(&transport->handles.match_index, key, key_size);
+		return handle != NULL ? handle->handle : 0;
+	}
+
+	// Handles without match data are not indexed
 	RRR_LL_ITERATE_BEGIN(&transport->handles, struct rrr_net_transport_handle);
 		if (number != node->match_number) {
 			RRR_LL_ITERATE_NEXT();
@@ -1136,20 +1306,6 @@ rrr_net_transport_handle rrr_net_transport_handle_get_by_match (
 	return result_handle;
 }
 
-static struct rrr_net_transport_handle *__rrr_net_transport_handle_get_by_cid (
-		struct rrr_net_transport *transport,
-		const struct rrr_net_transport_connection_id *cid
-) {
-	assert(cid->length > 0);
-
-	RRR_LL_ITERATE_BEGIN(&transport->handles, struct rrr_net_transport_handle);
-		if (rrr_net_transport_connection_id_collection_has(&node->cids, cid))
-			return node;
-	RRR_LL_ITERATE_END();
-
-	return NULL;
-}
-
 rrr_net_transport_handle rrr_net_transport_handle_get_by_cid (
 		struct rrr_net_transport *transport,
 		const struct rrr_net_transport_connection_id *cid
@@ -1162,12 +1318,12 @@ static struct rrr_net_transport_handle *__rrr_net_transport_handle_get_by_cid_pa
 		struct rrr_net_transport *transport,
 		const struct rrr_net_transport_connection_id_pair *cids
 ) {
-	RRR_LL_ITERATE_BEGIN(&transport->handles, struct rrr_net_transport_handle);
-		if (rrr_net_transport_connection_id_collection_has(&node->cids, &cids->a))
-			return node;
-		if (rrr_net_transport_connection_id_collection_has(&node->cids, &cids->b))
-			return node;
-	RRR_LL_ITERATE_END();
+	struct rrr_net_transport_handle *handle = NULL;
+
+	if (cids->a.length > 0 && (handle = __rrr_net_transport_handle_get_by_cid(transport, &cids->a)) != NULL)
+		return handle;
+	if (cids->b.length > 0 && (handle = __rrr_net_transport_handle_get_by_cid(transport, &cids->b)) != NULL)
+		return handle;
 
 	return NULL;
 }
@@ -1226,6 +1382,11 @@ static int __rrr_net_transport_handle_ptr_cid_push (
 		goto out;
 	}
 
+	if ((ret = rrr_hash_set(&handle->transport->handles.cid_index, cid->data, (rrr_length) cid->length, handle)) != 0) {
+		rrr_net_transport_ctx_connection_id_remove(handle, cid);
+		goto out;
+	}
+
 	out:
 	return ret;
 }
@@ -1268,6 +1429,10 @@ int rrr_net_transport_handle_cid_remove (
 ) {
 	RRR_NET_TRANSPORT_HANDLE_GET();
 
+	if (rrr_net_transport_connection_id_collection_has(&handle->cids, cid)) {
+		__rrr_net_transport_handle_cid_index_remove(handle, cid);
+	}
+
 	rrr_net_transport_ctx_connection_id_remove(handle, cid);
 
 	return 0;
@@ -1732,6 +1897,14 @@ static int __rrr_net_transport_bind_and_listen_callback_intermediate (
 	return ret;
 }
 
+// Listening sockets created after this call are bound with SO_REUSEPORT,
+// allowing multiple transports to accept connections on the same port
+void rrr_net_transport_reuse_port_set (
+		struct rrr_net_transport *transport
+) {
+	transport->reuse_port = 1;
+}
+
 int rrr_net_transport_bind_and_listen_dualstack (
 		struct rrr_net_transport *transport,
 		uint16_t port,
@@ -1904,7 +2077,11 @@ int rrr_net_transport_handle_match_data_set (
 ) {
 	RRR_NET_TRANSPORT_HANDLE_GET();
 
-	RRR_FREE_IF_NOT_NULL(handle->match_string);
+	if (handle->match_string != NULL) {
+		__rrr_net_transport_handle_match_index_remove(handle);
+		RRR_FREE_IF_NOT_NULL(handle->match_string);
+	}
+
 	if ((handle->match_string = rrr_strdup(string)) == NULL) {
 		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
 		return 1;
@@ -1912,6 +2089,12 @@ int rrr_net_transport_handle_match_data_set (
 
 	handle->match_number = number;
 
+	if (__rrr_net_transport_handle_match_index_add(handle) != 0) {
+		RRR_MSG_0("Could not add match data to index in %s\n", __func__);
+		RRR_FREE_IF_NOT_NULL(handle->match_string);
+		return 1;
+	}
+
 	return 0;
 }
 
@@ -2210,6 +2393,10 @@ void rrr_net_transport_common_cleanup (
 			struct rrr_net_transport_handle,
 			__rrr_net_transport_handle_destroy (node)
 	);
+
+	rrr_hash_clear(&collection->handle_index);
+	rrr_hash_clear(&collection->cid_index);
+	rrr_hash_clear(&collection->match_index);
 }
 
 enum rrr_net_transport_type rrr_net_transport_type_get (
@@ -2236,6 +2423,21 @@ void rrr_net_transport_stats_get (
 	RRR_LL_ITERATE_END();
 }
 
+void rrr_net_transport_tls_stats_get (
+		struct rrr_net_transport_tls_stats *target,
+		const struct rrr_net_transport *transport
+) {
+	memset(target, '\0', sizeof(*target));
+
+#if defined(RRR_WITH_LIBRESSL) || defined(RRR_WITH_OPENSSL)
+	if (transport->transport_type == RRR_NET_TRANSPORT_TLS) {
+		*target = ((const struct rrr_net_transport_tls *) transport)->stats;
+	}
+#else
+	(void)(transport);
+#endif
+}
+
 void rrr_net_transport_shutdown (
 		struct rrr_net_transport *transport
 ) {
@@ -2307,7 +2509,7 @@ static int __rrr_net_transport_new (
 			ret = rrr_net_transport_tls_new (
 					(struct rrr_net_transport_tls **) &new_transport,
 					config->transport_subtype_p,
-					flags,
+					flags | (config->tls_ktls ? RRR_NET_TRANSPORT_F_TLS_KTLS : 0),
 					config->tls_certificate_file,
 					config->tls_key_file,
 					config->tls_ca_file,
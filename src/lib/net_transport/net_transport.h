@@ -131,6 +131,7 @@ struct rrr_socket_graylist;
     struct timeval soft_read_timeout_tv;                                    \
     struct timeval hard_read_timeout_tv;                                    \
     int shutdown;                                                           \
+    int reuse_port;                                                         \
     void (*accept_callback)(RRR_NET_TRANSPORT_ACCEPT_CALLBACK_FINAL_ARGS);  \
     void *accept_callback_arg;                                              \
     int (*handshake_complete_callback)(RRR_NET_TRANSPORT_HANDSHAKE_COMPLETE_CALLBACK_ARGS);  \
@@ -255,6 +256,9 @@ int rrr_net_transport_handle_cid_remove (
 		rrr_net_transport_handle transport_handle,
 		const struct rrr_net_transport_connection_id *cid
 );
+void rrr_net_transport_reuse_port_set (
+		struct rrr_net_transport *transport
+);
 int rrr_net_transport_bind_and_listen_dualstack (
 		struct rrr_net_transport *transport,
 		uint16_t port,
@@ -398,6 +402,10 @@ void rrr_net_transport_stats_get (
 		rrr_length *connected_count,
 		struct rrr_net_transport *transport
 );
+void rrr_net_transport_tls_stats_get (
+		struct rrr_net_transport_tls_stats *target,
+		const struct rrr_net_transport *transport
+);
 void rrr_net_transport_shutdown (
 		struct rrr_net_transport *transport
 );
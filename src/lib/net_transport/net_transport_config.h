@@ -25,7 +25,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "net_transport_defines.h"
 
 #define RRR_NET_TRANSPORT_CONFIG_PLAIN_INITIALIZER \
-    {NULL, NULL, NULL, NULL, RRR_NET_TRANSPORT_PLAIN, RRR_NET_TRANSPORT_F_PLAIN, 0}
+    {NULL, NULL, NULL, NULL, RRR_NET_TRANSPORT_PLAIN, RRR_NET_TRANSPORT_F_PLAIN, 0, 0}
 
 struct rrr_instance_config_data;
 
@@ -39,6 +39,9 @@ struct rrr_net_transport_config {
 	enum rrr_net_transport_type_f transport_type_f;
 
 	enum rrr_net_transport_subtype transport_subtype_p;
+
+	// Only honored by the OpenSSL transport
+	int tls_ktls;
 };
 
 void rrr_net_transport_config_cleanup (
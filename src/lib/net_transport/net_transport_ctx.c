@@ -315,6 +315,78 @@ int rrr_net_transport_ctx_send_push_const_urgent (
 	return __rrr_net_transport_ctx_send_push_const (handle, data, size, 1 /* Urgent */);
 }
 
+static int __rrr_net_transport_ctx_send_push_shared (
+		struct rrr_net_transport_handle *handle,
+		const void *data,
+		rrr_biglength size,
+		void (*shared_owner_incref)(void *shared_owner),
+		void (*shared_owner_decref)(void *shared_owner),
+		void *shared_owner,
+		int is_urgent
+) {
+	int ret = 0;
+
+	EVENT_ADD(handle->event_write);
+
+	rrr_length send_chunk_count = 0;
+	if ((ret = rrr_socket_send_chunk_collection_push_shared (
+			&send_chunk_count,
+			&handle->send_chunks,
+			data,
+			size,
+			is_urgent ? RRR_SOCKET_SEND_CHUNK_PRIORITY_HIGH
+			          : RRR_SOCKET_SEND_CHUNK_PRIORITY_NORMAL,
+			shared_owner_incref,
+			shared_owner_decref,
+			shared_owner
+	)) != 0) {
+		goto out;
+	}
+
+	ret = __rrr_net_transport_ctx_send_push_postcheck (handle, send_chunk_count);
+
+	out:
+	return ret;
+}
+
+int rrr_net_transport_ctx_send_push_shared (
+		struct rrr_net_transport_handle *handle,
+		const void *data,
+		rrr_biglength size,
+		void (*shared_owner_incref)(void *shared_owner),
+		void (*shared_owner_decref)(void *shared_owner),
+		void *shared_owner
+) {
+	return __rrr_net_transport_ctx_send_push_shared (
+			handle,
+			data,
+			size,
+			shared_owner_incref,
+			shared_owner_decref,
+			shared_owner,
+			0 /* Not urgent */
+	);
+}
+
+int rrr_net_transport_ctx_send_push_shared_urgent (
+		struct rrr_net_transport_handle *handle,
+		const void *data,
+		rrr_biglength size,
+		void (*shared_owner_incref)(void *shared_owner),
+		void (*shared_owner_decref)(void *shared_owner),
+		void *shared_owner
+) {
+	return __rrr_net_transport_ctx_send_push_shared (
+			handle,
+			data,
+			size,
+			shared_owner_incref,
+			shared_owner_decref,
+			shared_owner,
+			1 /* Urgent */
+	);
+}
+
 static int __rrr_net_transport_ctx_send_push_nullsafe_callback (
 		const void *data,
 		rrr_nullsafe_len data_len,
@@ -137,6 +137,24 @@ int rrr_net_transport_ctx_send_push_const_urgent (
 		const void *data,
 		rrr_biglength size
 );
+// Data is not copied. A reference to the owner is held until the data
+// has been sent, and the data must not be modified during that time.
+int rrr_net_transport_ctx_send_push_shared (
+		struct rrr_net_transport_handle *handle,
+		const void *data,
+		rrr_biglength size,
+		void (*shared_owner_incref)(void *shared_owner),
+		void (*shared_owner_decref)(void *shared_owner),
+		void *shared_owner
+);
+int rrr_net_transport_ctx_send_push_shared_urgent (
+		struct rrr_net_transport_handle *handle,
+		const void *data,
+		rrr_biglength size,
+		void (*shared_owner_incref)(void *shared_owner),
+		void (*shared_owner_decref)(void *shared_owner),
+		void *shared_owner
+);
 int rrr_net_transport_ctx_send_push_nullsafe (
 		struct rrr_net_transport_handle *handle,
 		const struct rrr_nullsafe_str *nullsafe
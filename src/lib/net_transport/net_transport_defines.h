@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_NET_TRANSPORT_F_TLS_VERSION_MIN_1_1             (1<<1)
 #define RRR_NET_TRANSPORT_F_TLS_NO_ALPN                     (1<<2)
 #define RRR_NET_TRANSPORT_F_QUIC_STREAM_OPEN_CB_LOCAL_ONLY  (1<<3)
+#define RRR_NET_TRANSPORT_F_TLS_KTLS                        (1<<4)
 
 #define RRR_NET_TRANSPORT_STREAM_F_LOCAL               (1<<0)
 #define RRR_NET_TRANSPORT_STREAM_F_BIDI                (1<<1)
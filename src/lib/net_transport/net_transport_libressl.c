@@ -284,6 +284,7 @@ static int __rrr_net_transport_libressl_bind_and_listen_callback (
 	}
 
 	data->ip_data.port = callback_data->port;
+	data->ip_data.reuse_port = callback_data->tls->reuse_port;
 
 	if (rrr_ip_network_start_tcp (&data->ip_data, 10, callback_data->do_ipv6) != 0) {
 		RRR_DBG_1("Note: Could not start IP listening in __rrr_net_transport_libressl_bind_and_listen_callback\n");
@@ -741,7 +742,8 @@ static const struct rrr_net_transport_methods libressl_methods = {
 	__rrr_net_transport_libressl_poll,
 	__rrr_net_transport_libressl_handshake,
 	__rrr_net_transport_libressl_is_tls,
-	__rrr_net_transport_libressl_selected_proto_get
+	__rrr_net_transport_libressl_selected_proto_get,
+	NULL
 };
 
 int rrr_net_transport_libressl_new (
@@ -24,9 +24,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 #include <openssl/bio.h>
+#include <openssl/rand.h>
+#include <openssl/evp.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#	include <openssl/core_names.h>
+#endif
 
 #define RRR_NET_TRANSPORT_H_ENABLE_INTERNALS
 
@@ -51,9 +57,307 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/gnu.h"
 #include "../util/macro_utils.h"
 #include "../util/posix.h"
+#include "../util/rrr_time.h"
+#include "../util/hash.h"
+
+// Tickets are accepted for at least this long and at most twice as long
+#define RRR_NET_TRANSPORT_OPENSSL_TICKET_KEY_ROTATE_INTERVAL_S (60 * 60)
+#define RRR_NET_TRANSPORT_OPENSSL_SESSION_CACHE_MAX 256
+#define RRR_NET_TRANSPORT_OPENSSL_SESSION_ID_CONTEXT "rrr"
 
 struct in6_addr;
 
+static int __rrr_net_transport_openssl_session_cache_clear_callback (
+		RRR_HASH_ITERATE_CALLBACK_ARGS
+) {
+	(void)(key);
+	(void)(key_size);
+	(void)(arg);
+
+	SSL_SESSION_free(value);
+
+	return RRR_HASH_ITERATE_REMOVE;
+}
+
+static void __rrr_net_transport_openssl_session_cache_clear (
+		struct rrr_net_transport_tls *tls
+) {
+	rrr_hash_iterate(&tls->session_cache, __rrr_net_transport_openssl_session_cache_clear_callback, NULL);
+	rrr_hash_clear(&tls->session_cache);
+}
+
+static void __rrr_net_transport_openssl_session_cache_remove (
+		struct rrr_net_transport_tls *tls,
+		const char *session_key
+) {
+	SSL_SESSION *session;
+
+	if ((session = rrr_hash_remove_str(&tls->session_cache, session_key)) != NULL) {
+		SSL_SESSION_free(session);
+	}
+}
+
+static SSL_SESSION *__rrr_net_transport_openssl_session_cache_get (
+		struct rrr_net_transport_tls *tls,
+		const char *session_key
+) {
+	SSL_SESSION *session;
+
+	if ((session = rrr_hash_get_str(&tls->session_cache, session_key)) == NULL) {
+		return NULL;
+	}
+
+	if ( !SSL_SESSION_is_resumable(session) ||
+	     (uint64_t) SSL_SESSION_get_time(session) + (uint64_t) SSL_SESSION_get_timeout(session) <= (uint64_t) time(NULL)
+	) {
+		__rrr_net_transport_openssl_session_cache_remove(tls, session_key);
+		return NULL;
+	}
+
+	return session;
+}
+
+// Called by OpenSSL when a client receives a new session or ticket. Return
+// value 1 means that we take over the reference to the session.
+static int __rrr_net_transport_openssl_session_new_callback (
+		SSL *ssl,
+		SSL_SESSION *session
+) {
+	struct rrr_net_transport_tls_data *ssl_data = SSL_get_app_data(ssl);
+	struct rrr_net_transport_tls *tls = SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+
+	if (ssl_data == NULL || ssl_data->session_key == NULL) {
+		return 0;
+	}
+
+	SSL_SESSION *session_old = rrr_hash_get_str(&tls->session_cache, ssl_data->session_key);
+
+	if (session_old == session) {
+		return 0;
+	}
+
+	if (session_old == NULL && RRR_HASH_COUNT(&tls->session_cache) >= RRR_NET_TRANSPORT_OPENSSL_SESSION_CACHE_MAX) {
+		// Many different remotes, start over
+		__rrr_net_transport_openssl_session_cache_clear(tls);
+	}
+
+	if (rrr_hash_set_str(&tls->session_cache, ssl_data->session_key, session) != 0) {
+		return 0;
+	}
+
+	if (session_old != NULL) {
+		SSL_SESSION_free(session_old);
+	}
+
+	RRR_DBG_7("OpenSSL cached session for %s\n", ssl_data->session_key);
+
+	return 1;
+}
+
+static int __rrr_net_transport_openssl_session_prepare (
+		struct rrr_net_transport_tls *tls,
+		struct rrr_net_transport_tls_data *ssl_data,
+		SSL *ssl,
+		const char *host,
+		unsigned int port
+) {
+	SSL_SESSION *session;
+
+	if (rrr_asprintf(&ssl_data->session_key, "%s:%u", host, port) <= 0) {
+		RRR_MSG_0("Could not allocate memory for session key in %s\n", __func__);
+		return 1;
+	}
+
+	SSL_set_app_data(ssl, ssl_data);
+
+	if ((session = __rrr_net_transport_openssl_session_cache_get(tls, ssl_data->session_key)) != NULL) {
+		if (SSL_set_session(ssl, session) != 1) {
+			RRR_SSL_ERR("Could not set TLS session for resumption");
+			return 1;
+		}
+		RRR_DBG_7("OpenSSL attempting to resume session with %s\n", ssl_data->session_key);
+	}
+
+	return 0;
+}
+
+static int __rrr_net_transport_openssl_ticket_key_generate (
+		struct rrr_net_transport_tls_ticket_key *key
+) {
+	if (RAND_bytes((unsigned char *) key, sizeof(*key)) != 1) {
+		RRR_SSL_ERR("Could not generate session ticket key");
+		return 1;
+	}
+	return 0;
+}
+
+static int __rrr_net_transport_openssl_ticket_keys_maintain (
+		struct rrr_net_transport_tls *tls
+) {
+	const uint64_t now = rrr_time_get_64();
+	const uint64_t interval = (uint64_t) RRR_NET_TRANSPORT_OPENSSL_TICKET_KEY_ROTATE_INTERVAL_S * 1000 * 1000;
+
+	if (now < tls->ticket_keys_rotate_time) {
+		return 0;
+	}
+
+	// Also replace the key about to become the previous key if it
+	// is too old (or not yet generated)
+	if (now >= tls->ticket_keys_rotate_time + interval) {
+		if (__rrr_net_transport_openssl_ticket_key_generate(&tls->ticket_keys[0]) != 0) {
+			return 1;
+		}
+	}
+
+	tls->ticket_keys[1] = tls->ticket_keys[0];
+
+	if (__rrr_net_transport_openssl_ticket_key_generate(&tls->ticket_keys[0]) != 0) {
+		return 1;
+	}
+
+	tls->ticket_keys_rotate_time = now + interval;
+
+	RRR_DBG_7("OpenSSL rotated session ticket keys\n");
+
+	return 0;
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static int __rrr_net_transport_openssl_ticket_key_callback (
+		SSL *ssl,
+		unsigned char key_name[16],
+		unsigned char iv[EVP_MAX_IV_LENGTH],
+		EVP_CIPHER_CTX *cipher_ctx,
+		EVP_MAC_CTX *mac_ctx,
+		int enc
+) {
+	struct rrr_net_transport_tls *tls = SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+	const struct rrr_net_transport_tls_ticket_key *key;
+
+	int ret = 1;
+
+	if (__rrr_net_transport_openssl_ticket_keys_maintain(tls) != 0) {
+		return -1;
+	}
+
+	if (enc) {
+		key = &tls->ticket_keys[0];
+		if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1) {
+			return -1;
+		}
+		memcpy(key_name, key->name, sizeof(key->name));
+	}
+	else if (memcmp(key_name, tls->ticket_keys[0].name, sizeof(tls->ticket_keys[0].name)) == 0) {
+		key = &tls->ticket_keys[0];
+		// OpenSSL clients use TLSv1.3 tickets only once, and no new ticket
+		// is issued after resumption unless renewal is requested
+		if (SSL_version(ssl) >= TLS1_3_VERSION) {
+			ret = 2;
+		}
+	}
+	else if (memcmp(key_name, tls->ticket_keys[1].name, sizeof(tls->ticket_keys[1].name)) == 0) {
+		key = &tls->ticket_keys[1];
+		// Accept, but make OpenSSL issue a new ticket using the current key
+		ret = 2;
+	}
+	else {
+		// Unknown or expired key, do a full handshake
+		return 0;
+	}
+
+	OSSL_PARAM params[] = {
+		OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, (void *) key->hmac_key, sizeof(key->hmac_key)),
+		OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char *) "sha256", 0),
+		OSSL_PARAM_construct_end()
+	};
+
+	if (EVP_MAC_CTX_set_params(mac_ctx, params) != 1) {
+		RRR_SSL_ERR("Could not set session ticket MAC parameters");
+		return -1;
+	}
+
+	if ((enc
+		? EVP_EncryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), NULL, key->aes_key, iv)
+		: EVP_DecryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), NULL, key->aes_key, iv)
+	) != 1) {
+		RRR_SSL_ERR("Could not initialize session ticket cipher");
+		return -1;
+	}
+
+	return ret;
+}
+#endif
+
+// Returns a new reference to the shared client or server context of the
+// transport, the context is created upon first use
+static int __rrr_net_transport_openssl_ctx_get (
+		SSL_CTX **target,
+		struct rrr_net_transport_tls *tls,
+		int is_server
+) {
+	SSL_CTX **ctx = is_server ? &tls->ssl_server_ctx : &tls->ssl_client_ctx;
+
+	*target = NULL;
+
+	if (*ctx == NULL) {
+		if (rrr_net_transport_openssl_common_new_ctx (
+				ctx,
+				is_server ? tls->ssl_server_method : tls->ssl_client_method,
+				tls->flags_tls,
+				tls->certificate_file,
+				tls->private_key_file,
+				tls->ca_file,
+				tls->ca_path,
+				&tls->alpn
+		) != 0) {
+			return 1;
+		}
+
+		SSL_CTX_set_app_data(*ctx, tls);
+
+		if (is_server) {
+			// Resumption fails if this is not set and peer verification is enabled
+			if (SSL_CTX_set_session_id_context (
+					*ctx,
+					(const unsigned char *) RRR_NET_TRANSPORT_OPENSSL_SESSION_ID_CONTEXT,
+					sizeof(RRR_NET_TRANSPORT_OPENSSL_SESSION_ID_CONTEXT) - 1
+			) != 1) {
+				RRR_SSL_ERR("Could not set session id context");
+				goto out_free;
+			}
+
+			SSL_CTX_set_timeout(*ctx, RRR_NET_TRANSPORT_OPENSSL_TICKET_KEY_ROTATE_INTERVAL_S);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+			SSL_CTX_set_tlsext_ticket_key_evp_cb(*ctx, __rrr_net_transport_openssl_ticket_key_callback);
+#endif
+		}
+		else {
+			SSL_CTX_set_session_cache_mode(*ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+			SSL_CTX_sess_set_new_cb(*ctx, __rrr_net_transport_openssl_session_new_callback);
+		}
+
+#ifdef SSL_OP_ENABLE_KTLS
+		if (tls->flags_tls & RRR_NET_TRANSPORT_F_TLS_KTLS) {
+			SSL_CTX_set_options(*ctx, SSL_OP_ENABLE_KTLS);
+		}
+#endif
+	}
+
+	if (SSL_CTX_up_ref(*ctx) != 1) {
+		RRR_SSL_ERR("Could not reference SSL CTX");
+		return 1;
+	}
+
+	*target = *ctx;
+
+	return 0;
+
+	out_free:
+		SSL_CTX_free(*ctx);
+		*ctx = NULL;
+		return 1;
+}
+
 static int __rrr_net_transport_openssl_ssl_data_close (struct rrr_net_transport_handle *handle) {
 	rrr_net_transport_openssl_common_ssl_data_destroy (handle->submodule_private_ptr);
 	return 0;
@@ -73,9 +377,21 @@ static int __rrr_net_transport_openssl_pre_destroy (
 static void __rrr_net_transport_openssl_destroy (
 		RRR_NET_TRANSPORT_DESTROY_ARGS
 ) {
+	struct rrr_net_transport_tls *tls = (struct rrr_net_transport_tls *) transport;
+
+	__rrr_net_transport_openssl_session_cache_clear(tls);
+
+	if (tls->ssl_client_ctx != NULL) {
+		SSL_CTX_free(tls->ssl_client_ctx);
+	}
+	if (tls->ssl_server_ctx != NULL) {
+		SSL_CTX_free(tls->ssl_server_ctx);
+	}
+
+	OPENSSL_cleanse(tls->ticket_keys, sizeof(tls->ticket_keys));
+
 	rrr_openssl_global_unregister_user();
 
-	struct rrr_net_transport_tls *tls = (struct rrr_net_transport_tls *) transport;
 	rrr_net_transport_tls_common_destroy(tls);
 }
 
@@ -162,16 +478,7 @@ int __rrr_net_transport_openssl_connect_callback (
 		goto out_final;
 	}
 
-	if (rrr_net_transport_openssl_common_new_ctx (
-			&ssl_data->o_ctx,
-			tls->ssl_client_method,
-			tls->flags_tls,
-			tls->certificate_file,
-			tls->private_key_file,
-			tls->ca_file,
-			tls->ca_path,
-			&tls->alpn
-	) != 0) {
+	if (__rrr_net_transport_openssl_ctx_get(&ssl_data->o_ctx, tls, 0 /* Not server */) != 0) {
 		RRR_SSL_ERR("Could not get SSL CTX in __rrr_net_transport_openssl_connect_callback");
 		ret = 1;
 		goto out_destroy_ssl_data;
@@ -198,6 +505,11 @@ int __rrr_net_transport_openssl_connect_callback (
 		goto out_destroy_ssl_data;
 	}
 
+	if (__rrr_net_transport_openssl_session_prepare(tls, ssl_data, ssl, callback_data->host, callback_data->port) != 0) {
+		ret = 1;
+		goto out_destroy_ssl_data;
+	}
+
 	if (SSL_set_max_proto_version(ssl, TLS1_3_VERSION) != 1) {
 		RRR_SSL_ERR("Could set SSL protocol version");
 		ret = 1;
@@ -327,6 +639,7 @@ static int __rrr_net_transport_openssl_bind_and_listen_callback (
 	}
 
 	ssl_data->ip_data.port = callback_data->port;
+	ssl_data->ip_data.reuse_port = tls->reuse_port;
 
 	if (rrr_ip_network_start_tcp (&ssl_data->ip_data, 10, callback_data->do_ipv6) != 0) {
 		RRR_DBG_1("Note: Could not start IP listening in __rrr_net_transport_openssl_bind_and_listen_callback\n");
@@ -334,16 +647,7 @@ static int __rrr_net_transport_openssl_bind_and_listen_callback (
 		goto out_free_ssl_data;
 	}
 
-	if (rrr_net_transport_openssl_common_new_ctx (
-			&ssl_data->o_ctx,
-			tls->ssl_server_method,
-			tls->flags_tls,
-			tls->certificate_file,
-			tls->private_key_file,
-			tls->ca_file,
-			tls->ca_path,
-			&tls->alpn
-	) != 0) {
+	if (__rrr_net_transport_openssl_ctx_get(&ssl_data->o_ctx, tls, 1 /* Is server */) != 0) {
 		RRR_SSL_ERR("Could not get SSL CTX in __rrr_net_transport_openssl_bind_and_listen_callback");
 		ret = 1;
 		goto out_destroy_ip;
@@ -434,16 +738,7 @@ static int __rrr_net_transport_openssl_accept_callback (
 		goto out;
 	}
 
-	if (rrr_net_transport_openssl_common_new_ctx (
-			&ssl_data->o_ctx,
-			tls->ssl_server_method,
-			tls->flags_tls,
-			tls->certificate_file,
-			tls->private_key_file,
-			tls->ca_file,
-			tls->ca_path,
-			&tls->alpn
-	) != 0) {
+	if (__rrr_net_transport_openssl_ctx_get(&ssl_data->o_ctx, tls, 1 /* Is server */) != 0) {
 		RRR_SSL_ERR("Could not get SSL CTX in __rrr_net_transport_openssl_accept_callback");
 		ret = 1;
 		goto out_destroy;
@@ -728,10 +1023,38 @@ static int __rrr_net_transport_openssl_poll (
 	return RRR_READ_OK;
 }
 
+static void __rrr_net_transport_openssl_handshake_stats_update (
+		struct rrr_net_transport_tls *tls,
+		struct rrr_net_transport_handle *handle,
+		SSL *ssl
+) {
+	int reused = SSL_session_reused(ssl);
+	int ktls_send = 0;
+	int ktls_recv = 0;
+
+#ifdef SSL_OP_ENABLE_KTLS
+	ktls_send = BIO_get_ktls_send(SSL_get_wbio(ssl)) == 1;
+	ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(ssl)) == 1;
+#endif
+
+	tls->stats.handshakes++;
+	tls->stats.handshakes_resumed += (uint64_t) (reused != 0);
+	tls->stats.ktls_send += (uint64_t) ktls_send;
+	tls->stats.ktls_recv += (uint64_t) ktls_recv;
+
+	RRR_DBG_7("OpenSSL handshake complete fd %i %s session%s%s\n",
+		handle->submodule_fd,
+		reused ? "resumed" : "new",
+		ktls_send ? " kTLS send" : "",
+		ktls_recv ? " kTLS receive" : ""
+	);
+}
+
 static int __rrr_net_transport_openssl_handshake (
 		RRR_NET_TRANSPORT_HANDSHAKE_ARGS
 ) {
 	struct rrr_net_transport_tls_data *ssl_data = handle->submodule_private_ptr;
+	struct rrr_net_transport_tls *tls = (struct rrr_net_transport_tls *) handle->transport;
 
 	SSL *ssl;
 	BIO_get_ssl(ssl_data->web, &ssl);
@@ -741,6 +1064,10 @@ static int __rrr_net_transport_openssl_handshake (
 		if (BIO_should_retry(ssl_data->web) || SSL_want_read(ssl) || SSL_want_write(ssl)) {
 			return RRR_NET_TRANSPORT_SEND_INCOMPLETE;
 		}
+		if (ssl_data->session_key != NULL) {
+			// Don't offer a possibly bad session again
+			__rrr_net_transport_openssl_session_cache_remove(tls, ssl_data->session_key);
+		}
 		if (ret_tmp < 0) {
 			RRR_MSG_0("Fatal error during handshake (possible certificate expiration): %i\n", SSL_get_error(ssl, ret_tmp));
 			switch (SSL_get_error(ssl, ret_tmp)) {
@@ -812,6 +1139,8 @@ static int __rrr_net_transport_openssl_handshake (
 		return RRR_NET_TRANSPORT_SEND_SOFT_ERROR;
 	}
 
+	__rrr_net_transport_openssl_handshake_stats_update(tls, handle, ssl);
+
 	return RRR_NET_TRANSPORT_SEND_OK;
 }
 
@@ -846,7 +1175,8 @@ static const struct rrr_net_transport_methods tls_methods = {
 	__rrr_net_transport_openssl_poll,
 	__rrr_net_transport_openssl_handshake,
 	__rrr_net_transport_openssl_is_tls,
-	__rrr_net_transport_openssl_selected_proto_get
+	__rrr_net_transport_openssl_selected_proto_get,
+	NULL
 };
 
 int rrr_net_transport_openssl_new (
@@ -873,6 +1203,12 @@ int rrr_net_transport_openssl_new (
 		return 1;
 	}
 
+#ifndef SSL_OP_ENABLE_KTLS
+	if (flags & RRR_NET_TRANSPORT_F_TLS_KTLS) {
+		RRR_MSG_0("Warning: Kernel TLS requested but not supported by the OpenSSL version in use\n");
+	}
+#endif
+
 	rrr_openssl_global_register_user();
 
 	(*target)->methods = &tls_methods;
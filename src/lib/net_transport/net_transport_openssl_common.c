@@ -60,6 +60,7 @@ void rrr_net_transport_openssl_common_ssl_data_destroy (
 		if (ssl_data->ip_data.fd != 0) {
 			rrr_ip_close(&ssl_data->ip_data);
 		}
+		RRR_FREE_IF_NOT_NULL(ssl_data->session_key);
 		rrr_free(ssl_data);
 	}
 }
@@ -273,6 +273,21 @@ static int __rrr_net_transport_plain_send (
 	return ret;
 }
 
+static int __rrr_net_transport_plain_sendv (
+		RRR_NET_TRANSPORT_SENDV_ARGS
+) {
+	struct rrr_socket_options options;
+
+	*bytes_written = 0;
+
+	if (rrr_socket_get_options_from_fd(&options, handle->submodule_fd) != 0) {
+		RRR_MSG_0("Could not get socket options for fd %i in %s\n", handle->submodule_fd, __func__);
+		return RRR_NET_TRANSPORT_SEND_HARD_ERROR;
+	}
+
+	return rrr_socket_sendv_nonblock_check_retry(bytes_written, &options, iov, iov_count, 0 /* Not silent */);
+}
+
 int __rrr_net_transport_plain_bind_and_listen (
 		RRR_NET_TRANSPORT_BIND_AND_LISTEN_ARGS
 ) {
@@ -283,6 +298,7 @@ int __rrr_net_transport_plain_bind_and_listen (
 	struct rrr_ip_data ip_data = {0};
 
 	ip_data.port = port;
+	ip_data.reuse_port = transport->reuse_port;
 
 	if ((ret = rrr_ip_network_start_tcp(&ip_data, 10, do_ipv6)) != 0) {
 		goto out;
@@ -441,7 +457,8 @@ static const struct rrr_net_transport_methods plain_methods = {
 	__rrr_net_transport_plain_poll,
 	__rrr_net_transport_plain_handshake,
 	__rrr_net_transport_plain_is_tls,
-	__rrr_net_transport_plain_selected_proto_get
+	__rrr_net_transport_plain_selected_proto_get,
+	__rrr_net_transport_plain_sendv
 };
 
 int rrr_net_transport_plain_new (struct rrr_net_transport_plain **target) {
@@ -3580,7 +3580,8 @@ static const struct rrr_net_transport_methods tls_methods = {
 	__rrr_net_transport_quic_poll,
 	__rrr_net_transport_quic_handshake,
 	__rrr_net_transport_quic_is_tls,
-	__rrr_net_transport_quic_selected_proto_get
+	__rrr_net_transport_quic_selected_proto_get,
+	NULL
 };
 
 int rrr_net_transport_quic_new (
@@ -36,6 +36,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../read_constants.h"
 #include "../socket/rrr_socket.h"
 #include "../util/linked_list.h"
+#include "../util/hash.h"
 #include "../event/event_collection_struct.h"
 
 struct rrr_read_session;
@@ -211,6 +212,12 @@ struct rrr_nullsafe_str;
     const void *data,                                          \
     rrr_biglength size
 
+#define RRR_NET_TRANSPORT_SENDV_ARGS                           \
+    rrr_biglength *bytes_written,                              \
+    struct rrr_net_transport_handle *handle,                   \
+    const struct iovec *iov,                                   \
+    int iov_count
+
 #define RRR_NET_TRANSPORT_SELECTED_PROTO_GET_ARGS              \
     char **proto,                                              \
     struct rrr_net_transport_handle *handle
@@ -307,6 +314,10 @@ struct rrr_net_transport_methods {
 
 	// Get selected ALPN protocol
 	int (*selected_proto_get)(RRR_NET_TRANSPORT_SELECTED_PROTO_GET_ARGS);
+
+	// Optional, send multiple buffers at once. Only valid for stream oriented
+	// transports as buffers may be partially sent and boundaries are not kept.
+	int (*sendv)(RRR_NET_TRANSPORT_SENDV_ARGS);
 };
 
 struct rrr_net_transport_handle {
@@ -367,9 +378,11 @@ struct rrr_net_transport_handle {
 	void *application_private_ptr;
 	void (*application_ptr_destroy)(void *ptr);
 
-	// Optionally used to find existing connections to remotes
+	// Optionally used to find existing connections to remotes. Handles
+	// with equal match data are chained in the order they were set.
 	char *match_string;
 	uint64_t match_number;
+	struct rrr_net_transport_handle *match_next;
 
 	// Transport handshake is complete, application may be called
 	int handshake_complete;
@@ -388,6 +401,13 @@ struct rrr_net_transport_handle {
 struct rrr_net_transport_handle_collection {
 	RRR_LL_HEAD(struct rrr_net_transport_handle);
 	rrr_net_transport_handle next_handle_position;
+
+	// Lookup of handles by handle id, by connection id and by match
+	// data. Nodes in the list above must also be present in the index
+	// by handle id.
+	struct rrr_hash handle_index;
+	struct rrr_hash cid_index;
+	struct rrr_hash match_index;
 };
 
 struct rrr_net_transport {
@@ -96,6 +96,7 @@ int rrr_net_transport_tls_common_new (
 	CHECK_FLAG(RRR_NET_TRANSPORT_F_TLS_NO_CERT_VERIFY);
 	CHECK_FLAG(RRR_NET_TRANSPORT_F_TLS_VERSION_MIN_1_1);
 	CHECK_FLAG(RRR_NET_TRANSPORT_F_TLS_NO_ALPN);
+	CHECK_FLAG(RRR_NET_TRANSPORT_F_TLS_KTLS);
 
 	if (flags_tls != 0) {
 		RRR_BUG("BUG: Unknown flags %i given to rrr_net_transport_tls_new\n", flags_tls);
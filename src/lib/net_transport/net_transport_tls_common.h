@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "net_transport.h"
 #include "../ip/ip.h"
 #include "../socket/rrr_socket_graylist.h"
+#include "../util/hash.h"
 
 #define RRR_NET_TRANSPORT_TLS_COMMON_ALPN_MAX 6
 
@@ -46,6 +47,14 @@ struct rrr_net_transport_tls_alpn {
 	unsigned int alpn_buf_count;
 };
 
+#ifdef RRR_WITH_OPENSSL
+struct rrr_net_transport_tls_ticket_key {
+	unsigned char name[16];
+	unsigned char aes_key[32];
+	unsigned char hmac_key[32];
+};
+#endif
+
 struct rrr_net_transport_tls {
 	RRR_NET_TRANSPORT_HEAD(struct rrr_net_transport_tls);
 
@@ -55,6 +64,18 @@ struct rrr_net_transport_tls {
 #ifdef RRR_WITH_OPENSSL
 	const SSL_METHOD *ssl_client_method;
 	const SSL_METHOD *ssl_server_method;
+
+	// Contexts shared by all connections, created upon first use. Session
+	// resumption only works between handshakes using the same context.
+	SSL_CTX *ssl_client_ctx;
+	SSL_CTX *ssl_server_ctx;
+
+	// Client sessions by remote "host:port"
+	struct rrr_hash session_cache;
+
+	// Current and previous session ticket encryption keys
+	struct rrr_net_transport_tls_ticket_key ticket_keys[2];
+	uint64_t ticket_keys_rotate_time;
 #endif
 
 #ifdef RRR_WITH_LIBRESSL
@@ -69,6 +90,8 @@ struct rrr_net_transport_tls {
 	int flags_tls;
 	int flags_submodule;
 
+	struct rrr_net_transport_tls_stats stats;
+
 	char *certificate_file;
 	char *private_key_file;
 	char *ca_file;
@@ -84,6 +107,7 @@ struct rrr_net_transport_tls_data {
 	SSL_CTX *o_ctx;
 	BIO *web;
 	SSL *ssl;
+	char *session_key;
 #endif
 
 #ifdef RRR_WITH_LIBRESSL
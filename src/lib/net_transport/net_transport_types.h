@@ -32,4 +32,11 @@ struct rrr_net_transport_vector {
 	size_t len;
 };
 
+struct rrr_net_transport_tls_stats {
+	uint64_t handshakes;
+	uint64_t handshakes_resumed;
+	uint64_t ktls_send;
+	uint64_t ktls_recv;
+};
+
 #endif /* RRR_NET_TRANSPORT_TYPES_H */
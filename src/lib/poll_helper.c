@@ -78,12 +78,6 @@ static void __rrr_poll_intermediate_callback_nexthop_check (
 	);
 }
 
-struct rrr_poll_intermediate_callback_data {
-	struct rrr_instance_runtime_data *thread_data;
-	int (*callback)(RRR_MODULE_POLL_CALLBACK_SIGNATURE);
-	void *arg;
-};
-
 static int __rrr_poll_intermediate_callback (
 		RRR_MODULE_POLL_CALLBACK_SIGNATURE
 ) {
@@ -115,7 +109,7 @@ static int __rrr_poll_intermediate_callback (
 		return ret;
 }
 
-int rrr_poll_do_poll_delete_custom_arg (
+static int __rrr_poll_do_poll_delete (
 		uint16_t *amount,
 		struct rrr_instance_runtime_data *thread_data,
 		int (*callback)(RRR_MODULE_POLL_CALLBACK_SIGNATURE),
@@ -133,6 +127,24 @@ int rrr_poll_do_poll_delete_custom_arg (
 		message_broker_flags |= RRR_MESSAGE_BROKER_POLL_F_CHECK_BACKSTOP;
 	}
 
+	// A fused sender passes entries directly to the callback given in
+	// the first poll. Modules must always use the same callback.
+	if (INSTANCE_D_MISC_FLAGS(thread_data) & RRR_INSTANCE_MISC_OPTIONS_FUSED) {
+		if (thread_data->poll_fused.callback == NULL) {
+			thread_data->poll_fused = callback_data;
+			rrr_message_broker_fused_callback_set (
+					INSTANCE_D_HANDLE(thread_data),
+					message_broker_flags,
+					__rrr_poll_intermediate_callback,
+					&thread_data->poll_fused
+			);
+		}
+		else if (thread_data->poll_fused.callback != callback || thread_data->poll_fused.arg != callback_arg) {
+			RRR_BUG("BUG: Fused instance %s polled with a different callback or argument than in the first poll in %s\n",
+					INSTANCE_D_NAME(thread_data), __func__);
+		}
+	}
+
 	return rrr_message_broker_poll_delete (
 			amount,
 			INSTANCE_D_HANDLE(thread_data),
@@ -142,10 +154,26 @@ int rrr_poll_do_poll_delete_custom_arg (
 	);
 }
 
+// The argument may only be valid during the poll and is not remembered
+// for direct delivery, fused instances must use rrr_poll_do_poll_delete
+int rrr_poll_do_poll_delete_custom_arg (
+		uint16_t *amount,
+		struct rrr_instance_runtime_data *thread_data,
+		int (*callback)(RRR_MODULE_POLL_CALLBACK_SIGNATURE),
+		void *callback_arg
+) {
+	if (INSTANCE_D_MISC_FLAGS(thread_data) & RRR_INSTANCE_MISC_OPTIONS_FUSED) {
+		RRR_BUG("BUG: Fused instance %s polled with custom argument in %s\n",
+				INSTANCE_D_NAME(thread_data), __func__);
+	}
+
+	return __rrr_poll_do_poll_delete(amount, thread_data, callback, callback_arg);
+}
+
 int rrr_poll_do_poll_delete (
 		uint16_t *amount,
 		struct rrr_instance_runtime_data *thread_data,
 		int (*callback)(RRR_MODULE_POLL_CALLBACK_SIGNATURE)
 ) {
-	return rrr_poll_do_poll_delete_custom_arg(amount, thread_data, callback, thread_data);
+	return __rrr_poll_do_poll_delete(amount, thread_data, callback, thread_data);
 }
@@ -43,6 +43,12 @@ struct rrr_poll_helper_counters {
 	unsigned int poll_count_tmp;
 };
 
+struct rrr_poll_intermediate_callback_data {
+	struct rrr_instance_runtime_data *thread_data;
+	int (*callback)(RRR_MODULE_POLL_CALLBACK_SIGNATURE);
+	void *arg;
+};
+
 #define RRR_POLL_HELPER_COUNTERS_UPDATE_POLLED(data)           \
     data->counters.total_message_count++;                      \
     data->counters.poll_count_tmp++;
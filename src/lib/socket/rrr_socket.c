@@ -35,10 +35,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <poll.h>
 #include <sys/un.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 #ifdef RRR_HAVE_EVENTFD
 #	include <sys/eventfd.h>
 #endif
+#ifdef RRR_HAVE_INOTIFY
+#	include <sys/inotify.h>
+#endif
 
 #include "../log.h"
 #include "../allocator.h"
@@ -64,6 +68,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
  * which it had when the fork was created. New sockets created in the
  * main process can be added later, but they are not visible to
  * the fork. Also, new sockets in the fork are not visible to main.
+ *
+ * Sockets are registered in shards selected by the lowest bits of the
+ * fd. Within a shard, the holders are stored in an array indexed by the
+ * remaining bits of the fd, giving constant time lookup. Threads
+ * opening and closing different fds will mostly take different locks.
+ * Operations on all sockets lock all shards in ascending order.
  */
 
 // Allow read/write from self and group (mask away others)
@@ -71,6 +81,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_SOCKET_UNIX_DEFAULT_UMASK \
 	S_IROTH | S_IWOTH | S_IXOTH
 
+#define RRR_SOCKET_SHARD_BITS 4
+#define RRR_SOCKET_SHARD_COUNT (1 << RRR_SOCKET_SHARD_BITS)
+#define RRR_SOCKET_SHARD_MASK (RRR_SOCKET_SHARD_COUNT - 1)
+#define RRR_SOCKET_SHARD_HOLDERS_INITIAL 64
+
 struct rrr_socket_private_data {
 	RRR_LL_NODE(struct rrr_socket_private_data);
 	enum rrr_socket_private_data_class class;
@@ -82,7 +97,6 @@ struct rrr_socket_private_data_collection {
 };
 
 struct rrr_socket_holder {
-	RRR_LL_NODE(struct rrr_socket_holder);
 	char *creator;
 	char *filename_unlink;
 	char *filename_no_unlink;
@@ -91,27 +105,79 @@ struct rrr_socket_holder {
 	struct rrr_socket_private_data_collection private_data;
 };
 
-struct rrr_socket_holder_collection {
-	RRR_LL_HEAD(struct rrr_socket_holder);
+struct rrr_socket_shard {
+	pthread_mutex_t lock;
+	struct rrr_socket_holder **holders;
+	size_t holders_size;
+	size_t count;
+};
+
+#define RRR_SOCKET_SHARD_INITIALIZER \
+	{ PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0 }
+
+// Number of initializers must match RRR_SOCKET_SHARD_COUNT
+static struct rrr_socket_shard socket_shards[RRR_SOCKET_SHARD_COUNT] = {
+	RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER,
+	RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER,
+	RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER,
+	RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER, RRR_SOCKET_SHARD_INITIALIZER
 };
 
-struct rrr_socket_holder_collection socket_list = {0};
-static pthread_mutex_t socket_lock = PTHREAD_MUTEX_INITIALIZER;
+// Number of shard locks held by the current thread, used to detect re-entry
+static _Thread_local int socket_lock_depth = 0;
+
+static struct rrr_socket_shard *__rrr_socket_shard_lock (
+		int fd
+) {
+	struct rrr_socket_shard *shard = &socket_shards[(unsigned int) fd & RRR_SOCKET_SHARD_MASK];
+	pthread_mutex_lock(&shard->lock);
+	socket_lock_depth++;
+	return shard;
+}
+
+static void __rrr_socket_shard_unlock (
+		struct rrr_socket_shard *shard
+) {
+	socket_lock_depth--;
+	pthread_mutex_unlock(&shard->lock);
+}
+
+static void __rrr_socket_shard_lock_all (void) {
+	for (size_t i = 0; i < RRR_SOCKET_SHARD_COUNT; i++) {
+		pthread_mutex_lock(&socket_shards[i].lock);
+		socket_lock_depth++;
+	}
+}
+
+static void __rrr_socket_shard_unlock_all (void) {
+	for (size_t i = RRR_SOCKET_SHARD_COUNT; i > 0; i--) {
+		socket_lock_depth--;
+		pthread_mutex_unlock(&socket_shards[i - 1].lock);
+	}
+}
+
+static struct rrr_socket_holder *__rrr_socket_shard_get (
+		struct rrr_socket_shard *shard,
+		int fd
+) {
+	const size_t index = (size_t) ((unsigned int) fd >> RRR_SOCKET_SHARD_BITS);
+	return index < shard->holders_size ? shard->holders[index] : NULL;
+}
 
-void __rrr_socket_private_data_destroy (
+static void __rrr_socket_private_data_destroy (
 		struct rrr_socket_private_data *node
 ) {
 	RRR_FREE_IF_NOT_NULL(node->data);
 	rrr_free(node);
 }
 
-void __rrr_socket_private_data_collection_clear (
+static void __rrr_socket_private_data_collection_clear (
 		struct rrr_socket_private_data_collection *collection
 ) {
 	RRR_LL_DESTROY(collection, struct rrr_socket_private_data, __rrr_socket_private_data_destroy(node));
 }
 
-int __rrr_socket_private_data_collection_allocate_and_push (
+static int __rrr_socket_private_data_collection_allocate_and_push (
 		struct rrr_socket_private_data_collection *collection,
 		enum rrr_socket_private_data_class class,
 		size_t size
@@ -134,7 +200,7 @@ int __rrr_socket_private_data_collection_allocate_and_push (
 		goto out_free_node;
 	}
 
-	memset(new_data, '\0', sizeof(size));
+	memset(new_data, '\0', size);
 
 	new_node->class = class;
 	new_node->data = new_data;
@@ -147,11 +213,23 @@ int __rrr_socket_private_data_collection_allocate_and_push (
 		return ret;
 }
 
-int __rrr_socket_holder_close_and_destroy(struct rrr_socket_holder *holder, int no_unlink) {
-	int ret = 0;
+static void __rrr_socket_holder_destroy (
+		struct rrr_socket_holder *holder
+) {
+	__rrr_socket_private_data_collection_clear(&holder->private_data);
+	RRR_FREE_IF_NOT_NULL(holder->filename_unlink);
+	RRR_FREE_IF_NOT_NULL(holder->filename_no_unlink);
+	RRR_FREE_IF_NOT_NULL(holder->creator);
+	rrr_socket_send_chunk_collection_clear(&holder->send_chunks);
+	rrr_free(holder);
+}
+
+static void __rrr_socket_holder_close_and_destroy (
+		struct rrr_socket_holder *holder,
+		int no_unlink
+) {
 	if (holder->options.fd > 0) {
-		ret = close(holder->options.fd);
-		if (ret != 0) {
+		if (close(holder->options.fd) != 0) {
 			// A socket is sometimes closed by the other host
 			if (errno != EBADF) {
 				RRR_MSG_0("Warning: Socket close of fd %i failed in rrr_socket_close: %s\n",
@@ -163,18 +241,28 @@ int __rrr_socket_holder_close_and_destroy(struct rrr_socket_holder *holder, int
 		RRR_DBG_7("socket pid %i filename %s unlink\n", getpid(), holder->filename_unlink);
 		unlink(holder->filename_unlink);
 	}
-	__rrr_socket_private_data_collection_clear(&holder->private_data);
-	RRR_FREE_IF_NOT_NULL(holder->filename_unlink);
-	RRR_FREE_IF_NOT_NULL(holder->filename_no_unlink);
-	RRR_FREE_IF_NOT_NULL(holder->creator);
-	rrr_socket_send_chunk_collection_clear(&holder->send_chunks);
-	rrr_free(holder);
+	__rrr_socket_holder_destroy(holder);
+}
 
-	// Must always return 0 or linked list won' remove the node
-	return 0;
+static int __rrr_socket_sendv_possible (
+		const struct rrr_socket_options *options
+) {
+	struct stat st;
+
+	// Vectored writes would merge records on datagram and packet sockets
+	if (options->domain != 0) {
+		return (options->type & ~(SOCK_NONBLOCK|SOCK_CLOEXEC)) == SOCK_STREAM;
+	}
+
+	// Files, pipes and character devices, but not for instance eventfd
+	if (fstat(options->fd, &st) != 0) {
+		return 0;
+	}
+
+	return S_ISREG(st.st_mode) || S_ISFIFO(st.st_mode) || S_ISCHR(st.st_mode);
 }
 
-int __rrr_socket_holder_new (
+static int __rrr_socket_holder_new (
 		struct rrr_socket_holder **holder,
 		const char *creator,
 		const char *filename,
@@ -201,7 +289,11 @@ int __rrr_socket_holder_new (
 		RRR_BUG("Creator was NULL in __rrr_socket_holder_new\n");
 	}
 
-	result->creator = rrr_strdup(creator);
+	if ((result->creator = rrr_strdup(creator)) == NULL) {
+		RRR_MSG_0("Could not allocate memory for creator in __rrr_socket_holder_new\n");
+		ret = 1;
+		goto out;
+	}
 
 	if (filename != NULL) {
 		char *filename_tmp = rrr_strdup(filename);
@@ -222,32 +314,151 @@ int __rrr_socket_holder_new (
 	result->options.domain = domain;
 	result->options.type = type;
 	result->options.protocol = protocol;
+	result->options.sendv_possible = __rrr_socket_sendv_possible(&result->options);
 
 	*holder = result;
 	result = NULL;
 
 	out:
-	RRR_FREE_IF_NOT_NULL(result);
+	if (result != NULL) {
+		__rrr_socket_holder_destroy(result);
+	}
 	return ret;
 }
 
+static int __rrr_socket_shard_grow (
+		struct rrr_socket_shard *shard,
+		size_t index
+) {
+	size_t holders_size_new = shard->holders_size > 0
+		? shard->holders_size
+		: RRR_SOCKET_SHARD_HOLDERS_INITIAL
+	;
+
+	while (holders_size_new <= index) {
+		holders_size_new *= 2;
+	}
+
+	struct rrr_socket_holder **holders_new = rrr_reallocate(shard->holders, sizeof(*holders_new) * holders_size_new);
+	if (holders_new == NULL) {
+		RRR_MSG_0("Could not allocate memory in __rrr_socket_shard_grow\n");
+		return 1;
+	}
+
+	memset(holders_new + shard->holders_size, '\0', sizeof(*holders_new) * (holders_size_new - shard->holders_size));
+
+	shard->holders = holders_new;
+	shard->holders_size = holders_size_new;
+
+	return 0;
+}
+
+static void __rrr_socket_shard_remove_and_close (
+		struct rrr_socket_shard *shard,
+		struct rrr_socket_holder *holder,
+		int no_unlink
+) {
+	// The slot must be cleared while the shard is still locked. Once the
+	// fd is closed, another thread may receive the same fd number and will
+	// wait on this shard lock before registering it.
+	shard->holders[(unsigned int) holder->options.fd >> RRR_SOCKET_SHARD_BITS] = NULL;
+	shard->count--;
+	__rrr_socket_holder_close_and_destroy(holder, no_unlink);
+}
+
+static void __rrr_socket_dump_unlocked (void) {
+	size_t count = 0;
+	for (size_t i = 0; i < RRR_SOCKET_SHARD_COUNT; i++) {
+		count += socket_shards[i].count;
+	}
+	RRR_DBG_7("There are now %llu sockets\n", (unsigned long long) count);
+/*	Noisy
+	for (size_t i = 0; i < RRR_SOCKET_SHARD_COUNT; i++) {
+		for (size_t j = 0; j < socket_shards[i].holders_size; j++) {
+			const struct rrr_socket_holder *node = socket_shards[i].holders[j];
+			if (node == NULL)
+				continue;
+			const char *filename = (node->filename_unlink ? node->filename_unlink : node->filename_no_unlink);
+			RRR_DBG_7 ("fd %i pid %i creator %s filename %s%s\n", node->options.fd, getpid(), node->creator, filename, node->filename_unlink ? " (listen)" : "");
+		}
+	}
+	RRR_DBG_7("---\n");*/
+}
+
+static int __rrr_socket_add (
+		int fd,
+		int domain,
+		int type,
+		int protocol,
+		const char *creator,
+		const char *filename,
+		int filename_unlink
+) {
+	int ret = 0;
+
+	struct rrr_socket_holder *holder = NULL;
+
+	if (__rrr_socket_holder_new(&holder, creator, filename, filename_unlink, fd, domain, type, protocol) != 0) {
+		RRR_MSG_0("Could not create socket holder in __rrr_socket_add\n");
+		ret = 1;
+		goto out;
+	}
+
+	const size_t index = (size_t) ((unsigned int) fd >> RRR_SOCKET_SHARD_BITS);
+
+	struct rrr_socket_shard *shard = __rrr_socket_shard_lock(fd);
+
+	if (index >= shard->holders_size && (ret = __rrr_socket_shard_grow(shard, index)) != 0) {
+		goto out_unlock;
+	}
+
+	if (shard->holders[index] != NULL) {
+		// The fd has been closed without using rrr_socket_close and has
+		// now been reused. The old holder must not close the fd.
+		RRR_MSG_0("Warning: fd %i from %s was already registered by %s, it was probably closed without using rrr_socket_close\n",
+				fd, creator, shard->holders[index]->creator);
+		__rrr_socket_holder_destroy(shard->holders[index]);
+		shard->count--;
+	}
+
+	shard->holders[index] = holder;
+	shard->count++;
+	holder = NULL;
+
+	RRR_DBG_7("rrr_socket add fd %i pid %i, there are now %llu sockets in shard %u\n",
+			fd, getpid(), (unsigned long long) shard->count, (unsigned int) fd & RRR_SOCKET_SHARD_MASK);
+
+	out_unlock:
+		__rrr_socket_shard_unlock(shard);
+	out:
+		if (holder != NULL) {
+			__rrr_socket_holder_destroy(holder);
+		}
+		return ret;
+}
+
 void rrr_socket_unlink (
 		int fd
 ) {
-	RRR_LL_ITERATE_BEGIN(&socket_list,struct rrr_socket_holder);
-		if (node->options.fd == fd) {
-			char *filename = node->filename_unlink != NULL ? node->filename_unlink : node->filename_no_unlink;
-			if (filename == NULL) {
-				RRR_MSG_0("Warning: Socket unlink of fd %i called but it had no filename registered with it.\n", fd);
-				return;
-			}
-			RRR_DBG_7("socket pid %i fd %i filename %s direct unlink\n", getpid(), fd, filename);
-			unlink(filename);
-			return;
-		}
-	RRR_LL_ITERATE_END();
+	struct rrr_socket_shard *shard = __rrr_socket_shard_lock(fd);
+	const struct rrr_socket_holder *holder = __rrr_socket_shard_get(shard, fd);
 
-	RRR_MSG_0("Warning: Socket unlink of fd %i called but it was not registered.\n", fd);
+	if (holder == NULL) {
+		RRR_MSG_0("Warning: Socket unlink of fd %i called but it was not registered.\n", fd);
+		goto out;
+	}
+
+	const char *filename = holder->filename_unlink != NULL ? holder->filename_unlink : holder->filename_no_unlink;
+	if (filename == NULL) {
+		RRR_MSG_0("Warning: Socket unlink of fd %i called but it had no filename registered with it.\n", fd);
+		goto out;
+	}
+
+	RRR_DBG_7("socket pid %i fd %i filename %s direct unlink\n", getpid(), fd, filename);
+	unlink(filename);
+
+	out:
+	__rrr_socket_shard_unlock(shard);
 }
 
 int rrr_socket_with_filename_do (
@@ -255,69 +466,73 @@ int rrr_socket_with_filename_do (
 		int (*callback)(const char *filename, void *arg),
 		void *callback_arg
 ) {
-	RRR_LL_ITERATE_BEGIN(&socket_list, struct rrr_socket_holder);
-		if (node->options.fd == fd) {
-			if (node->filename_unlink) {
-				return callback(node->filename_unlink, callback_arg);
-			}
-			else {
-				return callback(node->filename_no_unlink, callback_arg);
-			}
-		}
-	RRR_LL_ITERATE_END();
+	int ret = 1;
+
+	struct rrr_socket_shard *shard = __rrr_socket_shard_lock(fd);
+	const struct rrr_socket_holder *holder = __rrr_socket_shard_get(shard, fd);
+
+	if (holder != NULL) {
+		ret = callback(holder->filename_unlink != NULL ? holder->filename_unlink : holder->filename_no_unlink, callback_arg);
+	}
 
-	return 1;
+	__rrr_socket_shard_unlock(shard);
+
+	return ret;
 }
 		
 int rrr_socket_get_filename_from_fd (
 		char **result,
 		int fd
 ) {
-	*result = NULL;
+	int ret = 0;
 
-	pthread_mutex_lock(&socket_lock);
+	*result = NULL;
 
-	int ret = 0;
+	struct rrr_socket_shard *shard = __rrr_socket_shard_lock(fd);
+	const struct rrr_socket_holder *holder = __rrr_socket_shard_get(shard, fd);
 
-	RRR_LL_ITERATE_BEGIN(&socket_list, struct rrr_socket_holder);
-		if (node->options.fd == fd) {
-			const char *filename = (node->filename_unlink ? node->filename_unlink : node->filename_no_unlink);
-			if (filename != NULL && *(filename) != '\0') {
-				char *filename_new = rrr_strdup(filename);
-				if (filename_new == NULL) {
-					RRR_MSG_0("Could not allocate memory in rrr_socket_get_filename_from_fd\n");
-					ret = 1;
-					goto out;
-				}
-				*result = filename_new;
+	if (holder != NULL) {
+		const char *filename = (holder->filename_unlink ? holder->filename_unlink : holder->filename_no_unlink);
+		if (filename != NULL && *(filename) != '\0') {
+			char *filename_new = rrr_strdup(filename);
+			if (filename_new == NULL) {
+				RRR_MSG_0("Could not allocate memory in rrr_socket_get_filename_from_fd\n");
+				ret = 1;
+				goto out;
 			}
-			ret = 0;
-			goto out;
+			*result = filename_new;
 		}
-	RRR_LL_ITERATE_END();
+	}
 
 	out:
-	pthread_mutex_unlock(&socket_lock);
+	__rrr_socket_shard_unlock(shard);
 	return ret;
 }
 		
 int rrr_socket_get_fd_from_filename (
 		const char *filename
 ) {
-	pthread_mutex_lock(&socket_lock);
-
 	int ret = -1;
 
-	RRR_LL_ITERATE_BEGIN(&socket_list, struct rrr_socket_holder);
-		const char *filename_node = (node->filename_unlink ? node->filename_unlink : node->filename_no_unlink);
-		if (filename_node != NULL && strcmp(filename, filename_node) == 0) {
-			ret = node->options.fd;
-			goto out;
+	for (size_t i = 0; i < RRR_SOCKET_SHARD_COUNT && ret < 0; i++) {
+		// fd number i maps to shard number i
+		struct rrr_socket_shard *shard = __rrr_socket_shard_lock((int) i);
+
+		for (size_t j = 0; j < shard->holders_size; j++) {
+			const struct rrr_socket_holder *holder = shard->holders[j];
+			if (holder == NULL) {
+				continue;
+			}
+			const char *filename_node = (holder->filename_unlink ? holder->filename_unlink : holder->filename_no_unlink);
+			if (filename_node != NULL && strcmp(filename, filename_node) == 0) {
+				ret = holder->options.fd;
+				break;
+			}
 		}
-	RRR_LL_ITERATE_END();
 
-	out:
-	pthread_mutex_unlock(&socket_lock);
+		__rrr_socket_shard_unlock(shard);
+	}
+
 	return ret;
 }
 
@@ -325,21 +540,19 @@ int rrr_socket_get_options_from_fd (
 		struct rrr_socket_options *target,
 		int fd
 ) {
-	memset (target, '\0', sizeof(*target));
-
 	int ret = 1;
 
-	pthread_mutex_lock(&socket_lock);
+	memset (target, '\0', sizeof(*target));
 
-	RRR_LL_ITERATE_BEGIN(&socket_list, struct rrr_socket_holder);
-		if (node->options.fd == fd) {
-			*target = node->options;
-			ret = 0;
-			RRR_LL_ITERATE_LAST();
-		}
-	RRR_LL_ITERATE_END();
+	struct rrr_socket_shard *shard = __rrr_socket_shard_lock(fd);
+	const struct rrr_socket_holder *holder = __rrr_socket_shard_get(shard, fd);
 
-	pthread_mutex_unlock(&socket_lock);
+	if (holder != NULL) {
+		*target = holder->options;
+		ret = 0;
+	}
+
+	__rrr_socket_shard_unlock(shard);
 
 	return ret;
 }
@@ -351,29 +564,28 @@ void *rrr_socket_get_private_data_from_fd (
 ) {
 	void *result = NULL;
 
-	pthread_mutex_lock(&socket_lock);
-
-	RRR_LL_ITERATE_BEGIN(&socket_list, struct rrr_socket_holder);
-		if (node->options.fd == fd) {
-			struct rrr_socket_holder *socket_holder = node;
-			RRR_LL_ITERATE_BEGIN(&socket_holder->private_data, struct rrr_socket_private_data);
-				if (node->class == class) {
-					result = node->data;
-					goto out;
-				}
-			RRR_LL_ITERATE_END();
+	struct rrr_socket_shard *shard = __rrr_socket_shard_lock(fd);
+	struct rrr_socket_holder *holder = __rrr_socket_shard_get(shard, fd);
 
-			if (__rrr_socket_private_data_collection_allocate_and_push(&socket_holder->private_data, class, size) != 0) {
-				goto out;
-			}
-			result = RRR_LL_LAST(&socket_holder->private_data);
+	if (holder == NULL) {
+		goto out;
+	}
 
+	RRR_LL_ITERATE_BEGIN(&holder->private_data, struct rrr_socket_private_data);
+		if (node->class == class) {
+			result = node->data;
 			goto out;
 		}
 	RRR_LL_ITERATE_END();
 
+	if (__rrr_socket_private_data_collection_allocate_and_push(&holder->private_data, class, size) != 0) {
+		goto out;
+	}
+
+	result = RRR_LL_LAST(&holder->private_data)->data;
+
 	out:
-	pthread_mutex_unlock(&socket_lock);
+	__rrr_socket_shard_unlock(shard);
 	return result;
 }
 
@@ -382,50 +594,9 @@ int rrr_socket_with_lock_do (
 		void *arg
 ) {
 	int ret = 0;
-	pthread_mutex_lock(&socket_lock);
+	__rrr_socket_shard_lock_all();
 	ret = callback(arg);
-	pthread_mutex_unlock(&socket_lock);
-	return ret;
-}
-
-static void __rrr_socket_dump_unlocked (void) {
-	RRR_DBG_7("There are now %i sockets\n", RRR_LL_COUNT(&socket_list));
-/*	Noisy
-	RRR_LL_ITERATE_BEGIN(&socket_list,struct rrr_socket_holder);
-		const char *filename = (node->filename_unlink ? node->filename_unlink : node->filename_no_unlink);
-		RRR_DBG_7 ("fd %i pid %i creator %s filename %s%s\n", node->options.fd, getpid(), node->creator, filename, node->filename_unlink ? " (listen)" : "");
-	RRR_LL_ITERATE_END();
-	RRR_DBG_7("---\n");*/
-}
-
-static int __rrr_socket_add_unlocked (
-		int fd,
-		int domain,
-		int type,
-		int protocol,
-		const char *creator,
-		const char *filename,
-		int filename_unlink
-) {
-	int ret = 0;
-	struct rrr_socket_holder *holder = NULL;
-
-	if (__rrr_socket_holder_new(&holder, creator, filename, filename_unlink, fd, domain, type, protocol) != 0) {
-		RRR_MSG_0("Could not create socket holder in __rrr_socket_add_unlocked\n");
-		ret = 1;
-		goto out;
-	}
-
-	RRR_LL_UNSHIFT(&socket_list,holder);
-	holder = NULL;
-
-	if (RRR_DEBUGLEVEL_7) {
-		RRR_DBG_7("rrr_socket add fd %i pid %i, sockets are now:\n", fd, getpid());
-		__rrr_socket_dump_unlocked();
-	}
-
-	out:
-	RRR_FREE_IF_NOT_NULL(holder);
+	__rrr_socket_shard_unlock_all();
 	return ret;
 }
 
@@ -445,17 +616,14 @@ int rrr_socket_accept (
 		goto out;
 	}
 
-	pthread_mutex_lock(&socket_lock);
-
 	socklen_t addr_len_orig = *addr_len;
 	fd_out = accept(fd_in, (struct sockaddr *) addr, addr_len);
 	if (fd_out != -1) {
-		__rrr_socket_add_unlocked(fd_out, options.domain, options.type, options.protocol, creator, NULL, 0);
+		__rrr_socket_add(fd_out, options.domain, options.type, options.protocol, creator, NULL, 0);
 	}
 	if (*addr_len > addr_len_orig) {
 		RRR_BUG("BUG: Given addr_len was to short in rrr_socket_accept\n");
 	}
-	pthread_mutex_unlock(&socket_lock);
 
 	if (fd_out != -1 && (options.type & SOCK_NONBLOCK) == SOCK_NONBLOCK) {
 		int flags = fcntl(fd_out, F_GETFL, 0);
@@ -483,12 +651,10 @@ int rrr_socket_mkstemp (
 ) {
 	int fd = 0;
 
-	pthread_mutex_lock(&socket_lock);
 	fd = mkstemp(filename);
 	if (fd != -1) {
-		__rrr_socket_add_unlocked(fd, 0, 0, 0, creator, filename, 1);
+		__rrr_socket_add(fd, 0, 0, 0, creator, filename, 1);
 	}
-	pthread_mutex_unlock(&socket_lock);
 
 	return fd;
 }
@@ -518,7 +684,7 @@ int rrr_socket_bind_and_listen (
 	return 0;
 }
 
-static int __rrr_socket_open_nolock (
+int rrr_socket_open (
 		const char *filename,
 		int flags,
 		int mode,
@@ -529,7 +695,7 @@ static int __rrr_socket_open_nolock (
 	fd = open(filename, flags, mode);
 
 	if (fd != -1) {
-		__rrr_socket_add_unlocked(fd, 0, 0, 0, creator, filename, register_for_unlink);
+		__rrr_socket_add(fd, 0, 0, 0, creator, filename, register_for_unlink);
 	}
 
 	RRR_DBG_7("rrr_socket_open fd %i pid %i filename %s creator %s flags %i\n", fd, getpid(), filename, creator, flags);
@@ -537,20 +703,6 @@ static int __rrr_socket_open_nolock (
 	return fd;
 }
 
-int rrr_socket_open (
-		const char *filename,
-		int flags,
-		int mode,
-		const char *creator,
-		int register_for_unlink
-) {
-	int fd = 0;
-	pthread_mutex_lock(&socket_lock);
-	fd = __rrr_socket_open_nolock(filename, flags, mode, creator, register_for_unlink);
-	pthread_mutex_unlock(&socket_lock);
-	return fd;
-}
-
 int rrr_socket_open_and_read_file_head (
 		char **result,
 		rrr_biglength *result_bytes,
@@ -660,9 +812,7 @@ int rrr_socket_eventfd (
 	}
 
 	if (fd != -1) {
-		pthread_mutex_lock(&socket_lock);
-		__rrr_socket_add_unlocked(fd, 0, 0, 0, creator, NULL, 0);
-		pthread_mutex_unlock(&socket_lock);
+		__rrr_socket_add(fd, 0, 0, 0, creator, NULL, 0);
 	}
 
 	RRR_DBG_7("rrr_socket_eventfd fd %i pid %i\n", fd, getpid());
@@ -671,6 +821,26 @@ int rrr_socket_eventfd (
 }
 #endif /* RRR_HAVE_EVENTFD */
 
+#ifdef RRR_HAVE_INOTIFY
+int rrr_socket_inotify (
+		const char *creator
+) {
+	int fd = 0;
+
+	if ((fd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC)) < 0) {
+		RRR_MSG_0("Failed to create inotify fd in rrr_socket_inotify: %s\n", rrr_strerror(errno));
+	}
+
+	if (fd != -1) {
+		__rrr_socket_add(fd, 0, 0, 0, creator, NULL, 0);
+	}
+
+	RRR_DBG_7("rrr_socket_inotify fd %i pid %i\n", fd, getpid());
+
+	return fd;
+}
+#endif /* RRR_HAVE_INOTIFY */
+
 int rrr_socket_pipe (
 		int result[2],
 		const char *creator
@@ -693,10 +863,8 @@ int rrr_socket_pipe (
 		}
 	}
 
-	pthread_mutex_lock(&socket_lock);
-	ret |= __rrr_socket_add_unlocked(fds[0], 0, 0, 0, creator, NULL, 0);
-	ret |= __rrr_socket_add_unlocked(fds[1], 0, 0, 0, creator, NULL, 0);
-	pthread_mutex_unlock(&socket_lock);
+	ret |= __rrr_socket_add(fds[0], 0, 0, 0, creator, NULL, 0);
+	ret |= __rrr_socket_add(fds[1], 0, 0, 0, creator, NULL, 0);
 
 	RRR_DBG_7("rrr_socket_pipe fd %i<-%i pid %i\n", fds[0], fds[1], getpid());
 
@@ -729,16 +897,14 @@ int rrr_socket (
 		int register_for_unlink
 ) {
 	int fd = 0;
-	pthread_mutex_lock(&socket_lock);
 	fd = socket(domain, type, protocol);
 
 	if (fd != -1) {
-		__rrr_socket_add_unlocked(fd, domain, type, protocol, creator, filename, register_for_unlink);
+		__rrr_socket_add(fd, domain, type, protocol, creator, filename, register_for_unlink);
 	}
 
 	RRR_DBG_7("rrr_socket fd %i pid %i filename %s\n", fd, getpid(), filename);
 
-	pthread_mutex_unlock(&socket_lock);
 	return fd;
 }
 
@@ -749,19 +915,17 @@ static int __rrr_socket_close (int fd, int ignore_unregistered, int no_unlink) {
 
 	RRR_DBG_7("rrr_socket_close fd %i pid %i no unlink %i\n", fd, getpid(), no_unlink);
 
-	pthread_mutex_lock(&socket_lock);
-
 	int did_destroy = 0;
 
-	RRR_LL_ITERATE_BEGIN(&socket_list,struct rrr_socket_holder);
-		if (node->options.fd == fd) {
-			RRR_LL_ITERATE_SET_DESTROY();
-			RRR_LL_ITERATE_LAST();
-			did_destroy = 1;
-		}
-	RRR_LL_ITERATE_END_CHECK_DESTROY(&socket_list,__rrr_socket_holder_close_and_destroy(node, no_unlink));
+	struct rrr_socket_shard *shard = __rrr_socket_shard_lock(fd);
+	struct rrr_socket_holder *holder = __rrr_socket_shard_get(shard, fd);
+
+	if (holder != NULL) {
+		__rrr_socket_shard_remove_and_close(shard, holder, no_unlink);
+		did_destroy = 1;
+	}
 
-	pthread_mutex_unlock(&socket_lock);
+	__rrr_socket_shard_unlock(shard);
 
 	if (did_destroy != 1 && ignore_unregistered == 0) {
 		// NOTE ! If this warning appears, program must be fixed. In a possible race
@@ -791,73 +955,68 @@ int rrr_socket_close_ignore_unregistered (int fd) {
 	return __rrr_socket_close (fd, 1, 0);
 }
 
-int __rrr_socket_close_all_except_array (int *fds, size_t fd_count, int no_unlink) {
+static int __rrr_socket_close_all_except_cb (int no_unlink, int (*except_cb)(int fd, void *arg), void *arg) {
 	int ret = 0;
 
 	RRR_DBG_7("%s pid %i no_unlink %i\n", __func__, getpid(), no_unlink);
 
 	int count = 0;
 
-	pthread_mutex_lock(&socket_lock);
+	__rrr_socket_shard_lock_all();
 
-	RRR_LL_ITERATE_BEGIN(&socket_list,struct rrr_socket_holder);
-		int match = 0;
-		for (size_t i = 0; i < fd_count; i++) {
-			if (node->options.fd == fds[i]) {
-				match = 1;
-				break;
+	for (size_t i = 0; i < RRR_SOCKET_SHARD_COUNT; i++) {
+		struct rrr_socket_shard *shard = &socket_shards[i];
+		for (size_t j = 0; j < shard->holders_size && shard->count > 0; j++) {
+			struct rrr_socket_holder *holder = shard->holders[j];
+			if (holder == NULL) {
+				continue;
+			}
+			if (except_cb(holder->options.fd, arg)) {
+				RRR_DBG_7("- Not closing %i as instructed by except callback\n", holder->options.fd);
+			}
+			else {
+				RRR_DBG_7("- Closing %i\n", holder->options.fd);
+				__rrr_socket_shard_remove_and_close(shard, holder, no_unlink);
+				count++;
 			}
 		}
-		if (match) {
-			RRR_DBG_7("- Not closing %i, was in except list\n", node->options.fd);
-		}
-		else {
-			RRR_DBG_7("- Closing %i\n", node->options.fd);
-			RRR_LL_ITERATE_SET_DESTROY();
-			count++;
-		}
-	RRR_LL_ITERATE_END_CHECK_DESTROY(&socket_list,__rrr_socket_holder_close_and_destroy(node, no_unlink));
+	}
 
 	if (RRR_DEBUGLEVEL_7) {
 		__rrr_socket_dump_unlocked();
 	}
 
-	pthread_mutex_unlock(&socket_lock);
+	__rrr_socket_shard_unlock_all();
 
 	RRR_DBG_1("Closed %i sockets pid %i\n", count, getpid());
 
 	return ret;
 }
 
-static int __rrr_socket_close_all_except_cb (int no_unlink, int (*except_cb)(int fd, void *arg), void *arg) {
-	int ret = 0;
-
-	RRR_DBG_7("%s pid %i no_unlink %i\n", __func__, getpid(), no_unlink);
-
-	int count = 0;
+struct rrr_socket_close_all_except_array_callback_data {
+	const int *fds;
+	size_t fd_count;
+};
 
-	pthread_mutex_lock(&socket_lock);
+static int __rrr_socket_close_all_except_array_callback (int fd, void *arg) {
+	struct rrr_socket_close_all_except_array_callback_data *callback_data = arg;
 
-	RRR_LL_ITERATE_BEGIN(&socket_list,struct rrr_socket_holder);
-		if (except_cb(node->options.fd, arg)) {
-			RRR_DBG_7("- Not closing %i as instructed by except callback\n", node->options.fd);
-		}
-		else {
-			RRR_DBG_7("- Closing %i\n", node->options.fd);
-			RRR_LL_ITERATE_SET_DESTROY();
-			count++;
+	for (size_t i = 0; i < callback_data->fd_count; i++) {
+		if (callback_data->fds[i] == fd) {
+			return 1;
 		}
-	RRR_LL_ITERATE_END_CHECK_DESTROY(&socket_list,__rrr_socket_holder_close_and_destroy(node, no_unlink));
-
-	if (RRR_DEBUGLEVEL_7) {
-		__rrr_socket_dump_unlocked();
 	}
 
-	pthread_mutex_unlock(&socket_lock);
+	return 0;
+}
 
-	RRR_DBG_1("Closed %i sockets pid %i\n", count, getpid());
+static int __rrr_socket_close_all_except_array (int *fds, size_t fd_count, int no_unlink) {
+	struct rrr_socket_close_all_except_array_callback_data callback_data = {
+		fds,
+		fd_count
+	};
 
-	return ret;
+	return __rrr_socket_close_all_except_cb(no_unlink, __rrr_socket_close_all_except_array_callback, &callback_data);
 }
 
 static int __rrr_socket_close_all_except (int fd, int no_unlink) {
@@ -910,8 +1069,6 @@ int rrr_socket_fifo_create (
 
 	int fd = 0;
 
-	pthread_mutex_lock(&socket_lock);
-
 	if (unlink_if_exists) {
 		if (unlink(filename) != 0) {
 			if (errno != ENOENT) {
@@ -933,7 +1090,7 @@ int rrr_socket_fifo_create (
 	int retry_limit = 100;
 
 	retry:
-	fd = __rrr_socket_open_nolock (
+	fd = rrr_socket_open (
 			filename,
 			(do_write_mode ? O_WRONLY : O_RDONLY) | (do_nonblock ? O_NONBLOCK : 0),
 			0,
@@ -964,8 +1121,7 @@ int rrr_socket_fifo_create (
 					filename, rrr_strerror(errno));
 		}
 	out:
-		pthread_mutex_unlock(&socket_lock);
-	return ret;
+		return ret;
 }
 
 struct rrr_socket_bind_and_listen_umask_callback_data {
@@ -1392,6 +1548,65 @@ int rrr_socket_sendto_nonblock_with_options (
 	return ret;
 }
 
+int rrr_socket_sendv_nonblock_check_retry (
+		rrr_biglength *written_bytes,
+		const struct rrr_socket_options *options,
+		const struct iovec *iov,
+		int iov_count,
+		int silent
+) {
+	int ret = RRR_SOCKET_OK;
+
+	// Unlike the non-vectored functions, no retries are made upon partial
+	// writes. The caller is expected to retry at next write event.
+
+	*written_bytes = 0;
+
+	struct msghdr msg = {0};
+	msg.msg_iov = (struct iovec *) iov;
+	msg.msg_iovlen = (size_t) iov_count;
+
+	ssize_t done_bytes;
+
+	retry:
+	if (options->domain != 0) {
+		done_bytes = sendmsg(options->fd, &msg, (options->type & SOCK_NONBLOCK) == SOCK_NONBLOCK ? MSG_DONTWAIT : 0);
+	}
+	else {
+		done_bytes = writev(options->fd, iov, iov_count);
+	}
+
+	if (done_bytes < 0) {
+		if (errno == EINTR) {
+			goto retry;
+		}
+		else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			ret = RRR_SOCKET_WRITE_INCOMPLETE;
+		}
+		else if (errno == EPIPE || errno == ECONNREFUSED || errno == ECONNRESET) {
+			if (!silent)
+				RRR_DBG_7 ("fd %i connection closed or refused during vectored send\n", options->fd);
+			ret = RRR_SOCKET_SOFT_ERROR;
+		}
+		else {
+			if (!silent)
+				RRR_MSG_0("fd %i error from vectored send with %i buffers: %s\n",
+					options->fd, iov_count, rrr_strerror(errno));
+			ret = RRR_SOCKET_HARD_ERROR;
+		}
+		goto out;
+	}
+
+	if (!silent)
+		RRR_DBG_7("fd %i vectored send of %i buffers wrote %lli bytes\n",
+			options->fd, iov_count, (long long int) done_bytes);
+
+	*written_bytes = (rrr_biglength) done_bytes;
+
+	out:
+	return ret;
+}
+
 int rrr_socket_sendto_nonblock (
 		int *err,
 		rrr_biglength *written_bytes,
@@ -1624,8 +1839,5 @@ int rrr_socket_recvmsg (
 }
 
 int rrr_socket_is_locked(void) {
-	if (pthread_mutex_trylock(&socket_lock) != 0)
-		return 1;
-	pthread_mutex_unlock(&socket_lock);
-	return 0;
+	return socket_lock_depth > 0;
 }
@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <unistd.h>
 #include <inttypes.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <stdint.h>
 
 #include "rrr_socket_read.h"
@@ -46,6 +47,9 @@ struct rrr_socket_options {
 	int domain;
 	int type;
 	int protocol;
+
+	// Decided once when the fd is registered
+	int sendv_possible;
 };
 
 void rrr_socket_unlink (
@@ -133,6 +137,11 @@ int rrr_socket_eventfd (
 		const char *creator
 );
 #endif
+#ifdef RRR_HAVE_INOTIFY
+int rrr_socket_inotify (
+		const char *creator
+);
+#endif
 int rrr_socket_pipe (
 		int result[2],
 		const char *creator
@@ -202,6 +211,13 @@ int rrr_socket_sendto_nonblock_with_options (
 		socklen_t addr_len,
 		int silent
 );
+int rrr_socket_sendv_nonblock_check_retry (
+		rrr_biglength *written_bytes,
+		const struct rrr_socket_options *options,
+		const struct iovec *iov,
+		int iov_count,
+		int silent
+);
 int rrr_socket_sendto_nonblock (
 		int *err,
 		rrr_biglength *written_bytes,
@@ -259,6 +275,7 @@ int rrr_socket_recvmsg (
 		struct rrr_socket_datagram *datagram,
 		int fd
 );
+// Returns true if the calling thread holds a lock in the socket framework
 int rrr_socket_is_locked(void);
 
 #endif /* RRR_SOCKET_H */
@@ -665,6 +665,13 @@ static int __rrr_socket_client_collection_read_raw_complete_callback (
 
 	DEDUCT_ADDRESS();
 
+	// Peers may pipeline data, make sure any data already read
+	// past the current target is processed without waiting for
+	// more data to arrive on the socket.
+	if (read_session->rx_overshoot_size && client->connected_fd != NULL) {
+		__rrr_socket_client_fd_notify_read (client, client->connected_fd->fd);
+	}
+
 	return collection->complete_callback (
 			read_session,
 			addr,
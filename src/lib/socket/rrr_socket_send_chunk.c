@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/uio.h>
 
 #include "../log.h"
 #include "../allocator.h"
@@ -31,6 +32,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../util/macro_utils.h"
 #include "../util/posix.h"
 
+// Maximum number of chunks to write with a single vectored send
+#define RRR_SOCKET_SEND_CHUNK_IOV_MAX 64
+
 struct rrr_socket_send_chunk {
 	RRR_LL_NODE(struct rrr_socket_send_chunk);
 	void *data;
@@ -40,6 +44,9 @@ struct rrr_socket_send_chunk {
 	socklen_t addr_len;
 	void *private_data;
 	void (*private_data_destroy)(void *private_data);
+	// Set for chunks which refer to data owned by someone else
+	void *shared_owner;
+	void (*shared_owner_decref)(void *shared_owner);
 };
 
 static void __rrr_socket_send_chunk_destroy (
@@ -48,7 +55,12 @@ static void __rrr_socket_send_chunk_destroy (
 	if (chunk->private_data) {
 		chunk->private_data_destroy(chunk->private_data);
 	}
-	RRR_FREE_IF_NOT_NULL(chunk->data);
+	if (chunk->shared_owner_decref) {
+		chunk->shared_owner_decref(chunk->shared_owner);
+	}
+	else {
+		RRR_FREE_IF_NOT_NULL(chunk->data);
+	}
 	rrr_free(chunk);
 }
 
@@ -231,6 +243,47 @@ static int __rrr_socket_send_chunk_collection_push_const (
 	return ret;
 }
 
+int rrr_socket_send_chunk_collection_push_shared (
+		rrr_length *send_chunk_count,
+		struct rrr_socket_send_chunk_collection *chunks,
+		const void *data,
+		rrr_biglength data_size,
+		enum rrr_socket_send_chunk_priority priority,
+		void (*shared_owner_incref)(void *shared_owner),
+		void (*shared_owner_decref)(void *shared_owner),
+		void *shared_owner
+) {
+	int ret = 0;
+
+	// The data is not copied, a reference to the owner is held
+	// until the chunk has been sent or the collection is cleared.
+	void *data_shared = (void *) data;
+
+	if ((ret = __rrr_socket_send_chunk_collection_push (
+			send_chunk_count,
+			chunks,
+			NULL,
+			0,
+			&data_shared,
+			data_size,
+			priority,
+			NULL,
+			NULL,
+			NULL
+	)) != 0) {
+		goto out;
+	}
+
+	struct rrr_socket_send_chunk *chunk = RRR_LL_LAST(&chunks->chunk_lists[priority]);
+
+	shared_owner_incref(shared_owner);
+	chunk->shared_owner = shared_owner;
+	chunk->shared_owner_decref = shared_owner_decref;
+
+	out:
+	return ret;
+}
+
 int rrr_socket_send_chunk_collection_push_const (
 		rrr_length *send_chunk_count,
 		struct rrr_socket_send_chunk_collection *chunks,
@@ -302,6 +355,128 @@ int rrr_socket_send_chunk_collection_push_const_with_address_and_private_data (
 	);
 }
 
+static int __rrr_socket_send_chunk_collection_iov_fill (
+		struct iovec *iov,
+		rrr_biglength *iov_size,
+		struct rrr_socket_send_chunk_collection *chunks
+) {
+	int iov_count = 0;
+
+	*iov_size = 0;
+
+	RRR_SOCKET_SEND_CHUNK_LISTS_ITERATE_BEGIN();
+		RRR_LL_ITERATE_BEGIN(list, struct rrr_socket_send_chunk);
+			if (iov_count == RRR_SOCKET_SEND_CHUNK_IOV_MAX) {
+				RRR_LL_ITERATE_BREAK();
+			}
+
+			const rrr_biglength remaining = node->data_size - node->data_pos;
+
+			iov[iov_count].iov_base = node->data + node->data_pos;
+			iov[iov_count].iov_len = rrr_size_from_biglength_bug_const(remaining);
+			iov_count++;
+
+			*iov_size += remaining;
+		RRR_LL_ITERATE_END();
+	RRR_SOCKET_SEND_CHUNK_LISTS_ITERATE_END();
+
+	return iov_count;
+}
+
+static void __rrr_socket_send_chunk_collection_consume (
+		struct rrr_socket_send_chunk_collection *chunks,
+		rrr_biglength written_bytes,
+		const struct rrr_socket_send_chunk_send_callbacks *callbacks
+) {
+	RRR_SOCKET_SEND_CHUNK_LISTS_ITERATE_BEGIN();
+		RRR_LL_ITERATE_BEGIN(list, struct rrr_socket_send_chunk);
+			const rrr_biglength remaining = node->data_size - node->data_pos;
+
+			if (written_bytes < remaining) {
+				node->data_pos += written_bytes;
+				written_bytes = 0;
+				RRR_LL_ITERATE_BREAK();
+			}
+
+			written_bytes -= remaining;
+			node->data_pos = node->data_size;
+
+			if (callbacks->success)
+				callbacks->success(node->data, node->data_size, node->data_pos, node->private_data, callbacks->success_arg);
+
+			RRR_LL_ITERATE_SET_DESTROY(); // Chunk complete
+		RRR_LL_ITERATE_END_CHECK_DESTROY(list, 0; __rrr_socket_send_chunk_destroy(node));
+	RRR_SOCKET_SEND_CHUNK_LISTS_ITERATE_END();
+}
+
+// Write as many chunks as possible per system call
+static int __rrr_socket_send_chunk_collection_sendv (
+		struct rrr_socket_send_chunk_collection *chunks,
+		int (*callback)(RRR_SOCKET_SEND_CHUNK_SENDV_CALLBACK_ARGS),
+		void *callback_arg,
+		const struct rrr_socket_send_chunk_send_callbacks *callbacks
+) {
+	int ret = 0;
+
+	struct iovec iov[RRR_SOCKET_SEND_CHUNK_IOV_MAX];
+	rrr_biglength iov_size;
+	rrr_biglength written_bytes;
+	int iov_count;
+
+	while ((iov_count = __rrr_socket_send_chunk_collection_iov_fill(iov, &iov_size, chunks)) > 0) {
+		if (!chunks->silent)
+			RRR_DBG_7("Chunk vectored send %i chunks total size %" PRIrrrbl "\n",
+				iov_count, iov_size);
+
+		written_bytes = 0;
+
+		if ((ret = callback (
+				&written_bytes,
+				iov,
+				iov_count,
+				callback_arg
+		)) != 0) {
+			if (ret == RRR_SOCKET_WRITE_INCOMPLETE) {
+				__rrr_socket_send_chunk_collection_consume(chunks, written_bytes, callbacks);
+			}
+			goto out;
+		}
+
+		if (written_bytes > iov_size) {
+			RRR_BUG("BUG: Too many bytes written in %s\n", __func__);
+		}
+
+		__rrr_socket_send_chunk_collection_consume(chunks, written_bytes, callbacks);
+
+		if (written_bytes < iov_size) {
+			ret = RRR_SOCKET_WRITE_INCOMPLETE;
+			goto out;
+		}
+	}
+
+	out:
+	return ret;
+}
+
+struct rrr_socket_send_chunk_sendv_fd_callback_data {
+	const struct rrr_socket_options *options;
+	int silent;
+};
+
+static int __rrr_socket_send_chunk_sendv_fd_callback (
+		RRR_SOCKET_SEND_CHUNK_SENDV_CALLBACK_ARGS
+) {
+	struct rrr_socket_send_chunk_sendv_fd_callback_data *callback_data = arg;
+
+	return rrr_socket_sendv_nonblock_check_retry (
+			written_bytes,
+			callback_data->options,
+			iov,
+			iov_count,
+			callback_data->silent
+	);
+}
+
 static int __rrr_socket_send_chunk_collection_send (
 		struct rrr_socket_send_chunk_collection *chunks,
 		int fd,
@@ -309,9 +484,25 @@ static int __rrr_socket_send_chunk_collection_send (
 ) {
 	int ret = 0;
 
+	struct rrr_socket_options options;
+
 	if (callbacks->send_start)
 		callbacks->send_start(callbacks->start_end_arg);
 
+	if (rrr_socket_get_options_from_fd(&options, fd) == 0 && options.sendv_possible) {
+		struct rrr_socket_send_chunk_sendv_fd_callback_data callback_data = {
+			&options,
+			chunks->silent
+		};
+		ret = __rrr_socket_send_chunk_collection_sendv (
+				chunks,
+				__rrr_socket_send_chunk_sendv_fd_callback,
+				&callback_data,
+				callbacks
+		);
+		goto out;
+	}
+
 	RRR_SOCKET_SEND_CHUNK_LISTS_ITERATE_BEGIN();
 		RRR_LL_ITERATE_BEGIN(list, struct rrr_socket_send_chunk);
 			if (!chunks->silent)
@@ -414,6 +605,20 @@ int rrr_socket_send_chunk_collection_send_with_callback (
 	return ret;
 }
 
+int rrr_socket_send_chunk_collection_sendv_with_callback (
+		struct rrr_socket_send_chunk_collection *chunks,
+		int (*callback)(RRR_SOCKET_SEND_CHUNK_SENDV_CALLBACK_ARGS),
+		void *callback_arg
+) {
+	struct rrr_socket_send_chunk_send_callbacks callbacks = {0};
+	return __rrr_socket_send_chunk_collection_sendv (
+			chunks,
+			callback,
+			callback_arg,
+			&callbacks
+	) &~ RRR_SOCKET_WRITE_INCOMPLETE;
+}
+
 void rrr_socket_send_chunk_collection_iterate (
 		struct rrr_socket_send_chunk_collection *chunks,
 		void (*callback)(int *do_remove, const void *data, rrr_biglength data_size, rrr_biglength data_pos, void *chunk_private_data, void *arg),
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_SOCKET_SEND_CHUNK_H
 
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "../rrr_types.h"
 #include "../util/linked_list.h"
@@ -38,6 +39,8 @@ enum rrr_socket_send_chunk_priority {
     const void *data, rrr_biglength data_size, rrr_biglength data_pos, void *chunk_private_data, void *arg
 #define RRR_SOCKET_SEND_CHUNK_START_END_CALLBACK_ARGS \
     void *arg
+#define RRR_SOCKET_SEND_CHUNK_SENDV_CALLBACK_ARGS \
+    rrr_biglength *written_bytes, const struct iovec *iov, int iov_count, void *arg
 
 // TODO : Create define for other callback args
 
@@ -89,6 +92,16 @@ int rrr_socket_send_chunk_collection_push_with_private_data (
 		void *private_data_arg,
 		void (*private_data_destroy)(void *private_data)
 );
+int rrr_socket_send_chunk_collection_push_shared (
+		rrr_length *send_chunk_count,
+		struct rrr_socket_send_chunk_collection *chunks,
+		const void *data,
+		rrr_biglength data_size,
+		enum rrr_socket_send_chunk_priority priority,
+		void (*shared_owner_incref)(void *shared_owner),
+		void (*shared_owner_decref)(void *shared_owner),
+		void *shared_owner
+);
 int rrr_socket_send_chunk_collection_push_const (
 		rrr_length *send_chunk_count,
 		struct rrr_socket_send_chunk_collection *chunks,
@@ -132,6 +145,11 @@ int rrr_socket_send_chunk_collection_send_with_callback (
 		int (*callback)(rrr_biglength *written_bytes, const struct sockaddr *addr, socklen_t addr_len, const void *data, rrr_biglength data_size, void *arg),
 		void *callback_arg
 );
+int rrr_socket_send_chunk_collection_sendv_with_callback (
+		struct rrr_socket_send_chunk_collection *chunks,
+		int (*callback)(RRR_SOCKET_SEND_CHUNK_SENDV_CALLBACK_ARGS),
+		void *callback_arg
+);
 void rrr_socket_send_chunk_collection_iterate (
 		struct rrr_socket_send_chunk_collection *chunks,
 		void (*callback)(int *do_remove, const void *data, rrr_biglength data_size, rrr_biglength data_pos, void *chunk_private_data, void *arg),
@@ -486,6 +486,7 @@ int rrr_stats_engine_init (
 ) {
 	int ret = 0;
 	char *filename = NULL;
+	char *filename_shm = NULL;
 
 	memset (stats, '\0', sizeof(*stats));
 
@@ -498,16 +499,28 @@ int rrr_stats_engine_init (
 
 	unlink(filename); // OK to ignore errors
 
+	if (rrr_asprintf(&filename_shm, "%s/" RRR_STATS_SHM_PREFIX ".%i", rrr_config_global.run_directory, pid) <= 0) {
+		RRR_MSG_0("Could not generate filename for statistics metrics file\n");
+		ret = 1;
+		goto out_final;
+	}
+
 	if (rrr_posix_mutex_init(&stats->main_lock, 0) != 0) {
 		RRR_MSG_0("Could not initialize main mutex in %s\n", __func__);
 		ret = 1;
 		goto out_final;
 	}
 
+	if (rrr_stats_shm_create(&stats->shm, filename_shm) != 0) {
+		RRR_MSG_0("Could not create metrics file for statistics engine with filename '%s'\n", filename_shm);
+		ret = 1;
+		goto out_destroy_main_lock;
+	}
+
 	if (rrr_socket_unix_create_bind_and_listen(&stats->socket, "rrr_stats_engine", filename, 2, 1, 0, 0) != 0) {
 		RRR_MSG_0("Could not create socket for statistics engine with filename '%s'\n", filename);
 		ret = 1;
-		goto out_destroy_main_lock;
+		goto out_destroy_shm;
 	}
 
 	if (rrr_socket_client_collection_new(&stats->client_collection, queue, "rrr_stats_engine") != 0) {
@@ -589,8 +602,8 @@ int rrr_stats_engine_init (
 			"stats engine msg hook data available"
 	);
 
-	RRR_DBG_1("Statistics engine started, listening at %s, log hook handle is %i\n",
-			filename, stats->log_hook_handle);
+	RRR_DBG_1("Statistics engine started, listening at %s, metrics at %s, log hook handle is %i\n",
+			filename, filename_shm, stats->log_hook_handle);
 
 	stats->queue = queue;
 	stats->initialized = 1;
@@ -602,10 +615,14 @@ int rrr_stats_engine_init (
 		rrr_socket_client_collection_destroy(stats->client_collection);
 	out_close_socket:
 		rrr_socket_close(stats->socket);
+	out_destroy_shm:
+		rrr_stats_shm_destroy(stats->shm);
+		stats->shm = NULL;
 	out_destroy_main_lock:
 		pthread_mutex_destroy(&stats->main_lock);
 	out_final:
 		RRR_FREE_IF_NOT_NULL(filename);
+		RRR_FREE_IF_NOT_NULL(filename_shm);
 		return ret;
 }
 
@@ -625,6 +642,8 @@ void rrr_stats_engine_cleanup (
 	__rrr_stats_named_message_list_collection_clear(&stats->named_message_list);
 	__rrr_stats_message_pair_list_clear (&stats->message_pairs);
 	__rrr_stats_log_stream_clear(&stats->log_stream);
+	rrr_stats_shm_destroy(stats->shm);
+	stats->shm = NULL;
 
 	stats->initialized = 0;
 
@@ -830,6 +849,82 @@ void rrr_stats_engine_handle_unregister (
 	pthread_mutex_unlock(&stats->main_lock);
 }
 
+int rrr_stats_engine_shm_slot_obtain (
+		uint32_t *slot,
+		struct rrr_stats_engine *stats,
+		const char *name
+) {
+	int ret = 0;
+
+	*slot = 0;
+
+	if (stats->initialized == 0) {
+		RRR_DBG_1("Note: Could not obtain metrics slot in %s, not initialized\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	pthread_mutex_lock(&stats->main_lock);
+	if ((ret = rrr_stats_shm_slot_obtain(slot, stats->shm, name)) != 0) {
+		RRR_MSG_0("Warning: No free slots in statistics metrics file for %s\n", name);
+	}
+	else {
+		stats->shm_slot_users[*slot]++;
+	}
+	pthread_mutex_unlock(&stats->main_lock);
+
+	out:
+	return ret;
+}
+
+void rrr_stats_engine_shm_slot_release (
+		struct rrr_stats_engine *stats,
+		uint32_t slot
+) {
+	if (stats->initialized == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&stats->main_lock);
+	if (stats->shm_slot_users[slot] == 0) {
+		RRR_BUG("BUG: Metrics slot %" PRIu32 " released without users in %s\n", slot, __func__);
+	}
+	if (--stats->shm_slot_users[slot] == 0) {
+		rrr_stats_shm_slot_release(stats->shm, slot);
+	}
+	pthread_mutex_unlock(&stats->main_lock);
+}
+
+// Slots are updated in place without holding the main lock, the
+// per slot sequence counter serializes writers.
+
+void rrr_stats_engine_shm_value_set (
+		struct rrr_stats_engine *stats,
+		uint32_t slot,
+		enum rrr_stats_shm_value value,
+		uint64_t number
+) {
+	if (stats->initialized == 0) {
+		return;
+	}
+
+	rrr_stats_shm_value_set(stats->shm, slot, value, number);
+}
+
+void rrr_stats_engine_shm_rate_set (
+		struct rrr_stats_engine *stats,
+		uint32_t slot,
+		unsigned int id,
+		const char *name,
+		uint64_t total
+) {
+	if (stats->initialized == 0) {
+		return;
+	}
+
+	rrr_stats_shm_rate_set(stats->shm, slot, id, name, total);
+}
+
 int rrr_stats_engine_post_message (
 		struct rrr_stats_engine *stats,
 		unsigned int handle,
@@ -32,6 +32,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../event/event_collection.h"
 #include "../event/event_collection_struct.h"
 #include "stats_message.h"
+#include "stats_shm.h"
 
 #define RRR_STATS_ENGINE_STICKY_SEND_INTERVAL_MS 1000
 
@@ -84,6 +85,11 @@ struct rrr_stats_engine {
 	struct rrr_stats_named_message_list_collection named_message_list;
 	struct rrr_stats_message_pair_list message_pairs;
 	struct rrr_socket_client_collection *client_collection;
+
+	// Metrics page readable without the socket protocol. Slots are
+	// shared by name, a slot is released when its last user releases it.
+	struct rrr_stats_shm *shm;
+	uint32_t shm_slot_users[RRR_STATS_SHM_SLOTS];
 };
 
 int rrr_stats_engine_init (
@@ -101,6 +107,28 @@ void rrr_stats_engine_handle_unregister (
 		struct rrr_stats_engine *stats,
 		unsigned int handle
 );
+int rrr_stats_engine_shm_slot_obtain (
+		uint32_t *slot,
+		struct rrr_stats_engine *stats,
+		const char *name
+);
+void rrr_stats_engine_shm_slot_release (
+		struct rrr_stats_engine *stats,
+		uint32_t slot
+);
+void rrr_stats_engine_shm_value_set (
+		struct rrr_stats_engine *stats,
+		uint32_t slot,
+		enum rrr_stats_shm_value value,
+		uint64_t number
+);
+void rrr_stats_engine_shm_rate_set (
+		struct rrr_stats_engine *stats,
+		uint32_t slot,
+		unsigned int id,
+		const char *name,
+		uint64_t total
+);
 int rrr_stats_engine_post_message (
 		struct rrr_stats_engine *stats,
 		unsigned int handle,
@@ -128,6 +128,9 @@ int rrr_stats_instance_new (
 		RRR_DBG_1("Could not obtain stats handle in %s, statistics will be disabled. Return was %i.\n", __func__, ret);
 		ret = 0;
 	}
+	else if (rrr_stats_engine_shm_slot_obtain(&instance->shm_slot, engine, name) == 0) {
+		instance->has_shm_slot = 1;
+	}
 
 	instance->engine = engine;
 
@@ -154,6 +157,9 @@ void rrr_stats_instance_destroy (
 	if (instance->stats_handle != 0) {
 		rrr_stats_engine_handle_unregister(instance->engine, instance->stats_handle);
 	}
+	if (instance->has_shm_slot) {
+		rrr_stats_engine_shm_slot_release(instance->engine, instance->shm_slot);
+	}
 	RRR_LL_DESTROY(&instance->rate_counters, struct rrr_stats_instance_rate_counter, __rrr_stats_instance_rate_counter_destroy(node));
 	RRR_FREE_IF_NOT_NULL(instance->name);
 	pthread_mutex_destroy(&instance->lock);
@@ -349,6 +355,18 @@ int rrr_stats_instance_post_double_text (
 	return __rrr_stats_instance_post_text(instance, path_postfix, sticky, RRR_STATS_MESSAGE_TYPE_DOUBLE_TEXT, text);
 }
 
+void rrr_stats_instance_shm_value_set (
+		struct rrr_stats_instance *instance,
+		enum rrr_stats_shm_value value,
+		uint64_t number
+) {
+	if (!instance->has_shm_slot) {
+		return;
+	}
+
+	rrr_stats_engine_shm_value_set(instance->engine, instance->shm_slot, value, number);
+}
+
 int rrr_stats_instance_update_rate (
 		struct rrr_stats_instance *instance,
 		unsigned int id,
@@ -372,6 +390,10 @@ int rrr_stats_instance_update_rate (
 	counter->accumulator += count;
 	counter->accumulator_total += count;
 
+	if (instance->has_shm_slot) {
+		rrr_stats_engine_shm_rate_set(instance->engine, instance->shm_slot, id, name, counter->accumulator_total);
+	}
+
 	uint64_t time_now = rrr_time_get_64();
 	if (time_now - counter->prev_time > RRR_STATS_INSTANCE_RATE_POST_INTERVAL_MS * 1000) {
 		double second = 1 * 1000 * 1000;
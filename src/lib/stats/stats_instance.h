@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "../rrr_types.h"
 #include "../util/linked_list.h"
+#include "stats_shm.h"
 
 #define RRR_STATS_INSTANCE_PATH_PREFIX "instances"
 
@@ -59,6 +60,8 @@ struct rrr_stats_instance {
 	char *name;
 	pthread_mutex_t lock;
 	unsigned int stats_handle;
+	uint32_t shm_slot;
+	int has_shm_slot;
 	struct rrr_stats_engine *engine;
 	struct rrr_stats_instance_rate_counter_collection rate_counters;
 	int (*post_message_hook)(RRR_INSTANCE_MESSAGE_HOOK_ARGUMENTS);
@@ -104,6 +107,11 @@ int rrr_stats_instance_post_unsigned_base10_text (
 int rrr_stats_instance_post_default_stickies (
 		struct rrr_stats_instance *instance
 );
+void rrr_stats_instance_shm_value_set (
+		struct rrr_stats_instance *instance,
+		enum rrr_stats_shm_value value,
+		uint64_t number
+);
 int rrr_stats_instance_update_rate (
 		struct rrr_stats_instance *instance,
 		unsigned int id,
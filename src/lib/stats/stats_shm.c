@@ -0,0 +1,374 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../log.h"
+#include "../allocator.h"
+#include "../rrr_strerror.h"
+#include "../socket/rrr_socket.h"
+#include "../util/rrr_time.h"
+#include "stats_shm.h"
+
+#define RRR_STATS_SHM_READ_RETRIES 1000
+
+static const char *rrr_stats_shm_value_names[] = {
+	"buffer/count",
+	"buffer/written_total",
+	"buffer/deleted_total",
+	"mmap_to_child_count",
+	"mmap_to_child_full_events",
+	"mmap_to_parent_count",
+	"mmap_to_parent_full_events"
+};
+
+static size_t __rrr_stats_shm_size (void) {
+	return sizeof(struct rrr_stats_shm_header) + sizeof(struct rrr_stats_shm_slot) * RRR_STATS_SHM_SLOTS;
+}
+
+static void __rrr_stats_shm_slot_write_begin (
+		struct rrr_stats_shm_slot *slot
+) {
+	// Writers from different threads are serialized by changing the
+	// counter from even to odd. Any other writer will spin.
+	uint32_t seq;
+	do {
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+	} while ((seq & 1) || !__atomic_compare_exchange_n(&slot->seq, &seq, seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+	// The odd counter must be visible before any of the data stores
+	// which follow, or a reader could accept a torn copy.
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void __rrr_stats_shm_slot_write_end (
+		struct rrr_stats_shm_slot *slot
+) {
+	slot->time_updated = rrr_time_get_64();
+	__atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+static struct rrr_stats_shm_slot *__rrr_stats_shm_slot_get (
+		struct rrr_stats_shm *shm,
+		uint32_t slot
+) {
+	if (slot >= shm->page->header.slot_count) {
+		RRR_BUG("BUG: Slot %u out of range in %s\n", slot, __func__);
+	}
+	return &shm->page->slots[slot];
+}
+
+static int __rrr_stats_shm_new (
+		struct rrr_stats_shm **target,
+		const char *filename
+) {
+	struct rrr_stats_shm *shm;
+
+	if ((shm = rrr_allocate_zero(sizeof(*shm))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		return 1;
+	}
+
+	if ((shm->filename = rrr_strdup(filename)) == NULL) {
+		RRR_MSG_0("Could not allocate memory for filename in %s\n", __func__);
+		rrr_free(shm);
+		return 1;
+	}
+
+	*target = shm;
+
+	return 0;
+}
+
+int rrr_stats_shm_create (
+		struct rrr_stats_shm **target,
+		const char *filename
+) {
+	int ret = 0;
+
+	struct rrr_stats_shm *shm = NULL;
+	int fd = 0;
+
+	if ((ret = __rrr_stats_shm_new(&shm, filename)) != 0) {
+		goto out;
+	}
+
+	unlink(filename); // OK to ignore errors
+
+	if ((fd = rrr_socket_open(filename, O_CREAT|O_TRUNC|O_RDWR, 0644, "rrr_stats_shm", 0)) <= 0) {
+		RRR_MSG_0("Could not open statistics metrics file %s: %s\n", filename, rrr_strerror(errno));
+		ret = 1;
+		goto out_destroy;
+	}
+
+	shm->size = __rrr_stats_shm_size();
+
+	if (ftruncate(fd, (off_t) shm->size) != 0) {
+		RRR_MSG_0("Could not set size of statistics metrics file %s: %s\n", filename, rrr_strerror(errno));
+		ret = 1;
+		goto out_unlink;
+	}
+
+	if ((shm->page = mmap(NULL, shm->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		RRR_MSG_0("Could not map statistics metrics file %s: %s\n", filename, rrr_strerror(errno));
+		shm->page = NULL;
+		ret = 1;
+		goto out_unlink;
+	}
+
+	shm->is_owner = 1;
+
+	shm->page->header.version = RRR_STATS_SHM_VERSION;
+	shm->page->header.slot_count = RRR_STATS_SHM_SLOTS;
+	shm->page->header.slot_size = sizeof(struct rrr_stats_shm_slot);
+	shm->page->header.pid = (uint64_t) getpid();
+
+	// Readers check magic last
+	__atomic_store_n(&shm->page->header.magic, RRR_STATS_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	*target = shm;
+	shm = NULL;
+
+	goto out_close;
+	out_unlink:
+		unlink(filename);
+	out_destroy:
+		rrr_stats_shm_destroy(shm);
+	out_close:
+		if (fd > 0) {
+			rrr_socket_close(fd);
+		}
+	out:
+		return ret;
+}
+
+int rrr_stats_shm_open (
+		struct rrr_stats_shm **target,
+		const char *filename
+) {
+	int ret = 0;
+
+	struct rrr_stats_shm *shm = NULL;
+	int fd = 0;
+	struct stat st;
+
+	if ((ret = __rrr_stats_shm_new(&shm, filename)) != 0) {
+		goto out;
+	}
+
+	if ((fd = rrr_socket_open(filename, O_RDONLY, 0, "rrr_stats_shm", 0)) <= 0) {
+		RRR_MSG_0("Could not open statistics metrics file %s: %s\n", filename, rrr_strerror(errno));
+		ret = 1;
+		goto out_destroy;
+	}
+
+	if (fstat(fd, &st) != 0) {
+		RRR_MSG_0("Could not stat statistics metrics file %s: %s\n", filename, rrr_strerror(errno));
+		ret = 1;
+		goto out_destroy;
+	}
+
+	if ((size_t) st.st_size < sizeof(struct rrr_stats_shm_header)) {
+		RRR_MSG_0("Statistics metrics file %s was too small\n", filename);
+		ret = 1;
+		goto out_destroy;
+	}
+
+	shm->size = (size_t) st.st_size;
+
+	if ((shm->page = mmap(NULL, shm->size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		RRR_MSG_0("Could not map statistics metrics file %s: %s\n", filename, rrr_strerror(errno));
+		shm->page = NULL;
+		ret = 1;
+		goto out_destroy;
+	}
+
+	const struct rrr_stats_shm_header *header = &shm->page->header;
+
+	if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != RRR_STATS_SHM_MAGIC ||
+	    header->version != RRR_STATS_SHM_VERSION ||
+	    header->slot_size != sizeof(struct rrr_stats_shm_slot) ||
+	    sizeof(*header) + (size_t) header->slot_count * header->slot_size > shm->size
+	) {
+		RRR_MSG_0("Statistics metrics file %s was not recognized or is of a different version\n", filename);
+		ret = 1;
+		goto out_destroy;
+	}
+
+	*target = shm;
+	shm = NULL;
+
+	goto out_close;
+	out_destroy:
+		rrr_stats_shm_destroy(shm);
+	out_close:
+		if (fd > 0) {
+			rrr_socket_close(fd);
+		}
+	out:
+		return ret;
+}
+
+void rrr_stats_shm_destroy (
+		struct rrr_stats_shm *shm
+) {
+	if (shm == NULL) {
+		return;
+	}
+	if (shm->page != NULL) {
+		munmap(shm->page, shm->size);
+	}
+	if (shm->is_owner) {
+		unlink(shm->filename);
+	}
+	RRR_FREE_IF_NOT_NULL(shm->filename);
+	rrr_free(shm);
+}
+
+// Caller must serialize calls to obtain and release
+int rrr_stats_shm_slot_obtain (
+		uint32_t *slot,
+		struct rrr_stats_shm *shm,
+		const char *name
+) {
+	uint32_t free_slot = UINT32_MAX;
+
+	for (uint32_t i = 0; i < shm->page->header.slot_count; i++) {
+		const struct rrr_stats_shm_slot *node = &shm->page->slots[i];
+		if (!node->in_use) {
+			if (free_slot == UINT32_MAX) {
+				free_slot = i;
+			}
+		}
+		else if (strncmp(node->name, name, RRR_STATS_SHM_NAME_MAX) == 0) {
+			*slot = i;
+			return 0;
+		}
+	}
+
+	if (free_slot == UINT32_MAX) {
+		return 1;
+	}
+
+	struct rrr_stats_shm_slot *node = &shm->page->slots[free_slot];
+
+	__rrr_stats_shm_slot_write_begin(node);
+	memset(node->name, '\0', sizeof(node->name));
+	strncpy(node->name, name, RRR_STATS_SHM_NAME_MAX);
+	memset(node->values, '\0', sizeof(node->values));
+	memset(node->rates, '\0', sizeof(node->rates));
+	node->in_use = 1;
+	__rrr_stats_shm_slot_write_end(node);
+
+	*slot = free_slot;
+
+	return 0;
+}
+
+void rrr_stats_shm_slot_release (
+		struct rrr_stats_shm *shm,
+		uint32_t slot
+) {
+	struct rrr_stats_shm_slot *node = __rrr_stats_shm_slot_get(shm, slot);
+
+	__rrr_stats_shm_slot_write_begin(node);
+	node->in_use = 0;
+	memset(node->name, '\0', sizeof(node->name));
+	__rrr_stats_shm_slot_write_end(node);
+}
+
+void rrr_stats_shm_value_set (
+		struct rrr_stats_shm *shm,
+		uint32_t slot,
+		enum rrr_stats_shm_value value,
+		uint64_t number
+) {
+	struct rrr_stats_shm_slot *node = __rrr_stats_shm_slot_get(shm, slot);
+
+	__rrr_stats_shm_slot_write_begin(node);
+	node->values[value] = number;
+	__rrr_stats_shm_slot_write_end(node);
+}
+
+void rrr_stats_shm_rate_set (
+		struct rrr_stats_shm *shm,
+		uint32_t slot,
+		unsigned int id,
+		const char *name,
+		uint64_t total
+) {
+	if (id >= RRR_STATS_SHM_RATES_MAX) {
+		return;
+	}
+
+	struct rrr_stats_shm_slot *node = __rrr_stats_shm_slot_get(shm, slot);
+	struct rrr_stats_shm_rate *rate = &node->rates[id];
+
+	__rrr_stats_shm_slot_write_begin(node);
+	if (strncmp(rate->name, name, sizeof(rate->name) - 1) != 0) {
+		memset(rate->name, '\0', sizeof(rate->name));
+		strncpy(rate->name, name, sizeof(rate->name) - 1);
+	}
+	rate->total = total;
+	__rrr_stats_shm_slot_write_end(node);
+}
+
+// Returns 0 when a consistent copy was made, caller must check
+// in_use of the copy. Returns 1 if the slot was busy.
+int rrr_stats_shm_slot_read (
+		struct rrr_stats_shm_slot *target,
+		const struct rrr_stats_shm *shm,
+		uint32_t slot
+) {
+	const struct rrr_stats_shm_slot *node = &shm->page->slots[slot];
+
+	for (int i = 0; i < RRR_STATS_SHM_READ_RETRIES; i++) {
+		const uint32_t seq = __atomic_load_n(&node->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			continue;
+		}
+
+		memcpy(target, node, sizeof(*target));
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&node->seq, __ATOMIC_RELAXED) == seq) {
+			target->name[RRR_STATS_SHM_NAME_MAX] = '\0';
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+const char *rrr_stats_shm_value_name (
+		enum rrr_stats_shm_value value
+) {
+	if (value >= RRR_STATS_SHM_VALUE_COUNT) {
+		RRR_BUG("BUG: Value %i out of range in %s\n", value, __func__);
+	}
+	return rrr_stats_shm_value_names[value];
+}
@@ -0,0 +1,134 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RRR_STATS_SHM_H
+#define RRR_STATS_SHM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define RRR_STATS_SHM_PREFIX RRR_STATS_SOCKET_PREFIX "_shm"
+
+#define RRR_STATS_SHM_MAGIC      0x52525253 /* RRRS */
+#define RRR_STATS_SHM_VERSION    1
+#define RRR_STATS_SHM_SLOTS      128
+#define RRR_STATS_SHM_NAME_MAX   63
+#define RRR_STATS_SHM_VALUES_MAX 16
+#define RRR_STATS_SHM_RATES_MAX  16
+
+// Fixed value positions in each slot. Keep in sync with names in stats_shm.c.
+enum rrr_stats_shm_value {
+	RRR_STATS_SHM_VALUE_BUFFER_COUNT,
+	RRR_STATS_SHM_VALUE_BUFFER_WRITTEN_TOTAL,
+	RRR_STATS_SHM_VALUE_BUFFER_DELETED_TOTAL,
+	RRR_STATS_SHM_VALUE_MMAP_TO_CHILD_COUNT,
+	RRR_STATS_SHM_VALUE_MMAP_TO_CHILD_FULL_EVENTS,
+	RRR_STATS_SHM_VALUE_MMAP_TO_PARENT_COUNT,
+	RRR_STATS_SHM_VALUE_MMAP_TO_PARENT_FULL_EVENTS,
+	RRR_STATS_SHM_VALUE_COUNT
+};
+
+/*
+ * The region is a file in the run directory which is mapped by the stats
+ * engine and written to in place by the main loop and by instance threads.
+ * External readers map the file read-only. Each slot is protected by a
+ * sequence counter which is odd while a write is in progress. Writers
+ * take the slot by changing the counter from even to odd, readers retry
+ * if the counter is odd or changes while they copy the slot.
+ */
+
+struct rrr_stats_shm_rate {
+	char name[32];
+	uint64_t total;
+};
+
+struct rrr_stats_shm_slot {
+	uint32_t seq;
+	uint32_t in_use;
+	char name[RRR_STATS_SHM_NAME_MAX + 1];
+	uint64_t time_updated;
+	uint64_t values[RRR_STATS_SHM_VALUES_MAX];
+	struct rrr_stats_shm_rate rates[RRR_STATS_SHM_RATES_MAX];
+};
+
+struct rrr_stats_shm_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slot_count;
+	uint32_t slot_size;
+	uint64_t pid;
+};
+
+struct rrr_stats_shm_page {
+	struct rrr_stats_shm_header header;
+	struct rrr_stats_shm_slot slots[];
+};
+
+struct rrr_stats_shm {
+	struct rrr_stats_shm_page *page;
+	size_t size;
+	char *filename;
+	int is_owner;
+};
+
+int rrr_stats_shm_create (
+		struct rrr_stats_shm **target,
+		const char *filename
+);
+int rrr_stats_shm_open (
+		struct rrr_stats_shm **target,
+		const char *filename
+);
+void rrr_stats_shm_destroy (
+		struct rrr_stats_shm *shm
+);
+int rrr_stats_shm_slot_obtain (
+		uint32_t *slot,
+		struct rrr_stats_shm *shm,
+		const char *name
+);
+void rrr_stats_shm_slot_release (
+		struct rrr_stats_shm *shm,
+		uint32_t slot
+);
+void rrr_stats_shm_value_set (
+		struct rrr_stats_shm *shm,
+		uint32_t slot,
+		enum rrr_stats_shm_value value,
+		uint64_t number
+);
+void rrr_stats_shm_rate_set (
+		struct rrr_stats_shm *shm,
+		uint32_t slot,
+		unsigned int id,
+		const char *name,
+		uint64_t total
+);
+int rrr_stats_shm_slot_read (
+		struct rrr_stats_shm_slot *target,
+		const struct rrr_stats_shm *shm,
+		uint32_t slot
+);
+const char *rrr_stats_shm_value_name (
+		enum rrr_stats_shm_value value
+);
+
+#endif /* RRR_STATS_SHM_H */
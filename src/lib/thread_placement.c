@@ -0,0 +1,490 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "log.h"
+#include "thread_placement.h"
+#include "rrr_strerror.h"
+#include "util/gnu.h"
+
+#ifdef RRR_HAVE_SET_MEMPOLICY
+#	include <sys/syscall.h>
+#	include <linux/mempolicy.h>
+#endif
+
+#define RRR_THREAD_PLACEMENT_ISOLATED_PATH "/sys/devices/system/cpu/isolated"
+
+static void __rrr_thread_placement_bit_set (
+		uint64_t *target,
+		rrr_length bit
+) {
+	target[bit / 64] |= (uint64_t) 1 << (bit % 64);
+}
+
+static int __rrr_thread_placement_bit_get (
+		const uint64_t *target,
+		rrr_length bit
+) {
+	return (target[bit / 64] & ((uint64_t) 1 << (bit % 64))) != 0;
+}
+
+static int __rrr_thread_placement_number_parse (
+		rrr_length *target,
+		const char **pos
+) {
+	char *end = NULL;
+
+	if (**pos < '0' || **pos > '9') {
+		return 1;
+	}
+
+	unsigned long long value = strtoull(*pos, &end, 10);
+	if (value > RRR_LENGTH_MAX) {
+		return 1;
+	}
+
+	*target = (rrr_length) value;
+	*pos = end;
+
+	return 0;
+}
+
+// Parses lists like 0-3,6,8-9 into a bitmask as used in kernel cpulists
+int rrr_thread_placement_list_parse (
+		uint64_t *target,
+		rrr_length target_bits,
+		const char *str
+) {
+	const char *pos = str;
+	rrr_length count = 0;
+
+	memset(target, '\0', sizeof(*target) * ((target_bits + 63) / 64));
+
+	while (*pos != '\0' && *pos != '\n') {
+		rrr_length first, last;
+
+		if (__rrr_thread_placement_number_parse(&first, &pos) != 0) {
+			goto out_invalid;
+		}
+
+		last = first;
+		if (*pos == '-') {
+			pos++;
+			if (__rrr_thread_placement_number_parse(&last, &pos) != 0) {
+				goto out_invalid;
+			}
+		}
+
+		if (last < first || last >= target_bits) {
+			RRR_MSG_0("Range %" PRIrrrl "-%" PRIrrrl " out of bounds in list '%s', maximum value is %" PRIrrrl "\n",
+					first, last, str, target_bits - 1);
+			return 1;
+		}
+
+		for (rrr_length i = first; i <= last; i++) {
+			__rrr_thread_placement_bit_set(target, i);
+			count++;
+		}
+
+		if (*pos == ',') {
+			pos++;
+			if (*pos == '\0' || *pos == '\n') {
+				goto out_invalid;
+			}
+		}
+		else if (*pos != '\0' && *pos != '\n') {
+			goto out_invalid;
+		}
+	}
+
+	return count == 0;
+
+	out_invalid:
+		RRR_MSG_0("Invalid list '%s', expected numbers or ranges separated by comma like 0-3,6\n", str);
+		return 1;
+}
+
+// Formats a bitmask as a list like 0-3,6. If the target is too small,
+// the list is cut after the last complete number or range.
+void rrr_thread_placement_list_format (
+		char *target,
+		size_t target_size,
+		const uint64_t *source,
+		rrr_length source_bits
+) {
+	size_t wpos = 0;
+
+	target[0] = '\0';
+
+	for (rrr_length i = 0; i < source_bits; i++) {
+		if (!__rrr_thread_placement_bit_get(source, i)) {
+			continue;
+		}
+
+		rrr_length last = i;
+		while (last + 1 < source_bits && __rrr_thread_placement_bit_get(source, last + 1)) {
+			last++;
+		}
+
+		int res = last > i
+			? snprintf(target + wpos, target_size - wpos, "%s%" PRIrrrl "-%" PRIrrrl, wpos > 0 ? "," : "", i, last)
+			: snprintf(target + wpos, target_size - wpos, "%s%" PRIrrrl, wpos > 0 ? "," : "", i);
+
+		if (res < 0 || (size_t) res >= target_size - wpos) {
+			// Truncated, list is only informational
+			target[wpos] = '\0';
+			break;
+		}
+
+		wpos += (size_t) res;
+		i = last;
+	}
+}
+
+/*
+ * Restrict the placement to one single CPU from the CPUs isolated from
+ * the scheduler by the kernel (isolcpus). Threads sharing an isolated
+ * CPU are not load balanced, the index should therefore be unique for
+ * each thread. If the placement already has a CPU set, only isolated
+ * CPUs within this set are used.
+ */
+int rrr_thread_placement_isolated_select (
+		struct rrr_thread_placement *placement,
+		rrr_length index
+) {
+	int ret = 0;
+
+	uint64_t isolated[RRR_THREAD_PLACEMENT_CPU_MAX / 64];
+	char buf[RRR_THREAD_PLACEMENT_LIST_MAX * 4];
+	rrr_length candidates[RRR_THREAD_PLACEMENT_CPU_MAX];
+	rrr_length candidate_count = 0;
+	FILE *file;
+
+	if ((file = fopen(RRR_THREAD_PLACEMENT_ISOLATED_PATH, "r")) == NULL) {
+		RRR_MSG_0("Could not open %s to find isolated CPUs: %s\n",
+				RRR_THREAD_PLACEMENT_ISOLATED_PATH, rrr_strerror(errno));
+		ret = 1;
+		goto out;
+	}
+
+	if (fgets(buf, sizeof(buf), file) == NULL) {
+		buf[0] = '\0';
+	}
+
+	fclose(file);
+
+	if (buf[0] == '\0' || buf[0] == '\n') {
+		RRR_MSG_0("No isolated CPUs found in %s, use the isolcpus kernel parameter to isolate CPUs\n",
+				RRR_THREAD_PLACEMENT_ISOLATED_PATH);
+		ret = 1;
+		goto out;
+	}
+
+	if ((ret = rrr_thread_placement_list_parse(isolated, RRR_THREAD_PLACEMENT_CPU_MAX, buf)) != 0) {
+		goto out;
+	}
+
+	for (rrr_length i = 0; i < RRR_THREAD_PLACEMENT_CPU_MAX; i++) {
+		if (__rrr_thread_placement_bit_get(isolated, i) &&
+		    (!placement->has_cpus || __rrr_thread_placement_bit_get(placement->cpus, i))
+		) {
+			candidates[candidate_count++] = i;
+		}
+	}
+
+	if (candidate_count == 0) {
+		RRR_MSG_0("None of the isolated CPUs %s are in the configured CPU set\n", buf);
+		ret = 1;
+		goto out;
+	}
+
+	if (index >= candidate_count) {
+		RRR_MSG_0("Warning: More threads than isolated CPUs are configured, isolated CPU %" PRIrrrl " will be shared\n",
+				candidates[index % candidate_count]);
+	}
+
+	memset(placement->cpus, '\0', sizeof(placement->cpus));
+	__rrr_thread_placement_bit_set(placement->cpus, candidates[index % candidate_count]);
+	placement->has_cpus = 1;
+
+	out:
+	return ret;
+}
+
+int rrr_thread_placement_sched_policy_parse (
+		enum rrr_thread_placement_sched_policy *target,
+		const char *str
+) {
+	if (strcmp(str, "other") == 0) {
+		*target = RRR_THREAD_PLACEMENT_SCHED_OTHER;
+	}
+	else if (strcmp(str, "fifo") == 0) {
+		*target = RRR_THREAD_PLACEMENT_SCHED_FIFO;
+	}
+	else if (strcmp(str, "rr") == 0) {
+		*target = RRR_THREAD_PLACEMENT_SCHED_RR;
+	}
+	else {
+		RRR_MSG_0("Unknown scheduling policy '%s', possible values are other, fifo and rr\n", str);
+		return 1;
+	}
+
+	return 0;
+}
+
+int rrr_thread_placement_numa_policy_parse (
+		enum rrr_thread_placement_numa_policy *target,
+		const char *str
+) {
+	if (strcmp(str, "bind") == 0) {
+		*target = RRR_THREAD_PLACEMENT_NUMA_BIND;
+	}
+	else if (strcmp(str, "preferred") == 0) {
+		*target = RRR_THREAD_PLACEMENT_NUMA_PREFERRED;
+	}
+	else if (strcmp(str, "interleave") == 0) {
+		*target = RRR_THREAD_PLACEMENT_NUMA_INTERLEAVE;
+	}
+	else {
+		RRR_MSG_0("Unknown NUMA policy '%s', possible values are bind, preferred and interleave\n", str);
+		return 1;
+	}
+
+	return 0;
+}
+
+int rrr_thread_placement_is_set (
+		const struct rrr_thread_placement *placement
+) {
+	return placement->has_cpus ||
+	       placement->numa_policy != RRR_THREAD_PLACEMENT_NUMA_DEFAULT ||
+	       placement->sched_policy != RRR_THREAD_PLACEMENT_SCHED_DEFAULT ||
+	       placement->has_nice;
+}
+
+static int __rrr_thread_placement_apply_cpus (
+		const struct rrr_thread_placement *placement
+) {
+#ifdef RRR_HAVE_SCHED_SETAFFINITY
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	for (rrr_length i = 0; i < RRR_THREAD_PLACEMENT_CPU_MAX && i < CPU_SETSIZE; i++) {
+		if (__rrr_thread_placement_bit_get(placement->cpus, i)) {
+			CPU_SET(i, &set);
+		}
+	}
+
+	// Zero means the calling thread
+	if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+		RRR_MSG_0("Failed to set CPU affinity: %s\n", rrr_strerror(errno));
+		return 1;
+	}
+
+	return 0;
+#else
+	(void)(placement);
+	RRR_MSG_0("CPU affinity is not supported on this platform\n");
+	return 1;
+#endif
+}
+
+static int __rrr_thread_placement_apply_numa (
+		const struct rrr_thread_placement *placement
+) {
+#ifdef RRR_HAVE_SET_MEMPOLICY
+	int mode = MPOL_DEFAULT;
+
+	switch (placement->numa_policy) {
+		case RRR_THREAD_PLACEMENT_NUMA_BIND:
+			mode = MPOL_BIND;
+			break;
+		case RRR_THREAD_PLACEMENT_NUMA_PREFERRED:
+			mode = MPOL_PREFERRED;
+			break;
+		case RRR_THREAD_PLACEMENT_NUMA_INTERLEAVE:
+			mode = MPOL_INTERLEAVE;
+			break;
+		default:
+			RRR_BUG("BUG: Unknown NUMA policy %i in %s\n", placement->numa_policy, __func__);
+	};
+
+	// The kernel uses one bit less than the given maximum
+	if (syscall(SYS_set_mempolicy, mode, &placement->numa_nodes, RRR_THREAD_PLACEMENT_NUMA_NODE_MAX + 1) != 0) {
+		RRR_MSG_0("Failed to set NUMA memory policy: %s\n", rrr_strerror(errno));
+		return 1;
+	}
+
+	return 0;
+#else
+	(void)(placement);
+	RRR_MSG_0("NUMA memory policy is not supported on this platform\n");
+	return 1;
+#endif
+}
+
+static int __rrr_thread_placement_apply_sched (
+		const struct rrr_thread_placement *placement
+) {
+	struct sched_param param = {0};
+	int policy;
+	int err;
+
+	switch (placement->sched_policy) {
+		case RRR_THREAD_PLACEMENT_SCHED_OTHER:
+			policy = SCHED_OTHER;
+			break;
+		case RRR_THREAD_PLACEMENT_SCHED_FIFO:
+			policy = SCHED_FIFO;
+			param.sched_priority = placement->sched_priority;
+			break;
+		case RRR_THREAD_PLACEMENT_SCHED_RR:
+			policy = SCHED_RR;
+			param.sched_priority = placement->sched_priority;
+			break;
+		default:
+			RRR_BUG("BUG: Unknown scheduling policy %i in %s\n", placement->sched_policy, __func__);
+	};
+
+	if ((err = pthread_setschedparam(pthread_self(), policy, &param)) != 0) {
+		RRR_MSG_0("Failed to set scheduling policy: %s%s\n", rrr_strerror(err),
+				err == EPERM ? " (real-time scheduling requires CAP_SYS_NICE or a suitable RLIMIT_RTPRIO)" : "");
+		return 1;
+	}
+
+	return 0;
+}
+
+static int __rrr_thread_placement_apply_nice (
+		const struct rrr_thread_placement *placement
+) {
+	// On Linux, the nice value is per thread when the thread ID is given
+	if (setpriority(PRIO_PROCESS, (id_t) rrr_gettid(), placement->nice) != 0) {
+		RRR_MSG_0("Failed to set nice value %i: %s\n", placement->nice, rrr_strerror(errno));
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Apply placement to the calling thread. Processes forked by the thread
+ * afterwards inherit the placement. All settings are attempted, a
+ * non-zero value is returned if any of them failed.
+ */
+int rrr_thread_placement_apply (
+		const struct rrr_thread_placement *placement,
+		const char *name
+) {
+	int ret = 0;
+
+	if (placement->has_cpus && __rrr_thread_placement_apply_cpus(placement) != 0) {
+		ret = 1;
+	}
+	if (placement->numa_policy != RRR_THREAD_PLACEMENT_NUMA_DEFAULT && __rrr_thread_placement_apply_numa(placement) != 0) {
+		ret = 1;
+	}
+	if (placement->sched_policy != RRR_THREAD_PLACEMENT_SCHED_DEFAULT && __rrr_thread_placement_apply_sched(placement) != 0) {
+		ret = 1;
+	}
+	if (placement->has_nice && __rrr_thread_placement_apply_nice(placement) != 0) {
+		ret = 1;
+	}
+
+	if (ret != 0) {
+		RRR_MSG_0("Warning: Placement of thread %s was not fully applied\n", name);
+	}
+
+	return ret;
+}
+
+void rrr_thread_placement_effective_get (
+		struct rrr_thread_placement_effective *effective
+) {
+	struct sched_param param = {0};
+	int policy = SCHED_OTHER;
+
+	memset(effective, '\0', sizeof(*effective));
+
+	strcpy(effective->cpus, "unknown");
+	strcpy(effective->numa_nodes, "unknown");
+	effective->numa_policy = "unknown";
+
+#ifdef RRR_HAVE_SCHED_SETAFFINITY
+	{
+		cpu_set_t set;
+		uint64_t cpus[RRR_THREAD_PLACEMENT_CPU_MAX / 64] = {0};
+
+		if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+			for (rrr_length i = 0; i < RRR_THREAD_PLACEMENT_CPU_MAX && i < CPU_SETSIZE; i++) {
+				if (CPU_ISSET(i, &set)) {
+					__rrr_thread_placement_bit_set(cpus, i);
+				}
+			}
+			rrr_thread_placement_list_format(effective->cpus, sizeof(effective->cpus), cpus, RRR_THREAD_PLACEMENT_CPU_MAX);
+		}
+	}
+#endif
+
+#ifdef RRR_HAVE_SET_MEMPOLICY
+	{
+		int mode = 0;
+		uint64_t nodes = 0;
+
+		if (syscall(SYS_get_mempolicy, &mode, &nodes, RRR_THREAD_PLACEMENT_NUMA_NODE_MAX + 1, NULL, 0) == 0) {
+			effective->numa_policy = mode == MPOL_BIND ? "bind" :
+			                         mode == MPOL_PREFERRED ? "preferred" :
+			                         mode == MPOL_INTERLEAVE ? "interleave" :
+			                         mode == MPOL_DEFAULT ? "default" : "other";
+			rrr_thread_placement_list_format(effective->numa_nodes, sizeof(effective->numa_nodes), &nodes, RRR_THREAD_PLACEMENT_NUMA_NODE_MAX);
+			if (*effective->numa_nodes == '\0') {
+				// No nodes are returned for the default policy
+				strcpy(effective->numa_nodes, "any");
+			}
+		}
+	}
+#endif
+
+	if (pthread_getschedparam(pthread_self(), &policy, &param) == 0) {
+		effective->sched_policy = policy == SCHED_FIFO ? "fifo" :
+		                          policy == SCHED_RR ? "rr" :
+		                          policy == SCHED_OTHER ? "other" : "unknown";
+		effective->sched_priority = param.sched_priority;
+	}
+	else {
+		effective->sched_policy = "unknown";
+	}
+
+	errno = 0;
+	int nice = getpriority(PRIO_PROCESS, (id_t) rrr_gettid());
+	effective->nice = errno == 0 ? nice : 0;
+}
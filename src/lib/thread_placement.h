@@ -0,0 +1,105 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef RRR_THREAD_PLACEMENT_H
+#define RRR_THREAD_PLACEMENT_H
+
+#include <stdint.h>
+
+#include "rrr_types.h"
+
+#define RRR_THREAD_PLACEMENT_CPU_MAX       1024
+#define RRR_THREAD_PLACEMENT_NUMA_NODE_MAX 64
+#define RRR_THREAD_PLACEMENT_LIST_MAX      256
+
+enum rrr_thread_placement_numa_policy {
+	RRR_THREAD_PLACEMENT_NUMA_DEFAULT,
+	RRR_THREAD_PLACEMENT_NUMA_BIND,
+	RRR_THREAD_PLACEMENT_NUMA_PREFERRED,
+	RRR_THREAD_PLACEMENT_NUMA_INTERLEAVE
+};
+
+enum rrr_thread_placement_sched_policy {
+	RRR_THREAD_PLACEMENT_SCHED_DEFAULT,
+	RRR_THREAD_PLACEMENT_SCHED_OTHER,
+	RRR_THREAD_PLACEMENT_SCHED_FIFO,
+	RRR_THREAD_PLACEMENT_SCHED_RR
+};
+
+// Placement of a thread as given in the configuration. Members left
+// at zero are not changed when the placement is applied.
+struct rrr_thread_placement {
+	uint64_t cpus[RRR_THREAD_PLACEMENT_CPU_MAX / 64];
+	int has_cpus;
+	uint64_t numa_nodes;
+	enum rrr_thread_placement_numa_policy numa_policy;
+	enum rrr_thread_placement_sched_policy sched_policy;
+	int sched_priority;
+	int nice;
+	int has_nice;
+};
+
+// Placement of the calling thread as reported by the operating system
+struct rrr_thread_placement_effective {
+	char cpus[RRR_THREAD_PLACEMENT_LIST_MAX];
+	char numa_nodes[RRR_THREAD_PLACEMENT_LIST_MAX];
+	const char *numa_policy;
+	const char *sched_policy;
+	int sched_priority;
+	int nice;
+};
+
+int rrr_thread_placement_list_parse (
+		uint64_t *target,
+		rrr_length target_bits,
+		const char *str
+);
+void rrr_thread_placement_list_format (
+		char *target,
+		size_t target_size,
+		const uint64_t *source,
+		rrr_length source_bits
+);
+int rrr_thread_placement_isolated_select (
+		struct rrr_thread_placement *placement,
+		rrr_length index
+);
+int rrr_thread_placement_sched_policy_parse (
+		enum rrr_thread_placement_sched_policy *target,
+		const char *str
+);
+int rrr_thread_placement_numa_policy_parse (
+		enum rrr_thread_placement_numa_policy *target,
+		const char *str
+);
+int rrr_thread_placement_is_set (
+		const struct rrr_thread_placement *placement
+);
+int rrr_thread_placement_apply (
+		const struct rrr_thread_placement *placement,
+		const char *name
+);
+void rrr_thread_placement_effective_get (
+		struct rrr_thread_placement_effective *effective
+);
+
+#endif /* RRR_THREAD_PLACEMENT_H */
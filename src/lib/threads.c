@@ -106,6 +106,7 @@ static int __rrr_thread_destroy (
 		struct rrr_thread *thread
 ) {
 	__rrr_thread_managed_data_cleanup_if_not_started(thread);
+	RRR_FREE_IF_NOT_NULL(thread->hosted);
 	pthread_cond_destroy(&thread->signal_cond);
 	pthread_mutex_destroy(&thread->signal_cond_mutex);
 	rrr_free(thread);
@@ -379,6 +380,13 @@ void rrr_thread_collection_destroy (
 
 	__rrr_thread_collection_stop_and_join_all_nolock(collection);
 
+	// A hosted thread might still be running if its host is a ghost
+	RRR_LL_ITERATE_BEGIN(collection, struct rrr_thread);
+		if (node->host != NULL && rrr_thread_state_check(node->host, RRR_THREAD_STATE_GHOST)) {
+			rrr_atomic_u32_fetch_or(&node->state_and_signal, RRR_THREAD_STATE_GHOST);
+		}
+	RRR_LL_ITERATE_END();
+
 	RRR_LL_ITERATE_BEGIN(collection, struct rrr_thread);
 		if (rrr_thread_state_check(node, RRR_THREAD_STATE_GHOST)) {
 			RRR_MSG_0 ("Thread %s is ghost when freeing all threads. Not freeing memory.\n",
@@ -497,6 +505,11 @@ static void __rrr_thread_start_condition_helper_nofork (
 		struct rrr_thread *thread,
 		int do_nice_wait
 ) {
+	if (thread->host != NULL) {
+		// States of hosted threads are managed by the host
+		return;
+	}
+
 	rrr_thread_state_set(thread, RRR_THREAD_STATE_INITIALIZED);
 	rrr_thread_signal_wait_cond_with_watchdog_update(thread, RRR_THREAD_SIGNAL_START_BEFOREFORK);
 	rrr_thread_state_set(thread, RRR_THREAD_STATE_RUNNING_FORKED);
@@ -528,6 +541,10 @@ int rrr_thread_start_condition_helper_fork (
 		int (*fork_callback)(void *arg),
 		void *callback_arg
 ) {
+	if (thread->host != NULL) {
+		RRR_BUG("BUG: Fork start condition used in hosted thread %s\n", thread->name);
+	}
+
 	rrr_thread_state_set(thread, RRR_THREAD_STATE_INITIALIZED);
 	rrr_thread_signal_wait_cond_with_watchdog_update(thread, RRR_THREAD_SIGNAL_START_BEFOREFORK);
 
@@ -1115,6 +1132,201 @@ struct rrr_thread *rrr_thread_collection_thread_create_and_preload (
 		return thread;
 }
 
+struct rrr_thread *rrr_thread_collection_thread_create_hosted_and_preload (
+		struct rrr_thread_collection *collection,
+		struct rrr_thread *host,
+		void *(*start_routine) (struct rrr_thread *),
+		int (*preload_routine) (struct rrr_thread *),
+		const char *name,
+		void *private_data
+) {
+	int err;
+	struct rrr_thread *thread = NULL;
+	struct rrr_thread **hosted_new = NULL;
+
+	if (host->host != NULL || host->is_watchdog) {
+		RRR_BUG("BUG: Host thread %s was hosted or a watchdog in %s\n", host->name, __func__);
+	}
+
+	if (strlen(name) > sizeof(thread->name) - 5) {
+		RRR_MSG_0 ("Name for thread was too long: '%s'\n", name);
+		goto out;
+	}
+
+	if ((hosted_new = rrr_reallocate(host->hosted, sizeof(*hosted_new) * (size_t) (host->hosted_count + 1))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		goto out;
+	}
+	host->hosted = hosted_new;
+
+	if (__rrr_thread_new(&thread, 0) != 0) {
+		goto out;
+	}
+
+	sprintf(thread->name, "%s", name);
+
+	thread->start_routine = start_routine;
+	thread->private_data = private_data;
+	thread->host = host;
+
+	rrr_thread_state_set(thread, RRR_THREAD_STATE_NEW);
+
+	if ((err = (preload_routine != NULL ? preload_routine(thread) : 0)) != 0) {
+		RRR_MSG_0 ("Error while preloading thread\n");
+		goto out_destroy_thread;
+	}
+
+	host->hosted[host->hosted_count++] = thread;
+
+	__rrr_thread_collection_add_thread(collection, thread);
+
+	goto out;
+	out_destroy_thread:
+		__rrr_thread_destroy(thread);
+		thread = NULL;
+	out:
+		return thread;
+}
+
+static void __rrr_thread_host_start_condition_step (
+		int *done,
+		struct rrr_thread *thread
+) {
+	uint32_t state = __rrr_thread_state_get(thread);
+
+	if (state == RRR_THREAD_STATE_NEW && rrr_thread_signal_check(thread, RRR_THREAD_SIGNAL_START_INITIALIZE)) {
+		rrr_thread_state_set(thread, RRR_THREAD_STATE_INITIALIZED);
+	}
+	else if (state == RRR_THREAD_STATE_INITIALIZED && rrr_thread_signal_check(thread, RRR_THREAD_SIGNAL_START_BEFOREFORK)) {
+		rrr_thread_state_set(thread, RRR_THREAD_STATE_RUNNING_FORKED);
+	}
+	else if (state == RRR_THREAD_STATE_RUNNING_FORKED && rrr_thread_signal_check(thread, RRR_THREAD_SIGNAL_START_AFTERFORK)) {
+		return;
+	}
+
+	*done = 0;
+}
+
+// Performs the start procedure for the host and all of its hosted threads
+// the same way rrr_thread_start_condition_helper_nofork() does for single
+// threads. Returns when all threads have received the last start signal.
+int rrr_thread_host_start_condition_helper (
+		struct rrr_thread *host
+) {
+	while (1) {
+		int done = 1;
+
+		// Only async safe functions until all threads are started as
+		// other threads might be forking
+
+		if (rrr_thread_signal_check(host, RRR_THREAD_SIGNAL_ENCOURAGE_STOP)) {
+			return RRR_THREAD_STOP;
+		}
+
+		for (int i = 0; i < host->hosted_count; i++) {
+			__rrr_thread_host_start_condition_step(&done, host->hosted[i]);
+		}
+		__rrr_thread_host_start_condition_step(&done, host);
+
+		if (done) {
+			break;
+		}
+
+		rrr_thread_watchdog_time_update(host);
+		rrr_posix_usleep(1000); // 1 ms
+	}
+
+	return 0;
+}
+
+static void __rrr_thread_hosted_run (
+		struct rrr_thread *thread
+) {
+	RRR_DBG_8("Hosted thread %p/%s starting in host %s\n",
+			thread, thread->name, thread->host->name);
+
+	pthread_cleanup_push(__rrr_thread_state_set_stopped, thread);
+	pthread_cleanup_push(__rrr_thread_cleanup, thread);
+
+	if (!rrr_thread_signal_check(thread, RRR_THREAD_SIGNAL_ENCOURAGE_STOP)) {
+		thread->start_routine(thread);
+	}
+
+	pthread_cleanup_pop(1);
+	pthread_cleanup_pop(1);
+}
+
+/*
+ * Hosted threads are run nested. When a hosted thread dispatches its event
+ * queue, which shares the event base with the host, this function is called
+ * to start the next hosted thread. After the last hosted thread, the host
+ * dispatch function runs the event loop. When the loop exits, or if any
+ * hosted thread returns without dispatching, all hosted threads unwind and
+ * clean up in reverse order.
+ */
+int rrr_thread_host_run_next_void (
+		void *arg
+) {
+	struct rrr_thread *host = arg;
+
+	int ret = 0;
+
+	if (host->hosted_done) {
+		// Unwinding, a hosted thread attempted to dispatch again
+		goto out;
+	}
+
+	if (host->hosted_pos == host->hosted_count) {
+		RRR_DBG_8("Host thread %p/%s dispatching for %i hosted threads\n",
+				host, host->name, host->hosted_count);
+		ret = host->host_dispatch(host->host_dispatch_arg);
+	}
+	else {
+		__rrr_thread_hosted_run(host->hosted[host->hosted_pos++]);
+	}
+
+	host->hosted_done = 1;
+
+	out:
+	return ret;
+}
+
+static void __rrr_thread_host_cleanup (
+		void *arg
+) {
+	struct rrr_thread *host = arg;
+
+	// Clean up hosted threads which were never run
+	for (int i = host->hosted_pos; i < host->hosted_count; i++) {
+		__rrr_thread_cleanup(host->hosted[i]);
+		__rrr_thread_state_set_stopped(host->hosted[i]);
+	}
+
+	host->hosted_pos = host->hosted_count;
+}
+
+void rrr_thread_host_run (
+		struct rrr_thread *host,
+		int (*dispatch)(void *arg),
+		void *dispatch_arg
+) {
+	host->host_dispatch = dispatch;
+	host->host_dispatch_arg = dispatch_arg;
+	host->hosted_pos = 0;
+	host->hosted_done = 0;
+
+	// From now on, the host is responsible for cleaning up
+	for (int i = 0; i < host->hosted_count; i++) {
+		host->hosted[i]->started = 1;
+	}
+
+	pthread_cleanup_push(__rrr_thread_host_cleanup, host);
+
+	rrr_thread_host_run_next_void(host);
+
+	pthread_cleanup_pop(1);
+}
+
 int rrr_thread_collection_start_all (
 		struct rrr_thread_collection *collection
 ) {
@@ -1123,7 +1335,7 @@ int rrr_thread_collection_start_all (
 	struct watchdog_data *watchdog_data = NULL;
 
 	RRR_LL_ITERATE_BEGIN(collection, struct rrr_thread);
-		if (node->is_watchdog) {
+		if (node->is_watchdog || node->host != NULL) {
 			RRR_LL_ITERATE_NEXT();
 		}
 
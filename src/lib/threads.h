@@ -138,6 +138,16 @@ struct rrr_thread {
 	// External data to clean up
 	struct rrr_thread_managed_data_collection managed_data;
 
+	// Hosted threads have no system thread or watchdog of their own
+	// and are run one after another by the host thread
+	struct rrr_thread *host;
+	struct rrr_thread **hosted;
+	int hosted_count;
+	int hosted_pos;
+	int hosted_done;
+	int (*host_dispatch)(void *arg);
+	void *host_dispatch_arg;
+
 	// Cleanup control
 	volatile int started;
 };
@@ -152,6 +162,12 @@ int rrr_thread_managed_data_push (
 		void (*destroy)(void *data)
 );
 
+static inline int rrr_thread_is_host (
+		const struct rrr_thread *thread
+) {
+	return thread->hosted_count > 0;
+}
+
 static inline int rrr_thread_signal_check (
 		struct rrr_thread *thread,
 		uint32_t signal
@@ -284,6 +300,25 @@ struct rrr_thread *rrr_thread_collection_thread_create_and_preload (
 		uint64_t watchdog_timeout_us,
 		void *private_data
 );
+struct rrr_thread *rrr_thread_collection_thread_create_hosted_and_preload (
+		struct rrr_thread_collection *collection,
+		struct rrr_thread *host,
+		void *(*start_routine) (struct rrr_thread *),
+		int (*preload_routine) (struct rrr_thread *),
+		const char *name,
+		void *private_data
+);
+int rrr_thread_host_start_condition_helper (
+		struct rrr_thread *host
+);
+int rrr_thread_host_run_next_void (
+		void *arg
+);
+void rrr_thread_host_run (
+		struct rrr_thread *host,
+		int (*dispatch)(void *arg),
+		void *dispatch_arg
+);
 int rrr_thread_collection_start_all (
 		struct rrr_thread_collection *collection
 );
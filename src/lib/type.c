@@ -37,6 +37,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "util/macro_utils.h"
 #include "util/gnu.h"
 #include "util/hex.h"
+#include "util/rrr_str.h"
 #include "parse.h"
 #include "hdlc/hdlc.h"
 
@@ -715,13 +716,7 @@ static int __rrr_type_64_unpack (RRR_TYPE_UNPACK_ARGS, uint8_t target_type) {
 		return 1;
 	}
 
-	rrr_length array_size = node->total_stored_length / sizeof(rrr_type_be);
-	const char *pos = node->data;
-	for (unsigned int i = 0; i < array_size; i++) {
-		rrr_type_be tmp = *((rrr_type_be *) pos);
-		*((rrr_type_be *) pos) = rrr_be64toh(tmp);
-		pos += sizeof(rrr_type_be);
-	}
+	rrr_be64toh_array(node->data, node->data, node->total_stored_length / sizeof(rrr_type_be));
 
 	node->definition = rrr_type_get_from_id(target_type);
 
@@ -742,14 +737,7 @@ static int __rrr_type_64_export_or_pack (RRR_TYPE_EXPORT_ARGS) {
 		return 1;
 	}
 
-	rrr_length array_size = node->total_stored_length / sizeof(rrr_type_be);
-	rrr_length pos = 0;
-	for (unsigned int i = 0; i < array_size; i++) {
-		const char *rpos = node->data + pos;
-		char *wpos = target + pos;
-		*((rrr_type_be *) wpos) = rrr_htobe64(*((rrr_type_be *) rpos));
-		pos += (rrr_length) sizeof(rrr_type_be);
-	}
+	rrr_htobe64_array(target, node->data, node->total_stored_length / sizeof(rrr_type_be));
 
 	*written_bytes = node->total_stored_length;
 
@@ -1212,7 +1200,12 @@ static int __rrr_type_hdlc_export (RRR_TYPE_EXPORT_ARGS) {
 static int __rrr_type_h_to_str (RRR_TYPE_TO_STR_ARGS) {
 	int ret = 0;
 
-	rrr_length output_size = node->total_stored_length * 4;
+	// Each value is at most 20 characters plus separator or \0
+	rrr_biglength output_size = (node->total_stored_length / sizeof(rrr_type_be)) * (RRR_STR_64_MAX + 1);
+
+	if (output_size == 0) {
+		output_size = 1;
+	}
 
 	char *result = rrr_allocate(output_size);
 	if (result == NULL) {
@@ -1222,17 +1215,21 @@ static int __rrr_type_h_to_str (RRR_TYPE_TO_STR_ARGS) {
 
 	char *wpos = result;
 	for (rrr_length i = 0; i < node->total_stored_length; i += (rrr_length) sizeof(rrr_type_be)) {
+		if (i > 0) {
+			*(wpos++) = ',';
+		}
 		if (RRR_TYPE_FLAG_IS_SIGNED(node->flags)) {
-			int64_t tmp = *((int64_t *) (node->data + i));
-			sprintf(wpos, "%s%" PRIi64, (i > 0 ? "," : ""), tmp);
+			int64_t tmp;
+			memcpy(&tmp, node->data + i, sizeof(tmp));
+			wpos += rrr_str_i64_to_dec(wpos, tmp);
 		}
 		else {
-			uint64_t tmp = *((uint64_t *) (node->data + i));
-			sprintf(wpos, "%s%" PRIu64, (i > 0 ? "," : ""), tmp);
+			uint64_t tmp;
+			memcpy(&tmp, node->data + i, sizeof(tmp));
+			wpos += rrr_str_u64_to_dec(wpos, tmp);
 		}
-		wpos = result + strlen(result);
 	}
-	result[output_size - 1] = '\0';
+	*wpos = '\0';
 
 	*target = result;
 
@@ -1246,12 +1243,29 @@ static int __rrr_type_fixp_to_str (RRR_TYPE_TO_STR_ARGS) {
 		RRR_BUG("BUG: Length was 0 in %s\n", __func__);
 	}
 
-	if (rrr_fixp_to_new_str_double (target, *((rrr_fixp *) (node->data))) != 0) {
-		RRR_MSG_0("Could not convert fixp in %s\n", __func__);
+	// Each value is at most RRR_FIXED_POINT_DEC_MAX characters plus separator or \0
+	const rrr_biglength output_size = (node->total_stored_length / sizeof(rrr_fixp)) * (RRR_FIXED_POINT_DEC_MAX + 1);
+
+	char *result = rrr_allocate(output_size);
+	if (result == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
 		ret = 1;
 		goto out;
 	}
 
+	char *wpos = result;
+	for (rrr_length i = 0; i < node->total_stored_length; i += (rrr_length) sizeof(rrr_fixp)) {
+		if (i > 0) {
+			*(wpos++) = ',';
+		}
+		rrr_fixp tmp;
+		memcpy(&tmp, node->data + i, sizeof(tmp));
+		wpos += rrr_fixp_to_dec(wpos, tmp);
+	}
+	*wpos = '\0';
+
+	*target = result;
+
 	out:
 	return ret;
 }
@@ -31,6 +31,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "allocator.h"
 #include "util/macro_utils.h"
 #include "util/hex.h"
+#include "util/rrr_str.h"
+#include "fixed_point.h"
 
 #define RRR_TYPE_CONVERT_ARGS \
 		struct rrr_type_value **target, const struct rrr_type_value *source, const int flags
@@ -86,6 +88,10 @@ static int __rrr_type_convert_clone_set_new_definition_no_data (
     (void)(flags);                                                                                                 \
     do {if (!RRR_TYPE_IS_64(source->definition->type)) { return RRR_TYPE_CONVERSION_NOT_POSSIBLE; }} while (0)
 
+#define TYPE_FIXP_ENSURE()                                                                                         \
+    (void)(flags);                                                                                                 \
+    do {if (!RRR_TYPE_IS_FIXP(source->definition->type)) { return RRR_TYPE_CONVERSION_NOT_POSSIBLE; }} while (0)
+
 #define TYPE_BLOB_ENSURE()                                                                                         \
     do {if (((flags & RRR_TYPE_CONVERT_F_STRICT_BLOBS) && !RRR_TYPE_IS_BLOB_EXCACT(source->definition->type)) ||   \
         !RRR_TYPE_IS_BLOB(source->definition->type)) { return RRR_TYPE_CONVERSION_NOT_POSSIBLE; }} while (0)
@@ -102,9 +108,36 @@ static int __rrr_type_convert_clone_set_new_definition_no_data (
     (void)(flags);                                                                                                 \
     do {if (!RRR_TYPE_IS_VAIN(source->definition->type)) { return RRR_TYPE_CONVERSION_NOT_POSSIBLE; }} while (0)
 
-static int __rrr_type_convert_h2str (RRR_TYPE_CONVERT_ARGS) {
-	 TYPE_H_ENSURE();
+static int __rrr_type_convert_h_element_to_dec (char *target, const char *source, rrr_type_flags flags) {
+	if (RRR_TYPE_FLAG_IS_SIGNED(flags)) {
+		int64_t tmp;
+		memcpy(&tmp, source, sizeof(tmp));
+		return rrr_str_i64_to_dec(target, tmp);
+	}
+
+	uint64_t tmp;
+	memcpy(&tmp, source, sizeof(tmp));
+	return rrr_str_u64_to_dec(target, tmp);
+}
+
+static int __rrr_type_convert_fixp_element_to_dec (char *target, const char *source, rrr_type_flags flags) {
+	(void)(flags);
+
+	rrr_fixp tmp;
+	memcpy(&tmp, source, sizeof(tmp));
+	return rrr_fixp_to_dec(target, tmp);
+}
 
+// Converts all 64-bit elements of a value in one pass. When there are multiple
+// elements, each number is right justified in a slot of fixed size with space
+// prefix to make them equal length.
+static int __rrr_type_convert_64_to_str (
+		struct rrr_type_value **target,
+		const struct rrr_type_value *source,
+		size_t slot_length,
+		int (*to_str)(char **target, const struct rrr_type_value *node),
+		int (*element_to_dec)(char *target, const char *source, rrr_type_flags flags)
+) {
 	int ret = 0;
 
 	char *buf = NULL;
@@ -119,25 +152,16 @@ static int __rrr_type_convert_h2str (RRR_TYPE_CONVERT_ARGS) {
 	rrr_biglength new_size = 0;
 
 	if (source->element_count == 1) {
-		if ((ret = rrr_type_definition_h.to_str(&buf, source)) != 0) {
+		if ((ret = to_str(&buf, source)) != 0) {
 			goto out;
 		}
 		new_size = strlen(buf);
 	}
 	else {
-		// Maximum output is 20 characters
-		// 2^63 =  9,223,372,036,854,775,808
-		// 2^64 = 18,446,744,073,709,551,616
-
-		// We use a custom to string function as we have to prefix
-		// pad numbers with spaces to make them equal length when there
-		// are more than one element
-
-		const size_t max_out_length = 20;
-		new_size = max_out_length * source->element_count;
+		new_size = slot_length * source->element_count;
 
 		if (new_size > RRR_LENGTH_MAX) {
-			RRR_MSG_0("Can't convert h2str, resulting string data would exceed maximum size (%" PRIrrrbl ">%" PRIrrrl ")\n",
+			RRR_MSG_0("Can't convert to str, resulting string data would exceed maximum size (%" PRIrrrbl ">%" PRIrrrl ")\n",
 					new_size, RRR_LENGTH_MAX);
 			ret = RRR_TYPE_CONVERSION_SOFT_ERROR;
 			goto out;
@@ -149,32 +173,16 @@ static int __rrr_type_convert_h2str (RRR_TYPE_CONVERT_ARGS) {
 			goto out;
 		}
 
-		memset (buf, ' ', (size_t) new_size); // Set whole buffer to spaces
+		char tmp[RRR_STR_64_MAX > RRR_FIXED_POINT_DEC_MAX ? RRR_STR_64_MAX : RRR_FIXED_POINT_DEC_MAX];
 
 		for (size_t i = 0; i < source->element_count; i++) {
-			const rrr_biglength rpos = i * sizeof(uint64_t);
-			const rrr_biglength wpos = max_out_length * i;
-
-			char tmp[max_out_length + 1];
-
-			const int number_length = (
-					RRR_TYPE_FLAG_IS_SIGNED(source->flags)
-					// Add parentheses around pointer addition to avoid compiler converting
-					// it to array subscripting (multiplying rpos with 8)
-					? snprintf(tmp, sizeof(tmp), "%" PRIi64, *((int64_t *) (source->data + rpos)))
-					: snprintf(tmp, sizeof(tmp), "%" PRIu64, *((uint64_t *) (source->data + rpos)))
-			);
-
-			if (number_length <= 0) {
-				RRR_MSG_0("Error from snprintf in %s\n", __func__);
-				ret = RRR_TYPE_CONVERSION_HARD_ERROR;
-				goto out;
-			}
+			const int number_length = element_to_dec(tmp, source->data + i * sizeof(uint64_t), source->flags);
 
 			// Write right justified in the slot
-			const rrr_biglength wpos_with_offset = wpos + max_out_length - (rrr_biglength) number_length;
-
-			memcpy(buf + wpos_with_offset, tmp, (size_t) number_length);
+			char *wpos = buf + slot_length * i;
+			const size_t pad_length = slot_length - (size_t) number_length;
+			memset(wpos, ' ', pad_length);
+			memcpy(wpos + pad_length, tmp, (size_t) number_length);
 		}
 	}
 
@@ -200,6 +208,34 @@ static int __rrr_type_convert_h2str (RRR_TYPE_CONVERT_ARGS) {
 	return ret;
 }
 
+static int __rrr_type_convert_h2str (RRR_TYPE_CONVERT_ARGS) {
+	TYPE_H_ENSURE();
+
+	// Maximum output is 20 characters
+	// 2^63 =  9,223,372,036,854,775,808
+	// 2^64 = 18,446,744,073,709,551,616
+
+	return __rrr_type_convert_64_to_str (
+			target,
+			source,
+			RRR_STR_64_MAX,
+			rrr_type_definition_h.to_str,
+			__rrr_type_convert_h_element_to_dec
+	);
+}
+
+static int __rrr_type_convert_fixp2str (RRR_TYPE_CONVERT_ARGS) {
+	TYPE_FIXP_ENSURE();
+
+	return __rrr_type_convert_64_to_str (
+			target,
+			source,
+			RRR_FIXED_POINT_DEC_MAX,
+			rrr_type_definition_fixp.to_str,
+			__rrr_type_convert_fixp_element_to_dec
+	);
+}
+
 static int __rrr_type_convert_h2vain (RRR_TYPE_CONVERT_ARGS) {
 	TYPE_H_ENSURE();
 	int ret = 0;
@@ -543,7 +579,8 @@ enum rrr_type_conversion {
 	RRR_TYPE_CONVERSION_MSG2BLOB,
 	RRR_TYPE_CONVERSION_VAIN2H,
 	RRR_TYPE_CONVERSION_VAIN2STR,
-	RRR_TYPE_CONVERSION_HCHAR2STR
+	RRR_TYPE_CONVERSION_HCHAR2STR,
+	RRR_TYPE_CONVERSION_FIXP2STR
 };
 
 RRR_TYPE_CONVERSION_DEFINE(h2str,H,STR);
@@ -559,6 +596,7 @@ RRR_TYPE_CONVERSION_DEFINE(vain2h,VAIN,H);
 RRR_TYPE_CONVERSION_DEFINE(vain2str,VAIN,STR);
 RRR_TYPE_CONVERSION_DEFINE(msg2blob,MSG,BLOB);
 RRR_TYPE_CONVERSION_DEFINE_SPECIAL(hchar2str,H,STR);
+RRR_TYPE_CONVERSION_DEFINE(fixp2str,FIXP,STR);
 
 static const struct rrr_type_conversion_definition *rrr_type_conversions[] = {
 		&rrr_type_conversion_h2str,
@@ -573,7 +611,8 @@ static const struct rrr_type_conversion_definition *rrr_type_conversions[] = {
 		&rrr_type_conversion_msg2blob,
 		&rrr_type_conversion_vain2h,
 		&rrr_type_conversion_vain2str,
-		&rrr_type_conversion_hchar2str
+		&rrr_type_conversion_hchar2str,
+		&rrr_type_conversion_fixp2str
 };
 
 static const struct rrr_type_conversion_definition *__rrr_type_convert_definition_get_from_str (
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <netdb.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -44,9 +45,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../ip/ip_util.h"
 
 // Configuration
-#define RRR_UDPSTREAM_VERSION 3
+#define RRR_UDPSTREAM_VERSION 4
 #define RRR_UDPSTREAM_VERSION_MINIMUM 2
 
+// From this version, ACK frames may contain additional ACK ranges in the payload
+#define RRR_UDPSTREAM_VERSION_SACK 4
+
+// From this version, senders reduce their rate upon loss themselves and receivers
+// no longer need to reduce the window size when there are holes in the buffer
+#define RRR_UDPSTREAM_VERSION_CONGESTION_CONTROL 4
+
 #define RRR_UDPSTREAM_BURST_LIMIT_RECEIVE 50
 #define RRR_UDPSTREAM_BURST_LIMIT_SEND 100
 
@@ -60,7 +68,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_UDPSTREAM_CONNECTION_TIMEOUT_MS 240000
 #define RRR_UDPSTREAM_CONNECTION_INVALID_TIMEOUT_MS (RRR_UDPSTREAM_CONNECTION_TIMEOUT_MS*2)
 
-#define RRR_UDPSTREAM_RESEND_UNACKNOWLEDGED_LIMIT 5
+#define RRR_UDPSTREAM_RESEND_UNACKNOWLEDGED_LIMIT 3
+
+#define RRR_UDPSTREAM_RTO_MIN_MS 100
+#define RRR_UDPSTREAM_RTO_MAX_MS 8000
+
+#define RRR_UDPSTREAM_SACK_RANGES_MAX 64
+
+#define RRR_UDPSTREAM_SEND_INTERVAL_MS 10
+
+#define RRR_UDPSTREAM_CONGESTION_WINDOW_INITIAL 32
+#define RRR_UDPSTREAM_CONGESTION_WINDOW_MIN 4
+#define RRR_UDPSTREAM_CUBIC_C 0.4
+#define RRR_UDPSTREAM_CUBIC_BETA 0.7
+
+#define RRR_UDPSTREAM_PACING_GAIN 1.25
 
 #define RRR_UDPSTREAM_EVENT_READ_TIMEOUT_MS_SHORT 10
 #define RRR_UDPSTREAM_EVENT_READ_TIMEOUT_MS_LONG 50
@@ -147,11 +169,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // which are currently not delivered to the application. A single data frame may therefore
 // be "mentioned" in multiple ACK frames.
 
+// When the remote supports it, a single ACK frame carries multiple ranges (selective ACK).
+// The first range is in the header as usual while any further ranges are stored as pairs
+// of 32 bit frame IDs in the payload. Older versions ignore the payload.
+
 // Each time a sender receives an ACK frame,
-// it increments the "unacknowledged counter" for frames which was not mentioned in the ACK.
-// If this counter reached a specific limit, the frame is re-sent. The way a client sends
-// ACK packets will therefore ensure that frames which are missing out (holes in the stream)
-// is re-sent.
+// it increments the "unacknowledged counter" for frames which was not mentioned in the ACK
+// while frames with higher IDs were. If this counter reached a specific limit, the frame is
+// re-sent. The way a client sends ACK packets will therefore ensure that frames which are
+// missing out (holes in the stream) is re-sent. Frames which are not acknowledged at all are
+// re-sent after the retransmission timeout which is derived from the measured round trip time.
+
+// The number of frames in flight is limited by the smaller of the window size regulated by
+// the receiver and the congestion window of the sender. The congestion window is controlled
+// CUBIC style, it is reduced when frames are lost and grows again as a function of the time
+// passed since the reduction. Frames are paced out according to the congestion window and
+// the round trip time.
 
 // If there are missing frames and holes in the receive buffer, a client will request the
 // window size to be reduced slightly. If there are no holes, the window size is carefully
@@ -184,9 +217,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_UDPSTREAM_FRAME_IS_RESET(frame) \
 	((RRR_UDPSTREAM_FRAME_TYPE(frame) == RRR_UDPSTREAM_FRAME_TYPE_RESET) != 0)
 
-// Forget to send a certain percentage of outbound packets (randomized). Comment out to disable.
-//#define RRR_UDPSTREAM_PACKET_LOSS_DEBUG_PERCENT 10
-
 static int __rrr_udpstream_frame_destroy(struct rrr_udpstream_frame *frame) {
 	RRR_FREE_IF_NOT_NULL(frame->data);
 	RRR_FREE_IF_NOT_NULL(frame->source_addr);
@@ -316,6 +346,9 @@ static int __rrr_udpstream_stream_new(struct rrr_udpstream_stream **target) {
 	res->last_seen = rrr_time_get_64();
 	res->window_size_to_remote = RRR_UDPSTREAM_WINDOW_SIZE_INITIAL;
 	res->window_size_from_remote = RRR_UDPSTREAM_WINDOW_SIZE_INITIAL;
+	res->rto = RRR_UDPSTREAM_RESEND_INTERVAL_FRAME_MS * 1000;
+	res->congestion_window = RRR_UDPSTREAM_CONGESTION_WINDOW_INITIAL;
+	res->congestion_ssthresh = RRR_UDPSTREAM_WINDOW_SIZE_MAX;
 
 	*target = res;
 
@@ -337,6 +370,13 @@ void rrr_udpstream_set_flags (
 	data->flags = flags;
 }
 
+void rrr_udpstream_set_loss_simulation (
+		struct rrr_udpstream *data,
+		unsigned int percent
+) {
+	data->loss_simulation_percent = percent;
+}
+
 static void __rrr_udpstream_frame_packed_dump (
 		const struct rrr_udpstream_frame_packed *frame
 ) {
@@ -441,12 +481,12 @@ static int __rrr_udpstream_checksum_and_send_packed_frame (
 	}
 
 	while (copies--) {
-#ifdef RRR_UDPSTREAM_PACKET_LOSS_DEBUG_PERCENT
-		if (rand() % 100 <= RRR_UDPSTREAM_PACKET_LOSS_DEBUG_PERCENT) {
+		if ( udpstream_data->loss_simulation_percent > 0 &&
+		     (unsigned int) (rrr_rand() % 100) < udpstream_data->loss_simulation_percent
+		) {
 			RRR_DBG_3("UDP-stream TX forgot to send packet :-(\n");
 			continue;
 		}
-#endif
 
 		rrr_length send_chunk_count_dummy = 0;
 		if ((ret = rrr_socket_client_collection_sendto_push_const (
@@ -529,13 +569,25 @@ static int __rrr_udpstream_send_frame_ack (
 		uint16_t stream_id,
 		uint32_t ack_id_first,
 		uint32_t ack_id_last,
+		const struct rrr_udpstream_ack_data *sack_ranges,
+		uint16_t sack_range_count,
 		uint32_t window_size,
 		int copies
 ) {
 	struct rrr_udpstream_frame_packed frame = {0};
+	struct rrr_udpstream_ack_data sack_ranges_packed[RRR_UDPSTREAM_SACK_RANGES_MAX];
+
+	RRR_DBG_3("UDP-stream TX ACK %u-%u-%u SACK ranges %u count %i\n",
+			stream_id, ack_id_first, ack_id_last, sack_range_count, copies);
 
-	RRR_DBG_3("UDP-stream TX ACK %u-%u-%u count %i\n",
-			stream_id, ack_id_first, ack_id_last, copies);
+	if (sack_range_count > RRR_UDPSTREAM_SACK_RANGES_MAX) {
+		RRR_BUG("BUG: Too many SACK ranges in __rrr_udpstream_send_frame_ack\n");
+	}
+
+	for (uint16_t i = 0; i < sack_range_count; i++) {
+		sack_ranges_packed[i].ack_id_first = rrr_htobe32(sack_ranges[i].ack_id_first);
+		sack_ranges_packed[i].ack_id_last = rrr_htobe32(sack_ranges[i].ack_id_last);
+	}
 
 	frame.flags_and_type = RRR_UDPSTREAM_FRAME_TYPE_FRAME_ACK;
 	frame.stream_id = rrr_htobe16(stream_id);
@@ -547,7 +599,15 @@ static int __rrr_udpstream_send_frame_ack (
 		frame.window_size = rrr_htobe32(window_size);
 	}
 
-	return __rrr_udpstream_checksum_and_send_packed_frame(data, addr, socklen, &frame, NULL, 0, copies);
+	return __rrr_udpstream_checksum_and_send_packed_frame (
+			data,
+			addr,
+			socklen,
+			&frame,
+			sack_range_count > 0 ? sack_ranges_packed : NULL,
+			(uint16_t) (sack_range_count * sizeof(*sack_ranges_packed)),
+			copies
+	);
 }
 
 static int __rrr_udpstream_send_reset (
@@ -631,6 +691,7 @@ static int __rrr_udpstream_send_and_update_frame (
 		goto out;
 	}
 	frame->unacknowledged_count = 0;
+	frame->send_count++;
 	frame->last_send_time = rrr_time_get_64();
 
 	out:
@@ -1032,6 +1093,152 @@ static int __rrr_udpstream_handle_received_connect (
 	return ret;
 }
 
+static void __rrr_udpstream_rtt_update (
+		struct rrr_udpstream_stream *stream,
+		uint64_t sample
+) {
+	if (sample == 0) {
+		sample = 1;
+	}
+
+	// Estimation as described in RFC 6298
+	if (stream->rtt_smoothed == 0) {
+		stream->rtt_smoothed = sample;
+		stream->rtt_variance = sample / 2;
+	}
+	else {
+		const uint64_t diff = stream->rtt_smoothed > sample
+			? stream->rtt_smoothed - sample
+			: sample - stream->rtt_smoothed;
+		stream->rtt_variance = (stream->rtt_variance * 3 + diff) / 4;
+		stream->rtt_smoothed = (stream->rtt_smoothed * 7 + sample) / 8;
+	}
+
+	// The send loop runs at a fixed interval which is the granularity of our timer
+	uint64_t rto_variance = stream->rtt_variance * 4;
+	if (rto_variance < RRR_UDPSTREAM_SEND_INTERVAL_MS * 1000) {
+		rto_variance = RRR_UDPSTREAM_SEND_INTERVAL_MS * 1000;
+	}
+
+	uint64_t rto = stream->rtt_smoothed + rto_variance;
+
+	if (rto < RRR_UDPSTREAM_RTO_MIN_MS * 1000) {
+		rto = RRR_UDPSTREAM_RTO_MIN_MS * 1000;
+	}
+	if (rto > RRR_UDPSTREAM_RTO_MAX_MS * 1000) {
+		rto = RRR_UDPSTREAM_RTO_MAX_MS * 1000;
+	}
+
+	stream->rto = rto;
+}
+
+static void __rrr_udpstream_congestion_on_ack (
+		struct rrr_udpstream_stream *stream,
+		uint32_t acked_count,
+		uint64_t time_now
+) {
+	if (stream->congestion_window < stream->congestion_ssthresh) {
+		// Slow start
+		stream->congestion_window += acked_count;
+		goto out;
+	}
+
+	if (stream->congestion_epoch_start == 0) {
+		stream->congestion_epoch_start = time_now;
+		stream->congestion_ack_count = 0;
+		stream->congestion_reno_window = stream->congestion_window;
+		if (stream->congestion_window < stream->congestion_window_max) {
+			stream->congestion_epoch_k = cbrt((stream->congestion_window_max - stream->congestion_window) / RRR_UDPSTREAM_CUBIC_C);
+			stream->congestion_epoch_origin = stream->congestion_window_max;
+		}
+		else {
+			stream->congestion_epoch_k = 0;
+			stream->congestion_epoch_origin = stream->congestion_window;
+		}
+	}
+
+	const double t = (double) (time_now - stream->congestion_epoch_start + stream->rtt_smoothed) / 1000000.0 - stream->congestion_epoch_k;
+	const double window_cubic = stream->congestion_epoch_origin + RRR_UDPSTREAM_CUBIC_C * t * t * t;
+
+	// Grow at least as fast as a Reno window would (TCP friendly region)
+	stream->congestion_reno_window += (3.0 * (1.0 - RRR_UDPSTREAM_CUBIC_BETA) / (1.0 + RRR_UDPSTREAM_CUBIC_BETA)) *
+		acked_count / stream->congestion_window;
+
+	const double window_target = window_cubic > stream->congestion_reno_window
+		? window_cubic
+		: stream->congestion_reno_window;
+
+	if (window_target > stream->congestion_window) {
+		// Number of ACKed frames needed per window increment, never grow
+		// faster than by half the window per round trip
+		double count = stream->congestion_window / (window_target - stream->congestion_window);
+		if (count < 2.0) {
+			count = 2.0;
+		}
+
+		stream->congestion_ack_count += acked_count;
+		if (stream->congestion_ack_count >= count) {
+			stream->congestion_window += (uint32_t) (stream->congestion_ack_count / count);
+			stream->congestion_ack_count = 0;
+		}
+	}
+
+	out:
+	if (stream->congestion_window > RRR_UDPSTREAM_WINDOW_SIZE_MAX) {
+		stream->congestion_window = RRR_UDPSTREAM_WINDOW_SIZE_MAX;
+	}
+}
+
+static void __rrr_udpstream_congestion_on_loss (
+		struct rrr_udpstream_stream *stream,
+		uint32_t frame_id,
+		int is_timeout
+) {
+	// Only reduce the window once for frames sent before the previous reduction
+	if (frame_id <= stream->congestion_recovery_frame_id) {
+		return;
+	}
+
+	stream->congestion_recovery_frame_id = stream->send_buffer.frame_id_counter;
+
+	// Fast convergence, release bandwidth to other flows if the window
+	// did not reach the previous maximum
+	if (stream->congestion_window < stream->congestion_window_max) {
+		stream->congestion_window_max = (uint32_t) (stream->congestion_window * (1.0 + RRR_UDPSTREAM_CUBIC_BETA) / 2.0);
+	}
+	else {
+		stream->congestion_window_max = stream->congestion_window;
+	}
+
+	stream->congestion_window = (uint32_t) (stream->congestion_window * RRR_UDPSTREAM_CUBIC_BETA);
+	if (stream->congestion_window < RRR_UDPSTREAM_CONGESTION_WINDOW_MIN) {
+		stream->congestion_window = RRR_UDPSTREAM_CONGESTION_WINDOW_MIN;
+	}
+
+	stream->congestion_ssthresh = stream->congestion_window;
+	stream->congestion_epoch_start = 0;
+
+	if (is_timeout) {
+		stream->congestion_window = RRR_UDPSTREAM_CONGESTION_WINDOW_MIN;
+	}
+
+	RRR_DBG_3("UDP-stream %u frame %u lost (%s), congestion window is now %" PRIu32 " ssthresh %" PRIu32 "\n",
+			stream->stream_id, frame_id, is_timeout ? "timeout" : "fast", stream->congestion_window, stream->congestion_ssthresh);
+}
+
+static int __rrr_udpstream_ack_ranges_contain (
+		const struct rrr_udpstream_ack_data *ranges,
+		uint16_t range_count,
+		uint32_t frame_id
+) {
+	for (uint16_t i = 0; i < range_count; i++) {
+		if (frame_id >= ranges[i].ack_id_first && frame_id <= ranges[i].ack_id_last) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
 static int __rrr_udpstream_handle_received_frame_ack (
 		struct rrr_udpstream *data,
 		struct rrr_udpstream_stream *stream,
@@ -1039,8 +1246,32 @@ static int __rrr_udpstream_handle_received_frame_ack (
 ) {
 	int ret = 0;
 
+	struct rrr_udpstream_ack_data ranges[1 + RRR_UDPSTREAM_SACK_RANGES_MAX];
+	uint16_t range_count = 0;
+	uint32_t ack_id_max = 0;
+
+	const uint64_t time_now = rrr_time_get_64();
+	uint32_t acked_count = 0;
+	uint64_t rtt_sample = 0;
+
 	int64_t nag_id = -1;
 
+	ranges[range_count++] = new_frame->ack_data;
+
+	for (uint16_t pos = 0; pos + sizeof(*ranges) <= new_frame->data_size && range_count < 1 + RRR_UDPSTREAM_SACK_RANGES_MAX; pos += sizeof(*ranges)) {
+		struct rrr_udpstream_ack_data range;
+		memcpy(&range, new_frame->data + pos, sizeof(range));
+		ranges[range_count].ack_id_first = rrr_be32toh(range.ack_id_first);
+		ranges[range_count].ack_id_last = rrr_be32toh(range.ack_id_last);
+		range_count++;
+	}
+
+	for (uint16_t i = 0; i < range_count; i++) {
+		if (ranges[i].ack_id_last > ack_id_max) {
+			ack_id_max = ranges[i].ack_id_last;
+		}
+	}
+
 	if (new_frame->ack_data.ack_id_first == new_frame->ack_data.ack_id_last) {
 		if (new_frame->ack_data.ack_id_last == stream->last_ack_id) {
 			nag_id = stream->last_ack_id;
@@ -1050,15 +1281,23 @@ static int __rrr_udpstream_handle_received_frame_ack (
 		}
 	}
 
-	RRR_DBG_3("UDP-stream RX ACK %u-%u-%u%s\n",
+	RRR_DBG_3("UDP-stream RX ACK %u-%u-%u SACK ranges %u%s\n",
 			new_frame->stream_id,
 			new_frame->ack_data.ack_id_first,
 			new_frame->ack_data.ack_id_last,
+			range_count - 1,
 			nag_id > 0 ? " (nagging)" : ""
 	);
 
 	RRR_LL_ITERATE_BEGIN(&stream->send_buffer, struct rrr_udpstream_frame);
-		if (node->frame_id >= new_frame->ack_data.ack_id_first && node->frame_id <= new_frame->ack_data.ack_id_last) {
+		if (__rrr_udpstream_ack_ranges_contain(ranges, range_count, node->frame_id)) {
+			// Only frames sent exactly once give unambiguous samples (Karn's algorithm)
+			if (node->send_count == 1 && node->last_send_time != 0) {
+				rtt_sample = time_now - node->last_send_time;
+			}
+			if (node->last_send_time != 0) {
+				acked_count++;
+			}
 			RRR_LL_ITERATE_SET_DESTROY();
 		}
 		else if (node->frame_id == nag_id + 1) {
@@ -1067,11 +1306,20 @@ static int __rrr_udpstream_handle_received_frame_ack (
 				goto out;
 			}
 		}
-		else {
+		else if (node->frame_id < ack_id_max) {
+			// Frames after this one has been received
 			node->unacknowledged_count++;
 		}
 	RRR_LL_ITERATE_END_CHECK_DESTROY(&stream->send_buffer, __rrr_udpstream_frame_destroy(node));
 
+	if (rtt_sample > 0) {
+		__rrr_udpstream_rtt_update(stream, rtt_sample);
+	}
+
+	if (acked_count > 0) {
+		__rrr_udpstream_congestion_on_ack(stream, acked_count, time_now);
+	}
+
 	out:
 	return ret;
 }
@@ -1210,6 +1458,7 @@ static int __rrr_udpstream_handle_received_frame (
 	}
 
 	stream->last_seen = rrr_time_get_64();
+	stream->remote_version = new_frame->version;
 
 	if (RRR_UDPSTREAM_FRAME_HAS_WINDOW_SIZE(frame)) {
 		stream->window_size_from_remote = new_frame->window_size;
@@ -1376,6 +1625,71 @@ struct ack_list {
 	RRR_LL_HEAD(struct ack_list_node);
 };
 
+// Send all ranges in the ACK list using as few frames as possible
+static int __rrr_udpstream_send_ack_list_sack (
+		struct rrr_udpstream *data,
+		struct rrr_udpstream_stream *stream,
+		struct ack_list *ack_list,
+		int window_size_adjust
+) {
+	int ret = 0;
+
+	struct rrr_udpstream_ack_data sack_ranges[RRR_UDPSTREAM_SACK_RANGES_MAX];
+	uint16_t sack_range_count = 0;
+	const struct ack_list_node *first = NULL;
+
+	if (RRR_LL_COUNT(ack_list) == 0) {
+		goto out;
+	}
+
+	__rrr_udpstream_regulate_window_size(stream, window_size_adjust);
+
+	RRR_LL_ITERATE_BEGIN(ack_list, struct ack_list_node);
+		if (first == NULL) {
+			first = node;
+		}
+		else {
+			sack_ranges[sack_range_count].ack_id_first = node->frame_id_from;
+			sack_ranges[sack_range_count].ack_id_last = node->frame_id_to;
+			sack_range_count++;
+		}
+
+		if (sack_range_count < RRR_UDPSTREAM_SACK_RANGES_MAX && RRR_LL_LAST(ack_list) != node) {
+			RRR_LL_ITERATE_NEXT();
+		}
+
+		const struct sockaddr *use_addr = stream->remote_addr;
+		socklen_t use_sockaddr_len = stream->remote_addr_len;
+
+		if (use_addr == NULL) {
+			use_addr = first->last_frame->source_addr;
+			use_sockaddr_len = first->last_frame->source_addr_len;
+		}
+
+		if ((ret = __rrr_udpstream_send_frame_ack (
+				data,
+				use_addr,
+				use_sockaddr_len,
+				stream->stream_id,
+				first->frame_id_from,
+				first->frame_id_to,
+				sack_ranges,
+				sack_range_count,
+				(window_size_adjust != 0 ? stream->window_size_to_remote : 0),
+				1
+		)) != 0) {
+			RRR_MSG_0("Error while sending UDP-stream ACK in __rrr_udpstream_send_ack_list_sack\n");
+			goto out;
+		}
+
+		first = NULL;
+		sack_range_count = 0;
+	RRR_LL_ITERATE_END();
+
+	out:
+	return ret;
+}
+
 struct rrr_udpstream_process_receive_buffer_callback_data {
 	struct rrr_udpstream *data;
 	struct rrr_udpstream_stream *stream;
@@ -1538,7 +1852,9 @@ static int __rrr_udpstream_process_receive_buffer (
 				RRR_DBG_3("UDP-stream TX ACK %u-%u-%u (%u is first after hole A)\n",
 						stream->stream_id, ack_id_from_tmp, ack_id_to_tmp, node->frame_id);
 
-				window_size_adjust -= 2;
+				if (stream->remote_version < RRR_UDPSTREAM_VERSION_CONGESTION_CONTROL) {
+					window_size_adjust -= 2;
+				}
 
 				goto add_ack;
 			}
@@ -1556,7 +1872,9 @@ static int __rrr_udpstream_process_receive_buffer (
 
 			first_ack_id = node->frame_id;
 
-			window_size_adjust -= 2;
+			if (stream->remote_version < RRR_UDPSTREAM_VERSION_CONGESTION_CONTROL) {
+				window_size_adjust -= 2;
+			}
 
 			goto add_ack;
 		}
@@ -1597,6 +1915,18 @@ static int __rrr_udpstream_process_receive_buffer (
 	/*
 	 * Send ACKs pushed to list in previous loop
 	 */
+	if (stream->remote_version >= RRR_UDPSTREAM_VERSION_SACK) {
+		if ((ret = __rrr_udpstream_send_ack_list_sack (
+				data,
+				stream,
+				&ack_list,
+				window_size_adjust
+		)) != 0) {
+			goto out;
+		}
+		goto deliver_again;
+	}
+
 	RRR_LL_ITERATE_BEGIN(&ack_list, struct ack_list_node);
 		const struct sockaddr *use_addr = stream->remote_addr;
 		socklen_t use_sockaddr_len = stream->remote_addr_len;
@@ -1617,6 +1947,8 @@ static int __rrr_udpstream_process_receive_buffer (
 				stream->stream_id,
 				node->frame_id_from,
 				node->frame_id_to,
+				NULL,
+				0,
 				(window_size_adjust != 0 ? stream->window_size_to_remote : 0),
 				1
 		) != 0) {
@@ -1783,6 +2115,34 @@ static int __rrr_udpstream_maintain (
 	return ret;
 }
 
+static void __rrr_udpstream_pacing_refill (
+		struct rrr_udpstream_stream *stream,
+		uint64_t time_now
+) {
+	if (stream->rtt_smoothed == 0) {
+		// No round trip time measured yet, only the burst limit applies
+		stream->pacing_tokens = RRR_UDPSTREAM_BURST_LIMIT_SEND;
+		goto out;
+	}
+
+	// Frames per microsecond
+	const double rate = RRR_UDPSTREAM_PACING_GAIN * stream->congestion_window / stream->rtt_smoothed;
+
+	// Allow at most one send interval worth of frames to be sent at once
+	double tokens_max = rate * RRR_UDPSTREAM_SEND_INTERVAL_MS * 1000;
+	if (tokens_max < 1.0) {
+		tokens_max = 1.0;
+	}
+
+	stream->pacing_tokens += rate * (double) (time_now - stream->pacing_time);
+	if (stream->pacing_tokens > tokens_max) {
+		stream->pacing_tokens = tokens_max;
+	}
+
+	out:
+	stream->pacing_time = time_now;
+}
+
 static int __rrr_udpstream_send_loop (
 		int *sending_complete,
 		int *sent_count_return,
@@ -1797,45 +2157,82 @@ static int __rrr_udpstream_send_loop (
 	int ret = 0;
 
 	int sent_count = 0;
+	int timeout_count = 0;
 	int64_t missing_ack_count = 0;
+
+	const uint32_t window_size = stream->window_size_from_remote < stream->congestion_window
+		? stream->window_size_from_remote
+		: stream->congestion_window;
+
+	__rrr_udpstream_pacing_refill(stream, time_now);
+
 	RRR_LL_ITERATE_BEGIN(&stream->send_buffer, struct rrr_udpstream_frame);
 		int do_send = 0;
+		int is_timeout = 0;
+		int is_lost = 0;
 
 		if (node->frame_id == 0) {
 			RRR_BUG("Frame ID was 0 in __rrr_udpstream_send_loop\n");
 		}
 
 		if (node->last_send_time == 0) {
-			if (++missing_ack_count < stream->window_size_from_remote) {
+			if (++missing_ack_count < window_size) {
 				do_send = 1;
-				RRR_DBG_3("UDP-stream TX %u-%u WS %" PRIu32 " UNACK %i\n",
-						stream->stream_id, node->frame_id, stream->window_size_from_remote, node->unacknowledged_count);
+				RRR_DBG_3("UDP-stream TX %u-%u WS %" PRIu32 " CW %" PRIu32 " UNACK %i\n",
+						stream->stream_id, node->frame_id, stream->window_size_from_remote, stream->congestion_window, node->unacknowledged_count);
 			}
 		}
-		else if (time_now - node->last_send_time > RRR_UDPSTREAM_RESEND_INTERVAL_FRAME_MS * 1000 ||
-				node->unacknowledged_count >= RRR_UDPSTREAM_RESEND_UNACKNOWLEDGED_LIMIT
-		) {
+		else if (time_now - node->last_send_time > stream->rto) {
+			RRR_DBG_3("UDP-stream TX %u-%u DUP RTO %" PRIu64 " ms\n",
+					stream->stream_id, node->frame_id, stream->rto / 1000);
+			do_send = is_timeout = is_lost = 1;
+		}
+		else if (node->unacknowledged_count >= RRR_UDPSTREAM_RESEND_UNACKNOWLEDGED_LIMIT) {
 			RRR_DBG_3("UDP-stream TX %u-%u DUP WS %" PRIu32 " UNACK %i\n",
 					stream->stream_id, node->frame_id, stream->window_size_from_remote, node->unacknowledged_count);
-			do_send = 1;
+			do_send = is_lost = 1;
 		}
 		else {
 			missing_ack_count++;
 		}
 
 		if (do_send != 0) {
+			if (stream->pacing_tokens < 1.0) {
+				RRR_LL_ITERATE_BREAK();
+			}
+
+			if (is_lost) {
+				__rrr_udpstream_congestion_on_loss(stream, node->frame_id, is_timeout);
+				timeout_count += is_timeout;
+			}
+
 			if ((ret = __rrr_udpstream_send_and_update_frame(data, stream, node)) != 0) {
 				RRR_MSG_0("Could not send frame in __rrr_udpstream_send_loop\n");
 				goto out;
 			}
 
+			stream->pacing_tokens -= 1.0;
+
 			if (++sent_count >= RRR_UDPSTREAM_BURST_LIMIT_SEND) {
-				*sending_complete = 0;
 				RRR_LL_ITERATE_LAST();
 			}
 		}
 	RRR_LL_ITERATE_END();
 
+	if (timeout_count > 0) {
+		// Exponential backoff until a new round trip time is measured
+		stream->rto *= 2;
+		if (stream->rto > RRR_UDPSTREAM_RTO_MAX_MS * 1000) {
+			stream->rto = RRR_UDPSTREAM_RTO_MAX_MS * 1000;
+		}
+	}
+
+	// Keep running as long as there are frames in the buffer to make sure
+	// that frames are sent when the window opens or the timeout expires
+	if (RRR_LL_COUNT(&stream->send_buffer) > 0) {
+		*sending_complete = 0;
+	}
+
 	*sent_count_return = sent_count;
 
 	out:
@@ -2191,7 +2588,7 @@ static int __rrr_udpstream_events_create (
 			&data->events,
 			__rrr_udpstream_event_send,
 			data,
-			10 * 1000 // 10 ms
+			RRR_UDPSTREAM_SEND_INTERVAL_MS * 1000
 	)) != 0) {
 		goto out_err;
 	}
@@ -2379,14 +2776,18 @@ void rrr_udpstream_dump_stats (
 	struct rrr_udpstream *data
 ) {
 	RRR_LL_ITERATE_BEGIN(&data->streams, struct rrr_udpstream_stream);
-		RRR_DBG(" - Stream %i: recv buf %i delivered id pos %u, send buf %i id pos %u window size f/t %" PRIu32 "/%" PRIu32 "\n",
+		RRR_DBG(" - Stream %i: recv buf %i delivered id pos %u, send buf %i id pos %u window size f/t %" PRIu32 "/%" PRIu32
+				" congestion window %" PRIu32 " rtt %" PRIu64 " us rto %" PRIu64 " us\n",
 				node->stream_id,
 				RRR_LL_COUNT(&node->receive_buffer),
 				node->receive_buffer.frame_id_prev_boundary_pos,
 				RRR_LL_COUNT(&node->send_buffer),
 				node->send_buffer.frame_id_counter,
 				node->window_size_from_remote,
-				node->window_size_to_remote
+				node->window_size_to_remote,
+				node->congestion_window,
+				node->rtt_smoothed,
+				node->rto
 		);
 	RRR_LL_ITERATE_END();
 }
@@ -72,6 +72,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // These parameters are useful to upstream framework, it's tuning
 // parameters should derive from these values.
 
+// Initial retransmission timeout used before the round trip time
+// of a stream has been measured
 #define RRR_UDPSTREAM_RESEND_INTERVAL_FRAME_MS 1000
 #define RRR_UDPSTREAM_BUFFER_LIMIT 750
 #define RRR_UDPSTREAM_WINDOW_SIZE_MAX RRR_UDPSTREAM_BUFFER_LIMIT*2
@@ -135,6 +137,7 @@ struct rrr_udpstream_frame {
 
 	uint64_t last_send_time;
 	int unacknowledged_count;
+	int send_count;
 	int ack_grace;
 
 	struct sockaddr *source_addr;
@@ -166,6 +169,27 @@ struct rrr_udpstream_stream {
 	int window_size_regulation_from_application;
 	uint32_t last_ack_id;
 	short destroy_on_empty_buffers;
+	uint8_t remote_version;
+
+	// Round trip time estimation, all values in microseconds
+	uint64_t rtt_smoothed;
+	uint64_t rtt_variance;
+	uint64_t rto;
+
+	// Congestion control, windows are counted in frames
+	uint32_t congestion_window;
+	uint32_t congestion_window_max;
+	uint32_t congestion_ssthresh;
+	uint32_t congestion_ack_count;
+	uint32_t congestion_recovery_frame_id;
+	uint64_t congestion_epoch_start;
+	uint32_t congestion_epoch_origin;
+	double congestion_epoch_k;
+	double congestion_reno_window;
+
+	// Pacing of outbound frames
+	double pacing_tokens;
+	uint64_t pacing_time;
 };
 
 struct rrr_udpstream_stream_collection {
@@ -216,6 +240,8 @@ struct rrr_udpstream {
 
 	void *send_buffer;
 	ssize_t send_buffer_size;
+
+	unsigned int loss_simulation_percent;
 };
 
 struct rrr_udpstream_send_data {
@@ -277,6 +303,13 @@ int rrr_udpstream_default_allocator (
 );
 */
 
+// Drop the given percentage of outbound packets randomly. Used
+// for testing only, set to zero to disable.
+void rrr_udpstream_set_loss_simulation (
+		struct rrr_udpstream *data,
+		unsigned int percent
+);
+
 // Check if a particular stream ID is registered
 int rrr_udpstream_stream_exists (
 		struct rrr_udpstream *data,
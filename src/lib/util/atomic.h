@@ -46,6 +46,14 @@ static inline int rrr_atomic_u32_fetch_and(rrr_atomic_u32_t *atomic, uint32_t va
 	return __atomic_fetch_and(&atomic->value, value, __ATOMIC_SEQ_CST);
 }
 
+static inline uint32_t rrr_atomic_u32_fetch_add(rrr_atomic_u32_t *atomic, uint32_t value) {
+	return __atomic_fetch_add(&atomic->value, value, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t rrr_atomic_u32_fetch_sub(rrr_atomic_u32_t *atomic, uint32_t value) {
+	return __atomic_fetch_sub(&atomic->value, value, __ATOMIC_SEQ_CST);
+}
+
 static inline uint64_t rrr_atomic_u64_load_relaxed(rrr_atomic_u64_t *atomic) {
 	uint64_t res;
 	__atomic_load(&atomic->value, &res, __ATOMIC_RELAXED);
@@ -56,4 +64,8 @@ static inline void rrr_atomic_u64_store_relaxed(rrr_atomic_u64_t *atomic, uint64
 	__atomic_store(&atomic->value, &value, __ATOMIC_RELAXED);
 }
 
+static inline uint64_t rrr_atomic_u64_fetch_add_relaxed(rrr_atomic_u64_t *atomic, uint64_t value) {
+	return __atomic_fetch_add(&atomic->value, value, __ATOMIC_RELAXED);
+}
+
 #endif /* RRR_ATOMIC_H */
@@ -28,9 +28,14 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 
 #include "../log.h"
 
+#ifdef RRR_HAVE_CRC32_PCLMUL
+#	include <immintrin.h>
+#endif
+
 #include "crc32.h"
 #include "../rrr_types.h"
 
@@ -105,21 +110,200 @@ static uint32_t crc_32_tab[] = { /* CRC polynomial 0xedb88320 */
 
 #define UPDC32(octet, crc) (crc_32_tab[((uint32_t) (crc) ^ (uint32_t) (octet)) & 0xff] ^ (uint32_t) ((crc) >> 8))
 
+/* Tables for slicing-by-8, generated from the table above upon first  */
+/* use. Table 0 equals crc_32_tab, table N gives the contribution of a */
+/* byte followed by N zero bytes.                                      */
+
+static uint32_t crc_32_tab_slice[8][256];
+static pthread_once_t crc_32_init_once = PTHREAD_ONCE_INIT;
+static uint32_t (*crc_32_update)(uint32_t crc, const unsigned char *buf, rrr_biglength len) = NULL;
+
+static uint32_t __rrr_crc32_update_bytewise (
+		uint32_t crc,
+		const unsigned char *buf,
+		rrr_biglength len
+) {
+	for (rrr_biglength i = 0; i < len; i++) {
+		crc = UPDC32(buf[i], crc);
+	}
+	return crc;
+}
+
+static uint32_t __rrr_crc32_update_slice_by_8 (
+		uint32_t crc,
+		const unsigned char *buf,
+		rrr_biglength len
+) {
+	const uint32_t (*t)[256] = (const uint32_t (*)[256]) crc_32_tab_slice;
+
+	for (; len > 0 && ((uintptr_t) buf) % 8 != 0; buf++, len--) {
+		crc = UPDC32(*buf, crc);
+	}
+
+	for (; len >= 8; buf += 8, len -= 8) {
+		// Byte-wise assembly keeps this independent of host endianess,
+		// compilers will turn it into plain loads on little endian.
+		const uint32_t a = crc ^ ((uint32_t) buf[0] | (uint32_t) buf[1] << 8 | (uint32_t) buf[2] << 16 | (uint32_t) buf[3] << 24);
+		const uint32_t b = (uint32_t) buf[4] | (uint32_t) buf[5] << 8 | (uint32_t) buf[6] << 16 | (uint32_t) buf[7] << 24;
+
+		crc = t[7][a & 0xff] ^ t[6][(a >> 8) & 0xff] ^ t[5][(a >> 16) & 0xff] ^ t[4][a >> 24] ^
+		      t[3][b & 0xff] ^ t[2][(b >> 8) & 0xff] ^ t[1][(b >> 16) & 0xff] ^ t[0][b >> 24];
+	}
+
+	return __rrr_crc32_update_bytewise(crc, buf, len);
+}
+
+#ifdef RRR_HAVE_CRC32_PCLMUL
+/* Folding using carry-less multiplication as described in Intel's     */
+/* "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ       */
+/* Instruction". Four 128-bit lanes are folded in parallel, reduced to */
+/* a single lane and finally Barrett reduced to 32 bits. The constants */
+/* are the bit-reflected ones for the polynomial used in this file.    */
+/* Input length must be at least 64 and a multiple of 16.              */
+
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t __rrr_crc32_update_pclmul_blocks (
+		uint32_t crc,
+		const unsigned char *buf,
+		rrr_biglength len
+) {
+	const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+	const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+	const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+	const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+	const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+	__m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+	x1 = _mm_loadu_si128((const __m128i *) (buf + 0x00));
+	x2 = _mm_loadu_si128((const __m128i *) (buf + 0x10));
+	x3 = _mm_loadu_si128((const __m128i *) (buf + 0x20));
+	x4 = _mm_loadu_si128((const __m128i *) (buf + 0x30));
+
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int) crc));
+
+	buf += 64;
+	len -= 64;
+
+	for (; len >= 64; buf += 64, len -= 64) {
+		x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i *) (buf + 0x00)));
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i *) (buf + 0x10)));
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i *) (buf + 0x20)));
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i *) (buf + 0x30)));
+	}
+
+	// Fold the four lanes into one
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// Remaining 16 byte blocks
+	for (; len >= 16; buf += 16, len -= 16) {
+		x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *) buf)), x5);
+	}
+
+	// Fold 128 bits to 64 bits
+	x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+	x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, mask32);
+	x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	x2 = _mm_and_si128(x1, mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+	x2 = _mm_and_si128(x2, mask32);
+	x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return (uint32_t) _mm_extract_epi32(x1, 1);
+}
+
+static uint32_t __rrr_crc32_update_pclmul (
+		uint32_t crc,
+		const unsigned char *buf,
+		rrr_biglength len
+) {
+	if (len >= 64) {
+		const rrr_biglength blocks_size = len & ~((rrr_biglength) 15);
+		crc = __rrr_crc32_update_pclmul_blocks(crc, buf, blocks_size);
+		buf += blocks_size;
+		len -= blocks_size;
+	}
+
+	return __rrr_crc32_update_slice_by_8(crc, buf, len);
+}
+#endif
+
+static void __rrr_crc32_init (void) {
+	for (int n = 0; n < 256; n++) {
+		crc_32_tab_slice[0][n] = crc_32_tab[n];
+	}
+	for (int k = 1; k < 8; k++) {
+		for (int n = 0; n < 256; n++) {
+			const uint32_t prev = crc_32_tab_slice[k - 1][n];
+			crc_32_tab_slice[k][n] = (prev >> 8) ^ crc_32_tab[prev & 0xff];
+		}
+	}
+
+	crc_32_update = __rrr_crc32_update_slice_by_8;
+
+#ifdef RRR_HAVE_CRC32_PCLMUL
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1")) {
+		crc_32_update = __rrr_crc32_update_pclmul;
+	}
+#endif
+}
+
+const char *rrr_crc32_implementation (void) {
+	pthread_once(&crc_32_init_once, __rrr_crc32_init);
+
+#ifdef RRR_HAVE_CRC32_PCLMUL
+	if (crc_32_update == __rrr_crc32_update_pclmul) {
+		return "pclmul";
+	}
+#endif
+
+	return "slice-by-8";
+}
+
 // Returns checksum
 uint32_t rrr_crc32buf (const char *buf, rrr_biglength len) {
-      uint32_t crc32 = 0xFFFFFFFF;
+	pthread_once(&crc_32_init_once, __rrr_crc32_init);
 
-      for (rrr_biglength i = 0; i < len; i++) {
-    	  crc32 = (UPDC32(*(buf + i), crc32));
-//    	  printf ("CRC: %" PRIu32 "\n", crc32);
-      }
+	return ~crc_32_update(0xFFFFFFFF, (const unsigned char *) buf, len);
+}
 
-      return ~crc32;
+// Reference implementation processing one byte at a time, returns checksum
+uint32_t rrr_crc32buf_bytewise (const char *buf, rrr_biglength len) {
+	return ~__rrr_crc32_update_bytewise(0xFFFFFFFF, (const unsigned char *) buf, len);
 }
 
 // Returns 0 if checksum is valid
 uint32_t rrr_crc32cmp (const char *buf, rrr_biglength len, uint32_t crc32) {
-//	printf ("CRC32CMP length %i\n", len);
 	uint32_t test = rrr_crc32buf(buf, len);
 	return test - crc32;
 }
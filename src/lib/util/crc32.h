@@ -26,7 +26,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "../rrr_types.h"
 
+const char *rrr_crc32_implementation (void);
 uint32_t rrr_crc32buf (const char *buf, rrr_biglength len);
+uint32_t rrr_crc32buf_bytewise (const char *buf, rrr_biglength len);
 uint32_t rrr_crc32cmp (const char *buf, rrr_biglength len, uint32_t crc32);
 
 #endif /* RRR_CRC32_H */
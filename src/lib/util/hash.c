@@ -0,0 +1,244 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+
+#include "../log.h"
+#include "../allocator.h"
+
+#include "hash.h"
+
+#define RRR_HASH_BUCKETS_INITIAL 16
+
+struct rrr_hash_entry {
+	struct rrr_hash_entry *next;
+	uint64_t hash;
+	void *value;
+	rrr_length key_size;
+	// Must be last
+	char key[1];
+};
+
+uint64_t rrr_hash_calculate (
+		const void *key,
+		rrr_length key_size
+) {
+	const unsigned char *pos = key;
+
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (rrr_length i = 0; i < key_size; i++) {
+		hash ^= pos[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	// Final mix to spread low-entropy keys like pointers and
+	// small integers over the low bits used for bucket selection
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdULL;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+void rrr_hash_clear (
+		struct rrr_hash *hash
+) {
+	for (rrr_length i = 0; i < hash->bucket_count; i++) {
+		struct rrr_hash_entry *entry = hash->buckets[i];
+		while (entry != NULL) {
+			struct rrr_hash_entry *next = entry->next;
+			rrr_free(entry);
+			entry = next;
+		}
+	}
+	RRR_FREE_IF_NOT_NULL(hash->buckets);
+	memset(hash, '\0', sizeof(*hash));
+}
+
+static int __rrr_hash_resize (
+		struct rrr_hash *hash,
+		rrr_length bucket_count
+) {
+	struct rrr_hash_entry **buckets;
+
+	if ((buckets = rrr_allocate(sizeof(*buckets) * bucket_count)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		return 1;
+	}
+
+	memset(buckets, '\0', sizeof(*buckets) * bucket_count);
+
+	for (rrr_length i = 0; i < hash->bucket_count; i++) {
+		struct rrr_hash_entry *entry = hash->buckets[i];
+		while (entry != NULL) {
+			struct rrr_hash_entry *next = entry->next;
+			struct rrr_hash_entry **bucket = &buckets[entry->hash & (bucket_count - 1)];
+			entry->next = *bucket;
+			*bucket = entry;
+			entry = next;
+		}
+	}
+
+	RRR_FREE_IF_NOT_NULL(hash->buckets);
+	hash->buckets = buckets;
+	hash->bucket_count = bucket_count;
+
+	return 0;
+}
+
+static struct rrr_hash_entry **__rrr_hash_find (
+		const struct rrr_hash *hash,
+		uint64_t key_hash,
+		const void *key,
+		rrr_length key_size
+) {
+	if (hash->bucket_count == 0) {
+		return NULL;
+	}
+
+	struct rrr_hash_entry **entry = &hash->buckets[key_hash & (hash->bucket_count - 1)];
+
+	for (; *entry != NULL; entry = &(*entry)->next) {
+		if ( (*entry)->hash == key_hash &&
+		     (*entry)->key_size == key_size &&
+		     memcmp((*entry)->key, key, key_size) == 0
+		) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+int rrr_hash_set (
+		struct rrr_hash *hash,
+		const void *key,
+		rrr_length key_size,
+		void *value
+) {
+	if (value == NULL) {
+		RRR_BUG("BUG: NULL value in %s\n", __func__);
+	}
+
+	const uint64_t key_hash = rrr_hash_calculate(key, key_size);
+
+	struct rrr_hash_entry **existing = __rrr_hash_find(hash, key_hash, key, key_size);
+	if (existing != NULL) {
+		(*existing)->value = value;
+		return 0;
+	}
+
+	if (hash->entry_count >= hash->bucket_count) {
+		if (__rrr_hash_resize (
+				hash,
+				hash->bucket_count == 0 ? RRR_HASH_BUCKETS_INITIAL : hash->bucket_count * 2
+		) != 0) {
+			return 1;
+		}
+	}
+
+	struct rrr_hash_entry *entry;
+
+	if ((entry = rrr_allocate(sizeof(*entry) + key_size)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		return 1;
+	}
+
+	entry->hash = key_hash;
+	entry->value = value;
+	entry->key_size = key_size;
+	memcpy(entry->key, key, key_size);
+
+	struct rrr_hash_entry **bucket = &hash->buckets[key_hash & (hash->bucket_count - 1)];
+	entry->next = *bucket;
+	*bucket = entry;
+
+	hash->entry_count++;
+
+	return 0;
+}
+
+void *rrr_hash_get (
+		const struct rrr_hash *hash,
+		const void *key,
+		rrr_length key_size
+) {
+	struct rrr_hash_entry **entry = __rrr_hash_find(hash, rrr_hash_calculate(key, key_size), key, key_size);
+	return entry != NULL ? (*entry)->value : NULL;
+}
+
+void *rrr_hash_remove (
+		struct rrr_hash *hash,
+		const void *key,
+		rrr_length key_size
+) {
+	struct rrr_hash_entry **entry = __rrr_hash_find(hash, rrr_hash_calculate(key, key_size), key, key_size);
+
+	if (entry == NULL) {
+		return NULL;
+	}
+
+	struct rrr_hash_entry *found = *entry;
+	void *value = found->value;
+
+	*entry = found->next;
+	rrr_free(found);
+
+	hash->entry_count--;
+
+	return value;
+}
+
+int rrr_hash_iterate (
+		struct rrr_hash *hash,
+		int (*callback)(RRR_HASH_ITERATE_CALLBACK_ARGS),
+		void *callback_arg
+) {
+	for (rrr_length i = 0; i < hash->bucket_count; i++) {
+		struct rrr_hash_entry **entry = &hash->buckets[i];
+		while (*entry != NULL) {
+			struct rrr_hash_entry *current = *entry;
+
+			int ret_tmp = callback(current->key, current->key_size, current->value, callback_arg);
+
+			if (ret_tmp & RRR_HASH_ITERATE_REMOVE) {
+				*entry = current->next;
+				rrr_free(current);
+				hash->entry_count--;
+			}
+			else {
+				entry = &current->next;
+			}
+
+			if (ret_tmp & RRR_HASH_ITERATE_ERR) {
+				return 1;
+			}
+			if (ret_tmp & RRR_HASH_ITERATE_STOP) {
+				return 0;
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef RRR_HASH_H
+#define RRR_HASH_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../rrr_types.h"
+
+// Chained hash table mapping arbitrary binary keys to pointers. Keys are
+// copied into the entries, values are not managed by the table. A zeroed
+// struct is a valid and empty table, buckets are allocated upon first
+// insertion. NULL may not be used as a value.
+
+#define RRR_HASH_ITERATE_OK       0
+#define RRR_HASH_ITERATE_REMOVE   (1<<0)
+#define RRR_HASH_ITERATE_STOP     (1<<1)
+#define RRR_HASH_ITERATE_ERR      (1<<2)
+
+#define RRR_HASH_ITERATE_CALLBACK_ARGS \
+    const void *key, rrr_length key_size, void *value, void *arg
+
+struct rrr_hash_entry;
+
+struct rrr_hash {
+	struct rrr_hash_entry **buckets;
+	rrr_length bucket_count;
+	rrr_length entry_count;
+};
+
+#define RRR_HASH_COUNT(hash) \
+    ((hash)->entry_count)
+
+uint64_t rrr_hash_calculate (
+		const void *key,
+		rrr_length key_size
+);
+void rrr_hash_clear (
+		struct rrr_hash *hash
+);
+int rrr_hash_set (
+		struct rrr_hash *hash,
+		const void *key,
+		rrr_length key_size,
+		void *value
+);
+void *rrr_hash_get (
+		const struct rrr_hash *hash,
+		const void *key,
+		rrr_length key_size
+);
+void *rrr_hash_remove (
+		struct rrr_hash *hash,
+		const void *key,
+		rrr_length key_size
+);
+int rrr_hash_iterate (
+		struct rrr_hash *hash,
+		int (*callback)(RRR_HASH_ITERATE_CALLBACK_ARGS),
+		void *callback_arg
+);
+
+static inline int rrr_hash_set_u64 (struct rrr_hash *hash, uint64_t key, void *value) {
+	return rrr_hash_set(hash, &key, sizeof(key), value);
+}
+
+static inline void *rrr_hash_get_u64 (const struct rrr_hash *hash, uint64_t key) {
+	return rrr_hash_get(hash, &key, sizeof(key));
+}
+
+static inline void *rrr_hash_remove_u64 (struct rrr_hash *hash, uint64_t key) {
+	return rrr_hash_remove(hash, &key, sizeof(key));
+}
+
+static inline int rrr_hash_set_ptr (struct rrr_hash *hash, const void *key, void *value) {
+	return rrr_hash_set(hash, &key, sizeof(key), value);
+}
+
+static inline void *rrr_hash_get_ptr (const struct rrr_hash *hash, const void *key) {
+	return rrr_hash_get(hash, &key, sizeof(key));
+}
+
+static inline void *rrr_hash_remove_ptr (struct rrr_hash *hash, const void *key) {
+	return rrr_hash_remove(hash, &key, sizeof(key));
+}
+
+static inline int rrr_hash_set_str (struct rrr_hash *hash, const char *key, void *value) {
+	return rrr_hash_set(hash, key, rrr_length_from_size_t_bug_const(strlen(key)), value);
+}
+
+static inline void *rrr_hash_get_str (const struct rrr_hash *hash, const char *key) {
+	return rrr_hash_get(hash, key, rrr_length_from_size_t_bug_const(strlen(key)));
+}
+
+static inline void *rrr_hash_remove_str (struct rrr_hash *hash, const char *key) {
+	return rrr_hash_remove(hash, key, rrr_length_from_size_t_bug_const(strlen(key)));
+}
+
+#endif /* RRR_HASH_H */
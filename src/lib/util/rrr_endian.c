@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define _DEFAULT_SOURCE
 
 #include <stdint.h>
+#include <string.h>
 
 #if defined(__linux__)
 #include <endian.h>
@@ -29,6 +30,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <sys/endian.h>
 #endif
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
 #include "rrr_endian.h"
 
 uint16_t rrr_htobe16(uint16_t x) {
@@ -69,3 +74,36 @@ uint64_t rrr_be64toh(uint64_t x) {
 uint64_t rrr_le64toh(uint64_t x) {
 	return le64toh(x);
 }
+
+// Converts multiple 64-bit values. Target and source may be equal but must otherwise
+// not overlap, and neither need to be aligned.
+void rrr_htobe64_array (
+		void *target,
+		const void *source,
+		uint64_t count
+) {
+	unsigned char *wpos = target;
+	const unsigned char *rpos = source;
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	if (wpos != rpos) {
+		memmove(wpos, rpos, count * sizeof(uint64_t));
+	}
+#else
+	uint64_t i = 0;
+#	if defined(__SSSE3__)
+	const __m128i shuffle = _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+	for (; i + 2 <= count; i += 2) {
+		const __m128i tmp = _mm_loadu_si128((const __m128i *) (rpos + i * sizeof(uint64_t)));
+		_mm_storeu_si128((__m128i *) (wpos + i * sizeof(uint64_t)), _mm_shuffle_epi8(tmp, shuffle));
+	}
+#	endif
+	// Plain loop which the compiler may vectorize
+	for (; i < count; i++) {
+		uint64_t tmp;
+		memcpy(&tmp, rpos + i * sizeof(tmp), sizeof(tmp));
+		tmp = __builtin_bswap64(tmp);
+		memcpy(wpos + i * sizeof(tmp), &tmp, sizeof(tmp));
+	}
+#endif
+}
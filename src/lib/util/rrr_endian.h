@@ -39,4 +39,18 @@ uint64_t rrr_htole64(uint64_t x);
 uint64_t rrr_be64toh(uint64_t x);
 uint64_t rrr_le64toh(uint64_t x);
 
+void rrr_htobe64_array (
+		void *target,
+		const void *source,
+		uint64_t count
+);
+static inline void rrr_be64toh_array (
+		void *target,
+		const void *source,
+		uint64_t count
+) {
+	// Same operation in both directions
+	rrr_htobe64_array(target, source, count);
+}
+
 #endif /* RRR_ENDIAN_H */
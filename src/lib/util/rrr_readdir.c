@@ -80,6 +80,63 @@ static int __rrr_readdir_prefix_match (const char *filename, const char *prefix)
 	return 1;
 }
 
+// Resolves type and real path of a directory entry, following symlinks. Returns
+// non-zero if the entry should be skipped.
+static int __rrr_readdir_resolve (
+		char orig_path[PATH_MAX + 1],
+		char real_path[PATH_MAX + 1],
+		unsigned char *d_type,
+		const char *dir_path,
+		const char *name
+) {
+	if (snprintf(orig_path, PATH_MAX, "%s/%s", dir_path, name) >= PATH_MAX) {
+		RRR_DBG_3("Path was too long for file '%s' in rrr_readdir_foreach\n", name);
+		return 1;
+	}
+
+	memcpy(real_path, orig_path, PATH_MAX + 1);
+
+	int i = 100;
+	while (--i > 0 && (*d_type == DT_UNKNOWN || *d_type == DT_LNK)) {
+		struct stat sb;
+		if (lstat(real_path, &sb) != 0) {
+			RRR_DBG_3("Could not stat file '%s': %s\n", orig_path, rrr_strerror(errno));
+			return 1;
+		}
+
+		switch (sb.st_mode & S_IFMT) {
+			case S_IFBLK:	*d_type = DT_BLK;	break;
+			case S_IFCHR:	*d_type = DT_CHR;	break;
+			case S_IFDIR:	*d_type = DT_DIR;	break;
+			case S_IFIFO:	*d_type = DT_FIFO;	break;
+			case S_IFLNK:	*d_type = DT_LNK;	break;
+			case S_IFREG:	*d_type = DT_REG;	break;
+			case S_IFSOCK:	*d_type = DT_SOCK;	break;
+			default:		*d_type = 0;		break;
+		}
+
+		if (*d_type == DT_LNK) {
+			if (realpath(orig_path, real_path) == NULL) {
+				RRR_DBG_3("Could not resolve real path for '%s': %s\n", orig_path, rrr_strerror(errno));
+				return 1;
+			}
+#ifdef RRR_READDIR_DEBUG
+			printf ("entry %s was symlink, translates to %s\n", name, real_path);
+#endif
+			continue;
+		}
+
+		break;
+	}
+
+	if (i <= 0) {
+		RRR_DBG_3("Possible symlink loop in rrr_readdir_foreach for file '%s'\n", orig_path);
+		return 1;
+	}
+
+	return 0;
+}
+
 int rrr_readdir_foreach_prefix (
 		const char *dir_path,
 		const char *prefix,
@@ -120,63 +177,23 @@ int rrr_readdir_foreach_prefix (
 
 		char orig_path[PATH_MAX + 1];
 		char real_path[PATH_MAX + 1];
-		if (snprintf(orig_path, PATH_MAX, "%s/%s", dir_path, entry->d_name) >= PATH_MAX) {
-			RRR_DBG_3("Path was too long for file '%s' in rrr_readdir_foreach\n", entry->d_name);
-			continue; // Non-critical
-		}
-
-		memcpy(real_path, orig_path, PATH_MAX + 1);
 
 #if defined(_DEFAULT_SOURCE) || defined(_BSD_SOURCE)
 		d_type = entry->d_type;
 #endif
 
-		int i = 100;
-		while (--i > 0 && (d_type == DT_UNKNOWN || d_type == DT_LNK)) {
-			struct stat sb;
-			if (lstat(real_path, &sb) != 0) {
-				RRR_DBG_3("Could not stat file '%s': %s\n", orig_path, rrr_strerror(errno));
-				goto next_entry; // Non-critical
-			}
-
-			switch (sb.st_mode & S_IFMT) {
-				case S_IFBLK:	d_type = DT_BLK;	break;
-				case S_IFCHR:	d_type = DT_CHR;	break;
-				case S_IFDIR:	d_type = DT_DIR;	break;
-				case S_IFIFO:	d_type = DT_FIFO;	break;
-				case S_IFLNK:	d_type = DT_LNK;	break;
-				case S_IFREG:	d_type = DT_REG;	break;
-				case S_IFSOCK:	d_type = DT_SOCK;	break;
-				default:		d_type = 0;			break;
-			}
-
-			if (d_type == DT_LNK) {
-				if (realpath(orig_path, real_path) == NULL) {
-					RRR_DBG_3("Could not resolve real path for '%s': %s\n", orig_path, rrr_strerror(errno));
-					goto next_entry; // Non-critical
-				}
-#ifdef RRR_READDIR_DEBUG
-				printf ("entry %s was symlink, translates to %s\n", entry->d_name, real_path);
-#endif
-				continue;
-			}
-
-			break;
+		// Check prefix first to avoid stat() of entries not matching
+		if (prefix != NULL && !__rrr_readdir_prefix_match(entry->d_name, prefix)) {
+			continue;
 		}
 
-		if (i <= 0) {
-			RRR_DBG_3("Possible symlink loop in rrr_readdir_foreach for file '%s'\n", orig_path);
-			goto next_entry; // Non-critical
+		if (__rrr_readdir_resolve(orig_path, real_path, &d_type, dir_path, entry->d_name) != 0) {
+			continue; // Non-critical
 		}
 
-		if (prefix == NULL || __rrr_readdir_prefix_match(entry->d_name, prefix)) {
-			if ((ret = callback (entry, orig_path, real_path, d_type, private_data)) != 0) {
-				goto out;
-			}
+		if ((ret = callback (entry, orig_path, real_path, d_type, private_data)) != 0) {
+			goto out;
 		}
-
-        next_entry:
-		continue;
 	}
 
 	out:
@@ -187,6 +204,28 @@ int rrr_readdir_foreach_prefix (
 	return ret;
 }
 
+int rrr_readdir_single_prefix (
+		const char *dir_path,
+		const char *name,
+		const char *prefix,
+		int (*callback)(struct dirent *entry, const char *orig_path, const char *resolved_path, unsigned char type, void *private_data),
+		void *private_data
+) {
+	unsigned char d_type = DT_UNKNOWN;
+	char orig_path[PATH_MAX + 1];
+	char real_path[PATH_MAX + 1];
+
+	if (prefix != NULL && !__rrr_readdir_prefix_match(name, prefix)) {
+		return 0;
+	}
+
+	if (__rrr_readdir_resolve(orig_path, real_path, &d_type, dir_path, name) != 0) {
+		return 0; // Non-critical, file may have been removed
+	}
+
+	return callback (NULL, orig_path, real_path, d_type, private_data);
+}
+
 int rrr_readdir_foreach (
 		const char *dir_path,
 		int (*callback)(struct dirent *entry, const char *orig_path, const char *resolved_path, unsigned char type, void *private_data),
@@ -55,7 +55,14 @@ int rrr_readdir_foreach_prefix (
 		int (*callback)(struct dirent *entry, const char *orig_path, const char *resolved_path, unsigned char type, void *private_data),
 		void *private_data
 );
-
+// Same as foreach_prefix but for a single known entry, entry argument to callback is NULL
+int rrr_readdir_single_prefix (
+		const char *dir_path,
+		const char *name,
+		const char *prefix,
+		int (*callback)(struct dirent *entry, const char *orig_path, const char *resolved_path, unsigned char type, void *private_data),
+		void *private_data
+);
 int rrr_readdir_foreach (
 		const char *dir_path,
 		int (*callback)(struct dirent *entry, const char *orig_path, const char *resolved_path, unsigned char type, void *private_data),
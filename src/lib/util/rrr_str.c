@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <ctype.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "rrr_str.h"
 
@@ -33,3 +34,60 @@ void rrr_str_tolower (
 		str[i] = tolower(str[i]);
 	}
 }
+
+static const char rrr_str_digit_pairs[200] = {
+	'0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9',
+	'1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9',
+	'2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9',
+	'3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9',
+	'4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9',
+	'5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9',
+	'6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9',
+	'7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9',
+	'8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9',
+	'9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
+
+// Writes decimal representation without \0 termination, target must hold
+// at least RRR_STR_64_MAX bytes. Returns number of bytes written.
+int rrr_str_u64_to_dec (
+		char *target,
+		uint64_t value
+) {
+	char buf[RRR_STR_64_MAX];
+	int pos = sizeof(buf);
+
+	// Two digits per division
+	while (value >= 100) {
+		const unsigned int pair = (unsigned int) (value % 100) * 2;
+		value /= 100;
+		buf[--pos] = rrr_str_digit_pairs[pair + 1];
+		buf[--pos] = rrr_str_digit_pairs[pair];
+	}
+
+	if (value >= 10) {
+		const unsigned int pair = (unsigned int) value * 2;
+		buf[--pos] = rrr_str_digit_pairs[pair + 1];
+		buf[--pos] = rrr_str_digit_pairs[pair];
+	}
+	else {
+		buf[--pos] = (char) ('0' + value);
+	}
+
+	const int length = (int) sizeof(buf) - pos;
+	memcpy(target, buf + pos, (size_t) length);
+
+	return length;
+}
+
+int rrr_str_i64_to_dec (
+		char *target,
+		int64_t value
+) {
+	if (value < 0) {
+		*target = '-';
+		// Negate as unsigned to handle INT64_MIN
+		return 1 + rrr_str_u64_to_dec(target + 1, (uint64_t) 0 - (uint64_t) value);
+	}
+	return rrr_str_u64_to_dec(target, (uint64_t) value);
+}
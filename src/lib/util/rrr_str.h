@@ -22,8 +22,21 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef RRR_STR_H
 #define RRR_STR_H
 
+#include <stdint.h>
+
+// Maximum length of a 64-bit integer as decimal with sign, not including \0
+#define RRR_STR_64_MAX 20
+
 void rrr_str_tolower (
 		char *str
 );
+int rrr_str_u64_to_dec (
+		char *target,
+		uint64_t value
+);
+int rrr_str_i64_to_dec (
+		char *target,
+		int64_t value
+);
 
 #endif /* RRR_STR_H */
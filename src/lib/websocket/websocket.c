@@ -197,8 +197,34 @@ static void __rrr_websocket_payload_mask_unmask (
 	} key;
 	key.key_32 = rrr_htobe32(masking_key_h);
 
-	for (rrr_biglength i = 0; i < payload_size; i++) {
-		payload[i] = payload[i] ^ key.key_8[i % 4];
+	rrr_biglength i = 0;
+
+	// Process single bytes until the payload is aligned, then
+	// eight bytes at a time. The compiler will vectorize the
+	// word loop where possible.
+	for (; i < payload_size && ((uintptr_t) (payload + i)) % sizeof(uint64_t) != 0; i++) {
+		payload[i] ^= key.key_8[i % 4];
+	}
+
+	if (payload_size - i >= sizeof(uint64_t)) {
+		uint8_t key_rotated[sizeof(uint64_t)];
+		for (rrr_biglength j = 0; j < sizeof(key_rotated); j++) {
+			key_rotated[j] = key.key_8[(i + j) % 4];
+		}
+
+		uint64_t key_64;
+		memcpy(&key_64, key_rotated, sizeof(key_64));
+
+		for (; payload_size - i >= sizeof(uint64_t); i += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, payload + i, sizeof(word));
+			word ^= key_64;
+			memcpy(payload + i, &word, sizeof(word));
+		}
+	}
+
+	for (; i < payload_size; i++) {
+		payload[i] ^= key.key_8[i % 4];
 	}
 }
 
@@ -265,7 +291,8 @@ static int __rrr_websocket_transport_ctx_frame_send (
 			__rrr_websocket_payload_mask_unmask((uint8_t *) frame->payload, frame->header.payload_len, frame->header.masking_key);
 		}
 
-		if ((ret = rrr_net_transport_ctx_send_push_const(handle, frame->payload, frame->header.payload_len)) != 0) {
+		// Payload is handed over to the send queue without copying
+		if ((ret = rrr_net_transport_ctx_send_push(handle, (void **) &frame->payload, frame->header.payload_len)) != 0) {
 			RRR_DBG_1("Failed to send websocket payload for handle %i\n", RRR_NET_TRANSPORT_CTX_HANDLE(handle));
 			goto out;
 		}
@@ -67,6 +67,11 @@ struct mqtt_broker_data {
 	char *password_file;
 	char *acl_file;
 	char *permission_name;
+	char *store_file;
+	rrr_setting_uint store_sync_interval_ms;
+	rrr_setting_uint topic_alias_maximum_in;
+	rrr_setting_uint topic_alias_maximum_out;
+	rrr_setting_uint threads;
 
 	int do_require_authentication;
 	int do_disconnect_on_v31_publish_deny;
@@ -83,6 +88,7 @@ static void mqttbroker_data_cleanup(void *arg) {
 	RRR_FREE_IF_NOT_NULL(data->password_file);
 	RRR_FREE_IF_NOT_NULL(data->acl_file);
 	RRR_FREE_IF_NOT_NULL(data->permission_name);
+	RRR_FREE_IF_NOT_NULL(data->store_file);
 	rrr_mqtt_acl_entry_collection_clear(&data->acl);
 	rrr_net_transport_config_cleanup(&data->net_transport_config);
 }
@@ -161,9 +167,33 @@ static int mqttbroker_parse_config (struct mqtt_broker_data *data, struct rrr_in
 		goto out;
 	}
 
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("mqtt_broker_topic_alias_maximum_in", topic_alias_maximum_in, 0);
+	if (data->topic_alias_maximum_in > 0xffff) {
+		RRR_MSG_0("mqtt_broker_topic_alias_maximum_in was too big for instance %s, max is 65535\n", config->name);
+		ret = 1;
+		goto out;
+	}
+
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("mqtt_broker_topic_alias_maximum_out", topic_alias_maximum_out, 0);
+	if (data->topic_alias_maximum_out > 0xffff) {
+		RRR_MSG_0("mqtt_broker_topic_alias_maximum_out was too big for instance %s, max is 65535\n", config->name);
+		ret = 1;
+		goto out;
+	}
+
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("mqtt_broker_threads", threads, 1);
+	if (data->threads < 1 || data->threads > RRR_MQTT_BROKER_THREADS_MAX) {
+		RRR_MSG_0("mqtt_broker_threads was out of range for instance %s, must be in the range 1-%i\n",
+				config->name, RRR_MQTT_BROKER_THREADS_MAX);
+		ret = 1;
+		goto out;
+	}
+
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("mqtt_broker_password_file", password_file);
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("mqtt_broker_permission_name", permission_name);
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("mqtt_broker_acl_file", acl_file);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("mqtt_broker_session_store_file", store_file);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("mqtt_broker_session_store_sync_interval_ms", store_sync_interval_ms, 100);
 
 	if (data->permission_name == NULL || *(data->permission_name) == '\0') {
 		RRR_FREE_IF_NOT_NULL(data->permission_name);
@@ -252,6 +282,12 @@ static void mqttbroker_update_stats (struct mqtt_broker_data *data, struct rrr_s
 	rrr_stats_instance_post_unsigned_base10_text(stats, "total_publish_not_forwarded", 0, broker_stats.session_stats.total_publish_not_forwarded);
 	rrr_stats_instance_post_unsigned_base10_text(stats, "total_publish_forwarded_in", 0, broker_stats.session_stats.total_publish_forwarded_in);
 	rrr_stats_instance_post_unsigned_base10_text(stats, "total_publish_forwarded_out", 0, broker_stats.session_stats.total_publish_forwarded_out);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_out_assigned", 0, broker_stats.topic_alias_stats.out_assigned);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_out_reused", 0, broker_stats.topic_alias_stats.out_reused);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_out_bytes_saved", 0, broker_stats.topic_alias_stats.out_bytes_saved);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_in_assigned", 0, broker_stats.topic_alias_stats.in_assigned);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_in_resolved", 0, broker_stats.topic_alias_stats.in_resolved);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_in_bytes_saved", 0, broker_stats.topic_alias_stats.in_bytes_saved);
 
 	// This will always be zero for the broker, nothing is delivered locally. Keep it here nevertheless to avoid accidently activating it.
 	// rrr_stats_instance_post_unsigned_base10_text(stats, "total_publish_delivered", 0, broker_stats.session_stats.total_publish_delivered);
@@ -339,7 +375,14 @@ static void *thread_entry_mqttbroker (struct rrr_thread *thread) {
 			INSTANCE_D_NAME(thread_data),
 			data->retry_interval * 1000 * 1000,
 			data->close_wait_time * 1000 * 1000,
-			RRR_MQTT_COMMON_MAX_CONNECTIONS
+			RRR_MQTT_COMMON_MAX_CONNECTIONS,
+			(uint16_t) data->topic_alias_maximum_in,
+			(uint16_t) data->topic_alias_maximum_out
+	};
+
+	struct rrr_mqtt_session_collection_ram_config session_config = {
+			data->store_file,
+			data->store_sync_interval_ms
 	};
 
 	if (rrr_mqtt_broker_new (
@@ -352,8 +395,9 @@ static void *thread_entry_mqttbroker (struct rrr_thread *thread) {
 			&data->acl,
 			data->do_require_authentication,
 			data->do_disconnect_on_v31_publish_deny,
+			(unsigned int) data->threads,
 			rrr_mqtt_session_collection_ram_new_broker,
-			NULL
+			&session_config
 	) != 0) {
 		RRR_MSG_0("Could not create new mqtt broker\n");
 		goto out_message;
@@ -406,6 +450,12 @@ static void *thread_entry_mqttbroker (struct rrr_thread *thread) {
 	}
 #endif
 
+	if (rrr_mqtt_broker_threads_start(data->mqtt_broker_data) != 0) {
+		RRR_MSG_0("Could not start threads in mqtt broker instance %s\n",
+				INSTANCE_D_NAME(thread_data));
+		goto out_destroy_broker;
+	}
+
 	rrr_event_dispatch (
 			INSTANCE_D_EVENTS(thread_data),
 			1 * 1000 * 1000,
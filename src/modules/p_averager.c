@@ -43,10 +43,57 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../lib/message_holder/message_holder_collection.h"
 #include "../lib/message_holder/message_holder_struct.h"
 #include "../lib/message_broker.h"
+#include "../lib/map.h"
+#include "../lib/util/hash.h"
+#include "../lib/util/gnu.h"
+
+// In seconds, keep x seconds of readings in the buffer
+#define RRR_DEFAULT_AVERAGER_TIMESPAN_S 15
+
+// Create an average/max/min-reading every x seconds
+#define RRR_DEFAULT_AVERAGER_INTERVAL_S 10
+
+#define RRR_AVERAGER_DEFAULT_VALUE_TAG "measurement"
+#define RRR_AVERAGER_PERCENTILES_MAX 16
+#define RRR_AVERAGER_RING_INITIAL_CAPACITY 64
+
+// Columns for timestamps are stored before the value columns
+#define RRR_AVERAGER_COLUMN_TIMESTAMP_FROM 0
+#define RRR_AVERAGER_COLUMN_TIMESTAMP_TO 1
+#define RRR_AVERAGER_COLUMN_VALUES_BEGIN 2
+
+// Holds sequence numbers of samples in a monotonic order of their
+// values. The front of a min deque is always the minimum value of
+// the samples in the window, and likewise for a max deque.
+struct averager_deque {
+	uint64_t *seqs;
+	uint64_t head;
+	uint64_t tail;
+};
+
+struct averager_column {
+	uint64_t *values;
+	uint64_t sum;
+	struct averager_deque min;
+	struct averager_deque max;
+};
+
+// Samples of a single source are stored in ring buffers with one
+// column per value, indexed by sample sequence number. Capacity is
+// always a power of two.
+struct averager_source {
+	char *topic;
+	uint16_t topic_length;
+	uint64_t capacity;
+	uint64_t head;
+	uint64_t tail;
+	uint64_t *times;
+	rrr_length column_count;
+	struct averager_column columns[];
+};
 
 struct averager_data {
 	struct rrr_instance_runtime_data *thread_data;
-	struct rrr_msg_holder_collection input_list;
 	struct rrr_msg_holder_collection output_list;
 
 	struct rrr_event_collection events;
@@ -59,18 +106,363 @@ struct averager_data {
 	// Set this to 1 to delete incoming messages which are not readings and infos
 	int discard_unknown_messages;
 
+	// Set this to 1 to keep samples until they expire instead of consuming
+	// them when an average is produced
+	int do_sliding_window;
+
+	// Set this to 1 to produce separate averages for each topic
+	int do_per_topic;
+
 	rrr_setting_uint timespan_s;
 	rrr_setting_uint interval_s;
 
 	char *msg_topic;
 	uint16_t msg_topic_length;
+
+	struct rrr_map value_tags;
+	int do_prefix_value_tags;
+
+	uint8_t percentiles[RRR_AVERAGER_PERCENTILES_MAX];
+	rrr_length percentile_count;
+
+	// Sources by topic, or a single source with empty key
+	struct rrr_hash sources;
+
+	// Scratch buffers for extraction and percentile calculation
+	uint64_t *values_tmp;
+	uint64_t *sort_tmp;
+	uint64_t sort_tmp_size;
 };
 
-// In seconds, keep x seconds of readings in the buffer
-#define RRR_DEFAULT_AVERAGER_TIMESPAN_S 15
+static uint64_t averager_deque_count (const struct averager_deque *deque) {
+	return deque->tail - deque->head;
+}
 
-// Create an average/max/min-reading every x seconds
-#define RRR_DEFAULT_AVERAGER_INTERVAL_S 10
+static uint64_t averager_deque_front (const struct averager_deque *deque, uint64_t mask) {
+	return deque->seqs[deque->head & mask];
+}
+
+static uint64_t averager_deque_back (const struct averager_deque *deque, uint64_t mask) {
+	return deque->seqs[(deque->tail - 1) & mask];
+}
+
+static void averager_deque_push (
+		struct averager_deque *deque,
+		uint64_t mask,
+		const uint64_t *values,
+		uint64_t seq,
+		int is_max
+) {
+	const uint64_t value = values[seq & mask];
+
+	// Samples which can never again become the min or max are removed
+	while (averager_deque_count(deque) > 0) {
+		const uint64_t back = values[averager_deque_back(deque, mask) & mask];
+		if (is_max ? back > value : back < value) {
+			break;
+		}
+		deque->tail--;
+	}
+
+	deque->seqs[deque->tail++ & mask] = seq;
+}
+
+static void averager_column_destroy (struct averager_column *column) {
+	RRR_FREE_IF_NOT_NULL(column->values);
+	RRR_FREE_IF_NOT_NULL(column->min.seqs);
+	RRR_FREE_IF_NOT_NULL(column->max.seqs);
+}
+
+static void averager_source_destroy (struct averager_source *source) {
+	for (rrr_length i = 0; i < source->column_count; i++) {
+		averager_column_destroy(&source->columns[i]);
+	}
+	RRR_FREE_IF_NOT_NULL(source->times);
+	RRR_FREE_IF_NOT_NULL(source->topic);
+	rrr_free(source);
+}
+
+static int averager_source_destroy_hash_callback (RRR_HASH_ITERATE_CALLBACK_ARGS) {
+	(void)(key);
+	(void)(key_size);
+	(void)(arg);
+	averager_source_destroy(value);
+	return RRR_HASH_ITERATE_REMOVE;
+}
+
+static void averager_sources_clear (struct averager_data *data) {
+	rrr_hash_iterate(&data->sources, averager_source_destroy_hash_callback, NULL);
+	rrr_hash_clear(&data->sources);
+}
+
+static int averager_ring_move (
+		uint64_t **ring,
+		uint64_t old_capacity,
+		uint64_t new_capacity,
+		uint64_t head,
+		uint64_t tail
+) {
+	uint64_t *new_ring;
+
+	if ((new_ring = rrr_allocate(sizeof(*new_ring) * new_capacity)) == NULL) {
+		return 1;
+	}
+
+	// Sequence numbers are preserved, only positions in the ring change
+	for (uint64_t seq = head; seq != tail; seq++) {
+		new_ring[seq & (new_capacity - 1)] = (*ring)[seq & (old_capacity - 1)];
+	}
+
+	RRR_FREE_IF_NOT_NULL(*ring);
+	*ring = new_ring;
+
+	return 0;
+}
+
+// On error, the source is left in an inconsistent state and must be destroyed
+static int averager_source_grow (struct averager_source *source) {
+	const uint64_t capacity = source->capacity == 0 ? RRR_AVERAGER_RING_INITIAL_CAPACITY : source->capacity * 2;
+
+	if (averager_ring_move(&source->times, source->capacity, capacity, source->head, source->tail) != 0) {
+		goto out_err;
+	}
+
+	for (rrr_length i = 0; i < source->column_count; i++) {
+		struct averager_column *column = &source->columns[i];
+		if (	averager_ring_move(&column->values, source->capacity, capacity, source->head, source->tail) != 0 ||
+			averager_ring_move(&column->min.seqs, source->capacity, capacity, column->min.head, column->min.tail) != 0 ||
+			averager_ring_move(&column->max.seqs, source->capacity, capacity, column->max.head, column->max.tail) != 0
+		) {
+			goto out_err;
+		}
+	}
+
+	source->capacity = capacity;
+
+	return 0;
+
+	out_err:
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		return 1;
+}
+
+static int averager_source_new (
+		struct averager_source **target,
+		const char *topic,
+		uint16_t topic_length,
+		rrr_length column_count
+) {
+	int ret = 0;
+
+	struct averager_source *source;
+
+	if ((source = rrr_allocate_zero(sizeof(*source) + sizeof(source->columns[0]) * column_count)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	source->column_count = column_count;
+
+	if (topic_length > 0) {
+		if ((source->topic = rrr_allocate(topic_length)) == NULL) {
+			RRR_MSG_0("Could not allocate memory for topic in %s\n", __func__);
+			ret = 1;
+			goto out_destroy;
+		}
+		memcpy(source->topic, topic, topic_length);
+		source->topic_length = topic_length;
+	}
+
+	if ((ret = averager_source_grow(source)) != 0) {
+		goto out_destroy;
+	}
+
+	*target = source;
+
+	goto out;
+	out_destroy:
+		averager_source_destroy(source);
+	out:
+		return ret;
+}
+
+static int averager_source_push (
+		struct averager_source *source,
+		uint64_t time,
+		const uint64_t *values
+) {
+	int ret = 0;
+
+	if (source->tail - source->head == source->capacity && (ret = averager_source_grow(source)) != 0) {
+		goto out;
+	}
+
+	const uint64_t mask = source->capacity - 1;
+	const uint64_t seq = source->tail++;
+
+	source->times[seq & mask] = time;
+
+	for (rrr_length i = 0; i < source->column_count; i++) {
+		struct averager_column *column = &source->columns[i];
+
+		column->values[seq & mask] = values[i];
+		column->sum += values[i];
+
+		averager_deque_push(&column->min, mask, column->values, seq, 0);
+		averager_deque_push(&column->max, mask, column->values, seq, 1);
+	}
+
+	out:
+	return ret;
+}
+
+static void averager_source_expire (
+		struct averager_source *source,
+		uint64_t min_time
+) {
+	const uint64_t mask = source->capacity - 1;
+
+	// Samples are assumed to arrive in order of timestamps. Any older samples
+	// arriving out of order are expired once samples before them have expired.
+	while (source->head != source->tail && source->times[source->head & mask] < min_time) {
+		const uint64_t seq = source->head++;
+
+		for (rrr_length i = 0; i < source->column_count; i++) {
+			struct averager_column *column = &source->columns[i];
+
+			column->sum -= column->values[seq & mask];
+
+			if (averager_deque_count(&column->min) > 0 && averager_deque_front(&column->min, mask) == seq) {
+				column->min.head++;
+			}
+			if (averager_deque_count(&column->max) > 0 && averager_deque_front(&column->max, mask) == seq) {
+				column->max.head++;
+			}
+		}
+	}
+}
+
+static void averager_source_reset (
+		struct averager_source *source
+) {
+	source->head = source->tail;
+
+	for (rrr_length i = 0; i < source->column_count; i++) {
+		struct averager_column *column = &source->columns[i];
+		column->sum = 0;
+		column->min.head = column->min.tail;
+		column->max.head = column->max.tail;
+	}
+}
+
+static uint64_t averager_column_min (const struct averager_source *source, const struct averager_column *column) {
+	return column->values[averager_deque_front(&column->min, source->capacity - 1) & (source->capacity - 1)];
+}
+
+static uint64_t averager_column_max (const struct averager_source *source, const struct averager_column *column) {
+	return column->values[averager_deque_front(&column->max, source->capacity - 1) & (source->capacity - 1)];
+}
+
+static int __averager_get_64_from_array (
+		uint64_t *result,
+		struct averager_data *averager_data,
+		const struct rrr_array *array,
+		const char *tag
+) {
+	const struct rrr_type_value *value = NULL;
+
+	int ret = 0;
+
+	*result = 0;
+
+	if ((value = rrr_array_value_get_by_tag_const(array, tag)) == NULL) {
+		RRR_MSG_0("Could not find tag '%s' in array message in averager instance %s, dropping message\n",
+				tag, INSTANCE_D_NAME(averager_data->thread_data));
+		ret = 1;
+		goto out;
+	}
+	if (!RRR_TYPE_IS_64(value->definition->type)) {
+		RRR_MSG_0("Value '%s' from array message in averager instance %s was not of type 64, dropping message\n",
+				tag, INSTANCE_D_NAME(averager_data->thread_data));
+		ret = 1;
+		goto out;
+	}
+
+	*result = *((uint64_t*) value->data);
+
+	out:
+	return ret;
+}
+
+static rrr_length averager_column_count (const struct averager_data *data) {
+	return RRR_AVERAGER_COLUMN_VALUES_BEGIN + (rrr_length) RRR_MAP_COUNT(&data->value_tags);
+}
+
+// Values are extracted once when a message arrives, the message itself is not retained
+static int averager_ingest_message (
+		struct averager_data *data,
+		const struct rrr_msg_msg *message
+) {
+	struct rrr_array array_tmp = {0};
+
+	int ret = 0;
+
+	RRR_DBG_2("averager instance %s ingesting message with timestamp %" PRIu64 "\n",
+			INSTANCE_D_NAME(data->thread_data), message->timestamp);
+
+	uint16_t array_version_dummy;
+	if (rrr_array_message_append_to_array(&array_version_dummy, &array_tmp, message) != 0) {
+		RRR_MSG_0("Could not create array in averager instance %s\n",
+				INSTANCE_D_NAME(data->thread_data));
+		ret = 1;
+		goto out;
+	}
+
+	// NOTE : Missing or invalid values are user caused and not critical
+
+	if (__averager_get_64_from_array(&data->values_tmp[RRR_AVERAGER_COLUMN_TIMESTAMP_FROM], data, &array_tmp, "timestamp_from") != 0) {
+		goto out;
+	}
+	if (__averager_get_64_from_array(&data->values_tmp[RRR_AVERAGER_COLUMN_TIMESTAMP_TO], data, &array_tmp, "timestamp_to") != 0) {
+		goto out;
+	}
+
+	rrr_length i = RRR_AVERAGER_COLUMN_VALUES_BEGIN;
+	RRR_MAP_ITERATE_BEGIN_CONST(&data->value_tags);
+		(void)(node_value);
+		(void)(value_length);
+		if (__averager_get_64_from_array(&data->values_tmp[i++], data, &array_tmp, node_tag) != 0) {
+			goto out;
+		}
+	RRR_MAP_ITERATE_END();
+
+	const char *key = data->do_per_topic ? MSG_TOPIC_PTR(message) : "";
+	const uint16_t key_length = data->do_per_topic ? MSG_TOPIC_LENGTH(message) : 0;
+
+	struct averager_source *source;
+	if ((source = rrr_hash_get(&data->sources, key, key_length)) == NULL) {
+		if ((ret = averager_source_new(&source, key, key_length, averager_column_count(data))) != 0) {
+			goto out;
+		}
+		if ((ret = rrr_hash_set(&data->sources, key, key_length, source)) != 0) {
+			RRR_MSG_0("Failed to store source in averager instance %s\n",
+					INSTANCE_D_NAME(data->thread_data));
+			averager_source_destroy(source);
+			goto out;
+		}
+	}
+
+	if ((ret = averager_source_push(source, message->timestamp, data->values_tmp)) != 0) {
+		rrr_hash_remove(&data->sources, key, key_length);
+		averager_source_destroy(source);
+		goto out;
+	}
+
+	out:
+	rrr_array_clear(&array_tmp);
+	return ret;
+}
 
 // Messages when polling from sender comes in here
 static int averager_poll_callback(RRR_MODULE_POLL_CALLBACK_SIGNATURE) {
@@ -85,9 +477,9 @@ static int averager_poll_callback(RRR_MODULE_POLL_CALLBACK_SIGNATURE) {
 	struct rrr_msg_msg *dup_message = NULL;
 
 	if (MSG_IS_MSG(message) && MSG_IS_ARRAY(message)) {
-		rrr_msg_holder_incref_while_locked(entry);
-		RRR_LL_APPEND(&averager_data->input_list, entry);
-
+		if ((ret = averager_ingest_message(averager_data, message)) != 0) {
+			goto out;
+		}
 		if (averager_data->preserve_point_measurements == 1) {
 			dup_entry = NULL;
 
@@ -140,130 +532,90 @@ static int averager_poll_callback(RRR_MODULE_POLL_CALLBACK_SIGNATURE) {
 		return ret;
 }
 
-static void averager_maintain_buffer(struct averager_data *data) {
-	uint64_t timespan_useconds = data->timespan_s * 1000000;
-	uint64_t time_now = rrr_time_get_64();
-	uint64_t min_time = time_now - timespan_useconds;
-
-	RRR_LL_ITERATE_BEGIN(&data->input_list, struct rrr_msg_holder);
-		rrr_msg_holder_lock(node);
-		struct rrr_msg_msg *message = node->message;
-		if (message->timestamp < min_time) {
-			RRR_LL_ITERATE_SET_DESTROY();
-		}
-		else {
-			rrr_msg_holder_unlock(node);
-		}
-	RRR_LL_ITERATE_END_CHECK_DESTROY(&data->input_list, 0; rrr_msg_holder_decref_while_locked_and_unlock(node));
-}
-
-struct averager_calculation {
-	struct averager_data *data;
-	uint64_t max;
-	uint64_t min;
-	uint64_t sum;
-	uint64_t entries;
-
-	uint64_t timestamp_from;
-	uint64_t timestamp_to;
-	uint64_t timestamp_max;
-	uint64_t timestamp_min;
-};
-
-static int __averager_get_64_from_array (uint64_t *result, struct averager_data *averager_data, struct rrr_array *array, const char *tag) {
-	struct rrr_type_value *value = NULL;
-
+static int averager_spawn_message_value_push (
+		struct rrr_array *array,
+		const struct averager_data *data,
+		const char *value_tag,
+		const char *name,
+		uint64_t value
+) {
 	int ret = 0;
 
-	*result = 0;
+	char *tag_tmp = NULL;
 
-	if ((value = rrr_array_value_get_by_tag(array, tag)) == NULL) {
-		RRR_MSG_0("Could not find tag '%s' in array message in averager instance %s, dropping message\n",
-				tag, INSTANCE_D_NAME(averager_data->thread_data));
-		ret = 1;
-		goto out;
+	if (data->do_prefix_value_tags) {
+		if (rrr_asprintf(&tag_tmp, "%s_%s", value_tag, name) <= 0) {
+			RRR_MSG_0("Could not allocate tag name in %s\n", __func__);
+			ret = 1;
+			goto out;
+		}
 	}
-	if (!RRR_TYPE_IS_64(value->definition->type)) {
-		RRR_MSG_0("Value '%s' from array message in averager instance %s was not of type 64, dropping message\n",
-				tag, INSTANCE_D_NAME(averager_data->thread_data));
-		ret = 1;
+
+	if ((ret = rrr_array_push_value_u64_with_tag(array, tag_tmp != NULL ? tag_tmp : name, value)) != 0) {
+		RRR_MSG_0("Could not push 64-value onto array in %s\n", __func__);
 		goto out;
 	}
 
-	*result = *((uint64_t*) value->data);
-
 	out:
+	RRR_FREE_IF_NOT_NULL(tag_tmp);
 	return ret;
 }
 
-static int averager_process_message (
-		struct averager_data *averager_data,
-		struct averager_calculation *calculation,
-		struct rrr_msg_holder *entry_locked
-) {
-	struct rrr_msg_msg *message = entry_locked->message;
-	struct rrr_array array_tmp = {0};
-
-	int ret = 0;
-
-	RRR_DBG_2("averager instance %s callback got a message from buffer with timestamp %" PRIu64 "\n",
-			INSTANCE_D_NAME(averager_data->thread_data), message->timestamp);
-
-	// NOTE : Not all errors are critical, some are user caused
+static int averager_sort_compare (const void *a, const void *b) {
+	const uint64_t va = *((const uint64_t *) a);
+	const uint64_t vb = *((const uint64_t *) b);
+	return (va > vb) - (va < vb);
+}
 
-	if (!MSG_IS_ARRAY(message)) {
-		RRR_DBG_2 ("Averager: Ignoring a message which is not and array\n");
-		ret = 0;
-		goto out;
+static int averager_spawn_message_percentiles_push (
+		struct rrr_array *array,
+		struct averager_data *data,
+		const struct averager_source *source,
+		const struct averager_column *column,
+		const char *value_tag
+) {
+	const uint64_t count = source->tail - source->head;
+	const uint64_t mask = source->capacity - 1;
+
+	if (data->sort_tmp_size < count) {
+		uint64_t *sort_tmp_new;
+		if ((sort_tmp_new = rrr_reallocate(data->sort_tmp, sizeof(*sort_tmp_new) * source->capacity)) == NULL) {
+			RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+			return 1;
+		}
+		data->sort_tmp = sort_tmp_new;
+		data->sort_tmp_size = source->capacity;
 	}
 
-	uint16_t array_version_dummy;
-	if (rrr_array_message_append_to_array(&array_version_dummy, &array_tmp, message) != 0) {
-		RRR_MSG_0("Could not create array in averager_callback of instance %s\n",
-				INSTANCE_D_NAME(averager_data->thread_data));
-		ret = 1;
-		goto out;
+	for (uint64_t seq = source->head, i = 0; seq != source->tail; seq++, i++) {
+		data->sort_tmp[i] = column->values[seq & mask];
 	}
 
-	uint64_t data_numeric;
-	uint64_t timestamp_from;
-	uint64_t timestamp_to;
+	qsort(data->sort_tmp, rrr_size_from_biglength_bug_const(count), sizeof(*data->sort_tmp), averager_sort_compare);
 
-	if (__averager_get_64_from_array(&data_numeric, averager_data, &array_tmp, "measurement") != 0) {
-		goto out;
-	}
-	if (__averager_get_64_from_array(&timestamp_from, averager_data, &array_tmp, "timestamp_from") != 0) {
-		goto out;
-	}
-	if (__averager_get_64_from_array(&timestamp_to, averager_data, &array_tmp, "timestamp_to") != 0) {
-		goto out;
-	}
+	for (rrr_length i = 0; i < data->percentile_count; i++) {
+		// Nearest rank
+		uint64_t rank = (data->percentiles[i] * count + 99) / 100;
+		if (rank > 0) {
+			rank--;
+		}
 
-	calculation->entries++;
-	calculation->sum += data_numeric;
-	if (data_numeric >= calculation->max) {
-		calculation->max = data_numeric;
-		calculation->timestamp_max = timestamp_from;
-	}
-	if (data_numeric < calculation->min) {
-		calculation->min = data_numeric;
-		calculation->timestamp_min = timestamp_from;
-	}
-	if (timestamp_from < calculation->timestamp_from) {
-		calculation->timestamp_from = timestamp_from;
-	}
-	if (timestamp_to > calculation->timestamp_to) {
-		calculation->timestamp_to = timestamp_to;
+		char name[8];
+		sprintf(name, "p%u", data->percentiles[i]);
+
+		if (averager_spawn_message_value_push(array, data, value_tag, name, data->sort_tmp[rank]) != 0) {
+			return 1;
+		}
 	}
 
-	out:
-	rrr_array_clear(&array_tmp);
-	return ret;
+	return 0;
 }
 
 struct averager_spawn_message_callback_data {
 	struct rrr_array *array_tmp;
 	struct averager_data *data;
+	const char *topic;
+	uint16_t topic_length;
 };
 
 static int averager_spawn_message_callback (struct rrr_msg_holder *new_entry, void *arg) {
@@ -277,8 +629,8 @@ static int averager_spawn_message_callback (struct rrr_msg_holder *new_entry, vo
 			&message,
 			callback_data->array_tmp,
 			rrr_time_get_64(),
-			callback_data->data->msg_topic,
-			callback_data->data->msg_topic_length
+			callback_data->topic,
+			callback_data->topic_length
 	) != 0) {
 		RRR_MSG_0 ("Could not create message in averager_spawn_message of instance %s\n",
 				INSTANCE_D_NAME(callback_data->data->thread_data));
@@ -297,48 +649,62 @@ static int averager_spawn_message_callback (struct rrr_msg_holder *new_entry, vo
 }
 
 static int averager_spawn_message (
-	struct averager_data *data,
-	uint64_t time_from,
-	uint64_t time_to,
-	uint64_t average,
-	uint64_t max,
-	uint64_t min
+		struct averager_data *data,
+		const struct averager_source *source
 ) {
-//	struct rrr_msg_msg *message = NULL;
+	const uint64_t count = source->tail - source->head;
 
 	struct rrr_array array_tmp = {0};
 
 	int ret = 0;
 
-	if (rrr_array_push_value_u64_with_tag(&array_tmp, "timestamp_from", time_from) != 0) {
-		RRR_MSG_0("Could not push 64-value onto array in averager_spawn_message\n");
-		ret = 1;
-		goto out;
-	}
-	if (rrr_array_push_value_u64_with_tag(&array_tmp, "timestamp_to", time_to) != 0) {
-		RRR_MSG_0("Could not push 64-value onto array in averager_spawn_message\n");
-		ret = 1;
-		goto out;
-	}
-	if (rrr_array_push_value_u64_with_tag(&array_tmp, "average", average) != 0) {
-		RRR_MSG_0("Could not push 64-value onto array in averager_spawn_message\n");
-		ret = 1;
-		goto out;
-	}
-	if (rrr_array_push_value_u64_with_tag(&array_tmp, "max", max) != 0) {
-		RRR_MSG_0("Could not push 64-value onto array in averager_spawn_message\n");
-		ret = 1;
-		goto out;
-	}
-	if (rrr_array_push_value_u64_with_tag(&array_tmp, "min", min) != 0) {
+	// Use the maximum timestamp for "to" to make sure values can be written on block device
+	// without newer timestamps getting written before older ones.
+
+	if (rrr_array_push_value_u64_with_tag (
+			&array_tmp,
+			"timestamp_from",
+			averager_column_min(source, &source->columns[RRR_AVERAGER_COLUMN_TIMESTAMP_FROM])
+	) != 0 || rrr_array_push_value_u64_with_tag (
+			&array_tmp,
+			"timestamp_to",
+			averager_column_max(source, &source->columns[RRR_AVERAGER_COLUMN_TIMESTAMP_TO])
+	) != 0) {
 		RRR_MSG_0("Could not push 64-value onto array in averager_spawn_message\n");
 		ret = 1;
 		goto out;
 	}
 
+	rrr_length i = RRR_AVERAGER_COLUMN_VALUES_BEGIN;
+	RRR_MAP_ITERATE_BEGIN_CONST(&data->value_tags);
+		(void)(node_value);
+		(void)(value_length);
+
+		const struct averager_column *column = &source->columns[i++];
+		const uint64_t average = column->sum / count;
+		const uint64_t max = averager_column_max(source, column);
+		const uint64_t min = averager_column_min(source, column);
+
+		RRR_DBG_2 ("Averager instance %s value %s average: %" PRIu64 ", Max: %" PRIu64 ", Min: %" PRIu64 ", Entries: %" PRIu64 "\n",
+				INSTANCE_D_NAME(data->thread_data), node_tag, average, max, min, count);
+
+		if ((ret = averager_spawn_message_value_push(&array_tmp, data, node_tag, "average", average)) != 0 ||
+		    (ret = averager_spawn_message_value_push(&array_tmp, data, node_tag, "max", max)) != 0 ||
+		    (ret = averager_spawn_message_value_push(&array_tmp, data, node_tag, "min", min)) != 0
+		) {
+			goto out;
+		}
+
+		if (data->percentile_count > 0 && (ret = averager_spawn_message_percentiles_push(&array_tmp, data, source, column, node_tag)) != 0) {
+			goto out;
+		}
+	RRR_MAP_ITERATE_END();
+
 	struct averager_spawn_message_callback_data callback_data = {
 			&array_tmp,
-			data
+			data,
+			data->msg_topic != NULL ? data->msg_topic : source->topic,
+			data->msg_topic != NULL ? data->msg_topic_length : source->topic_length
 	};
 
 	if (rrr_message_broker_write_entry (
@@ -362,47 +728,56 @@ static int averager_spawn_message (
 	return ret;
 }
 
-static int averager_calculate_average(struct averager_data *data) {
-	struct averager_calculation calculation = {data, 0, ULONG_MAX, 0, 0, UINT64_MAX, 0, 0, 0};
+struct averager_calculate_callback_data {
+	struct averager_data *data;
+	uint64_t min_time;
+};
 
-	int ret = 0;
+static int averager_calculate_callback (RRR_HASH_ITERATE_CALLBACK_ARGS) {
+	struct averager_calculate_callback_data *callback_data = arg;
+	struct averager_data *data = callback_data->data;
+	struct averager_source *source = value;
 
-	RRR_LL_ITERATE_BEGIN(&data->input_list, struct rrr_msg_holder);
-		rrr_msg_holder_lock(node);
-		if ((ret = averager_process_message(data, &calculation, node)) != 0) {
-			rrr_msg_holder_unlock(node);
-			RRR_LL_ITERATE_LAST();
+	(void)(key);
+	(void)(key_size);
+
+	averager_source_expire(source, callback_data->min_time);
+
+	if (source->head == source->tail) {
+		RRR_DBG_2 ("Averager instance %s: No entries, not averaging\n",
+				INSTANCE_D_NAME(data->thread_data));
+
+		// Sources of topics no longer seen are removed
+		if (data->do_per_topic) {
+			averager_source_destroy(source);
+			return RRR_HASH_ITERATE_REMOVE;
 		}
-		RRR_LL_ITERATE_SET_DESTROY();
-	RRR_LL_ITERATE_END_CHECK_DESTROY(&data->input_list, 0; rrr_msg_holder_decref_while_locked_and_unlock(node));
 
-	if (ret != 0) {
-		goto out;
+		return RRR_HASH_ITERATE_OK;
 	}
 
-	if (calculation.entries == 0) {
-		RRR_DBG_2 ("Averager: No entries, not averaging\n");
-		return ret;
+	if (averager_spawn_message(data, source) != 0) {
+		return RRR_HASH_ITERATE_ERR;
 	}
 
-	uint64_t average = calculation.sum / calculation.entries;
-	RRR_DBG_2 ("Average: %" PRIu64 ", Max: %" PRIu64 ", Min: %" PRIu64 ", Entries: %" PRIu64 "\n", average, calculation.max, calculation.min, calculation.entries);
+	if (!data->do_sliding_window) {
+		averager_source_reset(source);
+	}
 
-	// Use the maximum timestamp for "to" for all three to make sure they can be written on block device
-	// without newer timestamps getting written before older ones.
+	return RRR_HASH_ITERATE_OK;
+}
 
-	ret |= averager_spawn_message (
-			data,
-			calculation.timestamp_from,
-			calculation.timestamp_to,
-			average,
-			calculation.max,
-			calculation.min
-	);
+static int averager_calculate_average(struct averager_data *data) {
+	struct averager_calculate_callback_data callback_data = {
+		data,
+		rrr_time_get_64() - data->timespan_s * 1000000
+	};
+
+	int ret = 0;
 
-	if (ret != 0) {
+	if ((ret = rrr_hash_iterate(&data->sources, averager_calculate_callback, &callback_data)) != 0) {
 		RRR_MSG_0("Error when spawning messages in averager_calculate_average\n");
-		return ret;
+		goto out;
 	}
 
 	out:
@@ -421,8 +796,6 @@ static void averager_event_average (
 
 	struct averager_data *data = arg;
 
-	averager_maintain_buffer(data);
-
 	if (averager_calculate_average(data) != 0) {
 		RRR_MSG_0("Error while calculating in averager instance %s\n",
 				INSTANCE_D_NAME(data->thread_data));
@@ -471,8 +844,11 @@ static int averager_event_broker_data_available (RRR_EVENT_FUNCTION_ARGS) {
 static void averager_data_cleanup(void *arg) {
 	struct averager_data *data = (struct averager_data *) arg;
 	rrr_event_collection_clear(&data->events);
-	rrr_msg_holder_collection_clear (&data->input_list);
 	rrr_msg_holder_collection_clear (&data->output_list);
+	averager_sources_clear(data);
+	rrr_map_clear(&data->value_tags);
+	RRR_FREE_IF_NOT_NULL(data->values_tmp);
+	RRR_FREE_IF_NOT_NULL(data->sort_tmp);
 	RRR_FREE_IF_NOT_NULL(data->msg_topic);
 }
 
@@ -485,6 +861,29 @@ static int averager_data_init(struct averager_data *data, struct rrr_instance_ru
 	return 0;
 }
 
+static int averager_parse_percentile_callback (const char *value, void *arg) {
+	struct averager_data *data = arg;
+
+	char *end = NULL;
+	unsigned long long int percentile = strtoull(value, &end, 10);
+
+	if (end == value || *end != '\0' || percentile > 100) {
+		RRR_MSG_0("Invalid percentile '%s' in avg_percentiles of averager instance %s, must be a number from 0 to 100\n",
+				value, INSTANCE_D_NAME(data->thread_data));
+		return 1;
+	}
+
+	if (data->percentile_count == RRR_AVERAGER_PERCENTILES_MAX) {
+		RRR_MSG_0("Too many percentiles in avg_percentiles of averager instance %s, maximum is %i\n",
+				INSTANCE_D_NAME(data->thread_data), RRR_AVERAGER_PERCENTILES_MAX);
+		return 1;
+	}
+
+	data->percentiles[data->percentile_count++] = (uint8_t) percentile;
+
+	return 0;
+}
+
 static int averager_parse_config (struct averager_data *data, struct rrr_instance_config_data *config) {
 	int ret = 0;
 
@@ -493,6 +892,33 @@ static int averager_parse_config (struct averager_data *data, struct rrr_instanc
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("avg_interval", interval_s, RRR_DEFAULT_AVERAGER_INTERVAL_S);
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO("avg_preserve_points", preserve_point_measurements, 0);
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO("avg_discard_unknowns", discard_unknown_messages, 0);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO("avg_sliding_window", do_sliding_window, 0);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO("avg_per_topic", do_per_topic, 0);
+
+	if ((ret = rrr_instance_config_parse_comma_separated_to_map(&data->value_tags, config, "avg_value_tags")) != 0) {
+		RRR_MSG_0("Failed to parse avg_value_tags in averager instance %s\n", config->name);
+		goto out;
+	}
+
+	if (RRR_MAP_COUNT(&data->value_tags) == 0) {
+		if ((ret = rrr_map_item_add_new(&data->value_tags, RRR_AVERAGER_DEFAULT_VALUE_TAG, NULL)) != 0) {
+			goto out;
+		}
+	}
+	else {
+		// Output tags are prefixed with value tag names when these are explicitly set
+		data->do_prefix_value_tags = 1;
+	}
+
+	if ((ret = rrr_instance_config_traverse_split_commas_silent_fail(config, "avg_percentiles", averager_parse_percentile_callback, data)) != 0) {
+		goto out;
+	}
+
+	if ((data->values_tmp = rrr_allocate(sizeof(*data->values_tmp) * averager_column_count(data))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in averager instance %s\n", config->name);
+		ret = 1;
+		goto out;
+	}
 
 	out:
 	return ret;
@@ -524,8 +950,8 @@ static void *thread_entry_averager(struct rrr_thread *thread) {
 
 	rrr_instance_config_check_all_settings_used(thread_data->init_data.instance_config);
 
-	RRR_DBG_1 ("Averager: Interval: %" PRIrrrbl ", Timespan: %" PRIrrrbl ", Preserve points: %i\n",
-			data->interval_s, data->timespan_s, data->preserve_point_measurements);
+	RRR_DBG_1 ("Averager: Interval: %" PRIrrrbl ", Timespan: %" PRIrrrbl ", Preserve points: %i, Sliding window: %i, Per topic: %i\n",
+			data->interval_s, data->timespan_s, data->preserve_point_measurements, data->do_sliding_window, data->do_per_topic);
 
 	RRR_DBG_1 ("Averager started thread %p\n", thread_data);
 
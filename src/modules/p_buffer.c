@@ -194,6 +194,7 @@ void init(struct rrr_instance_module_data *data) {
 	data->type = RRR_MODULE_TYPE_PROCESSOR;
 	data->operations = module_operations;
 	data->event_functions = event_functions;
+	data->thread_pool_capable = 1;
 }
 
 void unload(void) {
@@ -28,6 +28,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <errno.h>
+
+#ifdef RRR_HAVE_INOTIFY
+#	include <sys/inotify.h>
+#endif
 
 #include "../lib/log.h"
 #include "../lib/allocator.h"
@@ -60,6 +65,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../lib/util/posix.h"
 #include "../lib/util/gnu.h"
 #include "../lib/util/fs.h"
+#include "../lib/util/hash.h"
 #include "../lib/input/input.h"
 #include "../lib/serial/serial.h"
 #include "../lib/socket/rrr_socket_client.h"
@@ -73,6 +79,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_FILE_DEFAULT_TTL 0
 #define RRR_FILE_MAX_SIZE_MB 32
 
+#ifdef RRR_HAVE_INOTIFY
+#	define RRR_FILE_INOTIFY_MASK (IN_CREATE|IN_MODIFY|IN_CLOSE_WRITE|IN_MOVED_TO|IN_ONLYDIR)
+#endif
+
 #define RRR_FILE_F_IS_KEYBOARD (1<<0)
 #define RRR_FILE_F_IS_SERIAL (1<<1)
 
@@ -104,6 +114,8 @@ struct file {
 
 struct file_collection {
 	RRR_LL_HEAD(struct file);
+	struct rrr_hash by_orig_path;
+	struct rrr_hash by_fd;
 };
 
 enum file_read_method {
@@ -132,6 +144,7 @@ struct file_data {
 	int do_serial_one_stop_bit;
 	int do_serial_two_stop_bits;
 	int do_no_probing;
+	int do_inotify;
 	int do_write_allow_directory_override;
 	int do_write_append;
 	int do_write_multicast;
@@ -176,6 +189,12 @@ struct file_data {
 	struct rrr_event_collection events;
 	rrr_event_handle event_probe;
 	rrr_event_handle event_stats;
+	rrr_event_handle event_inotify;
+
+	// Set while the directory is watched using inotify, periodic
+	// probing is then only performed when probe_pending is set.
+	int inotify_fd;
+	int probe_pending;
 
 	struct rrr_socket_client_collection *write_only_sockets;
 	struct rrr_socket_client_collection *read_write_sockets;
@@ -189,39 +208,32 @@ static void file_destroy(struct file *file) {
 }
 
 static struct file *file_collection_get_by_orig_path (const struct file_collection *files, const char *orig_path) {
-	RRR_LL_ITERATE_BEGIN(files, struct file);
-		if (strcmp(orig_path, node->orig_path) == 0) {
-			return node;
-		}
-	RRR_LL_ITERATE_END();
-	return NULL;
+	return rrr_hash_get_str(&files->by_orig_path, orig_path);
 }
 
 static struct file *file_collection_get_by_fd (const struct file_collection *files, int fd) {
-	RRR_LL_ITERATE_BEGIN(files, struct file);
-		if (node->fd == fd) {
-			return node;
-		}
-	RRR_LL_ITERATE_END();
-	return NULL;
+	return rrr_hash_get_u64(&files->by_fd, (uint64_t) fd);
 }
 
 static void file_collection_remove (struct file_collection *files, struct file *file) {
-	RRR_LL_ITERATE_BEGIN(files, struct file);
-		if (node == file) {
-			RRR_LL_ITERATE_SET_DESTROY();
-			RRR_LL_ITERATE_LAST();
-		}
-	RRR_LL_ITERATE_END_CHECK_DESTROY(files, 0; file_destroy(node));
+	rrr_hash_remove_str(&files->by_orig_path, file->orig_path);
+	rrr_hash_remove_u64(&files->by_fd, (uint64_t) file->fd);
+	RRR_LL_REMOVE_NODE_NO_FREE(files, file);
+	file_destroy(file);
 }
 
 static void file_collection_remove_by_fd (struct file_collection *files, int fd) {
-	RRR_LL_ITERATE_BEGIN(files, struct file);
-		if (node->fd == fd) {
-			RRR_LL_ITERATE_SET_DESTROY();
-			RRR_LL_ITERATE_LAST();
-		}
-	RRR_LL_ITERATE_END_CHECK_DESTROY(files, 0; file_destroy(node));
+	struct file *file;
+	if ((file = file_collection_get_by_fd(files, fd)) == NULL) {
+		return;
+	}
+	file_collection_remove(files, file);
+}
+
+static void file_collection_clear (struct file_collection *files) {
+	rrr_hash_clear(&files->by_orig_path);
+	rrr_hash_clear(&files->by_fd);
+	RRR_LL_DESTROY(files, struct file, file_destroy(node));
 }
 
 static int file_collection_count (const struct file_collection *files) {
@@ -328,10 +340,25 @@ static int file_collection_push (
 		goto out;
 	}
 
+	if (rrr_hash_set_str(&files->by_orig_path, file->orig_path, file) != 0) {
+		ret = 1;
+		goto out_destroy;
+	}
+
+	if (rrr_hash_set_u64(&files->by_fd, (uint64_t) fd, file) != 0) {
+		rrr_hash_remove_str(&files->by_orig_path, file->orig_path);
+		ret = 1;
+		goto out_destroy;
+	}
+
 	RRR_LL_PUSH(files, file);
 
+	goto out;
+	out_destroy:
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		file_destroy(file);
 	out:
-	return ret;
+		return ret;
 }
 
 static int file_data_init(struct file_data *data, struct rrr_instance_runtime_data *thread_data) {
@@ -347,6 +374,9 @@ static int file_data_init(struct file_data *data, struct rrr_instance_runtime_da
 static void file_data_cleanup(void *arg) {
 	struct file_data *data = (struct file_data *) arg;
 	rrr_event_collection_clear(&data->events);
+	if (data->inotify_fd > 0) {
+		rrr_socket_close(data->inotify_fd);
+	}
 	if (data->write_only_sockets != NULL) {
 		rrr_socket_client_collection_destroy(data->write_only_sockets);
 	}
@@ -356,7 +386,7 @@ static void file_data_cleanup(void *arg) {
 	if (data->send_loop != NULL) {
 		rrr_send_loop_destroy(data->send_loop);
 	}
-	RRR_LL_DESTROY (&data->files, struct file, file_destroy(node));
+	file_collection_clear(&data->files);
 	if (data->tree != NULL) {
 		rrr_array_tree_destroy(data->tree);
 	}
@@ -401,6 +431,13 @@ static int file_parse_config (struct file_data *data, struct rrr_instance_config
 
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO("file_no_probing", do_no_probing, 0);
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("file_probe_interval_ms", probe_interval, RRR_FILE_DEFAULT_PROBE_INTERVAL_MS);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO("file_inotify", do_inotify, 0);
+#ifndef RRR_HAVE_INOTIFY
+	if (data->do_inotify) {
+		RRR_MSG_0("Warning: Parameter file_inotify was set in file instance %s but inotify is not supported on this platform, using periodic probing\n", config->name);
+		data->do_inotify = 0;
+	}
+#endif
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("file_prefix", prefix);
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_TOPIC("file_topic", topic, topic_len);
 
@@ -886,6 +923,146 @@ static int file_probe (struct file_data *data, const char *directory, const char
 	);
 }
 
+#ifdef RRR_HAVE_INOTIFY
+static int file_inotify_probe_callback (
+		struct dirent *entry,
+		const char *orig_path,
+		const char *resolved_path,
+		unsigned char type,
+		void *private_data
+) {
+	struct file_data *data = private_data;
+
+	(void)(entry);
+
+	int ret = 0;
+
+	int fd;
+	if ((ret = file_open_as_needed(&fd, data, orig_path, resolved_path, type)) == RRR_FILE_BUSY) {
+		// Too many open files, pick up the file during next probe
+		data->probe_pending = 1;
+		ret = 0;
+	}
+
+	return ~(RRR_FILE_SOFT_ERROR) & ret;
+}
+
+static void file_inotify_stop (struct file_data *data) {
+	if (data->inotify_fd <= 0) {
+		return;
+	}
+
+	EVENT_REMOVE(data->event_inotify);
+	rrr_socket_close(data->inotify_fd);
+
+	data->inotify_fd = 0;
+}
+
+static void file_event_inotify (
+		evutil_socket_t fd,
+		short flags,
+		void *arg
+) {
+	struct file_data *data = arg;
+
+	(void)(flags);
+
+	RRR_EVENT_HOOK();
+
+	char buf[8192] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	ssize_t bytes;
+
+	while ((bytes = read(fd, buf, sizeof(buf))) > 0) {
+		const char *pos = buf;
+		while (pos < buf + bytes) {
+			const struct inotify_event *event = (const struct inotify_event *) pos;
+			pos += sizeof(*event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				RRR_DBG_3("file instance %s inotify queue overflow, probing directory\n",
+						INSTANCE_D_NAME(data->thread_data));
+				data->probe_pending = 1;
+				continue;
+			}
+
+			if (event->mask & IN_IGNORED) {
+				// Directory was removed or unmounted
+				RRR_MSG_0("Warning: inotify watch of directory '%s' removed in file instance %s, falling back to periodic probing\n",
+						data->directory, INSTANCE_D_NAME(data->thread_data));
+				file_inotify_stop(data);
+				return;
+			}
+
+			if (event->len == 0 || (event->mask & IN_ISDIR)) {
+				continue;
+			}
+
+			if (rrr_readdir_single_prefix (
+					data->directory,
+					event->name,
+					data->prefix, // NULL allowed
+					file_inotify_probe_callback,
+					data
+			) != 0) {
+				rrr_event_dispatch_break(INSTANCE_D_EVENTS(data->thread_data));
+				return;
+			}
+		}
+	}
+
+	if (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+		RRR_MSG_0("Warning: Failed to read inotify events in file instance %s, falling back to periodic probing: %s\n",
+				INSTANCE_D_NAME(data->thread_data), rrr_strerror(errno));
+		file_inotify_stop(data);
+		return;
+	}
+
+	if (data->probe_pending) {
+		EVENT_ACTIVATE(data->event_probe);
+	}
+}
+
+static int file_inotify_start (struct file_data *data) {
+	int fd;
+
+	// Failure is not critical, periodic probing is used instead
+	if ((fd = rrr_socket_inotify(INSTANCE_D_NAME(data->thread_data))) <= 0) {
+		goto out_fallback;
+	}
+
+	if (inotify_add_watch(fd, data->directory, RRR_FILE_INOTIFY_MASK) < 0) {
+		RRR_MSG_0("Warning: Could not watch directory '%s' using inotify in file instance %s: %s\n",
+				data->directory, INSTANCE_D_NAME(data->thread_data), rrr_strerror(errno));
+		goto out_close;
+	}
+
+	if (rrr_event_collection_push_read (
+			&data->event_inotify,
+			&data->events,
+			fd,
+			file_event_inotify,
+			data,
+			0
+	) != 0) {
+		RRR_MSG_0("Failed to create inotify event in file instance %s\n", INSTANCE_D_NAME(data->thread_data));
+		rrr_socket_close(fd);
+		return 1;
+	}
+
+	EVENT_ADD(data->event_inotify);
+
+	data->inotify_fd = fd;
+
+	return 0;
+	out_close:
+		rrr_socket_close(fd);
+	out_fallback:
+		RRR_MSG_0("Warning: Falling back to periodic probing in file instance %s\n",
+				INSTANCE_D_NAME(data->thread_data));
+		return 0;
+}
+#endif /* RRR_HAVE_INOTIFY */
+
 struct file_probe_excact_callback_data {
 	struct file_data *data;
 	const char *expected_orig_path;
@@ -2014,6 +2191,13 @@ static void file_event_probe (
 
 	RRR_EVENT_HOOK();
 
+	// New files are opened as they appear while inotify is active
+	if (data->inotify_fd > 0 && !data->probe_pending) {
+		return;
+	}
+
+	data->probe_pending = 0;
+
 	if (file_probe(data, data->directory, data->prefix) != 0) {
 		rrr_event_dispatch_break(INSTANCE_D_EVENTS(data->thread_data));
 	}
@@ -2078,11 +2262,12 @@ static void *thread_entry_file (struct rrr_thread *thread) {
 
 	rrr_instance_config_check_all_settings_used(thread_data->init_data.instance_config);
 
-	RRR_DBG_1 ("File %p instance %s probe interval is %" PRIrrrbl " ms%s in directory '%s' with prefix '%s'\n",
+	RRR_DBG_1 ("File %p instance %s probe interval is %" PRIrrrbl " ms%s%s in directory '%s' with prefix '%s'\n",
 			thread_data,
 			INSTANCE_D_NAME(thread_data),
 			data->probe_interval,
 			(data->do_no_probing ? " (but probing disabled)" : ""),
+			(data->do_inotify && !data->do_no_probing ? " (inotify enabled)" : ""),
 			(data->directory != NULL ? data->directory : ""),
 			(data->prefix != NULL ? data->prefix : "")
 	);
@@ -2233,7 +2418,17 @@ static void *thread_entry_file (struct rrr_thread *thread) {
 		}
 
 		EVENT_ADD(data->event_probe);
-		EVENT_ACTIVATE(data->event_probe); // Probe immediately when starting
+
+#ifdef RRR_HAVE_INOTIFY
+		if (data->do_inotify && file_inotify_start(data) != 0) {
+			goto out_cleanup;
+		}
+#endif
+
+		// Probe immediately when starting, also when inotify is used
+		// to pick up files already present in the directory
+		data->probe_pending = 1;
+		EVENT_ACTIVATE(data->event_probe);
 	}
 
 	if (rrr_event_collection_push_periodic (
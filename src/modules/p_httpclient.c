@@ -174,6 +174,7 @@ struct httpclient_data {
 	rrr_setting_uint message_low_pri_timeout_factor;
 
 	rrr_setting_uint redirects_max;
+	rrr_setting_uint keepalive_timeout_ms;
 
 	struct rrr_event_collection events;
 	rrr_event_handle event_msgdb_poll;
@@ -2074,6 +2075,15 @@ static int httpclient_parse_config (
 
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("http_max_redirects", redirects_max, RRR_HTTPCLIENT_DEFAULT_REDIRECTS_MAX);
 
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("http_keepalive_timeout_ms", keepalive_timeout_ms, RRR_HTTPCLIENT_DEFAULT_KEEPALIVE_MAX_S * 1000);
+
+	if (data->keepalive_timeout_ms < 100) {
+		RRR_MSG_0("Parameter http_keepalive_timeout_ms was too small in httpclient instance %s, minimum value is 100.\n",
+				config->name);
+		ret = 1;
+		goto out;
+	}
+
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("http_accept", http_header_accept);
 
 	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UTF8_DEFAULT_NULL("http_msgdb_socket", msgdb_socket);
@@ -2408,6 +2418,22 @@ static void httpclient_update_stats(struct httpclient_data *data) {
 	rrr_stats_instance_post_unsigned_base10_text(stats, "from_senders_queue_count", 0, RRR_LL_COUNT(&data->from_senders_queue));
 	rrr_stats_instance_post_unsigned_base10_text(stats, "redirect_queue_count", 0, RRR_LL_COUNT(&data->redirect_queue));
 	rrr_stats_instance_post_unsigned_base10_text(stats, "low_pri_queue_count", 0, RRR_LL_COUNT(&data->low_pri_queue));
+
+	struct rrr_net_transport_tls_stats tls_stats;
+	rrr_http_client_tls_stats_get(&tls_stats, data->http_client);
+
+	rrr_stats_instance_post_unsigned_base10_text(stats, "tls_handshakes", 0, tls_stats.handshakes);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "tls_handshakes_resumed", 0, tls_stats.handshakes_resumed);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "tls_ktls_send", 0, tls_stats.ktls_send);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "tls_ktls_recv", 0, tls_stats.ktls_recv);
+
+	struct rrr_http_client_pool_stats pool_stats;
+	rrr_http_client_pool_stats_get(&pool_stats, data->http_client);
+
+	rrr_stats_instance_post_unsigned_base10_text(stats, "pool_connections", 0, pool_stats.connections);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "pool_connections_opened", 0, pool_stats.connections_opened);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "pool_requests_reused", 0, pool_stats.requests_reused);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "pool_requests_busy", 0, pool_stats.requests_busy);
 }
 
 static int httpclient_event_periodic (RRR_EVENT_FUNCTION_PERIODIC_ARGS) {
@@ -2789,7 +2815,7 @@ static void *thread_entry_httpclient (struct rrr_thread *thread) {
 	if (rrr_http_client_new (
 			&data->http_client,
 			INSTANCE_D_EVENTS(thread_data),
-			RRR_HTTPCLIENT_DEFAULT_KEEPALIVE_MAX_S * 1000,
+			data->keepalive_timeout_ms,
 			RRR_HTTPCLIENT_SEND_CHUNK_COUNT_LIMIT,
 			&callbacks
 	) != 0) {
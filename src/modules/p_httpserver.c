@@ -52,6 +52,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../lib/messages/msg_msg.h"
 #include "../lib/ip/ip_defines.h"
 #include "../lib/util/gnu.h"
+#include "../lib/util/hash.h"
+#include "../lib/util/linked_list.h"
 #include "../lib/helpers/string_builder.h"
 #include "../lib/message_holder/message_holder.h"
 #include "../lib/message_holder/message_holder_struct.h"
@@ -77,6 +79,32 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define RRR_HTTPSERVER_REQUEST_TOPIC_PREFIX                   "httpserver/request/"
 #define RRR_HTTPSERVER_WEBSOCKET_TOPIC_PREFIX                 "httpserver/websocket/"
 
+#define RRR_HTTPSERVER_RESPONSE_WHEEL_SLOTS       64
+#define RRR_HTTPSERVER_RESPONSE_WHEEL_TICK_US     (100 * 1000)
+#define RRR_HTTPSERVER_LATENCY_BUCKETS            13
+
+// Responses from senders with a topic matching an outstanding request are
+// indexed by the unique id of the request as they are polled. Each entry is
+// also placed in a timer wheel slot by its expiry time so that unclaimed
+// responses can be removed without scanning all of them.
+
+struct httpserver_response_entry {
+	RRR_LL_NODE(struct httpserver_response_entry);
+	struct rrr_msg_holder *entry;
+	rrr_http_unique_id unique_id;
+	uint64_t expire_time;
+};
+
+struct httpserver_response_entry_collection {
+	RRR_LL_HEAD(struct httpserver_response_entry);
+};
+
+struct httpserver_response_index {
+	struct rrr_hash entries;
+	struct httpserver_response_entry_collection wheel[RRR_HTTPSERVER_RESPONSE_WHEEL_SLOTS];
+	uint64_t wheel_tick;
+};
+
 struct httpserver_data {
 	struct rrr_instance_runtime_data *thread_data;
 	struct rrr_net_transport_config net_transport_config;
@@ -115,6 +143,12 @@ struct httpserver_data {
 
 	struct rrr_poll_helper_counters counters;
 	struct rrr_fifo buffer;
+	struct httpserver_response_index response_index;
+
+	// Round trip times for responses from senders, bucket n counts
+	// responses received in less than 2^n ms. The last bucket counts
+	// the rest.
+	uint64_t response_latency_histogram[RRR_HTTPSERVER_LATENCY_BUCKETS];
 
 	struct rrr_map websocket_topic_filters;
 
@@ -132,6 +166,135 @@ struct httpserver_data {
 	int do_fail_once;
 };
 
+static void httpserver_response_entry_destroy (
+		struct httpserver_response_entry *response_entry
+) {
+	rrr_msg_holder_decref(response_entry->entry);
+	rrr_free(response_entry);
+}
+
+static struct httpserver_response_entry_collection *httpserver_response_index_slot (
+		struct httpserver_response_index *index,
+		uint64_t time
+) {
+	return &index->wheel[(time / RRR_HTTPSERVER_RESPONSE_WHEEL_TICK_US) % RRR_HTTPSERVER_RESPONSE_WHEEL_SLOTS];
+}
+
+static void httpserver_response_index_clear (
+		struct httpserver_response_index *index
+) {
+	for (size_t i = 0; i < RRR_HTTPSERVER_RESPONSE_WHEEL_SLOTS; i++) {
+		RRR_LL_DESTROY(&index->wheel[i], struct httpserver_response_entry, httpserver_response_entry_destroy(node));
+	}
+	rrr_hash_clear(&index->entries);
+}
+
+// Entry must be locked, a reference is taken upon success
+static int httpserver_response_index_push (
+		struct httpserver_response_index *index,
+		rrr_http_unique_id unique_id,
+		struct rrr_msg_holder *entry,
+		uint64_t expire_time
+) {
+	struct httpserver_response_entry *response_entry;
+
+	if ((response_entry = rrr_allocate_zero(sizeof(*response_entry))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		return 1;
+	}
+
+	if (rrr_hash_set_u64(&index->entries, unique_id, response_entry) != 0) {
+		RRR_MSG_0("Could not add response to index in %s\n", __func__);
+		rrr_free(response_entry);
+		return 1;
+	}
+
+	rrr_msg_holder_incref_while_locked(entry);
+
+	response_entry->entry = entry;
+	response_entry->unique_id = unique_id;
+	response_entry->expire_time = expire_time;
+
+	// Start the wheel when the first entry is added, or slots passed before
+	// the first expiry run would not be visited until the next rotation
+	if (index->wheel_tick == 0) {
+		index->wheel_tick = rrr_time_get_64() / RRR_HTTPSERVER_RESPONSE_WHEEL_TICK_US;
+	}
+
+	RRR_LL_APPEND(httpserver_response_index_slot(index, expire_time), response_entry);
+
+	return 0;
+}
+
+// Caller takes over the reference of any returned entry
+static struct rrr_msg_holder *httpserver_response_index_take (
+		struct httpserver_response_index *index,
+		rrr_http_unique_id unique_id
+) {
+	struct httpserver_response_entry *response_entry;
+	struct rrr_msg_holder *entry;
+
+	if ((response_entry = rrr_hash_remove_u64(&index->entries, unique_id)) == NULL) {
+		return NULL;
+	}
+
+	RRR_LL_REMOVE_NODE_NO_FREE(httpserver_response_index_slot(index, response_entry->expire_time), response_entry);
+
+	entry = response_entry->entry;
+	rrr_free(response_entry);
+
+	return entry;
+}
+
+// Only slots passed since the previous call are visited, and entries
+// expiring in a later rotation of the wheel are left in place.
+static rrr_length httpserver_response_index_expire (
+		struct httpserver_response_index *index,
+		uint64_t time_now
+) {
+	const uint64_t tick_now = time_now / RRR_HTTPSERVER_RESPONSE_WHEEL_TICK_US;
+
+	rrr_length expired_count = 0;
+
+	if (index->wheel_tick == 0 || index->wheel_tick > tick_now) {
+		index->wheel_tick = tick_now;
+	}
+
+	uint64_t ticks = tick_now - index->wheel_tick + 1;
+	if (ticks > RRR_HTTPSERVER_RESPONSE_WHEEL_SLOTS) {
+		ticks = RRR_HTTPSERVER_RESPONSE_WHEEL_SLOTS;
+	}
+
+	for (uint64_t i = 0; i < ticks; i++) {
+		struct httpserver_response_entry_collection *slot = &index->wheel[(index->wheel_tick + i) % RRR_HTTPSERVER_RESPONSE_WHEEL_SLOTS];
+		RRR_LL_ITERATE_BEGIN(slot, struct httpserver_response_entry);
+			if (node->expire_time <= time_now) {
+				rrr_hash_remove_u64(&index->entries, node->unique_id);
+				RRR_LL_ITERATE_SET_DESTROY();
+				expired_count++;
+			}
+		RRR_LL_ITERATE_END_CHECK_DESTROY(slot, 0; httpserver_response_entry_destroy(node));
+	}
+
+	index->wheel_tick = tick_now;
+
+	return expired_count;
+}
+
+static void httpserver_response_latency_register (
+		struct httpserver_data *data,
+		uint64_t latency_us
+) {
+	const uint64_t latency_ms = latency_us / 1000;
+
+	size_t bucket = 0;
+	while (bucket < RRR_HTTPSERVER_LATENCY_BUCKETS - 1 && latency_ms >= ((uint64_t) 1 << bucket)) {
+		bucket++;
+	}
+
+	data->response_latency_histogram[bucket]++;
+}
+
 static void httpserver_data_cleanup(void *arg) {
 	struct httpserver_data *data = arg;
 	rrr_net_transport_config_cleanup(&data->net_transport_config);
@@ -139,6 +302,7 @@ static void httpserver_data_cleanup(void *arg) {
 	rrr_map_clear(&data->websocket_topic_filters);
 	rrr_string_builder_clear(&data->alt_svc_header);
 	rrr_fifo_destroy(&data->buffer);
+	httpserver_response_index_clear(&data->response_index);
 	RRR_FREE_IF_NOT_NULL(data->allow_origin_header);
 	RRR_FREE_IF_NOT_NULL(data->cache_control_header);
 	RRR_FREE_IF_NOT_NULL(data->topic_format);
@@ -1302,24 +1466,14 @@ static int httpserver_async_response_get_and_process (
 		? response_data->request_topic_filter_long
 		: response_data->request_topic_base;
 
-	struct httpserver_async_response_get_callback_data callback_data = {
-		NULL,
-		topic_filter_use
-	};
+	struct rrr_msg_holder *entry = httpserver_response_index_take(&data->response_index, transaction->unique_id);
 
-	if ((ret = rrr_fifo_search (
-			&data->buffer,
-			httpserver_async_response_get_fifo_callback,
-			&callback_data
-	)) != 0) {
-		RRR_MSG_0("Error from poll in %s\n", __func__);
-		goto out;
-	}
+	const uint64_t time_now = rrr_time_get_64();
 
 	if (data->response_timeout_ms == 0) {
 		// No timeout
 	}
-	else if (rrr_time_get_64() > response_data->time_begin + data->response_timeout_ms * 1000) {
+	else if (time_now > response_data->time_begin + data->response_timeout_ms * 1000) {
 		RRR_DBG_3("Timeout while waiting for response from senders with topic filter '%s' in httpserver instance %s\n",
 			topic_filter_use, INSTANCE_D_NAME(data->thread_data));
 		transaction->response_part->response_code = 504; // Gateway timeout
@@ -1327,16 +1481,18 @@ static int httpserver_async_response_get_and_process (
 		goto out;
 	}
 
-	if (callback_data.entry != NULL) {
+	if (entry != NULL) {
 		RRR_DBG_3("httpserver instance %s got a response from senders with topic filter '%s'\n",
 				INSTANCE_D_NAME(data->thread_data), topic_filter_use);
 
-		rrr_msg_holder_lock(callback_data.entry);
+		httpserver_response_latency_register(data, time_now - response_data->time_begin);
+
+		rrr_msg_holder_lock(entry);
 		ret = httpserver_async_response_get_extract_data (
 				&target_array,
-				(struct rrr_msg_msg *) callback_data.entry->message
+				(struct rrr_msg_msg *) entry->message
 		);
-		rrr_msg_holder_unlock(callback_data.entry);
+		rrr_msg_holder_unlock(entry);
 
 		if (ret != 0) {
 			goto out;
@@ -1355,7 +1511,9 @@ static int httpserver_async_response_get_and_process (
 
 	out:
 	rrr_array_clear(&target_array);
-	httpserver_async_response_get_callback_data_cleanup(&callback_data);
+	if (entry != NULL) {
+		rrr_msg_holder_decref(entry);
+	}
 	return ret;
 
 }
@@ -2077,11 +2235,73 @@ static int httpserver_poll_callback_write (RRR_FIFO_WRITE_CALLBACK_ARGS) {
 	return RRR_FIFO_OK;
 }
 
+// Returns 0 if the topic is that of a response to a request, which is
+// the request topic base optionally followed by a subtopic when topic
+// formatting is active. This corresponds to the topic filters used in
+// the request.
+static int httpserver_response_topic_unique_id_get (
+		rrr_http_unique_id *unique_id,
+		const struct httpserver_data *data,
+		const struct rrr_msg_msg *msg
+) {
+	const char *pos = MSG_TOPIC_PTR(msg);
+	const char *end = MSG_TOPIC_PTR(msg) + MSG_TOPIC_LENGTH(msg);
+	const size_t prefix_length = strlen(RRR_HTTPSERVER_REQUEST_TOPIC_PREFIX);
+
+	rrr_http_unique_id result = 0;
+
+	if ((size_t) (end - pos) <= prefix_length || memcmp(pos, RRR_HTTPSERVER_REQUEST_TOPIC_PREFIX, prefix_length) != 0) {
+		return 1;
+	}
+
+	pos += prefix_length;
+
+	const char *digits_begin = pos;
+	for (; pos < end && *pos >= '0' && *pos <= '9'; pos++) {
+		const rrr_http_unique_id digit = (rrr_http_unique_id) (*pos - '0');
+		if (result > (UINT64_MAX - digit) / 10) {
+			return 1;
+		}
+		result = result * 10 + digit;
+	}
+
+	if (pos == digits_begin) {
+		return 1;
+	}
+
+	if (pos < end && (*pos != '/' || !data->do_topic_format_request)) {
+		return 1;
+	}
+
+	*unique_id = result;
+
+	return 0;
+}
+
 static int httpserver_poll_callback (RRR_MODULE_POLL_CALLBACK_SIGNATURE) {
 	struct rrr_instance_runtime_data *thread_data = arg;
 	struct httpserver_data *data = thread_data->private_data;
 
-	int ret = rrr_fifo_write(&data->buffer, httpserver_poll_callback_write, entry);
+	int ret = 0;
+
+	rrr_http_unique_id unique_id;
+
+	if (httpserver_response_topic_unique_id_get(&unique_id, data, entry->message) == 0 &&
+	    rrr_hash_get_u64(&data->response_index.entries, unique_id) == NULL
+	) {
+		ret = httpserver_response_index_push (
+				&data->response_index,
+				unique_id,
+				entry,
+				rrr_time_get_64() + data->response_timeout_ms * 1000
+		);
+	}
+	else {
+		// Websocket responses, responses with duplicate unique ids and
+		// other messages are stored in the buffer
+		ret = rrr_fifo_write(&data->buffer, httpserver_poll_callback_write, entry);
+	}
+
 	rrr_msg_holder_unlock(entry);
 	return ret;
 }
@@ -2146,6 +2366,26 @@ static int httpserver_event_periodic (RRR_EVENT_FUNCTION_PERIODIC_ARGS) {
 		return 1;
 	}
 
+	const rrr_length expired_count = httpserver_response_index_expire(&data->response_index, rrr_time_get_64());
+	if (expired_count > 0) {
+		RRR_DBG_1("httpserver instance %s deleted %" PRIrrrl " responses from senders which have timed out\n",
+				INSTANCE_D_NAME(thread_data), expired_count);
+	}
+
+	if (data->do_get_response_from_senders) {
+		char path[32];
+		for (size_t i = 0; i < RRR_HTTPSERVER_LATENCY_BUCKETS; i++) {
+			if (i < RRR_HTTPSERVER_LATENCY_BUCKETS - 1) {
+				sprintf(path, "response_latency/lt_%llums", 1ULL << i);
+			}
+			else {
+				sprintf(path, "response_latency/ge_%llums", 1ULL << (i - 1));
+			}
+			rrr_stats_instance_post_unsigned_base10_text(INSTANCE_D_STATS(thread_data), path, 0, data->response_latency_histogram[i]);
+		}
+		rrr_stats_instance_post_unsigned_base10_text(INSTANCE_D_STATS(thread_data), "response_index_count", 0, RRR_HASH_COUNT(&data->response_index.entries));
+	}
+
 	return 0;
 }
 
@@ -41,6 +41,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../lib/message_holder/message_holder.h"
 #include "../lib/message_holder/message_holder_struct.h"
 #include "../lib/message_holder/message_holder_util.h"
+#include "../lib/message_helper.h"
 #include "../lib/map.h"
 #include "../lib/mqtt/mqtt_topic.h"
 #include "../lib/msgdb/msgdb_client.h"
@@ -553,9 +554,7 @@ static int incrementer_poll_callback (RRR_MODULE_POLL_CALLBACK_SIGNATURE) {
 
 	// Do not produce errors for message process failures, just drop them
 
-	if (MSG_TOPIC_LENGTH((const struct rrr_msg_msg *) entry->message) > 0 &&
-	    rrr_msg_msg_topic_match(&does_match, (const struct rrr_msg_msg *) entry->message, data->subject_topic_filter_token) != 0
-	) {
+	if (rrr_message_helper_entry_topic_match(&does_match, entry, data->subject_topic_filter_token) != 0) {
 		RRR_MSG_0("Error while checking subject topic in incrementer_poll_callback of instance %s, dropping message\n",
 			INSTANCE_D_NAME(thread_data));
 		goto out;
@@ -711,6 +710,7 @@ void init(struct rrr_instance_module_data *data) {
 	data->type = RRR_MODULE_TYPE_PROCESSOR;
 	data->operations = module_operations;
 	data->event_functions = event_functions;
+	data->thread_pool_capable = 1;
 }
 
 void unload(void) {
@@ -104,6 +104,7 @@ struct modbus_command_node {
 	uint64_t last_seen_time;
 	uint64_t send_time;
 	uint64_t interval_ms;
+	int send_pending;
 	char *response_topic;
 	rrr_u16 response_topic_length;
 	struct modbus_command command;
@@ -122,6 +123,7 @@ struct modbus_data {
 	struct modbus_command_collection commands;
 	struct rrr_event_collection events;
 	rrr_event_handle event_process;
+	int do_coalesce_reads;
 };
 
 struct modbus_client_data {
@@ -132,10 +134,21 @@ struct modbus_client_data {
 	struct rrr_modbus_client *client;
 };
 
+// Part of a coalesced read, the response is split back into one
+// message for each part
+struct modbus_transaction_part {
+	char *response_topic;
+	rrr_u16 response_topic_length;
+	uint16_t starting_address;
+	uint16_t quantity;
+};
+
 struct modbus_transaction_data {
 	char *response_topic;
 	rrr_u16 response_topic_length;
 	struct modbus_command command;
+	struct modbus_transaction_part *parts;
+	size_t part_count;
 };
 
 static void modbus_command_node_destroy (struct modbus_command_node *node) {
@@ -217,6 +230,7 @@ static void modbus_command_node_update (
 	if (first) {
 		EVENT_ADD(node->event);
 	}
+	node->send_pending = 1;
 	EVENT_ACTIVATE(node->event);
 
 	if (interval_ms > 0) {
@@ -402,11 +416,24 @@ static int modbus_client_data_setup_final (
 	return ret;
 }
 
+static void modbus_transaction_data_destroy (
+		struct modbus_transaction_data *transaction_data
+) {
+	for (size_t i = 0; i < transaction_data->part_count; i++) {
+		RRR_FREE_IF_NOT_NULL(transaction_data->parts[i].response_topic);
+	}
+	RRR_FREE_IF_NOT_NULL(transaction_data->parts);
+	RRR_FREE_IF_NOT_NULL(transaction_data->response_topic);
+	rrr_free(transaction_data);
+}
+
 static int modbus_transaction_data_new (
 		struct modbus_transaction_data **result,
 		const struct modbus_command *command,
 		const char *response_topic,
-		rrr_u16 response_topic_length
+		rrr_u16 response_topic_length,
+		struct modbus_command_node * const *members,
+		size_t member_count
 ) {
 	int ret = 0;
 
@@ -422,29 +449,48 @@ static int modbus_transaction_data_new (
 		if ((transaction_data->response_topic = rrr_strdup(response_topic)) == NULL) {
 			RRR_MSG_0("Failed to allocate response topic in %s\n", __func__);
 			ret = 1;
-			goto out_free;
+			goto out_destroy;
 		}
 		transaction_data->response_topic_length = response_topic_length;
 	}
 
+	if (member_count > 1) {
+		if ((transaction_data->parts = rrr_allocate_zero(sizeof(*transaction_data->parts) * member_count)) == NULL) {
+			RRR_MSG_0("Failed to allocate parts in %s\n", __func__);
+			ret = 1;
+			goto out_destroy;
+		}
+
+		for (size_t i = 0; i < member_count; i++) {
+			struct modbus_transaction_part *part = &transaction_data->parts[i];
+
+			if (members[i]->response_topic != NULL) {
+				if ((part->response_topic = rrr_strdup(members[i]->response_topic)) == NULL) {
+					RRR_MSG_0("Failed to allocate response topic in %s\n", __func__);
+					ret = 1;
+					goto out_destroy;
+				}
+				part->response_topic_length = members[i]->response_topic_length;
+			}
+
+			part->starting_address = members[i]->command.starting_address;
+			part->quantity = members[i]->command.quantity;
+
+			transaction_data->part_count++;
+		}
+	}
+
 	transaction_data->command = *command;
 
 	*result = transaction_data;
 
 	goto out;
-	out_free:
-		rrr_free(transaction_data);
+	out_destroy:
+		modbus_transaction_data_destroy(transaction_data);
 	out:
 		return ret;
 }
 
-static void modbus_transaction_data_destroy (
-		struct modbus_transaction_data *transaction_data
-) {
-	RRR_FREE_IF_NOT_NULL(transaction_data->response_topic);
-	rrr_free(transaction_data);
-}
-
 struct modbus_output_callback_data {
 	const struct rrr_array *array;
 	const char *response_topic;
@@ -531,6 +577,8 @@ struct modbus_transaction_private_data_create_callback_data {
 	const struct modbus_command *command;
 	const char *request_topic;
 	rrr_u16 request_topic_length;
+	struct modbus_command_node * const *members;
+	size_t member_count;
 };
 
 int modbus_callback_req_transaction_private_data_create (void **result, void *private_data_arg, void *arg) {
@@ -547,7 +595,9 @@ int modbus_callback_req_transaction_private_data_create (void **result, void *pr
 			&transaction_data,
 			callback_data->command,
 			callback_data->request_topic,
-			callback_data->request_topic_length
+			callback_data->request_topic_length,
+			callback_data->members,
+			callback_data->member_count
 	)) != 0) {
 		goto out;
 	}
@@ -563,40 +613,33 @@ void modbus_callback_req_transaction_private_data_destroy (void *private_data) {
 	modbus_transaction_data_destroy(transaction_data);
 }
 
-static int modbus_callback_res_byte_count_and_values (
-		RRR_MODBUS_BYTE_COUNT_AND_COILS_CALLBACK_ARGS
+static int modbus_output_byte_count_and_values (
+		struct modbus_client_data *client_data,
+		uint8_t function_code,
+		uint8_t byte_count,
+		const uint8_t *values,
+		const char *response_topic,
+		rrr_u16 response_topic_length
 ) {
-	struct modbus_client_data *client_data = arg;
-	struct modbus_transaction_data *transaction_data = transaction_private_data;
-	struct modbus_data *data = client_data->data;
-
 	int ret = 0;
 
 	struct rrr_array array = {0};
 
-	RRR_DBG_2("Response from server %s:%u in modbus instance %s: Transaction %u function %u byte count %u\n",
-		client_data->server,
-		client_data->port,
-		INSTANCE_D_NAME(data->thread_data),
-		transaction_id,
-		function_code,
-		byte_count);
-
 	if ((ret = rrr_array_push_value_u64_with_tag (&array, modbus_field_bytes, byte_count)) != 0) {
 		goto push_fail;
 	}
 
 	const char *response_data_tag = (function_code < 3) ? modbus_field_status : modbus_field_contents;
 
-	if ((ret = rrr_array_push_value_blob_with_tag_with_size (&array, response_data_tag, (const char *) coil_status, byte_count)) != 0) {
+	if ((ret = rrr_array_push_value_blob_with_tag_with_size (&array, response_data_tag, (const char *) values, byte_count)) != 0) {
 		goto push_fail;
 	}
 
 	if ((ret = modbus_output (
 			client_data->data,
 			&array,
-			transaction_data->response_topic,
-			transaction_data->response_topic_length,
+			response_topic,
+			response_topic_length,
 			client_data->server,
 			client_data->port,
 			function_code
@@ -612,6 +655,116 @@ static int modbus_callback_res_byte_count_and_values (
 		return ret;
 }
 
+// Extract the values for one part of a coalesced read. Coils are
+// packed with the first coil in the least significant bit.
+static int modbus_transaction_part_values_get (
+		uint8_t *target,
+		uint8_t *target_byte_count,
+		const struct modbus_transaction_data *transaction_data,
+		const struct modbus_transaction_part *part,
+		uint8_t function_code,
+		uint8_t byte_count,
+		const uint8_t *values
+) {
+	const uint16_t offset = (uint16_t) (part->starting_address - transaction_data->command.starting_address);
+
+	if (function_code < 3) {
+		if ((offset + part->quantity + 7) / 8 > byte_count) {
+			return 1;
+		}
+
+		memset(target, '\0', (part->quantity + 7) / 8);
+
+		for (uint16_t i = 0; i < part->quantity; i++) {
+			const uint16_t src = (uint16_t) (offset + i);
+			if (values[src / 8] & (1 << (src % 8))) {
+				target[i / 8] |= (uint8_t) (1 << (i % 8));
+			}
+		}
+
+		*target_byte_count = (uint8_t) ((part->quantity + 7) / 8);
+	}
+	else {
+		if ((offset + part->quantity) * 2 > byte_count) {
+			return 1;
+		}
+
+		memcpy(target, values + offset * 2, part->quantity * 2);
+
+		*target_byte_count = (uint8_t) (part->quantity * 2);
+	}
+
+	return 0;
+}
+
+static int modbus_callback_res_byte_count_and_values (
+		RRR_MODBUS_BYTE_COUNT_AND_COILS_CALLBACK_ARGS
+) {
+	struct modbus_client_data *client_data = arg;
+	struct modbus_transaction_data *transaction_data = transaction_private_data;
+	struct modbus_data *data = client_data->data;
+
+	int ret = 0;
+
+	RRR_DBG_2("Response from server %s:%u in modbus instance %s: Transaction %u function %u byte count %u parts %llu\n",
+		client_data->server,
+		client_data->port,
+		INSTANCE_D_NAME(data->thread_data),
+		transaction_id,
+		function_code,
+		byte_count,
+		(unsigned long long) transaction_data->part_count);
+
+	if (transaction_data->part_count == 0) {
+		return modbus_output_byte_count_and_values (
+				client_data,
+				function_code,
+				byte_count,
+				coil_status,
+				transaction_data->response_topic,
+				transaction_data->response_topic_length
+		);
+	}
+
+	for (size_t i = 0; i < transaction_data->part_count; i++) {
+		const struct modbus_transaction_part *part = &transaction_data->parts[i];
+
+		uint8_t values[255];
+		uint8_t values_byte_count;
+
+		if (modbus_transaction_part_values_get (
+				values,
+				&values_byte_count,
+				transaction_data,
+				part,
+				function_code,
+				byte_count,
+				coil_status
+		) != 0) {
+			RRR_MSG_0("Short response from server %s:%u in modbus instance %s for coalesced read, byte count was %u. Dropping it.\n",
+				client_data->server,
+				client_data->port,
+				INSTANCE_D_NAME(data->thread_data),
+				byte_count);
+			goto out;
+		}
+
+		if ((ret = modbus_output_byte_count_and_values (
+				client_data,
+				function_code,
+				values_byte_count,
+				values,
+				part->response_topic,
+				part->response_topic_length
+		)) != 0) {
+			goto out;
+		}
+	}
+
+	out:
+	return ret;
+}
+
 static int modbus_callback_res_starting_address_and_register_value (
 		RRR_MODBUS_STARTING_ADDRESS_AND_REGISTER_VALUE_CALLBACK_ARGS
 ) {
@@ -707,25 +860,17 @@ static int modbus_callback_res_starting_address_and_quantity (
 		return ret;
 }
 
-static int modbus_callback_res_error (
-		RRR_MODBUS_ERROR_CALLBACK_ARGS
+static int modbus_output_error (
+		struct modbus_client_data *client_data,
+		uint8_t function_code,
+		uint8_t error_code,
+		const char *response_topic,
+		rrr_u16 response_topic_length
 ) {
-	struct modbus_client_data *client_data = arg;
-	struct modbus_transaction_data *transaction_data = transaction_private_data;
-
 	int ret = 0;
 
 	struct rrr_array array = {0};
 
-	RRR_MSG_0("Error response from server %s:%u in modbus instance %s: Transaction %u function 0x%02x exception %u\n",
-		client_data->server,
-		client_data->port,
-		INSTANCE_D_NAME(client_data->data->thread_data),
-		transaction_id,
-		function_code,
-		error_code
-	);
-
 	if ((ret = rrr_array_push_value_u64_with_tag (&array, modbus_field_exception_code, error_code)) != 0) {
 		goto push_fail;
 	}
@@ -733,8 +878,8 @@ static int modbus_callback_res_error (
 	if ((ret = modbus_output (
 			client_data->data,
 			&array,
-			transaction_data->response_topic,
-			transaction_data->response_topic_length,
+			response_topic,
+			response_topic_length,
 			client_data->server,
 			client_data->port,
 			function_code
@@ -750,6 +895,49 @@ static int modbus_callback_res_error (
 		return ret;
 }
 
+static int modbus_callback_res_error (
+		RRR_MODBUS_ERROR_CALLBACK_ARGS
+) {
+	struct modbus_client_data *client_data = arg;
+	struct modbus_transaction_data *transaction_data = transaction_private_data;
+
+	int ret = 0;
+
+	RRR_MSG_0("Error response from server %s:%u in modbus instance %s: Transaction %u function 0x%02x exception %u\n",
+		client_data->server,
+		client_data->port,
+		INSTANCE_D_NAME(client_data->data->thread_data),
+		transaction_id,
+		function_code,
+		error_code
+	);
+
+	if (transaction_data->part_count == 0) {
+		return modbus_output_error (
+				client_data,
+				function_code,
+				error_code,
+				transaction_data->response_topic,
+				transaction_data->response_topic_length
+		);
+	}
+
+	// The exception applies to the whole coalesced read
+	for (size_t i = 0; i < transaction_data->part_count; i++) {
+		if ((ret = modbus_output_error (
+				client_data,
+				function_code,
+				error_code,
+				transaction_data->parts[i].response_topic,
+				transaction_data->parts[i].response_topic_length
+		)) != 0) {
+			break;
+		}
+	}
+
+	return ret;
+}
+
 static int modbus_callback_connect (
 		int *fd,
 		const struct sockaddr *addr,
@@ -795,6 +983,9 @@ static int modbus_callback_connect (
 struct modbus_data_prepare_callback_data {
 	struct modbus_data *data;
 	struct modbus_command_node *node;
+	struct modbus_command *command;
+	struct modbus_command_node * const *members;
+	size_t member_count;
 	uint8_t *buf;
 	rrr_biglength buf_size_orig;
 };
@@ -808,7 +999,7 @@ static int modbus_callback_data_prepare (
 	struct modbus_data_prepare_callback_data *callback_data = callback_arg;
 	struct modbus_client_data *client_data = private_data;
 	struct modbus_command_node *node = callback_data->node;
-	struct modbus_command *command = &node->command;
+	struct modbus_command *command = callback_data->command;
 	struct modbus_data *data = callback_data->data;
 
 	(void)(_buf);
@@ -835,7 +1026,9 @@ static int modbus_callback_data_prepare (
 	struct modbus_transaction_private_data_create_callback_data private_data_create_callback_data = {
 		command,
 		node->response_topic,
-		node->response_topic_length
+		node->response_topic_length,
+		callback_data->members,
+		callback_data->member_count
 	};
 
 	switch (command->function) {
@@ -933,9 +1126,118 @@ static int modbus_callback_data_prepare (
 
 }
 
+static int modbus_command_is_read (
+		uint8_t function
+) {
+	return function == RRR_MODBUS_FUNCTION_CODE_01_READ_COILS ||
+	       function == RRR_MODBUS_FUNCTION_CODE_02_READ_DISCRETE_INPUTS ||
+	       function == RRR_MODBUS_FUNCTION_CODE_03_READ_HOLDING_REGISTERS ||
+	       function == RRR_MODBUS_FUNCTION_CODE_04_READ_INPUT_REGISTERS;
+}
+
+static int modbus_command_node_can_coalesce (
+		const struct modbus_command_node *node,
+		const struct modbus_command_node *candidate
+) {
+	if (candidate->command.function != node->command.function ||
+	    candidate->command.port != node->command.port ||
+	    candidate->interval_ms != node->interval_ms ||
+	    strcmp(candidate->command.server, node->command.server) != 0
+	) {
+		return 0;
+	}
+
+	// Single shot commands are only merged if they are not yet sent
+	return node->interval_ms > 0 || candidate->send_pending;
+}
+
+// Find commands for the same server and function with the same interval
+// which overlap or are adjacent to the given command, and merge them into
+// one read covering at most the maximum quantity of the function. The
+// given command is always the first member.
+static int modbus_command_coalesce (
+		struct modbus_command *merged,
+		struct modbus_command_node ***members,
+		size_t *member_count,
+		struct modbus_data *data,
+		struct modbus_command_node *first
+) {
+	struct modbus_command_node **result;
+	size_t result_count = 0;
+
+	const uint32_t quantity_max = first->command.function < 3
+		? MODBUS_QUANTITY_COIL_MAX
+		: MODBUS_QUANTITY_READ_REGISTER_MAX;
+
+	if ((result = rrr_allocate(sizeof(*result) * (size_t) RRR_LL_COUNT(&data->commands))) == NULL) {
+		RRR_MSG_0("Failed to allocate memory in %s\n", __func__);
+		return 1;
+	}
+
+	result[result_count++] = first;
+
+	uint32_t begin = first->command.starting_address;
+	uint32_t end = begin + first->command.quantity;
+
+	// Repeat until no more commands can be added as the range grows
+	int changed;
+	do {
+		changed = 0;
+		RRR_LL_ITERATE_BEGIN(&data->commands, struct modbus_command_node);
+			const uint32_t node_begin = node->command.starting_address;
+			const uint32_t node_end = node_begin + node->command.quantity;
+
+			if (node_begin > end || node_end < begin) {
+				RRR_LL_ITERATE_NEXT();
+			}
+
+			const uint32_t new_begin = node_begin < begin ? node_begin : begin;
+			const uint32_t new_end = node_end > end ? node_end : end;
+
+			if (new_end - new_begin > quantity_max || !modbus_command_node_can_coalesce(first, node)) {
+				RRR_LL_ITERATE_NEXT();
+			}
+
+			int found = 0;
+			for (size_t i = 0; i < result_count; i++) {
+				if (result[i] == node) {
+					found = 1;
+					break;
+				}
+			}
+			if (found) {
+				RRR_LL_ITERATE_NEXT();
+			}
+
+			result[result_count++] = node;
+			begin = new_begin;
+			end = new_end;
+			changed = 1;
+		RRR_LL_ITERATE_END();
+	} while (changed);
+
+	*merged = first->command;
+	merged->starting_address = (uint16_t) begin;
+	merged->quantity = (uint16_t) (end - begin);
+
+	*members = result;
+	*member_count = result_count;
+
+	return 0;
+}
+
+static void modbus_command_node_sent (
+		struct modbus_command_node *node
+) {
+	node->send_time = 0;
+	node->send_pending = 0;
+	if (node->interval_ms == 0) {
+		EVENT_REMOVE(node->event);
+	}
+}
+
 static void modbus_event_command (evutil_socket_t fd, short flags, void *arg) {
 	struct modbus_command_node *node = arg;
-	struct modbus_command *command = &node->command;
 	struct modbus_data *data = node->data;
 
 	(void)(fd);
@@ -944,21 +1246,35 @@ static void modbus_event_command (evutil_socket_t fd, short flags, void *arg) {
 	int ret_tmp;
 	uint8_t buf[2048];
 
+	struct modbus_command command = node->command;
+	struct modbus_command_node **members = NULL;
+	size_t member_count = 0;
+
 	RRR_EVENT_HOOK();
 
-	RRR_DBG_3("Modbus instance %s send command server %s:%u function 0x%02x starting address %u quantity %u interval %" PRIu64 "\n",
+	if (data->do_coalesce_reads && modbus_command_is_read(command.function)) {
+		if (modbus_command_coalesce (&command, &members, &member_count, data, node) != 0) {
+			goto fail;
+		}
+	}
+
+	RRR_DBG_3("Modbus instance %s send command server %s:%u function 0x%02x starting address %u quantity %u interval %" PRIu64 " coalesced commands %llu\n",
 		INSTANCE_D_NAME(data->thread_data),
-		command->server,
-		command->port,
-		command->function,
-		command->starting_address,
-		command->quantity,
-		node->interval_ms
+		command.server,
+		command.port,
+		command.function,
+		command.starting_address,
+		command.quantity,
+		node->interval_ms,
+		(unsigned long long) member_count
 	);
 
 	struct modbus_data_prepare_callback_data prepare_callback_data = {
 		data,
 		node,
+		&command,
+		members,
+		member_count,
 		buf,
 		sizeof(buf)
 	};
@@ -971,8 +1287,8 @@ static void modbus_event_command (evutil_socket_t fd, short flags, void *arg) {
 	if ((ret_tmp = rrr_ip_socket_client_collection_send_push_const_by_host_and_port_connect_as_needed (
 			&send_chunk_count,
 			data->collection_tcp,
-			command->server,
-			command->port,
+			command.server,
+			command.port,
 			buf,
 			sizeof(buf),
 			NULL,
@@ -985,12 +1301,12 @@ static void modbus_event_command (evutil_socket_t fd, short flags, void *arg) {
 	)) != 0) {
 		if (ret_tmp == RRR_SOCKET_NOT_READY) {
 			RRR_DBG_2("Modbus instance %s connection to %s:%u not yet ready\n",
-				INSTANCE_D_NAME(data->thread_data), command->server, command->port);
+				INSTANCE_D_NAME(data->thread_data), command.server, command.port);
 		}
 		else {
 			if (ret_tmp == RRR_SOCKET_SOFT_ERROR) {
 				RRR_MSG_0("Modbus instance %s connection to %s:%u soft error\n",
-					INSTANCE_D_NAME(data->thread_data), command->server, command->port);
+					INSTANCE_D_NAME(data->thread_data), command.server, command.port);
 			}
 			else {
 				goto fail_send;
@@ -998,19 +1314,27 @@ static void modbus_event_command (evutil_socket_t fd, short flags, void *arg) {
 		}
 	}
 	else {
-		node->send_time = 0;
-		if (node->interval_ms == 0) {
-			EVENT_REMOVE(node->event);
+		modbus_command_node_sent(node);
+
+		// Restart the interval of the other commands so that they are
+		// not sent separately but stay in sync with this command
+		for (size_t i = 1; i < member_count; i++) {
+			modbus_command_node_sent(members[i]);
+			if (members[i]->interval_ms > 0) {
+				EVENT_ADD(members[i]->event);
+			}
 		}
 	}
 
-	return;
+	goto out;
 	fail_send:
 		RRR_MSG_0("Send or connection failed in modbus instance %s, return was %i\n",
 			INSTANCE_D_NAME(data->thread_data), ret_tmp);
 		goto fail;
 	fail:
 		rrr_event_dispatch_break(INSTANCE_D_EVENTS(data->thread_data));
+	out:
+		RRR_FREE_IF_NOT_NULL(members);
 }
 
 static void modbus_event_process (evutil_socket_t fd, short flags, void *arg) {
@@ -1370,11 +1694,11 @@ static int modbus_event_broker_data_available (RRR_EVENT_FUNCTION_ARGS) {
 }
 
 static int modbus_parse_config (struct modbus_data *data, struct rrr_instance_config_data *config) {
-	(void)(data);
-	(void)(config);
-
 	int ret = 0;
 
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_YESNO("modbus_coalesce_reads", do_coalesce_reads, 0);
+
+	out:
 	return ret;
 }
 
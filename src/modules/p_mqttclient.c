@@ -126,6 +126,8 @@ struct mqtt_client_data {
 	uint16_t server_port;
 	rrr_setting_uint qos;
 	rrr_setting_uint version;
+	rrr_setting_uint topic_alias_maximum_in;
+	rrr_setting_uint topic_alias_maximum_out;
 
 	struct rrr_mqtt_subscription_collection *subscriptions;
 
@@ -1011,6 +1013,21 @@ static int mqttclient_parse_config (struct mqtt_client_data *data, struct rrr_in
 		}
 	}
 
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("mqtt_topic_alias_maximum_in", topic_alias_maximum_in, 0);
+	RRR_INSTANCE_CONFIG_PARSE_OPTIONAL_UNSIGNED("mqtt_topic_alias_maximum_out", topic_alias_maximum_out, 0);
+
+	if (data->topic_alias_maximum_in > 0xffff || data->topic_alias_maximum_out > 0xffff) {
+		RRR_MSG_0("mqtt_topic_alias_maximum_in or mqtt_topic_alias_maximum_out was too big in mqtt client instance %s, max is 65535\n", config->name);
+		ret = 1;
+		goto out;
+	}
+
+	if ((data->topic_alias_maximum_in > 0 || data->topic_alias_maximum_out > 0) && data->version < 5) {
+		RRR_MSG_0("mqtt_topic_alias_maximum_in or mqtt_topic_alias_maximum_out was set in mqtt client instance %s but mqtt_version was not 5, this is a configuration error.\n", config->name);
+		ret = 1;
+		goto out;
+	}
+
 	if ((ret = rrr_instance_config_get_string_noconvert_silent(&data->server, config, "mqtt_server")) != 0) {
 		if (ret != RRR_SETTING_NOT_FOUND) {
 			RRR_MSG_0("Error while parsing mqtt_server setting of instance %s\n", config->name);
@@ -2061,6 +2078,13 @@ static void mqttclient_update_stats (
 	// regardless of their origin. We therefore count it in the module poll callback function.
 	rrr_stats_instance_post_unsigned_base10_text(stats, "total_publish_sent", 0, data->total_sent_count);
 
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_out_assigned", 0, client_stats.topic_alias_stats.out_assigned);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_out_reused", 0, client_stats.topic_alias_stats.out_reused);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_out_bytes_saved", 0, client_stats.topic_alias_stats.out_bytes_saved);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_in_assigned", 0, client_stats.topic_alias_stats.in_assigned);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_in_resolved", 0, client_stats.topic_alias_stats.in_resolved);
+	rrr_stats_instance_post_unsigned_base10_text(stats, "topic_alias_in_bytes_saved", 0, client_stats.topic_alias_stats.in_bytes_saved);
+
 	// These will always be zero for the client, nothing is forwarded. Keep it here nevertheless to avoid accidently activating it.
 	// rrr_stats_instance_post_unsigned_base10_text(stats, "total_publish_forwarded_in", 0, client_stats.session_stats.total_publish_forwarded_in);
 	// rrr_stats_instance_post_unsigned_base10_text(stats, "total_publish_forwarded_out", 0, client_stats.session_stats.total_publish_forwarded_out);
@@ -2218,7 +2242,9 @@ static void *thread_entry_mqtt_client (struct rrr_thread *thread) {
 		data->client_identifier, // May be NULL
 		RRR_MQTT_COMMON_RETRY_INTERVAL_S * 1000 * 1000,
 		RRR_MQTT_COMMON_CLOSE_WAIT_TIME_S * 1000 * 1000,
-		RRR_MQTT_COMMON_MAX_CONNECTIONS
+		RRR_MQTT_COMMON_MAX_CONNECTIONS,
+		(uint16_t) data->topic_alias_maximum_in,
+		(uint16_t) data->topic_alias_maximum_out
 	};
 
 	if (rrr_mqtt_client_new (
@@ -146,12 +146,81 @@ void dump_install_directories (void) {
 	DUMP_INSTALL_DIRECTORY("cmodule-dir", RRR_CMODULE_PATH);
 }
 
+// Metrics slots of message broker costumers, the slots are shared
+// with the instances of the same names
+struct stats_shm_slot {
+	RRR_LL_NODE(struct stats_shm_slot);
+	char *name;
+	uint32_t slot;
+	int is_reported;
+};
+
+struct stats_shm_slot_collection {
+	RRR_LL_HEAD(struct stats_shm_slot);
+};
+
 struct stats_data {
 	unsigned int handle;
 	int log_hook_handle;
 	struct rrr_stats_engine engine;
+	struct stats_shm_slot_collection shm_slots;
 };
 
+static void main_stats_shm_slot_destroy (struct stats_data *stats_data, struct stats_shm_slot *slot) {
+	rrr_stats_engine_shm_slot_release(&stats_data->engine, slot->slot);
+	rrr_free(slot->name);
+	rrr_free(slot);
+}
+
+static struct stats_shm_slot *main_stats_shm_slot_get (struct stats_data *stats_data, const char *name) {
+	struct stats_shm_slot *slot = NULL;
+
+	RRR_LL_ITERATE_BEGIN(&stats_data->shm_slots, struct stats_shm_slot);
+		if (strcmp(node->name, name) == 0) {
+			return node;
+		}
+	RRR_LL_ITERATE_END();
+
+	if ((slot = rrr_allocate_zero(sizeof(*slot))) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		goto out_err;
+	}
+
+	if ((slot->name = rrr_strdup(name)) == NULL) {
+		RRR_MSG_0("Could not allocate memory for name in %s\n", __func__);
+		goto out_free;
+	}
+
+	if (rrr_stats_engine_shm_slot_obtain(&slot->slot, &stats_data->engine, name) != 0) {
+		goto out_free_name;
+	}
+
+	RRR_LL_APPEND(&stats_data->shm_slots, slot);
+
+	return slot;
+
+	out_free_name:
+		rrr_free(slot->name);
+	out_free:
+		rrr_free(slot);
+	out_err:
+		return NULL;
+}
+
+// Release slots of costumers which were not reported since the last call
+static void main_stats_shm_slots_sweep (struct stats_data *stats_data) {
+	RRR_LL_ITERATE_BEGIN(&stats_data->shm_slots, struct stats_shm_slot);
+		if (!node->is_reported) {
+			RRR_LL_ITERATE_SET_DESTROY();
+		}
+		node->is_reported = 0;
+	RRR_LL_ITERATE_END_CHECK_DESTROY(&stats_data->shm_slots, 0; main_stats_shm_slot_destroy(stats_data, node));
+}
+
+static void main_stats_shm_slots_clear (struct stats_data *stats_data) {
+	RRR_LL_DESTROY(&stats_data->shm_slots, struct stats_shm_slot, main_stats_shm_slot_destroy(stats_data, node));
+}
+
 static int main_stats_post_message (struct stats_data *stats_data, const char *path, uint8_t type, const char *text, uint32_t flags) {
 	struct rrr_msg_stats message;
 
@@ -441,7 +510,12 @@ static int main_mmap_periodic (struct stats_data *stats_data) {
 	return ret;
 }
 
-static void main_loop_periodic_message_broker_report_buffer_callback (const char *name, rrr_length count, void *arg) {
+static void main_loop_periodic_message_broker_report_buffer_callback (
+		const char *name,
+		rrr_length count,
+		const struct rrr_fifo_protected_stats *fifo_stats,
+		void *arg
+) {
 	struct main_loop_event_callback_data *callback_data = arg;
 	struct stats_data *stats_data = callback_data->stats_data;
 
@@ -454,6 +528,14 @@ static void main_loop_periodic_message_broker_report_buffer_callback (const char
 		char buf[256];
 		snprintf(buf, sizeof(buf), "message_broker/costumers/%s/buffer/count", name);
 		main_stats_post_unsigned_message (stats_data, buf, count, 0);
+
+		struct stats_shm_slot *slot = main_stats_shm_slot_get(stats_data, name);
+		if (slot != NULL) {
+			slot->is_reported = 1;
+			rrr_stats_engine_shm_value_set(&stats_data->engine, slot->slot, RRR_STATS_SHM_VALUE_BUFFER_COUNT, count);
+			rrr_stats_engine_shm_value_set(&stats_data->engine, slot->slot, RRR_STATS_SHM_VALUE_BUFFER_WRITTEN_TOTAL, fifo_stats->total_entries_written);
+			rrr_stats_engine_shm_value_set(&stats_data->engine, slot->slot, RRR_STATS_SHM_VALUE_BUFFER_DELETED_TOTAL, fifo_stats->total_entries_deleted);
+		}
 	}
 }
 
@@ -523,6 +605,9 @@ static int main_loop_periodic_maintenance (
 			main_loop_periodic_message_broker_report_buffer_split_buffer_callback,
 			callback_data
 		);
+		if (callback_data->stats_data != NULL) {
+			main_stats_shm_slots_sweep(callback_data->stats_data);
+		}
 		callback_data->prev_periodic_time = now_time;
 	}
 
@@ -838,6 +923,7 @@ static int main_loop (
 //	out_destroy_message_broker:
 		rrr_message_broker_destroy(message_broker);
 	out_destroy_stats_engine:
+		main_stats_shm_slots_clear(&stats_data);
 		rrr_stats_engine_cleanup(&stats_data.engine);
 	out_destroy_instance_metadata:
 		rrr_signal_handler_set_active(RRR_SIGNALS_NOT_ACTIVE);
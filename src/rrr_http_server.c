@@ -601,7 +601,8 @@ int main (int argc, const char **argv, const char **env) {
 				NULL,
 				RRR_NET_TRANSPORT_TLS,
 				RRR_NET_TRANSPORT_F_TLS,
-				RRR_NET_TRANSPORT_TLS_NONE
+				RRR_NET_TRANSPORT_TLS_NONE,
+				0
 		};
 
 		int flags = 0;
@@ -637,7 +638,8 @@ int main (int argc, const char **argv, const char **env) {
 				NULL,
 				RRR_NET_TRANSPORT_QUIC,
 				RRR_NET_TRANSPORT_F_QUIC,
-				RRR_NET_TRANSPORT_TLS_NONE
+				RRR_NET_TRANSPORT_TLS_NONE,
+				0
 		};
 
 		int flags = 0;
@@ -145,50 +145,69 @@ static int __make_response (
 
 	uint16_t length = rrr_be16toh(*((uint16_t *) &dst_buf[4]));
 
+	if (*src_buf_size < 12) {
+		RRR_DBG_1("Frame too short for function 0x%02x\n", dst_buf[7]);
+		ret = 1;
+		goto out;
+	}
+
+	// Values are derived from the address so that clients may verify
+	// that the correct range was returned. Coils at addresses divisible
+	// by three are set, and each register contains its own address.
+	const uint16_t starting_address = rrr_be16toh(*((uint16_t *) &dst_buf[8]));
+	const uint16_t quantity = rrr_be16toh(*((uint16_t *) &dst_buf[10]));
+	uint8_t byte_count;
+
+	if (length < 6) {
+		RRR_DBG_1("Length %u too short function 0x%02x\n", length, dst_buf[7]);
+		exception = 0x02; /* Illegal data address */
+		goto exception;
+	}
+
 	switch(dst_buf[7]) { // Function code
 		case 0x01:
 		case 0x02:
-			if (dst_buf[10] != 0 || dst_buf[11] != 8) {
-				RRR_DBG_1("Illegal address/quantity %u/%u for function 0x01\n", dst_buf[10], dst_buf[11]);
+			if (quantity < 1 || quantity > 2000 || (uint32_t) starting_address + quantity > 0x10000) {
+				RRR_DBG_1("Illegal address/quantity %u/%u for function 0x%02x\n", starting_address, quantity, dst_buf[7]);
 				exception = 0x02; /* Illegal data address */
 				goto exception;
 			}
-			if (length < 6) {
-				RRR_DBG_1("Length %u too short function 0x01\n", length);
-				exception = 0x02; /* Illegal data address */
-				goto exception;
+			byte_count = (uint8_t) ((quantity + 7) / 8);
+			memset(dst_buf + 9, '\0', byte_count);
+			for (uint16_t i = 0; i < quantity; i++) {
+				if ((starting_address + i) % 3 == 0) {
+					dst_buf[9 + i / 8] |= (char) (1 << (i % 8));
+				}
 			}
-			dst_buf[4] = 0;     // Length high
-			dst_buf[5] = 4;     // Length low
-			dst_buf[8] = 1;     // Byte count
-			dst_buf[9] = 0x01;  // Coil status 0
-			*dst_buf_size = 10;
-			*bytes_consumed = 12;
 			break;
 		case 0x03:
-			if (dst_buf[10] != 0 || dst_buf[11] != 1) {
-				RRR_DBG_1("Illegal address/quantity %u/%u for function 0x03\n", dst_buf[10], dst_buf[11]);
+		case 0x04:
+			if (quantity < 1 || quantity > 125 || (uint32_t) starting_address + quantity > 0x10000) {
+				RRR_DBG_1("Illegal address/quantity %u/%u for function 0x%02x\n", starting_address, quantity, dst_buf[7]);
 				exception = 0x02; /* Illegal data address */
 				goto exception;
 			}
-			if (length < 6) {
-				RRR_DBG_1("Length %u too short function 0x03\n", length);
-				exception = 0x02; /* Illegal data address */
-				goto exception;
+			byte_count = (uint8_t) (quantity * 2);
+			for (uint16_t i = 0; i < quantity; i++) {
+				const uint16_t address = (uint16_t) (starting_address + i);
+				dst_buf[9 + i * 2] = (char) (address >> 8);     // Register high
+				dst_buf[9 + i * 2 + 1] = (char) (address & 0xff); // Register low
 			}
-			dst_buf[4] = 0;     // Length high
-			dst_buf[5] = 5;     // Length low
-			dst_buf[8] = 2;     // Byte count
-			dst_buf[9] = 0x01;  // Register high
-			dst_buf[10] = 0x01;  // Register low
-			*dst_buf_size = 11;
-			*bytes_consumed = 12;
 			break;
 		default:
 			RRR_DBG_1("Illegal function 0x%u\n", dst_buf[7]);
 			goto exception;
 	}
 
+	RRR_DBG_1("Response to function 0x%02x starting address %u quantity %u byte count %u\n",
+		dst_buf[7], starting_address, quantity, byte_count);
+
+	dst_buf[4] = 0;                         // Length high
+	dst_buf[5] = (char) (3 + byte_count);   // Length low
+	dst_buf[8] = (char) byte_count;         // Byte count
+	*dst_buf_size = 9 + (size_t) byte_count;
+	*bytes_consumed = 12;
+
 	goto out;
 	exception:
 		dst_buf[4] = 0;     // Length high
@@ -196,6 +215,7 @@ static int __make_response (
 		dst_buf[7] += 0x80;
 		dst_buf[8] = (char) exception;
 		*dst_buf_size = 9;
+		*bytes_consumed = 6 + (size_t) length < *src_buf_size ? 6 + (size_t) length : *src_buf_size;
 	out:
 		return ret;
 }
@@ -330,17 +350,18 @@ int main(int argc, const char **argv, const char **env) {
 				break;
 			}
 
-			if (bytes_consumed < buf_size) {
-				bytes_offset += bytes_consumed;
-				goto again;
-			}
-
 			RRR_DBG_2("Write response size %llu\n", (long long unsigned) buf2_size);
 
 			if (write(client_fd, buf2, buf2_size) != (ssize_t) buf2_size) {
 				RRR_MSG_0("Write to client failed: %s\n", rrr_strerror(errno));
 				break;
 			}
+
+			// Client may pipeline multiple requests, respond to each of them
+			if (bytes_consumed < buf_size) {
+				bytes_offset += bytes_consumed;
+				goto again;
+			}
 		}
 
 		RRR_DBG_1("Closing connection\n");
@@ -61,6 +61,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "lib/socket/rrr_socket_client.h"
 #include "lib/stats/stats_message.h"
 #include "lib/stats/stats_tree.h"
+#include "lib/stats/stats_shm.h"
 #include "lib/util/rrr_time.h"
 #include "lib/util/linked_list.h"
 #include "lib/util/rrr_readdir.h"
@@ -87,6 +88,7 @@ static const struct cmd_arg_rule cmd_rules[] = {
         {0,                            'E',    "events",                "[-E|--events]"},
         {0,                            'J',    "journal",               "[-J|--journal]"},
         {0,                            'M',    "messages",              "[-M|--messages]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'S',    "shm",                   "[-S|--shm[=]METRICS FILE]"},
         {CMD_ARG_FLAG_HAS_ARGUMENT,    'e',    "environment-file",      "[-e|--environment-file[=]ENVIRONMENT FILE]"},
         {CMD_ARG_FLAG_HAS_ARGUMENT,    'd',    "debuglevel",            "[-d|--debuglevel[=]DEBUG FLAGS]"},
         {CMD_ARG_FLAG_HAS_ARGUMENT,    'D',    "debuglevel-on-exit",    "[-D|--debuglevel-on-exit[=]DEBUG FLAGS]"},
@@ -100,6 +102,7 @@ struct rrr_stats_data {
 	struct rrr_map socket_prefixes;
 	struct rrr_stats_tree message_tree;
 	char *socket_path_active;
+	const char *shm_path;
 
 	int do_socket_path_exact;
 	int do_print_journal;
@@ -270,6 +273,13 @@ static int __rrr_stats_parse_config (
 		data->do_print_events = 1;
 	}
 
+	if ((data->shm_path = cmd_get_value(cmd, "shm", 0)) != NULL) {
+		if (data->do_print_journal + data->do_print_messages + data->do_print_events > 0) {
+			RRR_MSG_0("Cannot print messages, events or journal while reading metrics file. Check arguments.\n");
+			return 1;
+		}
+	}
+
 	if (data->do_print_journal + data->do_print_messages + data->do_print_events > 1) {
 		RRR_MSG_0("Cannot print messages, events and/or journal simultaneously. Check arguments.\n");
 		return 1;
@@ -838,6 +848,50 @@ static int __rrr_stats_event_periodic (RRR_EVENT_FUNCTION_PERIODIC_ARGS) {
 	return 0;
 }
 
+static int __rrr_stats_shm_dump (
+		const char *path
+) {
+	int ret = 0;
+
+	struct rrr_stats_shm *shm = NULL;
+	struct rrr_stats_shm_slot slot;
+
+	if ((ret = rrr_stats_shm_open(&shm, path)) != 0) {
+		goto out;
+	}
+
+	RRR_MSG_PLAIN("== METRICS FROM PID %" PRIu64 " ===================================\n", shm->page->header.pid);
+
+	for (uint32_t i = 0; i < shm->page->header.slot_count; i++) {
+		if (rrr_stats_shm_slot_read(&slot, shm, i) != 0) {
+			RRR_MSG_0("Slot %" PRIu32 " in metrics file was busy, skipping\n", i);
+			continue;
+		}
+
+		if (!slot.in_use) {
+			continue;
+		}
+
+		for (int j = 0; j < RRR_STATS_SHM_VALUE_COUNT; j++) {
+			RRR_MSG_PLAIN("%s/%s: %" PRIu64 "\n",
+				slot.name, rrr_stats_shm_value_name(j), slot.values[j]);
+		}
+
+		for (int j = 0; j < RRR_STATS_SHM_RATES_MAX; j++) {
+			if (*slot.rates[j].name == '\0') {
+				continue;
+			}
+			RRR_MSG_PLAIN("%s/%s/total: %" PRIu64 "\n",
+				slot.name, slot.rates[j].name, slot.rates[j].total);
+		}
+	}
+
+	rrr_stats_shm_destroy(shm);
+
+	out:
+	return ret;
+}
+
 int main (int argc, const char **argv, const char **env) {
 	if (!rrr_verify_library_build_timestamp(RRR_BUILD_TIMESTAMP)) {
 		fprintf(stderr, "Library build version mismatch.\n");
@@ -887,6 +941,13 @@ int main (int argc, const char **argv, const char **env) {
 		goto out_cleanup_data;
 	}
 
+	if (data.shm_path != NULL) {
+		if (__rrr_stats_shm_dump(data.shm_path) != 0) {
+			ret = EXIT_FAILURE;
+		}
+		goto out_cleanup_data;
+	}
+
 	int (*message_callback)(const struct rrr_msg_stats *, void *, void *) = NULL;
 
 	if (data.do_print_journal) {
@@ -424,7 +424,9 @@ int main (int argc, const char **argv, const char **env) {
 		NULL, /* Client name */
 		RRR_MQTT_COMMON_RETRY_INTERVAL_S * 1000 * 1000,
 		RRR_MQTT_COMMON_CLOSE_WAIT_TIME_S * 1000 * 1000,
-		RRR_MQTT_COMMON_MAX_CONNECTIONS
+		RRR_MQTT_COMMON_MAX_CONNECTIONS,
+		0, /* Topic alias maximum in */
+		0  /* Topic alias maximum out */
 	};
 
 	cmd_init(&cmd, cmd_rules, argc, argv);
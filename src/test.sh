@@ -0,0 +1,2 @@
+#!/bin/sh
+./rrr_msg -s
@@ -167,6 +167,54 @@ static void *thread_entry_test_module (struct rrr_thread *thread) {
 		);
 		TEST_MSG("Result from averager test: %i\n", ret);
 	}
+	else if (strcmp(data->test_method, "test_averager_options") == 0) {
+		ret = test_averager_options (
+				&data->test_function_data,
+				thread_data->init_data.module->all_instances,
+				thread_data
+		);
+		TEST_MSG("Result from averager options test: %i\n", ret);
+	}
+	else if (strcmp(data->test_method, "test_modbus_coalesce") == 0) {
+		ret = test_modbus_coalesce (
+				&data->test_function_data,
+				thread_data->init_data.module->all_instances,
+				thread_data
+		);
+		TEST_MSG("Result from modbus coalesce test: %i\n", ret);
+	}
+	else if (strcmp(data->test_method, "test_mqtt_broker_threads") == 0) {
+		ret = test_mqtt_broker_threads (
+				&data->test_function_data,
+				thread_data->init_data.module->all_instances,
+				thread_data
+		);
+		TEST_MSG("Result from MQTT broker threads test: %i\n", ret);
+	}
+	else if (strcmp(data->test_method, "test_thread_pool") == 0) {
+		ret = test_thread_pool (
+				&data->test_function_data,
+				thread_data->init_data.module->all_instances,
+				thread_data
+		);
+		TEST_MSG("Result from thread pool test: %i\n", ret);
+	}
+	else if (strcmp(data->test_method, "test_thread_pool_fused") == 0) {
+		ret = test_thread_pool_fused (
+				&data->test_function_data,
+				thread_data->init_data.module->all_instances,
+				thread_data
+		);
+		TEST_MSG("Result from fused thread pool test: %i\n", ret);
+	}
+	else if (strcmp(data->test_method, "test_httpserver_response_index") == 0) {
+		ret = test_httpserver_response_index (
+				&data->test_function_data,
+				thread_data->init_data.module->all_instances,
+				thread_data
+		);
+		TEST_MSG("Result from httpserver response index test: %i\n", ret);
+	}
 	else if (strcmp(data->test_method, "test_anything") == 0) {
 		ret = test_anything (
 				&data->test_function_data,
@@ -378,6 +378,526 @@ int test_averager (
 	return ret;
 }
 
+struct rrr_test_averager_options_data {
+	int count_a;
+	int count_b;
+};
+
+int test_averager_options_callback (TEST_POLL_CALLBACK_SIGNATURE) {
+	struct rrr_test_result *result = callback_data->test_result;
+	struct rrr_test_averager_options_data *options_data = callback_data->private_data;
+
+	struct rrr_msg_msg *message = (struct rrr_msg_msg *) entry->message;
+
+	int ret = 0;
+
+	struct rrr_array array_tmp = {0};
+
+	uint64_t value_average;
+	uint64_t value_max;
+	uint64_t value_min;
+	uint64_t value_p25;
+	uint64_t value_p50;
+	uint64_t value_p100;
+
+	if (!MSG_IS_ARRAY(message)) {
+		TEST_MSG("Unknown non-array message received in test_averager_options_callback\n");
+		ret = 1;
+		goto out;
+	}
+
+	uint16_t array_version_dummy;
+	if (rrr_array_message_append_to_array(&array_version_dummy, &array_tmp, message) != 0) {
+		TEST_MSG("Could not create array collection in test_averager_options_callback\n");
+		ret = 1;
+		goto out;
+	}
+
+	// Output values are prefixed with the value tag when avg_value_tags is set
+	if (rrr_array_has_tag(&array_tmp, "average")) {
+		TEST_MSG("Unprefixed value received in test_averager_options_callback\n");
+		ret = 1;
+		goto out;
+	}
+
+	ret |= rrr_array_get_value_unsigned_64_by_tag(&value_average, &array_tmp, "measurement_average", 0);
+	ret |= rrr_array_get_value_unsigned_64_by_tag(&value_max, &array_tmp, "measurement_max", 0);
+	ret |= rrr_array_get_value_unsigned_64_by_tag(&value_min, &array_tmp, "measurement_min", 0);
+	ret |= rrr_array_get_value_unsigned_64_by_tag(&value_p25, &array_tmp, "measurement_p25", 0);
+	ret |= rrr_array_get_value_unsigned_64_by_tag(&value_p50, &array_tmp, "measurement_p50", 0);
+	ret |= rrr_array_get_value_unsigned_64_by_tag(&value_p100, &array_tmp, "measurement_p100", 0);
+
+	if (ret != 0) {
+		TEST_MSG("Could not retrieve 64-values from array in test_averager_options_callback\n");
+		ret = 1;
+		goto out;
+	}
+
+	// Each voltmonitor spawns the values 2, 4, 6 and 8
+	if ( value_average != 5 || value_max != 8 || value_min != 2 ||
+	     value_p25 != 2 || value_p50 != 4 || value_p100 != 8
+	) {
+		TEST_MSG("Received wrong values %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 ", %" PRIu64 " in test_averager_options_callback\n",
+				value_average, value_max, value_min, value_p25, value_p50, value_p100);
+		ret = 1;
+		goto out;
+	}
+
+	// Averages are produced per topic and keep the topic of the values
+	if (MSG_TOPIC_IS(message, "averager/a")) {
+		options_data->count_a++;
+	}
+	else if (MSG_TOPIC_IS(message, "averager/b")) {
+		options_data->count_b++;
+	}
+	else {
+		TEST_MSG("Received average with unexpected topic '%.*s' in test_averager_options_callback\n",
+				MSG_TOPIC_LENGTH(message), MSG_TOPIC_PTR(message));
+		ret = 1;
+		goto out;
+	}
+
+	// With a sliding window, the values are averaged again at the next interval
+	if (options_data->count_a >= 2 && options_data->count_b >= 2) {
+		result->result = 2;
+	}
+
+	out:
+	rrr_msg_holder_unlock(entry);
+	rrr_array_clear(&array_tmp);
+	return ret;
+}
+
+int test_averager_options (
+		RRR_TEST_FUNCTION_ARGS
+) {
+	(void)(test_function_data);
+	(void)(instances);
+
+	// Preconditions for this test:
+	// - Senders of the averager module are two voltmonitor modules with
+	//   vm_spawn_test_measurements set and topics averager/a and averager/b
+	// - The averager has avg_value_tags=measurement, avg_percentiles=25,50,100,
+	//   avg_sliding_window=yes and avg_per_topic=yes
+
+	int ret = 0;
+
+	struct rrr_test_result test_result = {0};
+	struct rrr_test_averager_options_data options_data = {0};
+
+	struct rrr_test_callback_data callback_data = { &test_result, &options_data };
+
+	ret |= test_do_poll_loop(
+			self_thread_data,
+			test_averager_options_callback,
+			&callback_data
+	);
+	TEST_MSG("Result of test_averager_options, should be 2: %i (%i and %i averages)\n",
+			test_result.result, options_data.count_a, options_data.count_b);
+
+	ret |= (test_result.result == 2 ? 0 : 1);
+
+	return ret;
+}
+
+// Commands sent to the modbus instance, each register of the modbus
+// test server contains its own address
+static const struct rrr_test_modbus_coalesce_part {
+	uint16_t starting_address;
+	uint16_t quantity;
+} rrr_test_modbus_coalesce_parts[] = {
+	{100, 2},
+	{102, 3},
+	{105, 1}
+};
+
+#define RRR_TEST_MODBUS_COALESCE_PARTS \
+	(sizeof(rrr_test_modbus_coalesce_parts) / sizeof(*rrr_test_modbus_coalesce_parts))
+
+struct rrr_test_modbus_coalesce_data {
+	int counts[RRR_TEST_MODBUS_COALESCE_PARTS];
+};
+
+int test_modbus_coalesce_callback (TEST_POLL_CALLBACK_SIGNATURE) {
+	struct rrr_test_result *result = callback_data->test_result;
+	struct rrr_test_modbus_coalesce_data *coalesce_data = callback_data->private_data;
+
+	struct rrr_msg_msg *message = (struct rrr_msg_msg *) entry->message;
+
+	int ret = 0;
+
+	struct rrr_array array_tmp = {0};
+
+	if (!MSG_IS_ARRAY(message)) {
+		TEST_MSG("Unknown non-array message received in test_modbus_coalesce_callback\n");
+		ret = 1;
+		goto out;
+	}
+
+	uint16_t array_version_dummy;
+	if (rrr_array_message_append_to_array(&array_version_dummy, &array_tmp, message) != 0) {
+		TEST_MSG("Could not create array collection in test_modbus_coalesce_callback\n");
+		ret = 1;
+		goto out;
+	}
+
+	const struct rrr_type_value *value = rrr_array_value_get_by_tag(&array_tmp, "modbus_contents");
+	if (value == NULL || value->total_stored_length < 2 || value->total_stored_length % 2 != 0) {
+		TEST_MSG("Missing or invalid modbus_contents in test_modbus_coalesce_callback\n");
+		ret = 1;
+		goto out;
+	}
+
+	const uint8_t *data = (const uint8_t *) value->data;
+	const uint16_t quantity = (uint16_t) (value->total_stored_length / 2);
+	const uint16_t starting_address = (uint16_t) (data[0] << 8 | data[1]);
+
+	for (uint16_t i = 0; i < quantity; i++) {
+		const uint16_t address = (uint16_t) (data[i * 2] << 8 | data[i * 2 + 1]);
+		if (address != starting_address + i) {
+			TEST_MSG("Register %u of response starting at %u contained %u in test_modbus_coalesce_callback\n",
+					i, starting_address, address);
+			ret = 1;
+			goto out;
+		}
+	}
+
+	size_t i;
+	for (i = 0; i < RRR_TEST_MODBUS_COALESCE_PARTS; i++) {
+		const struct rrr_test_modbus_coalesce_part *part = &rrr_test_modbus_coalesce_parts[i];
+		if (part->starting_address == starting_address && part->quantity == quantity) {
+			break;
+		}
+	}
+
+	if (i == RRR_TEST_MODBUS_COALESCE_PARTS) {
+		TEST_MSG("Response with starting address %u and quantity %u did not match any command in test_modbus_coalesce_callback\n",
+				starting_address, quantity);
+		ret = 1;
+		goto out;
+	}
+
+	coalesce_data->counts[i]++;
+
+	// Commands are repeated, wait for a few rounds
+	result->result = 2;
+	for (i = 0; i < RRR_TEST_MODBUS_COALESCE_PARTS; i++) {
+		if (coalesce_data->counts[i] < 3) {
+			result->result = 1;
+		}
+	}
+
+	out:
+	rrr_msg_holder_unlock(entry);
+	rrr_array_clear(&array_tmp);
+	return ret;
+}
+
+int test_modbus_coalesce (
+		RRR_TEST_FUNCTION_ARGS
+) {
+	(void)(test_function_data);
+	(void)(instances);
+
+	// Preconditions for this test:
+	// - Sender is a modbus instance with modbus_coalesce_reads=yes
+	// - The modbus instance receives read holding registers commands for
+	//   the parts above with the same interval, and the server is rrr_modbus_server
+
+	int ret = 0;
+
+	struct rrr_test_result test_result = {0};
+	struct rrr_test_modbus_coalesce_data coalesce_data = {0};
+
+	struct rrr_test_callback_data callback_data = { &test_result, &coalesce_data };
+
+	ret |= test_do_poll_loop(
+			self_thread_data,
+			test_modbus_coalesce_callback,
+			&callback_data
+	);
+	TEST_MSG("Result of test_modbus_coalesce, should be 2: %i (%i, %i and %i responses)\n",
+			test_result.result, coalesce_data.counts[0], coalesce_data.counts[1], coalesce_data.counts[2]);
+
+	ret |= (test_result.result == 2 ? 0 : 1);
+
+	return ret;
+}
+
+struct rrr_test_mqtt_broker_threads_data {
+	int count_a;
+	int count_b;
+};
+
+int test_mqtt_broker_threads_callback (TEST_POLL_CALLBACK_SIGNATURE) {
+	struct rrr_test_result *result = callback_data->test_result;
+	struct rrr_test_mqtt_broker_threads_data *threads_data = callback_data->private_data;
+
+	struct rrr_msg_msg *message = (struct rrr_msg_msg *) entry->message;
+
+	int ret = 0;
+
+	// Each topic has its own publisher and subscriber
+	if (MSG_TOPIC_IS(message, "threads/a")) {
+		threads_data->count_a++;
+	}
+	else if (MSG_TOPIC_IS(message, "threads/b")) {
+		threads_data->count_b++;
+	}
+	else {
+		TEST_MSG("Received message with unexpected topic '%.*s' in test_mqtt_broker_threads_callback\n",
+				MSG_TOPIC_LENGTH(message), MSG_TOPIC_PTR(message));
+		ret = 1;
+		goto out;
+	}
+
+	// Keep running for a while to let the clients sharing client ID
+	// take the session over from each other a few times
+	if (threads_data->count_a >= 200 && threads_data->count_b >= 200) {
+		result->result = 2;
+	}
+
+	out:
+	rrr_msg_holder_unlock(entry);
+	return ret;
+}
+
+int test_mqtt_broker_threads (
+		RRR_TEST_FUNCTION_ARGS
+) {
+	(void)(test_function_data);
+	(void)(instances);
+
+	// Preconditions for this test:
+	// - Senders are mqttclient instances subscribing to the topics
+	//   threads/a and threads/b on a broker with multiple threads
+
+	int ret = 0;
+
+	struct rrr_test_result test_result = {0};
+	struct rrr_test_mqtt_broker_threads_data threads_data = {0};
+
+	struct rrr_test_callback_data callback_data = { &test_result, &threads_data };
+
+	ret |= test_do_poll_loop(
+			self_thread_data,
+			test_mqtt_broker_threads_callback,
+			&callback_data
+	);
+	TEST_MSG("Result of test_mqtt_broker_threads, should be 2: %i (%i and %i messages)\n",
+			test_result.result, threads_data.count_a, threads_data.count_b);
+
+	ret |= (test_result.result == 2 ? 0 : 1);
+
+	return ret;
+}
+
+// Number of messages generated by each dummy instance in the thread pool tests
+#define RRR_TEST_THREAD_POOL_MESSAGES 500
+
+int test_thread_pool_callback (TEST_POLL_CALLBACK_SIGNATURE) {
+	struct rrr_test_result *result = callback_data->test_result;
+	int *count = callback_data->private_data;
+
+	struct rrr_msg_msg *message = (struct rrr_msg_msg *) entry->message;
+
+	int ret = 0;
+
+	if (!MSG_TOPIC_IS(message, "pool/dummy")) {
+		TEST_MSG("Received message with unexpected topic '%.*s' in test_thread_pool_callback\n",
+				MSG_TOPIC_LENGTH(message), MSG_TOPIC_PTR(message));
+		ret = 1;
+		goto out;
+	}
+
+	if (++(*count) > RRR_TEST_THREAD_POOL_MESSAGES * 2) {
+		TEST_MSG("Received more messages than generated in test_thread_pool_callback\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (*count == RRR_TEST_THREAD_POOL_MESSAGES * 2) {
+		result->result = 2;
+	}
+
+	out:
+	rrr_msg_holder_unlock(entry);
+	return ret;
+}
+
+int test_thread_pool (
+		RRR_TEST_FUNCTION_ARGS
+) {
+	(void)(test_function_data);
+	(void)(instances);
+
+	// Preconditions for this test:
+	// - Senders are pooled instances reading from a pooled instance with
+	//   duplicate=yes which again reads from a dummy instance generating
+	//   the given number of messages with topic pool/dummy
+
+	int ret = 0;
+
+	struct rrr_test_result test_result = {0};
+	int count = 0;
+
+	struct rrr_test_callback_data callback_data = { &test_result, &count };
+
+	ret |= test_do_poll_loop(
+			self_thread_data,
+			test_thread_pool_callback,
+			&callback_data
+	);
+	TEST_MSG("Result of test_thread_pool, should be 2: %i (%i messages)\n",
+			test_result.result, count);
+
+	ret |= (test_result.result == 2 ? 0 : 1);
+
+	return ret;
+}
+
+struct rrr_test_thread_pool_fused_data {
+	int count;
+	uint64_t timestamp_prev;
+};
+
+int test_thread_pool_fused_callback (TEST_POLL_CALLBACK_SIGNATURE) {
+	struct rrr_test_result *result = callback_data->test_result;
+	struct rrr_test_thread_pool_fused_data *fused_data = callback_data->private_data;
+
+	struct rrr_msg_msg *message = (struct rrr_msg_msg *) entry->message;
+
+	int ret = 0;
+
+	// Other topics are removed by the topic filter or routed elsewhere
+	if (!MSG_TOPIC_IS(message, "pool/a")) {
+		TEST_MSG("Received message with unexpected topic '%.*s' in test_thread_pool_fused_callback\n",
+				MSG_TOPIC_LENGTH(message), MSG_TOPIC_PTR(message));
+		ret = 1;
+		goto out;
+	}
+
+	// Several messages may be generated with the same timestamp
+	if (message->timestamp < fused_data->timestamp_prev) {
+		TEST_MSG("Message %i with timestamp %" PRIu64 " was received out of order in test_thread_pool_fused_callback\n",
+				fused_data->count, message->timestamp);
+		ret = 1;
+		goto out;
+	}
+
+	fused_data->timestamp_prev = message->timestamp;
+
+	if (++(fused_data->count) > RRR_TEST_THREAD_POOL_MESSAGES) {
+		TEST_MSG("Received more messages than generated in test_thread_pool_fused_callback\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (fused_data->count == RRR_TEST_THREAD_POOL_MESSAGES) {
+		result->result = 2;
+	}
+
+	out:
+	rrr_msg_holder_unlock(entry);
+	return ret;
+}
+
+int test_thread_pool_fused (
+		RRR_TEST_FUNCTION_ARGS
+) {
+	(void)(test_function_data);
+	(void)(instances);
+
+	// Preconditions for this test:
+	// - Sender is the last of a chain of fused pooled instances which
+	//   receive messages with topic pool/a from a dummy instance generating
+	//   the given number of messages
+
+	int ret = 0;
+
+	struct rrr_test_result test_result = {0};
+	struct rrr_test_thread_pool_fused_data fused_data = {0};
+
+	struct rrr_test_callback_data callback_data = { &test_result, &fused_data };
+
+	ret |= test_do_poll_loop(
+			self_thread_data,
+			test_thread_pool_fused_callback,
+			&callback_data
+	);
+	TEST_MSG("Result of test_thread_pool_fused, should be 2: %i (%i messages)\n",
+			test_result.result, fused_data.count);
+
+	ret |= (test_result.result == 2 ? 0 : 1);
+
+	return ret;
+}
+
+// Number of requests made by the httpclient instance in the httpserver response
+// index test. At the request interval used, the requests must span more than one
+// rotation of the response timer wheel.
+#define RRR_TEST_HTTPSERVER_RESPONSE_INDEX_MESSAGES 20
+#define RRR_TEST_HTTPSERVER_RESPONSE_INDEX_BODY "pong"
+
+int test_httpserver_response_index_callback (TEST_POLL_CALLBACK_SIGNATURE) {
+	struct rrr_test_result *result = callback_data->test_result;
+	int *count = callback_data->private_data;
+
+	struct rrr_msg_msg *message = (struct rrr_msg_msg *) entry->message;
+
+	int ret = 0;
+
+	if (!MSG_IS_DATA(message) ||
+	    MSG_DATA_LENGTH(message) != strlen(RRR_TEST_HTTPSERVER_RESPONSE_INDEX_BODY) ||
+	    memcmp(MSG_DATA_PTR(message), RRR_TEST_HTTPSERVER_RESPONSE_INDEX_BODY, MSG_DATA_LENGTH(message)) != 0
+	) {
+		TEST_MSG("Received message with unexpected class or response body in test_httpserver_response_index_callback\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (++(*count) == RRR_TEST_HTTPSERVER_RESPONSE_INDEX_MESSAGES) {
+		result->result = 2;
+	}
+
+	out:
+	rrr_msg_holder_unlock(entry);
+	return ret;
+}
+
+int test_httpserver_response_index (
+		RRR_TEST_FUNCTION_ARGS
+) {
+	(void)(test_function_data);
+	(void)(instances);
+
+	// Preconditions for this test:
+	// - Sender is an httpclient instance making the given number of requests
+	//   to an httpserver instance which gets the responses from a buffer
+	//   instance echoing the request messages back to it
+	// - Each request has the field http_body set which the echoed message
+	//   then uses as the response body
+
+	int ret = 0;
+
+	struct rrr_test_result test_result = {0};
+	int count = 0;
+
+	struct rrr_test_callback_data callback_data = { &test_result, &count };
+
+	ret |= test_do_poll_loop(
+			self_thread_data,
+			test_httpserver_response_index_callback,
+			&callback_data
+	);
+	TEST_MSG("Result of test_httpserver_response_index, should be 2: %i (%i responses)\n",
+			test_result.result, count);
+
+	ret |= (test_result.result == 2 ? 0 : 1);
+
+	return ret;
+}
+
 #define TEST_DATA_ELEMENTS 13
 
 struct rrr_test_type_array_callback_data {
@@ -40,6 +40,30 @@ int test_averager (
 		RRR_TEST_FUNCTION_ARGS
 );
 
+int test_averager_options (
+		RRR_TEST_FUNCTION_ARGS
+);
+
+int test_modbus_coalesce (
+		RRR_TEST_FUNCTION_ARGS
+);
+
+int test_mqtt_broker_threads (
+		RRR_TEST_FUNCTION_ARGS
+);
+
+int test_thread_pool (
+		RRR_TEST_FUNCTION_ARGS
+);
+
+int test_thread_pool_fused (
+		RRR_TEST_FUNCTION_ARGS
+);
+
+int test_httpserver_response_index (
+		RRR_TEST_FUNCTION_ARGS
+);
+
 int test_array (
 		RRR_TEST_FUNCTION_ARGS
 );
@@ -48,6 +48,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "test_msleep_signal_safe.h"
 #include "test_fixp.h"
 #include "test_mqtt_topic.h"
+#include "test_mqtt_session_store.h"
+#include "test_stats_shm.h"
+#include "test_thread_placement.h"
+#include "test_mqtt_topic_alias.h"
+#include "test_mqtt_acl.h"
+#include "test_crc32.h"
+#include "test_udpstream.h"
+#include "test_socket.h"
 #include "test_parse.h"
 #include "test_inet.h"
 #include "test_modbus.h"
@@ -188,6 +196,54 @@ int rrr_test_library_functions (
 
 	ret |= ret_tmp;
 
+	TEST_BEGIN("MQTT session store") {
+		ret_tmp = rrr_test_mqtt_session_store();
+	} TEST_RESULT(ret_tmp == 0);
+
+	ret |= ret_tmp;
+
+	TEST_BEGIN("statistics metrics page") {
+		ret_tmp = rrr_test_stats_shm();
+	} TEST_RESULT(ret_tmp == 0);
+
+	ret |= ret_tmp;
+
+	TEST_BEGIN("thread placement lists") {
+		ret_tmp = rrr_test_thread_placement();
+	} TEST_RESULT(ret_tmp == 0);
+
+	ret |= ret_tmp;
+
+	TEST_BEGIN("MQTT topic aliases") {
+		ret_tmp = rrr_test_mqtt_topic_alias();
+	} TEST_RESULT(ret_tmp == 0);
+
+	ret |= ret_tmp;
+
+	TEST_BEGIN("MQTT ACL") {
+		ret_tmp = rrr_test_mqtt_acl();
+	} TEST_RESULT(ret_tmp == 0);
+
+	ret |= ret_tmp;
+
+	TEST_BEGIN("CRC32") {
+		ret_tmp = rrr_test_crc32();
+	} TEST_RESULT(ret_tmp == 0);
+
+	ret |= ret_tmp;
+
+	TEST_BEGIN("UDP-stream") {
+		ret_tmp = rrr_test_udpstream();
+	} TEST_RESULT(ret_tmp == 0);
+
+	ret |= ret_tmp;
+
+	TEST_BEGIN("Socket registry") {
+		ret_tmp = rrr_test_socket();
+	} TEST_RESULT(ret_tmp == 0);
+
+	ret |= ret_tmp;
+
 	TEST_BEGIN("parsing") {
 		ret_tmp = rrr_test_parse();
 	} TEST_RESULT(ret_tmp == 0);
@@ -309,7 +365,7 @@ int rrr_test_library_functions (
 	ret |= ret_tmp;
 
 	TEST_BEGIN("http functions") {
-		ret_tmp = rrr_test_http();
+		ret_tmp = rrr_test_http(main_running, event_queue);
 	} TEST_RESULT(ret_tmp == 0);
 
 	ret |= ret_tmp;
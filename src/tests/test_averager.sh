@@ -6,3 +6,4 @@ source ./testlib.sh
 source ../../variables.sh
 
 do_test_simple test_averager.conf
+do_test_simple test_averager_options.conf
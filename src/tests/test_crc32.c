@@ -0,0 +1,89 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "../lib/log.h"
+#include "../lib/allocator.h"
+#include "../lib/util/crc32.h"
+
+#include "test.h"
+#include "test_crc32.h"
+
+#define RRR_TEST_CRC32_CHECK_INPUT "123456789"
+#define RRR_TEST_CRC32_CHECK_VALUE 0xCBF43926
+
+// Large enough to cover the folding paths, small enough to run quickly
+#define RRR_TEST_CRC32_BUF_SIZE 4096
+
+int rrr_test_crc32(void) {
+	int ret = 0;
+
+	char *buf = NULL;
+	uint32_t crc;
+
+	TEST_MSG("CRC32 implementation in use is %s\n", rrr_crc32_implementation());
+
+	if ((crc = rrr_crc32buf(RRR_TEST_CRC32_CHECK_INPUT, strlen(RRR_TEST_CRC32_CHECK_INPUT))) != RRR_TEST_CRC32_CHECK_VALUE) {
+		TEST_MSG("- Check value mismatch %08x<>%08x\n", crc, RRR_TEST_CRC32_CHECK_VALUE);
+		ret = 1;
+		goto out;
+	}
+
+	if ((buf = rrr_allocate(RRR_TEST_CRC32_BUF_SIZE)) == NULL) {
+		TEST_MSG("- Failed to allocate memory\n");
+		ret = 1;
+		goto out;
+	}
+
+	for (size_t i = 0; i < RRR_TEST_CRC32_BUF_SIZE; i++) {
+		buf[i] = (char) (rand() & 0xff);
+	}
+
+	// Check all lengths and alignments around the block sizes used by the
+	// fast implementations against the byte-at-a-time reference
+	for (rrr_biglength offset = 0; offset < 16; offset++) {
+		for (rrr_biglength len = 0; len <= 300; len++) {
+			if ((crc = rrr_crc32buf(buf + offset, len)) != rrr_crc32buf_bytewise(buf + offset, len)) {
+				TEST_MSG("- Mismatch with offset %" PRIrrrbl " length %" PRIrrrbl "\n", offset, len);
+				ret = 1;
+				goto out;
+			}
+		}
+	}
+
+	if ((crc = rrr_crc32buf(buf + 1, RRR_TEST_CRC32_BUF_SIZE - 1)) != rrr_crc32buf_bytewise(buf + 1, RRR_TEST_CRC32_BUF_SIZE - 1)) {
+		TEST_MSG("- Mismatch for full buffer\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (rrr_crc32cmp(buf, RRR_TEST_CRC32_BUF_SIZE, rrr_crc32buf_bytewise(buf, RRR_TEST_CRC32_BUF_SIZE)) != 0) {
+		TEST_MSG("- Compare function failed\n");
+		ret = 1;
+		goto out;
+	}
+
+	out:
+	RRR_FREE_IF_NOT_NULL(buf);
+	return ret;
+}
@@ -161,6 +161,24 @@ static int __rrr_test_discern_stack_resolve_topic_filter_cb (RRR_DISCERN_STACK_R
 	return 0;
 }
 
+// Test should confirm that
+//   - Second operand of AND is not evaluated when first operand is false
+//   - Equal topic filters are evaluated once across definitions
+//   - BAIL stops processing without producing an error
+
+static const char *evaltests[] = {
+	"T AAA\nT BBB\nAND D no APPLY POP",
+	"T AAA\nT YYY\nOR D yes APPLY BAIL",
+	"TRUE D no APPLY POP"
+};
+
+static int __rrr_test_discern_stack_resolve_topic_filter_count_cb (RRR_DISCERN_STACK_RESOLVE_TOPIC_FILTER_CB_ARGS) {
+	int *count = arg;
+	(*count)++;
+	*result = strncmp(topic_filter, "YYY", topic_filter_size) == 0;
+	return 0;
+}
+
 static int __rrr_test_discern_stack_resolve_array_tag_cb (RRR_DISCERN_STACK_RESOLVE_ARRAY_TAG_CB_ARGS) {
 	(void)(result);
 	(void)(new_index);
@@ -183,6 +201,56 @@ static int __rrr_test_discern_stack_apply_cb_true (RRR_DISCERN_STACK_APPLY_CB_AR
 	return 0;
 }
 
+static int __rrr_test_discern_stack_evaluation (void) {
+	int ret = 0;
+
+	struct rrr_discern_stack_collection routes = {0};
+	enum rrr_discern_stack_fault fault = 0;
+	int count = 0;
+
+	for (unsigned int i = 0; i < sizeof(evaltests)/sizeof(*evaltests); i++) {
+		struct rrr_parse_pos pos;
+		rrr_parse_pos_init(&pos, evaltests[i], rrr_length_from_biglength_bug_const(strlen(evaltests[i])));
+
+		if (rrr_discern_stack_interpret (&routes, &fault, &pos, evaltests[i]) != 0) {
+			TEST_MSG("%s\n -> NOT OK - Parsing failed, fault was %i\n", evaltests[i], fault);
+			ret = 1;
+			goto out;
+		}
+	}
+
+	struct rrr_discern_stack_callbacks callbacks = {
+		__rrr_test_discern_stack_resolve_topic_filter_count_cb,
+		__rrr_test_discern_stack_resolve_array_tag_cb,
+		&count,
+		__rrr_test_discern_stack_apply_cb_false,
+		__rrr_test_discern_stack_apply_cb_true,
+		NULL
+	};
+
+	for (int i = 0; i < 2; i++) {
+		count = 0;
+
+		TEST_MSG("Evaluation (execute %i) -> ", i);
+
+		if (rrr_discern_stack_collection_execute (&fault, &routes, &callbacks) != 0) {
+			TEST_MSG("NOT OK - Execution failed, fault was %i\n", fault);
+			ret = 1;
+		}
+		else if (count != 2) {
+			TEST_MSG("NOT OK - Topic filters resolved %i times, expected 2\n", count);
+			ret = 1;
+		}
+		else {
+			TEST_MSG("OK\n");
+		}
+	}
+
+	out:
+	rrr_discern_stack_collection_clear(&routes);
+	return ret;
+}
+
 int rrr_test_discern_stack(void) {
 	int ret = 0;
 
@@ -301,6 +369,8 @@ int rrr_test_discern_stack(void) {
 
 	rrr_discern_stack_collection_clear(&routes);
 
+	ret |= __rrr_test_discern_stack_evaluation();
+
 	return ret;
 }
 
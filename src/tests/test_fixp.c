@@ -30,6 +30,62 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../lib/fixed_point.h"
 #include "../lib/util/macro_utils.h"
 
+static int __rrr_test_fixp_dec (void) {
+	// Boundaries of fraction rounding and whole number range. The most negative
+	// number is not compared as the long double conversion overflows on it.
+	static const uint64_t values[] = {
+		0,
+		1,
+		2,
+		0x7f,
+		0x80,
+		0x81,
+		0xffffff,
+		0x1000000,
+		0x1800000,
+		0x1ffffff,
+		0x7fffffffffffffffULL,
+		0x8000000000000001ULL,
+		0xffffffffffffffffULL,
+		0xfffffffffeffffffULL
+	};
+
+	char buf_a[RRR_FIXED_POINT_DEC_MAX + 1];
+	char buf_b[128];
+	uint64_t value = 0x123456789abcdefULL;
+
+	for (int i = 0; i < 10000; i++) {
+		if (i < (int) (sizeof(values) / sizeof(values[0]))) {
+			value = values[i];
+		}
+		else {
+			// Simple LCG to cover many fractions and magnitudes
+			value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+			value >>= (i % 40);
+			if (value == 0x8000000000000000ULL) {
+				continue;
+			}
+		}
+
+		rrr_fixp fixp;
+		memcpy(&fixp, &value, sizeof(fixp));
+
+		long double dbl = 0;
+		rrr_fixp_to_ldouble(&dbl, fixp);
+
+		buf_a[rrr_fixp_to_dec(buf_a, fixp)] = '\0';
+		snprintf(buf_b, sizeof(buf_b), "%.10Lf", dbl);
+
+		if (strcmp(buf_a, buf_b) != 0) {
+			TEST_MSG("Mismatch while converting fixed point 0x%llx to decimal, expected '%s' but got '%s'\n",
+					(unsigned long long) value, buf_b, buf_a);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 int rrr_test_fixp(void) {
 	int ret = 0;
 
@@ -209,6 +265,10 @@ int rrr_test_fixp(void) {
 		goto out;
 	}
 
+	if ((ret = __rrr_test_fixp_dec()) != 0) {
+		goto out;
+	}
+
 	out:
 	RRR_FREE_IF_NOT_NULL(tmp);
 	return (ret != 0);
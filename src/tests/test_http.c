@@ -24,8 +24,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "test.h"
 #include "test_http.h"
 #include "../lib/log.h"
+#include "../lib/event/event.h"
+#include "../lib/http/http_client.h"
+#include "../lib/http/http_server.h"
+#include "../lib/http/http_transaction.h"
+#include "../lib/http/http_part.h"
+#include "../lib/net_transport/net_transport_config.h"
+#include "../lib/util/rrr_time.h"
 #include "../lib/http/http_util.c"
 
+#define RRR_TEST_HTTP_CLIENT_POOL_PORT        8889
+#define RRR_TEST_HTTP_CLIENT_POOL_TIMEOUT_S   5
+#define RRR_TEST_HTTP_CLIENT_POOL_REQUESTS    3
+#define RRR_TEST_HTTP_CLIENT_POOL_CONNECTIONS 4
+
 struct rrr_test_http_endpoint_and_query_string_split_callback_data {
 	const char *expect_endpoint;
 	const char *expect_query_string;
@@ -200,13 +212,247 @@ static int __rrr_test_http_endpoint_and_query_string_split (void) {
 	return ret;
 }
 
-int rrr_test_http (void) {
+struct rrr_test_http_client_pool_data {
+	const volatile int *main_running;
+	struct rrr_http_client *http_client;
+	struct rrr_http_client_request_data request_data;
+	struct rrr_net_transport_config net_transport_config;
+	rrr_http_unique_id unique_id_counter;
+	uint64_t timeout;
+	int requests_sent;
+	int responses_received;
+	int failed;
+	struct rrr_http_client_pool_stats pool_stats_first;
+};
+
+static int __rrr_test_http_client_pool_unique_id_generator_callback (
+		RRR_HTTP_CLIENT_UNIQUE_ID_GENERATOR_CALLBACK_ARGS
+) {
+	struct rrr_test_http_client_pool_data *data = arg;
+	*unique_id = ++(data->unique_id_counter);
+	return 0;
+}
+
+static int __rrr_test_http_client_pool_final_callback (
+		RRR_HTTP_CLIENT_FINAL_CALLBACK_ARGS
+) {
+	struct rrr_test_http_client_pool_data *data = arg;
+
+	(void)(response_data);
+
+	// The server has no callbacks and gives an empty response
+	if (transaction->response_part->response_code != RRR_HTTP_RESPONSE_CODE_OK_NO_CONTENT) {
+		TEST_MSG("Unexpected response code %u in HTTP client pool test\n",
+				transaction->response_part->response_code);
+		data->failed = 1;
+	}
+
+	// The first request may have been retried while the connection was
+	// being opened, later requests are compared with the counters here
+	if (++(data->responses_received) == 1) {
+		rrr_http_client_pool_stats_get(&data->pool_stats_first, data->http_client);
+	}
+
+	return 0;
+}
+
+static int __rrr_test_http_client_pool_failure_callback (
+		RRR_HTTP_CLIENT_FAILURE_CALLBACK_ARGS
+) {
+	struct rrr_test_http_client_pool_data *data = arg;
+
+	(void)(transaction);
+
+	TEST_MSG("Request failed in HTTP client pool test: %s\n", error_msg);
+	data->failed = 1;
+
+	return 0;
+}
+
+// Requests are sent one at a time, each after the response to the previous
+// one is received. The connection is then idle when the next request is made.
+static int __rrr_test_http_client_pool_periodic (RRR_EVENT_FUNCTION_PERIODIC_ARGS) {
+	struct rrr_test_http_client_pool_data *data = arg;
+
+	int ret = 0;
+
+	if (!*data->main_running) {
+		TEST_MSG("HTTP client pool test aborted\n");
+		return RRR_EVENT_ERR;
+	}
+
+	if (rrr_time_get_64() > data->timeout) {
+		TEST_MSG("HTTP client pool test timeout after %i seconds\n", RRR_TEST_HTTP_CLIENT_POOL_TIMEOUT_S);
+		return RRR_EVENT_ERR;
+	}
+
+	if (data->failed) {
+		return RRR_EVENT_ERR;
+	}
+
+	if (data->responses_received == RRR_TEST_HTTP_CLIENT_POOL_REQUESTS) {
+		return RRR_EVENT_EXIT;
+	}
+
+	if (data->requests_sent > data->responses_received) {
+		return RRR_EVENT_OK;
+	}
+
+	if ((ret = rrr_http_client_request_send (
+			&data->request_data,
+			data->http_client,
+			&data->net_transport_config,
+			0,
+			NULL,
+			NULL,
+			NULL,
+			NULL,
+			NULL,
+			NULL
+	)) == 0) {
+		data->requests_sent++;
+	}
+	else if (ret != RRR_HTTP_BUSY) {
+		TEST_MSG("Failed to send request in HTTP client pool test\n");
+		return RRR_EVENT_ERR;
+	}
+
+	return RRR_EVENT_OK;
+}
+
+static int __rrr_test_http_client_pool (
+		const volatile int *main_running,
+		struct rrr_event_queue *queue
+) {
+	int ret = 0;
+
+	struct rrr_http_server *http_server = NULL;
+	struct rrr_http_client_pool_stats pool_stats;
+
+	const struct rrr_http_server_callbacks server_callbacks = {0};
+
+	struct rrr_test_http_client_pool_data data = {0};
+
+	const struct rrr_http_client_callbacks client_callbacks = {
+		.final_callback = __rrr_test_http_client_pool_final_callback,
+		.failure_callback = __rrr_test_http_client_pool_failure_callback,
+		.unique_id_generator_callback = __rrr_test_http_client_pool_unique_id_generator_callback,
+		.callback_arg = &data
+	};
+
+	data.main_running = main_running;
+	data.timeout = rrr_time_get_64() + RRR_TEST_HTTP_CLIENT_POOL_TIMEOUT_S * 1000 * 1000;
+	data.net_transport_config.transport_type_p = RRR_NET_TRANSPORT_PLAIN;
+	data.net_transport_config.transport_type_f = RRR_NET_TRANSPORT_F_PLAIN;
+
+	// More connections are allowed than requests are made, each request
+	// after the first must still use the idle connection
+	data.request_data.concurrent_connections = RRR_TEST_HTTP_CLIENT_POOL_CONNECTIONS;
+
+	if ((ret = rrr_http_server_new(&http_server, &server_callbacks)) != 0) {
+		TEST_MSG("Failed to create HTTP server in %s\n", __func__);
+		goto out;
+	}
+
+	if ((ret = rrr_http_server_start_plain (
+			http_server,
+			queue,
+			RRR_TEST_HTTP_CLIENT_POOL_PORT,
+			1000, // 1s first read timeout
+			5000, // 5s read timeout
+			0     // No send chunk limit
+	)) != 0) {
+		TEST_MSG("Failed to start HTTP server in %s\n", __func__);
+		goto out_destroy_server;
+	}
+
+	if ((ret = rrr_http_client_new (
+			&data.http_client,
+			queue,
+			RRR_TEST_HTTP_CLIENT_POOL_TIMEOUT_S * 1000,
+			0, // No send chunk limit
+			&client_callbacks
+	)) != 0) {
+		TEST_MSG("Failed to create HTTP client in %s\n", __func__);
+		goto out_destroy_server;
+	}
+
+	if ((ret = rrr_http_client_request_data_reset (
+			&data.request_data,
+			RRR_HTTP_TRANSPORT_HTTP,
+			RRR_HTTP_METHOD_GET,
+			RRR_HTTP_BODY_FORMAT_URLENCODED,
+			RRR_HTTP_UPGRADE_MODE_NONE,
+			RRR_HTTP_VERSION_11,
+#ifdef RRR_WITH_NGHTTP2
+			0, // No plain HTTP2
+#endif
+			"RRR/test"
+	)) != 0) {
+		goto out_destroy_client;
+	}
+
+	if ((ret = rrr_http_client_request_data_reset_from_raw (
+			&data.request_data,
+			"localhost",
+			RRR_TEST_HTTP_CLIENT_POOL_PORT
+	)) != 0) {
+		goto out_cleanup_request_data;
+	}
+
+	if ((ret = rrr_event_dispatch (
+			queue,
+			10 * 1000, // 10 ms
+			__rrr_test_http_client_pool_periodic,
+			&data
+	)) != 0) {
+		TEST_MSG("HTTP client pool test failed after %i of %i responses\n",
+				data.responses_received, RRR_TEST_HTTP_CLIENT_POOL_REQUESTS);
+		goto out_cleanup_request_data;
+	}
+
+	rrr_http_client_pool_stats_get(&pool_stats, data.http_client);
+
+	TEST_MSG("HTTP client pool connections %" PRIu64 " opened %" PRIu64 " reused %" PRIu64 " busy %" PRIu64 "\n",
+			pool_stats.connections,
+			pool_stats.connections_opened,
+			pool_stats.requests_reused,
+			pool_stats.requests_busy
+	);
+
+	if (pool_stats.connections != 1 || pool_stats.connections_opened != 1 || data.pool_stats_first.connections_opened != 1) {
+		TEST_MSG("Expected one connection to be open and one to have been opened in HTTP client pool test\n");
+		ret = 1;
+	}
+
+	if (pool_stats.requests_reused - data.pool_stats_first.requests_reused != RRR_TEST_HTTP_CLIENT_POOL_REQUESTS - 1) {
+		TEST_MSG("Expected %i requests on the idle connection after the first response in HTTP client pool test, got %" PRIu64 "\n",
+				RRR_TEST_HTTP_CLIENT_POOL_REQUESTS - 1,
+				pool_stats.requests_reused - data.pool_stats_first.requests_reused);
+		ret = 1;
+	}
+
+	out_cleanup_request_data:
+		rrr_http_client_request_data_cleanup(&data.request_data);
+	out_destroy_client:
+		rrr_http_client_destroy(data.http_client);
+	out_destroy_server:
+		rrr_http_server_destroy(http_server);
+	out:
+		return ret;
+}
+
+int rrr_test_http (const volatile int *main_running, struct rrr_event_queue *queue) {
 	int ret = 0;
 
 	if ((ret = __rrr_test_http_endpoint_and_query_string_split()) != 0) {
 		goto out;
 	}
 
+	if ((ret = __rrr_test_http_client_pool(main_running, queue)) != 0) {
+		goto out;
+	}
+
 	out:
 	return ret;
 }
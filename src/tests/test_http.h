@@ -21,6 +21,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef RRR_TEST_HTTP_H
 #define RRR_TEST_HTTP_H
 
-int rrr_test_http (void);
+struct rrr_event_queue;
+
+int rrr_test_http (const volatile int *main_running, struct rrr_event_queue *queue);
 
 #endif /* RRR_TEST_HTTP_H */
@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+
+set -e
+
+source ./testlib.sh
+source ../../variables.sh
+
+HTTPSERVER_RESPONSE_INDEX_LOG=/tmp/rrr-test-httpserver-response-index.log.$SUFFIX
+trap "rm -f $HTTPSERVER_RESPONSE_INDEX_LOG" EXIT
+
+# Debuglevel 1 makes the httpserver log expired responses and debuglevel 3
+# makes it log responses claimed from the index
+print_test_header SIMPLE test_httpserver_response_index.conf
+echo \$ $TEST -d 5 test_httpserver_response_index.conf
+$TEST -d 5 test_httpserver_response_index.conf > $HTTPSERVER_RESPONSE_INDEX_LOG 2>&1 || {
+	grep -v '^<[23]>' $HTTPSERVER_RESPONSE_INDEX_LOG || true
+	fail test_httpserver_response_index.conf
+}
+grep -v '^<[23]>' $HTTPSERVER_RESPONSE_INDEX_LOG || true
+
+CLAIMED=`grep -c 'got a response from senders' $HTTPSERVER_RESPONSE_INDEX_LOG || true`
+EXPIRED=`grep 'responses from senders which have timed out' $HTTPSERVER_RESPONSE_INDEX_LOG | sed 's/.* deleted \([0-9]*\) responses.*/\1/' | awk '{s+=$1} END {print s+0}'`
+echo "Claimed $CLAIMED responses from the index, $EXPIRED responses expired"
+
+# Claimed responses must have been removed from the timer wheel, only the
+# unclaimed one may expire
+if test $EXPIRED -ne 1; then
+	fail "test_httpserver_response_index.conf expired count"
+fi
+
+# The unclaimed response is in the same wheel slot as responses expiring
+# 0.6 seconds after it was indexed. At one request each 0.5 seconds, a
+# good number of responses must have been claimed before it expired.
+CLAIMED_BEFORE_EXPIRY=`sed '/responses from senders which have timed out/q' $HTTPSERVER_RESPONSE_INDEX_LOG | grep -c 'got a response from senders' || true`
+echo "Claimed $CLAIMED_BEFORE_EXPIRY responses before the unclaimed response expired"
+
+if test $CLAIMED_BEFORE_EXPIRY -lt 6; then
+	fail "test_httpserver_response_index.conf expiry time"
+fi
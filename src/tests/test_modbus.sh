@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+
+set -e
+
+source ./testlib.sh
+source ../../variables.sh
+
+MODBUS_SERVER=../rrr_modbus_server
+MODBUS_PORT=5022
+MODBUS_SERVER_LOG=/tmp/rrr-test-modbus-server.log.$SUFFIX
+MODBUS_ARRAY_DEFINITION=be2#modbus_port,be1#modbus_function_code,be2#modbus_starting_address,be2#modbus_quantity,be2#modbus_interval_ms
+
+# Read holding registers 100-101, 102-104 and 105 every 100 ms. The
+# modbus instance should merge them into one read of 100-105.
+do_modbus_commands() {
+	sleep 1
+	printf '\x13\x9e\x03\x00\x64\x00\x02\x00\x64\x13\x9e\x03\x00\x66\x00\x03\x00\x64\x13\x9e\x03\x00\x69\x00\x01\x00\x64' | \
+		$RRR_POST $RRR_POST_SOCKET -f - -a $MODBUS_ARRAY_DEFINITION
+}
+
+$MODBUS_SERVER -p $MODBUS_PORT -d 1 > $MODBUS_SERVER_LOG 2>&1 &
+MODBUS_SERVER_PID=$!
+trap "kill $MODBUS_SERVER_PID 2>/dev/null || true; rm -f $MODBUS_SERVER_LOG" EXIT
+
+print_test_header MODBUS test_modbus.conf
+do_modbus_commands &
+echo \$ $TEST test_modbus.conf
+$TEST test_modbus.conf || fail test_modbus.conf
+
+# Stop the server to make sure its log is complete
+kill -INT $MODBUS_SERVER_PID
+wait $MODBUS_SERVER_PID || true
+
+# Apart from a round sent before all commands have arrived, only
+# merged reads may be sent
+COALESCED=`grep -c 'function 0x03 starting address 100 quantity 6' $MODBUS_SERVER_LOG || true`
+TOTAL=`grep -c 'Response to function 0x03' $MODBUS_SERVER_LOG || true`
+echo "Modbus server received $TOTAL read requests of which $COALESCED were merged"
+
+if test $COALESCED -lt 3 || test $(($TOTAL - $COALESCED)) -gt 2; then
+	fail "test_modbus.conf request count"
+fi
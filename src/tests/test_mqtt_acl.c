@@ -0,0 +1,185 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "../lib/log.h"
+#include "../lib/mqtt/mqtt_acl.h"
+#include "../lib/mqtt/mqtt_topic.h"
+
+#include "test.h"
+#include "test_mqtt_acl.h"
+
+#define RRR_TEST_MQTT_ACL_FILE "/tmp/rrr_test_mqtt_acl"
+
+static const char rrr_test_mqtt_acl_contents[] =
+	"TOPIC a/b\n"
+	"	DEFAULT WRITE\n"
+	"	USER user1 READ\n"
+	"TOPIC a/+\n"
+	"	DEFAULT READ\n"
+	"TOPIC $SYS/#\n"
+	"	DEFAULT READ\n"
+	"TOPIC x/#\n"
+	"	DEFAULT DENY\n"
+	"	USER user1 DENY\n"
+	"	USER user1 WRITE\n"
+	"TOPIC +/c\n"
+	"	DEFAULT WRITE\n";
+
+struct rrr_test_mqtt_acl_case {
+	const char *topic;
+	int match_type;
+	int access_level;
+	const char *username;
+	int result;
+};
+
+static const struct rrr_test_mqtt_acl_case rrr_test_mqtt_acl_cases[] = {
+	{"a/b",     RRR_MQTT_ACL_MATCH_PUBLISH,   RRR_MQTT_ACL_ACTION_RW, NULL,    RRR_MQTT_ACL_RESULT_DENY},
+	{"a/b",     RRR_MQTT_ACL_MATCH_PUBLISH,   RRR_MQTT_ACL_ACTION_RO, NULL,    RRR_MQTT_ACL_RESULT_ALLOW},
+	{"c/d",     RRR_MQTT_ACL_MATCH_PUBLISH,   RRR_MQTT_ACL_ACTION_RO, NULL,    RRR_MQTT_ACL_RESULT_DENY},
+	{"x/y/z",   RRR_MQTT_ACL_MATCH_PUBLISH,   RRR_MQTT_ACL_ACTION_RW, NULL,    RRR_MQTT_ACL_RESULT_DENY},
+	{"x/y/z",   RRR_MQTT_ACL_MATCH_PUBLISH,   RRR_MQTT_ACL_ACTION_RW, "user1", RRR_MQTT_ACL_RESULT_ALLOW},
+	{"x/c",     RRR_MQTT_ACL_MATCH_PUBLISH,   RRR_MQTT_ACL_ACTION_RW, NULL,    RRR_MQTT_ACL_RESULT_ALLOW},
+	{"$SYS/c",  RRR_MQTT_ACL_MATCH_PUBLISH,   RRR_MQTT_ACL_ACTION_RW, NULL,    RRR_MQTT_ACL_RESULT_DENY},
+	{"$SYS/c",  RRR_MQTT_ACL_MATCH_PUBLISH,   RRR_MQTT_ACL_ACTION_RO, NULL,    RRR_MQTT_ACL_RESULT_ALLOW},
+	{"a/#",     RRR_MQTT_ACL_MATCH_SUBSCRIBE, RRR_MQTT_ACL_ACTION_RO, NULL,    RRR_MQTT_ACL_RESULT_DENY},
+	{"+/c",     RRR_MQTT_ACL_MATCH_SUBSCRIBE, RRR_MQTT_ACL_ACTION_RO, NULL,    RRR_MQTT_ACL_RESULT_ALLOW},
+	{"x/#",     RRR_MQTT_ACL_MATCH_SUBSCRIBE, RRR_MQTT_ACL_ACTION_RO, NULL,    RRR_MQTT_ACL_RESULT_DENY},
+	{"x/#",     RRR_MQTT_ACL_MATCH_SUBSCRIBE, RRR_MQTT_ACL_ACTION_RO, "user1", RRR_MQTT_ACL_RESULT_ALLOW},
+	{"+/+",     RRR_MQTT_ACL_MATCH_SUBSCRIBE, RRR_MQTT_ACL_ACTION_RO, NULL,    RRR_MQTT_ACL_RESULT_ALLOW},
+	{"$SYS/+",  RRR_MQTT_ACL_MATCH_SUBSCRIBE, RRR_MQTT_ACL_ACTION_RO, NULL,    RRR_MQTT_ACL_RESULT_ALLOW},
+	{NULL,      0,                            0,                      NULL,    0}
+};
+
+static int __rrr_test_mqtt_acl_write_file (
+		const char *contents
+) {
+	FILE *file;
+
+	if ((file = fopen(RRR_TEST_MQTT_ACL_FILE, "w")) == NULL) {
+		TEST_MSG("- Could not open %s\n", RRR_TEST_MQTT_ACL_FILE);
+		return 1;
+	}
+
+	const size_t length = strlen(contents);
+	const size_t written = fwrite(contents, 1, length, file);
+
+	fclose(file);
+
+	return written != length;
+}
+
+static int __rrr_test_mqtt_acl_check (
+		struct rrr_mqtt_acl_cache *cache,
+		const struct rrr_mqtt_acl *acl,
+		const struct rrr_test_mqtt_acl_case *test_case
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_topic_token *token = NULL;
+
+	if (rrr_mqtt_topic_tokenize(&token, test_case->topic) != 0) {
+		TEST_MSG("- Could not tokenize topic %s\n", test_case->topic);
+		ret = 1;
+		goto out;
+	}
+
+	// Second round is served from the cache
+	for (int i = 0; i < 2; i++) {
+		const int result = rrr_mqtt_acl_check_access_cached (
+				cache,
+				acl,
+				test_case->topic,
+				token,
+				test_case->access_level,
+				test_case->username,
+				test_case->match_type
+		);
+
+		if (result != test_case->result) {
+			TEST_MSG("- Topic %s user %s level %i type %i got result %i, expected %i (round %i)\n",
+					test_case->topic,
+					test_case->username != NULL ? test_case->username : "",
+					test_case->access_level,
+					test_case->match_type,
+					result,
+					test_case->result,
+					i
+			);
+			ret = 1;
+		}
+	}
+
+	out:
+	rrr_mqtt_topic_token_destroy(token);
+	return ret;
+}
+
+int rrr_test_mqtt_acl (void) {
+	int ret = 0;
+
+	struct rrr_mqtt_acl acl = {0};
+	struct rrr_mqtt_acl_cache cache_anonymous = {0};
+	struct rrr_mqtt_acl_cache cache_user = {0};
+
+	if (__rrr_test_mqtt_acl_write_file(rrr_test_mqtt_acl_contents) != 0) {
+		ret = 1;
+		goto out;
+	}
+
+	if (rrr_mqtt_acl_entry_collection_populate_from_file(&acl, RRR_TEST_MQTT_ACL_FILE) != 0) {
+		TEST_MSG("- Could not load ACL file\n");
+		ret = 1;
+		goto out;
+	}
+
+	for (const struct rrr_test_mqtt_acl_case *test_case = rrr_test_mqtt_acl_cases; test_case->topic != NULL; test_case++) {
+		ret |= __rrr_test_mqtt_acl_check (
+				test_case->username != NULL ? &cache_user : &cache_anonymous,
+				&acl,
+				test_case
+		);
+	}
+
+	// Cached decisions must not survive a reload
+	rrr_mqtt_acl_entry_collection_clear(&acl);
+	if (rrr_mqtt_acl_entry_collection_push_allow_all(&acl) != 0) {
+		TEST_MSG("- Could not reload ACL\n");
+		ret = 1;
+		goto out;
+	}
+
+	const struct rrr_test_mqtt_acl_case test_case_reload = {
+		"a/b", RRR_MQTT_ACL_MATCH_PUBLISH, RRR_MQTT_ACL_ACTION_RW, NULL, RRR_MQTT_ACL_RESULT_ALLOW
+	};
+	ret |= __rrr_test_mqtt_acl_check(&cache_anonymous, &acl, &test_case_reload);
+
+	out:
+	rrr_mqtt_acl_cache_clear(&cache_anonymous);
+	rrr_mqtt_acl_cache_clear(&cache_user);
+	rrr_mqtt_acl_entry_collection_clear(&acl);
+	unlink(RRR_TEST_MQTT_ACL_FILE);
+	return ret;
+}
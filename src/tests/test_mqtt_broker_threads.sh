@@ -0,0 +1,26 @@
+#!/usr/bin/env bash
+
+set -e
+
+source ./testlib.sh
+source ../../variables.sh
+
+MQTT_BROKER_THREADS_LOG=/tmp/rrr-test-mqtt-broker-threads.log.$SUFFIX
+trap "rm -f $MQTT_BROKER_THREADS_LOG" EXIT
+
+# Debuglevel 2 makes the broker log session takeovers
+print_test_header SIMPLE test_mqtt_broker_threads.conf
+echo \$ $TEST -d 2 test_mqtt_broker_threads.conf
+$TEST -d 2 test_mqtt_broker_threads.conf > $MQTT_BROKER_THREADS_LOG 2>&1 || {
+	grep -v '^<2>' $MQTT_BROKER_THREADS_LOG || true
+	fail test_mqtt_broker_threads.conf
+}
+grep -v '^<2>' $MQTT_BROKER_THREADS_LOG || true
+
+TAKEN_OVER=`grep -c 'the old one was disconnected' $MQTT_BROKER_THREADS_LOG || true`
+TAKEN_OVER_THREADS=`grep -c 'session was taken over by connection in another broker thread' $MQTT_BROKER_THREADS_LOG || true`
+echo "Session was taken over $TAKEN_OVER times of which $TAKEN_OVER_THREADS were from another broker thread"
+
+if test $TAKEN_OVER_THREADS -lt 1; then
+	fail "test_mqtt_broker_threads.conf takeover count"
+fi
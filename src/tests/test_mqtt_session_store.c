@@ -0,0 +1,427 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "../lib/log.h"
+#include "../lib/allocator.h"
+#include "../lib/mqtt/mqtt_packet.h"
+#include "../lib/mqtt/mqtt_payload.h"
+#include "../lib/mqtt/mqtt_subscription.h"
+#include "../lib/mqtt/mqtt_session_store.h"
+
+#include "test.h"
+#include "test_mqtt_session_store.h"
+
+#define RRR_TEST_MQTT_SESSION_STORE_FILE "/tmp/rrr_test_mqtt_session_store"
+
+#define RRR_TEST_MQTT_SESSION_STORE_TOPIC   "a/b/c"
+#define RRR_TEST_MQTT_SESSION_STORE_PAYLOAD "payload"
+#define RRR_TEST_MQTT_SESSION_STORE_CLIENT  "client"
+#define RRR_TEST_MQTT_SESSION_STORE_FILTER  "a/+/c"
+
+struct rrr_test_mqtt_session_store_replay_data {
+	int count;
+	int fail;
+	rrr_biglength retain_offset;
+};
+
+static int __rrr_test_mqtt_session_store_verify_publish (
+		struct rrr_mqtt_session_store_reader *reader
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_p_publish *publish = NULL;
+
+	if (rrr_mqtt_session_store_reader_get_publish(&publish, reader) != 0) {
+		TEST_MSG("- Failed to read PUBLISH\n");
+		ret = 1;
+		goto out;
+	}
+
+	if ( strcmp(publish->topic, RRR_TEST_MQTT_SESSION_STORE_TOPIC) != 0 ||
+	     RRR_MQTT_P_PUBLISH_GET_FLAG_QOS(publish) != 1 ||
+	     RRR_MQTT_P_PUBLISH_GET_FLAG_RETAIN(publish) != 1 ||
+	     publish->payload == NULL ||
+	     publish->payload->size != strlen(RRR_TEST_MQTT_SESSION_STORE_PAYLOAD) ||
+	     memcmp(publish->payload->payload_start, RRR_TEST_MQTT_SESSION_STORE_PAYLOAD, publish->payload->size) != 0
+	) {
+		TEST_MSG("- PUBLISH read back did not match\n");
+		ret = 1;
+		goto out;
+	}
+
+	out:
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish);
+	return ret;
+}
+
+static int __rrr_test_mqtt_session_store_verify_session (
+		struct rrr_mqtt_session_store_reader *reader
+) {
+	int ret = 0;
+
+	char *client_id = NULL;
+	uint32_t session_expiry = 0;
+	struct rrr_mqtt_subscription_collection subscriptions = {0};
+
+	if ( rrr_mqtt_session_store_reader_get_str(&client_id, reader) != 0 ||
+	     rrr_mqtt_session_store_reader_get_u32(&session_expiry, reader) != 0 ||
+	     rrr_mqtt_session_store_reader_get_subscriptions(&subscriptions, reader) != 0
+	) {
+		TEST_MSG("- Failed to read session\n");
+		ret = 1;
+		goto out;
+	}
+
+	if ( strcmp(client_id, RRR_TEST_MQTT_SESSION_STORE_CLIENT) != 0 ||
+	     session_expiry != 3600 ||
+	     RRR_LL_COUNT(&subscriptions) != 1 ||
+	     strcmp(RRR_LL_FIRST(&subscriptions)->topic_filter, RRR_TEST_MQTT_SESSION_STORE_FILTER) != 0 ||
+	     RRR_LL_FIRST(&subscriptions)->qos_or_reason_v5 != 2
+	) {
+		TEST_MSG("- Session read back did not match\n");
+		ret = 1;
+		goto out;
+	}
+
+	out:
+	rrr_mqtt_subscription_collection_clear(&subscriptions);
+	RRR_FREE_IF_NOT_NULL(client_id);
+	return ret;
+}
+
+static int __rrr_test_mqtt_session_store_replay_callback (
+		RRR_MQTT_SESSION_STORE_REPLAY_CALLBACK_ARGS
+) {
+	struct rrr_test_mqtt_session_store_replay_data *replay_data = arg;
+
+	int ret = 0;
+
+	switch (type) {
+		case RRR_MQTT_SESSION_STORE_RECORD_RETAIN:
+			ret = __rrr_test_mqtt_session_store_verify_publish(reader);
+			replay_data->retain_offset = offset;
+			break;
+		case RRR_MQTT_SESSION_STORE_RECORD_SESSION:
+			ret = __rrr_test_mqtt_session_store_verify_session(reader);
+			break;
+		default:
+			TEST_MSG("- Unexpected record type %u\n", type);
+			ret = 1;
+			break;
+	};
+
+	if (reader->pos != reader->end) {
+		TEST_MSG("- Record of type %u was not fully read\n", type);
+		ret = 1;
+	}
+
+	replay_data->count++;
+	replay_data->fail |= ret;
+
+	// Continue to let the test count the records
+	return 0;
+}
+
+static int __rrr_test_mqtt_session_store_write (
+		rrr_biglength *retain_offset,
+		struct rrr_mqtt_session_store *store
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_session_store_record record = {0};
+	struct rrr_mqtt_p_publish *publish = NULL;
+	struct rrr_mqtt_subscription_collection *subscriptions = NULL;
+
+	if ((ret = rrr_mqtt_p_new_publish (
+			&publish,
+			RRR_TEST_MQTT_SESSION_STORE_TOPIC,
+			RRR_TEST_MQTT_SESSION_STORE_PAYLOAD,
+			strlen(RRR_TEST_MQTT_SESSION_STORE_PAYLOAD),
+			rrr_mqtt_p_get_protocol_version(RRR_MQTT_VERSION_5)
+	)) != 0) {
+		goto out;
+	}
+
+	RRR_MQTT_P_PUBLISH_SET_FLAG_QOS(publish, 1);
+	RRR_MQTT_P_PUBLISH_SET_FLAG_RETAIN(publish, 1);
+
+	if ( (ret = rrr_mqtt_session_store_record_push_publish(&record, publish)) != 0 ||
+	     (ret = rrr_mqtt_session_store_append_with_offset(retain_offset, store, RRR_MQTT_SESSION_STORE_RECORD_RETAIN, &record)) != 0
+	) {
+		goto out;
+	}
+
+	rrr_mqtt_session_store_record_clear(&record);
+
+	if ((ret = rrr_mqtt_subscription_collection_new(&subscriptions)) != 0) {
+		goto out;
+	}
+
+	if ((ret = rrr_mqtt_subscription_collection_push_unique_str (
+			subscriptions,
+			RRR_TEST_MQTT_SESSION_STORE_FILTER,
+			0,
+			0,
+			0,
+			2
+	)) != 0) {
+		goto out;
+	}
+
+	if ( (ret = rrr_mqtt_session_store_record_push_str(&record, RRR_TEST_MQTT_SESSION_STORE_CLIENT)) != 0 ||
+	     (ret = rrr_mqtt_session_store_record_push_u32(&record, 3600)) != 0 ||
+	     (ret = rrr_mqtt_session_store_record_push_subscriptions(&record, subscriptions)) != 0 ||
+	     (ret = rrr_mqtt_session_store_append(store, RRR_MQTT_SESSION_STORE_RECORD_SESSION, &record)) != 0
+	) {
+		goto out;
+	}
+
+	out:
+	if (subscriptions != NULL) {
+		rrr_mqtt_subscription_collection_destroy(subscriptions);
+	}
+	rrr_mqtt_session_store_record_clear(&record);
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish);
+	return ret;
+}
+
+static int __rrr_test_mqtt_session_store_reopen (
+		struct rrr_test_mqtt_session_store_replay_data *replay_data
+) {
+	struct rrr_mqtt_session_store *store = NULL;
+
+	memset(replay_data, '\0', sizeof(*replay_data));
+
+	if (rrr_mqtt_session_store_open (
+			&store,
+			RRR_TEST_MQTT_SESSION_STORE_FILE,
+			0,
+			__rrr_test_mqtt_session_store_replay_callback,
+			replay_data
+	) != 0) {
+		TEST_MSG("- Failed to open store\n");
+		return 1;
+	}
+
+	rrr_mqtt_session_store_close(store);
+
+	return replay_data->fail;
+}
+
+static int __rrr_test_mqtt_session_store_append_garbage (void) {
+	int ret = 0;
+
+	int fd = open(RRR_TEST_MQTT_SESSION_STORE_FILE, O_WRONLY|O_APPEND);
+	if (fd < 0) {
+		return 1;
+	}
+
+	// Simulates a record partially written before a crash
+	const char garbage[] = { 0, 0, 0, 20, RRR_MQTT_SESSION_STORE_RECORD_SESSION, 'a', 'b' };
+	if (write(fd, garbage, sizeof(garbage)) != sizeof(garbage)) {
+		ret = 1;
+	}
+
+	close(fd);
+
+	return ret;
+}
+
+int rrr_test_mqtt_session_store (void) {
+	int ret = 0;
+
+	struct rrr_mqtt_session_store *store = NULL;
+	struct rrr_test_mqtt_session_store_replay_data replay_data = {0};
+	rrr_biglength offset = 0;
+	int is_complete = 0;
+	rrr_biglength tail_offset = 0;
+	rrr_biglength tail_offset_new = 0;
+
+	unlink(RRR_TEST_MQTT_SESSION_STORE_FILE);
+
+	TEST_MSG("\n=== WRITE AND REPLAY\n");
+
+	if (rrr_mqtt_session_store_open (
+			&store,
+			RRR_TEST_MQTT_SESSION_STORE_FILE,
+			0,
+			__rrr_test_mqtt_session_store_replay_callback,
+			&replay_data
+	) != 0) {
+		TEST_MSG("- Failed to create store\n");
+		ret = 1;
+		goto out;
+	}
+
+	ret |= __rrr_test_mqtt_session_store_write(&offset, store);
+
+	rrr_mqtt_session_store_close(store);
+	store = NULL;
+
+	if (ret != 0 || replay_data.count != 0 || __rrr_test_mqtt_session_store_reopen(&replay_data) != 0 || replay_data.count != 2) {
+		TEST_MSG("= FAIL (%i records replayed)\n", replay_data.count);
+		ret = 1;
+		goto out;
+	}
+
+	TEST_MSG("= SUCCESS\n");
+
+	TEST_MSG("\n=== DISCARD TRUNCATED RECORD\n");
+
+	if ( __rrr_test_mqtt_session_store_append_garbage() != 0 ||
+	     __rrr_test_mqtt_session_store_reopen(&replay_data) != 0 ||
+	     replay_data.count != 2
+	) {
+		TEST_MSG("= FAIL (%i records replayed)\n", replay_data.count);
+		ret = 1;
+		goto out;
+	}
+
+	TEST_MSG("= SUCCESS\n");
+
+	TEST_MSG("\n=== REWRITE\n");
+
+	if (rrr_mqtt_session_store_open (
+			&store,
+			RRR_TEST_MQTT_SESSION_STORE_FILE,
+			0,
+			__rrr_test_mqtt_session_store_replay_callback,
+			&replay_data
+	) != 0) {
+		TEST_MSG("- Failed to open store\n");
+		ret = 1;
+		goto out;
+	}
+
+	// A rewrite which is not committed must leave the log untouched
+	if ( rrr_mqtt_session_store_rewrite_begin(store) != 0 ||
+	     rrr_mqtt_session_store_rewrite_end(store, 0) != 0 ||
+	     rrr_mqtt_session_store_rewrite_begin(store) != 0 ||
+	     __rrr_test_mqtt_session_store_write(&offset, store) != 0 ||
+	     rrr_mqtt_session_store_rewrite_end(store, 1) != 0 ||
+	     rrr_mqtt_session_store_rewrite_complete(&is_complete, &tail_offset, &tail_offset_new, store, 1) != 0 ||
+	     !is_complete
+	) {
+		TEST_MSG("- Rewrite failed\n");
+		ret = 1;
+	}
+
+	rrr_mqtt_session_store_close(store);
+	store = NULL;
+
+	if (ret != 0 || __rrr_test_mqtt_session_store_reopen(&replay_data) != 0 || replay_data.count != 2) {
+		TEST_MSG("= FAIL (%i records replayed)\n", replay_data.count);
+		ret = 1;
+		goto out;
+	}
+
+	TEST_MSG("= SUCCESS\n");
+
+	TEST_MSG("\n=== APPEND WHILE REWRITE IS PENDING\n");
+
+	if (rrr_mqtt_session_store_open (
+			&store,
+			RRR_TEST_MQTT_SESSION_STORE_FILE,
+			0,
+			__rrr_test_mqtt_session_store_replay_callback,
+			&replay_data
+	) != 0) {
+		TEST_MSG("- Failed to open store\n");
+		ret = 1;
+		goto out;
+	}
+
+	// Records appended after the rewrite is ended go to the old log and
+	// must be copied to the new log at the reported offset
+	if ( rrr_mqtt_session_store_rewrite_begin(store) != 0 ||
+	     __rrr_test_mqtt_session_store_write(&offset, store) != 0 ||
+	     rrr_mqtt_session_store_rewrite_end(store, 1) != 0 ||
+	     !rrr_mqtt_session_store_rewrite_is_pending(store) ||
+	     __rrr_test_mqtt_session_store_write(&offset, store) != 0 ||
+	     rrr_mqtt_session_store_rewrite_complete(&is_complete, &tail_offset, &tail_offset_new, store, 1) != 0 ||
+	     !is_complete ||
+	     rrr_mqtt_session_store_rewrite_is_pending(store)
+	) {
+		TEST_MSG("- Rewrite failed\n");
+		ret = 1;
+	}
+
+	rrr_mqtt_session_store_close(store);
+	store = NULL;
+
+	// The replay data holds the offset of the last retain record
+	if ( ret != 0 ||
+	     __rrr_test_mqtt_session_store_reopen(&replay_data) != 0 ||
+	     replay_data.count != 4 ||
+	     replay_data.retain_offset != offset - tail_offset + tail_offset_new
+	) {
+		TEST_MSG("= FAIL (%i records replayed)\n", replay_data.count);
+		ret = 1;
+		goto out;
+	}
+
+	TEST_MSG("= SUCCESS\n");
+
+	TEST_MSG("\n=== READ BY OFFSET\n");
+
+	if (rrr_mqtt_session_store_open (
+			&store,
+			RRR_TEST_MQTT_SESSION_STORE_FILE,
+			0,
+			__rrr_test_mqtt_session_store_replay_callback,
+			&replay_data
+	) != 0) {
+		TEST_MSG("- Failed to open store\n");
+		ret = 1;
+		goto out;
+	}
+
+	// The replay data now only counts the record read
+	replay_data.count = 0;
+
+	if ( replay_data.retain_offset == 0 ||
+	     rrr_mqtt_session_store_read(store, replay_data.retain_offset, __rrr_test_mqtt_session_store_replay_callback, &replay_data) != 0 ||
+	     replay_data.count != 1 ||
+	     replay_data.fail
+	) {
+		TEST_MSG("= FAIL (%i records read)\n", replay_data.count);
+		ret = 1;
+	}
+
+	rrr_mqtt_session_store_close(store);
+	store = NULL;
+
+	if (ret != 0) {
+		goto out;
+	}
+
+	TEST_MSG("= SUCCESS\n");
+
+	out:
+	unlink(RRR_TEST_MQTT_SESSION_STORE_FILE);
+	return (ret != 0);
+}
@@ -25,6 +25,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../lib/log.h"
 #include "../lib/allocator.h"
 #include "../lib/mqtt/mqtt_topic.h"
+#include "../lib/mqtt/mqtt_packet.h"
+#include "../lib/mqtt/mqtt_subscription.h"
+#include "../lib/mqtt/mqtt_subscription_index.h"
 
 #include "test.h"
 #include "test_mqtt_topic.h"
@@ -200,6 +203,255 @@ static int __rrr_test_mqtt_topic_verify_match (int ret, int expected_result) {
 	return 0;
 }
 
+static int __rrr_test_mqtt_topic_index_match_callback (
+		const struct rrr_mqtt_p_publish *publish,
+		const struct rrr_mqtt_subscription *subscription,
+		void *owner,
+		void *arg
+) {
+	(void)(publish);
+	(void)(subscription);
+
+	int *owner_matches = arg;
+
+	owner_matches[*((int *) owner)]++;
+
+	return 0;
+}
+
+static int __rrr_test_mqtt_topic_index_publish (
+		int *owner_matches,
+		rrr_length *match_count,
+		const struct rrr_mqtt_subscription_index *index,
+		const char *topic
+) {
+	int ret = 0;
+
+	struct rrr_mqtt_p_publish *publish = NULL;
+
+	if (rrr_mqtt_p_new_publish (
+			&publish,
+			topic,
+			NULL,
+			0,
+			rrr_mqtt_p_get_protocol_version(RRR_MQTT_VERSION_5)
+	) != 0) {
+		TEST_MSG("- Failed to create PUBLISH\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (rrr_mqtt_subscription_index_match_publish_with_callback (
+			index,
+			publish,
+			__rrr_test_mqtt_topic_index_match_callback,
+			owner_matches,
+			match_count
+	) != 0) {
+		TEST_MSG("- Index matching failed\n");
+		ret = 1;
+		goto out;
+	}
+
+	out:
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish);
+	return ret;
+}
+
+// Returns result compatible with the topic matching functions
+static int __rrr_test_mqtt_topic_index_match (
+		const char *filter,
+		const char *topic
+) {
+	int ret = RRR_MQTT_TOKEN_INTERNAL_ERROR;
+
+	struct rrr_mqtt_subscription_index *index = NULL;
+	struct rrr_mqtt_subscription_collection *subscriptions = NULL;
+	int owner = 0;
+	int owner_matches[1] = {0};
+	rrr_length match_count = 0;
+
+	if (rrr_mqtt_subscription_index_new(&index) != 0) {
+		goto out;
+	}
+
+	if (rrr_mqtt_subscription_collection_new(&subscriptions) != 0) {
+		goto out;
+	}
+
+	if (rrr_mqtt_subscription_collection_push_unique_str(subscriptions, filter, 0, 0, 0, 1) != 0) {
+		goto out;
+	}
+
+	if (rrr_mqtt_subscription_index_owner_update(index, &owner, subscriptions) != 0) {
+		goto out;
+	}
+
+	if (__rrr_test_mqtt_topic_index_publish(owner_matches, &match_count, index, topic) != 0) {
+		goto out;
+	}
+
+	if (match_count > 1 || owner_matches[0] != (int) match_count) {
+		TEST_MSG("- Unexpected match count %" PRIrrrl "\n", match_count);
+		goto out;
+	}
+
+	ret = match_count == 1 ? RRR_MQTT_TOKEN_MATCH : RRR_MQTT_TOKEN_MISMATCH;
+
+	out:
+	if (subscriptions != NULL) {
+		rrr_mqtt_subscription_index_owner_remove(index, &owner);
+		rrr_mqtt_subscription_collection_destroy(subscriptions);
+	}
+	if (index != NULL) {
+		if (rrr_mqtt_subscription_index_count(index) != 0) {
+			TEST_MSG("- Index not empty after owner removal\n");
+			ret = RRR_MQTT_TOKEN_INTERNAL_ERROR;
+		}
+		rrr_mqtt_subscription_index_destroy(index);
+	}
+	return ret;
+}
+
+// Returns result compatible with the topic matching functions
+static int __rrr_test_mqtt_topic_view_match (
+		const char *filter,
+		const char *topic
+) {
+	int ret = RRR_MQTT_TOKEN_INTERNAL_ERROR;
+
+	struct rrr_mqtt_topic_token *filter_token = NULL;
+	struct rrr_mqtt_topic_view *view = NULL;
+
+	if (rrr_mqtt_topic_tokenize(&filter_token, filter) != 0) {
+		goto out;
+	}
+
+	if (rrr_mqtt_topic_view_new_with_end(&view, topic, topic + strlen(topic)) != 0) {
+		goto out;
+	}
+
+	if (!rrr_mqtt_topic_view_describes_with_end(view, topic, topic + strlen(topic))) {
+		TEST_MSG("- View does not describe its own topic\n");
+		goto out;
+	}
+
+	ret = rrr_mqtt_topic_match_tokens_and_view(filter_token, view);
+
+	out:
+	RRR_FREE_IF_NOT_NULL(view);
+	rrr_mqtt_topic_token_destroy(filter_token);
+	return ret;
+}
+
+#define TEST_INDEX_OWNERS 3
+
+static int __rrr_test_mqtt_topic_index_owners (void) {
+	int ret = 0;
+
+	static const char *filters[TEST_INDEX_OWNERS][3] = {
+		{"a/b",   "a/+",   "#"},
+		{"a/#",   "+/b",   NULL},
+		{"c/d",   NULL,    NULL}
+	};
+
+	struct rrr_mqtt_subscription_index *index = NULL;
+	struct rrr_mqtt_subscription_collection *subscriptions[TEST_INDEX_OWNERS] = {0};
+	int owners[TEST_INDEX_OWNERS];
+	int owner_matches[TEST_INDEX_OWNERS];
+	rrr_length match_count = 0;
+
+	if (rrr_mqtt_subscription_index_new(&index) != 0) {
+		ret = 1;
+		goto out;
+	}
+
+	for (int i = 0; i < TEST_INDEX_OWNERS; i++) {
+		owners[i] = i;
+		if (rrr_mqtt_subscription_collection_new(&subscriptions[i]) != 0) {
+			ret = 1;
+			goto out;
+		}
+		for (int j = 0; j < 3 && filters[i][j] != NULL; j++) {
+			if (rrr_mqtt_subscription_collection_push_unique_str(subscriptions[i], filters[i][j], 0, 0, 0, 1) != 0) {
+				ret = 1;
+				goto out;
+			}
+		}
+		if (rrr_mqtt_subscription_index_owner_update(index, &owners[i], subscriptions[i]) != 0) {
+			ret = 1;
+			goto out;
+		}
+	}
+
+	if (rrr_mqtt_subscription_index_count(index) != 6) {
+		TEST_MSG("- Unexpected index count %" PRIrrrl " after adding owners\n", rrr_mqtt_subscription_index_count(index));
+		ret = 1;
+		goto out;
+	}
+
+	memset(owner_matches, '\0', sizeof(owner_matches));
+	if ((ret = __rrr_test_mqtt_topic_index_publish(owner_matches, &match_count, index, "a/b")) != 0) {
+		goto out;
+	}
+	if (match_count != 5 || owner_matches[0] != 3 || owner_matches[1] != 2 || owner_matches[2] != 0) {
+		TEST_MSG("- Unexpected matches for a/b: %" PRIrrrl " %i %i %i\n",
+				match_count, owner_matches[0], owner_matches[1], owner_matches[2]);
+		ret = 1;
+		goto out;
+	}
+
+	// Replace subscriptions of the first owner, old entries must disappear
+	rrr_mqtt_subscription_collection_clear(subscriptions[0]);
+	if ( rrr_mqtt_subscription_collection_push_unique_str(subscriptions[0], "c/+", 0, 0, 0, 1) != 0 ||
+	     rrr_mqtt_subscription_index_owner_update(index, &owners[0], subscriptions[0]) != 0
+	) {
+		ret = 1;
+		goto out;
+	}
+
+	memset(owner_matches, '\0', sizeof(owner_matches));
+	if ((ret = __rrr_test_mqtt_topic_index_publish(owner_matches, &match_count, index, "c/d")) != 0) {
+		goto out;
+	}
+	if (match_count != 2 || owner_matches[0] != 1 || owner_matches[1] != 0 || owner_matches[2] != 1) {
+		TEST_MSG("- Unexpected matches for c/d: %" PRIrrrl " %i %i %i\n",
+				match_count, owner_matches[0], owner_matches[1], owner_matches[2]);
+		ret = 1;
+		goto out;
+	}
+
+	rrr_mqtt_subscription_index_owner_remove(index, &owners[2]);
+
+	memset(owner_matches, '\0', sizeof(owner_matches));
+	if ((ret = __rrr_test_mqtt_topic_index_publish(owner_matches, &match_count, index, "c/d")) != 0) {
+		goto out;
+	}
+	if (match_count != 1 || owner_matches[0] != 1 || owner_matches[2] != 0) {
+		TEST_MSG("- Unexpected matches for c/d after removal: %" PRIrrrl "\n", match_count);
+		ret = 1;
+		goto out;
+	}
+
+	if (rrr_mqtt_subscription_index_count(index) != 3) {
+		TEST_MSG("- Unexpected index count %" PRIrrrl " after removal\n", rrr_mqtt_subscription_index_count(index));
+		ret = 1;
+		goto out;
+	}
+
+	out:
+	for (int i = 0; i < TEST_INDEX_OWNERS; i++) {
+		if (subscriptions[i] != NULL) {
+			rrr_mqtt_subscription_index_owner_remove(index, &owners[i]);
+			rrr_mqtt_subscription_collection_destroy(subscriptions[i]);
+		}
+	}
+	if (index != NULL) {
+		rrr_mqtt_subscription_index_destroy(index);
+	}
+	return ret;
+}
+
 int rrr_test_mqtt_topic(void) {
 	int ret = 0;
 	int ret_tmp;
@@ -256,6 +508,16 @@ int rrr_test_mqtt_topic(void) {
 			ret_tmp = 1;
 		};
 
+		if (__rrr_test_mqtt_topic_verify_match (__rrr_test_mqtt_topic_view_match(test_case->filter, test_case->topic), test_case->result) != 0) {
+			TEST_MSG("- Topic view verification failed\n");
+			ret_tmp = 1;
+		}
+
+		if (__rrr_test_mqtt_topic_verify_match (__rrr_test_mqtt_topic_index_match(test_case->filter, test_case->topic), test_case->result) != 0) {
+			TEST_MSG("- Subscription index verification failed\n");
+			ret_tmp = 1;
+		}
+
 		if (ret_tmp)
 			goto fail;
 
@@ -267,5 +529,14 @@ int rrr_test_mqtt_topic(void) {
 			ret = 1;
 	}
 
+	TEST_MSG("\n=== SUBSCRIPTION INDEX WITH MULTIPLE OWNERS\n");
+	if (__rrr_test_mqtt_topic_index_owners() != 0) {
+		TEST_MSG("= FAIL\n");
+		ret = 1;
+	}
+	else {
+		TEST_MSG("= SUCCESS\n");
+	}
+
 	return (ret != 0);
 }
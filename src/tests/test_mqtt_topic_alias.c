@@ -0,0 +1,167 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+
+#include "../lib/log.h"
+#include "../lib/allocator.h"
+#include "../lib/mqtt/mqtt_topic_alias.h"
+
+#include "test.h"
+#include "test_mqtt_topic_alias.h"
+
+#define TOPIC_A "sensors/building-a/temperature"
+#define TOPIC_B "sensors/building-b/temperature"
+#define TOPIC_C "sensors/building-c/temperature"
+#define TOPIC_D "sensors/building-d/temperature"
+#define TOPIC_SHORT "a/b"
+
+static int __rrr_test_mqtt_topic_alias_out_check (
+		struct rrr_mqtt_topic_alias_out *table,
+		const char *topic,
+		uint16_t alias_expected,
+		int is_new_expected
+) {
+	uint16_t alias;
+	int is_new;
+
+	if (rrr_mqtt_topic_alias_out_get(&alias, &is_new, table, topic) != 0) {
+		TEST_MSG("- Failed to get alias for topic %s\n", topic);
+		return 1;
+	}
+
+	if (alias != alias_expected || is_new != is_new_expected) {
+		TEST_MSG("- Topic %s got alias %u new %i, expected alias %u new %i\n",
+				topic, alias, is_new, alias_expected, is_new_expected);
+		return 1;
+	}
+
+	return 0;
+}
+
+static int __rrr_test_mqtt_topic_alias_out (void) {
+	int ret = 0;
+
+	struct rrr_mqtt_topic_alias_out table = {0};
+
+	// Aliasing disabled
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_A, 0, 0);
+
+	rrr_mqtt_topic_alias_out_maximum_set(&table, 2);
+
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_SHORT, 0, 0);
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_A, 1, 1);
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_B, 2, 1);
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_A, 1, 0);
+
+	// B is now least recently used and its alias is re-assigned
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_C, 2, 1);
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_A, 1, 0);
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_B, 2, 1);
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_C, 1, 1);
+
+	rrr_mqtt_topic_alias_out_maximum_set(&table, 3);
+
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_A, 1, 1);
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_B, 2, 1);
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_C, 3, 1);
+
+	// Drop B like a failed store does, D must not get alias 3 which C has
+	RRR_LL_ITERATE_BEGIN(&table, struct rrr_mqtt_topic_alias_out_entry);
+		if (strcmp(node->topic, TOPIC_B) == 0) {
+			table.alias_free = node->alias;
+			rrr_hash_remove_str(&table.topics, node->topic);
+			RRR_LL_ITERATE_SET_DESTROY();
+		}
+	RRR_LL_ITERATE_END_CHECK_DESTROY(&table, 0; rrr_free(node->topic); rrr_free(node));
+
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_D, 2, 1);
+	ret |= __rrr_test_mqtt_topic_alias_out_check(&table, TOPIC_C, 3, 0);
+
+	rrr_mqtt_topic_alias_out_clear(&table);
+
+	return ret;
+}
+
+static int __rrr_test_mqtt_topic_alias_bytes_saved (void) {
+	int ret = 0;
+
+	// Remotes may assign aliases to topics shorter than the property
+	if ( RRR_MQTT_TOPIC_ALIAS_BYTES_SAVED(strlen(TOPIC_SHORT)) != 0 ||
+	     RRR_MQTT_TOPIC_ALIAS_BYTES_SAVED(strlen(TOPIC_A)) != strlen(TOPIC_A) - RRR_MQTT_TOPIC_ALIAS_PROPERTY_SIZE
+	) {
+		TEST_MSG("- Unexpected number of bytes saved\n");
+		ret = 1;
+	}
+
+	return ret;
+}
+
+static int __rrr_test_mqtt_topic_alias_in (void) {
+	int ret = 0;
+
+	struct rrr_mqtt_topic_alias_in table = {0};
+
+	rrr_mqtt_topic_alias_in_maximum_set(&table, 2);
+
+	if (rrr_mqtt_topic_alias_in_get(&table, 1) != NULL) {
+		TEST_MSG("- Alias 1 was defined before being set\n");
+		ret = 1;
+	}
+
+	if ( rrr_mqtt_topic_alias_in_set(&table, 1, TOPIC_A) != 0 ||
+	     rrr_mqtt_topic_alias_in_set(&table, 2, TOPIC_B) != 0 ||
+	     rrr_mqtt_topic_alias_in_set(&table, 1, TOPIC_C) != 0
+	) {
+		TEST_MSG("- Failed to set alias\n");
+		ret = 1;
+		goto out;
+	}
+
+	const char *topic_1 = rrr_mqtt_topic_alias_in_get(&table, 1);
+	const char *topic_2 = rrr_mqtt_topic_alias_in_get(&table, 2);
+
+	if ( topic_1 == NULL || strcmp(topic_1, TOPIC_C) != 0 ||
+	     topic_2 == NULL || strcmp(topic_2, TOPIC_B) != 0
+	) {
+		TEST_MSG("- Aliases did not resolve to the expected topics\n");
+		ret = 1;
+	}
+
+	if (rrr_mqtt_topic_alias_in_get(&table, 0) != NULL || rrr_mqtt_topic_alias_in_get(&table, 3) != NULL) {
+		TEST_MSG("- Aliases out of range resolved to a topic\n");
+		ret = 1;
+	}
+
+	out:
+	rrr_mqtt_topic_alias_in_clear(&table);
+	return ret;
+}
+
+int rrr_test_mqtt_topic_alias (void) {
+	int ret = 0;
+
+	ret |= __rrr_test_mqtt_topic_alias_out();
+	ret |= __rrr_test_mqtt_topic_alias_in();
+	ret |= __rrr_test_mqtt_topic_alias_bytes_saved();
+
+	return ret;
+}
@@ -312,6 +312,7 @@ int rrr_test_quic (const volatile int *main_running, struct rrr_event_queue *que
 		NULL,
 		RRR_NET_TRANSPORT_QUIC,
 		RRR_NET_TRANSPORT_F_QUIC,
+		0,
 		0
 	};
 
@@ -322,6 +323,7 @@ int rrr_test_quic (const volatile int *main_running, struct rrr_event_queue *que
 		"../../misc/ssl/rootca",
 		RRR_NET_TRANSPORT_QUIC,
 		RRR_NET_TRANSPORT_F_QUIC,
+		0,
 		0
 	};
 
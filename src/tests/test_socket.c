@@ -0,0 +1,285 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "../lib/log.h"
+#include "../lib/allocator.h"
+#include "../lib/socket/rrr_socket.h"
+#include "../lib/socket/rrr_socket_send_chunk.h"
+
+#include "test.h"
+#include "test_socket.h"
+
+#define RRR_TEST_SOCKET_THREADS 8
+#define RRR_TEST_SOCKET_ITERATIONS 2000
+#define RRR_TEST_SOCKET_TEMPLATE "/tmp/rrr-test-socket-XXXXXX"
+#define RRR_TEST_SOCKET_CHUNKS 200
+#define RRR_TEST_SOCKET_CHUNK_LARGE_SIZE (1024 * 1024)
+
+struct rrr_test_socket_thread_data {
+	pthread_t thread;
+	int ret;
+};
+
+static void *__rrr_test_socket_thread (void *arg) {
+	struct rrr_test_socket_thread_data *data = arg;
+
+	struct rrr_socket_options options;
+	int fds[2];
+
+	for (int i = 0; i < RRR_TEST_SOCKET_ITERATIONS; i++) {
+		if (rrr_socket_pipe(fds, "rrr_test_socket") != 0) {
+			TEST_MSG("- Failed to create pipe\n");
+			data->ret = 1;
+			break;
+		}
+
+		// Another thread may only receive the same fd numbers after
+		// they have been closed here
+		if (rrr_socket_get_options_from_fd(&options, fds[0]) != 0 || options.fd != fds[0]) {
+			TEST_MSG("- fd %i was not registered after creation\n", fds[0]);
+			data->ret = 1;
+		}
+		else if (!options.sendv_possible) {
+			TEST_MSG("- Vectored writes not possible for pipe fd %i\n", fds[0]);
+			data->ret = 1;
+		}
+
+		rrr_socket_close(fds[0]);
+		rrr_socket_close(fds[1]);
+
+		if (data->ret != 0) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static int __rrr_test_socket_threads (void) {
+	int ret = 0;
+
+	struct rrr_test_socket_thread_data threads[RRR_TEST_SOCKET_THREADS] = {0};
+	int started = 0;
+
+	for (; started < RRR_TEST_SOCKET_THREADS; started++) {
+		if (pthread_create(&threads[started].thread, NULL, __rrr_test_socket_thread, &threads[started]) != 0) {
+			TEST_MSG("- Failed to start thread\n");
+			ret = 1;
+			break;
+		}
+	}
+
+	for (int i = 0; i < started; i++) {
+		pthread_join(threads[i].thread, NULL);
+		ret |= threads[i].ret;
+	}
+
+	return ret;
+}
+
+static int __rrr_test_socket_filename (void) {
+	int ret = 0;
+
+	char filename[] = RRR_TEST_SOCKET_TEMPLATE;
+	char *filename_result = NULL;
+	int fd;
+
+	if ((fd = rrr_socket_mkstemp(filename, "rrr_test_socket")) < 0) {
+		TEST_MSG("- Failed to create temporary file\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (rrr_socket_get_fd_from_filename(filename) != fd) {
+		TEST_MSG("- Lookup of fd from filename %s failed\n", filename);
+		ret = 1;
+	}
+
+	if (rrr_socket_get_filename_from_fd(&filename_result, fd) != 0 ||
+	    filename_result == NULL ||
+	    strcmp(filename_result, filename) != 0
+	) {
+		TEST_MSG("- Lookup of filename from fd %i failed\n", fd);
+		ret = 1;
+	}
+
+	rrr_socket_close(fd);
+
+	if (access(filename, F_OK) == 0) {
+		TEST_MSG("- File %s was not unlinked upon close\n", filename);
+		unlink(filename);
+		ret = 1;
+	}
+
+	if (rrr_socket_get_fd_from_filename(filename) >= 0) {
+		TEST_MSG("- File %s was still registered after close\n", filename);
+		ret = 1;
+	}
+
+	out:
+	RRR_FREE_IF_NOT_NULL(filename_result);
+	return ret;
+}
+
+static int __rrr_test_socket_send_chunk_read (
+		char *target,
+		size_t target_size,
+		size_t *target_pos,
+		int fd
+) {
+	ssize_t bytes = 0;
+
+	while (*target_pos < target_size && (bytes = read(fd, target + *target_pos, target_size - *target_pos)) > 0) {
+		*target_pos += (size_t) bytes;
+	}
+
+	return *target_pos < target_size && (bytes == 0 || (bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK));
+}
+
+static int __rrr_test_socket_send_chunk (void) {
+	int ret = 0;
+
+	struct rrr_socket_send_chunk_collection chunks = {0};
+	char *large = NULL;
+	char *result = NULL;
+	int fds[2] = {-1, -1};
+	rrr_length send_chunk_count = 0;
+	char expected[RRR_TEST_SOCKET_CHUNKS * 2];
+	size_t result_pos = 0;
+	// High and normal priority chunks of two bytes each followed by the large chunk
+	const size_t small_size = RRR_TEST_SOCKET_CHUNKS * 2 * 2;
+	const size_t result_size = small_size + RRR_TEST_SOCKET_CHUNK_LARGE_SIZE;
+
+	if ((large = rrr_allocate(RRR_TEST_SOCKET_CHUNK_LARGE_SIZE)) == NULL ||
+	    (result = rrr_allocate(result_size)) == NULL
+	) {
+		TEST_MSG("- Failed to allocate memory\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (rrr_socket_pipe(fds, "rrr_test_socket") != 0) {
+		TEST_MSG("- Failed to create pipe\n");
+		ret = 1;
+		goto out;
+	}
+
+	memset(large, 'x', RRR_TEST_SOCKET_CHUNK_LARGE_SIZE);
+
+	// Normal priority chunks are pushed first but high priority chunks are to be written first
+	for (int i = 0; i < RRR_TEST_SOCKET_CHUNKS; i++) {
+		const char normal[2] = { 'n', (char) i };
+		const char high[2] = { 'h', (char) i };
+
+		ret |= rrr_socket_send_chunk_collection_push_const(&send_chunk_count, &chunks, normal, sizeof(normal), RRR_SOCKET_SEND_CHUNK_PRIORITY_NORMAL);
+		ret |= rrr_socket_send_chunk_collection_push_const(&send_chunk_count, &chunks, high, sizeof(high), RRR_SOCKET_SEND_CHUNK_PRIORITY_HIGH);
+
+		memcpy(expected + i * 2, high, sizeof(high));
+	}
+
+	ret |= rrr_socket_send_chunk_collection_push_const(&send_chunk_count, &chunks, large, RRR_TEST_SOCKET_CHUNK_LARGE_SIZE, RRR_SOCKET_SEND_CHUNK_PRIORITY_NORMAL);
+
+	if (ret != 0) {
+		TEST_MSG("- Failed to push chunks\n");
+		goto out;
+	}
+
+	// The large chunk does not fit in the pipe buffer and is written in multiple rounds
+	int ret_tmp;
+	int rounds = 0;
+	while ((ret_tmp = rrr_socket_send_chunk_collection_send(&chunks, fds[1])) == RRR_SOCKET_WRITE_INCOMPLETE) {
+		if (__rrr_test_socket_send_chunk_read(result, result_size, &result_pos, fds[0]) != 0) {
+			TEST_MSG("- Read from pipe failed\n");
+			ret = 1;
+			goto out;
+		}
+		if (++rounds > 10000) {
+			TEST_MSG("- Too many rounds while sending chunks\n");
+			ret = 1;
+			goto out;
+		}
+	}
+
+	if (ret_tmp != 0 || rrr_socket_send_chunk_collection_count(&chunks) != 0) {
+		TEST_MSG("- Sending chunks failed, return was %i\n", ret_tmp);
+		ret = 1;
+		goto out;
+	}
+
+	if (__rrr_test_socket_send_chunk_read(result, result_size, &result_pos, fds[0]) != 0) {
+		TEST_MSG("- Read from pipe failed\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (result_pos != result_size) {
+		TEST_MSG("- Size mismatch after sending chunks %llu<>%llu\n",
+			(unsigned long long) result_pos, (unsigned long long) result_size);
+		ret = 1;
+		goto out;
+	}
+
+	if (memcmp(result, expected, sizeof(expected)) != 0) {
+		TEST_MSG("- High priority chunks were not written first and in order\n");
+		ret = 1;
+	}
+
+	for (int i = 0; i < RRR_TEST_SOCKET_CHUNKS; i++) {
+		const char *pos = result + RRR_TEST_SOCKET_CHUNKS * 2 + i * 2;
+		if (pos[0] != 'n' || pos[1] != (char) i) {
+			TEST_MSG("- Normal priority chunk %i was out of order\n", i);
+			ret = 1;
+			break;
+		}
+	}
+
+	if (memcmp(result + small_size, large, RRR_TEST_SOCKET_CHUNK_LARGE_SIZE) != 0) {
+		TEST_MSG("- Large chunk was corrupted\n");
+		ret = 1;
+	}
+
+	out:
+	rrr_socket_send_chunk_collection_clear(&chunks);
+	if (fds[0] >= 0) {
+		rrr_socket_close(fds[0]);
+		rrr_socket_close(fds[1]);
+	}
+	RRR_FREE_IF_NOT_NULL(large);
+	RRR_FREE_IF_NOT_NULL(result);
+	return ret;
+}
+
+int rrr_test_socket(void) {
+	int ret = 0;
+
+	ret |= __rrr_test_socket_threads();
+	ret |= __rrr_test_socket_filename();
+	ret |= __rrr_test_socket_send_chunk();
+
+	return ret;
+}
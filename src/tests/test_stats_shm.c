@@ -0,0 +1,198 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "../lib/log.h"
+#include "../lib/stats/stats_shm.h"
+
+#include "test.h"
+#include "test_stats_shm.h"
+
+#define RRR_TEST_STATS_SHM_FILE "/tmp/rrr_test_stats_shm"
+
+static int __rrr_test_stats_shm_obtain_release (
+		struct rrr_stats_shm *shm
+) {
+	int ret = 0;
+
+	uint32_t slot_a, slot_b, slot_a_again, slot_c;
+
+	if ( rrr_stats_shm_slot_obtain(&slot_a, shm, "a") != 0 ||
+	     rrr_stats_shm_slot_obtain(&slot_b, shm, "b") != 0 ||
+	     rrr_stats_shm_slot_obtain(&slot_a_again, shm, "a") != 0
+	) {
+		TEST_MSG("- Failed to obtain slots\n");
+		ret = 1;
+		goto out;
+	}
+
+	if (slot_a == slot_b || slot_a != slot_a_again) {
+		TEST_MSG("- Unexpected slots %" PRIu32 " %" PRIu32 " %" PRIu32 "\n", slot_a, slot_b, slot_a_again);
+		ret = 1;
+		goto out;
+	}
+
+	rrr_stats_shm_slot_release(shm, slot_a);
+
+	if (shm->page->slots[slot_a].in_use || shm->page->slots[slot_a].name[0] != '\0') {
+		TEST_MSG("- Slot was not cleared on release\n");
+		ret = 1;
+		goto out;
+	}
+
+	// The first free slot is reused
+	if (rrr_stats_shm_slot_obtain(&slot_c, shm, "c") != 0 || slot_c != slot_a) {
+		TEST_MSG("- Released slot was not reused\n");
+		ret = 1;
+		goto out;
+	}
+
+	// Fill all slots, one more must fail
+	for (uint32_t i = 0; i < RRR_STATS_SHM_SLOTS; i++) {
+		char name[32];
+		uint32_t slot;
+		sprintf(name, "fill-%" PRIu32, i);
+		if (rrr_stats_shm_slot_obtain(&slot, shm, name) != 0) {
+			if (i != RRR_STATS_SHM_SLOTS - 2) {
+				TEST_MSG("- Obtain failed after %" PRIu32 " slots\n", i);
+				ret = 1;
+			}
+			goto out;
+		}
+	}
+
+	TEST_MSG("- Obtain did not fail with all slots used\n");
+	ret = 1;
+
+	out:
+	for (uint32_t i = 0; i < RRR_STATS_SHM_SLOTS; i++) {
+		if (shm->page->slots[i].in_use) {
+			rrr_stats_shm_slot_release(shm, i);
+		}
+	}
+	return ret;
+}
+
+static int __rrr_test_stats_shm_read (
+		struct rrr_stats_shm *shm
+) {
+	int ret = 0;
+
+	struct rrr_stats_shm *reader = NULL;
+	struct rrr_stats_shm_slot target;
+	uint32_t slot;
+
+	if (rrr_stats_shm_slot_obtain(&slot, shm, "instance") != 0) {
+		TEST_MSG("- Failed to obtain slot\n");
+		ret = 1;
+		goto out;
+	}
+
+	rrr_stats_shm_value_set(shm, slot, RRR_STATS_SHM_VALUE_BUFFER_COUNT, 123);
+	rrr_stats_shm_value_set(shm, slot, RRR_STATS_SHM_VALUE_BUFFER_WRITTEN_TOTAL, 456);
+	rrr_stats_shm_rate_set(shm, slot, 1, "rate", 789);
+
+	if (rrr_stats_shm_open(&reader, RRR_TEST_STATS_SHM_FILE) != 0) {
+		TEST_MSG("- Failed to open file read-only\n");
+		ret = 1;
+		goto out_release;
+	}
+
+	if (rrr_stats_shm_slot_read(&target, reader, slot) != 0) {
+		TEST_MSG("- Read failed on idle slot\n");
+		ret = 1;
+		goto out_release;
+	}
+
+	if ( !target.in_use ||
+	     strcmp(target.name, "instance") != 0 ||
+	     target.values[RRR_STATS_SHM_VALUE_BUFFER_COUNT] != 123 ||
+	     target.values[RRR_STATS_SHM_VALUE_BUFFER_WRITTEN_TOTAL] != 456 ||
+	     strcmp(target.rates[1].name, "rate") != 0 ||
+	     target.rates[1].total != 789 ||
+	     (target.seq & 1) != 0
+	) {
+		TEST_MSG("- Values read back did not match\n");
+		ret = 1;
+		goto out_release;
+	}
+
+	// Simulate a writer which is in progress, the reader must give up
+	const uint32_t seq = shm->page->slots[slot].seq;
+	__atomic_store_n(&shm->page->slots[slot].seq, seq + 1, __ATOMIC_RELEASE);
+
+	if (rrr_stats_shm_slot_read(&target, reader, slot) != 1) {
+		TEST_MSG("- Read did not report busy slot with odd sequence\n");
+		ret = 1;
+	}
+
+	__atomic_store_n(&shm->page->slots[slot].seq, seq + 2, __ATOMIC_RELEASE);
+
+	if (rrr_stats_shm_slot_read(&target, reader, slot) != 0 || target.values[RRR_STATS_SHM_VALUE_BUFFER_COUNT] != 123) {
+		TEST_MSG("- Read failed after sequence became even\n");
+		ret = 1;
+	}
+
+	out_release:
+		rrr_stats_shm_slot_release(shm, slot);
+	out:
+		rrr_stats_shm_destroy(reader);
+		return ret;
+}
+
+int rrr_test_stats_shm (void) {
+	int ret = 0;
+
+	struct rrr_stats_shm *shm = NULL;
+
+	if (rrr_stats_shm_create(&shm, RRR_TEST_STATS_SHM_FILE) != 0) {
+		TEST_MSG("- Failed to create metrics file\n");
+		ret = 1;
+		goto out;
+	}
+
+	TEST_MSG("\n=== SLOT OBTAIN AND RELEASE\n");
+
+	if (__rrr_test_stats_shm_obtain_release(shm) != 0) {
+		TEST_MSG("= FAIL\n");
+		ret = 1;
+	}
+	else {
+		TEST_MSG("= SUCCESS\n");
+	}
+
+	TEST_MSG("\n=== WRITE AND READ\n");
+
+	if (__rrr_test_stats_shm_read(shm) != 0) {
+		TEST_MSG("= FAIL\n");
+		ret = 1;
+	}
+	else {
+		TEST_MSG("= SUCCESS\n");
+	}
+
+	out:
+	rrr_stats_shm_destroy(shm);
+	return ret;
+}
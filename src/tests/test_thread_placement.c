@@ -0,0 +1,177 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <string.h>
+
+#include "../lib/log.h"
+#include "../lib/thread_placement.h"
+
+#include "test.h"
+#include "test_thread_placement.h"
+
+#define RRR_TEST_THREAD_PLACEMENT_BITS 128
+
+// Lists which are parsed and formatted back. The sysfs files end
+// with a newline which is ignored.
+static const struct rrr_test_thread_placement_list_valid {
+	const char *str;
+	const char *formatted;
+} rrr_test_thread_placement_lists_valid[] = {
+	{"0",               "0"},
+	{"0-3,6,8-9",       "0-3,6,8-9"},
+	{"0-3,6,8-9\n",     "0-3,6,8-9"},
+	{"5\n",             "5"},
+	{"1,2,3",           "1-3"},
+	{"7-7",             "7"},
+	{"9,0-2",           "0-2,9"},
+	{"62-65",           "62-65"},
+	{"127",             "127"},
+	{"0-127",           "0-127"}
+};
+
+static const char *rrr_test_thread_placement_lists_invalid[] = {
+	"",
+	"\n",
+	"1,",
+	"1,\n",
+	",1",
+	"1,,2",
+	"1-",
+	"-1",
+	"3-1",
+	"a",
+	"1 2",
+	"1-2-3",
+	"128",
+	"0-128",
+	"99999999999999999999"
+};
+
+#define RRR_TEST_THREAD_PLACEMENT_ARRAY_SIZE(array) \
+	(sizeof(array) / sizeof(*array))
+
+static int __rrr_test_thread_placement_list_parse (void) {
+	int ret = 0;
+
+	uint64_t bits[RRR_TEST_THREAD_PLACEMENT_BITS / 64];
+	char buf[64];
+
+	for (size_t i = 0; i < RRR_TEST_THREAD_PLACEMENT_ARRAY_SIZE(rrr_test_thread_placement_lists_valid); i++) {
+		const struct rrr_test_thread_placement_list_valid *list = &rrr_test_thread_placement_lists_valid[i];
+
+		if (rrr_thread_placement_list_parse(bits, RRR_TEST_THREAD_PLACEMENT_BITS, list->str) != 0) {
+			TEST_MSG("- Parsing of valid list '%s' failed\n", list->str);
+			ret = 1;
+			continue;
+		}
+
+		rrr_thread_placement_list_format(buf, sizeof(buf), bits, RRR_TEST_THREAD_PLACEMENT_BITS);
+
+		if (strcmp(buf, list->formatted) != 0) {
+			TEST_MSG("- List '%s' was formatted as '%s', expected '%s'\n", list->str, buf, list->formatted);
+			ret = 1;
+		}
+	}
+
+	// Boundaries between the 64 bit words
+	if ( rrr_thread_placement_list_parse(bits, RRR_TEST_THREAD_PLACEMENT_BITS, "63-64") != 0 ||
+	     bits[0] != (uint64_t) 1 << 63 ||
+	     bits[1] != 1
+	) {
+		TEST_MSG("- Unexpected bits after parsing range across words\n");
+		ret = 1;
+	}
+
+	TEST_MSG("- The following errors are expected\n");
+
+	for (size_t i = 0; i < RRR_TEST_THREAD_PLACEMENT_ARRAY_SIZE(rrr_test_thread_placement_lists_invalid); i++) {
+		const char *str = rrr_test_thread_placement_lists_invalid[i];
+
+		if (rrr_thread_placement_list_parse(bits, RRR_TEST_THREAD_PLACEMENT_BITS, str) == 0) {
+			TEST_MSG("- Parsing of invalid list '%s' did not fail\n", str);
+			ret = 1;
+		}
+	}
+
+	return ret;
+}
+
+static int __rrr_test_thread_placement_list_format (void) {
+	int ret = 0;
+
+	uint64_t bits[RRR_TEST_THREAD_PLACEMENT_BITS / 64] = {0};
+	char buf[16];
+
+	rrr_thread_placement_list_format(buf, sizeof(buf), bits, RRR_TEST_THREAD_PLACEMENT_BITS);
+
+	if (buf[0] != '\0') {
+		TEST_MSG("- Empty bitmask was formatted as '%s'\n", buf);
+		ret = 1;
+	}
+
+	// Every other bit gives a list longer than the buffer, it must be
+	// cut after the last number which fits completely
+	for (size_t i = 0; i < RRR_TEST_THREAD_PLACEMENT_BITS; i += 2) {
+		bits[i / 64] |= (uint64_t) 1 << (i % 64);
+	}
+
+	rrr_thread_placement_list_format(buf, 9, bits, RRR_TEST_THREAD_PLACEMENT_BITS);
+
+	if (strcmp(buf, "0,2,4,6") != 0) {
+		TEST_MSG("- Truncated list was '%s', expected '0,2,4,6'\n", buf);
+		ret = 1;
+	}
+
+	rrr_thread_placement_list_format(buf, sizeof(buf), bits, RRR_TEST_THREAD_PLACEMENT_BITS);
+
+	if (strcmp(buf, "0,2,4,6,8,10,12") != 0) {
+		TEST_MSG("- Truncated list was '%s', expected '0,2,4,6,8,10,12'\n", buf);
+		ret = 1;
+	}
+
+	return ret;
+}
+
+int rrr_test_thread_placement (void) {
+	int ret = 0;
+
+	TEST_MSG("\n=== LIST PARSE\n");
+
+	if (__rrr_test_thread_placement_list_parse() != 0) {
+		TEST_MSG("= FAIL\n");
+		ret = 1;
+	}
+	else {
+		TEST_MSG("= SUCCESS\n");
+	}
+
+	TEST_MSG("\n=== LIST FORMAT\n");
+
+	if (__rrr_test_thread_placement_list_format() != 0) {
+		TEST_MSG("= FAIL\n");
+		ret = 1;
+	}
+	else {
+		TEST_MSG("= SUCCESS\n");
+	}
+
+	return ret;
+}
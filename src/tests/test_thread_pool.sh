@@ -0,0 +1,8 @@
+#!/usr/bin/env bash
+
+set -e
+
+source ./testlib.sh
+source ../../variables.sh
+
+do_test_simple test_thread_pool.conf
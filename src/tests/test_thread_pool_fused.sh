@@ -0,0 +1,25 @@
+#!/usr/bin/env bash
+
+set -e
+
+source ./testlib.sh
+source ../../variables.sh
+
+THREAD_POOL_FUSED_LOG=/tmp/rrr-test-thread-pool-fused.log.$SUFFIX
+trap "rm -f $THREAD_POOL_FUSED_LOG" EXIT
+
+# Debuglevel 1 makes the fused instances be logged
+print_test_header SIMPLE test_thread_pool_fused.conf
+echo \$ $TEST -d 1 test_thread_pool_fused.conf
+$TEST -d 1 test_thread_pool_fused.conf > $THREAD_POOL_FUSED_LOG 2>&1 || {
+	grep -v '^<1>' $THREAD_POOL_FUSED_LOG || true
+	fail test_thread_pool_fused.conf
+}
+grep -v '^<1>' $THREAD_POOL_FUSED_LOG || true
+
+FUSED=`grep -c 'is fused with its sender' $THREAD_POOL_FUSED_LOG || true`
+echo "$FUSED instances were fused with their sender"
+
+if test $FUSED -ne 2; then
+	fail "test_thread_pool_fused.conf fused instance count"
+fi
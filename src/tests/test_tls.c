@@ -125,7 +125,8 @@ int rrr_test_tls (const volatile int *main_running, struct rrr_event_queue *queu
 		NULL,
 		RRR_NET_TRANSPORT_TLS,
 		RRR_NET_TRANSPORT_F_TLS,
-		RRR_NET_TRANSPORT_TLS_NONE
+		RRR_NET_TRANSPORT_TLS_NONE,
+		0
 	};
 
 	static const struct rrr_net_transport_config config_client = {
@@ -135,7 +136,8 @@ int rrr_test_tls (const volatile int *main_running, struct rrr_event_queue *queu
 		"../../misc/ssl/rootca",
 		RRR_NET_TRANSPORT_TLS,
 		RRR_NET_TRANSPORT_F_TLS,
-		RRR_NET_TRANSPORT_TLS_NONE
+		RRR_NET_TRANSPORT_TLS_NONE,
+		0
 	};
 
 	if ((ret = rrr_test_tls_common_init (
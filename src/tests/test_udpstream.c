@@ -0,0 +1,305 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Transfers messages between two UDP-streams over loopback, both without
+// loss and with a percentage of packets dropped randomly by the sender, and
+// reports the goodput.
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "../lib/log.h"
+#include "../lib/allocator.h"
+#include "../lib/event/event.h"
+#include "../lib/udpstream/udpstream.h"
+#include "../lib/util/rrr_time.h"
+#include "../lib/util/macro_utils.h"
+
+#include "test.h"
+#include "test_udpstream.h"
+
+#define RRR_TEST_UDPSTREAM_PORT_SERVER   27301
+#define RRR_TEST_UDPSTREAM_PORT_CLIENT   27302
+#define RRR_TEST_UDPSTREAM_MESSAGE_COUNT 500
+#define RRR_TEST_UDPSTREAM_MESSAGE_SIZE  4000
+#define RRR_TEST_UDPSTREAM_LOSS_PERCENT  10
+#define RRR_TEST_UDPSTREAM_TIMEOUT_MS    30000
+
+struct rrr_test_udpstream_data {
+	struct rrr_udpstream server;
+	struct rrr_udpstream client;
+	uint32_t connect_handle;
+	int connected;
+	uint32_t queued_count;
+	uint32_t received_count;
+	uint64_t received_bytes;
+	uint64_t time_start;
+	uint64_t time_connected;
+	int fail;
+};
+
+static void __rrr_test_udpstream_message_fill (
+		char *buf,
+		uint32_t index
+) {
+	memcpy(buf, &index, sizeof(index));
+	for (size_t i = sizeof(index); i < RRR_TEST_UDPSTREAM_MESSAGE_SIZE; i++) {
+		buf[i] = (char) ((index + i) & 0xff);
+	}
+}
+
+static int __rrr_test_udpstream_control_frame_callback (uint32_t connect_handle, uint64_t application_data, void *arg) {
+	(void)(connect_handle);
+	(void)(application_data);
+	(void)(arg);
+	return 0;
+}
+
+static int __rrr_test_udpstream_allocator_callback (RRR_UDPSTREAM_ALLOCATOR_CALLBACK_ARGS) {
+	(void)(remote_addr);
+	(void)(remote_addr_len);
+	(void)(arg);
+
+	int ret = 0;
+
+	void *joined_data = NULL;
+
+	if ((joined_data = rrr_allocate(size)) == NULL) {
+		TEST_MSG("Could not allocate memory in %s\n", __func__);
+		ret = 1;
+		goto out;
+	}
+
+	ret = receive_callback(&joined_data, NULL, udpstream_callback_arg);
+
+	out:
+	RRR_FREE_IF_NOT_NULL(joined_data);
+	return ret;
+}
+
+static int __rrr_test_udpstream_receive_possible_callback (RRR_UDPSTREAM_FINAL_RECEIVE_CALLBACK_POSSIBLE_ARGS) {
+	(void)(arg);
+	return 1;
+}
+
+static int __rrr_test_udpstream_final_callback (RRR_UDPSTREAM_FINAL_RECEIVE_CALLBACK_ARGS) {
+	struct rrr_test_udpstream_data *data = arg;
+
+	char expected[RRR_TEST_UDPSTREAM_MESSAGE_SIZE];
+
+	__rrr_test_udpstream_message_fill(expected, data->received_count);
+
+	if ( receive_data->data_size != RRR_TEST_UDPSTREAM_MESSAGE_SIZE ||
+	     memcmp(*joined_data, expected, RRR_TEST_UDPSTREAM_MESSAGE_SIZE) != 0
+	) {
+		TEST_MSG("- Message %" PRIu32 " was corrupt or out of order\n", data->received_count);
+		data->fail = 1;
+	}
+
+	data->received_count++;
+	data->received_bytes += receive_data->data_size;
+
+	rrr_free(*joined_data);
+	*joined_data = NULL;
+
+	return 0;
+}
+
+static int __rrr_test_udpstream_periodic (RRR_EVENT_FUNCTION_PERIODIC_ARGS) {
+	struct rrr_test_udpstream_data *data = arg;
+
+	char buf[RRR_TEST_UDPSTREAM_MESSAGE_SIZE];
+
+	if (rrr_time_get_64() - data->time_start > RRR_TEST_UDPSTREAM_TIMEOUT_MS * 1000) {
+		TEST_MSG("- Timeout, %" PRIu32 " of %i messages received\n",
+				data->received_count, RRR_TEST_UDPSTREAM_MESSAGE_COUNT);
+		data->fail = 1;
+		return RRR_EVENT_EXIT;
+	}
+
+	if (data->fail || data->received_count == RRR_TEST_UDPSTREAM_MESSAGE_COUNT) {
+		return RRR_EVENT_EXIT;
+	}
+
+	if (!data->connected) {
+		if (rrr_udpstream_connection_check(&data->client, data->connect_handle) != 0) {
+			return RRR_EVENT_OK;
+		}
+		data->connected = 1;
+		data->time_connected = rrr_time_get_64();
+	}
+
+	while (data->queued_count < RRR_TEST_UDPSTREAM_MESSAGE_COUNT) {
+		__rrr_test_udpstream_message_fill(buf, data->queued_count);
+
+		int ret_tmp = rrr_udpstream_queue_outbound_data (
+				&data->client,
+				data->connect_handle,
+				buf,
+				sizeof(buf),
+				0
+		);
+
+		if (ret_tmp == RRR_UDPSTREAM_NOT_READY) {
+			break;
+		}
+		else if (ret_tmp != 0) {
+			TEST_MSG("- Failed to queue message\n");
+			data->fail = 1;
+			return RRR_EVENT_EXIT;
+		}
+
+		data->queued_count++;
+	}
+
+	return RRR_EVENT_OK;
+}
+
+static int __rrr_test_udpstream_init (
+		struct rrr_udpstream *udpstream,
+		struct rrr_event_queue *queue,
+		int flags,
+		uint16_t port,
+		struct rrr_test_udpstream_data *data
+) {
+	int ret = 0;
+
+	if ((ret = rrr_udpstream_init (
+			udpstream,
+			queue,
+			flags,
+			__rrr_test_udpstream_control_frame_callback,
+			data,
+			__rrr_test_udpstream_allocator_callback,
+			data,
+			NULL,
+			NULL,
+			__rrr_test_udpstream_receive_possible_callback,
+			data,
+			__rrr_test_udpstream_final_callback,
+			data
+	)) != 0) {
+		TEST_MSG("- Failed to initialize UDP-stream\n");
+		goto out;
+	}
+
+	if ((ret = rrr_udpstream_bind_v4_only(udpstream, port)) != 0) {
+		TEST_MSG("- Failed to bind UDP-stream to port %u\n", port);
+		rrr_udpstream_clear(udpstream);
+		goto out;
+	}
+
+	out:
+	return ret;
+}
+
+static int __rrr_test_udpstream_transfer (
+		unsigned int loss_percent
+) {
+	int ret = 0;
+
+	struct rrr_event_queue *queue = NULL;
+	struct rrr_test_udpstream_data data = {0};
+
+	TEST_MSG("Transfer %i messages of %i bytes with %u%% packet loss...\n",
+			RRR_TEST_UDPSTREAM_MESSAGE_COUNT, RRR_TEST_UDPSTREAM_MESSAGE_SIZE, loss_percent);
+
+	if ((ret = rrr_event_queue_new (&queue)) != 0) {
+		TEST_MSG("- Failed to create event queue\n");
+		goto out_final;
+	}
+
+	if ((ret = __rrr_test_udpstream_init (
+			&data.server,
+			queue,
+			RRR_UDPSTREAM_FLAGS_ACCEPT_CONNECTIONS,
+			RRR_TEST_UDPSTREAM_PORT_SERVER,
+			&data
+	)) != 0) {
+		goto out_destroy_queue;
+	}
+
+	if ((ret = __rrr_test_udpstream_init (
+			&data.client,
+			queue,
+			0,
+			RRR_TEST_UDPSTREAM_PORT_CLIENT,
+			&data
+	)) != 0) {
+		goto out_clear_server;
+	}
+
+	rrr_udpstream_set_loss_simulation(&data.server, loss_percent);
+	rrr_udpstream_set_loss_simulation(&data.client, loss_percent);
+
+	data.time_start = rrr_time_get_64();
+
+	if ((ret = rrr_udpstream_connect (
+			&data.connect_handle,
+			&data.client,
+			"127.0.0.1",
+			RRR_QUOTE_MACRO(RRR_TEST_UDPSTREAM_PORT_SERVER)
+	)) != 0) {
+		TEST_MSG("- Failed to connect\n");
+		goto out_clear_client;
+	}
+
+	rrr_event_dispatch (
+			queue,
+			10 * 1000, // 10 ms
+			__rrr_test_udpstream_periodic,
+			&data
+	);
+
+	if (data.fail) {
+		ret = 1;
+		goto out_clear_client;
+	}
+
+	const uint64_t time_us = rrr_time_get_64() - data.time_connected;
+	TEST_MSG("Received %" PRIu64 " bytes in %" PRIu64 " ms, goodput %.1f kB/s\n",
+			data.received_bytes,
+			time_us / 1000,
+			time_us > 0 ? ((double) data.received_bytes * 1000) / (double) time_us : 0.0
+	);
+
+	if (RRR_DEBUGLEVEL_3) {
+		rrr_udpstream_dump_stats(&data.client);
+	}
+
+	out_clear_client:
+		rrr_udpstream_clear(&data.client);
+	out_clear_server:
+		rrr_udpstream_clear(&data.server);
+	out_destroy_queue:
+		rrr_event_queue_destroy(queue);
+	out_final:
+		return ret;
+}
+
+int rrr_test_udpstream(void) {
+	int ret = 0;
+
+	ret |= __rrr_test_udpstream_transfer(0);
+	ret |= __rrr_test_udpstream_transfer(RRR_TEST_UDPSTREAM_LOSS_PERCENT);
+
+	return ret;
+}
@@ -0,0 +1,176 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Benchmark of the CRC32 checksum used for message framing and in
+// udpstream. The implementation selected at runtime is compared with
+// the byte-at-a-time reference implementation.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../build_timestamp.h"
+#include "../src/main.h"
+#include "../src/lib/version.h"
+#include "../src/lib/allocator.h"
+#include "../src/lib/rrr_strerror.h"
+#include "../src/lib/rrr_types.h"
+#include "../src/lib/cmdlineparser/cmdline.h"
+#include "../src/lib/util/crc32.h"
+#include "../src/lib/util/rrr_time.h"
+
+RRR_CONFIG_DEFINE_DEFAULT_LOG_PREFIX("crc32_bench");
+
+#define CRC32_BENCH_DEFAULT_SIZE       65536
+#define CRC32_BENCH_DEFAULT_ITERATIONS 10000
+
+static const struct cmd_arg_rule cmd_rules[] = {
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    's',    "size",                 "[-s|--size[=]BUFFER SIZE]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'i',    "iterations",           "[-i|--iterations[=]NUMBER OF ITERATIONS]"},
+        {0,                            'l',    "loglevel-translation", "[-l|--loglevel-translation]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'e',    "environment-file",     "[-e|--environment-file[=]ENVIRONMENT FILE]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'd',    "debuglevel",           "[-d|--debuglevel[=]DEBUG FLAGS]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'D',    "debuglevel-on-exit",   "[-D|--debuglevel-on-exit[=]DEBUG FLAGS]"},
+        {0,                            'h',    "help",                 "[-h|--help]"},
+        {0,                            'v',    "version",              "[-v|--version]"},
+        {0,                            '\0',    NULL,                   NULL}
+};
+
+static int crc32_bench_get_number (
+		rrr_length *target,
+		struct cmd_data *cmd,
+		const char *key,
+		rrr_length default_value
+) {
+	const char *value = cmd_get_value(cmd, key, 0);
+	char *end = NULL;
+
+	*target = default_value;
+
+	if (value == NULL) {
+		return 0;
+	}
+
+	unsigned long long tmp = strtoull(value, &end, 10);
+	if (*end != '\0' || tmp == 0 || tmp > RRR_LENGTH_MAX) {
+		RRR_MSG_0("Invalid value '%s' for argument %s\n", value, key);
+		return 1;
+	}
+
+	*target = (rrr_length) tmp;
+
+	return 0;
+}
+
+static uint32_t crc32_bench_measure (
+		const char *name,
+		uint32_t (*method)(const char *buf, rrr_biglength len),
+		const char *buf,
+		rrr_length size,
+		rrr_length iterations
+) {
+	uint32_t crc = 0;
+
+	const uint64_t time_start = rrr_time_get_64();
+	for (rrr_length i = 0; i < iterations; i++) {
+		crc ^= method(buf, size);
+	}
+	const uint64_t time_us = rrr_time_get_64() - time_start;
+
+	printf("%-12s %10" PRIu64 " us %10.1f MB/s\n",
+			name,
+			time_us,
+			time_us > 0 ? ((double) size * iterations) / (double) time_us : 0.0
+	);
+
+	return crc;
+}
+
+int main (int argc, const char **argv, const char **env) {
+	if (!rrr_verify_library_build_timestamp(RRR_BUILD_TIMESTAMP)) {
+		fprintf(stderr, "Library build version mismatch.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	int ret = EXIT_SUCCESS;
+
+	struct cmd_data cmd;
+	rrr_length size = 0;
+	rrr_length iterations = 0;
+	char *buf = NULL;
+
+	if (rrr_allocator_init() != 0) {
+		ret = EXIT_FAILURE;
+		goto out_final;
+	}
+	if (rrr_log_init() != 0) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_allocator;
+	}
+	rrr_strerror_init();
+
+	cmd_init(&cmd, cmd_rules, argc, argv);
+
+	if ((ret = rrr_main_parse_cmd_arguments_and_env(&cmd, env, CMD_CONFIG_DEFAULTS)) != 0) {
+		goto out_cleanup_cmd;
+	}
+
+	if (rrr_main_print_banner_help_and_version(&cmd, 1) != 0) {
+		goto out_cleanup_cmd;
+	}
+
+	if ( crc32_bench_get_number(&size, &cmd, "size", CRC32_BENCH_DEFAULT_SIZE) != 0 ||
+	     crc32_bench_get_number(&iterations, &cmd, "iterations", CRC32_BENCH_DEFAULT_ITERATIONS) != 0
+	) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_cmd;
+	}
+
+	if ((buf = rrr_allocate(size)) == NULL) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = EXIT_FAILURE;
+		goto out_cleanup_cmd;
+	}
+
+	for (rrr_length i = 0; i < size; i++) {
+		buf[i] = (char) (rand() & 0xff);
+	}
+
+	printf("Checksumming %" PRIrrrl " bytes %" PRIrrrl " times, implementation is %s\n",
+			size, iterations, rrr_crc32_implementation());
+
+	if ( crc32_bench_measure("selected", rrr_crc32buf, buf, size, iterations) !=
+	     crc32_bench_measure("bytewise", rrr_crc32buf_bytewise, buf, size, iterations)
+	) {
+		RRR_MSG_0("Checksum mismatch between implementations\n");
+		ret = EXIT_FAILURE;
+	}
+
+	rrr_free(buf);
+
+	out_cleanup_cmd:
+		cmd_destroy(&cmd);
+		rrr_log_cleanup();
+	out_cleanup_allocator:
+		rrr_allocator_cleanup();
+	out_final:
+		return ret;
+}
@@ -0,0 +1,387 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Benchmark of the broker session engine. A number of local clients are
+// created directly in the RAM session collection, each subscribing to its
+// own topic and optionally to a shared wildcard topic. PUBLISH packets are
+// then injected and forwarded to the subscribers, and the send queues are
+// drained, without any network traffic involved.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../build_timestamp.h"
+#include "../src/main.h"
+#include "../src/lib/version.h"
+#include "../src/lib/allocator.h"
+#include "../src/lib/rrr_strerror.h"
+#include "../src/lib/rrr_types.h"
+#include "../src/lib/cmdlineparser/cmdline.h"
+#include "../src/lib/mqtt/mqtt_packet.h"
+#include "../src/lib/mqtt/mqtt_session.h"
+#include "../src/lib/mqtt/mqtt_session_ram.h"
+#include "../src/lib/mqtt/mqtt_subscription.h"
+#include "../src/lib/util/rrr_time.h"
+
+RRR_CONFIG_DEFINE_DEFAULT_LOG_PREFIX("mqtt_broker_bench");
+
+#define MQTT_BROKER_BENCH_DEFAULT_CLIENTS   5000
+#define MQTT_BROKER_BENCH_DEFAULT_PUBLISHES 100000
+
+static const struct cmd_arg_rule cmd_rules[] = {
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'c',    "clients",              "[-c|--clients[=]NUMBER OF CLIENTS]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'p',    "publishes",            "[-p|--publishes[=]NUMBER OF PUBLISHES]"},
+        {0,                            'w',    "wildcard",             "[-w|--wildcard]"},
+        {0,                            'l',    "loglevel-translation", "[-l|--loglevel-translation]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'e',    "environment-file",     "[-e|--environment-file[=]ENVIRONMENT FILE]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'd',    "debuglevel",           "[-d|--debuglevel[=]DEBUG FLAGS]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'D',    "debuglevel-on-exit",   "[-D|--debuglevel-on-exit[=]DEBUG FLAGS]"},
+        {0,                            'h',    "help",                 "[-h|--help]"},
+        {0,                            'v',    "version",              "[-v|--version]"},
+        {0,                            '\0',    NULL,                   NULL}
+};
+
+struct mqtt_broker_bench_data {
+	struct rrr_mqtt_session_collection *sessions;
+	struct rrr_mqtt_session **session_list;
+	rrr_length client_count;
+	rrr_length publish_count;
+	int do_wildcard;
+	uint64_t sent_count;
+};
+
+static void mqtt_broker_bench_publish_notify_callback (RRR_MQTT_SESSION_PUBLISH_NOTIFY_ARGS) {
+	(void)(arg);
+}
+
+static int mqtt_broker_bench_send_callback (struct rrr_mqtt_p *packet, void *arg) {
+	struct mqtt_broker_bench_data *data = arg;
+
+	(void)(packet);
+
+	data->sent_count++;
+
+	return 0;
+}
+
+static int mqtt_broker_bench_get_number (
+		rrr_length *target,
+		struct cmd_data *cmd,
+		const char *key,
+		rrr_length default_value
+) {
+	const char *value = cmd_get_value(cmd, key, 0);
+	char *end = NULL;
+
+	*target = default_value;
+
+	if (value == NULL) {
+		return 0;
+	}
+
+	unsigned long long tmp = strtoull(value, &end, 10);
+	if (*end != '\0' || tmp == 0 || tmp > RRR_LENGTH_MAX) {
+		RRR_MSG_0("Invalid value '%s' for argument %s\n", value, key);
+		return 1;
+	}
+
+	*target = (rrr_length) tmp;
+
+	return 0;
+}
+
+static int mqtt_broker_bench_create_clients (
+		struct mqtt_broker_bench_data *data
+) {
+	int ret = 0;
+
+	const struct rrr_mqtt_p_protocol_version *protocol_version = rrr_mqtt_p_get_protocol_version(RRR_MQTT_VERSION_5);
+	const struct rrr_mqtt_session_properties session_properties = {0};
+	struct rrr_mqtt_p_subscribe *subscribe = NULL;
+	char buf[64];
+
+	for (rrr_length i = 0; i < data->client_count; i++) {
+		struct rrr_mqtt_session **session = &data->session_list[i];
+		short session_was_present = 0;
+		unsigned int ack_match_count = 0;
+
+		sprintf(buf, "client-%" PRIrrrl, i);
+
+		if ((ret = data->sessions->methods->get_session (
+				session,
+				data->sessions,
+				buf,
+				&session_was_present,
+				0
+		)) != 0) {
+			RRR_MSG_0("Failed to create session\n");
+			goto out;
+		}
+
+		if ((ret = data->sessions->methods->init_session (
+				data->sessions,
+				session,
+				&session_properties,
+				1 * 1000 * 1000,
+				65535,
+				1,
+				1
+		)) != 0) {
+			RRR_MSG_0("Failed to initialize session\n");
+			goto out;
+		}
+
+		if ((subscribe = (struct rrr_mqtt_p_subscribe *) rrr_mqtt_p_allocate(RRR_MQTT_P_TYPE_SUBSCRIBE, protocol_version)) == NULL) {
+			RRR_MSG_0("Failed to allocate SUBSCRIBE\n");
+			ret = 1;
+			goto out;
+		}
+
+		sprintf(buf, "bench/%" PRIrrrl "/+", i);
+
+		if ((ret = rrr_mqtt_subscription_collection_push_unique_str (
+				subscribe->subscriptions,
+				buf,
+				0,
+				0,
+				0,
+				0
+		)) != 0) {
+			RRR_MSG_0("Failed to add subscription\n");
+			goto out;
+		}
+
+		if (data->do_wildcard && (ret = rrr_mqtt_subscription_collection_push_unique_str (
+				subscribe->subscriptions,
+				"bench/+/wildcard",
+				0,
+				0,
+				0,
+				0
+		)) != 0) {
+			RRR_MSG_0("Failed to add subscription\n");
+			goto out;
+		}
+
+		if ((ret = data->sessions->methods->receive_packet (
+				data->sessions,
+				session,
+				(struct rrr_mqtt_p *) subscribe,
+				&ack_match_count
+		)) != 0) {
+			RRR_MSG_0("Failed to process SUBSCRIBE\n");
+			goto out;
+		}
+
+		RRR_MQTT_P_DECREF(subscribe);
+		subscribe = NULL;
+	}
+
+	out:
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(subscribe);
+	return ret;
+}
+
+static int mqtt_broker_bench_drain (
+		struct mqtt_broker_bench_data *data
+) {
+	int ret = 0;
+
+	// First round sends QoS 0 packets, second round removes them
+	for (int round = 0; round < 2; round++) {
+		for (rrr_length i = 0; i < data->client_count; i++) {
+			struct rrr_mqtt_session_iterate_send_queue_counters counters = {0};
+			if ((ret = data->sessions->methods->iterate_send_queue (
+					&counters,
+					data->sessions,
+					&data->session_list[i],
+					mqtt_broker_bench_send_callback,
+					data
+			)) != 0) {
+				RRR_MSG_0("Failed to iterate send queue\n");
+				goto out;
+			}
+		}
+	}
+
+	out:
+	return ret;
+}
+
+static int mqtt_broker_bench_publish (
+		struct mqtt_broker_bench_data *data
+) {
+	int ret = 0;
+
+	const struct rrr_mqtt_p_protocol_version *protocol_version = rrr_mqtt_p_get_protocol_version(RRR_MQTT_VERSION_5);
+	struct rrr_mqtt_p_publish *publish = NULL;
+	char buf[64];
+
+	for (rrr_length i = 0; i < data->publish_count; i++) {
+		const rrr_length client = i % data->client_count;
+		unsigned int ack_match_count = 0;
+
+		sprintf(buf, "bench/%" PRIrrrl "/%s", client, (data->do_wildcard && i % 100 == 0 ? "wildcard" : "data"));
+
+		if ((ret = rrr_mqtt_p_new_publish (
+				&publish,
+				buf,
+				"payload",
+				7,
+				protocol_version
+		)) != 0) {
+			RRR_MSG_0("Failed to create PUBLISH\n");
+			goto out;
+		}
+
+		if ((ret = data->sessions->methods->receive_packet (
+				data->sessions,
+				&data->session_list[client],
+				(struct rrr_mqtt_p *) publish,
+				&ack_match_count
+		)) != 0) {
+			RRR_MSG_0("Failed to process PUBLISH\n");
+			goto out;
+		}
+
+		RRR_MQTT_P_DECREF(publish);
+		publish = NULL;
+
+		// Keep queues short like a broker with active clients would
+		if (client == data->client_count - 1 && (ret = mqtt_broker_bench_drain(data)) != 0) {
+			goto out;
+		}
+	}
+
+	ret = mqtt_broker_bench_drain(data);
+
+	out:
+	RRR_MQTT_P_DECREF_IF_NOT_NULL(publish);
+	return ret;
+}
+
+static int mqtt_broker_bench_run (
+		struct mqtt_broker_bench_data *data
+) {
+	int ret = 0;
+
+	if ((data->session_list = rrr_allocate_zero(sizeof(*data->session_list) * data->client_count)) == NULL) {
+		RRR_MSG_0("Failed to allocate session list\n");
+		ret = 1;
+		goto out;
+	}
+
+	if ((ret = rrr_mqtt_session_collection_ram_new_broker(&data->sessions, NULL)) != 0) {
+		RRR_MSG_0("Failed to create session collection\n");
+		goto out;
+	}
+
+	data->sessions->methods->register_callbacks(data->sessions, mqtt_broker_bench_publish_notify_callback, NULL);
+
+	uint64_t time_start = rrr_time_get_64();
+
+	if ((ret = mqtt_broker_bench_create_clients(data)) != 0) {
+		goto out;
+	}
+
+	uint64_t time_subscribed = rrr_time_get_64();
+
+	if ((ret = mqtt_broker_bench_publish(data)) != 0) {
+		goto out;
+	}
+
+	uint64_t time_published = rrr_time_get_64();
+
+	struct rrr_mqtt_session_collection_stats stats = {0};
+	data->sessions->methods->get_stats(&stats, data->sessions);
+
+	const double subscribe_ms = (double) (time_subscribed - time_start) / 1000.0;
+	const double publish_ms = (double) (time_published - time_subscribed) / 1000.0;
+
+	printf("Clients:            %" PRIrrrl "\n", data->client_count);
+	printf("Subscribe time:     %.1f ms\n", subscribe_ms);
+	printf("Publishes:          %" PRIrrrl "\n", data->publish_count);
+	printf("Forwarded:          %" PRIu64 "\n", stats.total_publish_forwarded_out);
+	printf("Sent:               %" PRIu64 "\n", data->sent_count);
+	printf("Publish time:       %.1f ms\n", publish_ms);
+	printf("Publishes/second:   %.0f\n", publish_ms > 0 ? (double) data->publish_count / publish_ms * 1000.0 : 0.0);
+
+	out:
+	if (data->sessions != NULL) {
+		data->sessions->methods->destroy(data->sessions);
+	}
+	RRR_FREE_IF_NOT_NULL(data->session_list);
+	return ret;
+}
+
+int main (int argc, const char **argv, const char **env) {
+	if (!rrr_verify_library_build_timestamp(RRR_BUILD_TIMESTAMP)) {
+		fprintf(stderr, "Library build version mismatch.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	int ret = EXIT_SUCCESS;
+
+	struct cmd_data cmd;
+	struct mqtt_broker_bench_data data = {0};
+
+	if (rrr_allocator_init() != 0) {
+		ret = EXIT_FAILURE;
+		goto out_final;
+	}
+	if (rrr_log_init() != 0) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_allocator;
+	}
+	rrr_strerror_init();
+
+	cmd_init(&cmd, cmd_rules, argc, argv);
+
+	if ((ret = rrr_main_parse_cmd_arguments_and_env(&cmd, env, CMD_CONFIG_DEFAULTS)) != 0) {
+		goto out_cleanup_cmd;
+	}
+
+	if (rrr_main_print_banner_help_and_version(&cmd, 1) != 0) {
+		goto out_cleanup_cmd;
+	}
+
+	if ( mqtt_broker_bench_get_number(&data.client_count, &cmd, "clients", MQTT_BROKER_BENCH_DEFAULT_CLIENTS) != 0 ||
+	     mqtt_broker_bench_get_number(&data.publish_count, &cmd, "publishes", MQTT_BROKER_BENCH_DEFAULT_PUBLISHES) != 0
+	) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_cmd;
+	}
+
+	data.do_wildcard = cmd_exists(&cmd, "wildcard", 0);
+
+	if (mqtt_broker_bench_run(&data) != 0) {
+		ret = EXIT_FAILURE;
+	}
+
+	out_cleanup_cmd:
+		cmd_destroy(&cmd);
+		rrr_log_cleanup();
+	out_cleanup_allocator:
+		rrr_allocator_cleanup();
+	out_final:
+		return ret;
+}
@@ -0,0 +1,321 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Benchmark of handle lookups in the network transport framework. A
+// number of connection handles are created on a plain transport without
+// any network traffic, and lookups by handle id, by connection id (as done
+// for every received QUIC datagram) and by match data (as done by the HTTP
+// client to find keepalive connections) are timed.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define RRR_NET_TRANSPORT_H_ENABLE_INTERNALS
+
+#include "../build_timestamp.h"
+#include "../src/main.h"
+#include "../src/lib/version.h"
+#include "../src/lib/allocator.h"
+#include "../src/lib/rrr_strerror.h"
+#include "../src/lib/rrr_types.h"
+#include "../src/lib/cmdlineparser/cmdline.h"
+#include "../src/lib/event/event.h"
+#include "../src/lib/socket/rrr_socket.h"
+#include "../src/lib/net_transport/net_transport.h"
+#include "../src/lib/net_transport/net_transport_config.h"
+#include "../src/lib/net_transport/net_transport_connection_id.h"
+#include "../src/lib/util/rrr_time.h"
+
+RRR_CONFIG_DEFINE_DEFAULT_LOG_PREFIX("net_transport_bench");
+
+#define NET_TRANSPORT_BENCH_DEFAULT_CONNECTIONS 10000
+#define NET_TRANSPORT_BENCH_DEFAULT_ITERATIONS  100000
+#define NET_TRANSPORT_BENCH_MATCH_STRING        "bench.example.com"
+#define NET_TRANSPORT_BENCH_CID_LENGTH          8
+
+static const struct cmd_arg_rule cmd_rules[] = {
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'c',    "connections",          "[-c|--connections[=]NUMBER OF CONNECTIONS]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'i',    "iterations",           "[-i|--iterations[=]NUMBER OF LOOKUPS]"},
+        {0,                            'l',    "loglevel-translation", "[-l|--loglevel-translation]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'e',    "environment-file",     "[-e|--environment-file[=]ENVIRONMENT FILE]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'd',    "debuglevel",           "[-d|--debuglevel[=]DEBUG FLAGS]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'D',    "debuglevel-on-exit",   "[-D|--debuglevel-on-exit[=]DEBUG FLAGS]"},
+        {0,                            'h',    "help",                 "[-h|--help]"},
+        {0,                            'v',    "version",              "[-v|--version]"},
+        {0,                            '\0',    NULL,                   NULL}
+};
+
+struct net_transport_bench_data {
+	struct rrr_net_transport *transport;
+	rrr_net_transport_handle *handles;
+	struct rrr_net_transport_connection_id *cids;
+	rrr_length connections;
+	rrr_length iterations;
+};
+
+static int net_transport_bench_get_number (
+		rrr_length *target,
+		struct cmd_data *cmd,
+		const char *key,
+		rrr_length default_value
+) {
+	const char *value = cmd_get_value(cmd, key, 0);
+	char *end = NULL;
+
+	*target = default_value;
+
+	if (value == NULL) {
+		return 0;
+	}
+
+	unsigned long long tmp = strtoull(value, &end, 10);
+	if (*end != '\0' || tmp == 0 || tmp > RRR_LENGTH_MAX) {
+		RRR_MSG_0("Invalid value '%s' for argument %s\n", value, key);
+		return 1;
+	}
+
+	*target = (rrr_length) tmp;
+
+	return 0;
+}
+
+static int net_transport_bench_allocate_callback (
+		RRR_NET_TRANSPORT_ALLOCATE_CALLBACK_ARGS
+) {
+	(void)(connection_ids);
+	(void)(datagram);
+	(void)(arg);
+
+	// The plain transport closes the fd and frees the private data upon destruction
+	*submodule_private_ptr = NULL;
+	if ((*submodule_fd = rrr_socket(AF_INET, SOCK_DGRAM, 0, "net_transport_bench", NULL, 0)) < 0) {
+		return 1;
+	}
+
+	return 0;
+}
+
+static int net_transport_bench_ctx_callback (
+		struct rrr_net_transport_handle *handle,
+		void *arg
+) {
+	(void)(handle);
+	(*((rrr_length *) arg))++;
+	return 0;
+}
+
+static int net_transport_bench_populate (
+		struct net_transport_bench_data *data
+) {
+	int ret = 0;
+
+	for (rrr_length i = 0; i < data->connections; i++) {
+		rrr_net_transport_handle handle;
+
+		if ((ret = rrr_net_transport_handle_allocate_and_add (
+				&handle,
+				data->transport,
+				RRR_NET_TRANSPORT_SOCKET_MODE_CONNECTION,
+				"bench",
+				NULL,
+				NULL,
+				net_transport_bench_allocate_callback,
+				NULL
+		)) != 0) {
+			RRR_MSG_0("Failed to add handle %" PRIrrrl ", the open files limit may be too low\n", i);
+			goto out;
+		}
+
+		struct rrr_net_transport_connection_id *cid = &data->cids[i];
+		cid->length = NET_TRANSPORT_BENCH_CID_LENGTH;
+		for (size_t j = 0; j < NET_TRANSPORT_BENCH_CID_LENGTH; j++) {
+			cid->data[j] = (uint8_t) (rand() & 0xff);
+		}
+
+		if ((ret = rrr_net_transport_handle_cid_push(data->transport, handle, cid)) != 0) {
+			RRR_MSG_0("Failed to push connection id for handle %i\n", handle);
+			goto out;
+		}
+
+		if ((ret = rrr_net_transport_handle_match_data_set(data->transport, handle, NET_TRANSPORT_BENCH_MATCH_STRING, i)) != 0) {
+			goto out;
+		}
+
+		data->handles[i] = handle;
+	}
+
+	out:
+	return ret;
+}
+
+static void net_transport_bench_report (
+		const char *name,
+		uint64_t time_us,
+		rrr_length iterations,
+		rrr_length found
+) {
+	printf("%-14s %10" PRIu64 " us %10.1f ns/lookup %10" PRIrrrl " found\n",
+			name,
+			time_us,
+			((double) time_us * 1000.0) / (double) iterations,
+			found
+	);
+}
+
+static int net_transport_bench_run (
+		struct net_transport_bench_data *data
+) {
+	uint64_t time_start;
+	rrr_length found;
+
+	// Visit connections in a pseudo-random order to defeat any locality
+	// which would favour searches from the head of a list
+	rrr_length pos;
+	const rrr_length step = 7919 % data->connections == 0 ? 1 : 7919;
+
+	pos = 0;
+	found = 0;
+	time_start = rrr_time_get_64();
+	for (rrr_length i = 0; i < data->iterations; i++) {
+		pos = (pos + step) % data->connections;
+		rrr_net_transport_handle_with_transport_ctx_do (
+				data->transport,
+				data->handles[pos],
+				net_transport_bench_ctx_callback,
+				&found
+		);
+	}
+	net_transport_bench_report("handle id", rrr_time_get_64() - time_start, data->iterations, found);
+
+	pos = 0;
+	found = 0;
+	time_start = rrr_time_get_64();
+	for (rrr_length i = 0; i < data->iterations; i++) {
+		pos = (pos + step) % data->connections;
+		if (rrr_net_transport_handle_get_by_cid(data->transport, &data->cids[pos]) == data->handles[pos]) {
+			found++;
+		}
+	}
+	net_transport_bench_report("connection id", rrr_time_get_64() - time_start, data->iterations, found);
+
+	pos = 0;
+	found = 0;
+	time_start = rrr_time_get_64();
+	for (rrr_length i = 0; i < data->iterations; i++) {
+		pos = (pos + step) % data->connections;
+		if (rrr_net_transport_handle_get_by_match(data->transport, NET_TRANSPORT_BENCH_MATCH_STRING, pos) == data->handles[pos]) {
+			found++;
+		}
+	}
+	net_transport_bench_report("match data", rrr_time_get_64() - time_start, data->iterations, found);
+
+	return found == data->iterations ? 0 : 1;
+}
+
+int main (int argc, const char **argv, const char **env) {
+	if (!rrr_verify_library_build_timestamp(RRR_BUILD_TIMESTAMP)) {
+		fprintf(stderr, "Library build version mismatch.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	int ret = EXIT_SUCCESS;
+
+	struct cmd_data cmd;
+	struct rrr_event_queue *queue = NULL;
+	struct rrr_net_transport_config config = RRR_NET_TRANSPORT_CONFIG_PLAIN_INITIALIZER;
+	struct net_transport_bench_data data = {0};
+
+	if (rrr_allocator_init() != 0) {
+		ret = EXIT_FAILURE;
+		goto out_final;
+	}
+	if (rrr_log_init() != 0) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_allocator;
+	}
+	rrr_strerror_init();
+
+	cmd_init(&cmd, cmd_rules, argc, argv);
+
+	if ((ret = rrr_main_parse_cmd_arguments_and_env(&cmd, env, CMD_CONFIG_DEFAULTS)) != 0) {
+		goto out_cleanup_cmd;
+	}
+
+	if (rrr_main_print_banner_help_and_version(&cmd, 1) != 0) {
+		goto out_cleanup_cmd;
+	}
+
+	if ( net_transport_bench_get_number(&data.connections, &cmd, "connections", NET_TRANSPORT_BENCH_DEFAULT_CONNECTIONS) != 0 ||
+	     net_transport_bench_get_number(&data.iterations, &cmd, "iterations", NET_TRANSPORT_BENCH_DEFAULT_ITERATIONS) != 0
+	) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_cmd;
+	}
+
+	if ( (data.handles = rrr_allocate(sizeof(*data.handles) * data.connections)) == NULL ||
+	     (data.cids = rrr_allocate(sizeof(*data.cids) * data.connections)) == NULL
+	) {
+		RRR_MSG_0("Could not allocate memory in %s\n", __func__);
+		ret = EXIT_FAILURE;
+		goto out_free;
+	}
+
+	memset(data.cids, '\0', sizeof(*data.cids) * data.connections);
+
+	if (rrr_event_queue_new(&queue) != 0) {
+		ret = EXIT_FAILURE;
+		goto out_free;
+	}
+
+	if (rrr_net_transport_new_simple(&data.transport, &config, "net_transport_bench", 0, queue) != 0) {
+		ret = EXIT_FAILURE;
+		goto out_destroy_queue;
+	}
+
+	if (net_transport_bench_populate(&data) != 0) {
+		ret = EXIT_FAILURE;
+		goto out_destroy_transport;
+	}
+
+	printf("Looking up %" PRIrrrl " times among %" PRIrrrl " connections\n",
+			data.iterations, data.connections);
+
+	if (net_transport_bench_run(&data) != 0) {
+		RRR_MSG_0("Not all lookups returned the expected handle\n");
+		ret = EXIT_FAILURE;
+	}
+
+	out_destroy_transport:
+		rrr_net_transport_destroy(data.transport);
+	out_destroy_queue:
+		rrr_event_queue_destroy(queue);
+	out_free:
+		RRR_FREE_IF_NOT_NULL(data.handles);
+		RRR_FREE_IF_NOT_NULL(data.cids);
+	out_cleanup_cmd:
+		cmd_destroy(&cmd);
+		rrr_log_cleanup();
+	out_cleanup_allocator:
+		rrr_allocator_cleanup();
+	out_final:
+		return ret;
+}
@@ -0,0 +1,432 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Benchmark of TLS handshakes. A TLS server and a TLS client transport
+// are created in the same event loop, and the client connects to the
+// server sequentially a number of times. Each connection is closed once
+// the client has received one byte from the server. Handshake times are
+// reported separately for full handshakes and for resumed sessions.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../build_timestamp.h"
+#include "../src/main.h"
+#include "../src/lib/version.h"
+#include "../src/lib/allocator.h"
+#include "../src/lib/rrr_strerror.h"
+#include "../src/lib/rrr_types.h"
+#include "../src/lib/cmdlineparser/cmdline.h"
+#include "../src/lib/event/event.h"
+#include "../src/lib/net_transport/net_transport.h"
+#include "../src/lib/net_transport/net_transport_config.h"
+#include "../src/lib/util/rrr_time.h"
+
+RRR_CONFIG_DEFINE_DEFAULT_LOG_PREFIX("tls_handshake_bench");
+
+#define TLS_HANDSHAKE_BENCH_DEFAULT_CONNECTIONS 200
+#define TLS_HANDSHAKE_BENCH_DEFAULT_PORT        4443
+#define TLS_HANDSHAKE_BENCH_CERTIFICATE         "misc/ssl/rrr.crt"
+#define TLS_HANDSHAKE_BENCH_KEY                 "misc/ssl/rrr.key"
+#define TLS_HANDSHAKE_BENCH_TIMEOUT_S           30
+
+static const struct cmd_arg_rule cmd_rules[] = {
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'c',    "connections",          "[-c|--connections[=]NUMBER OF CONNECTIONS]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'p',    "port",                 "[-p|--port[=]PORT]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'C',    "certificate",          "[-C|--certificate[=]CERTIFICATE FILE]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'K',    "key",                  "[-K|--key[=]PRIVATE KEY FILE]"},
+        {0,                            'k',    "ktls",                 "[-k|--ktls]"},
+        {0,                            'l',    "loglevel-translation", "[-l|--loglevel-translation]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'e',    "environment-file",     "[-e|--environment-file[=]ENVIRONMENT FILE]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'd',    "debuglevel",           "[-d|--debuglevel[=]DEBUG FLAGS]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'D',    "debuglevel-on-exit",   "[-D|--debuglevel-on-exit[=]DEBUG FLAGS]"},
+        {0,                            'h',    "help",                 "[-h|--help]"},
+        {0,                            'v',    "version",              "[-v|--version]"},
+        {0,                            '\0',    NULL,                   NULL}
+};
+
+struct tls_handshake_bench_data {
+	struct rrr_net_transport *transport_server;
+	struct rrr_net_transport *transport_client;
+	rrr_length connections;
+	rrr_length connections_complete;
+	uint16_t port;
+	int in_progress;
+	int failed;
+	uint64_t time_connect;
+	uint64_t time_handshake;
+	int resumed;
+	uint64_t time_full;
+	uint64_t time_resumed;
+	uint64_t handshakes_resumed;
+	uint64_t timeout;
+};
+
+static int tls_handshake_bench_get_number (
+		rrr_length *target,
+		struct cmd_data *cmd,
+		const char *key,
+		rrr_length default_value,
+		rrr_length max
+) {
+	const char *value = cmd_get_value(cmd, key, 0);
+	char *end = NULL;
+
+	*target = default_value;
+
+	if (value == NULL) {
+		return 0;
+	}
+
+	unsigned long long tmp = strtoull(value, &end, 10);
+	if (*end != '\0' || tmp == 0 || tmp > max) {
+		RRR_MSG_0("Invalid value '%s' for argument %s\n", value, key);
+		return 1;
+	}
+
+	*target = (rrr_length) tmp;
+
+	return 0;
+}
+
+static void tls_handshake_bench_accept_callback (RRR_NET_TRANSPORT_ACCEPT_CALLBACK_FINAL_ARGS) {
+	(void)(handle);
+	(void)(sockaddr);
+	(void)(socklen);
+	(void)(arg);
+}
+
+static void tls_handshake_bench_connect_callback (RRR_NET_TRANSPORT_ACCEPT_CALLBACK_FINAL_ARGS) {
+	(void)(handle);
+	(void)(sockaddr);
+	(void)(socklen);
+	(void)(arg);
+}
+
+static void tls_handshake_bench_listen_callback (RRR_NET_TRANSPORT_BIND_AND_LISTEN_CALLBACK_FINAL_ARGS) {
+	(void)(handle);
+	(void)(arg);
+}
+
+static int tls_handshake_bench_server_handshake_complete_callback (RRR_NET_TRANSPORT_HANDSHAKE_COMPLETE_CALLBACK_ARGS) {
+	(void)(arg);
+
+	// Session tickets are sent after the handshake in TLSv1.3 and the
+	// client must read to receive them, give it something to read.
+	return rrr_net_transport_ctx_send_push_const(handle, "x", 1);
+}
+
+static int tls_handshake_bench_client_handshake_complete_callback (RRR_NET_TRANSPORT_HANDSHAKE_COMPLETE_CALLBACK_ARGS) {
+	struct tls_handshake_bench_data *data = arg;
+	struct rrr_net_transport_tls_stats stats;
+
+	(void)(handle);
+
+	// The counters are updated prior to this callback
+	rrr_net_transport_tls_stats_get(&stats, data->transport_client);
+
+	data->time_handshake = rrr_time_get_64() - data->time_connect;
+	data->resumed = stats.handshakes_resumed > data->handshakes_resumed;
+	data->handshakes_resumed = stats.handshakes_resumed;
+
+	return 0;
+}
+
+static int tls_handshake_bench_server_read_callback (RRR_NET_TRANSPORT_READ_CALLBACK_FINAL_ARGS) {
+	uint64_t bytes_read;
+	char buf[16];
+
+	(void)(arg);
+
+	// Returns error upon close from the client which destroys the handle
+	return rrr_net_transport_ctx_read(&bytes_read, handle, buf, sizeof(buf));
+}
+
+static int tls_handshake_bench_client_read_callback (RRR_NET_TRANSPORT_READ_CALLBACK_FINAL_ARGS) {
+	struct tls_handshake_bench_data *data = arg;
+
+	uint64_t bytes_read;
+	char buf[16];
+	int ret;
+
+	if ((ret = rrr_net_transport_ctx_read(&bytes_read, handle, buf, sizeof(buf))) != 0) {
+		return ret == RRR_NET_TRANSPORT_READ_INCOMPLETE ? 0 : ret;
+	}
+
+	if (data->resumed) {
+		data->time_resumed += data->time_handshake;
+	}
+	else {
+		data->time_full += data->time_handshake;
+	}
+
+	data->connections_complete++;
+	data->in_progress = 0;
+
+	rrr_net_transport_ctx_close_now_set(handle);
+
+	return 0;
+}
+
+static int tls_handshake_bench_periodic (RRR_EVENT_FUNCTION_PERIODIC_ARGS) {
+	struct tls_handshake_bench_data *data = arg;
+
+	if (rrr_time_get_64() > data->timeout) {
+		RRR_MSG_0("Timeout after %i seconds\n", TLS_HANDSHAKE_BENCH_TIMEOUT_S);
+		data->failed = 1;
+		return RRR_EVENT_EXIT;
+	}
+
+	if (data->in_progress) {
+		return RRR_EVENT_OK;
+	}
+
+	if (data->connections_complete == data->connections) {
+		return RRR_EVENT_EXIT;
+	}
+
+	data->in_progress = 1;
+	data->time_connect = rrr_time_get_64();
+
+	if (rrr_net_transport_connect (
+			data->transport_client,
+			data->port,
+			"localhost",
+			tls_handshake_bench_connect_callback,
+			NULL
+	) != 0) {
+		RRR_MSG_0("Connect failed\n");
+		data->failed = 1;
+		return RRR_EVENT_EXIT;
+	}
+
+	return RRR_EVENT_OK;
+}
+
+static int tls_handshake_bench_transport_new (
+		struct rrr_net_transport **target,
+		const struct rrr_net_transport_config *config,
+		const char *name,
+		int flags,
+		struct rrr_event_queue *queue,
+		int (*handshake_complete_callback)(RRR_NET_TRANSPORT_HANDSHAKE_COMPLETE_CALLBACK_ARGS),
+		int (*read_callback)(RRR_NET_TRANSPORT_READ_CALLBACK_FINAL_ARGS),
+		struct tls_handshake_bench_data *data
+) {
+	return rrr_net_transport_new (
+			target,
+			config,
+			name,
+			flags,
+			queue,
+			NULL,
+			0,
+			5 * 1000,  //  5s first read timeout
+			15 * 1000, // 15s soft timeout
+			30 * 1000, // 30s hard timeout
+			16,
+			tls_handshake_bench_accept_callback,
+			data,
+			handshake_complete_callback,
+			data,
+			read_callback,
+			data,
+			NULL,
+			NULL
+	);
+}
+
+static void tls_handshake_bench_report (
+		const char *name,
+		const struct rrr_net_transport_tls_stats *stats
+) {
+	printf("%-8s %6" PRIu64 " handshakes %6" PRIu64 " resumed %6" PRIu64 " kTLS send %6" PRIu64 " kTLS receive\n",
+			name,
+			stats->handshakes,
+			stats->handshakes_resumed,
+			stats->ktls_send,
+			stats->ktls_recv
+	);
+}
+
+int main (int argc, const char **argv, const char **env) {
+	if (!rrr_verify_library_build_timestamp(RRR_BUILD_TIMESTAMP)) {
+		fprintf(stderr, "Library build version mismatch.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	int ret = EXIT_SUCCESS;
+
+	struct cmd_data cmd;
+	struct rrr_event_queue *queue = NULL;
+	struct tls_handshake_bench_data data = {0};
+	struct rrr_net_transport_tls_stats stats_client;
+	struct rrr_net_transport_tls_stats stats_server;
+	rrr_length port;
+
+	struct rrr_net_transport_config config_server = {
+		TLS_HANDSHAKE_BENCH_CERTIFICATE,
+		TLS_HANDSHAKE_BENCH_KEY,
+		NULL,
+		NULL,
+		RRR_NET_TRANSPORT_TLS,
+		RRR_NET_TRANSPORT_F_TLS,
+		RRR_NET_TRANSPORT_TLS_NONE,
+		0
+	};
+
+	struct rrr_net_transport_config config_client = {
+		NULL,
+		NULL,
+		NULL,
+		NULL,
+		RRR_NET_TRANSPORT_TLS,
+		RRR_NET_TRANSPORT_F_TLS,
+		RRR_NET_TRANSPORT_TLS_NONE,
+		0
+	};
+
+	if (rrr_allocator_init() != 0) {
+		ret = EXIT_FAILURE;
+		goto out_final;
+	}
+	if (rrr_log_init() != 0) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_allocator;
+	}
+	rrr_strerror_init();
+
+	cmd_init(&cmd, cmd_rules, argc, argv);
+
+	if ((ret = rrr_main_parse_cmd_arguments_and_env(&cmd, env, CMD_CONFIG_DEFAULTS)) != 0) {
+		goto out_cleanup_cmd;
+	}
+
+	if (rrr_main_print_banner_help_and_version(&cmd, 1) != 0) {
+		goto out_cleanup_cmd;
+	}
+
+	if ( tls_handshake_bench_get_number(&data.connections, &cmd, "connections", TLS_HANDSHAKE_BENCH_DEFAULT_CONNECTIONS, RRR_LENGTH_MAX) != 0 ||
+	     tls_handshake_bench_get_number(&port, &cmd, "port", TLS_HANDSHAKE_BENCH_DEFAULT_PORT, 65535) != 0
+	) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_cmd;
+	}
+
+	data.port = (uint16_t) port;
+
+	if (cmd_get_value(&cmd, "certificate", 0) != NULL) {
+		config_server.tls_certificate_file = (char *) cmd_get_value(&cmd, "certificate", 0);
+	}
+	if (cmd_get_value(&cmd, "key", 0) != NULL) {
+		config_server.tls_key_file = (char *) cmd_get_value(&cmd, "key", 0);
+	}
+	if (cmd_exists(&cmd, "ktls", 0)) {
+		config_server.tls_ktls = 1;
+		config_client.tls_ktls = 1;
+	}
+
+	if (rrr_event_queue_new(&queue) != 0) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_cmd;
+	}
+
+	if (tls_handshake_bench_transport_new (
+			&data.transport_server,
+			&config_server,
+			"tls_handshake_bench server",
+			0,
+			queue,
+			tls_handshake_bench_server_handshake_complete_callback,
+			tls_handshake_bench_server_read_callback,
+			&data
+	) != 0) {
+		ret = EXIT_FAILURE;
+		goto out_destroy_queue;
+	}
+
+	// The certificate is not verified, the point is to measure the
+	// handshake and not to depend on certificate expiry
+	if (tls_handshake_bench_transport_new (
+			&data.transport_client,
+			&config_client,
+			"tls_handshake_bench client",
+			RRR_NET_TRANSPORT_F_TLS_NO_CERT_VERIFY,
+			queue,
+			tls_handshake_bench_client_handshake_complete_callback,
+			tls_handshake_bench_client_read_callback,
+			&data
+	) != 0) {
+		ret = EXIT_FAILURE;
+		goto out_destroy_server;
+	}
+
+	if (rrr_net_transport_bind_and_listen_dualstack (
+			data.transport_server,
+			data.port,
+			tls_handshake_bench_listen_callback,
+			NULL
+	) != 0) {
+		RRR_MSG_0("Could not listen on port %u\n", data.port);
+		ret = EXIT_FAILURE;
+		goto out_destroy_client;
+	}
+
+	data.timeout = rrr_time_get_64() + TLS_HANDSHAKE_BENCH_TIMEOUT_S * 1000 * 1000;
+
+	rrr_event_dispatch(queue, 1000, tls_handshake_bench_periodic, &data);
+
+	if (data.failed || data.connections_complete != data.connections) {
+		RRR_MSG_0("Only %" PRIrrrl " of %" PRIrrrl " handshakes completed\n",
+				data.connections_complete, data.connections);
+		ret = EXIT_FAILURE;
+	}
+
+	rrr_net_transport_tls_stats_get(&stats_client, data.transport_client);
+	rrr_net_transport_tls_stats_get(&stats_server, data.transport_server);
+
+	tls_handshake_bench_report("Client", &stats_client);
+	tls_handshake_bench_report("Server", &stats_server);
+
+	if (stats_client.handshakes > stats_client.handshakes_resumed) {
+		printf("Full handshake    %10.1f us average\n",
+				(double) data.time_full / (double) (stats_client.handshakes - stats_client.handshakes_resumed));
+	}
+	if (stats_client.handshakes_resumed > 0) {
+		printf("Resumed handshake %10.1f us average\n",
+				(double) data.time_resumed / (double) stats_client.handshakes_resumed);
+	}
+
+	out_destroy_client:
+		rrr_net_transport_destroy(data.transport_client);
+	out_destroy_server:
+		rrr_net_transport_destroy(data.transport_server);
+	out_destroy_queue:
+		rrr_event_queue_destroy(queue);
+	out_cleanup_cmd:
+		cmd_destroy(&cmd);
+		rrr_log_cleanup();
+	out_cleanup_allocator:
+		rrr_allocator_cleanup();
+	out_final:
+		return ret;
+}
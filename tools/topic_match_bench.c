@@ -0,0 +1,300 @@
+/*
+
+Read Route Record
+
+Copyright (C) 2026 Atle Solbakken atle@goliathdns.no
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+// Benchmark of topic filter matching as done when several readers poll
+// the same message. The per-reader tokenization used previously is
+// compared with the topic view cached in the message holder.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../build_timestamp.h"
+#include "../src/main.h"
+#include "../src/lib/version.h"
+#include "../src/lib/allocator.h"
+#include "../src/lib/rrr_strerror.h"
+#include "../src/lib/rrr_types.h"
+#include "../src/lib/cmdlineparser/cmdline.h"
+#include "../src/lib/message_helper.h"
+#include "../src/lib/message_holder/message_holder.h"
+#include "../src/lib/message_holder/message_holder_struct.h"
+#include "../src/lib/messages/msg_msg.h"
+#include "../src/lib/mqtt/mqtt_topic.h"
+#include "../src/lib/util/rrr_time.h"
+
+RRR_CONFIG_DEFINE_DEFAULT_LOG_PREFIX("topic_match_bench");
+
+#define TOPIC_MATCH_BENCH_DEFAULT_READERS    8
+#define TOPIC_MATCH_BENCH_DEFAULT_ITERATIONS 100000
+
+static const struct cmd_arg_rule cmd_rules[] = {
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'r',    "readers",              "[-r|--readers[=]NUMBER OF READERS]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'i',    "iterations",           "[-i|--iterations[=]NUMBER OF ITERATIONS]"},
+        {0,                            'l',    "loglevel-translation", "[-l|--loglevel-translation]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'e',    "environment-file",     "[-e|--environment-file[=]ENVIRONMENT FILE]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'd',    "debuglevel",           "[-d|--debuglevel[=]DEBUG FLAGS]"},
+        {CMD_ARG_FLAG_HAS_ARGUMENT,    'D',    "debuglevel-on-exit",   "[-D|--debuglevel-on-exit[=]DEBUG FLAGS]"},
+        {0,                            'h',    "help",                 "[-h|--help]"},
+        {0,                            'v',    "version",              "[-v|--version]"},
+        {0,                            '\0',    NULL,                   NULL}
+};
+
+static const char *topic_match_bench_topics[] = {
+	"sensors/building-a/floor-1/temperature",
+	"sensors/building-b/floor-7/humidity",
+	"actuators/building-a/floor-2/valve",
+	"$SYS/broker/clients"
+};
+
+static const char *topic_match_bench_filters[] = {
+	"sensors/+/+/temperature",
+	"sensors/#",
+	"sensors/building-a/floor-1/temperature",
+	"actuators/building-a/#",
+	"+/building-b/+/humidity",
+	"#",
+	"sensors/building-c/+/temperature",
+	"$SYS/#"
+};
+
+#define TOPIC_MATCH_BENCH_TOPIC_COUNT (sizeof(topic_match_bench_topics) / sizeof(*topic_match_bench_topics))
+#define TOPIC_MATCH_BENCH_FILTER_COUNT (sizeof(topic_match_bench_filters) / sizeof(*topic_match_bench_filters))
+
+static int topic_match_bench_get_number (
+		rrr_length *target,
+		struct cmd_data *cmd,
+		const char *key,
+		rrr_length default_value
+) {
+	const char *value = cmd_get_value(cmd, key, 0);
+	char *end = NULL;
+
+	*target = default_value;
+
+	if (value == NULL) {
+		return 0;
+	}
+
+	unsigned long long tmp = strtoull(value, &end, 10);
+	if (*end != '\0' || tmp == 0 || tmp > RRR_LENGTH_MAX) {
+		RRR_MSG_0("Invalid value '%s' for argument %s\n", value, key);
+		return 1;
+	}
+
+	*target = (rrr_length) tmp;
+
+	return 0;
+}
+
+// Matching as done before the topic view was cached, every reader
+// validates and tokenizes the topic of the message
+static int topic_match_bench_tokenize (
+		int *does_match,
+		const struct rrr_msg_msg *msg,
+		const struct rrr_mqtt_topic_token *filter
+) {
+	struct rrr_mqtt_topic_token *token = NULL;
+
+	*does_match = 0;
+
+	if (rrr_mqtt_topic_validate_name_with_end(MSG_TOPIC_PTR(msg), MSG_TOPIC_PTR(msg) + MSG_TOPIC_LENGTH(msg)) != 0) {
+		return 0;
+	}
+
+	if (rrr_mqtt_topic_tokenize_with_end(&token, MSG_TOPIC_PTR(msg), MSG_TOPIC_PTR(msg) + MSG_TOPIC_LENGTH(msg)) != 0) {
+		return 1;
+	}
+
+	*does_match = rrr_mqtt_topic_match_tokens_recursively(filter, token) == RRR_MQTT_TOKEN_MATCH;
+
+	rrr_mqtt_topic_token_destroy(token);
+
+	return 0;
+}
+
+static int topic_match_bench_run (
+		uint64_t *matches,
+		struct rrr_mqtt_topic_token **filters,
+		const char *topic,
+		rrr_length readers,
+		rrr_length iterations,
+		int use_view
+) {
+	int ret = 0;
+
+	struct rrr_msg_msg *msg = NULL;
+	struct rrr_msg_holder *entry = NULL;
+
+	for (rrr_length i = 0; i < iterations; i++) {
+		if ((ret = rrr_msg_msg_new_with_data (
+				&msg,
+				MSG_TYPE_MSG,
+				MSG_CLASS_DATA,
+				0,
+				topic,
+				(rrr_u16) strlen(topic),
+				NULL,
+				0
+		)) != 0) {
+			goto out;
+		}
+
+		if ((ret = rrr_msg_holder_new (&entry, MSG_TOTAL_SIZE(msg), NULL, 0, 0, msg)) != 0) {
+			goto out;
+		}
+		msg = NULL;
+
+		rrr_msg_holder_lock(entry);
+		for (rrr_length j = 0; j < readers; j++) {
+			const struct rrr_mqtt_topic_token *filter = filters[j % TOPIC_MATCH_BENCH_FILTER_COUNT];
+			int does_match = 0;
+
+			if ((ret = use_view
+				? rrr_message_helper_entry_topic_match(&does_match, entry, filter)
+				: topic_match_bench_tokenize(&does_match, entry->message, filter)
+			) != 0) {
+				rrr_msg_holder_unlock(entry);
+				goto out;
+			}
+
+			*matches += (uint64_t) does_match;
+		}
+		rrr_msg_holder_decref_while_locked_and_unlock(entry);
+		entry = NULL;
+	}
+
+	out:
+	if (entry != NULL) {
+		rrr_msg_holder_decref(entry);
+	}
+	RRR_FREE_IF_NOT_NULL(msg);
+	return ret;
+}
+
+static int topic_match_bench_measure (
+		uint64_t *matches,
+		const char *name,
+		struct rrr_mqtt_topic_token **filters,
+		rrr_length readers,
+		rrr_length iterations,
+		int use_view
+) {
+	*matches = 0;
+
+	const uint64_t time_start = rrr_time_get_64();
+	for (size_t i = 0; i < TOPIC_MATCH_BENCH_TOPIC_COUNT; i++) {
+		if (topic_match_bench_run(matches, filters, topic_match_bench_topics[i], readers, iterations, use_view) != 0) {
+			RRR_MSG_0("Matching failed in %s\n", __func__);
+			return 1;
+		}
+	}
+	const uint64_t time_us = rrr_time_get_64() - time_start;
+	const uint64_t count = (uint64_t) TOPIC_MATCH_BENCH_TOPIC_COUNT * iterations * readers;
+
+	printf("%-12s %10" PRIu64 " us %10.1f ns/match %10" PRIu64 " matches\n",
+			name,
+			time_us,
+			count > 0 ? ((double) time_us * 1000.0) / (double) count : 0.0,
+			*matches
+	);
+
+	return 0;
+}
+
+int main (int argc, const char **argv, const char **env) {
+	if (!rrr_verify_library_build_timestamp(RRR_BUILD_TIMESTAMP)) {
+		fprintf(stderr, "Library build version mismatch.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	int ret = EXIT_SUCCESS;
+
+	struct cmd_data cmd;
+	rrr_length readers = 0;
+	rrr_length iterations = 0;
+	struct rrr_mqtt_topic_token *filters[TOPIC_MATCH_BENCH_FILTER_COUNT] = {0};
+	uint64_t matches_tokenize = 0;
+	uint64_t matches_view = 0;
+
+	if (rrr_allocator_init() != 0) {
+		ret = EXIT_FAILURE;
+		goto out_final;
+	}
+	if (rrr_log_init() != 0) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_allocator;
+	}
+	rrr_strerror_init();
+
+	cmd_init(&cmd, cmd_rules, argc, argv);
+
+	if ((ret = rrr_main_parse_cmd_arguments_and_env(&cmd, env, CMD_CONFIG_DEFAULTS)) != 0) {
+		goto out_cleanup_cmd;
+	}
+
+	if (rrr_main_print_banner_help_and_version(&cmd, 1) != 0) {
+		goto out_cleanup_cmd;
+	}
+
+	if ( topic_match_bench_get_number(&readers, &cmd, "readers", TOPIC_MATCH_BENCH_DEFAULT_READERS) != 0 ||
+	     topic_match_bench_get_number(&iterations, &cmd, "iterations", TOPIC_MATCH_BENCH_DEFAULT_ITERATIONS) != 0
+	) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_cmd;
+	}
+
+	for (size_t i = 0; i < TOPIC_MATCH_BENCH_FILTER_COUNT; i++) {
+		if (rrr_mqtt_topic_tokenize(&filters[i], topic_match_bench_filters[i]) != 0) {
+			RRR_MSG_0("Failed to tokenize filter %s\n", topic_match_bench_filters[i]);
+			ret = EXIT_FAILURE;
+			goto out_cleanup_filters;
+		}
+	}
+
+	printf("Matching %llu topics %" PRIrrrl " times against %" PRIrrrl " readers\n",
+			(unsigned long long) TOPIC_MATCH_BENCH_TOPIC_COUNT, iterations, readers);
+
+	if ( topic_match_bench_measure(&matches_tokenize, "tokenize", filters, readers, iterations, 0) != 0 ||
+	     topic_match_bench_measure(&matches_view, "cached view", filters, readers, iterations, 1) != 0
+	) {
+		ret = EXIT_FAILURE;
+		goto out_cleanup_filters;
+	}
+
+	if (matches_tokenize != matches_view) {
+		RRR_MSG_0("Match count mismatch between methods\n");
+		ret = EXIT_FAILURE;
+	}
+
+	out_cleanup_filters:
+		for (size_t i = 0; i < TOPIC_MATCH_BENCH_FILTER_COUNT; i++) {
+			rrr_mqtt_topic_token_destroy(filters[i]);
+		}
+	out_cleanup_cmd:
+		cmd_destroy(&cmd);
+		rrr_log_cleanup();
+	out_cleanup_allocator:
+		rrr_allocator_cleanup();
+	out_final:
+		return ret;
+}
@@ -0,0 +1,3 @@
+#!/bin/sh
+
+# DO NOT DELETE THIS FILE